@@ -0,0 +1,704 @@
+/**
+ * Benchmark Harness - Headless micro and macro benchmarks
+ *
+ * Links the player's modules (everything but main, ui, browser and
+ * snapshot) and times the hot paths on synthetic data: EQ processing per
+ * active band count, FLAC-rate resampling per quality, the loudness meter,
+ * the spectrum tap and FFT, the whole post-mix path with its callback
+ * timing stats (audiostats.h), directory scans with natural sort, the tag
+ * parsers, metadata cache lookups and glyph atlas draws. FLAC decoding
+ * needs a real file (-f), text needs a font (-F or a system DejaVu); those
+ * cases are reported as skipped otherwise.
+ *
+ * Every result is one JSON object per line, lower is better, so runs
+ * from different commits can be diffed (scripts/bench-compare.sh).
+ * SDL runs with the dummy audio and video drivers; nothing is opened.
+ *
+ * Usage: mono-bench [-o results.jsonl] [-f track.flac] [-F font.ttf] [filter]
+ */
+
+#define _GNU_SOURCE  // nftw, mkdtemp
+
+#include "equalizer.h"
+#include "resample.h"
+#include "loudness.h"
+#include "spectrum.h"
+#include "audiostats.h"
+#include "library.h"
+#include "metadata.h"
+#include "tags.h"
+#include "wav.h"
+#include "glyph.h"
+#include "dr_flac.h"
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/stat.h>
+
+// Minimum measured time per case (iterations double until reached)
+#define BENCH_MIN_NS 300000000ull
+
+#define BENCH_DEFAULT_OUTPUT "bench.jsonl"
+#define BENCH_EQ_FRAMES 1024           // One mixer buffer
+#define BENCH_RESAMPLE_FRAMES 4096     // One FLAC refill
+#define BENCH_MP3_FRAMES 10000         // ~4 MB, ~4 minutes of 128 kbps
+#define BENCH_METADATA_ENTRIES 5000
+#define BENCH_TEXT "Artist Name - A Fairly Long Track Title (Remastered)"
+
+typedef void (*BenchFn)(void *ctx);
+
+static FILE *g_out = NULL;
+static const char *g_filter = NULL;
+static char g_root[64];                // Scratch directory for synthetic files
+static volatile uint64_t g_sink = 0;   // Keeps results alive
+
+/**
+ * Monotonic time in nanoseconds
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Whether a case passes the command line filter
+ */
+static bool selected(const char *name) {
+    return !g_filter || strstr(name, g_filter) != NULL;
+}
+
+/**
+ * Write one result line
+ */
+static void report(const char *name, double value, const char *unit, uint64_t iters) {
+    fprintf(g_out, "{\"bench\":\"%s\",\"value\":%.3f,\"unit\":\"%s\",\"iters\":%llu}\n",
+            name, value, unit, (unsigned long long)iters);
+    fflush(g_out);
+    fprintf(stderr, "  %-32s %12.3f %s\n", name, value, unit);
+}
+
+/**
+ * Record a case that could not run
+ */
+static void skip(const char *name, const char *reason) {
+    if (!selected(name)) return;
+    fprintf(g_out, "{\"bench\":\"%s\",\"skipped\":\"%s\"}\n", name, reason);
+    fprintf(stderr, "  %-32s skipped (%s)\n", name, reason);
+}
+
+/**
+ * Time a case
+ * @param units Work units per call (samples, entries, bytes...)
+ * @param unit Result unit, e.g. "ns/sample"
+ */
+static void run_case(const char *name, const char *unit, double units, BenchFn fn, void *ctx) {
+    if (!selected(name)) return;
+
+    fn(ctx);  // Warm caches and lazy init
+
+    uint64_t iters = 1;
+    uint64_t elapsed = 0;
+    for (;;) {
+        uint64_t start = now_ns();
+        for (uint64_t i = 0; i < iters; i++) fn(ctx);
+        elapsed = now_ns() - start;
+        if (elapsed >= BENCH_MIN_NS || iters >= (1ull << 30)) break;
+        iters *= 2;
+    }
+    report(name, (double)elapsed / ((double)iters * units), unit, iters);
+}
+
+/**
+ * Write a buffer to a new file
+ */
+static bool write_file(const char *path, const void *data, size_t size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    fclose(f);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Equalizer
+// ---------------------------------------------------------------------------
+
+static int16_t g_eq_buf[BENCH_EQ_FRAMES * 2];
+
+static void bench_eq(void *ctx) {
+    (void)ctx;
+    eq_process((uint8_t *)g_eq_buf, (int)sizeof(g_eq_buf));
+}
+
+static void bench_equalizer(void) {
+    // Mixer is never opened, so eq_process() is the only caller
+    eq_init();
+    srand(1);
+    for (int i = 0; i < BENCH_EQ_FRAMES * 2; i++) g_eq_buf[i] = (int16_t)(rand() % 20000 - 10000);
+
+    for (int bands = 0; bands <= EQ_BAND_COUNT; bands++) {
+        for (int b = 0; b < EQ_BAND_COUNT; b++) eq_set_band_db(b, b < bands ? 6 : 0);
+        char name[64];
+        snprintf(name, sizeof(name), "eq_process_%d_bands", bands);
+        run_case(name, "ns/sample", BENCH_EQ_FRAMES * 2, bench_eq, NULL);
+    }
+    eq_reset();
+    eq_cleanup();
+}
+
+// ---------------------------------------------------------------------------
+// Resampler
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    Resampler *r;
+    int16_t in[BENCH_RESAMPLE_FRAMES * 2];
+    int16_t *out;
+} ResampleCase;
+
+static void bench_resample_block(void *ctx) {
+    ResampleCase *c = (ResampleCase *)ctx;
+    g_sink += resample_process(c->r, c->in, BENCH_RESAMPLE_FRAMES, c->out);
+}
+
+static void bench_resample(void) {
+    static const int rates[] = { 48000, 96000 };
+    static const char *quality_names[] = { "fast", "medium", "best" };
+
+    ResampleCase *c = malloc(sizeof(ResampleCase));
+    if (!c) return;
+    srand(2);
+    for (int i = 0; i < BENCH_RESAMPLE_FRAMES * 2; i++) c->in[i] = (int16_t)(rand() % 20000 - 10000);
+
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+        for (int q = RESAMPLE_FAST; q <= RESAMPLE_BEST; q++) {
+            c->r = resample_create(rates[r], 44100, 2, (ResampleQuality)q);
+            c->out = c->r ? malloc(resample_max_output(c->r, BENCH_RESAMPLE_FRAMES) * 2 * sizeof(int16_t)) : NULL;
+            char name[64];
+            snprintf(name, sizeof(name), "resample_%dk_%s", rates[r] / 1000, quality_names[q]);
+            if (c->out) {
+                run_case(name, "ns/frame", BENCH_RESAMPLE_FRAMES, bench_resample_block, c);
+            } else {
+                skip(name, "out of memory");
+            }
+            free(c->out);
+            resample_destroy(c->r);
+        }
+    }
+    free(c);
+}
+
+// ---------------------------------------------------------------------------
+// Loudness meter
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    LoudnessMeter *m;
+    int16_t pcm[BENCH_RESAMPLE_FRAMES * 2];
+} LoudnessCase;
+
+static void bench_loudness_block(void *ctx) {
+    LoudnessCase *c = (LoudnessCase *)ctx;
+    loudness_meter_add(c->m, c->pcm, BENCH_RESAMPLE_FRAMES);
+}
+
+static void bench_loudness(void) {
+    LoudnessCase *c = malloc(sizeof(LoudnessCase));
+    if (!c) return;
+    srand(3);
+    for (int i = 0; i < BENCH_RESAMPLE_FRAMES * 2; i++) c->pcm[i] = (int16_t)(rand() % 20000 - 10000);
+
+    // Background measurement cost per decoded FLAC frame
+    c->m = loudness_meter_create(44100, 2);
+    if (c->m) {
+        run_case("loudness_meter_44k", "ns/frame", BENCH_RESAMPLE_FRAMES, bench_loudness_block, c);
+    } else {
+        skip("loudness_meter_44k", "out of memory");
+    }
+    loudness_meter_destroy(c->m);
+    free(c);
+}
+
+// ---------------------------------------------------------------------------
+// Spectrum
+// ---------------------------------------------------------------------------
+
+static int16_t g_spectrum_block[SPECTRUM_FFT_SIZE];
+
+static void bench_spectrum_tap(void *ctx) {
+    (void)ctx;
+    spectrum_tap(g_eq_buf, BENCH_EQ_FRAMES);
+}
+
+static void bench_spectrum_fft(void *ctx) {
+    (void)ctx;
+    spectrum_analyze(g_spectrum_block);
+    g_sink += (uint64_t)(spectrum_get_bars()[0] * 1000.0f);
+}
+
+static void bench_spectrum(void) {
+    spectrum_init();
+    srand(4);
+    for (int i = 0; i < BENCH_EQ_FRAMES * 2; i++) g_eq_buf[i] = (int16_t)(rand() % 20000 - 10000);
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) g_spectrum_block[i] = (int16_t)(rand() % 20000 - 10000);
+
+    // Audio thread cost per mixer buffer: hidden, then on screen
+    run_case("spectrum_tap_idle", "ns/frame", BENCH_EQ_FRAMES, bench_spectrum_tap, NULL);
+    spectrum_set_active(true);
+    run_case("spectrum_tap_active", "ns/frame", BENCH_EQ_FRAMES, bench_spectrum_tap, NULL);
+    spectrum_set_active(false);
+
+    // UI thread cost per bar update
+    run_case("spectrum_fft_1024", "ns/block", 1, bench_spectrum_fft, NULL);
+}
+
+// ---------------------------------------------------------------------------
+// Post-mix path (as the audio thread runs it, timing stats included)
+// ---------------------------------------------------------------------------
+
+static void bench_postmix_block(void *ctx) {
+    (void)ctx;
+    eq_postmix_process((uint8_t *)g_eq_buf, (int)sizeof(g_eq_buf));
+}
+
+static void bench_postmix(void) {
+    if (!selected("postmix_")) return;
+
+    // Worst case: every band active and the spectrum tap on
+    eq_init();
+    for (int b = 0; b < EQ_BAND_COUNT; b++) eq_set_band_db(b, 6);
+    spectrum_init();
+    spectrum_set_active(true);
+    srand(1);
+    for (int i = 0; i < BENCH_EQ_FRAMES * 2; i++) g_eq_buf[i] = (int16_t)(rand() % 20000 - 10000);
+
+    audiostats_reset();
+    run_case("postmix_path", "ns/frame", BENCH_EQ_FRAMES, bench_postmix_block, NULL);
+
+    // What the HUD would show for the same calls (histogram resolution)
+    AudioStats stats;
+    audiostats_read(&stats);
+    const AudioPathStats *post = &stats.path[AUDIO_PATH_POSTMIX];
+    report("postmix_p99", audiostats_percentile_us(post, 99), "us/callback", post->calls);
+    report("postmix_worst", post->worst_us, "us/callback", post->calls);
+    report("postmix_deadline_misses", stats.deadline_misses, "callbacks", stats.callbacks);
+
+    spectrum_set_active(false);
+    eq_reset();
+    eq_cleanup();
+}
+
+// ---------------------------------------------------------------------------
+// Directory scan + natural sort
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    char path[128];
+    int entries;
+    bool cold;
+} ScanCase;
+
+static void count_entry(const char *name, bool is_dir, void *userdata) {
+    (void)name;
+    (void)is_dir;
+    (*(int *)userdata)++;
+}
+
+static void bench_scan(void *ctx) {
+    ScanCase *c = (ScanCase *)ctx;
+    if (c->cold) library_invalidate(c->path);
+    int count = 0;
+    library_list_dir(c->path, count_entry, &count);
+    g_sink += (uint64_t)count;
+}
+
+/**
+ * Folder of N tracks with unpadded numbers (natural sort has work to do)
+ */
+static bool make_tree(const char *path, int files) {
+    if (mkdir(path, 0755) != 0) return false;
+    char file[256];
+    for (int i = files; i > 0; i--) {
+        snprintf(file, sizeof(file), "%s/%02d Track %d.mp3", path, i % 100, i);
+        FILE *f = fopen(file, "wb");
+        if (!f) return false;
+        fclose(f);
+    }
+    for (int i = 0; i < files / 100; i++) {
+        snprintf(file, sizeof(file), "%s/Disc %d", path, i + 1);
+        mkdir(file, 0755);
+    }
+    return true;
+}
+
+static void bench_library(void) {
+    static const int sizes[] = { 1000, 10000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        char name[64];
+        snprintf(name, sizeof(name), "scan_dir_%dk", sizes[s] / 1000);
+        char cached_name[64];
+        snprintf(cached_name, sizeof(cached_name), "list_cached_%dk", sizes[s] / 1000);
+        if (!selected(name) && !selected(cached_name)) continue;
+
+        ScanCase c;
+        snprintf(c.path, sizeof(c.path), "%s/tree%d", g_root, sizes[s]);
+        if (!make_tree(c.path, sizes[s])) {
+            skip(name, "cannot create tree");
+            continue;
+        }
+        c.entries = sizes[s] + sizes[s] / 100;
+
+        c.cold = true;
+        run_case(name, "ns/entry", c.entries, bench_scan, &c);
+        c.cold = false;
+        run_case(cached_name, "ns/entry", c.entries, bench_scan, &c);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Tag parsers
+// ---------------------------------------------------------------------------
+
+static char g_mp3_path[128];
+static long g_mp3_size = 0;
+
+/**
+ * Append an ID3v2.3 text frame
+ */
+static size_t id3_frame(uint8_t *p, const char *id, const char *text) {
+    size_t len = strlen(text) + 1;  // Encoding byte + text
+    memcpy(p, id, 4);
+    p[4] = (uint8_t)(len >> 24);
+    p[5] = (uint8_t)(len >> 16);
+    p[6] = (uint8_t)(len >> 8);
+    p[7] = (uint8_t)len;
+    p[8] = p[9] = 0;
+    p[10] = 0;  // ISO-8859-1
+    memcpy(p + 11, text, len - 1);
+    return 10 + len;
+}
+
+/**
+ * CBR MP3: ID3v2 tag, 128 kbps frames, ID3v1 trailer
+ */
+static bool make_mp3(const char *path) {
+    const size_t frame_len = 417;  // 144 * 128000 / 44100
+    size_t size = 512 + BENCH_MP3_FRAMES * frame_len + 128;
+    uint8_t *data = calloc(1, size);
+    if (!data) return false;
+
+    size_t body = 0;
+    uint8_t *frames = data + 10;
+    body += id3_frame(frames + body, "TIT2", "Benchmark Title");
+    body += id3_frame(frames + body, "TPE1", "Benchmark Artist");
+    body += id3_frame(frames + body, "TALB", "Benchmark Album");
+    memcpy(data, "ID3\x03\x00\x00", 6);
+    data[6] = (uint8_t)((body >> 21) & 0x7F);
+    data[7] = (uint8_t)((body >> 14) & 0x7F);
+    data[8] = (uint8_t)((body >> 7) & 0x7F);
+    data[9] = (uint8_t)(body & 0x7F);
+
+    size_t pos = 10 + body;
+    for (int i = 0; i < BENCH_MP3_FRAMES; i++) {
+        static const uint8_t header[4] = { 0xFF, 0xFB, 0x90, 0x00 };
+        memcpy(data + pos, header, 4);
+        pos += frame_len;
+    }
+    memcpy(data + pos, "TAG", 3);
+    pos += 128;
+
+    bool ok = write_file(path, data, pos);
+    free(data);
+    g_mp3_size = (long)pos;
+    return ok;
+}
+
+static void bench_probe(void *ctx) {
+    (void)ctx;
+    TrackInfo info;
+    tags_probe(g_mp3_path, &info);
+    g_sink += (uint64_t)info.duration_sec;
+}
+
+static void bench_probe_toc(void *ctx) {
+    (void)ctx;
+    TrackInfo info;
+    Mp3Toc toc;
+    tags_probe_toc(g_mp3_path, &info, &toc);
+    g_sink += toc.offsets[MP3_TOC_POINTS];
+}
+
+static void bench_scan_mp3(void *ctx) {
+    (void)ctx;
+    Mp3Toc toc;
+    tags_scan_mp3(g_mp3_path, &toc, NULL);
+    g_sink += toc.duration_ms;
+}
+
+static void bench_tags(void) {
+    snprintf(g_mp3_path, sizeof(g_mp3_path), "%s/track.mp3", g_root);
+    if (!make_mp3(g_mp3_path)) {
+        skip("tags_probe", "cannot write MP3");
+        return;
+    }
+    run_case("tags_probe", "ns/call", 1, bench_probe, NULL);
+    run_case("tags_probe_toc", "ns/call", 1, bench_probe_toc, NULL);
+    run_case("tags_scan_mp3", "ns/KB", g_mp3_size / 1024.0, bench_scan_mp3, NULL);
+}
+
+// ---------------------------------------------------------------------------
+// Metadata cache
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    unsigned int next;
+    bool hit;
+} LookupCase;
+
+static void bench_lookup(void *ctx) {
+    LookupCase *c = (LookupCase *)ctx;
+    char path[128];
+    unsigned int i = (c->next = c->next * 1103515245u + 12345u) % BENCH_METADATA_ENTRIES;
+    snprintf(path, sizeof(path), "/music/Artist %u/%s %u.mp3", i % 100, c->hit ? "Track" : "Missing", i);
+    MetadataResult result;
+    g_sink += metadata_get_cached(path, &result);
+}
+
+static void bench_metadata(void) {
+    if (!selected("metadata_get_cached")) return;
+
+    // The cache imports the legacy JSON file on first open ($HOME is g_root)
+    char dir[128], path[160];
+    snprintf(dir, sizeof(dir), "%s/.mono", g_root);
+    mkdir(dir, 0755);
+    snprintf(path, sizeof(path), "%s/metadata_cache.json", dir);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        skip("metadata_get_cached_hit", "cannot write cache");
+        return;
+    }
+    fprintf(f, "{");
+    for (int i = 0; i < BENCH_METADATA_ENTRIES; i++) {
+        fprintf(f, "%s\"/music/Artist %d/Track %d.mp3\":{\"title\":\"Title %d\","
+                "\"artist\":\"Artist %d\",\"album\":\"Album %d\",\"confidence\":95}",
+                i ? "," : "", i % 100, i, i, i % 100, i % 100);
+    }
+    fprintf(f, "}");
+    fclose(f);
+    metadata_init();
+
+    LookupCase c = { 1, true };
+    run_case("metadata_get_cached_hit", "ns/lookup", 1, bench_lookup, &c);
+    c.hit = false;
+    run_case("metadata_get_cached_miss", "ns/lookup", 1, bench_lookup, &c);
+    metadata_cleanup();
+}
+
+// ---------------------------------------------------------------------------
+// Glyph atlas
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    SDL_Renderer *renderer;
+    TTF_Font *font;
+    GlyphAtlas *atlas;
+} TextCase;
+
+static void bench_text_hit(void *ctx) {
+    TextCase *c = (TextCase *)ctx;
+    SDL_Color white = { 255, 255, 255, 255 };
+    g_sink += (uint64_t)glyph_atlas_draw(c->atlas, BENCH_TEXT, 0, 0, white);
+}
+
+static void bench_text_measure(void *ctx) {
+    TextCase *c = (TextCase *)ctx;
+    g_sink += (uint64_t)glyph_atlas_measure(c->atlas, BENCH_TEXT, -1);
+}
+
+static void bench_text_miss(void *ctx) {
+    TextCase *c = (TextCase *)ctx;
+    SDL_Color white = { 255, 255, 255, 255 };
+    GlyphAtlas *atlas = glyph_atlas_create(c->renderer, c->font);
+    if (!atlas) return;
+    g_sink += (uint64_t)glyph_atlas_draw(atlas, BENCH_TEXT, 0, 0, white);
+    glyph_atlas_destroy(atlas);
+}
+
+static void bench_text(const char *font_path) {
+    static const char *fallbacks[] = {
+        "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+        "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+        "/usr/trimui/res/regular.ttf",
+        NULL
+    };
+    for (int i = 0; !font_path && fallbacks[i]; i++) {
+        if (access(fallbacks[i], R_OK) == 0) font_path = fallbacks[i];
+    }
+    if (!font_path) {
+        skip("glyph_draw_hit", "no font (-F)");
+        return;
+    }
+    if (!selected("glyph_")) return;
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, 1024, 768, 32, SDL_PIXELFORMAT_ARGB8888);
+    TextCase c = {0};
+    c.renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    if (!c.renderer || TTF_Init() < 0 || !(c.font = TTF_OpenFont(font_path, 32))) {
+        skip("glyph_draw_hit", "no renderer or font");
+        if (c.renderer) SDL_DestroyRenderer(c.renderer);
+        if (surface) SDL_FreeSurface(surface);
+        return;
+    }
+    c.atlas = glyph_atlas_create(c.renderer, c.font);
+
+    double glyphs = (double)strlen(BENCH_TEXT);
+    if (c.atlas) {
+        run_case("glyph_draw_hit", "ns/glyph", glyphs, bench_text_hit, &c);
+        run_case("glyph_measure", "ns/glyph", glyphs, bench_text_measure, &c);
+        glyph_atlas_destroy(c.atlas);
+    }
+    run_case("glyph_draw_miss", "ns/glyph", glyphs, bench_text_miss, &c);
+
+    TTF_CloseFont(c.font);
+    TTF_Quit();
+    SDL_DestroyRenderer(c.renderer);
+    SDL_FreeSurface(surface);
+}
+
+// ---------------------------------------------------------------------------
+// FLAC decode
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const char *path;
+    uint64_t frames;
+} FlacCase;
+
+static void bench_flac_full(void *ctx) {
+    FlacCase *c = (FlacCase *)ctx;
+    drflac *flac = drflac_open_file(c->path, NULL);
+    if (!flac) return;
+    int16_t buf[4096 * 2];
+    uint64_t n;
+    while ((n = drflac_read_pcm_frames_s16(flac, (sizeof(buf) / sizeof(buf[0])) / flac->channels, buf)) > 0) {
+        g_sink += (uint64_t)buf[0] + n;
+    }
+    drflac_close(flac);
+}
+
+static void bench_flac_wav(void *ctx) {
+    FlacCase *c = (FlacCase *)ctx;
+    drflac *flac = drflac_open_file(c->path, NULL);
+    if (!flac) return;
+    size_t size = 0;
+    uint64_t frames = 0;
+    uint8_t *wav = wav_decode_flac(flac, flac->totalPCMFrameCount, &size, &frames);
+    g_sink += frames;
+    wav_release(wav);
+    drflac_close(flac);
+}
+
+static void bench_flac(const char *path) {
+    if (!path) {
+        skip("flac_decode_stream", "no FLAC file (-f)");
+        skip("flac_decode_wav", "no FLAC file (-f)");
+        return;
+    }
+    drflac *flac = drflac_open_file(path, NULL);
+    if (!flac) {
+        skip("flac_decode_stream", "cannot open FLAC");
+        return;
+    }
+    FlacCase c = { path, flac->totalPCMFrameCount };
+    drflac_close(flac);
+    if (c.frames == 0) {
+        skip("flac_decode_stream", "empty FLAC");
+        return;
+    }
+
+    run_case("flac_decode_stream", "ns/frame", (double)c.frames, bench_flac_full, &c);
+    run_case("flac_decode_wav", "ns/frame", (double)c.frames, bench_flac_wav, &c);
+    wav_pool_cleanup();
+}
+
+// ---------------------------------------------------------------------------
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = BENCH_DEFAULT_OUTPUT;
+    const char *flac_path = NULL;
+    const char *font_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) flac_path = argv[++i];
+        else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) font_path = argv[++i];
+        else if (argv[i][0] != '-') g_filter = argv[i];
+        else {
+            fprintf(stderr, "Usage: %s [-o results.jsonl] [-f track.flac] [-F font.ttf] [filter]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    g_out = fopen(output, "w");
+    if (!g_out) {
+        fprintf(stderr, "Cannot write %s\n", output);
+        return 1;
+    }
+
+    snprintf(g_root, sizeof(g_root), "/tmp/mono-bench-XXXXXX");
+    if (!mkdtemp(g_root)) {
+        fprintf(stderr, "Cannot create scratch directory\n");
+        return 1;
+    }
+    setenv("HOME", g_root, 1);  // Module caches land in the scratch dir
+
+    setenv("SDL_AUDIODRIVER", "dummy", 1);
+    setenv("SDL_VIDEODRIVER", "dummy", 1);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
+    }
+
+    const char *commit = getenv("BENCH_COMMIT");
+#if defined(__aarch64__)
+    const char *arch = "aarch64";
+#elif defined(__x86_64__)
+    const char *arch = "x86_64";
+#else
+    const char *arch = "other";
+#endif
+    fprintf(g_out, "{\"meta\":{\"commit\":\"%s\",\"arch\":\"%s\",\"min_ns\":%llu}}\n",
+            commit ? commit : "", arch, (unsigned long long)BENCH_MIN_NS);
+
+    // Module logs go to stdout; results to the file, and a summary to stderr
+    fprintf(stderr, "Mono benchmarks (%s) -> %s\n", arch, output);
+    bench_equalizer();
+    bench_resample();
+    bench_loudness();
+    bench_spectrum();
+    bench_postmix();
+    bench_library();
+    bench_tags();
+    bench_metadata();
+    bench_text(font_path);
+    bench_flac(flac_path);
+
+    nftw(g_root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    SDL_Quit();
+    fclose(g_out);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#!/bin/sh
+# bench-compare.sh — Compare two mono-bench result files
+# Usage: scripts/bench-compare.sh <old.jsonl> <new.jsonl> [threshold%]
+# Prints every case with its change; lower values are better.
+# Exit code 1 if any case got slower than the threshold (default 10%)
+# Plain awk: mono-bench writes one flat JSON object per line, nothing nested
+# but its meta line.
+
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <old.jsonl> <new.jsonl> [threshold%]"
+    exit 2
+fi
+
+exec awk -v threshold="${3:-10}" '
+# String value of "key":"..." on a line ("" if absent)
+function str(line, key) {
+    if (!match(line, "\"" key "\":\"[^\"]*\"")) return ""
+    return substr(line, RSTART + length(key) + 4, RLENGTH - length(key) - 5)
+}
+
+# Numeric value of "key":n on a line
+function num(line, key) {
+    if (!match(line, "\"" key "\":-?[0-9.eE+-]+")) return 0
+    return substr(line, RSTART + length(key) + 3, RLENGTH - length(key) - 3) + 0
+}
+
+FNR == 1 { side = (++files == 1) ? "old" : "new" }
+
+/"meta":/ { commit[side] = str($0, "commit"); next }
+
+/"value":/ {
+    name = str($0, "bench")
+    value[side, name] = num($0, "value")
+    has[side, name] = 1
+    if (!(name in seen)) {
+        seen[name] = 1
+        names[++count] = name
+    }
+}
+
+END {
+    # Insertion sort: a few dozen cases at most
+    for (i = 2; i <= count; i++) {
+        n = names[i]
+        for (j = i - 1; j >= 1 && names[j] > n; j--) names[j + 1] = names[j]
+        names[j + 1] = n
+    }
+
+    header = "bench (" (commit["old"] != "" ? commit["old"] : "?") " -> " \
+             (commit["new"] != "" ? commit["new"] : "?") ")"
+    printf "%-32s %12s %12s %8s\n", header, "old", "new", "change"
+
+    regressions = 0
+    for (i = 1; i <= count; i++) {
+        n = names[i]
+        if (!has["old", n] || !has["new", n]) {
+            printf "%-32s %12s\n", n, "only in " (has["new", n] ? "new" : "old")
+            continue
+        }
+        a = value["old", n]
+        b = value["new", n]
+        change = a != 0 ? (b - a) * 100.0 / a : 0.0
+        flag = ""
+        if (change > threshold) {
+            flag = "  SLOWER"
+            regressions++
+        } else if (change < -threshold) {
+            flag = "  faster"
+        }
+        printf "%-32s %12.3f %12.3f %+7.1f%%%s\n", n, a, b, change, flag
+    }
+    exit regressions ? 1 : 0
+}
+' "$1" "$2"
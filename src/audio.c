@@ -2,12 +2,24 @@
  * Audio Engine Implementation
  *
  * Uses SDL_mixer for audio playback with support for MP3, FLAC, and OGG.
- * FLAC files are decoded via dr_flac since SDL_mixer on Trimui lacks FLAC support.
- * Provides basic ID3 tag extraction for metadata display.
+ * FLAC files are decoded via dr_flac since SDL_mixer on Trimui lacks FLAC support,
+ * streamed through Mix_HookMusic() so only a few KB of PCM is resident at a time.
+ * The hook runs two FLAC decks, so the next track queued from the preloader
+ * starts at the exact sample the current one ends (or crossfades into it).
+ * Provides basic ID3 tag extraction for metadata display, and sets each
+ * track's loudness gain when it starts to be heard.
  */
 
 #include "audio.h"
+#include "audiostats.h"
+#include "btvolume.h"
+#include "iosched.h"
+#include "loudness.h"
 #include "metadata.h"
+#include "mp3index.h"
+#include "resample.h"
+#include "tags.h"
+#include "wav.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
 #include <stdio.h>
@@ -26,25 +38,87 @@ static TrackInfo g_track_info;
 static bool g_is_paused = false;
 static int g_volume = 80;  // Default 80%
 static bool g_using_bluetooth = false;  // Track if using bluealsa output
-static char g_bluealsa_control[64] = {0};  // Bluealsa mixer control name (e.g. "WH-1000XM5 A2DP")
 
 // Track start time for position calculation
 static Uint32 g_start_time = 0;
 static Uint32 g_pause_time = 0;
 static double g_music_position = 0.0;
 
-// FLAC decoded to WAV in memory
-static uint8_t *g_flac_wav_data = NULL;
-static size_t g_flac_wav_size = 0;
-static int g_flac_sample_rate = 0;
-static int g_flac_channels = 0;
-static int g_flac_duration = 0;
-static char g_current_path[512] = {0};  // For FLAC seek (reload from position)
+// Compressed file image backing g_music when loaded from a preload (freed after it)
+static uint8_t *g_music_file_data = NULL;
+static size_t g_music_file_size = 0;
+
+// Device period: follows the power mode and screen, but the device is only
+// reopened while nothing is loaded (or right before a cold load), so a
+// change never interrupts audio
+#define PERIOD_MIN_INTERVAL_MS 2000            // Don't churn on quick dim/undim
+static int g_period_frames = AUDIO_PERIOD_DEFAULT;
+static int g_period_target = AUDIO_PERIOD_DEFAULT;
+static Uint32 g_period_changed = 0;
+
+// MP3 seek table: seeks reopen the stream at the TOC offset instead of
+// letting SDL_mixer decode forward from the start
+#define TOC_POLL_MS 1000                       // Check for a background scan result
+static Mp3Toc g_toc = {0};
+static bool g_toc_pending = false;             // Waiting for mp3index to scan the file
+static Uint32 g_toc_last_poll = 0;
+
+static char g_current_path[512] = {0};  // For FLAC seek (reopen from position)
+
+// FLAC playback runs through the SDL_mixer music hook on two decks: the one
+// playing and the next track, queued from the preloader. Each deck reads
+// from up to two sources:
+// - resident PCM: preloaded WAV image (whole track or head), read through a frame cursor
+// - dr_flac stream: decodes on demand, memory stays constant (~100KB)
+// When both are present the stream continues where the resident head ends.
+// The hook moves to the queued deck at the exact sample the playing one runs
+// out, or mixes both over the crossfade window, so a transition never waits
+// for the main loop.
+#define FLAC_DECODE_FRAMES 4096      // PCM frames decoded per refill (~93ms at 44.1kHz)
+#define FLAC_MIX_BUFFER_SIZE 16384   // Converted output staged before volume mixing
+#define FLAC_FADE_BLOCK_FRAMES 256   // Crossfade gain steps (~6ms at 44.1kHz)
+#define CROSSFADE_MAX_SEC 12
 
-// FLAC chunked decoding - only decode N seconds at a time for fast seeking
-#define FLAC_CHUNK_SECONDS 60  // Decode 60 seconds at a time
-static int g_flac_chunk_start = 0;  // Start time of current chunk in seconds
-static int g_flac_chunk_end = 0;    // End time of current chunk in seconds
+/**
+ * One FLAC source with its own converter and playback clock
+ */
+typedef struct {
+    drflac *flac;
+    uint8_t *wav_data;               // Preloaded WAV image backing pcm (wav pool)
+    size_t wav_size;
+    const int16_t *pcm;              // Resident PCM (inside wav_data)
+    uint64_t pcm_frames;             // Total frames in resident PCM
+    uint64_t pcm_cursor;             // Next resident frame to hand to the hook
+    uint64_t total_frames;           // Track length in source frames (0 = unknown)
+    int src_rate;                    // Source sample rate
+    int src_channels;                // Source channel count
+    int duration_sec;
+    SDL_AudioStream *stream;         // Converts source channels/format to the device's
+    Resampler *resampler;            // Source rate to device rate (NULL if equal)
+    int16_t *resample_buf;
+    int16_t *decode_buf;
+    bool active;                     // Loaded, the hook may read it
+    bool drained;                    // Source reached end, stream flushed
+    bool finished;                   // All audio delivered to device
+    uint64_t base_frame;             // Source frame at last open/seek
+    uint64_t out_bytes;              // Output bytes delivered since then
+    char path[512];
+    TrackInfo info;                  // Queued deck: tags read when it was queued
+} Deck;
+
+static Deck g_decks[2];
+static int g_deck = 0;                         // Playing deck, the other one is queued
+static bool g_handoff = false;                 // Hook moved to the queued deck
+static char g_handoff_path[512] = {0};         // Track that took over, for audio_take_handoff()
+static int g_crossfade_sec = 0;
+static ResampleQuality g_resample_quality = RESAMPLE_MEDIUM;
+static int64_t g_fade_bytes = 0;               // Output bytes both decks overlap (or the playing one fades)
+static Uint8 *g_flac_mix_buf = NULL;
+static SDL_mutex *g_flac_mutex = NULL;         // Guards decks between hook and main thread
+static Uint16 g_device_format = AUDIO_S16SYS;
+static int g_device_frame_bytes = 4;           // Bytes per output frame (all channels)
+static int g_device_freq = 44100;
+static bool g_flac_hooked = false;             // Music hook installed (playback started)
 
 /**
  * Check if file has FLAC extension
@@ -56,602 +130,482 @@ static bool is_flac_file(const char *path) {
 }
 
 /**
- * Decode FLAC to WAV in memory using dr_flac, decoding a chunk from start to end
- * @param path Path to FLAC file
- * @param start_sec Starting position in seconds (0 = beginning)
- * @param end_sec Ending position in seconds (-1 = decode to end)
- * @param out_data Output: pointer to allocated WAV data (caller must free)
- * @param out_size Output: size of WAV data
- * @param out_sample_rate Output: sample rate of decoded audio
- * @param out_channels Output: number of channels
- * @return Total duration in seconds, or 0 on failure
+ * Deck that is playing (or loaded to play)
  */
-static int decode_flac_to_wav(const char *path, int start_sec, int end_sec, uint8_t **out_data, size_t *out_size,
-                               int *out_sample_rate, int *out_channels) {
-    drflac *pFlac = drflac_open_file(path, NULL);
-    if (!pFlac) {
-        fprintf(stderr, "[AUDIO] Failed to open FLAC: %s\n", path);
-        return 0;
-    }
-
-    // Get FLAC properties
-    uint32_t sample_rate = pFlac->sampleRate;
-    uint32_t channels = pFlac->channels;
-    uint64_t total_frames = pFlac->totalPCMFrameCount;
-    int duration_sec = (int)(total_frames / sample_rate);
-
-    // Calculate start frame for seek
-    uint64_t start_frame = 0;
-    if (start_sec > 0 && start_sec < duration_sec) {
-        start_frame = (uint64_t)start_sec * sample_rate;
-        if (!drflac_seek_to_pcm_frame(pFlac, start_frame)) {
-            // Seek failed - this is a real error, don't silently fall back
-            fprintf(stderr, "[AUDIO] FLAC seek to %d sec failed\n", start_sec);
-            drflac_close(pFlac);
-            return 0;  // Return failure instead of silently playing from wrong position
-        }
-    }
-
-    // Calculate end frame (chunked decoding)
-    uint64_t end_frame = total_frames;
-    if (end_sec > 0 && end_sec < duration_sec) {
-        end_frame = (uint64_t)end_sec * sample_rate;
-    }
-
-    uint64_t frames_to_decode = end_frame - start_frame;
-
-    // Allocate buffer for decoded PCM (16-bit samples)
-    size_t pcm_size = frames_to_decode * channels * sizeof(int16_t);
-    int16_t *pcm_data = (int16_t *)malloc(pcm_size);
-    if (!pcm_data) {
-        fprintf(stderr, "[AUDIO] Failed to allocate PCM buffer (%zu bytes)\n", pcm_size);
-        drflac_close(pFlac);
-        return 0;
-    }
-
-    // Decode frames
-    uint64_t frames_read = drflac_read_pcm_frames_s16(pFlac, frames_to_decode, pcm_data);
-    drflac_close(pFlac);
-
-    // Build WAV file in memory (44-byte header + PCM data)
-    size_t wav_size = 44 + (frames_read * channels * sizeof(int16_t));
-    uint8_t *wav_data = (uint8_t *)malloc(wav_size);
-    if (!wav_data) {
-        fprintf(stderr, "[AUDIO] Failed to allocate WAV buffer\n");
-        free(pcm_data);
-        return 0;
-    }
-
-    // WAV header
-    uint32_t data_size = (uint32_t)(frames_read * channels * sizeof(int16_t));
-    uint32_t file_size = 36 + data_size;
-    uint16_t block_align = channels * sizeof(int16_t);
-    uint32_t byte_rate = sample_rate * block_align;
-
-    // RIFF header
-    memcpy(wav_data + 0, "RIFF", 4);
-    memcpy(wav_data + 4, &file_size, 4);
-    memcpy(wav_data + 8, "WAVE", 4);
-
-    // fmt chunk
-    memcpy(wav_data + 12, "fmt ", 4);
-    uint32_t fmt_size = 16;
-    memcpy(wav_data + 16, &fmt_size, 4);
-    uint16_t audio_format = 1;  // PCM
-    memcpy(wav_data + 20, &audio_format, 2);
-    uint16_t num_channels = (uint16_t)channels;
-    memcpy(wav_data + 22, &num_channels, 2);
-    memcpy(wav_data + 24, &sample_rate, 4);
-    memcpy(wav_data + 28, &byte_rate, 4);
-    memcpy(wav_data + 32, &block_align, 2);
-    uint16_t bits_per_sample = 16;
-    memcpy(wav_data + 34, &bits_per_sample, 2);
-
-    // data chunk
-    memcpy(wav_data + 36, "data", 4);
-    memcpy(wav_data + 40, &data_size, 4);
-
-    // Copy PCM data
-    memcpy(wav_data + 44, pcm_data, data_size);
-    free(pcm_data);
-
-    *out_data = wav_data;
-    *out_size = wav_size;
-    *out_sample_rate = (int)sample_rate;
-    *out_channels = (int)channels;
-
-    return duration_sec;
+static Deck* flac_deck(void) {
+    return &g_decks[g_deck];
 }
 
 /**
- * Free FLAC WAV buffer and reset chunk tracking
+ * Whether a FLAC source is loaded on the playing deck
  */
-static void free_flac_buffer(void) {
-    if (g_flac_wav_data) {
-        free(g_flac_wav_data);
-        g_flac_wav_data = NULL;
-    }
-    g_flac_wav_size = 0;
-    g_flac_sample_rate = 0;
-    g_flac_channels = 0;
-    g_flac_duration = 0;
-    g_flac_chunk_start = 0;
-    g_flac_chunk_end = 0;
+static bool flac_active(void) {
+    return g_decks[g_deck].active;
 }
 
 /**
- * Load FLAC file from a given position (chunked decoding for fast seeking)
- * Only decodes FLAC_CHUNK_SECONDS at a time for responsive UI
+ * Hand source frames to a deck's converter, resampling them first if needed
  */
-static bool load_flac_from_position(const char *path, int start_sec) {
-    // Calculate chunk boundaries
-    int chunk_start = start_sec;
-    int chunk_end = start_sec + FLAC_CHUNK_SECONDS;  // Decode only a chunk
-
-    // Decode FLAC chunk to WAV
-    int duration = decode_flac_to_wav(path, chunk_start, chunk_end, &g_flac_wav_data, &g_flac_wav_size,
-                                       &g_flac_sample_rate, &g_flac_channels);
-    if (duration <= 0 || !g_flac_wav_data) {
-        return false;
+static void flac_deck_put(Deck *d, const int16_t *pcm, uint64_t frames) {
+    if (!d->resampler) {
+        SDL_AudioStreamPut(d->stream, pcm, (int)(frames * d->src_channels * sizeof(int16_t)));
+        return;
     }
+    int out = resample_process(d->resampler, pcm, (int)frames, d->resample_buf);
+    SDL_AudioStreamPut(d->stream, d->resample_buf, out * d->src_channels * (int)sizeof(int16_t));
+}
 
-    g_flac_duration = duration;
-
-    // Track chunk boundaries for seek optimization
-    g_flac_chunk_start = chunk_start;
-    g_flac_chunk_end = (chunk_end < duration) ? chunk_end : duration;
-
-    printf("[AUDIO] FLAC chunk loaded: %d-%d sec (total %d sec)\n",
-           g_flac_chunk_start, g_flac_chunk_end, g_flac_duration);
-
-    // Load WAV from memory
-    SDL_RWops *rwops = SDL_RWFromMem(g_flac_wav_data, (int)g_flac_wav_size);
-    if (!rwops) {
-        free_flac_buffer();
-        return false;
+/**
+ * Push the next block of source audio into a deck's converter
+ * @return false when the source is exhausted
+ */
+static bool flac_source_refill(Deck *d) {
+    // Resident PCM first: feed straight from the buffer, no copy
+    if (d->pcm && d->pcm_cursor < d->pcm_frames) {
+        uint64_t frames = d->pcm_frames - d->pcm_cursor;
+        if (frames > FLAC_DECODE_FRAMES) frames = FLAC_DECODE_FRAMES;
+        flac_deck_put(d, d->pcm + d->pcm_cursor * d->src_channels, frames);
+        d->pcm_cursor += frames;
+        return true;
     }
 
-    // SDL_TRUE = SDL will free RWops when music is freed (but NOT our buffer)
-    g_music = Mix_LoadMUS_RW(rwops, SDL_TRUE);
-    if (!g_music) {
-        free_flac_buffer();
-        return false;
+    if (d->flac) {
+        drflac_uint64 frames = drflac_read_pcm_frames_s16(d->flac, FLAC_DECODE_FRAMES, d->decode_buf);
+        if (frames == 0) return false;
+        flac_deck_put(d, d->decode_buf, frames);
+        return true;
     }
 
-    return true;
+    return false;
 }
 
 /**
- * Extract filename without extension as fallback title
+ * Pull converted output from a deck, refilling from its source as needed
+ * Sets finished once the source and converter are both empty.
+ * @return Bytes written to out (less than len only at the end)
  */
-static void extract_filename_title(const char *path, char *title, size_t size) {
-    const char *filename = strrchr(path, '/');
-    if (filename) {
-        filename++;
-    } else {
-        filename = path;
-    }
-
-    strncpy(title, filename, size - 1);
-    title[size - 1] = '\0';
+static int flac_deck_pull(Deck *d, Uint8 *out, int len) {
+    int total = 0;
+    while (total < len) {
+        // Refill converter until it can satisfy this request
+        if (!d->drained && SDL_AudioStreamAvailable(d->stream) < len - total) {
+            if (flac_source_refill(d)) continue;
+            // End of source - push out whatever the resamplers are holding
+            if (d->resampler) {
+                int out = resample_flush(d->resampler, d->resample_buf);
+                SDL_AudioStreamPut(d->stream, d->resample_buf, out * d->src_channels * (int)sizeof(int16_t));
+            }
+            SDL_AudioStreamFlush(d->stream);
+            d->drained = true;
+        }
 
-    char *dot = strrchr(title, '.');
-    if (dot) {
-        *dot = '\0';
+        int got = SDL_AudioStreamGet(d->stream, out + total, len - total);
+        if (got <= 0) {
+            if (d->drained) d->finished = true;
+            break;
+        }
+        total += got;
     }
+    d->out_bytes += total;
+    return total;
 }
 
 /**
- * Estimate MP3 duration from file size and bitrate
- *
- * Optimized for slow SD cards: reads in 8KB blocks instead of byte-by-byte
- * seeking. On Trimui's slow SD, this reduces load time from 2-10s to <100ms.
+ * Output bytes a deck has left to deliver
+ * @return Bytes, or -1 if the track length is unknown
  */
-static int estimate_mp3_duration(const char *path) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return 0;
-
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    // Skip ID3v2 tag if present
-    unsigned char header[10];
-    if (fread(header, 1, 10, f) != 10) {
-        fclose(f);
-        return 0;
-    }
-
-    long audio_start = 0;
-    if (header[0] == 'I' && header[1] == 'D' && header[2] == '3') {
-        long tag_size = ((header[6] & 0x7F) << 21) |
-                       ((header[7] & 0x7F) << 14) |
-                       ((header[8] & 0x7F) << 7) |
-                       (header[9] & 0x7F);
-        audio_start = 10 + tag_size;
-    }
-
-    // Find first MP3 frame sync - read in blocks for speed (not byte-by-byte)
-    // On Trimui's slow SD card, byte-by-byte fseek() causes 2-10s delays
-    fseek(f, audio_start, SEEK_SET);
-
-    // Use static buffer to avoid stack overflow on Trimui (limited stack)
-    #define SYNC_BUFFER_SIZE 4096
-    static unsigned char buffer[SYNC_BUFFER_SIZE];
-    size_t bytes_read = fread(buffer, 1, SYNC_BUFFER_SIZE, f);
-
-    int found = 0;
-    size_t sync_pos = 0;
-    for (size_t i = 0; i + 1 < bytes_read && !found; i++) {
-        if (buffer[i] == 0xFF && (buffer[i + 1] & 0xE0) == 0xE0) {
-            found = 1;
-            sync_pos = i;
-        }
-    }
+static int64_t flac_deck_remaining(const Deck *d) {
+    if (d->total_frames == 0 || d->src_rate <= 0) return -1;
+
+    double played = d->base_frame +
+                    (double)(d->out_bytes / g_device_frame_bytes) * d->src_rate / g_device_freq;
+    double left = (double)d->total_frames - played;
+    if (left < 0) left = 0;
+    return (int64_t)(left * g_device_freq / d->src_rate) * g_device_frame_bytes;
+}
 
-    if (!found) {
-        fclose(f);
-        return 0;
-    }
+/**
+ * Pull FLAC audio on demand and mix it into the output
+ * Runs on the audio thread. Output is pre-silenced by SDL_mixer, so returning
+ * early (paused/finished) plays silence. Volume is applied here because
+ * Mix_VolumeMusic() does not affect hooked music.
+ */
+static void flac_music_mix(Uint8 *stream, int len) {
+    SDL_LockMutex(g_flac_mutex);
 
-    // Read frame header from buffer
-    if (sync_pos + 4 > bytes_read) {
-        fclose(f);
-        return 0;
+    Deck *a = &g_decks[g_deck];
+    Deck *b = &g_decks[1 - g_deck];
+    if (!a->active || g_is_paused) {
+        SDL_UnlockMutex(g_flac_mutex);
+        return;
     }
 
-    unsigned char *frame = &buffer[sync_pos];
-    fclose(f);
+    int volume = (int)(g_volume * 1.28);
+
+    while (len > 0) {
+        if (a->finished) {
+            if (!b->active) break;  // Nothing queued: the track ends here
+
+            // Handoff at this sample; the main thread frees the old deck
+            a->active = false;
+            g_deck = 1 - g_deck;
+            Deck *tmp = a;
+            a = b;
+            b = tmp;
+            g_handoff = true;
+            g_fade_bytes = 0;
+            continue;
+        }
 
-    int version = (frame[1] >> 3) & 0x03;
-    int layer = (frame[1] >> 1) & 0x03;
-    int bitrate_idx = (frame[2] >> 4) & 0x0F;
+        int want = (len < FLAC_MIX_BUFFER_SIZE) ? len : FLAC_MIX_BUFFER_SIZE;
+        // Fade set with nothing queued: the queued deck was dropped mid-window
+        int64_t left = g_fade_bytes > 0 ? flac_deck_remaining(a) : -1;
+
+        if (left >= 0 && left < g_fade_bytes) {
+            // Crossfade window: both decks, gain stepped per block
+            int block = FLAC_FADE_BLOCK_FRAMES * g_device_frame_bytes;
+            if (want > block) want = block;
+            int gain = (int)((g_fade_bytes - left) * volume / g_fade_bytes);
+
+            int got_a = flac_deck_pull(a, g_flac_mix_buf, want);
+            SDL_MixAudioFormat(stream, g_flac_mix_buf, g_device_format, (Uint32)got_a, volume - gain);
+            int got_b = 0;
+            if (b->active) {
+                got_b = flac_deck_pull(b, g_flac_mix_buf, want);
+                SDL_MixAudioFormat(stream, g_flac_mix_buf, g_device_format, (Uint32)got_b, gain);
+            }
 
-    static const int bitrates_v1_l3[] = {
-        0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0
-    };
-    static const int bitrates_v2_l3[] = {
-        0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0
-    };
+            int got = got_a > got_b ? got_a : got_b;
+            if (got <= 0 && !a->finished) break;
+            stream += got;
+            len -= got;
+            continue;
+        }
 
-    int bitrate = 0;
-    if (layer == 0x01) {
-        if (version == 0x03) {
-            bitrate = bitrates_v1_l3[bitrate_idx];
-        } else if (version == 0x02 || version == 0x00) {
-            bitrate = bitrates_v2_l3[bitrate_idx];
+        int got = flac_deck_pull(a, g_flac_mix_buf, want);
+        if (got <= 0) {
+            if (a->finished) continue;
+            break;
         }
+
+        SDL_MixAudioFormat(stream, g_flac_mix_buf, g_device_format, (Uint32)got, volume);
+        stream += got;
+        len -= got;
     }
 
-    if (bitrate == 0) return 0;
+    SDL_UnlockMutex(g_flac_mutex);
+}
 
-    long audio_size = file_size - audio_start - 128;
-    if (audio_size < 0) audio_size = file_size - audio_start;
+/**
+ * SDL_mixer music hook: flac_music_mix(), timed as AUDIO_PATH_FLAC_HOOK
+ * (mutex wait included, since the callback waits for it too)
+ */
+static void SDLCALL flac_music_hook(void *udata, Uint8 *stream, int len) {
+    (void)udata;
+    uint64_t start = audiostats_begin();
+    flac_music_mix(stream, len);
+    audiostats_end(AUDIO_PATH_FLAC_HOOK, start, len / g_device_frame_bytes);
+}
 
-    return (int)((audio_size * 8) / (bitrate * 1000));
+/**
+ * Release a deck's decoder, converter and preloaded WAV image
+ * The hook must no longer read it (inactive, or unhooked).
+ */
+static void flac_deck_close(Deck *d) {
+    SDL_LockMutex(g_flac_mutex);
+    drflac *flac = d->flac;
+    SDL_AudioStream *stream = d->stream;
+    Resampler *resampler = d->resampler;
+    int16_t *resample_buf = d->resample_buf;
+    int16_t *decode_buf = d->decode_buf;
+    uint8_t *wav_data = d->wav_data;
+    memset(d, 0, sizeof(*d));
+    SDL_UnlockMutex(g_flac_mutex);
+
+    if (flac) drflac_close(flac);
+    if (stream) SDL_FreeAudioStream(stream);
+    resample_destroy(resampler);
+    free(resample_buf);
+    free(decode_buf);
+    wav_release(wav_data);  // Back to the pool for the next preload
 }
 
 /**
- * Read ID3v2 tags from MP3 file (ID3v2.3/2.4)
- * Parses TIT2 (title), TPE1 (artist), TALB (album) frames
+ * Close both decks and release decoder resources
+ * Removes the music hook first so the audio thread no longer touches them.
  */
-static bool read_id3v2(const char *path, TrackInfo *info) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return false;
-
-    // Read ID3v2 header (10 bytes)
-    unsigned char header[10];
-    if (fread(header, 1, 10, f) != 10) {
-        fclose(f);
-        return false;
+static void flac_stream_close(void) {
+    if (g_flac_hooked) {
+        Mix_HookMusic(NULL, NULL);  // Locks audio, hook is not running after this
+        g_flac_hooked = false;
     }
 
-    // Check "ID3" magic
-    if (header[0] != 'I' || header[1] != 'D' || header[2] != '3') {
-        fclose(f);
-        return false;
+    flac_deck_close(&g_decks[0]);
+    flac_deck_close(&g_decks[1]);
+
+    SDL_LockMutex(g_flac_mutex);
+    g_deck = 0;
+    g_handoff = false;
+    g_fade_bytes = 0;
+    SDL_UnlockMutex(g_flac_mutex);
+}
+
+/**
+ * Create a deck's converter for a source of the given format
+ * Matches whatever format Mix_OpenAudio negotiated with the device. A rate
+ * change goes through our polyphase resampler; SDL only converts channels
+ * and sample format, which it does without filtering. Allocates, so it runs
+ * without g_flac_mutex on a deck the hook doesn't read (inactive).
+ */
+static bool flac_output_setup(Deck *d, int src_rate, int src_channels, bool need_decode_buf) {
+    int out_freq = 44100;
+    int out_channels = 2;
+    Uint16 out_format = AUDIO_S16SYS;
+    Mix_QuerySpec(&out_freq, &out_format, &out_channels);
+
+    bool resample_ok = true;
+    if (src_rate != out_freq) {
+        d->resampler = resample_create(src_rate, out_freq, src_channels, g_resample_quality);
+        if (d->resampler) {
+            int frames = resample_max_output(d->resampler, FLAC_DECODE_FRAMES);
+            d->resample_buf = malloc(frames * src_channels * sizeof(int16_t));
+        }
+        resample_ok = d->resampler && d->resample_buf;
     }
 
-    // Version check (we handle 2.3 and 2.4)
-    int version = header[3];
-    if (version < 2 || version > 4) {
-        fclose(f);
+    d->stream = SDL_NewAudioStream(AUDIO_S16SYS, (Uint8)src_channels, out_freq,
+                                   out_format, (Uint8)out_channels, out_freq);
+    if (need_decode_buf) {
+        d->decode_buf = malloc(FLAC_DECODE_FRAMES * src_channels * sizeof(int16_t));
+    }
+
+    if (!d->stream || !g_flac_mix_buf || !resample_ok || (need_decode_buf && !d->decode_buf)) {
+        fprintf(stderr, "[AUDIO] Failed to set up FLAC output: %s\n", SDL_GetError());
         return false;
     }
 
-    // Tag size (syncsafe integer)
-    uint32_t tag_size = ((header[6] & 0x7F) << 21) |
-                        ((header[7] & 0x7F) << 14) |
-                        ((header[8] & 0x7F) << 7) |
-                        (header[9] & 0x7F);
-
-    bool got_title = false, got_artist = false, got_album = false;
-    long pos = 10;
-    long end_pos = 10 + (long)tag_size;
-
-    // Parse frames
-    while (pos < end_pos && !(got_title && got_artist && got_album)) {
-        // Read frame header (10 bytes for v2.3/2.4)
-        unsigned char frame_header[10];
-        if (fseek(f, pos, SEEK_SET) != 0) break;
-        if (fread(frame_header, 1, 10, f) != 10) break;
-
-        // Check for padding (null bytes = end of frames)
-        if (frame_header[0] == 0) break;
-
-        // Frame ID (4 chars)
-        char frame_id[5];
-        memcpy(frame_id, frame_header, 4);
-        frame_id[4] = '\0';
-
-        // Frame size
-        uint32_t frame_size;
-        if (version == 4) {
-            // ID3v2.4: syncsafe integer
-            frame_size = ((frame_header[4] & 0x7F) << 21) |
-                         ((frame_header[5] & 0x7F) << 14) |
-                         ((frame_header[6] & 0x7F) << 7) |
-                         (frame_header[7] & 0x7F);
-        } else {
-            // ID3v2.3: big-endian 32-bit
-            frame_size = ((uint32_t)frame_header[4] << 24) |
-                         ((uint32_t)frame_header[5] << 16) |
-                         ((uint32_t)frame_header[6] << 8) |
-                         (uint32_t)frame_header[7];
-        }
+    d->src_rate = src_rate;
+    d->src_channels = src_channels;
+    return true;
+}
 
-        // Sanity check
-        if (frame_size == 0 || frame_size > 10000000) {
-            pos += 10 + frame_size;
-            continue;
-        }
+/**
+ * Take over the device format for mixing (caller holds g_flac_mutex)
+ */
+static void flac_device_sync(void) {
+    int freq = 44100;
+    int channels = 2;
+    Uint16 format = AUDIO_S16SYS;
+    Mix_QuerySpec(&freq, &format, &channels);
+    g_device_format = format;
+    g_device_freq = freq;
+    g_device_frame_bytes = channels * ((format & 0xFF) / 8);
+}
 
-        // Check if this is a text frame we want
-        char *dest = NULL;
-        size_t dest_size = 0;
-
-        if (strcmp(frame_id, "TIT2") == 0) {
-            dest = info->title;
-            dest_size = sizeof(info->title);
-        } else if (strcmp(frame_id, "TPE1") == 0) {
-            dest = info->artist;
-            dest_size = sizeof(info->artist);
-        } else if (strcmp(frame_id, "TALB") == 0) {
-            dest = info->album;
-            dest_size = sizeof(info->album);
-        }
+/**
+ * Open FLAC file for streaming playback on the playing deck, at start_sec
+ * Playback starts when audio_play() installs the music hook.
+ */
+static bool flac_stream_open(const char *path, int start_sec) {
+    drflac *flac = drflac_open_file(path, NULL);
+    if (!flac) {
+        fprintf(stderr, "[AUDIO] Failed to open FLAC: %s\n", path);
+        return false;
+    }
 
-        if (dest && frame_size > 1) {
-            // Read frame content
-            unsigned char *content = malloc(frame_size);
-            if (content) {
-                if (fread(content, 1, frame_size, f) == frame_size) {
-                    // First byte is encoding
-                    int encoding = content[0];
-                    unsigned char *text_start = content + 1;
-                    uint32_t text_len = frame_size - 1;
-
-                    // Handle encoding
-                    if (encoding == 0 || encoding == 3) {
-                        // ISO-8859-1 or UTF-8: direct copy
-                        size_t copy_len = (text_len < dest_size - 1) ? text_len : dest_size - 1;
-                        memcpy(dest, text_start, copy_len);
-                        dest[copy_len] = '\0';
-                    } else if (encoding == 1 || encoding == 2) {
-                        // UTF-16 (with or without BOM): simple ASCII extraction
-                        // (Full UTF-16 support would require iconv/ICU)
-                        size_t j = 0;
-                        int bom_skip = 0;
-                        if (text_len >= 2 && ((text_start[0] == 0xFF && text_start[1] == 0xFE) ||
-                                               (text_start[0] == 0xFE && text_start[1] == 0xFF))) {
-                            bom_skip = 2;
-                        }
-                        bool is_be = (bom_skip == 2 && text_start[0] == 0xFE);
-
-                        for (uint32_t i = bom_skip; i + 1 < text_len && j < dest_size - 1; i += 2) {
-                            unsigned char lo = is_be ? text_start[i + 1] : text_start[i];
-                            unsigned char hi = is_be ? text_start[i] : text_start[i + 1];
-                            if (hi == 0 && lo >= 0x20 && lo < 0x7F) {
-                                dest[j++] = (char)lo;
-                            } else if (lo == 0 && hi == 0) {
-                                break;  // Null terminator
-                            }
-                        }
-                        dest[j] = '\0';
-                    }
-
-                    // Trim trailing whitespace
-                    size_t len = strlen(dest);
-                    while (len > 0 && (dest[len - 1] == ' ' || dest[len - 1] == '\0')) {
-                        dest[--len] = '\0';
-                    }
-
-                    if (strlen(dest) > 0) {
-                        if (dest == info->title) got_title = true;
-                        else if (dest == info->artist) got_artist = true;
-                        else if (dest == info->album) got_album = true;
-                    }
-                }
-                free(content);
-            }
+    int duration_sec = (int)(flac->totalPCMFrameCount / flac->sampleRate);
+    uint64_t start_frame = 0;
+    if (start_sec > 0 && start_sec < duration_sec) {
+        start_frame = (uint64_t)start_sec * flac->sampleRate;
+        if (!drflac_seek_to_pcm_frame(flac, start_frame)) {
+            // Seek failed - this is a real error, don't silently play from wrong position
+            fprintf(stderr, "[AUDIO] FLAC seek to %d sec failed\n", start_sec);
+            drflac_close(flac);
+            return false;
         }
+    }
 
-        pos += 10 + frame_size;
+    // Inactive until filled in, so the hook leaves it alone meanwhile
+    Deck *d = flac_deck();
+    d->flac = flac;
+    bool ok = flac_output_setup(d, (int)flac->sampleRate, (int)flac->channels, true);
+    d->total_frames = flac->totalPCMFrameCount;
+    d->duration_sec = duration_sec;
+    d->base_frame = start_frame;
+    d->out_bytes = 0;
+    strncpy(d->path, path, sizeof(d->path) - 1);
+
+    SDL_LockMutex(g_flac_mutex);
+    if (ok) flac_device_sync();
+    d->active = ok;
+    SDL_UnlockMutex(g_flac_mutex);
+
+    if (!ok) {
+        flac_deck_close(d);
+        return false;
     }
 
-    fclose(f);
-    return got_title || got_artist || got_album;
+    printf("[AUDIO] FLAC stream opened: %u Hz, %u ch, %d sec (start %d)\n",
+           flac->sampleRate, flac->channels, duration_sec, start_sec);
+    return true;
 }
 
 /**
- * Read FLAC Vorbis Comments metadata
- * Parses TITLE, ARTIST, ALBUM fields from VORBIS_COMMENT block
+ * Attach resident PCM from a preloaded WAV image to a deck
+ * Takes ownership of wav_data and tail, even on failure.
+ * @param tail Open decoder positioned right after the resident PCM, or NULL
+ *             if the image holds the whole track
  */
-static bool read_flac_metadata(const char *path, TrackInfo *info) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return false;
-
-    // Check fLaC magic
-    char magic[4];
-    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, "fLaC", 4) != 0) {
-        fclose(f);
+static bool flac_pcm_open(Deck *d, const char *path, uint8_t *wav_data, size_t wav_size,
+                          drflac *tail, int duration_sec) {
+    int sample_rate, channels;
+    if (!wav_read_header(wav_data, wav_size, &sample_rate, &channels)) {
+        wav_release(wav_data);
+        if (tail) drflac_close(tail);
         return false;
     }
 
-    bool got_title = false, got_artist = false, got_album = false;
-    bool last_block = false;
-
-    // Iterate through metadata blocks
-    while (!last_block) {
-        // Block header (1 byte type + 3 bytes size)
-        unsigned char block_header[4];
-        if (fread(block_header, 1, 4, f) != 4) break;
-
-        last_block = (block_header[0] & 0x80) != 0;
-        int block_type = block_header[0] & 0x7F;
-        uint32_t block_size = ((uint32_t)block_header[1] << 16) |
-                              ((uint32_t)block_header[2] << 8) |
-                              (uint32_t)block_header[3];
-
-        // VORBIS_COMMENT block type = 4
-        if (block_type == 4 && block_size > 8) {
-            unsigned char *block_data = malloc(block_size);
-            if (!block_data) {
-                fseek(f, block_size, SEEK_CUR);
-                continue;
-            }
+    // Inactive until filled in, so the hook leaves it alone meanwhile
+    d->flac = tail;
+    d->wav_data = wav_data;
+    d->wav_size = wav_size;
+    d->pcm = (const int16_t *)(wav_data + WAV_HEADER_SIZE);
+    d->pcm_frames = (wav_size - WAV_HEADER_SIZE) / (channels * sizeof(int16_t));
+    d->pcm_cursor = 0;
+    d->total_frames = tail ? tail->totalPCMFrameCount : d->pcm_frames;
+    d->duration_sec = duration_sec;
+    bool ok = flac_output_setup(d, sample_rate, channels, tail != NULL);
+    d->base_frame = 0;
+    d->out_bytes = 0;
+    strncpy(d->path, path, sizeof(d->path) - 1);
+
+    SDL_LockMutex(g_flac_mutex);
+    if (ok) flac_device_sync();
+    d->active = ok;
+    SDL_UnlockMutex(g_flac_mutex);
+
+    if (!ok) {
+        flac_deck_close(d);
+        return false;
+    }
+    return true;
+}
 
-            if (fread(block_data, 1, block_size, f) != block_size) {
-                free(block_data);
-                break;
-            }
+/**
+ * Seek the playing deck to an absolute position
+ * Resident PCM: just moves the cursor. Stream: a second decoder on the
+ * same file is positioned off the lock (the seek reads the card) and
+ * swapped in, so the hook never waits on it. With a resident head plus
+ * stream, a seek inside the head re-parks the decoder at the head's end.
+ */
+static bool flac_stream_seek(double position_sec) {
+    SDL_LockMutex(g_flac_mutex);
+    Deck *d = flac_deck();
+    SDL_UnlockMutex(g_flac_mutex);
+
+    // Sources and path are fixed while the deck plays; only this thread sets them
+    if (!d->pcm && !d->flac) return false;
+    uint64_t frame = (uint64_t)(position_sec * d->src_rate);
+    bool in_pcm = d->pcm && (frame < d->pcm_frames || !d->flac);
+    if (in_pcm && frame > d->pcm_frames) frame = d->pcm_frames;
+
+    drflac *flac = NULL;
+    if (d->flac) {
+        flac = drflac_open_file(d->path, NULL);
+        if (!flac || !drflac_seek_to_pcm_frame(flac, in_pcm ? d->pcm_frames : frame)) {
+            if (flac) drflac_close(flac);
+            fprintf(stderr, "[AUDIO] FLAC seek to %.1f sec failed\n", position_sec);
+            return false;
+        }
+    }
 
-            // Parse Vorbis Comment structure
-            uint32_t pos = 0;
-
-            // Vendor string length (little-endian)
-            if (pos + 4 > block_size) { free(block_data); continue; }
-            uint32_t vendor_len = block_data[pos] |
-                                  ((uint32_t)block_data[pos + 1] << 8) |
-                                  ((uint32_t)block_data[pos + 2] << 16) |
-                                  ((uint32_t)block_data[pos + 3] << 24);
-            pos += 4 + vendor_len;
-
-            // Number of comments
-            if (pos + 4 > block_size) { free(block_data); continue; }
-            uint32_t comment_count = block_data[pos] |
-                                     ((uint32_t)block_data[pos + 1] << 8) |
-                                     ((uint32_t)block_data[pos + 2] << 16) |
-                                     ((uint32_t)block_data[pos + 3] << 24);
-            pos += 4;
-
-            // Parse each comment
-            for (uint32_t i = 0; i < comment_count && pos + 4 <= block_size; i++) {
-                uint32_t comment_len = block_data[pos] |
-                                       ((uint32_t)block_data[pos + 1] << 8) |
-                                       ((uint32_t)block_data[pos + 2] << 16) |
-                                       ((uint32_t)block_data[pos + 3] << 24);
-                pos += 4;
-
-                if (pos + comment_len > block_size) break;
-
-                // Comment format: "FIELD=value"
-                char *comment = (char *)block_data + pos;
-
-                // Extract field and value
-                char *equals = memchr(comment, '=', comment_len);
-                if (equals) {
-                    size_t field_len = equals - comment;
-                    char *value = equals + 1;
-                    size_t value_len = comment_len - field_len - 1;
-
-                    // Case-insensitive field comparison
-                    char *dest = NULL;
-                    size_t dest_size = 0;
-
-                    if (field_len == 5 && strncasecmp(comment, "TITLE", 5) == 0) {
-                        dest = info->title;
-                        dest_size = sizeof(info->title);
-                    } else if (field_len == 6 && strncasecmp(comment, "ARTIST", 6) == 0) {
-                        dest = info->artist;
-                        dest_size = sizeof(info->artist);
-                    } else if (field_len == 5 && strncasecmp(comment, "ALBUM", 5) == 0) {
-                        dest = info->album;
-                        dest_size = sizeof(info->album);
-                    }
-
-                    if (dest && value_len > 0) {
-                        size_t copy_len = (value_len < dest_size - 1) ? value_len : dest_size - 1;
-                        memcpy(dest, value, copy_len);
-                        dest[copy_len] = '\0';
-
-                        if (dest == info->title) got_title = true;
-                        else if (dest == info->artist) got_artist = true;
-                        else if (dest == info->album) got_album = true;
-                    }
-                }
-
-                pos += comment_len;
-            }
+    SDL_LockMutex(g_flac_mutex);
+    bool ok = d == flac_deck() && d->active;  // Not handed off meanwhile
+    if (ok) {
+        drflac *old = d->flac;
+        d->flac = flac;
+        flac = old;
+        d->pcm_cursor = in_pcm ? frame : d->pcm_frames;  // Head (if any) is behind us
+
+        // Drop audio converted from the old position and restart the clock
+        SDL_AudioStreamClear(d->stream);
+        if (d->resampler) resample_reset(d->resampler);
+        d->drained = false;
+        d->finished = false;
+        d->base_frame = frame;
+        d->out_bytes = 0;
+        if (!g_decks[1 - g_deck].active) g_fade_bytes = 0;  // Fade-out left by audio_unqueue()
+    }
+    SDL_UnlockMutex(g_flac_mutex);
 
-            free(block_data);
+    // The replaced decoder, or ours if the track changed under us
+    if (flac) drflac_close(flac);
 
-            // Found what we need, stop parsing
-            if (got_title && got_artist && got_album) break;
-        } else {
-            // Skip other block types
-            fseek(f, block_size, SEEK_CUR);
-        }
+    if (!ok) {
+        fprintf(stderr, "[AUDIO] FLAC seek to %.1f sec failed\n", position_sec);
     }
+    return ok;
+}
 
-    fclose(f);
-    return got_title || got_artist || got_album;
+/**
+ * Get FLAC playback position from audio actually delivered to the device
+ * (sample-accurate, unlike the SDL_GetTicks() estimate used for Mix_Music)
+ */
+static double flac_get_position(void) {
+    SDL_LockMutex(g_flac_mutex);
+    const Deck *d = flac_deck();
+    double pos = 0.0;
+    if (d->src_rate > 0 && g_device_freq > 0) {
+        pos = (double)d->base_frame / d->src_rate +
+              (double)(d->out_bytes / g_device_frame_bytes) / g_device_freq;
+    }
+    SDL_UnlockMutex(g_flac_mutex);
+    return pos;
 }
 
 /**
- * Simple ID3v1 tag reader (fallback for old MP3s)
+ * Adopt the deck the hook moved to: free the old one, switch track info
+ * Main thread, from audio_update().
  */
-static bool read_id3v1(const char *path, TrackInfo *info) {
-    FILE *f = fopen(path, "rb");
-    if (!f) return false;
+static void flac_finish_handoff(void) {
+    SDL_LockMutex(g_flac_mutex);
+    bool handoff = g_handoff;
+    g_handoff = false;
+    SDL_UnlockMutex(g_flac_mutex);
+    if (!handoff) return;
 
-    if (fseek(f, -128, SEEK_END) != 0) {
-        fclose(f);
-        return false;
-    }
+    flac_deck_close(&g_decks[1 - g_deck]);
 
-    char tag[4];
-    if (fread(tag, 1, 3, f) != 3) {
-        fclose(f);
-        return false;
-    }
-    tag[3] = '\0';
+    Deck *d = flac_deck();
+    strncpy(g_current_path, d->path, sizeof(g_current_path) - 1);
+    g_current_path[sizeof(g_current_path) - 1] = '\0';
+    strncpy(g_handoff_path, d->path, sizeof(g_handoff_path) - 1);
+    g_track_info = d->info;
+    g_music_position = flac_get_position();
+    g_track_info.position_sec = (int)g_music_position;
+    loudness_apply(loudness_track_gain(d->path, &g_track_info));
 
-    if (strcmp(tag, "TAG") != 0) {
-        fclose(f);
-        return false;
-    }
+    printf("[GAPLESS] Deck handoff to: %s - %s\n", g_track_info.artist, g_track_info.title);
+}
 
-    char title[31], artist[31], album[31];
-    if (fread(title, 1, 30, f) != 30 ||
-        fread(artist, 1, 30, f) != 30 ||
-        fread(album, 1, 30, f) != 30) {
-        fclose(f);
-        return false;
+/**
+ * Extract filename without extension as fallback title
+ */
+static void extract_filename_title(const char *path, char *title, size_t size) {
+    const char *filename = strrchr(path, '/');
+    if (filename) {
+        filename++;
+    } else {
+        filename = path;
     }
-    title[30] = artist[30] = album[30] = '\0';
-    fclose(f);
 
-    // Trim trailing spaces
-    for (int i = 29; i >= 0 && title[i] == ' '; i--) title[i] = '\0';
-    for (int i = 29; i >= 0 && artist[i] == ' '; i--) artist[i] = '\0';
-    for (int i = 29; i >= 0 && album[i] == ' '; i--) album[i] = '\0';
-
-    if (strlen(title) > 0) strncpy(info->title, title, sizeof(info->title) - 1);
-    if (strlen(artist) > 0) strncpy(info->artist, artist, sizeof(info->artist) - 1);
-    if (strlen(album) > 0) strncpy(info->album, album, sizeof(info->album) - 1);
+    strncpy(title, filename, size - 1);
+    title[size - 1] = '\0';
 
-    return strlen(title) > 0;
+    char *dot = strrchr(title, '.');
+    if (dot) {
+        *dot = '\0';
+    }
 }
 
 int audio_init(void) {
@@ -661,6 +615,14 @@ int audio_init(void) {
     g_pause_time = 0;
     g_current_path[0] = '\0';
 
+    g_flac_mutex = SDL_CreateMutex();
+    if (!g_flac_mutex) {
+        fprintf(stderr, "[AUDIO] Failed to create FLAC mutex: %s\n", SDL_GetError());
+        return -1;
+    }
+    g_flac_mix_buf = malloc(FLAC_MIX_BUFFER_SIZE);
+    memset(g_decks, 0, sizeof(g_decks));
+
     memset(&g_track_info, 0, sizeof(g_track_info));
     Mix_VolumeMusic((int)(g_volume * 1.28));
 
@@ -669,94 +631,78 @@ int audio_init(void) {
 
 void audio_cleanup(void) {
     audio_stop();
-}
+    btvolume_stop();
 
-bool audio_load(const char *path) {
-    audio_stop();
-
-    // Store path for potential FLAC seek
-    strncpy(g_current_path, path, sizeof(g_current_path) - 1);
-    g_current_path[sizeof(g_current_path) - 1] = '\0';
-
-    bool is_flac = is_flac_file(path);
-
-    // For FLAC files, use dr_flac decoder (SDL_mixer on Trimui lacks FLAC support)
-    if (is_flac) {
-        if (!load_flac_from_position(path, 0)) {
-            fprintf(stderr, "[AUDIO] FLAC decode failed: %s\n", path);
-            return false;
-        }
-    } else {
-        // For MP3/OGG, use native SDL_mixer
-        g_music = Mix_LoadMUS(path);
-        if (!g_music) {
-            fprintf(stderr, "[AUDIO] Failed to load %s: %s\n", path, Mix_GetError());
-            return false;
-        }
+    if (g_flac_mutex) {
+        SDL_DestroyMutex(g_flac_mutex);
+        g_flac_mutex = NULL;
     }
+    free(g_flac_mix_buf);
+    g_flac_mix_buf = NULL;
+}
 
-    // Reset track info
-    memset(&g_track_info, 0, sizeof(g_track_info));
-
+/**
+ * Fill title/artist/album of a newly loaded track
+ * @param info Track info to fill (g_track_info, or a queued deck's)
+ * @param probed Result of tags_probe() for this file
+ */
+static void load_track_tags(TrackInfo *info, const char *path, const TrackInfo *probed) {
     // Priority order for metadata:
     // 1. MusicBrainz cache (from metadata scanner)
     // 2. Embedded tags (ID3v2, Vorbis Comments, ID3v1)
     // 3. Filename extraction
 
     bool got_metadata = false;
+    info->has_replaygain = probed->has_replaygain;
+    info->replaygain_db = probed->replaygain_db;
 
     // Check MusicBrainz cache first
     MetadataResult cached;
     if (metadata_get_cached(path, &cached)) {
-        strncpy(g_track_info.title, cached.title, sizeof(g_track_info.title) - 1);
-        strncpy(g_track_info.artist, cached.artist, sizeof(g_track_info.artist) - 1);
-        strncpy(g_track_info.album, cached.album, sizeof(g_track_info.album) - 1);
+        strncpy(info->title, cached.title, sizeof(info->title) - 1);
+        strncpy(info->artist, cached.artist, sizeof(info->artist) - 1);
+        strncpy(info->album, cached.album, sizeof(info->album) - 1);
         got_metadata = true;
     }
 
-    // If no cache, try embedded tags
+    // If no cache, use embedded tags
     if (!got_metadata) {
-        if (is_flac) {
-            // FLAC: read Vorbis Comments
-            got_metadata = read_flac_metadata(path, &g_track_info);
-        } else {
-            // MP3/other: try ID3v2 first (modern tags), then ID3v1 (legacy fallback)
-            got_metadata = read_id3v2(path, &g_track_info);
-            if (!got_metadata) {
-                got_metadata = read_id3v1(path, &g_track_info);
-            }
-        }
+        memcpy(info->title, probed->title, sizeof(info->title));
+        memcpy(info->artist, probed->artist, sizeof(info->artist));
+        memcpy(info->album, probed->album, sizeof(info->album));
+        got_metadata = probed->title[0] || probed->artist[0] || probed->album[0];
     }
 
     // Final fallback: use filename
     if (!got_metadata) {
-        extract_filename_title(path, g_track_info.title, sizeof(g_track_info.title));
-        strcpy(g_track_info.artist, "Unknown Artist");
-        strcpy(g_track_info.album, "Unknown Album");
+        extract_filename_title(path, info->title, sizeof(info->title));
+        strcpy(info->artist, "Unknown Artist");
+        strcpy(info->album, "Unknown Album");
     } else {
         // Fill in missing fields even if we got some metadata
-        if (strlen(g_track_info.title) == 0) {
-            extract_filename_title(path, g_track_info.title, sizeof(g_track_info.title));
+        if (strlen(info->title) == 0) {
+            extract_filename_title(path, info->title, sizeof(info->title));
         }
-        if (strlen(g_track_info.artist) == 0) {
-            strcpy(g_track_info.artist, "Unknown Artist");
+        if (strlen(info->artist) == 0) {
+            strcpy(info->artist, "Unknown Artist");
         }
-        if (strlen(g_track_info.album) == 0) {
-            strcpy(g_track_info.album, "Unknown Album");
+        if (strlen(info->album) == 0) {
+            strcpy(info->album, "Unknown Album");
         }
     }
+}
 
-    // Get duration
+/**
+ * Fill g_track_info.duration_sec for a track loaded through SDL_mixer
+ * @param estimate Duration from tags_probe() (Xing/VBRI, STREAMINFO, Ogg
+ *        granule or CBR estimate), used when SDL_mixer can't tell
+ */
+static void load_music_duration(int estimate) {
     g_track_info.duration_sec = 0;
 
-    // For FLAC, we have the duration from decoding
-    if (is_flac && g_flac_duration > 0) {
-        g_track_info.duration_sec = g_flac_duration;
-    }
-
     // Try SDL_mixer 2.6+ Mix_MusicDuration
 #if SDL_MIXER_COMPILEDVERSION >= SDL_VERSIONNUM(2, 6, 0)
-    if (g_track_info.duration_sec == 0) {
+    if (g_music) {
         double duration = Mix_MusicDuration(g_music);
         if (duration > 0) {
             g_track_info.duration_sec = (int)duration;
@@ -764,19 +710,176 @@ bool audio_load(const char *path) {
     }
 #endif
 
-    // Fallback: estimate MP3 duration
-    if (g_track_info.duration_sec == 0) {
-        const char *ext = strrchr(path, '.');
-        if (ext && (strcasecmp(ext, ".mp3") == 0)) {
-            int estimated = estimate_mp3_duration(path);
-            if (estimated > 0) {
-                g_track_info.duration_sec = estimated;
+    if (g_track_info.duration_sec == 0 && estimate > 0) {
+        g_track_info.duration_sec = estimate;
+    }
+
+    // A frame-accurate MP3 count beats both
+    if (g_toc.valid && g_toc.exact) {
+        g_track_info.duration_sec = (int)(g_toc.duration_ms / 1000);
+    }
+}
+
+/**
+ * Adopt the seek table of a newly loaded MP3
+ * A TOC that is only a CBR estimate is refined from the mp3index cache, or
+ * by a background frame scan picked up later in audio_update().
+ * @param probed TOC from tags_probe_toc()
+ */
+static void load_mp3_toc(const char *path, const Mp3Toc *probed) {
+    g_toc = *probed;
+    g_toc_pending = false;
+    if (!g_toc.valid || g_toc.exact) return;
+
+    Mp3Toc cached;
+    if (mp3index_lookup(path, &cached)) {
+        g_toc = cached;
+    } else {
+        mp3index_request(path);
+        g_toc_pending = true;
+        g_toc_last_poll = SDL_GetTicks();
+    }
+}
+
+/**
+ * Find the first frame sync in a buffer
+ * @return Index of the sync, or len if none
+ */
+static size_t find_frame_sync(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i + 1 < len; i++) {
+        if (buf[i] == 0xFF && (buf[i + 1] & 0xE0) == 0xE0) return i;
+    }
+    return len;
+}
+
+/**
+ * Seek an MP3 by reopening it at the TOC offset for the position
+ * @return false to fall back to Mix_SetMusicPosition
+ */
+static bool mp3_toc_seek(double position_sec) {
+    long offset = tags_toc_offset(&g_toc, position_sec);
+    if (offset < 0) return false;
+
+    SDL_RWops *rw = NULL;
+    if (g_music_file_data) {
+        if ((size_t)offset >= g_music_file_size) return false;
+        size_t remaining = g_music_file_size - offset;
+        offset += (long)find_frame_sync(g_music_file_data + offset, remaining < 4096 ? remaining : 4096);
+        if ((size_t)offset >= g_music_file_size) return false;
+        rw = SDL_RWFromConstMem(g_music_file_data + offset, (int)(g_music_file_size - offset));
+    } else {
+        rw = SDL_RWFromFile(g_current_path, "rb");
+        if (rw) {
+            uint8_t probe[4096];
+            size_t got = 0;
+            if (SDL_RWseek(rw, offset, RW_SEEK_SET) >= 0) {
+                got = SDL_RWread(rw, probe, 1, sizeof(probe));
+            }
+            if (got < 4 || SDL_RWseek(rw, offset + (long)find_frame_sync(probe, got), RW_SEEK_SET) < 0) {
+                SDL_RWclose(rw);
+                return false;
             }
         }
     }
 
+    // The stream starts mid-file, so tell SDL_mixer the type
+    Mix_Music *music = rw ? Mix_LoadMUSType_RW(rw, MUS_MP3, 1) : NULL;
+    if (!music) {
+        fprintf(stderr, "[AUDIO] TOC seek failed: %s\n", Mix_GetError());
+        return false;
+    }
+
+    Mix_HaltMusic();
+    Mix_FreeMusic(g_music);
+    g_music = music;
+    if (Mix_PlayMusic(g_music, 1) < 0) {
+        fprintf(stderr, "[AUDIO] Failed to play: %s\n", Mix_GetError());
+        return false;
+    }
+    if (g_is_paused) {
+        Mix_PauseMusic();
+        g_pause_time = SDL_GetTicks();
+    }
+    return true;
+}
+
+/**
+ * Reopen the device with the requested period if nothing is loaded
+ * The EQ post-mix and music hook pointers survive Mix_CloseAudio().
+ */
+static void period_apply(void) {
+    if (g_period_target == g_period_frames || g_music || flac_active() || g_flac_hooked) return;
+    if (g_period_changed && SDL_GetTicks() - g_period_changed < PERIOD_MIN_INTERVAL_MS) return;
+
+    int freq, channels;
+    Uint16 format;
+    if (!Mix_QuerySpec(&freq, &format, &channels)) return;
+
+    g_period_changed = SDL_GetTicks();
+    Mix_CloseAudio();
+    if (Mix_OpenAudio(freq, format, channels, g_period_target) < 0) {
+        fprintf(stderr, "[AUDIO] Reopen with %d frames failed: %s\n", g_period_target, Mix_GetError());
+        g_period_target = g_period_frames;
+        if (Mix_OpenAudio(freq, format, channels, g_period_frames) < 0) {
+            fprintf(stderr, "[AUDIO] Reopen failed: %s\n", Mix_GetError());
+        }
+        audiostats_set_rate(freq);
+        return;
+    }
+    g_period_frames = g_period_target;
+    audiostats_set_rate(freq);
+    Mix_VolumeMusic((int)(g_volume * 1.28));
+
+    printf("[AUDIO] Period %d frames (%.0f ms, %.1f wakeups/s)\n", g_period_frames,
+           g_period_frames * 1000.0 / freq, (double)freq / g_period_frames);
+}
+
+bool audio_load(const char *path) {
+    audio_stop();
+    period_apply();  // Output is silent until the new track starts anyway
+    iosched_hold(IOSCHED_HOLD_MS);  // Opening and priming reads the card
+
+    // Store path for potential FLAC seek
+    strncpy(g_current_path, path, sizeof(g_current_path) - 1);
+    g_current_path[sizeof(g_current_path) - 1] = '\0';
+
+    bool is_flac = is_flac_file(path);
+
+    // For FLAC files, stream via dr_flac (SDL_mixer on Trimui lacks FLAC support)
+    if (is_flac) {
+        if (!flac_stream_open(path, 0)) {
+            fprintf(stderr, "[AUDIO] FLAC decode failed: %s\n", path);
+            return false;
+        }
+    } else {
+        // For MP3/OGG, use native SDL_mixer
+        g_music = Mix_LoadMUS(path);
+        if (!g_music) {
+            fprintf(stderr, "[AUDIO] Failed to load %s: %s\n", path, Mix_GetError());
+            return false;
+        }
+    }
+
+    // Tags, duration estimate and MP3 TOC in one read of the file's head and tail
+    TrackInfo probed;
+    Mp3Toc toc;
+    tags_probe_toc(path, &probed, &toc);
+
+    // Reset track info
+    memset(&g_track_info, 0, sizeof(g_track_info));
+    load_track_tags(&g_track_info, path, &probed);
+
+    // For FLAC, we have the duration from the stream header
+    if (is_flac) {
+        g_track_info.duration_sec = flac_deck()->duration_sec;
+    } else {
+        load_mp3_toc(path, &toc);
+        load_music_duration(probed.duration_sec);
+    }
+
     g_track_info.position_sec = 0;
     g_music_position = 0.0;
+    loudness_apply(loudness_track_gain(path, &g_track_info));
 
     printf("[AUDIO] Loaded: %s - %s (%d sec)\n", g_track_info.artist, g_track_info.title, g_track_info.duration_sec);
 
@@ -784,6 +887,17 @@ bool audio_load(const char *path) {
 }
 
 void audio_play(void) {
+    // FLAC: hook feeds itself, pause is handled inside the hook
+    if (flac_active()) {
+        if (g_is_paused) {
+            g_is_paused = false;
+        } else if (!g_flac_hooked) {
+            Mix_HookMusic(flac_music_hook, NULL);
+            g_flac_hooked = true;
+        }
+        return;
+    }
+
     if (!g_music) return;
 
     if (g_is_paused) {
@@ -801,6 +915,13 @@ void audio_play(void) {
 }
 
 void audio_pause(void) {
+    if (flac_active()) {
+        if (g_flac_hooked && !g_is_paused) {
+            g_is_paused = true;
+        }
+        return;
+    }
+
     if (g_music && Mix_PlayingMusic()) {
         Mix_PauseMusic();
         g_pause_time = SDL_GetTicks();
@@ -822,9 +943,16 @@ void audio_stop(void) {
         Mix_FreeMusic(g_music);
         g_music = NULL;
     }
+    free(g_music_file_data);
+    g_music_file_data = NULL;
+    g_music_file_size = 0;
+    memset(&g_toc, 0, sizeof(g_toc));
+    g_toc_pending = false;
 
-    free_flac_buffer();
+    flac_stream_close();
     g_current_path[0] = '\0';
+    g_handoff_path[0] = '\0';
+    loudness_apply(0.0f);  // Other sources (Spotify) share the EQ stage
 
     g_is_paused = false;
     g_start_time = 0;
@@ -833,86 +961,48 @@ void audio_stop(void) {
 }
 
 bool audio_is_playing(void) {
+    if (flac_active()) {
+        // Locked: mid-handoff the old deck is finished but the new one plays
+        SDL_LockMutex(g_flac_mutex);
+        bool playing = g_flac_hooked && !flac_deck()->finished && !g_is_paused;
+        SDL_UnlockMutex(g_flac_mutex);
+        return playing;
+    }
     return g_music && Mix_PlayingMusic() && !g_is_paused;
 }
 
 bool audio_is_paused(void) {
-    return g_music && g_is_paused;
+    return (g_music || flac_active()) && g_is_paused;
 }
 
 void audio_seek(int seconds) {
-    if (!g_music) return;
+    if (!g_music && !flac_active()) return;
 
     double new_pos = g_music_position + seconds;
     if (new_pos < 0) new_pos = 0;
+    iosched_hold(IOSCHED_HOLD_MS);  // Seeks read from a cold offset
 
     // Clamp to duration
     if (g_track_info.duration_sec > 0 && new_pos >= g_track_info.duration_sec) {
         new_pos = g_track_info.duration_sec - 1;
     }
 
-    // For FLAC (loaded as WAV), we use chunked decoding for fast seeking
-    // Only reload if seeking outside the current chunk
-    if (g_flac_wav_data != NULL && g_current_path[0] != '\0') {
-        int new_pos_int = (int)new_pos;
-
-        // Check if new position is within current chunk (with buffer for smooth playback)
-        // Allow seeking within chunk without reload
-        if (new_pos_int >= g_flac_chunk_start && new_pos_int < g_flac_chunk_end - 2) {
-            // Seek within current chunk - calculate position relative to chunk start
-            int pos_in_chunk = new_pos_int - g_flac_chunk_start;
-
-            // For WAV loaded from memory, we can't use Mix_SetMusicPosition
-            // So we need to reload even for in-chunk seeks, but it's still faster
-            // because we're reusing the already-decoded chunk boundaries
-            bool was_playing = audio_is_playing();
-            int total_duration = g_flac_duration;
-
-            Mix_HaltMusic();
-            Mix_FreeMusic(g_music);
-            g_music = NULL;
-            free_flac_buffer();
-
-            // Reload same chunk but start playback at new position
-            if (load_flac_from_position(g_current_path, g_flac_chunk_start)) {
-                g_flac_duration = total_duration;
-                g_track_info.duration_sec = total_duration;
-
-                if (was_playing) {
-                    Mix_PlayMusic(g_music, 1);
-                }
-
-                // Adjust timing to reflect actual position in track
-                g_music_position = new_pos;
-                g_start_time = SDL_GetTicks() - (Uint32)(pos_in_chunk * 1000);
-            }
-            return;
-        }
-
-        // Seeking outside current chunk - load new chunk centered on target position
-        bool was_playing = audio_is_playing();
-        int total_duration = g_flac_duration;
-
-        Mix_HaltMusic();
-        Mix_FreeMusic(g_music);
-        g_music = NULL;
-        free_flac_buffer();
-
-        // Load new chunk starting from target position
-        if (load_flac_from_position(g_current_path, new_pos_int)) {
-            g_flac_duration = total_duration;
-            g_track_info.duration_sec = total_duration;
-
-            if (was_playing) {
-                Mix_PlayMusic(g_music, 1);
-            }
-
+    // FLAC: reposition the source, the hook picks up from there
+    if (flac_active()) {
+        if (flac_stream_seek(new_pos)) {
             g_music_position = new_pos;
-            g_start_time = SDL_GetTicks();  // Reset timing since we're at chunk start
+            g_track_info.position_sec = (int)new_pos;
         }
         return;
     }
 
+    // MP3 with a seek table: reopen at the TOC offset
+    if (g_toc.valid && mp3_toc_seek(new_pos)) {
+        g_music_position = new_pos;
+        g_start_time = SDL_GetTicks() - (Uint32)(new_pos * 1000);
+        return;
+    }
+
     // For MP3/OGG, use native seek
     if (Mix_SetMusicPosition(new_pos) == 0) {
         g_music_position = new_pos;
@@ -921,7 +1011,7 @@ void audio_seek(int seconds) {
 }
 
 void audio_seek_absolute(int position_sec) {
-    if (!g_music) return;
+    if (!g_music && !flac_active()) return;
 
     // Calculate relative seek from current position
     int current = (int)g_music_position;
@@ -935,13 +1025,10 @@ void audio_set_volume(int volume) {
     g_volume = volume;
     Mix_VolumeMusic((int)(g_volume * 1.28));
 
-    // Sync volume with bluealsa when using Bluetooth audio
+    // Sync volume with bluealsa when using Bluetooth audio (applied by btvolume's worker)
 #ifdef __linux__
-    if (g_using_bluetooth && g_bluealsa_control[0]) {
-        char cmd[256];
-        snprintf(cmd, sizeof(cmd), "amixer -D bluealsa set '%s' %d%% 2>/dev/null",
-                 g_bluealsa_control, volume);
-        system(cmd);
+    if (g_using_bluetooth) {
+        btvolume_set(volume);
     }
 #endif
 }
@@ -952,107 +1039,65 @@ int audio_get_volume(void) {
 
 void audio_set_bluetooth_mode(bool enabled) {
     g_using_bluetooth = enabled;
-    g_bluealsa_control[0] = '\0';
 
-    if (enabled) {
 #ifdef __linux__
-        // Get the bluealsa control name (e.g. "WH-1000XM5 A2DP")
-        // Format: Simple mixer control 'NAME',0
-        FILE *fp = popen("amixer -D bluealsa scontrols 2>/dev/null | head -1", "r");
-        if (fp) {
-            char buf[128];
-            if (fgets(buf, sizeof(buf), fp)) {
-                // Extract name between quotes
-                char *start = strchr(buf, '\'');
-                if (start) {
-                    start++;
-                    char *end = strchr(start, '\'');
-                    if (end) {
-                        size_t len = end - start;
-                        if (len < sizeof(g_bluealsa_control)) {
-                            strncpy(g_bluealsa_control, start, len);
-                            g_bluealsa_control[len] = '\0';
-                        }
-                    }
-                }
-            }
-            pclose(fp);
-        }
+    if (enabled) {
+        // Control name is detected on the worker
+        btvolume_start();
+    } else {
+        btvolume_stop();
+    }
 #endif
-        printf("[AUDIO] Bluetooth mode enabled, control='%s'\n", g_bluealsa_control);
+    if (enabled) {
+        printf("[AUDIO] Bluetooth mode enabled\n");
     }
 }
 
 void audio_update(void) {
-    if (!g_music || !Mix_PlayingMusic() || g_is_paused) return;
-
-    Uint32 elapsed = SDL_GetTicks() - g_start_time;
-
-    // For chunked FLAC playback, position is relative to chunk start
-    // Note: Check g_flac_wav_data != NULL to include ALL chunks (including first at position 0)
-    if (g_flac_wav_data != NULL) {
-        // Calculate position within current chunk
-        double pos_in_chunk = elapsed / 1000.0;
-        int chunk_length = g_flac_chunk_end - g_flac_chunk_start;
-
-        // Clamp to chunk boundaries (prevents overshoot during chunk transitions)
-        if (pos_in_chunk > chunk_length) {
-            pos_in_chunk = chunk_length;
+    flac_finish_handoff();
+    period_apply();
+
+    // Pick up an exact duration once the background MP3 scan is done
+    if (g_toc_pending && SDL_GetTicks() - g_toc_last_poll >= TOC_POLL_MS) {
+        g_toc_last_poll = SDL_GetTicks();
+        Mp3Toc scanned;
+        if (mp3index_lookup(g_current_path, &scanned)) {
+            g_toc = scanned;
+            g_toc_pending = false;
+            g_track_info.duration_sec = (int)(g_toc.duration_ms / 1000);
+            printf("[AUDIO] Exact duration: %d sec\n", g_track_info.duration_sec);
         }
+    }
 
-        // Calculate absolute position (chunk_start + elapsed within chunk)
-        g_music_position = g_flac_chunk_start + pos_in_chunk;
-
-        // Never exceed total duration
-        if (g_music_position > g_flac_duration) {
-            g_music_position = g_flac_duration;
-        }
+    if (!audio_is_playing()) return;
 
-        // Auto-extend chunk when approaching end (5 seconds before)
-        // This ensures seamless playback without gaps
-        int pos_int = (int)g_music_position;
-        if (pos_int >= g_flac_chunk_end - 5 && g_flac_chunk_end < g_flac_duration) {
-            printf("[AUDIO] Auto-extending FLAC chunk (at %d, chunk ends %d)\n",
-                   pos_int, g_flac_chunk_end);
-
-            // Load next chunk seamlessly
-            int total_duration = g_flac_duration;
-
-            Mix_HaltMusic();
-            Mix_FreeMusic(g_music);
-            g_music = NULL;
-            free_flac_buffer();
-
-            // Load chunk starting from current position
-            if (load_flac_from_position(g_current_path, pos_int)) {
-                g_flac_duration = total_duration;
-                g_track_info.duration_sec = total_duration;
-                Mix_PlayMusic(g_music, 1);
-                g_start_time = SDL_GetTicks();  // Reset for new chunk
-                g_music_position = pos_int;
-            }
+    if (flac_active()) {
+        // Position from the hook's delivered-frame count
+        g_music_position = flac_get_position();
+        if (g_music_position > flac_deck()->duration_sec) {
+            g_music_position = flac_deck()->duration_sec;
         }
     } else {
+        Uint32 elapsed = SDL_GetTicks() - g_start_time;
         g_music_position = elapsed / 1000.0;
     }
 
     g_track_info.position_sec = (int)g_music_position;
+
+    // Keep bulk I/O off the card until the next track is running
+    if (g_track_info.duration_sec > 0 &&
+        g_track_info.duration_sec - g_track_info.position_sec <= IOSCHED_TRACK_END_SEC) {
+        iosched_hold(IOSCHED_HOLD_MS);
+    }
 }
 
 const TrackInfo* audio_get_track_info(void) {
     return &g_track_info;
 }
 
-const int16_t* audio_get_pcm_data(size_t *sample_count, int *channels, int *sample_rate) {
-    // PCM data no longer exposed (waveform feature removed)
-    (void)sample_count;
-    (void)channels;
-    (void)sample_rate;
-    return NULL;
-}
-
-bool audio_has_pcm_data(void) {
-    return false;
+void audio_show_track_info(const TrackInfo *info) {
+    if (!info || g_music || flac_active()) return;
+    g_track_info = *info;
 }
 
 const char* audio_format_from_path(const char *path) {
@@ -1074,13 +1119,17 @@ const char* audio_get_format_string(void) {
 }
 
 bool audio_is_flac(void) {
-    return g_flac_wav_data != NULL;
+    return flac_active();
 }
 
-bool audio_load_preloaded(const char *path, uint8_t *wav_data, size_t wav_size, int duration_sec) {
+bool audio_load_preloaded(const char *path, uint8_t *wav_data, size_t wav_size,
+                          void *flac_handle, int duration_sec) {
     audio_stop();
+    iosched_hold(IOSCHED_HOLD_MS);
 
     if (!wav_data || wav_size == 0) {
+        wav_release(wav_data);
+        if (flac_handle) drflac_close((drflac *)flac_handle);
         return false;
     }
 
@@ -1088,66 +1137,177 @@ bool audio_load_preloaded(const char *path, uint8_t *wav_data, size_t wav_size,
     strncpy(g_current_path, path, sizeof(g_current_path) - 1);
     g_current_path[sizeof(g_current_path) - 1] = '\0';
 
-    // Take ownership of the preloaded WAV data
-    g_flac_wav_data = wav_data;
-    g_flac_wav_size = wav_size;
-    g_flac_duration = duration_sec;
-    g_flac_chunk_start = 0;
-    g_flac_chunk_end = duration_sec;
-
-    // Load WAV from memory
-    SDL_RWops *rwops = SDL_RWFromMem(g_flac_wav_data, (int)g_flac_wav_size);
-    if (!rwops) {
-        free_flac_buffer();
-        return false;
-    }
-
-    g_music = Mix_LoadMUS_RW(rwops, SDL_TRUE);
-    if (!g_music) {
-        free_flac_buffer();
+    // Play resident PCM through the music hook (seek = move frame cursor),
+    // continuing from the open decoder if only the head was preloaded
+    if (!flac_pcm_open(flac_deck(), path, wav_data, wav_size, (drflac *)flac_handle, duration_sec)) {
+        g_current_path[0] = '\0';
         return false;
     }
 
     // Reset track info
     memset(&g_track_info, 0, sizeof(g_track_info));
+    TrackInfo probed;
+    tags_probe(path, &probed);
+    load_track_tags(&g_track_info, path, &probed);
     g_track_info.duration_sec = duration_sec;
 
-    // Get metadata (same as audio_load)
-    bool got_metadata = false;
-    MetadataResult cached;
-    if (metadata_get_cached(path, &cached)) {
-        strncpy(g_track_info.title, cached.title, sizeof(g_track_info.title) - 1);
-        strncpy(g_track_info.artist, cached.artist, sizeof(g_track_info.artist) - 1);
-        strncpy(g_track_info.album, cached.album, sizeof(g_track_info.album) - 1);
-        got_metadata = true;
+    g_track_info.position_sec = 0;
+    g_music_position = 0.0;
+    loudness_apply(loudness_track_gain(path, &g_track_info));
+
+    printf("[AUDIO] Loaded preloaded: %s - %s (%d sec)\n",
+           g_track_info.artist, g_track_info.title, g_track_info.duration_sec);
+
+    return true;
+}
+
+bool audio_load_preloaded_music(const char *path, uint8_t *file_data, size_t file_size,
+                                const TrackInfo *probed, const struct Mp3Toc *toc) {
+    audio_stop();
+    iosched_hold(IOSCHED_HOLD_MS);
+
+    strncpy(g_current_path, path, sizeof(g_current_path) - 1);
+    g_current_path[sizeof(g_current_path) - 1] = '\0';
+
+    // Decode from the in-memory copy when the preloader kept one, so the
+    // transition does no SD card I/O; otherwise the file head is already
+    // in the page cache and opening it is cheap.
+    if (file_data && file_size > 0) {
+        SDL_RWops *rw = SDL_RWFromConstMem(file_data, (int)file_size);
+        g_music = rw ? Mix_LoadMUS_RW(rw, 1) : NULL;
+        if (g_music) {
+            g_music_file_data = file_data;
+            g_music_file_size = file_size;
+        } else {
+            free(file_data);
+        }
+    } else {
+        free(file_data);
+        g_music = Mix_LoadMUS(path);
     }
 
-    if (!got_metadata) {
-        // Try embedded tags
-        got_metadata = read_flac_metadata(path, &g_track_info);
+    if (!g_music) {
+        fprintf(stderr, "[AUDIO] Failed to load %s: %s\n", path, Mix_GetError());
+        g_current_path[0] = '\0';
+        return false;
     }
 
-    if (!got_metadata) {
-        extract_filename_title(path, g_track_info.title, sizeof(g_track_info.title));
-        strcpy(g_track_info.artist, "Unknown Artist");
-        strcpy(g_track_info.album, "Unknown Album");
-    } else {
-        if (strlen(g_track_info.title) == 0) {
-            extract_filename_title(path, g_track_info.title, sizeof(g_track_info.title));
-        }
-        if (strlen(g_track_info.artist) == 0) {
-            strcpy(g_track_info.artist, "Unknown Artist");
-        }
-        if (strlen(g_track_info.album) == 0) {
-            strcpy(g_track_info.album, "Unknown Album");
-        }
+    memset(&g_track_info, 0, sizeof(g_track_info));
+    TrackInfo local;
+    Mp3Toc local_toc;
+    if (!probed || !toc) {
+        tags_probe_toc(path, &local, &local_toc);
+        probed = &local;
+        toc = &local_toc;
     }
+    load_track_tags(&g_track_info, path, probed);
+    load_mp3_toc(path, toc);
+    load_music_duration(probed->duration_sec);
 
     g_track_info.position_sec = 0;
     g_music_position = 0.0;
+    loudness_apply(loudness_track_gain(path, &g_track_info));
 
     printf("[AUDIO] Loaded preloaded: %s - %s (%d sec)\n",
            g_track_info.artist, g_track_info.title, g_track_info.duration_sec);
 
     return true;
 }
+
+bool audio_queue_preloaded(const char *path, uint8_t *wav_data, size_t wav_size,
+                           void *flac_handle, int duration_sec) {
+    Deck *next = &g_decks[1 - g_deck];
+    if (!flac_active() || next->active || g_handoff || !wav_data || wav_size == 0) {
+        wav_release(wav_data);
+        if (flac_handle) drflac_close((drflac *)flac_handle);
+        return false;
+    }
+
+    // No overlap until the queued deck is complete
+    SDL_LockMutex(g_flac_mutex);
+    g_fade_bytes = 0;
+    SDL_UnlockMutex(g_flac_mutex);
+
+    // Tags now, so the handoff on the audio thread only has to swap decks
+    TrackInfo probed;
+    tags_probe(path, &probed);
+    memset(&next->info, 0, sizeof(next->info));
+    load_track_tags(&next->info, path, &probed);
+    next->info.duration_sec = duration_sec;
+    if (!probed.has_replaygain) loudness_request(path);  // Gain is looked up at the handoff
+
+    if (!flac_pcm_open(next, path, wav_data, wav_size, (drflac *)flac_handle, duration_sec)) {
+        return false;
+    }
+
+    SDL_LockMutex(g_flac_mutex);
+    int64_t fade = (int64_t)g_crossfade_sec * g_device_freq * g_device_frame_bytes;
+    // Never longer than half the incoming track, nor retroactive for this one
+    int64_t next_len = flac_deck_remaining(next);
+    if (next_len >= 0 && fade > next_len / 2) fade = next_len / 2;
+    int64_t left = flac_deck_remaining(flac_deck());
+    if (left < 0) fade = 0;
+    else if (fade > left) fade = left;
+    g_fade_bytes = fade - fade % g_device_frame_bytes;
+    SDL_UnlockMutex(g_flac_mutex);
+
+    printf("[GAPLESS] Queued on second deck: %s (crossfade %.1fs)\n", next->info.title,
+           g_device_freq > 0 ? (double)g_fade_bytes / g_device_frame_bytes / g_device_freq : 0.0);
+    return true;
+}
+
+bool audio_has_queued(void) {
+    return g_decks[1 - g_deck].active || g_handoff;
+}
+
+bool audio_unqueue(void) {
+    SDL_LockMutex(g_flac_mutex);
+    Deck *next = &g_decks[1 - g_deck];
+    bool queued = next->active && !g_handoff;
+    if (queued) {
+        next->active = false;
+        // Once the crossfade has started, finish fading out rather than jump back up
+        int64_t left = flac_deck_remaining(flac_deck());
+        if (left < 0 || left >= g_fade_bytes) g_fade_bytes = 0;
+    }
+    SDL_UnlockMutex(g_flac_mutex);
+    if (!queued) return false;
+
+    printf("[GAPLESS] Unqueued: %s\n", next->info.title);
+    flac_deck_close(next);
+    return true;
+}
+
+bool audio_take_handoff(char *path, size_t size) {
+    if (!g_handoff_path[0]) return false;
+    strncpy(path, g_handoff_path, size - 1);
+    path[size - 1] = '\0';
+    g_handoff_path[0] = '\0';
+    return true;
+}
+
+void audio_set_resample_quality(ResampleQuality quality) {
+    g_resample_quality = quality;
+}
+
+void audio_set_crossfade(int seconds) {
+    if (seconds < 0) seconds = 0;
+    if (seconds > CROSSFADE_MAX_SEC) seconds = CROSSFADE_MAX_SEC;
+    g_crossfade_sec = seconds;
+}
+
+void audio_set_period(int frames) {
+    if (frames < AUDIO_PERIOD_MIN) frames = AUDIO_PERIOD_MIN;
+    if (frames > AUDIO_PERIOD_MAX) frames = AUDIO_PERIOD_MAX;
+    g_period_target = frames;
+}
+
+int audio_get_period(int *wakeups_per_sec) {
+    if (wakeups_per_sec) {
+        int freq = 44100, channels = 2;
+        Uint16 format = AUDIO_S16SYS;
+        Mix_QuerySpec(&freq, &format, &channels);
+        *wakeups_per_sec = (freq + g_period_frames / 2) / g_period_frames;
+    }
+    return g_period_frames;
+}
@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include "resample.h"
 
 /**
  * Track metadata from ID3 tags or filename
@@ -18,8 +19,17 @@ typedef struct {
     char album[256];
     int duration_sec;      // Total duration in seconds
     int position_sec;      // Current position in seconds
+    bool has_replaygain;   // Track gain tag found (REPLAYGAIN_TRACK_GAIN / R128_TRACK_GAIN)
+    float replaygain_db;   // That gain, relative to -18 LUFS
 } TrackInfo;
 
+struct Mp3Toc;  // MP3 seek table (tags.h)
+
+// Device period in frames (the device is opened with AUDIO_PERIOD_DEFAULT)
+#define AUDIO_PERIOD_DEFAULT 2048
+#define AUDIO_PERIOD_MIN 512
+#define AUDIO_PERIOD_MAX 8192
+
 /**
  * Initialize audio engine
  * @return 0 on success, -1 on failure
@@ -113,19 +123,11 @@ void audio_update(void);
 const TrackInfo* audio_get_track_info(void);
 
 /**
- * Get PCM data for waveform visualization (deprecated - always returns NULL)
- * @param sample_count Output: number of samples per channel
- * @param channels Output: number of channels
- * @param sample_rate Output: sample rate in Hz
- * @return Always NULL (waveform feature removed)
- */
-const int16_t* audio_get_pcm_data(size_t *sample_count, int *channels, int *sample_rate);
-
-/**
- * Check if PCM data is available (deprecated - always returns false)
- * @return Always false (waveform feature removed)
+ * Show saved track info while nothing is loaded (resume snapshot)
+ * Replaced by the real tags on the next load; ignored if a track is loaded.
+ * @param info Track info to show (copied)
  */
-bool audio_has_pcm_data(void);
+void audio_show_track_info(const TrackInfo *info);
 
 /**
  * Get uppercase format string for currently playing track
@@ -142,19 +144,103 @@ const char* audio_format_from_path(const char *path);
 
 /**
  * Check if currently loaded track is a FLAC file
- * @return true if current track is FLAC (uses chunked decoding)
+ * @return true if current track is FLAC (streamed via dr_flac or preloaded)
  */
 bool audio_is_flac(void);
 
 /**
  * Load audio from preloaded WAV data (for gapless playback)
- * Takes ownership of the wav_data pointer
+ * Takes ownership of wav_data and flac_handle, even on failure
  * @param path Original file path (for metadata)
- * @param wav_data WAV data in memory (will be freed by audio_stop)
+ * @param wav_data WAV image from wav_alloc() (released by audio_stop)
  * @param wav_size Size of WAV data
+ * @param flac_handle Open drflac positioned after wav_data's audio, streamed
+ *                    once the resident part has played (NULL = whole track)
  * @param duration_sec Total duration in seconds
  * @return true if loaded successfully
  */
-bool audio_load_preloaded(const char *path, uint8_t *wav_data, size_t wav_size, int duration_sec);
+bool audio_load_preloaded(const char *path, uint8_t *wav_data, size_t wav_size,
+                          void *flac_handle, int duration_sec);
+
+/**
+ * Load a preloaded MP3/OGG/Opus/etc. track through SDL_mixer (gapless playback)
+ * Takes ownership of file_data, even on failure
+ * @param path Original file path (for metadata and format)
+ * @param file_data Whole compressed file in memory, or NULL to open path
+ *                  (head already warmed into the page cache)
+ * @param file_size Size of file_data
+ * @param probed Tags and duration read by the preloader (NULL = read now)
+ * @param toc MP3 seek table read with them (NULL = read now)
+ * @return true if loaded successfully
+ */
+bool audio_load_preloaded_music(const char *path, uint8_t *file_data, size_t file_size,
+                                const TrackInfo *probed, const struct Mp3Toc *toc);
+
+/**
+ * Queue a preloaded FLAC on the second deck, behind the playing FLAC
+ * The audio thread switches to it at the sample the current track ends,
+ * or mixes both over the crossfade window; audio_take_handoff() reports
+ * the switch. Takes ownership of wav_data and flac_handle, even on failure.
+ * @param path Original file path (for metadata)
+ * @param wav_data WAV image from wav_alloc()
+ * @param wav_size Size of WAV data
+ * @param flac_handle Open drflac positioned after wav_data's audio (NULL = whole track)
+ * @param duration_sec Total duration in seconds
+ * @return true if queued (false if the playing track isn't a FLAC deck)
+ */
+bool audio_queue_preloaded(const char *path, uint8_t *wav_data, size_t wav_size,
+                           void *flac_handle, int duration_sec);
+
+/**
+ * Check if a track is queued on the second deck
+ */
+bool audio_has_queued(void);
+
+/**
+ * Drop the track queued on the second deck before the audio thread takes it
+ * For when what plays next has changed (repeat, shuffle or the playlist).
+ * Inside the crossfade window the playing track still fades out.
+ * @return true if a queued track was dropped (false if none, or already handed off)
+ */
+bool audio_unqueue(void);
+
+/**
+ * Report a deck handoff since the last call (once per handoff)
+ * The queued track is then the current one and already playing.
+ * @param path Receives the path of the track that took over
+ * @param size Size of path buffer
+ * @return true if a handoff happened
+ */
+bool audio_take_handoff(char *path, size_t size);
+
+/**
+ * Set crossfade between queued tracks (0 = gapless, no overlap)
+ * Applies to the next track queued.
+ * @param seconds Overlap in seconds
+ */
+void audio_set_crossfade(int seconds);
+
+/**
+ * Set the resampler filter length for FLAC at a rate other than the device's
+ * Applies to the next track opened.
+ * @param quality RESAMPLE_FAST/MEDIUM/BEST
+ */
+void audio_set_resample_quality(ResampleQuality quality);
+
+/**
+ * Request a device period (frames per audio callback)
+ * Longer periods let the SoC sleep between callbacks, shorter ones cut
+ * EQ and seek latency. The device is reopened only at a safe point:
+ * while nothing is loaded, or before a cold audio_load().
+ * @param frames Period in frames (clamped to AUDIO_PERIOD_MIN..MAX)
+ */
+void audio_set_period(int frames);
+
+/**
+ * Get the period the device runs with
+ * @param wakeups_per_sec Receives audio callbacks per second (may be NULL)
+ * @return Period in frames
+ */
+int audio_get_period(int *wakeups_per_sec);
 
 #endif // AUDIO_H
@@ -0,0 +1,178 @@
+/**
+ * Audio Stats Implementation
+ *
+ * Every counter is an SDL_atomic_t written only by the audio thread, so
+ * updates are plain get/set pairs with no read-modify-write races; other
+ * threads only read, or raise a flag for the writer to act on (reset,
+ * device reopened). Cost per call is two monotonic clock reads and a
+ * handful of stores.
+ */
+
+#include "audiostats.h"
+#include <SDL2/SDL.h>
+#include <time.h>
+
+static const unsigned g_bucket_limits[AUDIOSTATS_BUCKETS] = AUDIOSTATS_BUCKET_LIMITS_US;
+
+/**
+ * One path's published counters
+ */
+typedef struct {
+    SDL_atomic_t calls;
+    SDL_atomic_t avg_us;
+    SDL_atomic_t worst_us;
+    SDL_atomic_t hist[AUDIOSTATS_BUCKETS];
+} PathCounters;
+
+static PathCounters g_paths[AUDIO_PATH_COUNT];
+static SDL_atomic_t g_callbacks;
+static SDL_atomic_t g_deadline_misses;
+static SDL_atomic_t g_late_callbacks;
+static SDL_atomic_t g_worst_gap_us;
+static SDL_atomic_t g_period_us;
+
+// Set by other threads, consumed by the writer
+static SDL_atomic_t g_rate = { AUDIOSTATS_DEFAULT_RATE };
+static SDL_atomic_t g_reset_pending;
+static SDL_atomic_t g_restart_pending;
+
+// Audio thread only
+static uint64_t g_last_callback_us = 0;  // Post-mix start of the previous callback
+static unsigned g_callback_work_us = 0;  // Time in our paths this callback
+
+/**
+ * Monotonic time in microseconds
+ */
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/**
+ * Add one to a counter (single writer)
+ */
+static void bump(SDL_atomic_t *counter) {
+    SDL_AtomicSet(counter, SDL_AtomicGet(counter) + 1);
+}
+
+/**
+ * Raise a counter to a value if it is below (single writer)
+ */
+static void raise_to(SDL_atomic_t *counter, unsigned value) {
+    if (value > (unsigned)SDL_AtomicGet(counter)) SDL_AtomicSet(counter, (int)value);
+}
+
+/**
+ * Zero every counter (writer side of audiostats_reset)
+ */
+static void clear_counters(void) {
+    for (int p = 0; p < AUDIO_PATH_COUNT; p++) {
+        SDL_AtomicSet(&g_paths[p].calls, 0);
+        SDL_AtomicSet(&g_paths[p].avg_us, 0);
+        SDL_AtomicSet(&g_paths[p].worst_us, 0);
+        for (int b = 0; b < AUDIOSTATS_BUCKETS; b++) SDL_AtomicSet(&g_paths[p].hist[b], 0);
+    }
+    SDL_AtomicSet(&g_callbacks, 0);
+    SDL_AtomicSet(&g_deadline_misses, 0);
+    SDL_AtomicSet(&g_late_callbacks, 0);
+    SDL_AtomicSet(&g_worst_gap_us, 0);
+    g_last_callback_us = 0;
+    g_callback_work_us = 0;
+}
+
+void audiostats_set_rate(int freq) {
+    if (freq > 0) SDL_AtomicSet(&g_rate, freq);
+    SDL_AtomicSet(&g_restart_pending, 1);
+}
+
+uint64_t audiostats_begin(void) {
+    return now_us();
+}
+
+void audiostats_end(AudioPath path, uint64_t start_us, int frames) {
+    if (SDL_AtomicGet(&g_reset_pending)) {
+        clear_counters();
+        SDL_AtomicSet(&g_reset_pending, 0);
+    }
+
+    unsigned took = (unsigned)(now_us() - start_us);
+    PathCounters *p = &g_paths[path];
+
+    unsigned calls = (unsigned)SDL_AtomicGet(&p->calls);
+    int avg = SDL_AtomicGet(&p->avg_us);
+    avg = calls ? avg + ((int)took - avg) / 16 : (int)took;
+    SDL_AtomicSet(&p->avg_us, avg);
+    SDL_AtomicSet(&p->calls, (int)(calls + 1));
+    raise_to(&p->worst_us, took);
+
+    int bucket = 0;
+    while (bucket < AUDIOSTATS_BUCKETS - 1 && took >= g_bucket_limits[bucket]) bucket++;
+    bump(&p->hist[bucket]);
+
+    g_callback_work_us += took;
+    if (path != AUDIO_PATH_POSTMIX) return;
+
+    // Post-mix runs last: close this device callback
+    int rate = SDL_AtomicGet(&g_rate);
+    unsigned period = (unsigned)((uint64_t)frames * 1000000u / (unsigned)rate);
+    SDL_AtomicSet(&g_period_us, (int)period);
+    bump(&g_callbacks);
+    if (g_callback_work_us > period) bump(&g_deadline_misses);
+    g_callback_work_us = 0;
+
+    bool restarted = SDL_AtomicGet(&g_restart_pending) != 0;
+    if (restarted) SDL_AtomicSet(&g_restart_pending, 0);
+    if (g_last_callback_us && !restarted) {
+        unsigned gap = (unsigned)(start_us - g_last_callback_us);
+        if (gap < AUDIOSTATS_MAX_GAP_MS * 1000u) {
+            raise_to(&g_worst_gap_us, gap);
+            if ((uint64_t)gap * 100u > (uint64_t)period * AUDIOSTATS_LATE_PCT) {
+                bump(&g_late_callbacks);
+            }
+        }
+    }
+    g_last_callback_us = start_us;
+}
+
+void audiostats_read(AudioStats *out) {
+    for (int p = 0; p < AUDIO_PATH_COUNT; p++) {
+        out->path[p].calls = (unsigned)SDL_AtomicGet(&g_paths[p].calls);
+        out->path[p].avg_us = (unsigned)SDL_AtomicGet(&g_paths[p].avg_us);
+        out->path[p].worst_us = (unsigned)SDL_AtomicGet(&g_paths[p].worst_us);
+        for (int b = 0; b < AUDIOSTATS_BUCKETS; b++) {
+            out->path[p].hist[b] = (unsigned)SDL_AtomicGet(&g_paths[p].hist[b]);
+        }
+    }
+    out->callbacks = (unsigned)SDL_AtomicGet(&g_callbacks);
+    out->deadline_misses = (unsigned)SDL_AtomicGet(&g_deadline_misses);
+    out->late_callbacks = (unsigned)SDL_AtomicGet(&g_late_callbacks);
+    out->worst_gap_us = (unsigned)SDL_AtomicGet(&g_worst_gap_us);
+    out->period_us = (unsigned)SDL_AtomicGet(&g_period_us);
+}
+
+void audiostats_reset(void) {
+    SDL_AtomicSet(&g_reset_pending, 1);
+}
+
+unsigned audiostats_bucket_limit_us(int bucket) {
+    if (bucket < 0 || bucket >= AUDIOSTATS_BUCKETS) return 0;
+    return g_bucket_limits[bucket];
+}
+
+unsigned audiostats_percentile_us(const AudioPathStats *stats, int pct) {
+    unsigned total = 0;
+    for (int b = 0; b < AUDIOSTATS_BUCKETS; b++) total += stats->hist[b];
+    if (total == 0) return 0;
+
+    unsigned rank = (unsigned)(((uint64_t)total * (unsigned)pct + 99) / 100);
+    if (rank < 1) rank = 1;
+    unsigned seen = 0;
+    for (int b = 0; b < AUDIOSTATS_BUCKETS - 1; b++) {
+        seen += stats->hist[b];
+        if (seen >= rank) {
+            return g_bucket_limits[b] < stats->worst_us ? g_bucket_limits[b] : stats->worst_us;
+        }
+    }
+    return stats->worst_us;
+}
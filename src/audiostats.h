@@ -0,0 +1,117 @@
+/**
+ * Audio Stats - Timing of the audio thread's own processing
+ *
+ * The FLAC music hook and the post-mix path (EQ, spectrum tap) time each
+ * call and record it here: a histogram of processing times, a running
+ * average, the worst case and how often one device callback spent more
+ * than its period in our code. The gap between post-mix calls (one per
+ * device callback) is tracked too, since a late callback is what the
+ * listener hears as a dropout whatever its cause.
+ *
+ * The audio thread is the only writer and never blocks; counters are
+ * SDL atomics that the perf HUD and the bench read at any time. Fields
+ * are read one by one, so a snapshot may straddle a callback.
+ */
+
+#ifndef AUDIOSTATS_H
+#define AUDIOSTATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Histogram bucket upper bounds in microseconds (the last one is open)
+#define AUDIOSTATS_BUCKETS 10
+#define AUDIOSTATS_BUCKET_LIMITS_US { 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 0 }
+
+// A callback gap above this share of the period counts as late (percent)
+#define AUDIOSTATS_LATE_PCT 150
+
+// Longer gaps are the device being stopped (system suspend), not a dropout
+#define AUDIOSTATS_MAX_GAP_MS 1000
+
+// Rate assumed until audiostats_set_rate() (SDL_mixer default)
+#define AUDIOSTATS_DEFAULT_RATE 44100
+
+/**
+ * Timed paths on the audio thread
+ */
+typedef enum {
+    AUDIO_PATH_FLAC_HOOK,       // flac_music_hook(): decode ring pull, crossfade, mix
+    AUDIO_PATH_POSTMIX,         // eq_postmix_callback(): EQ and spectrum tap
+    AUDIO_PATH_COUNT
+} AudioPath;
+
+/**
+ * One path's counters
+ */
+typedef struct {
+    unsigned calls;
+    unsigned avg_us;            // Running average (1/16 weight per call)
+    unsigned worst_us;
+    unsigned hist[AUDIOSTATS_BUCKETS];
+} AudioPathStats;
+
+/**
+ * Snapshot of all counters
+ */
+typedef struct {
+    AudioPathStats path[AUDIO_PATH_COUNT];
+    unsigned callbacks;         // Device callbacks seen (post-mix calls)
+    unsigned deadline_misses;   // Callbacks whose processing took longer than the period
+    unsigned late_callbacks;    // Gaps above AUDIOSTATS_LATE_PCT of the period
+    unsigned worst_gap_us;      // Longest gap between callbacks
+    unsigned period_us;         // Period of the latest callback
+} AudioStats;
+
+/**
+ * Set the device rate the period is computed from
+ * Call after every open of the device: the gap across a reopen isn't a
+ * late callback. Gaps over AUDIOSTATS_MAX_GAP_MS (suspend) aren't either.
+ * @param freq Output sample rate in Hz
+ */
+void audiostats_set_rate(int freq);
+
+/**
+ * Start timing a path (audio thread)
+ * @return Start time, for audiostats_end()
+ */
+uint64_t audiostats_begin(void);
+
+/**
+ * Record one call of a path (audio thread)
+ * AUDIO_PATH_POSTMIX closes the device callback: it also records the gap
+ * since the previous one and checks the callback's total against the period.
+ * @param path Path that ran
+ * @param start_us Value from audiostats_begin()
+ * @param frames Frames in the device buffer
+ */
+void audiostats_end(AudioPath path, uint64_t start_us, int frames);
+
+/**
+ * Read the counters (any thread)
+ * @param out Output
+ */
+void audiostats_read(AudioStats *out);
+
+/**
+ * Zero the counters (any thread)
+ * Applied by the writer at its next call, so it never races a callback.
+ */
+void audiostats_reset(void);
+
+/**
+ * Upper bound of a histogram bucket
+ * @param bucket Index below AUDIOSTATS_BUCKETS
+ * @return Microseconds, 0 for the open last bucket
+ */
+unsigned audiostats_bucket_limit_us(int bucket);
+
+/**
+ * Estimate a percentile from a path's histogram
+ * @param stats Path counters
+ * @param pct Percentile (1-100)
+ * @return Upper bound of the bucket it falls in (worst_us for the last), 0 if no calls
+ */
+unsigned audiostats_percentile_us(const AudioPathStats *stats, int pct);
+
+#endif // AUDIOSTATS_H
@@ -2,185 +2,309 @@
  * File Browser Implementation
  *
  * Provides directory navigation with filtering for audio files.
- * Supports MP3, FLAC, OGG, and WAV formats.
+ * Supports MP3, FLAC, OGG, and WAV formats. Listings come from the
+ * library index (library.c), which only touches the disk when a folder
+ * changed since it was last indexed. Folders that need reading are scanned
+ * in the background: entries show up as they are read and are replaced
+ * by the sorted listing when the scan completes.
+ *
+ * A single entry that the player itself added, removed or renamed (file
+ * menu, finished download) is patched into the sorted list at the place a
+ * binary search finds, instead of listing the folder again.
  */
 
 #include "browser.h"
+#include "library.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <dirent.h>
-#include <sys/stat.h>
-#include <ctype.h>
-
-// Maximum entries we can handle
-#define MAX_ENTRIES 1024
 
 // Visible items in list (dynamic from UI)
 #include "ui.h"
 #define VISIBLE_ITEMS ui_get_list_visible_rows()
 
-// File list
-static FileEntry g_entries[MAX_ENTRIES];
+// File list: compact entries plus one string arena for all names
+// (grows to fit the folder, no entry cap)
+static FileEntry *g_entries = NULL;
+static uint32_t *g_name_offsets = NULL;   // Arena offset per entry
 static int g_entry_count = 0;
+static int g_entry_capacity = 0;
+static char *g_arena = NULL;
+static size_t g_arena_used = 0;
+static size_t g_arena_capacity = 0;
 static int g_cursor = 0;
 static int g_scroll_offset = 0;
 
 // Current paths
 static char g_base_path[512];
 static char g_current_path[512];
+static char g_parent_path[512];           // Target of the ".." entry
+
+// Paths derived on demand (separate so callers can hold one of each)
+static char g_entry_path[512];
+static char g_selected_path[512];
+static char g_next_track_path[512];
+
+// Background scan of g_current_path
+static unsigned g_scan_ticket = 0;
+static bool g_scanning = false;
+static char g_pending_name[256] = {0};    // Entry to select once listed
+static int g_pending_cursor = -1;         // Cursor to restore once listed
+static bool g_keep_listing = false;       // Scan replaces the shown listing at the end
 
 /**
- * Check if filename has an audio extension (optimized)
+ * Copy a name into the arena
+ * Re-points every entry's name if the arena had to move.
+ * @return Arena offset, or UINT32_MAX if out of memory
  */
-static bool is_audio_file(const char *name) {
-    const char *ext = strrchr(name, '.');
-    if (!ext || ext[1] == '\0') return false;
-
-    // Get extension length
-    int len = 0;
-    for (const char *p = ext; *p; p++) len++;
-    if (len < 4 || len > 5) return false;
-
-    // Case-insensitive comparison
-    char c1 = ext[1] | 0x20;  // tolower
-    char c2 = ext[2] | 0x20;
-    char c3 = ext[3] | 0x20;
-
-    if (len == 4) {
-        // .mp3, .ogg, .wav, .m4a
-        if (c1 == 'm' && c2 == 'p' && c3 == '3') return true;
-        if (c1 == 'o' && c2 == 'g' && c3 == 'g') return true;
-        if (c1 == 'w' && c2 == 'a' && c3 == 'v') return true;
-        if (c1 == 'm' && c2 == '4' && c3 == 'a') return true;
-    } else {
-        // .flac, .webm, .opus
-        char c4 = ext[4] | 0x20;
-        if (c1 == 'f' && c2 == 'l' && c3 == 'a' && c4 == 'c') return true;
-        if (c1 == 'w' && c2 == 'e' && c3 == 'b' && c4 == 'm') return true;
-        if (c1 == 'o' && c2 == 'p' && c3 == 'u' && c4 == 's') return true;
+static uint32_t arena_add(const char *name) {
+    size_t len = strlen(name) + 1;
+    if (g_arena_used + len > g_arena_capacity) {
+        size_t new_capacity = g_arena_capacity ? g_arena_capacity * 2 : 4096;
+        while (new_capacity < g_arena_used + len) new_capacity *= 2;
+        char *grown = realloc(g_arena, new_capacity);
+        if (!grown) return UINT32_MAX;
+        if (grown != g_arena) {
+            for (int i = 0; i < g_entry_count; i++) {
+                g_entries[i].name = grown + g_name_offsets[i];
+            }
+        }
+        g_arena = grown;
+        g_arena_capacity = new_capacity;
     }
 
-    return false;
+    uint32_t offset = (uint32_t)g_arena_used;
+    memcpy(g_arena + offset, name, len);
+    g_arena_used += len;
+    return offset;
+}
+
+/**
+ * Append an entry with its name interned in the arena
+ * @return false if out of memory
+ */
+static bool append_entry(const char *name, EntryType type) {
+    if (g_entry_count == g_entry_capacity) {
+        int new_capacity = g_entry_capacity ? g_entry_capacity * 2 : 64;
+        FileEntry *grown = realloc(g_entries, new_capacity * sizeof(FileEntry));
+        if (!grown) return false;
+        g_entries = grown;
+        uint32_t *grown_offsets = realloc(g_name_offsets, new_capacity * sizeof(uint32_t));
+        if (!grown_offsets) return false;
+        g_name_offsets = grown_offsets;
+        g_entry_capacity = new_capacity;
+    }
+
+    uint32_t offset = arena_add(name);
+    if (offset == UINT32_MAX) return false;
+
+    g_name_offsets[g_entry_count] = offset;
+    g_entries[g_entry_count].name = g_arena + offset;
+    g_entries[g_entry_count].type = type;
+    g_entry_count++;
+    return true;
+}
+
+/**
+ * Compare entry at index with a name in display order
+ */
+static int compare_entry(int index, const char *name, EntryType type) {
+    return library_compare_entries(g_entries[index].name, g_entries[index].type == ENTRY_DIRECTORY,
+                                   name, type == ENTRY_DIRECTORY);
 }
 
 /**
- * Natural sort comparison - treats embedded numbers as integers
- * Example: "Track 2" < "Track 10" (unlike alphabetical sort)
+ * Binary search for the first entry not before a name ("..", if any, stays first)
  */
-static int compare_natural(const char *a, const char *b) {
-    while (*a && *b) {
-        if (isdigit((unsigned char)*a) && isdigit((unsigned char)*b)) {
-            // Both pointing to digits - compare as integers
-            long na = strtol(a, (char **)&a, 10);
-            long nb = strtol(b, (char **)&b, 10);
-            if (na != nb) return (na < nb) ? -1 : 1;
-            // Numbers equal, continue comparing rest of string
+static int lower_bound(const char *name, EntryType type) {
+    int lo = (g_entry_count > 0 && g_entries[0].type == ENTRY_PARENT) ? 1 : 0;
+    int hi = g_entry_count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (compare_entry(mid, name, type) < 0) {
+            lo = mid + 1;
         } else {
-            // Compare characters case-insensitively
-            int ca = tolower((unsigned char)*a);
-            int cb = tolower((unsigned char)*b);
-            if (ca != cb) return ca - cb;
-            a++;
-            b++;
+            hi = mid;
         }
     }
-    // Handle different lengths
-    return (unsigned char)*a - (unsigned char)*b;
+    return lo;
 }
 
 /**
- * Compare function for sorting entries (parent first, then directories, then files)
+ * Find an entry by exact name
+ * @return Index, or -1 if not listed
  */
-static int compare_entries(const void *a, const void *b) {
-    const FileEntry *ea = (const FileEntry *)a;
-    const FileEntry *eb = (const FileEntry *)b;
+static int find_entry(const char *name, EntryType type) {
+    // Names that only differ in case compare equal: check each of them
+    for (int i = lower_bound(name, type); i < g_entry_count && compare_entry(i, name, type) == 0; i++) {
+        if (g_entries[i].type == type && strcmp(g_entries[i].name, name) == 0) return i;
+    }
+    return -1;
+}
 
-    // Parent entry always first
-    if (ea->type == ENTRY_PARENT) return -1;
-    if (eb->type == ENTRY_PARENT) return 1;
+/**
+ * Insert an entry at its sorted place, keeping the cursor on its entry
+ * @return Index, or -1 if out of memory
+ */
+static int insert_entry(const char *name, EntryType type) {
+    int pos = lower_bound(name, type);
+    if (!append_entry(name, type)) return -1;
+
+    // Rotate the appended entry down into place
+    int last = g_entry_count - 1;
+    FileEntry entry = g_entries[last];
+    uint32_t offset = g_name_offsets[last];
+    memmove(&g_entries[pos + 1], &g_entries[pos], (last - pos) * sizeof(FileEntry));
+    memmove(&g_name_offsets[pos + 1], &g_name_offsets[pos], (last - pos) * sizeof(uint32_t));
+    g_entries[pos] = entry;
+    g_name_offsets[pos] = offset;
+
+    if (pos <= g_cursor && g_cursor < last) g_cursor++;
+    return pos;
+}
 
-    // Directories come before files
-    if (ea->type != eb->type) {
-        return ea->type == ENTRY_DIRECTORY ? -1 : 1;
-    }
+/**
+ * Remove an entry; the cursor moves to the next one if it was on it
+ * (its name stays in the arena until the next listing)
+ */
+static void remove_entry(int index) {
+    int tail = g_entry_count - index - 1;
+    memmove(&g_entries[index], &g_entries[index + 1], tail * sizeof(FileEntry));
+    memmove(&g_name_offsets[index], &g_name_offsets[index + 1], tail * sizeof(uint32_t));
+    g_entry_count--;
+
+    if (index < g_cursor) g_cursor--;
+    if (g_cursor >= g_entry_count) g_cursor = g_entry_count > 0 ? g_entry_count - 1 : 0;
+}
 
-    // Natural sort within same type
-    return compare_natural(ea->name, eb->name);
+/**
+ * Library callback: add one listed entry (already in display order)
+ */
+static void add_library_entry(const char *name, bool is_dir, void *userdata) {
+    (void)userdata;
+    append_entry(name, is_dir ? ENTRY_DIRECTORY : ENTRY_FILE);
 }
 
 /**
- * Scan directory and populate entries
+ * Library callback: ignore an entry (the shown listing stays as is)
  */
-static int scan_directory(const char *path) {
-    DIR *dir = opendir(path);
-    if (!dir) {
-        fprintf(stderr, "Cannot open directory: %s\n", path);
-        return -1;
-    }
+static void skip_library_entry(const char *name, bool is_dir, void *userdata) {
+    (void)name;
+    (void)is_dir;
+    (void)userdata;
+}
 
-    g_entry_count = 0;
-    g_cursor = 0;
-    g_scroll_offset = 0;
+/**
+ * Move the cursor into view
+ */
+static void scroll_to_cursor(void) {
+    if (g_cursor < g_scroll_offset) {
+        g_scroll_offset = g_cursor;
+    } else if (g_cursor >= g_scroll_offset + VISIBLE_ITEMS) {
+        g_scroll_offset = g_cursor - VISIBLE_ITEMS + 1;
+    }
+}
 
-    // Add ".." entry if not at base path
-    if (strcmp(path, g_base_path) != 0) {
-        FileEntry *parent = &g_entries[g_entry_count];
-        parent->type = ENTRY_PARENT;
-        strncpy(parent->name, "", sizeof(parent->name) - 1);  // Empty, prefix handles display
-        // Build parent path
-        char parent_path[512];
-        strncpy(parent_path, path, sizeof(parent_path) - 1);
-        char *last_sep = strrchr(parent_path, '/');
-        if (last_sep && last_sep != parent_path) {
-            *last_sep = '\0';
+/**
+ * Apply the selection requested before the listing was ready
+ */
+static void apply_pending_selection(void) {
+    if (g_pending_name[0]) {
+        for (int i = 0; i < g_entry_count; i++) {
+            if (g_entries[i].type != ENTRY_PARENT &&
+                strcmp(g_entries[i].name, g_pending_name) == 0) {
+                g_cursor = i;
+                break;
+            }
         }
-        strncpy(parent->full_path, parent_path, sizeof(parent->full_path) - 1);
-        g_entry_count++;
-    }
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL && g_entry_count < MAX_ENTRIES) {
-        // Skip hidden files and special entries
-        if (entry->d_name[0] == '.') continue;
-
-        // Build full path
-        char full_path[512];
-        snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-
-        // Get file info
-        struct stat st;
-        if (stat(full_path, &st) != 0) continue;
-
-        FileEntry *fe = &g_entries[g_entry_count];
-
-        if (S_ISDIR(st.st_mode)) {
-            // Directory
-            fe->type = ENTRY_DIRECTORY;
-            strncpy(fe->name, entry->d_name, sizeof(fe->name) - 1);
-            strncpy(fe->full_path, full_path, sizeof(fe->full_path) - 1);
-            g_entry_count++;
-        } else if (S_ISREG(st.st_mode) && is_audio_file(entry->d_name)) {
-            // Audio file
-            fe->type = ENTRY_FILE;
-            strncpy(fe->name, entry->d_name, sizeof(fe->name) - 1);
-            strncpy(fe->full_path, full_path, sizeof(fe->full_path) - 1);
-            g_entry_count++;
+        g_pending_name[0] = '\0';
+    }
+
+    if (g_pending_cursor >= 0) {
+        // If it was at or past the end, go to the new last item
+        if (g_pending_cursor >= g_entry_count) {
+            g_cursor = g_entry_count > 0 ? g_entry_count - 1 : 0;
+        } else {
+            g_cursor = g_pending_cursor;
         }
+        g_pending_cursor = -1;
     }
 
-    closedir(dir);
+    scroll_to_cursor();
+}
 
-    // Sort entries
-    if (g_entry_count > 0) {
-        qsort(g_entries, g_entry_count, sizeof(FileEntry), compare_entries);
+/**
+ * Drop all entries but ".."
+ */
+static void clear_listing(void) {
+    g_entry_count = 0;
+    g_arena_used = 0;
+
+    if (strcmp(g_current_path, g_base_path) != 0) {
+        append_entry("", ENTRY_PARENT);  // Empty name, prefix handles display
     }
+}
 
-    printf("Scanned %s: %d entries\n", path, g_entry_count);
+/**
+ * Set the ".." target for a folder
+ */
+static void set_parent_path(const char *path) {
+    strncpy(g_parent_path, path, sizeof(g_parent_path) - 1);
+    g_parent_path[sizeof(g_parent_path) - 1] = '\0';
+    char *last_sep = strrchr(g_parent_path, '/');
+    if (last_sep && last_sep != g_parent_path) {
+        *last_sep = '\0';
+    }
+}
 
+/**
+ * Populate entries from the library index
+ * Entries arrive sorted (directories, then files, natural order), so only
+ * the ".." entry is added here. A folder that is missing from the index or
+ * changed on disk is handed to the background scanner (cancelling the
+ * previous one) and filled in by browser_update().
+ */
+static int scan_directory(const char *path) {
+    g_cursor = 0;
+    g_scroll_offset = 0;
+    g_scanning = false;
+    g_keep_listing = false;
+
+    // Build parent path for the ".." entry
+    set_parent_path(path);
+    clear_listing();
+
+    int count = library_list_cached(path, add_library_entry, NULL, true);
+    if (count == LIBRARY_NOT_INDEXED) {
+        g_scan_ticket = library_scan_start(path);
+        g_scanning = true;
+        return 0;
+    }
+    if (count < 0) {
+        g_entry_count = 0;
+        g_pending_name[0] = '\0';
+        g_pending_cursor = -1;
+        return -1;
+    }
+
+    apply_pending_selection();
     return 0;
 }
 
+/**
+ * Build the full path of an entry into buf
+ */
+static const char* entry_path(int index, char *buf, size_t size) {
+    if (g_entries[index].type == ENTRY_PARENT) {
+        snprintf(buf, size, "%s", g_parent_path);
+    } else {
+        snprintf(buf, size, "%s/%s", g_current_path, g_entries[index].name);
+    }
+    return buf;
+}
+
 int browser_init(const char *base_path) {
     strncpy(g_base_path, base_path, sizeof(g_base_path) - 1);
     strncpy(g_current_path, base_path, sizeof(g_current_path) - 1);
@@ -188,7 +312,73 @@ int browser_init(const char *base_path) {
     return scan_directory(g_current_path);
 }
 
+int browser_restore(const char *base_path, const char *path, const char *names,
+                    const unsigned char *is_dir, int count, int cursor) {
+    // Must be the base folder or inside it
+    size_t base_len = strlen(base_path);
+    if (strncmp(path, base_path, base_len) != 0 ||
+        (path[base_len] != '\0' && path[base_len] != '/')) {
+        return -1;
+    }
+
+    strncpy(g_base_path, base_path, sizeof(g_base_path) - 1);
+    strncpy(g_current_path, path, sizeof(g_current_path) - 1);
+    g_cursor = 0;
+    g_scroll_offset = 0;
+    g_scanning = false;
+    g_keep_listing = false;
+    set_parent_path(path);
+    clear_listing();
+
+    const char *name = names;
+    for (int i = 0; i < count; i++) {
+        if (!append_entry(name, is_dir[i] ? ENTRY_DIRECTORY : ENTRY_FILE)) return -1;
+        name += strlen(name) + 1;
+    }
+
+    // Saved cursor doesn't count ".."
+    if (g_entry_count > 0 && g_entries[0].type == ENTRY_PARENT) cursor++;
+    browser_set_cursor(cursor);
+    return 0;
+}
+
+void browser_revalidate(void) {
+    if (g_scanning) return;
+
+    // Changed or never indexed: keep showing this listing until the
+    // scan has the sorted one (browser_update keeps the selection)
+    int count = library_list_cached(g_current_path, skip_library_entry, NULL, true);
+    if (count == LIBRARY_NOT_INDEXED) {
+        g_scan_ticket = library_scan_start(g_current_path);
+        g_scanning = true;
+        g_keep_listing = true;
+        return;
+    }
+    if (count < 0) {
+        scan_directory(g_current_path);
+        return;
+    }
+
+    // Swap in the index's listing, same entry selected
+    if (g_cursor < g_entry_count && g_entries[g_cursor].type != ENTRY_PARENT) {
+        strncpy(g_pending_name, g_entries[g_cursor].name, sizeof(g_pending_name) - 1);
+        g_pending_name[sizeof(g_pending_name) - 1] = '\0';
+    }
+    clear_listing();
+    library_list_cached(g_current_path, add_library_entry, NULL, false);
+    apply_pending_selection();
+}
+
 void browser_cleanup(void) {
+    free(g_entries);
+    free(g_name_offsets);
+    free(g_arena);
+    g_entries = NULL;
+    g_name_offsets = NULL;
+    g_arena = NULL;
+    g_arena_used = 0;
+    g_arena_capacity = 0;
+    g_entry_capacity = 0;
     g_entry_count = 0;
     g_cursor = 0;
 }
@@ -229,7 +419,9 @@ bool browser_select_current(void) {
         return false;
     } else if (entry->type == ENTRY_DIRECTORY) {
         // Enter directory
-        strncpy(g_current_path, entry->full_path, sizeof(g_current_path) - 1);
+        char dir_path[512];
+        entry_path(g_cursor, dir_path, sizeof(dir_path));
+        strncpy(g_current_path, dir_path, sizeof(g_current_path) - 1);
         scan_directory(g_current_path);
         return false;  // Not a file selection
     } else {
@@ -263,25 +455,11 @@ bool browser_go_up(void) {
         strncpy(g_current_path, g_base_path, sizeof(g_current_path) - 1);
     }
 
+    // Select the folder we came from once it's listed
+    strncpy(g_pending_name, leaving_folder, sizeof(g_pending_name) - 1);
+    g_pending_name[sizeof(g_pending_name) - 1] = '\0';
     scan_directory(g_current_path);
 
-    // Find and select the folder we came from
-    if (leaving_folder[0]) {
-        for (int i = 0; i < g_entry_count; i++) {
-            if (g_entries[i].type == ENTRY_DIRECTORY &&
-                strcmp(g_entries[i].name, leaving_folder) == 0) {
-                g_cursor = i;
-                // Update scroll offset to keep cursor visible
-                if (g_cursor < g_scroll_offset) {
-                    g_scroll_offset = g_cursor;
-                } else if (g_cursor >= g_scroll_offset + VISIBLE_ITEMS) {
-                    g_scroll_offset = g_cursor - VISIBLE_ITEMS + 1;
-                }
-                break;
-            }
-        }
-    }
-
     return true;
 }
 
@@ -300,9 +478,16 @@ const FileEntry* browser_get_entry(int index) {
     return &g_entries[index];
 }
 
+const char* browser_get_entry_path(int index) {
+    if (index < 0 || index >= g_entry_count) {
+        return NULL;
+    }
+    return entry_path(index, g_entry_path, sizeof(g_entry_path));
+}
+
 const char* browser_get_selected_path(void) {
     if (g_cursor >= 0 && g_cursor < g_entry_count) {
-        return g_entries[g_cursor].full_path;
+        return entry_path(g_cursor, g_selected_path, sizeof(g_selected_path));
     }
     return NULL;
 }
@@ -345,36 +530,136 @@ int browser_navigate_to(const char *path) {
 }
 
 void browser_rescan_preserve_cursor(void) {
-    int old_cursor = g_cursor;
+    // Contents just changed (e.g. delete); don't trust the mtime alone
+    library_invalidate(g_current_path);
 
+    g_pending_cursor = g_cursor;
     scan_directory(g_current_path);
+}
+
+/**
+ * Split a path into its folder and entry name
+ * @return Entry name, or NULL if the path has no folder part
+ */
+static const char* split_path(const char *path, char *dir, size_t size) {
+    const char *last_sep = path ? strrchr(path, '/') : NULL;
+    if (!last_sep || !last_sep[1]) return NULL;
+    snprintf(dir, size, "%.*s", (int)(last_sep - path), path);
+    return last_sep + 1;
+}
+
+/**
+ * Apply one entry change to the index and, if shown, to the list
+ */
+static void apply_entry_change(const char *dir, const char *old_name, const char *new_name, bool is_dir) {
+    library_update_entry(dir, old_name, new_name, is_dir);
+    if (strcmp(dir, g_current_path) != 0) return;
+
+    // A scan in flight may or may not have seen it: list again
+    if (g_scanning) {
+        browser_rescan_preserve_cursor();
+        return;
+    }
+
+    EntryType type = is_dir ? ENTRY_DIRECTORY : ENTRY_FILE;
+    if (new_name && !is_dir && !library_is_audio_file(new_name)) new_name = NULL;
+
+    bool follow = false;
+    if (old_name) {
+        int index = find_entry(old_name, type);
+        if (index >= 0) {
+            follow = (index == g_cursor);
+            remove_entry(index);
+        }
+    }
+    if (new_name && find_entry(new_name, type) < 0) {
+        int index = insert_entry(new_name, type);
+        if (index < 0) {
+            browser_rescan_preserve_cursor();
+            return;
+        }
+        if (follow) g_cursor = index;
+    }
+    scroll_to_cursor();
+}
 
-    // Adjust cursor: if was at or past end, go to new last item
-    if (old_cursor >= g_entry_count) {
-        g_cursor = g_entry_count > 0 ? g_entry_count - 1 : 0;
+void browser_entry_added(const char *path, bool is_dir) {
+    char dir[512];
+    const char *name = split_path(path, dir, sizeof(dir));
+    if (name) apply_entry_change(dir, NULL, name, is_dir);
+}
+
+void browser_entry_removed(const char *path, bool is_dir) {
+    char dir[512];
+    const char *name = split_path(path, dir, sizeof(dir));
+    if (name) apply_entry_change(dir, name, NULL, is_dir);
+}
+
+void browser_entry_renamed(const char *old_path, const char *new_path, bool is_dir) {
+    char old_dir[512], new_dir[512];
+    const char *old_name = split_path(old_path, old_dir, sizeof(old_dir));
+    const char *new_name = split_path(new_path, new_dir, sizeof(new_dir));
+    if (!old_name || !new_name) return;
+
+    if (strcmp(old_dir, new_dir) == 0) {
+        apply_entry_change(old_dir, old_name, new_name, is_dir);
     } else {
-        g_cursor = old_cursor;
+        apply_entry_change(old_dir, old_name, NULL, is_dir);
+        apply_entry_change(new_dir, NULL, new_name, is_dir);
     }
+}
 
-    // Update scroll offset to keep cursor visible
-    if (g_cursor < g_scroll_offset) {
-        g_scroll_offset = g_cursor;
-    } else if (g_cursor >= g_scroll_offset + VISIBLE_ITEMS) {
-        g_scroll_offset = g_cursor - VISIBLE_ITEMS + 1;
+void browser_update(void) {
+    if (!g_scanning) return;
+
+    LibraryScanStatus status = library_scan_poll(g_scan_ticket,
+                                                 g_keep_listing ? skip_library_entry : add_library_entry,
+                                                 NULL);
+    if (status == LIBRARY_SCAN_RUNNING) return;
+
+    g_scanning = false;
+    g_keep_listing = false;
+    if (status != LIBRARY_SCAN_DONE) {
+        // Unreadable: keep whatever arrived
+        g_pending_name[0] = '\0';
+        g_pending_cursor = -1;
+        return;
     }
+
+    // Keep the entry the user moved to while the list was filling in
+    if (g_pending_name[0] == '\0' && g_pending_cursor < 0 &&
+        g_cursor < g_entry_count && g_entries[g_cursor].type != ENTRY_PARENT) {
+        strncpy(g_pending_name, g_entries[g_cursor].name, sizeof(g_pending_name) - 1);
+        g_pending_name[sizeof(g_pending_name) - 1] = '\0';
+    }
+
+    // Swap the read-order entries for the final sorted listing
+    clear_listing();
+    library_list_cached(g_current_path, add_library_entry, NULL, false);
+    apply_pending_selection();
+}
+
+bool browser_is_scanning(void) {
+    return g_scanning;
+}
+
+void browser_wait_for_scan(void) {
+    if (!g_scanning) return;
+    library_scan_wait(g_scan_ticket);
+    browser_update();
 }
 
 const char* browser_get_next_track_path(void) {
     // Find next audio file after current cursor
     for (int i = g_cursor + 1; i < g_entry_count; i++) {
         if (g_entries[i].type == ENTRY_FILE) {
-            return g_entries[i].full_path;
+            return entry_path(i, g_next_track_path, sizeof(g_next_track_path));
         }
     }
     // Wrap around to beginning (for repeat all mode)
     for (int i = 0; i < g_cursor; i++) {
         if (g_entries[i].type == ENTRY_FILE) {
-            return g_entries[i].full_path;
+            return entry_path(i, g_next_track_path, sizeof(g_next_track_path));
         }
     }
     return NULL;
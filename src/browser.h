@@ -17,11 +17,10 @@ typedef enum {
 } EntryType;
 
 /**
- * File entry in browser
+ * File entry in browser (full path via browser_get_entry_path)
  */
 typedef struct {
-    char name[256];
-    char full_path[512];
+    const char *name;   // Entry name (valid until the next rescan)
     EntryType type;
 } FileEntry;
 
@@ -75,6 +74,14 @@ int browser_get_count(void);
  */
 const FileEntry* browser_get_entry(int index);
 
+/**
+ * Get full path of the entry at index (built on demand)
+ * For ENTRY_PARENT this is the parent directory.
+ * @param index Entry index
+ * @return Path (valid until the next call), NULL if invalid
+ */
+const char* browser_get_entry_path(int index);
+
 /**
  * Get currently selected file path
  * @return Path to selected file, NULL if none
@@ -99,6 +106,27 @@ int browser_get_scroll_offset(void);
  */
 void browser_set_cursor(int pos);
 
+/**
+ * Show a saved listing without touching the disk (resume snapshot)
+ * Use instead of browser_init() for a fast first frame, then call
+ * browser_revalidate() once the library is up to correct it.
+ * @param base_path Root music directory path
+ * @param path Folder the listing belongs to (inside base_path)
+ * @param names count NUL-terminated entry names, back to back, in display order
+ * @param is_dir Per entry: nonzero for a folder
+ * @param count Number of entries (".." not included; added as usual)
+ * @param cursor Selected entry, not counting ".." (-1 selects "..")
+ * @return 0 on success, -1 if path isn't under base_path or out of memory
+ */
+int browser_restore(const char *base_path, const char *path, const char *names,
+                    const unsigned char *is_dir, int count, int cursor);
+
+/**
+ * Re-list the current folder from the library, keeping the shown listing
+ * until the new one is complete and the selected entry selected
+ */
+void browser_revalidate(void);
+
 /**
  * Navigate to a specific directory
  * @param path Directory path to navigate to
@@ -108,10 +136,55 @@ int browser_navigate_to(const char *path);
 
 /**
  * Rescan current directory preserving cursor position
- * Used after delete to keep cursor near same position
+ * For changes the entry functions below can't describe.
  */
 void browser_rescan_preserve_cursor(void);
 
+/**
+ * Add an entry created on disk (e.g. a finished download)
+ * Updates the library index, and the list if its folder is shown, in
+ * sorted place without listing the folder again.
+ * @param path Full path of the new file or folder
+ * @param is_dir true for a folder
+ */
+void browser_entry_added(const char *path, bool is_dir);
+
+/**
+ * Remove an entry deleted from disk
+ * The cursor stays at the same position (now on the next entry).
+ * @param path Full path of the deleted file or folder
+ * @param is_dir true for a folder
+ */
+void browser_entry_removed(const char *path, bool is_dir);
+
+/**
+ * Move an entry renamed on disk to its new sorted place
+ * The cursor follows the entry if it was on it.
+ * @param old_path Full path before the rename
+ * @param new_path Full path after the rename
+ * @param is_dir true for a folder
+ */
+void browser_entry_renamed(const char *old_path, const char *new_path, bool is_dir);
+
+/**
+ * Pick up entries from a background scan (call once per frame)
+ * Appends entries as they are read; when the scan finishes the list is
+ * replaced by the sorted listing, keeping the selected entry.
+ */
+void browser_update(void);
+
+/**
+ * Check if the current folder is still being scanned
+ * @return true while entries may still arrive
+ */
+bool browser_is_scanning(void);
+
+/**
+ * Block until the current folder is fully listed
+ * For callers that look up an entry right after browser_navigate_to().
+ */
+void browser_wait_for_scan(void);
+
 /**
  * Get the path of the next audio file after current cursor
  * Used for gapless playback preloading
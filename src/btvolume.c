@@ -0,0 +1,168 @@
+/**
+ * Bluetooth Volume Implementation
+ *
+ * amixer in --stdin mode opens the bluealsa mixer once and applies one
+ * command per line, so a volume step costs a short pipe write instead of
+ * a shell and a fresh mixer handle. Threading follows preload.c: one
+ * worker, one pending request, pthread mutex/cond.
+ */
+
+#include "btvolume.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BTVOLUME_MIXER_CMD "amixer -D bluealsa -q -s 2>/dev/null"
+#define BTVOLUME_SCONTROLS_CMD "amixer -D bluealsa scontrols 2>/dev/null"
+
+static pthread_t g_thread;
+static bool g_thread_running = false;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static bool g_shutdown = false;
+static int g_pending = -1;  // Latest requested volume, -1 = none
+
+// Worker-owned mixer state
+static FILE *g_mixer = NULL;
+static char g_control[64] = {0};  // Bluealsa mixer control name (e.g. "WH-1000XM5 A2DP")
+
+/**
+ * Get the bluealsa control name (worker thread)
+ * Format: Simple mixer control 'NAME',0
+ */
+static bool detect_control(void) {
+    g_control[0] = '\0';
+
+    FILE *fp = popen(BTVOLUME_SCONTROLS_CMD, "r");
+    if (!fp) return false;
+
+    char buf[128];
+    if (fgets(buf, sizeof(buf), fp)) {
+        // Extract name between quotes
+        char *start = strchr(buf, '\'');
+        if (start) {
+            start++;
+            char *end = strchr(start, '\'');
+            if (end) {
+                size_t len = end - start;
+                if (len < sizeof(g_control)) {
+                    strncpy(g_control, start, len);
+                    g_control[len] = '\0';
+                }
+            }
+        }
+    }
+    pclose(fp);
+
+    printf("[BTVOL] Bluealsa control='%s'\n", g_control);
+    return g_control[0] != '\0';
+}
+
+/**
+ * Close the amixer process
+ */
+static void close_mixer(void) {
+    if (g_mixer) {
+        pclose(g_mixer);
+        g_mixer = NULL;
+    }
+}
+
+/**
+ * Send one volume to the mixer, reopening it once if amixer went away
+ */
+static void apply_volume(int volume) {
+    if (!g_control[0] && !detect_control()) return;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!g_mixer) {
+            g_mixer = popen(BTVOLUME_MIXER_CMD, "w");
+            if (!g_mixer) return;
+        }
+
+        if (fprintf(g_mixer, "sset '%s' %d%%\n", g_control, volume) > 0 &&
+            fflush(g_mixer) == 0) {
+            return;
+        }
+
+        // Broken pipe: the device may have changed, look the control up again
+        close_mixer();
+        if (!detect_control()) return;
+    }
+}
+
+/**
+ * Worker: apply the latest requested volume
+ */
+static void* volume_thread_func(void *arg) {
+    (void)arg;
+
+    // A dead amixer must fail the write, not kill the player
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    detect_control();
+
+    pthread_mutex_lock(&g_mutex);
+    while (!g_shutdown) {
+        if (g_pending < 0) {
+            pthread_cond_wait(&g_cond, &g_mutex);
+            continue;
+        }
+
+        int volume = g_pending;
+        g_pending = -1;
+        pthread_mutex_unlock(&g_mutex);
+
+        apply_volume(volume);
+
+        pthread_mutex_lock(&g_mutex);
+    }
+    pthread_mutex_unlock(&g_mutex);
+
+    close_mixer();
+    return NULL;
+}
+
+int btvolume_start(void) {
+    if (g_thread_running) return 0;
+
+    g_shutdown = false;
+    g_pending = -1;
+    if (pthread_create(&g_thread, NULL, volume_thread_func, NULL) != 0) {
+        fprintf(stderr, "[BTVOL] Failed to create volume thread\n");
+        return -1;
+    }
+    g_thread_running = true;
+    return 0;
+}
+
+void btvolume_stop(void) {
+    if (!g_thread_running) return;
+
+    pthread_mutex_lock(&g_mutex);
+    g_shutdown = true;
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+    pthread_join(g_thread, NULL);
+    g_thread_running = false;
+}
+
+void btvolume_set(int volume) {
+    if (!g_thread_running) return;
+
+    if (volume < 0) volume = 0;
+    if (volume > 100) volume = 100;
+
+    pthread_mutex_lock(&g_mutex);
+    g_pending = volume;
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+}
+
+bool btvolume_is_active(void) {
+    return g_thread_running;
+}
@@ -0,0 +1,37 @@
+/**
+ * Bluetooth Volume - bluealsa mixer control off the main thread
+ *
+ * Keeps one "amixer -D bluealsa -s" process open as the mixer handle and
+ * feeds it volume commands from a worker thread. Rapid changes (holding a
+ * volume key) collapse into the latest value, so input never waits on the
+ * Bluetooth stack.
+ */
+
+#ifndef BTVOLUME_H
+#define BTVOLUME_H
+
+#include <stdbool.h>
+
+/**
+ * Start the worker (detects the bluealsa control in the background)
+ * @return 0 on success, -1 on failure
+ */
+int btvolume_start(void);
+
+/**
+ * Stop the worker and close the mixer
+ */
+void btvolume_stop(void);
+
+/**
+ * Request a volume (applied asynchronously, latest value wins)
+ * @param volume Volume from 0 to 100
+ */
+void btvolume_set(int volume);
+
+/**
+ * Check if the worker is running
+ */
+bool btvolume_is_active(void);
+
+#endif // BTVOLUME_H
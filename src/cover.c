@@ -3,6 +3,18 @@
  *
  * Uses stb_image for image loading (single-header, no dependencies).
  * Supports PNG, JPG, JPEG formats.
+ *
+ * Covers are found, decoded, downscaled and analyzed by a job on the
+ * shared pool (interactive class); the render thread only uploads the
+ * finished pixels. Downscaled covers
+ * are kept as raw RGBA thumbnails in the data directory, keyed by the
+ * cover file's path, size and mtime, so revisiting an album skips the
+ * JPEG/PNG decode entirely. A new request cancels the previous job, and
+ * results arrive through the job's completion callback on the main loop.
+ *
+ * The shown cover also keeps a much smaller copy for the resume snapshot
+ * (snapshot.h), which a launch puts up as a placeholder until the real
+ * decode for the same folder replaces it.
  */
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -13,34 +25,83 @@
 #include "stb_image.h"
 
 #include "cover.h"
+#include "state.h"
+#include "jobs.h"
+#include "memgov.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <dirent.h>
 #include <sys/stat.h>
 
 // Cover display size (scaled to fit)
 #define COVER_MAX_SIZE 150
 
+// Longest side of the decoded cover. The player draws it as a darkened
+// full-screen background, so this bounds memory and upload size without
+// visible loss.
+#define COVER_THUMB_SIZE 512
+
+// Longest side of the copy kept for the resume snapshot
+#define COVER_SNAPSHOT_SIZE 128
+
+// Thumbnail cache
+#define COVER_CACHE_DIR "covers"
+#define COVER_CACHE_MAGIC 0x42485443  // "CTHB"
+#define COVER_CACHE_VERSION 1
+#define COVER_CACHE_MAX_FILES 64
+
+/**
+ * Thumbnail file header, followed by the cover path and RGBA pixels
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int64_t src_size;
+    int64_t src_mtime;
+    uint16_t width;
+    uint16_t height;
+    uint8_t is_dark;
+    uint8_t reserved[3];
+    uint32_t path_len;
+} ThumbHeader;
+
+/**
+ * Decoded cover handed from the worker to the render thread
+ */
+typedef struct {
+    char dir[512];
+    unsigned char *pixels;      // RGBA, NULL if the folder has no cover
+    int width;
+    int height;
+    bool is_dark;
+} CoverResult;
+
 // Cached cover texture
 static SDL_Texture *g_cover_texture = NULL;
 static SDL_Renderer *g_renderer = NULL;
-static int g_cover_width = 0;
+static int g_cover_width = 0;    // Display size
 static int g_cover_height = 0;
+static int g_texture_w = 0;      // Decoded size held by the texture
+static int g_texture_h = 0;
 static char g_current_dir[512] = {0};
 static bool g_cover_is_dark = true;  // Default to dark (for safety with light text)
+static bool g_placeholder = false;   // Texture is a snapshot stand-in
+static unsigned char *g_snapshot_pixels = NULL;  // Small RGBA copy of the shown cover
+static int g_snapshot_w = 0;
+static int g_snapshot_h = 0;
+
+// Decode job (main thread only; the job itself only sees its CoverResult)
+static JobId g_job = 0;
+static CoverResult g_result;                // Ready for upload
+static bool g_result_ready = false;
 
 // Cover filename patterns to search (in priority order)
 // Reduced list - most common names only, case handled in search
 static const char *COVER_BASENAMES[] = {"cover", "folder", "album", "front", NULL};
 static const char *COVER_EXTENSIONS[] = {".jpg", ".png", ".jpeg", NULL};
 
-/**
- * Check if file exists
- */
-static bool file_exists(const char *path) {
-    struct stat st;
-    return stat(path, &st) == 0;
-}
-
 /**
  * Analyze image brightness by sampling pixels
  * Returns true if image is predominantly dark
@@ -81,42 +142,337 @@ static bool analyze_brightness(unsigned char *data, int width, int height) {
 }
 
 /**
- * Load image and create SDL texture
+ * Find the cover image in a directory
+ * @return true if found (path and st filled in)
  */
-static SDL_Texture* load_image(const char *path) {
-    int width, height, channels;
-    unsigned char *data = stbi_load(path, &width, &height, &channels, 4); // Force RGBA
+static bool find_cover_file(const char *dir_path, char *path, size_t path_size, struct stat *st) {
+    char upper_name[32];
+
+    for (int b = 0; COVER_BASENAMES[b] != NULL; b++) {
+        for (int e = 0; COVER_EXTENSIONS[e] != NULL; e++) {
+            // Try lowercase
+            snprintf(path, path_size, "%s/%s%s", dir_path, COVER_BASENAMES[b], COVER_EXTENSIONS[e]);
+            if (stat(path, st) == 0 && S_ISREG(st->st_mode)) return true;
+
+            // Try capitalized (Cover.jpg, Folder.png, etc.)
+            snprintf(upper_name, sizeof(upper_name), "%c%s", COVER_BASENAMES[b][0] - 32, COVER_BASENAMES[b] + 1);
+            snprintf(path, path_size, "%s/%s%s", dir_path, upper_name, COVER_EXTENSIONS[e]);
+            if (stat(path, st) == 0 && S_ISREG(st->st_mode)) return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Area-average downscale of an RGBA image
+ * @return New buffer (caller frees), or NULL on allocation failure
+ */
+static unsigned char* downscale_rgba(const unsigned char *src, int sw, int sh, int dw, int dh) {
+    unsigned char *dst = malloc((size_t)dw * dh * 4);
+    if (!dst) return NULL;
+
+    for (int y = 0; y < dh; y++) {
+        int y0 = y * sh / dh;
+        int y1 = (y + 1) * sh / dh;
+        if (y1 <= y0) y1 = y0 + 1;
+
+        for (int x = 0; x < dw; x++) {
+            int x0 = x * sw / dw;
+            int x1 = (x + 1) * sw / dw;
+            if (x1 <= x0) x1 = x0 + 1;
+
+            uint32_t sum[4] = {0, 0, 0, 0};
+            for (int sy = y0; sy < y1; sy++) {
+                const unsigned char *p = src + ((size_t)sy * sw + x0) * 4;
+                for (int sx = x0; sx < x1; sx++, p += 4) {
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                    sum[3] += p[3];
+                }
+            }
+
+            uint32_t count = (uint32_t)(y1 - y0) * (x1 - x0);
+            unsigned char *d = dst + ((size_t)y * dw + x) * 4;
+            d[0] = (unsigned char)(sum[0] / count);
+            d[1] = (unsigned char)(sum[1] / count);
+            d[2] = (unsigned char)(sum[2] / count);
+            d[3] = (unsigned char)(sum[3] / count);
+        }
+    }
+    return dst;
+}
+
+/**
+ * Thumbnail file for a cover image (FNV-1a of its path)
+ * @return false if there is no data directory
+ */
+static bool thumb_path(const char *cover_path, char *out, size_t size) {
+    const char *data_dir = state_get_data_dir();
+    if (!data_dir || !data_dir[0]) return false;
+
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)cover_path; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    snprintf(out, size, "%s/%s/%08x.raw", data_dir, COVER_CACHE_DIR, h);
+    return true;
+}
+
+/**
+ * Load a cached thumbnail if it matches the cover file
+ */
+static unsigned char* read_thumb(const char *cache_path, const char *cover_path,
+                                 const struct stat *st, int *w, int *h, bool *is_dark) {
+    FILE *f = fopen(cache_path, "rb");
+    if (!f) return NULL;
+
+    ThumbHeader hdr;
+    char stored_path[512];
+    unsigned char *pixels = NULL;
+
+    if (fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+        hdr.magic == COVER_CACHE_MAGIC && hdr.version == COVER_CACHE_VERSION &&
+        hdr.src_size == (int64_t)st->st_size && hdr.src_mtime == (int64_t)st->st_mtime &&
+        hdr.path_len == strlen(cover_path) && hdr.path_len < sizeof(stored_path) &&
+        hdr.width > 0 && hdr.height > 0 &&
+        fread(stored_path, 1, hdr.path_len, f) == hdr.path_len &&
+        memcmp(stored_path, cover_path, hdr.path_len) == 0) {
+
+        size_t size = (size_t)hdr.width * hdr.height * 4;
+        pixels = malloc(size);
+        if (pixels && fread(pixels, 1, size, f) != size) {
+            free(pixels);
+            pixels = NULL;
+        }
+        *w = hdr.width;
+        *h = hdr.height;
+        *is_dark = hdr.is_dark != 0;
+    }
+
+    fclose(f);
+    return pixels;
+}
+
+/**
+ * Keep the thumbnail cache bounded by dropping the oldest file
+ */
+static void trim_thumb_cache(const char *cache_dir) {
+    DIR *dir = opendir(cache_dir);
+    if (!dir) return;
+
+    int count = 0;
+    time_t oldest_time = 0;
+    char oldest[512] = {0};
+    char path[512];
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        const char *ext = strrchr(entry->d_name, '.');
+        if (!ext || strcmp(ext, ".raw") != 0) continue;
+
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+
+        count++;
+        if (!oldest[0] || st.st_mtime < oldest_time) {
+            oldest_time = st.st_mtime;
+            strncpy(oldest, path, sizeof(oldest) - 1);
+        }
+    }
+    closedir(dir);
+
+    if (count > COVER_CACHE_MAX_FILES && oldest[0]) {
+        remove(oldest);
+    }
+}
 
+/**
+ * Save a thumbnail (temp file + rename)
+ */
+static void write_thumb(const char *cache_path, const char *cover_path, const struct stat *st,
+                        const unsigned char *pixels, int w, int h, bool is_dark) {
+    char cache_dir[512];
+    strncpy(cache_dir, cache_path, sizeof(cache_dir) - 1);
+    cache_dir[sizeof(cache_dir) - 1] = '\0';
+    char *slash = strrchr(cache_dir, '/');
+    if (!slash) return;
+    *slash = '\0';
+    mkdir(cache_dir, 0755);
+
+    char tmp_path[520];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return;
+
+    ThumbHeader hdr = {0};
+    hdr.magic = COVER_CACHE_MAGIC;
+    hdr.version = COVER_CACHE_VERSION;
+    hdr.src_size = (int64_t)st->st_size;
+    hdr.src_mtime = (int64_t)st->st_mtime;
+    hdr.width = (uint16_t)w;
+    hdr.height = (uint16_t)h;
+    hdr.is_dark = is_dark ? 1 : 0;
+    hdr.path_len = (uint32_t)strlen(cover_path);
+
+    size_t size = (size_t)w * h * 4;
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+              fwrite(cover_path, 1, hdr.path_len, f) == hdr.path_len &&
+              fwrite(pixels, 1, size, f) == size;
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(tmp_path, cache_path) != 0) {
+        remove(tmp_path);
+        return;
+    }
+    trim_thumb_cache(cache_dir);
+}
+
+/**
+ * Find, decode and downscale a directory's cover (worker thread)
+ * @param out Filled in; pixels stays NULL when there is no usable cover
+ */
+static void decode_cover(const char *dir_path, CoverResult *out) {
+    char cover_path[512];
+    struct stat st;
+    if (!find_cover_file(dir_path, cover_path, sizeof(cover_path), &st)) {
+        printf("[COVER] No cover found in %s\n", dir_path);
+        return;
+    }
+
+    char cache_path[512];
+    bool cacheable = thumb_path(cover_path, cache_path, sizeof(cache_path));
+    if (cacheable) {
+        out->pixels = read_thumb(cache_path, cover_path, &st, &out->width, &out->height, &out->is_dark);
+        if (out->pixels) {
+            printf("[COVER] Thumbnail hit for %s (%dx%d)\n", cover_path, out->width, out->height);
+            return;
+        }
+    }
+
+    int width, height, channels;
+    unsigned char *data = stbi_load(cover_path, &width, &height, &channels, 4); // Force RGBA
     if (!data) {
         fprintf(stderr, "[COVER] Failed to load image: %s\n", stbi_failure_reason());
-        return NULL;
+        return;
     }
 
-    // Analyze brightness before converting to texture
-    g_cover_is_dark = analyze_brightness(data, width, height);
-
-    // Create SDL surface from raw pixel data
-    // Use SDL_PIXELFORMAT_ABGR8888 which is common on ARM/Mali GPUs
-    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom(
-        data, width, height, 32, width * 4, SDL_PIXELFORMAT_ABGR8888
-    );
+    // Downscale to the size the player can actually show
+    int tw = width, th = height;
+    if (width > COVER_THUMB_SIZE || height > COVER_THUMB_SIZE) {
+        float scale_x = (float)COVER_THUMB_SIZE / width;
+        float scale_y = (float)COVER_THUMB_SIZE / height;
+        float scale = (scale_x < scale_y) ? scale_x : scale_y;
+        tw = (int)(width * scale);
+        th = (int)(height * scale);
+        if (tw < 1) tw = 1;
+        if (th < 1) th = 1;
+    }
 
-    if (!surface) {
-        fprintf(stderr, "[COVER] Failed to create surface: %s\n", SDL_GetError());
+    unsigned char *pixels = data;
+    if (tw != width || th != height) {
+        pixels = downscale_rgba(data, width, height, tw, th);
         stbi_image_free(data);
-        return NULL;
+        data = NULL;
+        if (!pixels) return;
+    } else {
+        // Copy out of stb's allocator so the result is always free()d
+        pixels = malloc((size_t)tw * th * 4);
+        if (pixels) memcpy(pixels, data, (size_t)tw * th * 4);
+        stbi_image_free(data);
+        if (!pixels) return;
     }
 
-    // Create texture from surface
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(g_renderer, surface);
+    out->pixels = pixels;
+    out->width = tw;
+    out->height = th;
+    out->is_dark = analyze_brightness(pixels, tw, th);
 
-    SDL_FreeSurface(surface);
-    stbi_image_free(data);
+    printf("[COVER] Decoded %s (%dx%d -> %dx%d)\n", cover_path, width, height, tw, th);
 
-    if (!texture) {
+    if (cacheable) {
+        write_thumb(cache_path, cover_path, &st, pixels, tw, th, out->is_dark);
+    }
+}
+
+/**
+ * Job: decode the cover of one directory
+ */
+static void cover_job(void *arg, const volatile bool *cancel) {
+    CoverResult *result = (CoverResult *)arg;
+    if (!*cancel) decode_cover(result->dir, result);
+}
+
+/**
+ * Job completion (main loop): keep the result if it is still wanted
+ */
+static void cover_job_done(void *arg, bool cancelled) {
+    CoverResult *result = (CoverResult *)arg;
+
+    if (cancelled || !g_renderer || strcmp(result->dir, g_current_dir) != 0) {
+        // Superseded while decoding
+        free(result->pixels);
+    } else {
+        free(g_result.pixels);
+        g_result = *result;
+        g_result_ready = true;
+        g_job = 0;
+    }
+    free(result);
+}
+
+/**
+ * Destroy the texture and reset display state
+ */
+static void release_texture(void) {
+    if (g_cover_texture) {
+        SDL_DestroyTexture(g_cover_texture);
+        g_cover_texture = NULL;
+    }
+    free(g_snapshot_pixels);
+    g_snapshot_pixels = NULL;
+    g_snapshot_w = 0;
+    g_snapshot_h = 0;
+    g_cover_width = 0;
+    g_cover_height = 0;
+    g_texture_w = 0;
+    g_texture_h = 0;
+    g_cover_is_dark = true;  // Reset to default
+}
+
+/**
+ * Create a texture from RGBA pixels
+ * @return Texture, or NULL on failure (logged)
+ */
+static SDL_Texture* upload_pixels(const unsigned char *pixels, int width, int height) {
+    // Use SDL_PIXELFORMAT_ABGR8888 which matches RGBA bytes on ARM/Mali GPUs
+    SDL_Texture *texture = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_ABGR8888,
+                                             SDL_TEXTUREACCESS_STATIC, width, height);
+    if (!texture || SDL_UpdateTexture(texture, NULL, pixels, width * 4) != 0) {
         fprintf(stderr, "[COVER] Failed to create texture: %s\n", SDL_GetError());
+        if (texture) SDL_DestroyTexture(texture);
         return NULL;
     }
+    return texture;
+}
+
+/**
+ * Make the uploaded texture current, with its snapshot copy and display size
+ * @param snapshot Copy for the snapshot (ownership taken), or NULL
+ */
+static void show_texture(SDL_Texture *texture, int width, int height, bool is_dark,
+                         unsigned char *snapshot, int snapshot_w, int snapshot_h) {
+    release_texture();
+    g_cover_texture = texture;
+    if (SDL_QueryTexture(texture, NULL, NULL, &g_texture_w, &g_texture_h) != 0) {
+        g_texture_w = g_texture_h = 0;
+    }
+    g_cover_is_dark = is_dark;
+    g_snapshot_pixels = snapshot;
+    g_snapshot_w = snapshot ? snapshot_w : 0;
+    g_snapshot_h = snapshot ? snapshot_h : 0;
 
     // Calculate scaled dimensions (maintain aspect ratio)
     float scale = 1.0f;
@@ -125,13 +481,17 @@ static SDL_Texture* load_image(const char *path) {
         float scale_y = (float)COVER_MAX_SIZE / height;
         scale = (scale_x < scale_y) ? scale_x : scale_y;
     }
-
     g_cover_width = (int)(width * scale);
     g_cover_height = (int)(height * scale);
+}
 
-    printf("[COVER] Loaded %s (%dx%d -> %dx%d)\n", path, width, height, g_cover_width, g_cover_height);
-
-    return texture;
+/**
+ * Memory held by the cover texture and a result waiting for upload
+ */
+static size_t cover_usage(void) {
+    size_t bytes = (size_t)g_texture_w * g_texture_h * 4 + (size_t)g_snapshot_w * g_snapshot_h * 4;
+    if (g_result_ready && g_result.pixels) bytes += (size_t)g_result.width * g_result.height * 4;
+    return bytes;
 }
 
 int cover_init(SDL_Renderer *renderer) {
@@ -140,10 +500,20 @@ int cover_init(SDL_Renderer *renderer) {
     g_cover_width = 0;
     g_cover_height = 0;
     g_current_dir[0] = '\0';
+    g_job = 0;
+    memgov_register("cover", 0, cover_usage, NULL);
     return 0;
 }
 
 void cover_cleanup(void) {
+    // A decode in flight is freed by its completion callback
+    jobs_cancel(g_job);
+    g_job = 0;
+
+    free(g_result.pixels);
+    g_result.pixels = NULL;
+    g_result_ready = false;
+
     cover_clear();
     g_renderer = NULL;
 }
@@ -153,43 +523,110 @@ bool cover_load(const char *dir_path) {
         return false;
     }
 
-    // Skip if same directory (already cached)
-    if (g_current_dir[0] && strcmp(g_current_dir, dir_path) == 0 && g_cover_texture) {
-        return true;  // Already loaded
+    // Skip if same directory (loaded or on its way); a snapshot
+    // placeholder stays up until its real decode lands
+    bool same_dir = g_current_dir[0] && strcmp(g_current_dir, dir_path) == 0;
+    if (same_dir && (!g_placeholder || g_job != 0)) {
+        return true;
     }
 
-    // Clear previous cover
-    cover_clear();
+    if (!same_dir) {
+        // Clear previous cover
+        cover_clear();
 
-    // Store current directory
-    strncpy(g_current_dir, dir_path, sizeof(g_current_dir) - 1);
-    g_current_dir[sizeof(g_current_dir) - 1] = '\0';
+        // Store current directory
+        strncpy(g_current_dir, dir_path, sizeof(g_current_dir) - 1);
+        g_current_dir[sizeof(g_current_dir) - 1] = '\0';
+    }
 
-    // Search for cover files (optimized: basename x extension matrix)
-    char path[512];
-    char upper_name[32];
+    CoverResult *request = (CoverResult *)calloc(1, sizeof(CoverResult));
+    if (!request) return false;
+    strncpy(request->dir, g_current_dir, sizeof(request->dir) - 1);
 
-    for (int b = 0; COVER_BASENAMES[b] != NULL; b++) {
-        for (int e = 0; COVER_EXTENSIONS[e] != NULL; e++) {
-            // Try lowercase
-            snprintf(path, sizeof(path), "%s/%s%s", dir_path, COVER_BASENAMES[b], COVER_EXTENSIONS[e]);
-            if (file_exists(path)) {
-                g_cover_texture = load_image(path);
-                if (g_cover_texture) return true;
-            }
+    // Only the latest directory matters
+    jobs_cancel(g_job);
+    g_job = jobs_submit(JOB_CLASS_INTERACTIVE, "cover_decode", cover_job, cover_job_done, request);
+    if (g_job == 0) {
+        free(request);
+        return false;
+    }
+    return true;
+}
 
-            // Try capitalized (Cover.jpg, Folder.png, etc.)
-            snprintf(upper_name, sizeof(upper_name), "%c%s", COVER_BASENAMES[b][0] - 32, COVER_BASENAMES[b] + 1);
-            snprintf(path, sizeof(path), "%s/%s%s", dir_path, upper_name, COVER_EXTENSIONS[e]);
-            if (file_exists(path)) {
-                g_cover_texture = load_image(path);
-                if (g_cover_texture) return true;
-            }
-        }
+bool cover_poll(void) {
+    CoverResult result;
+
+    if (!g_result_ready) return false;
+    result = g_result;
+    g_result.pixels = NULL;
+    g_result_ready = false;
+
+    // Stale (directory changed since the request)
+    if (strcmp(result.dir, g_current_dir) != 0) {
+        free(result.pixels);
+        return false;
     }
 
-    printf("[COVER] No cover found in %s\n", dir_path);
-    return false;
+    // Folder has no cover (any more): drop a snapshot placeholder
+    if (!result.pixels) {
+        if (!g_placeholder) return false;
+        g_placeholder = false;
+        release_texture();
+        return true;
+    }
+
+    SDL_Texture *texture = upload_pixels(result.pixels, result.width, result.height);
+    if (!texture) {
+        free(result.pixels);
+        return false;
+    }
+
+    // Small copy for the resume snapshot (none is fine)
+    int sw = result.width, sh = result.height;
+    if (sw > COVER_SNAPSHOT_SIZE || sh > COVER_SNAPSHOT_SIZE) {
+        float scale_x = (float)COVER_SNAPSHOT_SIZE / sw;
+        float scale_y = (float)COVER_SNAPSHOT_SIZE / sh;
+        float scale = (scale_x < scale_y) ? scale_x : scale_y;
+        sw = (int)(sw * scale);
+        sh = (int)(sh * scale);
+        if (sw < 1) sw = 1;
+        if (sh < 1) sh = 1;
+    }
+    unsigned char *snapshot = downscale_rgba(result.pixels, result.width, result.height, sw, sh);
+    free(result.pixels);
+
+    g_placeholder = false;
+    show_texture(texture, result.width, result.height, result.is_dark, snapshot, sw, sh);
+    return true;
+}
+
+bool cover_get_thumbnail(const unsigned char **pixels, int *w, int *h, bool *is_dark,
+                         const char **dir_path) {
+    if (!g_snapshot_pixels || !g_current_dir[0]) return false;
+    *pixels = g_snapshot_pixels;
+    *w = g_snapshot_w;
+    *h = g_snapshot_h;
+    *is_dark = g_cover_is_dark;
+    *dir_path = g_current_dir;
+    return true;
+}
+
+bool cover_show_thumbnail(const char *dir_path, const unsigned char *pixels, int w, int h,
+                          bool is_dark) {
+    if (!dir_path || !pixels || w <= 0 || h <= 0 || !g_renderer) return false;
+
+    SDL_Texture *texture = upload_pixels(pixels, w, h);
+    if (!texture) return false;
+    unsigned char *snapshot = malloc((size_t)w * h * 4);
+    if (snapshot) memcpy(snapshot, pixels, (size_t)w * h * 4);
+
+    // Sized like the full cover would be, so the layout doesn't shift
+    cover_clear();
+    show_texture(texture, COVER_THUMB_SIZE, COVER_THUMB_SIZE * h / w, is_dark, snapshot, w, h);
+    strncpy(g_current_dir, dir_path, sizeof(g_current_dir) - 1);
+    g_current_dir[sizeof(g_current_dir) - 1] = '\0';
+    g_placeholder = true;
+    return true;
 }
 
 SDL_Texture* cover_get_texture(void) {
@@ -206,14 +643,9 @@ bool cover_is_loaded(void) {
 }
 
 void cover_clear(void) {
-    if (g_cover_texture) {
-        SDL_DestroyTexture(g_cover_texture);
-        g_cover_texture = NULL;
-    }
-    g_cover_width = 0;
-    g_cover_height = 0;
+    release_texture();
     g_current_dir[0] = '\0';
-    g_cover_is_dark = true;  // Reset to default
+    g_placeholder = false;
 }
 
 bool cover_is_dark(void) {
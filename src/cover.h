@@ -2,7 +2,8 @@
  * Cover Art - Album cover display for music player
  *
  * Loads and displays album cover images (cover.png/jpg) from
- * the directory containing the current track.
+ * the directory containing the current track. Decoding runs as a job on
+ * the shared pool; cover_poll() uploads the result.
  */
 
 #ifndef COVER_H
@@ -24,13 +25,47 @@ int cover_init(SDL_Renderer *renderer);
 void cover_cleanup(void);
 
 /**
- * Load cover art from directory
+ * Request cover art from directory (asynchronous)
  * Searches for cover.png, cover.jpg, folder.*, album.*, front.*
+ * The previous cover is cleared at once; the new one appears after a
+ * later cover_poll().
  * @param dir_path Directory to search for cover art
- * @return true if cover was found and loaded
+ * @return true if the cover was requested (or is already current)
  */
 bool cover_load(const char *dir_path);
 
+/**
+ * Upload a finished decode to a texture (call from the render thread)
+ * @return true if a new cover became available (redraw needed)
+ */
+bool cover_poll(void);
+
+/**
+ * Get the small copy of the shown cover (for the resume snapshot)
+ * @param pixels Output: RGBA pixels (valid until the cover changes)
+ * @param w Output width
+ * @param h Output height
+ * @param is_dark Output brightness flag
+ * @param dir_path Output: folder the cover belongs to
+ * @return false if no cover is shown
+ */
+bool cover_get_thumbnail(const unsigned char **pixels, int *w, int *h, bool *is_dark,
+                         const char **dir_path);
+
+/**
+ * Show a snapshot thumbnail until the folder's real cover is decoded
+ * The next cover_load() of the same folder keeps it up and replaces it
+ * when the decode finishes (or drops it if the folder has no cover now).
+ * @param dir_path Folder the thumbnail belongs to
+ * @param pixels RGBA pixels (copied)
+ * @param w Width
+ * @param h Height
+ * @param is_dark Brightness flag saved with it
+ * @return true if shown
+ */
+bool cover_show_thumbnail(const char *dir_path, const unsigned char *pixels, int w, int h,
+                          bool is_dark);
+
 /**
  * Get current cover art texture
  * @return SDL_Texture pointer, or NULL if no cover loaded
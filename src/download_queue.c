@@ -1,35 +1,54 @@
 /**
  * Background Download Queue Implementation
  *
- * Uses pthread for background downloads. Downloads run sequentially
- * in a worker thread while the main thread continues UI updates.
+ * A pool of DLQUEUE_WORKERS pthreads takes items in queue order. Each
+ * item holds a network slot while yt-dlp fetches the native audio and a
+ * CPU slot while ffmpeg transcodes it, so a download and a transcode run
+ * side by side. In native mode an Opus stream is only remuxed. Slot counts shrink while music plays or in BATTERY mode.
+ * The queue is written through persist.c on every change.
  */
 
 #include "download_queue.h"
 #include "youtube.h"
+#include "state.h"
+#include "persist.h"
+#include "cJSON.h"
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+// Saved queue (in the data dir)
+#define QUEUE_FILENAME "download_queue.json"
+#define QUEUE_MAX_FILE (512 * 1024)
+
 // Queue storage
 static DownloadItem g_queue[DOWNLOAD_QUEUE_MAX];
 static int g_queue_count = 0;
-static int g_current_index = -1;  // Index of currently downloading item
+static int g_next_id = 1;
 
 // Thread synchronization
-static pthread_t g_worker_thread;
+static pthread_t g_workers[DLQUEUE_WORKERS];
+static int g_worker_count = 0;
 static pthread_mutex_t g_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t g_queue_cond = PTHREAD_COND_INITIALIZER;
-static bool g_worker_running = false;
 static bool g_shutdown_requested = false;
 
+// Scheduling (slot limits follow dlqueue_set_conditions)
+static int g_net_active = 0;
+static int g_cpu_active = 0;
+static int g_net_limit = DLQUEUE_NET_SLOTS;
+static int g_cpu_limit = DLQUEUE_CPU_SLOTS;
+static bool g_low_priority = false;
+static bool g_keep_native = false;      // Remux Opus instead of transcoding
+
 // Completion tracking
 static bool g_has_new_completions = false;
 static char g_last_completed_path[512] = {0};
 
-// Current download progress (updated from worker thread)
-static int g_current_progress = 0;
+// Saved queue path
+static char g_queue_path[512] = {0};
 
 // View state (cursor/scroll for queue list view)
 static int g_view_cursor = 0;
@@ -37,112 +56,267 @@ static int g_view_scroll = 0;
 #define VIEW_VISIBLE_ITEMS 8
 
 /**
- * Progress callback for youtube_download
- * Called from worker thread
+ * Check if an item is being worked on
  */
-static bool worker_progress_callback(int percent, const char *status) {
-    (void)status;  // Unused for now
+static bool is_active(DownloadStatus status) {
+    return status == DL_DOWNLOADING || status == DL_CONVERTING;
+}
 
-    pthread_mutex_lock(&g_queue_mutex);
-    g_current_progress = percent;
-    if (g_current_index >= 0 && g_current_index < g_queue_count) {
-        g_queue[g_current_index].progress = percent;
+/**
+ * Find an item by id (caller holds g_queue_mutex)
+ */
+static DownloadItem* find_item(int id) {
+    for (int i = 0; i < g_queue_count; i++) {
+        if (g_queue[i].id == id) return &g_queue[i];
+    }
+    return NULL;
+}
+
+/**
+ * Save the queue (caller holds g_queue_mutex)
+ * Active items are saved as pending so they restart next launch.
+ */
+static void save_queue(void) {
+    if (g_queue_path[0] == '\0') return;
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *items = cJSON_AddArrayToObject(root, "items");
+    for (int i = 0; i < g_queue_count; i++) {
+        const DownloadItem *item = &g_queue[i];
+        cJSON *obj = cJSON_CreateObject();
+        DownloadStatus status = is_active(item->status) ? DL_PENDING : item->status;
+        cJSON_AddStringToObject(obj, "video_id", item->video_id);
+        cJSON_AddStringToObject(obj, "title", item->title);
+        cJSON_AddStringToObject(obj, "channel", item->channel);
+        cJSON_AddNumberToObject(obj, "status", status);
+        if (status == DL_FAILED) cJSON_AddStringToObject(obj, "error", item->error);
+        if (status == DL_COMPLETE) cJSON_AddStringToObject(obj, "filepath", item->filepath);
+        cJSON_AddItemToArray(items, obj);
+    }
+
+    char *json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json) return;
+
+    persist_write(g_queue_path, json, strlen(json));
+    free(json);
+}
+
+/**
+ * Copy a JSON string field into a fixed buffer
+ */
+static void copy_field(cJSON *obj, const char *name, char *dst, size_t dst_size) {
+    cJSON *v = cJSON_GetObjectItem(obj, name);
+    if (v && cJSON_IsString(v)) {
+        strncpy(dst, v->valuestring, dst_size - 1);
+        dst[dst_size - 1] = '\0';
+    }
+}
+
+/**
+ * Restore the saved queue (before the workers start)
+ */
+static void load_queue(void) {
+    FILE *f = fopen(g_queue_path, "r");
+    if (!f) return;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0 || size > QUEUE_MAX_FILE) {
+        fclose(f);
+        return;
     }
+
+    char *json = malloc(size + 1);
+    if (!json) {
+        fclose(f);
+        return;
+    }
+    size_t read_size = fread(json, 1, size, f);
+    fclose(f);
+    json[read_size] = '\0';
+
+    cJSON *root = cJSON_Parse(json);
+    free(json);
+    if (!root) return;
+
+    int pending = 0;
+    cJSON *items = cJSON_GetObjectItem(root, "items");
+    cJSON *obj;
+    cJSON_ArrayForEach(obj, items) {
+        if (g_queue_count >= DOWNLOAD_QUEUE_MAX) break;
+
+        DownloadItem *item = &g_queue[g_queue_count];
+        memset(item, 0, sizeof(DownloadItem));
+        copy_field(obj, "video_id", item->video_id, sizeof(item->video_id));
+        copy_field(obj, "title", item->title, sizeof(item->title));
+        copy_field(obj, "channel", item->channel, sizeof(item->channel));
+        copy_field(obj, "error", item->error, sizeof(item->error));
+        copy_field(obj, "filepath", item->filepath, sizeof(item->filepath));
+        if (item->video_id[0] == '\0') continue;
+
+        cJSON *status = cJSON_GetObjectItem(obj, "status");
+        item->status = cJSON_IsNumber(status) ? (DownloadStatus)status->valueint : DL_PENDING;
+        if (item->status != DL_COMPLETE && item->status != DL_FAILED) {
+            item->status = DL_PENDING;
+            pending++;
+        }
+        if (item->status == DL_COMPLETE) item->progress = 100;
+        item->id = g_next_id++;
+        g_queue_count++;
+    }
+    cJSON_Delete(root);
+
+    printf("[DLQUEUE] Restored %d items (%d pending)\n", g_queue_count, pending);
+}
+
+/**
+ * Progress callback for the fetch/convert phases
+ * Called from worker threads; ctx points at the item id
+ */
+static bool worker_progress_callback(int percent, void *ctx) {
+    int id = *(int *)ctx;
+
+    pthread_mutex_lock(&g_queue_mutex);
+    DownloadItem *item = find_item(id);
+    bool keep_going = item && !item->cancel && !g_shutdown_requested;
+    if (item) item->progress = percent;
     pthread_mutex_unlock(&g_queue_mutex);
 
-    // Check if shutdown requested
-    return !g_shutdown_requested;
+    return keep_going;
+}
+
+/**
+ * Record the outcome of a job (caller holds g_queue_mutex)
+ */
+static void finish_item(int id, const char *path, const char *error) {
+    DownloadItem *item = find_item(id);
+    if (!item) return;
+
+    if (path) {
+        item->status = DL_COMPLETE;
+        item->progress = 100;
+        strncpy(item->filepath, path, sizeof(item->filepath) - 1);
+        strncpy(g_last_completed_path, path, sizeof(g_last_completed_path) - 1);
+        g_has_new_completions = true;
+        printf("[DLQUEUE] Download complete: %s\n", path);
+    } else if (g_shutdown_requested && !item->cancel) {
+        // Interrupted by exit: saved as pending, resumes next launch
+        item->status = DL_PENDING;
+        item->progress = 0;
+    } else {
+        item->status = DL_FAILED;
+        snprintf(item->error, sizeof(item->error), "%s",
+                 item->cancel ? "Cancelled by user" : (error && error[0] ? error : "Unknown error"));
+        printf("[DLQUEUE] Download failed: %s\n", item->error);
+    }
+    save_queue();
 }
 
 /**
  * Worker thread function
- * Processes downloads from queue sequentially
+ * Takes the oldest pending item whenever a network slot is free
  */
 static void* worker_thread_func(void *arg) {
     (void)arg;
 
-    printf("[DLQUEUE] Worker thread started\n");
-
-    while (1) {
-        pthread_mutex_lock(&g_queue_mutex);
+    pthread_mutex_lock(&g_queue_mutex);
 
-        // Wait for work or shutdown
-        while (!g_shutdown_requested) {
-            // Find next pending item
-            int next_pending = -1;
+    while (!g_shutdown_requested) {
+        // Find next pending item if a network slot is free
+        DownloadItem *item = NULL;
+        if (g_net_active < g_net_limit) {
             for (int i = 0; i < g_queue_count; i++) {
                 if (g_queue[i].status == DL_PENDING) {
-                    next_pending = i;
+                    item = &g_queue[i];
                     break;
                 }
             }
-
-            if (next_pending >= 0) {
-                // Found work
-                g_current_index = next_pending;
-                g_queue[next_pending].status = DL_DOWNLOADING;
-                g_queue[next_pending].progress = 0;
-                g_current_progress = 0;
-                break;
-            }
-
-            // No work, wait for signal
-            pthread_cond_wait(&g_queue_cond, &g_queue_mutex);
         }
 
-        if (g_shutdown_requested) {
-            pthread_mutex_unlock(&g_queue_mutex);
-            break;
+        if (!item) {
+            pthread_cond_wait(&g_queue_cond, &g_queue_mutex);
+            continue;
         }
 
-        // Get item info (copy to local vars while holding lock)
+        // Claim it and copy what the job needs while holding the lock
+        int id = item->id;
         char video_id[16];
         char title[256];
-        strncpy(video_id, g_queue[g_current_index].video_id, sizeof(video_id) - 1);
-        video_id[sizeof(video_id) - 1] = '\0';
-        strncpy(title, g_queue[g_current_index].title, sizeof(title) - 1);
-        title[sizeof(title) - 1] = '\0';
+        memcpy(video_id, item->video_id, sizeof(video_id));
+        memcpy(title, item->title, sizeof(title));
+        item->status = DL_DOWNLOADING;
+        item->progress = 0;
+        item->cancel = false;
+        bool keep_native = g_keep_native;
+        g_net_active++;
+        pthread_mutex_unlock(&g_queue_mutex);
 
         printf("[DLQUEUE] Starting download: %s - %s\n", video_id, title);
 
-        pthread_mutex_unlock(&g_queue_mutex);
-
-        // Perform download (blocking, but in worker thread)
-        const char *path = youtube_download(video_id, title, worker_progress_callback);
+        char src_path[512];
+        char final_path[512];
+        char error[256] = {0};
+        bool fetched = false;
+        bool done = youtube_find_downloaded(video_id, title, final_path, sizeof(final_path));
+        if (!done) {
+            fetched = youtube_fetch_audio(video_id, title, keep_native, src_path, sizeof(src_path),
+                                          error, sizeof(error), worker_progress_callback, &id);
+        }
 
-        // Update item status
         pthread_mutex_lock(&g_queue_mutex);
+        g_net_active--;
+        pthread_cond_broadcast(&g_queue_cond);  // Network slot free
+
+        if (fetched && keep_native) {
+            // Remuxing only copies packets, so it doesn't wait for a CPU slot
+            item = find_item(id);
+            if (item && !item->cancel && !g_shutdown_requested) {
+                item->status = DL_CONVERTING;
+                item->progress = 0;
+                pthread_mutex_unlock(&g_queue_mutex);
+
+                done = youtube_remux_native(src_path, video_id, title,
+                                            final_path, sizeof(final_path),
+                                            error, sizeof(error), worker_progress_callback, &id);
+
+                pthread_mutex_lock(&g_queue_mutex);
+                if (!done) printf("[DLQUEUE] %s, converting to MP3\n", error);
+            }
+        }
 
-        if (g_current_index >= 0 && g_current_index < g_queue_count) {
-            if (path) {
-                g_queue[g_current_index].status = DL_COMPLETE;
-                g_queue[g_current_index].progress = 100;
-                strncpy(g_queue[g_current_index].filepath, path,
-                        sizeof(g_queue[g_current_index].filepath) - 1);
-                strncpy(g_last_completed_path, path, sizeof(g_last_completed_path) - 1);
-                g_has_new_completions = true;
-                printf("[DLQUEUE] Download complete: %s\n", path);
+        if (fetched && !done) {
+            // Wait for a CPU slot, then transcode
+            while (!g_shutdown_requested && g_cpu_active >= g_cpu_limit &&
+                   (item = find_item(id)) && !item->cancel) {
+                pthread_cond_wait(&g_queue_cond, &g_queue_mutex);
+            }
+            item = find_item(id);
+            if (!g_shutdown_requested && item && !item->cancel) {
+                item->status = DL_CONVERTING;
+                item->progress = 0;
+                g_cpu_active++;
+                bool low_priority = g_low_priority;
+                pthread_mutex_unlock(&g_queue_mutex);
+
+                done = youtube_convert_mp3(src_path, video_id, title, low_priority,
+                                           final_path, sizeof(final_path),
+                                           error, sizeof(error), worker_progress_callback, &id);
+
+                pthread_mutex_lock(&g_queue_mutex);
+                g_cpu_active--;
+                pthread_cond_broadcast(&g_queue_cond);  // CPU slot free
             } else {
-                g_queue[g_current_index].status = DL_FAILED;
-                const char *err = youtube_get_error();
-                if (err) {
-                    strncpy(g_queue[g_current_index].error, err,
-                            sizeof(g_queue[g_current_index].error) - 1);
-                }
-                printf("[DLQUEUE] Download failed: %s\n", err ? err : "Unknown error");
+                snprintf(error, sizeof(error), "Download cancelled");
             }
+            if (!done) unlink(src_path);
         }
 
-        g_current_index = -1;
-        g_current_progress = 0;
-
-        pthread_mutex_unlock(&g_queue_mutex);
-
-        // Small delay between downloads
-        usleep(100000);  // 100ms
+        finish_item(id, done ? final_path : NULL, error);
     }
 
-    printf("[DLQUEUE] Worker thread exiting\n");
+    pthread_mutex_unlock(&g_queue_mutex);
     return NULL;
 }
 
@@ -152,56 +326,83 @@ void dlqueue_init(void) {
     // Clear queue
     memset(g_queue, 0, sizeof(g_queue));
     g_queue_count = 0;
-    g_current_index = -1;
-    g_current_progress = 0;
     g_has_new_completions = false;
     g_last_completed_path[0] = '\0';
     g_shutdown_requested = false;
+    g_net_active = 0;
+    g_cpu_active = 0;
+
+    const char *data_dir = state_get_data_dir();
+    if (data_dir && data_dir[0]) {
+        snprintf(g_queue_path, sizeof(g_queue_path), "%s/%s", data_dir, QUEUE_FILENAME);
+        load_queue();
+    }
 
     pthread_mutex_unlock(&g_queue_mutex);
 
-    // Start worker thread
-    if (!g_worker_running) {
-        if (pthread_create(&g_worker_thread, NULL, worker_thread_func, NULL) == 0) {
-            g_worker_running = true;
-            printf("[DLQUEUE] Initialized with worker thread\n");
-        } else {
+    // Start worker pool
+    while (g_worker_count < DLQUEUE_WORKERS) {
+        if (pthread_create(&g_workers[g_worker_count], NULL, worker_thread_func, NULL) != 0) {
             fprintf(stderr, "[DLQUEUE] Failed to create worker thread\n");
+            break;
         }
+        g_worker_count++;
     }
+    printf("[DLQUEUE] Initialized with %d workers\n", g_worker_count);
 }
 
 void dlqueue_shutdown(void) {
-    if (!g_worker_running) return;
+    if (g_worker_count == 0) return;
 
     printf("[DLQUEUE] Shutting down...\n");
 
     pthread_mutex_lock(&g_queue_mutex);
     g_shutdown_requested = true;
-    pthread_cond_signal(&g_queue_cond);
+    pthread_cond_broadcast(&g_queue_cond);
     pthread_mutex_unlock(&g_queue_mutex);
 
-    pthread_join(g_worker_thread, NULL);
-    g_worker_running = false;
+    for (int i = 0; i < g_worker_count; i++) {
+        pthread_join(g_workers[i], NULL);
+    }
+    g_worker_count = 0;
+
+    pthread_mutex_lock(&g_queue_mutex);
+    save_queue();
+    pthread_mutex_unlock(&g_queue_mutex);
 
     printf("[DLQUEUE] Shutdown complete\n");
 }
 
+void dlqueue_set_conditions(bool playback_active, bool battery_mode) {
+    bool throttled = playback_active || battery_mode;
+    int net_limit = battery_mode ? DLQUEUE_THROTTLED_NET_SLOTS : DLQUEUE_NET_SLOTS;
+    int cpu_limit = throttled ? DLQUEUE_THROTTLED_CPU_SLOTS : DLQUEUE_CPU_SLOTS;
+
+    pthread_mutex_lock(&g_queue_mutex);
+    if (net_limit != g_net_limit || cpu_limit != g_cpu_limit) {
+        // Raised limits may unblock a worker; lowered ones apply to new phases
+        g_net_limit = net_limit;
+        g_cpu_limit = cpu_limit;
+        pthread_cond_broadcast(&g_queue_cond);
+    }
+    g_low_priority = throttled;
+    pthread_mutex_unlock(&g_queue_mutex);
+}
+
+void dlqueue_set_keep_native(bool keep_native) {
+    pthread_mutex_lock(&g_queue_mutex);
+    g_keep_native = keep_native;
+    pthread_mutex_unlock(&g_queue_mutex);
+}
+
 bool dlqueue_add(const char *video_id, const char *title, const char *channel) {
     if (!video_id || !title) return false;
 
     pthread_mutex_lock(&g_queue_mutex);
 
-    // Check if queue full
-    if (g_queue_count >= DOWNLOAD_QUEUE_MAX) {
-        pthread_mutex_unlock(&g_queue_mutex);
-        printf("[DLQUEUE] Queue full, cannot add: %s\n", title);
-        return false;
-    }
-
-    // Check for duplicates (same video_id pending or downloading)
+    // Check for duplicates (same video_id pending or active)
     for (int i = 0; i < g_queue_count; i++) {
-        if ((g_queue[i].status == DL_PENDING || g_queue[i].status == DL_DOWNLOADING) &&
+        if ((g_queue[i].status == DL_PENDING || is_active(g_queue[i].status)) &&
             strcmp(g_queue[i].video_id, video_id) == 0) {
             pthread_mutex_unlock(&g_queue_mutex);
             printf("[DLQUEUE] Already in queue: %s\n", video_id);
@@ -209,6 +410,22 @@ bool dlqueue_add(const char *video_id, const char *title, const char *channel) {
         }
     }
 
+    // Full: make room by dropping the oldest finished item
+    if (g_queue_count >= DOWNLOAD_QUEUE_MAX) {
+        int drop = -1;
+        for (int i = 0; i < g_queue_count && drop < 0; i++) {
+            if (g_queue[i].status == DL_COMPLETE || g_queue[i].status == DL_FAILED) drop = i;
+        }
+        if (drop < 0) {
+            pthread_mutex_unlock(&g_queue_mutex);
+            printf("[DLQUEUE] Queue full, cannot add: %s\n", title);
+            return false;
+        }
+        memmove(&g_queue[drop], &g_queue[drop + 1],
+                (g_queue_count - drop - 1) * sizeof(DownloadItem));
+        g_queue_count--;
+    }
+
     // Add to queue
     DownloadItem *item = &g_queue[g_queue_count];
     memset(item, 0, sizeof(DownloadItem));
@@ -219,14 +436,16 @@ bool dlqueue_add(const char *video_id, const char *title, const char *channel) {
     }
     item->status = DL_PENDING;
     item->progress = 0;
+    item->id = g_next_id++;
 
     g_queue_count++;
+    save_queue();
 
     printf("[DLQUEUE] Added to queue (%d items): %s - %s\n",
            g_queue_count, video_id, title);
 
-    // Signal worker thread
-    pthread_cond_signal(&g_queue_cond);
+    // Signal a worker
+    pthread_cond_broadcast(&g_queue_cond);
 
     pthread_mutex_unlock(&g_queue_mutex);
 
@@ -238,7 +457,7 @@ int dlqueue_pending_count(void) {
 
     int count = 0;
     for (int i = 0; i < g_queue_count; i++) {
-        if (g_queue[i].status == DL_PENDING || g_queue[i].status == DL_DOWNLOADING) {
+        if (g_queue[i].status == DL_PENDING || is_active(g_queue[i].status)) {
             count++;
         }
     }
@@ -254,16 +473,27 @@ int dlqueue_total_count(void) {
     return count;
 }
 
+/**
+ * Oldest active item (caller holds g_queue_mutex)
+ */
+static const DownloadItem* first_active(void) {
+    for (int i = 0; i < g_queue_count; i++) {
+        if (is_active(g_queue[i].status)) return &g_queue[i];
+    }
+    return NULL;
+}
+
 bool dlqueue_is_downloading(void) {
     pthread_mutex_lock(&g_queue_mutex);
-    bool downloading = (g_current_index >= 0);
+    bool downloading = first_active() != NULL;
     pthread_mutex_unlock(&g_queue_mutex);
     return downloading;
 }
 
 int dlqueue_get_progress(void) {
     pthread_mutex_lock(&g_queue_mutex);
-    int progress = g_current_index >= 0 ? g_current_progress : -1;
+    const DownloadItem *item = first_active();
+    int progress = item ? item->progress : -1;
     pthread_mutex_unlock(&g_queue_mutex);
     return progress;
 }
@@ -273,8 +503,9 @@ const char* dlqueue_get_current_title(void) {
 
     pthread_mutex_lock(&g_queue_mutex);
 
-    if (g_current_index >= 0 && g_current_index < g_queue_count) {
-        strncpy(title, g_queue[g_current_index].title, sizeof(title) - 1);
+    const DownloadItem *item = first_active();
+    if (item) {
+        strncpy(title, item->title, sizeof(title) - 1);
         title[sizeof(title) - 1] = '\0';
         pthread_mutex_unlock(&g_queue_mutex);
         return title;
@@ -302,10 +533,11 @@ void dlqueue_clear_completed(void) {
     pthread_mutex_lock(&g_queue_mutex);
 
     // Compact queue, removing completed/failed items
+    // (workers find their item by id, so moving active ones is fine)
     int write_idx = 0;
     for (int read_idx = 0; read_idx < g_queue_count; read_idx++) {
         if (g_queue[read_idx].status == DL_PENDING ||
-            g_queue[read_idx].status == DL_DOWNLOADING) {
+            is_active(g_queue[read_idx].status)) {
             if (write_idx != read_idx) {
                 memcpy(&g_queue[write_idx], &g_queue[read_idx], sizeof(DownloadItem));
             }
@@ -314,11 +546,7 @@ void dlqueue_clear_completed(void) {
     }
 
     g_queue_count = write_idx;
-
-    // Adjust current_index if needed
-    if (g_current_index >= g_queue_count) {
-        g_current_index = -1;
-    }
+    save_queue();
 
     pthread_mutex_unlock(&g_queue_mutex);
 
@@ -347,7 +575,7 @@ bool dlqueue_is_queued(const char *video_id) {
 
     bool found = false;
     for (int i = 0; i < g_queue_count; i++) {
-        if ((g_queue[i].status == DL_PENDING || g_queue[i].status == DL_DOWNLOADING) &&
+        if ((g_queue[i].status == DL_PENDING || is_active(g_queue[i].status)) &&
             strcmp(g_queue[i].video_id, video_id) == 0) {
             found = true;
             break;
@@ -460,11 +688,20 @@ bool dlqueue_cancel(int index) {
 
     DownloadItem *item = &g_queue[index];
 
-    // Only cancel pending items (can't interrupt active download safely)
     if (item->status == DL_PENDING) {
         item->status = DL_FAILED;
         strncpy(item->error, "Cancelled by user", sizeof(item->error) - 1);
         printf("[DLQUEUE] Cancelled: %s\n", item->title);
+        save_queue();
+        pthread_mutex_unlock(&g_queue_mutex);
+        return true;
+    }
+
+    // Active: the worker's next progress callback stops yt-dlp/ffmpeg
+    if (is_active(item->status) && !item->cancel) {
+        item->cancel = true;
+        printf("[DLQUEUE] Cancelling: %s\n", item->title);
+        pthread_cond_broadcast(&g_queue_cond);  // In case it waits for a CPU slot
         pthread_mutex_unlock(&g_queue_mutex);
         return true;
     }
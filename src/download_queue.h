@@ -1,8 +1,11 @@
 /**
  * Background Download Queue System
  *
- * Manages a queue of YouTube downloads that run in a background thread.
+ * Manages a queue of YouTube downloads that run on a small worker pool.
  * Allows user to continue browsing/searching while downloads complete.
+ * Each item is fetched (network) and then transcoded (CPU) as separate
+ * phases, so one item's download overlaps another's transcode. The
+ * queue is saved to the data directory and resumes after a restart.
  */
 
 #ifndef DOWNLOAD_QUEUE_H
@@ -11,12 +14,22 @@
 #include <stdbool.h>
 
 // Maximum items in queue
-#define DOWNLOAD_QUEUE_MAX 20
+#define DOWNLOAD_QUEUE_MAX 100
+
+// Worker threads (upper bound on items in flight)
+#define DLQUEUE_WORKERS 3
+
+// Concurrent phases when unthrottled / while playing or on BATTERY
+#define DLQUEUE_NET_SLOTS 2
+#define DLQUEUE_CPU_SLOTS 2
+#define DLQUEUE_THROTTLED_NET_SLOTS 1
+#define DLQUEUE_THROTTLED_CPU_SLOTS 1
 
 // Queue item status
 typedef enum {
     DL_PENDING,     // Waiting to start
     DL_DOWNLOADING, // Currently downloading
+    DL_CONVERTING,  // Transcoding the downloaded audio
     DL_COMPLETE,    // Finished successfully
     DL_FAILED       // Download failed
 } DownloadStatus;
@@ -27,23 +40,41 @@ typedef struct {
     char title[256];
     char channel[128];
     DownloadStatus status;
-    int progress;           // 0-100
+    int progress;           // 0-100 (of the current phase)
     char error[128];        // Error message if failed
     char filepath[512];     // Path to downloaded file (when complete)
+    int id;                 // Stable handle (indices shift when cleared)
+    bool cancel;            // Stop requested while active
 } DownloadItem;
 
 /**
  * Initialize the download queue system
- * Starts the background worker thread
+ * Restores the saved queue (needs the data dir) and starts the workers
  */
 void dlqueue_init(void);
 
 /**
  * Shutdown the download queue
- * Waits for current download to finish, clears queue
+ * Stops active downloads (they resume at next start) and saves the queue
  */
 void dlqueue_shutdown(void);
 
+/**
+ * Tell the scheduler what else is going on (call once per frame)
+ * Playback or BATTERY power mode limits the queue to one download and one
+ * transcode, and runs transcodes at the lowest CPU priority.
+ * @param playback_active Audio is playing
+ * @param battery_mode Power mode is BATTERY
+ */
+void dlqueue_set_conditions(bool playback_active, bool battery_mode);
+
+/**
+ * Choose the output format for items that start from now on
+ * @param keep_native true to keep the Opus stream (remux, no re-encode);
+ *        items whose best stream isn't Opus still become MP3
+ */
+void dlqueue_set_keep_native(bool keep_native);
+
 /**
  * Add item to download queue
  * @param video_id YouTube video ID
@@ -64,18 +95,18 @@ int dlqueue_pending_count(void);
 int dlqueue_total_count(void);
 
 /**
- * Check if currently downloading
+ * Check if currently downloading or converting
  */
 bool dlqueue_is_downloading(void);
 
 /**
- * Get current download progress (0-100)
+ * Get progress of the oldest active item (0-100)
  * Returns -1 if not downloading
  */
 int dlqueue_get_progress(void);
 
 /**
- * Get current download title
+ * Get title of the oldest active item
  * @return Title string or NULL if not downloading
  */
 const char* dlqueue_get_current_title(void);
@@ -150,7 +181,7 @@ bool dlqueue_view_action_select(void);
 const char* dlqueue_view_get_selected_path(void);
 
 /**
- * Action: Cancel item at cursor (if pending/downloading)
+ * Action: Cancel item at cursor (if pending or active)
  * @return true if cancelled
  */
 bool dlqueue_view_action_cancel(void);
@@ -9,17 +9,47 @@
  *
  * Biquad IIR filters per Audio EQ Cookbook (Robert Bristow-Johnson).
  * Sample rate assumed 44100 Hz (SDL_mixer default).
+ *
+ * The post-mix callback runs the cascade one band at a time over a block
+ * of both channels, so filter state and coefficients stay in registers.
+ * On ARM64 the block kernel is NEON with L/R in the two lanes of a
+ * float64x2_t; elsewhere a scalar kernel does the same arithmetic. Both
+ * stay in double: float32 coefficients drift several LSB on the 60Hz
+ * shelf, whose poles sit right next to the unit circle.
+ *
+ * Coefficients cross from the UI thread to the audio thread without locks.
+ * Each side owns one CoefSet and a third "spare" set changes hands through
+ * one atomic exchange: the UI fills its set and swaps it in as spare
+ * (flagged fresh), the audio thread swaps the fresh spare for its own at
+ * the start of a buffer and crossfades from the old response. Filter
+ * history belongs to the audio thread alone.
+ *
+ * The loudness pre-gain (loudness.c) travels in the same set and is
+ * multiplied in while the samples are converted to double, so a track
+ * gain costs no pass of its own; with all bands flat, that conversion
+ * and the soft clip are the whole chain.
  */
 
 #include "equalizer.h"
+#include "spectrum.h"
+#include "audiostats.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <string.h>
 #include <math.h>
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #define EQ_STEP_DB  2
 #define SAMPLE_RATE 44100.0
+#define EQ_BLOCK_FRAMES 512   // Stereo frames filtered per pass (8KB work buffer)
+#define EQ_FADE_FRAMES  256   // Old->new response crossfade after a change (~6ms)
+#define EQ_SET_FRESH    0x4   // Spare set holds coefficients the audio thread hasn't seen
 
 // Filter type per band
 typedef enum {
@@ -43,42 +73,49 @@ static const BandDef BANDS[EQ_BAND_COUNT] = {
     {16000.0, FILTER_HIGHSHELF, "16kHz" },
 };
 
-// Biquad filter state (stereo: 2 channels)
+// Biquad coefficients (written by the UI thread)
 typedef struct {
     double b0, b1, b2;  // Numerator coefficients
     double a1, a2;      // Denominator coefficients (a0 normalized to 1)
+} BiquadCoefs;
+
+// Biquad filter history (stereo: 2 channels, audio thread only)
+typedef struct {
     double x1[2], x2[2]; // Input history (per channel)
     double y1[2], y2[2]; // Output history (per channel)
-} BiquadFilter;
+} BiquadState;
+
+// Complete EQ response handed from UI thread to audio thread
+typedef struct {
+    BiquadCoefs coefs[EQ_BAND_COUNT];
+    unsigned active_mask;              // Bit per non-flat band
+    double pregain;                    // Linear input gain (1.0 = none)
+} CoefSet;
+
+// Block kernel: filter `frames` interleaved stereo frames in place
+typedef void (*BiquadBlockFn)(const BiquadCoefs *c, BiquadState *s, double *buf, int frames);
 
 // EQ state
 static int g_band_db[EQ_BAND_COUNT];
-static BiquadFilter g_filters[EQ_BAND_COUNT];
+static float g_pregain_db = 0.0f;
 static char g_band_str[16];
+static BiquadBlockFn g_biquad_block = NULL;   // Selected in eq_init()
 
-/**
- * Reset filter history (prevents clicks when changing settings)
- */
-static void reset_filter_history(BiquadFilter *f) {
-    f->x1[0] = f->x1[1] = 0.0;
-    f->x2[0] = f->x2[1] = 0.0;
-    f->y1[0] = f->y1[1] = 0.0;
-    f->y2[0] = f->y2[1] = 0.0;
-}
+// Coefficient handoff (see file header)
+static CoefSet g_sets[3];
+static SDL_atomic_t g_spare_set;              // Spare index | EQ_SET_FRESH
+static int g_ui_set = 0;                      // UI thread only
+static int g_audio_set = 1;                   // Audio thread only
 
-/**
- * Set filter to flat passthrough
- */
-static void set_passthrough(BiquadFilter *f) {
-    f->b0 = 1.0; f->b1 = 0.0; f->b2 = 0.0;
-    f->a1 = 0.0; f->a2 = 0.0;
-    reset_filter_history(f);
-}
+// Audio thread only
+static BiquadState g_state[EQ_BAND_COUNT];
+static double g_work[EQ_BLOCK_FRAMES * 2];
+static double g_fade_work[EQ_FADE_FRAMES * 2];
 
 /**
  * Compute low-shelf biquad coefficients
  */
-static void compute_lowshelf(BiquadFilter *f, double freq, double gain_db) {
+static void compute_lowshelf(BiquadCoefs *f, double freq, double gain_db) {
     double A = pow(10.0, gain_db / 40.0);
     double w0 = 2.0 * M_PI * freq / SAMPLE_RATE;
     double cosw0 = cos(w0);
@@ -97,7 +134,7 @@ static void compute_lowshelf(BiquadFilter *f, double freq, double gain_db) {
 /**
  * Compute high-shelf biquad coefficients
  */
-static void compute_highshelf(BiquadFilter *f, double freq, double gain_db) {
+static void compute_highshelf(BiquadCoefs *f, double freq, double gain_db) {
     double A = pow(10.0, gain_db / 40.0);
     double w0 = 2.0 * M_PI * freq / SAMPLE_RATE;
     double cosw0 = cos(w0);
@@ -116,7 +153,7 @@ static void compute_highshelf(BiquadFilter *f, double freq, double gain_db) {
 /**
  * Compute peaking EQ biquad coefficients (Q = 1.0)
  */
-static void compute_peaking(BiquadFilter *f, double freq, double gain_db) {
+static void compute_peaking(BiquadCoefs *f, double freq, double gain_db) {
     double A = pow(10.0, gain_db / 40.0);
     double w0 = 2.0 * M_PI * freq / SAMPLE_RATE;
     double cosw0 = cos(w0);
@@ -133,32 +170,44 @@ static void compute_peaking(BiquadFilter *f, double freq, double gain_db) {
 }
 
 /**
- * Update filter coefficients for a specific band
+ * Compute coefficients for a band at a given level
  */
-static void update_band_filter(int band) {
-    if (band < 0 || band >= EQ_BAND_COUNT) return;
-
-    if (g_band_db[band] == 0) {
-        set_passthrough(&g_filters[band]);
-        return;
-    }
-
+static void compute_band(BiquadCoefs *c, int band, int db) {
     double freq = BANDS[band].freq;
-    double db = (double)g_band_db[band];
 
     switch (BANDS[band].type) {
         case FILTER_LOWSHELF:
-            compute_lowshelf(&g_filters[band], freq, db);
+            compute_lowshelf(c, freq, (double)db);
             break;
         case FILTER_PEAKING:
-            compute_peaking(&g_filters[band], freq, db);
+            compute_peaking(c, freq, (double)db);
             break;
         case FILTER_HIGHSHELF:
-            compute_highshelf(&g_filters[band], freq, db);
+            compute_highshelf(c, freq, (double)db);
             break;
     }
 }
 
+/**
+ * Rebuild the full response from g_band_db and hand it to the audio thread
+ * UI thread only. Never blocks: the audio thread picks the set up at its
+ * next buffer, and repeated calls before then simply replace the spare.
+ */
+static void publish_coefs(void) {
+    CoefSet *set = &g_sets[g_ui_set];
+    set->active_mask = 0;
+    set->pregain = pow(10.0, g_pregain_db / 20.0);
+
+    for (int b = 0; b < EQ_BAND_COUNT; b++) {
+        if (g_band_db[b] == 0) continue;
+        compute_band(&set->coefs[b], b, g_band_db[b]);
+        set->active_mask |= 1u << b;
+    }
+
+    int prev = SDL_AtomicSet(&g_spare_set, g_ui_set | EQ_SET_FRESH);
+    g_ui_set = prev & ~EQ_SET_FRESH;
+}
+
 /**
  * Soft clipping to prevent harsh distortion
  */
@@ -173,66 +222,209 @@ static inline double soft_clip(double sample) {
 }
 
 /**
- * Apply biquad filter to a sample
+ * Scalar block kernel (desktop builds and non-NEON targets)
+ * Same operation order as the original per-sample biquad, per channel.
  */
-static inline double apply_biquad(BiquadFilter *f, double input, int channel) {
-    double output = f->b0 * input + f->b1 * f->x1[channel] + f->b2 * f->x2[channel]
-                  - f->a1 * f->y1[channel] - f->a2 * f->y2[channel];
+static void biquad_block_scalar(const BiquadCoefs *c, BiquadState *s, double *buf, int frames) {
+    const double b0 = c->b0, b1 = c->b1, b2 = c->b2, a1 = c->a1, a2 = c->a2;
+
+    for (int ch = 0; ch < 2; ch++) {
+        double x1 = s->x1[ch], x2 = s->x2[ch];
+        double y1 = s->y1[ch], y2 = s->y2[ch];
+        double *p = buf + ch;
+
+        for (int i = 0; i < frames; i++, p += 2) {
+            double x = *p;
+            double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            *p = y;
+        }
 
-    f->x2[channel] = f->x1[channel];
-    f->x1[channel] = input;
-    f->y2[channel] = f->y1[channel];
-    f->y1[channel] = output;
+        s->x1[ch] = x1;
+        s->x2[ch] = x2;
+        s->y1[ch] = y1;
+        s->y2[ch] = y2;
+    }
+}
+
+#if defined(__aarch64__)
+/**
+ * NEON block kernel: left/right filtered together in one float64x2_t
+ * History arrays are already laid out as [L, R], so they load directly.
+ */
+static void biquad_block_neon(const BiquadCoefs *c, BiquadState *s, double *buf, int frames) {
+    const float64x2_t b0 = vdupq_n_f64(c->b0);
+    const float64x2_t b1 = vdupq_n_f64(c->b1);
+    const float64x2_t b2 = vdupq_n_f64(c->b2);
+    const float64x2_t a1 = vdupq_n_f64(c->a1);
+    const float64x2_t a2 = vdupq_n_f64(c->a2);
+    float64x2_t x1 = vld1q_f64(s->x1), x2 = vld1q_f64(s->x2);
+    float64x2_t y1 = vld1q_f64(s->y1), y2 = vld1q_f64(s->y2);
+
+    for (int i = 0; i < frames; i++) {
+        float64x2_t x = vld1q_f64(buf + 2 * i);
+        float64x2_t y = vmulq_f64(b0, x);
+        y = vfmaq_f64(y, b1, x1);
+        y = vfmaq_f64(y, b2, x2);
+        y = vfmsq_f64(y, a1, y1);
+        y = vfmsq_f64(y, a2, y2);
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        vst1q_f64(buf + 2 * i, y);
+    }
 
-    return output;
+    vst1q_f64(s->x1, x1);
+    vst1q_f64(s->x2, x2);
+    vst1q_f64(s->y1, y1);
+    vst1q_f64(s->y2, y2);
 }
+#endif
 
 /**
- * Check if any band is non-flat
+ * Check if a set changes the signal at all
  */
-static int eq_is_active(void) {
-    for (int i = 0; i < EQ_BAND_COUNT; i++) {
-        if (g_band_db[i] != 0) return 1;
+static inline bool set_is_active(const CoefSet *set) {
+    return set->active_mask != 0 || set->pregain != 1.0;
+}
+
+/**
+ * Run every active band of a set over a work block
+ */
+static void run_cascade(const CoefSet *set, BiquadState *state, double *buf, int frames) {
+    for (int b = 0; b < EQ_BAND_COUNT; b++) {
+        if (set->active_mask & (1u << b)) {
+            g_biquad_block(&set->coefs[b], &state[b], buf, frames);
+        }
     }
-    return 0;
 }
 
 /**
- * Post-mix callback - processes all audio through EQ chain
+ * Run the EQ chain over one buffer
+ * Adopts freshly published coefficients at the buffer boundary; the first
+ * EQ_FADE_FRAMES are then rendered through both responses and crossfaded.
  */
-static void eq_postmix_callback(void *udata, Uint8 *stream, int len) {
-    (void)udata;
+void eq_process(uint8_t *stream, int len) {
+    // Pick up a new set if the UI published one (lock-free swap)
+    CoefSet old_set;
+    bool fade = false;
+    if (SDL_AtomicGet(&g_spare_set) & EQ_SET_FRESH) {
+        old_set = g_sets[g_audio_set];
+        int prev = SDL_AtomicSet(&g_spare_set, g_audio_set);
+        g_audio_set = prev & ~EQ_SET_FRESH;
+
+        // Bands switching on start from silence, not stale history
+        unsigned started = g_sets[g_audio_set].active_mask & ~old_set.active_mask;
+        for (int b = 0; b < EQ_BAND_COUNT; b++) {
+            if (started & (1u << b)) memset(&g_state[b], 0, sizeof(g_state[b]));
+        }
+        fade = set_is_active(&old_set) || set_is_active(&g_sets[g_audio_set]);
+    }
 
-    if (!eq_is_active()) return;
+    const CoefSet *set = &g_sets[g_audio_set];
+    if (!set_is_active(set) && !fade) return;
 
     int16_t *samples = (int16_t *)stream;
-    int sample_count = len / sizeof(int16_t);
+    int total_frames = len / (int)(2 * sizeof(int16_t));
 
-    for (int i = 0; i < sample_count; i += 2) {
-        double left = (double)samples[i];
-        double right = (double)samples[i + 1];
+    // Fading out to flat: only the fade span needs touching
+    if (!set_is_active(set) && total_frames > EQ_FADE_FRAMES) {
+        total_frames = EQ_FADE_FRAMES;
+    }
 
-        // Chain all active filters
-        for (int b = 0; b < EQ_BAND_COUNT; b++) {
-            if (g_band_db[b] != 0) {
-                left = apply_biquad(&g_filters[b], left, 0);
-                right = apply_biquad(&g_filters[b], right, 1);
+    const double pregain = set->pregain;
+    while (total_frames > 0) {
+        int frames = total_frames < EQ_BLOCK_FRAMES ? total_frames : EQ_BLOCK_FRAMES;
+        int count = frames * 2;
+
+        for (int i = 0; i < count; i++) {
+            g_work[i] = (double)samples[i] * pregain;
+        }
+
+        // Old response over the fade span, on a copy of the history
+        int fade_frames = 0;
+        if (fade) {
+            fade_frames = frames < EQ_FADE_FRAMES ? frames : EQ_FADE_FRAMES;
+            BiquadState old_state[EQ_BAND_COUNT];
+            memcpy(old_state, g_state, sizeof(old_state));
+            double rescale = old_set.pregain / pregain;
+            for (int i = 0; i < fade_frames * 2; i++) {
+                g_fade_work[i] = g_work[i] * rescale;
             }
+            run_cascade(&old_set, old_state, g_fade_work, fade_frames);
+            fade = false;
+        }
+
+        // Chain all active filters, one pass per band
+        run_cascade(set, g_state, g_work, frames);
+
+        for (int i = 0; i < fade_frames; i++) {
+            double w = (double)(i + 1) / EQ_FADE_FRAMES;
+            g_work[2 * i] = g_fade_work[2 * i] + (g_work[2 * i] - g_fade_work[2 * i]) * w;
+            g_work[2 * i + 1] = g_fade_work[2 * i + 1] + (g_work[2 * i + 1] - g_fade_work[2 * i + 1]) * w;
         }
 
-        samples[i] = (int16_t)soft_clip(left);
-        samples[i + 1] = (int16_t)soft_clip(right);
+        for (int i = 0; i < count; i++) {
+            samples[i] = (int16_t)soft_clip(g_work[i]);
+        }
+
+        samples += count;
+        total_frames -= frames;
     }
 }
 
+/**
+ * Post-mix callback - processes all audio through EQ chain, then hands
+ * the result to the spectrum tap (a no-op while it is hidden)
+ */
+void eq_postmix_process(uint8_t *stream, int len) {
+    uint64_t start = audiostats_begin();
+    eq_process(stream, len);
+    spectrum_tap((const int16_t *)stream, len / 4);
+    audiostats_end(AUDIO_PATH_POSTMIX, start, len / 4);
+}
+
+static void eq_postmix_callback(void *udata, Uint8 *stream, int len) {
+    (void)udata;
+    eq_postmix_process(stream, len);
+}
+
 void eq_init(void) {
     for (int i = 0; i < EQ_BAND_COUNT; i++) {
         g_band_db[i] = 0;
-        set_passthrough(&g_filters[i]);
     }
 
+    // All sets flat; callback not registered yet, so no handoff needed
+    g_pregain_db = 0.0f;
+    memset(g_sets, 0, sizeof(g_sets));
+    for (int i = 0; i < 3; i++) g_sets[i].pregain = 1.0;
+    memset(g_state, 0, sizeof(g_state));
+    g_ui_set = 0;
+    g_audio_set = 1;
+    SDL_AtomicSet(&g_spare_set, 2);
+
+    // NEON on ARM64; MONO_EQ_SCALAR=1 forces the scalar kernel for A/B checks
+    g_biquad_block = biquad_block_scalar;
+    const char *kernel = "scalar";
+#if defined(__aarch64__)
+    const char *force_scalar = getenv("MONO_EQ_SCALAR");
+    if (!force_scalar || force_scalar[0] != '1') {
+        g_biquad_block = biquad_block_neon;
+        kernel = "NEON";
+    }
+#endif
+
+    // Callback timing needs the device rate for its period
+    int freq = AUDIOSTATS_DEFAULT_RATE, channels = 2;
+    Uint16 format = AUDIO_S16SYS;
+    if (Mix_QuerySpec(&freq, &format, &channels)) audiostats_set_rate(freq);
+
     Mix_SetPostMix(eq_postmix_callback, NULL);
-    printf("[EQ] Initialized 5-band EQ (all flat)\n");
+    printf("[EQ] Initialized 5-band EQ (all flat, %s kernel)\n", kernel);
 }
 
 void eq_cleanup(void) {
@@ -256,8 +448,7 @@ void eq_set_band_db(int band, int db) {
 
     if (db != g_band_db[band]) {
         g_band_db[band] = db;
-        reset_filter_history(&g_filters[band]);
-        update_band_filter(band);
+        publish_coefs();
         printf("[EQ] %s: %d dB\n", BANDS[band].label, db);
     }
 }
@@ -286,11 +477,22 @@ const char* eq_get_band_string(int band) {
     return g_band_str;
 }
 
+void eq_set_pregain_db(float db) {
+    if (db == g_pregain_db) return;
+    g_pregain_db = db;
+    publish_coefs();
+    printf("[EQ] Pre-gain: %+.1f dB\n", db);
+}
+
+float eq_get_pregain_db(void) {
+    return g_pregain_db;
+}
+
 void eq_reset(void) {
     for (int i = 0; i < EQ_BAND_COUNT; i++) {
         g_band_db[i] = 0;
-        set_passthrough(&g_filters[i]);
     }
+    publish_coefs();
     printf("[EQ] Reset to flat\n");
 }
 
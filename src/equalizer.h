@@ -9,12 +9,15 @@
  *   4: 16kHz (high-shelf) - Air
  *
  * Range: -12 to +12 dB per band, 2 dB steps.
- * Processing via Mix_SetPostMix() callback for real-time audio.
+ * Processing via Mix_SetPostMix() callback for real-time audio, with an
+ * input pre-gain for loudness normalization.
  */
 
 #ifndef EQUALIZER_H
 #define EQUALIZER_H
 
+#include <stdint.h>
+
 #define EQ_BAND_COUNT 5
 #define EQ_MIN_DB    -12
 #define EQ_MAX_DB     12
@@ -29,6 +32,37 @@ void eq_init(void);
  */
 void eq_cleanup(void);
 
+/**
+ * Run the EQ over a buffer, as the post-mix callback does
+ * For the audio thread, or for the benchmark harness when no device is
+ * open (never both at once).
+ * @param stream Interleaved stereo S16 samples, processed in place
+ * @param len Buffer size in bytes
+ */
+void eq_process(uint8_t *stream, int len);
+
+/**
+ * Run the whole post-mix path over a buffer: EQ, spectrum tap and the
+ * AUDIO_PATH_POSTMIX timing (audiostats.h)
+ * Same callers as eq_process().
+ * @param stream Interleaved stereo S16 samples, processed in place
+ * @param len Buffer size in bytes
+ */
+void eq_postmix_process(uint8_t *stream, int len);
+
+/**
+ * Set the gain applied ahead of the bands (loudness normalization)
+ * Changes are crossfaded like band changes. Not saved with the bands, and
+ * eq_reset() leaves it alone.
+ * @param db Gain in dB (0 = none)
+ */
+void eq_set_pregain_db(float db);
+
+/**
+ * Get the current pre-gain in dB
+ */
+float eq_get_pregain_db(void);
+
 /**
  * Get number of bands
  */
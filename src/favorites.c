@@ -15,15 +15,30 @@
 
 #include "favorites.h"
 #include "state.h"
+#include "persist.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #define FAVORITES_FILENAME "favorites.json"
 
-// Favorites storage
-static char g_favorites[MAX_FAVORITES][512];
+// Favorites file size limit
+#define FAVORITES_MAX_FILE (4 * 1024 * 1024)
+
+// Favorite entry (path owned by the list)
+typedef struct {
+    char *path;
+    uint32_t hash;
+} Favorite;
+
+// Favorites storage: list in playback order plus an open-addressing set
+// of list indices (index + 1, 0 = empty) for is_favorite() from render code
+static Favorite *g_favorites = NULL;
 static int g_favorites_count = 0;
+static int g_favorites_capacity = 0;
+static int32_t *g_set = NULL;
+static uint32_t g_set_size = 0;     // Power of two, kept at most half full
 static char g_favorites_path[512] = {0};
 static bool g_dirty = false;  // Track if changes need saving
 
@@ -41,6 +56,106 @@ static void build_path(void) {
     }
 }
 
+/**
+ * FNV-1a hash of a path
+ */
+static uint32_t hash_path(const char *path) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Rebuild the set from the list, growing it if needed
+ * @return false if out of memory (set left unchanged)
+ */
+static bool rebuild_set(int min_count) {
+    uint32_t size = g_set_size ? g_set_size : 64;
+    while (size < (uint32_t)min_count * 2) size *= 2;
+
+    int32_t *set = size == g_set_size ? g_set : malloc(size * sizeof(int32_t));
+    if (!set) return false;
+    memset(set, 0, size * sizeof(int32_t));
+
+    for (int i = 0; i < g_favorites_count; i++) {
+        uint32_t b = g_favorites[i].hash & (size - 1);
+        while (set[b]) b = (b + 1) & (size - 1);
+        set[b] = i + 1;
+    }
+
+    if (set != g_set) free(g_set);
+    g_set = set;
+    g_set_size = size;
+    return true;
+}
+
+/**
+ * Find a favorite by path
+ * @return List index, or -1 if not a favorite
+ */
+static int find_favorite(const char *path) {
+    if (!g_set) return -1;
+
+    uint32_t hash = hash_path(path);
+    uint32_t b = hash & (g_set_size - 1);
+    while (g_set[b]) {
+        const Favorite *fav = &g_favorites[g_set[b] - 1];
+        if (fav->hash == hash && strcmp(fav->path, path) == 0) {
+            return g_set[b] - 1;
+        }
+        b = (b + 1) & (g_set_size - 1);
+    }
+    return -1;
+}
+
+/**
+ * Append a path to the list and the set
+ * @return false if out of memory
+ */
+static bool insert_favorite(const char *path) {
+    if (g_favorites_count == g_favorites_capacity) {
+        int new_capacity = g_favorites_capacity ? g_favorites_capacity * 2 : 64;
+        Favorite *grown = realloc(g_favorites, new_capacity * sizeof(Favorite));
+        if (!grown) return false;
+        g_favorites = grown;
+        g_favorites_capacity = new_capacity;
+    }
+    if ((uint32_t)(g_favorites_count + 1) * 2 > g_set_size && !rebuild_set(g_favorites_count + 1)) {
+        return false;
+    }
+
+    char *copy = strdup(path);
+    if (!copy) return false;
+
+    Favorite *fav = &g_favorites[g_favorites_count];
+    fav->path = copy;
+    fav->hash = hash_path(path);
+
+    uint32_t b = fav->hash & (g_set_size - 1);
+    while (g_set[b]) b = (b + 1) & (g_set_size - 1);
+    g_set[b] = ++g_favorites_count;
+    return true;
+}
+
+/**
+ * Free the list and the set
+ */
+static void clear_favorites(void) {
+    for (int i = 0; i < g_favorites_count; i++) {
+        free(g_favorites[i].path);
+    }
+    free(g_favorites);
+    free(g_set);
+    g_favorites = NULL;
+    g_set = NULL;
+    g_favorites_count = 0;
+    g_favorites_capacity = 0;
+    g_set_size = 0;
+}
+
 /**
  * Load favorites from disk
  */
@@ -60,7 +175,7 @@ static bool load_favorites(void) {
     long size = ftell(f);
     fseek(f, 0, SEEK_SET);
 
-    if (size <= 0 || size > 262144) {  // 256KB max
+    if (size <= 0 || size > FAVORITES_MAX_FILE) {
         fclose(f);
         return false;
     }
@@ -100,10 +215,10 @@ static bool load_favorites(void) {
     }
 
     // Parse each path in the array
-    g_favorites_count = 0;
+    clear_favorites();
     const char *p = arr_start + 1;
 
-    while (p < arr_end && g_favorites_count < MAX_FAVORITES) {
+    while (p < arr_end) {
         // Find opening quote
         const char *start = strchr(p, '"');
         if (!start || start >= arr_end) break;
@@ -124,12 +239,16 @@ static bool load_favorites(void) {
 
         if (!end || end >= arr_end) break;
 
-        // Copy path
-        size_t len = end - start;
-        if (len > 0 && len < sizeof(g_favorites[0])) {
-            strncpy(g_favorites[g_favorites_count], start, len);
-            g_favorites[g_favorites_count][len] = '\0';
-            g_favorites_count++;
+        // Copy path, undoing the escapes favorites_save() adds
+        char path[1024];
+        size_t len = 0;
+        for (const char *c = start; c < end && len < sizeof(path) - 1; c++) {
+            if (*c == '\\' && c + 1 < end) c++;
+            path[len++] = *c;
+        }
+        path[len] = '\0';
+        if (len > 0 && find_favorite(path) < 0) {
+            insert_favorite(path);
         }
 
         p = end + 1;
@@ -141,7 +260,7 @@ static bool load_favorites(void) {
 }
 
 int favorites_init(void) {
-    g_favorites_count = 0;
+    clear_favorites();
     g_dirty = false;
 
     build_path();
@@ -154,7 +273,7 @@ void favorites_cleanup(void) {
     if (g_dirty) {
         favorites_save();
     }
-    g_favorites_count = 0;
+    clear_favorites();
 }
 
 bool favorites_add(const char *path) {
@@ -165,16 +284,11 @@ bool favorites_add(const char *path) {
         return false;
     }
 
-    // Check capacity
-    if (g_favorites_count >= MAX_FAVORITES) {
-        fprintf(stderr, "[FAV] Favorites list is full\n");
+    // Add to list
+    if (!insert_favorite(path)) {
+        fprintf(stderr, "[FAV] Out of memory adding favorite\n");
         return false;
     }
-
-    // Add to list
-    strncpy(g_favorites[g_favorites_count], path, sizeof(g_favorites[0]) - 1);
-    g_favorites[g_favorites_count][sizeof(g_favorites[0]) - 1] = '\0';
-    g_favorites_count++;
     g_dirty = true;
     favorites_save();  // Persist immediately - NextUI/MinUI kills app without cleanup
 
@@ -185,21 +299,19 @@ bool favorites_add(const char *path) {
 bool favorites_remove(const char *path) {
     if (!path || path[0] == '\0') return false;
 
-    for (int i = 0; i < g_favorites_count; i++) {
-        if (strcmp(g_favorites[i], path) == 0) {
-            // Shift remaining entries
-            for (int j = i; j < g_favorites_count - 1; j++) {
-                strcpy(g_favorites[j], g_favorites[j + 1]);
-            }
-            g_favorites_count--;
-            g_dirty = true;
-            favorites_save();  // Persist immediately - NextUI/MinUI kills app without cleanup
-            printf("[FAV] Removed: %s\n", path);
-            return true;
-        }
-    }
+    int i = find_favorite(path);
+    if (i < 0) return false;
 
-    return false;
+    // Shift remaining entries (pointers only), then reindex the set
+    free(g_favorites[i].path);
+    memmove(&g_favorites[i], &g_favorites[i + 1],
+            (g_favorites_count - i - 1) * sizeof(Favorite));
+    g_favorites_count--;
+    rebuild_set(g_favorites_count);
+    g_dirty = true;
+    favorites_save();  // Persist immediately - NextUI/MinUI kills app without cleanup
+    printf("[FAV] Removed: %s\n", path);
+    return true;
 }
 
 bool favorites_toggle(const char *path) {
@@ -214,13 +326,7 @@ bool favorites_toggle(const char *path) {
 
 bool favorites_is_favorite(const char *path) {
     if (!path || path[0] == '\0') return false;
-
-    for (int i = 0; i < g_favorites_count; i++) {
-        if (strcmp(g_favorites[i], path) == 0) {
-            return true;
-        }
-    }
-    return false;
+    return find_favorite(path) >= 0;
 }
 
 int favorites_get_count(void) {
@@ -231,7 +337,7 @@ const char* favorites_get_path(int index) {
     if (index < 0 || index >= g_favorites_count) {
         return NULL;
     }
-    return g_favorites[index];
+    return g_favorites[index].path;
 }
 
 bool favorites_save(void) {
@@ -239,9 +345,12 @@ bool favorites_save(void) {
         build_path();
     }
 
-    FILE *f = fopen(g_favorites_path, "w");
+    // Build the file in memory; the persist thread writes it
+    char *json = NULL;
+    size_t json_size = 0;
+    FILE *f = open_memstream(&json, &json_size);
     if (!f) {
-        fprintf(stderr, "[FAV] Failed to open %s for writing\n", g_favorites_path);
+        fprintf(stderr, "[FAV] Failed to build favorites file\n");
         return false;
     }
 
@@ -252,7 +361,7 @@ bool favorites_save(void) {
         // Escape special characters in path
         fprintf(f, "    \"");
 
-        for (const char *p = g_favorites[i]; *p; p++) {
+        for (const char *p = g_favorites[i].path; *p; p++) {
             if (*p == '"' || *p == '\\') {
                 fputc('\\', f);
             }
@@ -270,6 +379,10 @@ bool favorites_save(void) {
     fprintf(f, "}\n");
 
     fclose(f);
+    bool queued = persist_write(g_favorites_path, json, json_size);
+    free(json);
+    if (!queued) return false;
+
     g_dirty = false;
     printf("[FAV] Saved %d favorites to %s\n", g_favorites_count, g_favorites_path);
     return true;
@@ -309,7 +422,7 @@ int favorites_advance_playback(int delta) {
     }
 
     g_favorites_playback_index = new_index;
-    printf("[FAV] Advanced to index %d: %s\n", new_index, g_favorites[new_index]);
+    printf("[FAV] Advanced to index %d: %s\n", new_index, g_favorites[new_index].path);
     return new_index;
 }
 
@@ -320,7 +433,7 @@ const char* favorites_get_current_playback_path(void) {
     if (g_favorites_playback_index < 0 || g_favorites_playback_index >= g_favorites_count) {
         return NULL;
     }
-    return g_favorites[g_favorites_playback_index];
+    return g_favorites[g_favorites_playback_index].path;
 }
 
 int favorites_get_playback_index(void) {
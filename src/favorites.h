@@ -12,9 +12,6 @@
 
 #include <stdbool.h>
 
-// Maximum number of favorites
-#define MAX_FAVORITES 256
-
 /**
  * Initialize favorites system
  * Loads existing favorites from disk
@@ -20,6 +20,7 @@ static bool g_confirm_pending = false;
 
 // Rename state
 static char g_rename_buffer[256] = {0};
+static char g_renamed_path[512] = {0};  // Target's path after the last rename
 static int g_rename_cursor = 0;  // Position in text
 static int g_kbd_row = 0;        // Keyboard grid row
 static int g_kbd_col = 0;        // Keyboard grid column
@@ -276,15 +277,15 @@ FileMenuResult filemenu_rename_confirm(void) {
     }
 
     // Build new path
-    char new_path[512];
+    char *new_path = g_renamed_path;
     char *last_sep = strrchr(g_target_path, '/');
     if (last_sep) {
         int dir_len = last_sep - g_target_path;
         strncpy(new_path, g_target_path, dir_len);
         new_path[dir_len] = '\0';
-        snprintf(new_path + dir_len, sizeof(new_path) - dir_len, "/%s", g_rename_buffer);
+        snprintf(new_path + dir_len, sizeof(g_renamed_path) - dir_len, "/%s", g_rename_buffer);
     } else {
-        strncpy(new_path, g_rename_buffer, sizeof(new_path) - 1);
+        strncpy(new_path, g_rename_buffer, sizeof(g_renamed_path) - 1);
     }
 
     // Rename file
@@ -296,3 +297,7 @@ FileMenuResult filemenu_rename_confirm(void) {
         return FILEMENU_RESULT_CANCELLED;
     }
 }
+
+const char* filemenu_rename_get_new_path(void) {
+    return g_renamed_path;
+}
@@ -148,4 +148,10 @@ char filemenu_rename_get_char_at(int row, int col);
  */
 FileMenuResult filemenu_rename_confirm(void);
 
+/**
+ * Get the target's new path after FILEMENU_RESULT_RENAMED
+ * (filemenu_get_path() still returns the old one)
+ */
+const char* filemenu_rename_get_new_path(void);
+
 #endif // FILEMENU_H
@@ -0,0 +1,414 @@
+/**
+ * Glyph Atlas Implementation
+ *
+ * Glyphs are rasterized one codepoint at a time with TTF_RenderUTF8_Blended
+ * (white, so any color can be applied as a tint) and shelf-packed into a
+ * static texture. Lookups are a direct table for ASCII and a small open-
+ * addressing table for the rest. When the texture fills up the atlas starts
+ * over; with the handful of scripts a music library uses that is rare.
+ *
+ * Layout is advance-based. Proportional fonts (the system's regular.ttf)
+ * also get the font's kerning between adjacent glyphs, as TTF_RenderUTF8
+ * applies it; fixed-width faces skip the lookup.
+ */
+
+#include "glyph.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define ATLAS_MAX_GLYPHS 512
+#define ATLAS_HASH_SIZE 1024           // Non-ASCII lookup, power of two
+#define ATLAS_BATCH_GLYPHS 128         // Quads per draw call
+#define ATLAS_PAD 1                    // Gap between glyphs (no bleeding)
+
+/**
+ * One cached glyph
+ */
+typedef struct {
+    Uint32 codepoint;
+    SDL_Rect rect;                     // Location in the atlas (w=0: blank)
+    int advance;
+} Glyph;
+
+struct GlyphAtlas {
+    SDL_Renderer *renderer;
+    TTF_Font *font;
+    SDL_Texture *texture;
+    int size;                          // Texture is size x size
+    int height;                        // Font line height
+    bool kern;                         // Proportional face with kerning on
+
+    // Shelf packer
+    int pen_x, pen_y, shelf_h;
+
+    Glyph glyphs[ATLAS_MAX_GLYPHS];
+    int glyph_count;
+    int16_t ascii[128];                // Glyph index + 1, 0 = not cached
+    int16_t table[ATLAS_HASH_SIZE];    // Same, for codepoints >= 128
+
+    GlyphAtlasStats stats;
+};
+
+/**
+ * Kerning adjustment between two adjacent codepoints (0 if none)
+ */
+static int kerning(const GlyphAtlas *atlas, Uint32 prev, Uint32 cp) {
+    if (!atlas->kern || prev == 0 || prev > 0xFFFF || cp > 0xFFFF) return 0;
+    return TTF_GetFontKerningSizeGlyphs(atlas->font, (Uint16)prev, (Uint16)cp);
+}
+
+/**
+ * Pending quad (source in atlas, destination on screen)
+ */
+typedef struct {
+    SDL_Rect src;
+    SDL_Rect dst;
+} GlyphQuad;
+
+// Batch shared by all atlases (rendering is single-threaded)
+static GlyphQuad g_batch[ATLAS_BATCH_GLYPHS];
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+static SDL_Vertex g_vertices[ATLAS_BATCH_GLYPHS * 4];
+static int g_indices[ATLAS_BATCH_GLYPHS * 6];
+static bool g_indices_ready = false;
+#endif
+
+/**
+ * Decode one UTF-8 sequence and advance past it
+ * Malformed bytes decode as U+FFFD, one byte at a time.
+ */
+static Uint32 decode_utf8(const char **text) {
+    const unsigned char *s = (const unsigned char *)*text;
+    Uint32 cp;
+    int len;
+
+    if (s[0] < 0x80) {
+        cp = s[0];
+        len = 1;
+    } else if ((s[0] & 0xE0) == 0xC0) {
+        cp = s[0] & 0x1F;
+        len = 2;
+    } else if ((s[0] & 0xF0) == 0xE0) {
+        cp = s[0] & 0x0F;
+        len = 3;
+    } else if ((s[0] & 0xF8) == 0xF0) {
+        cp = s[0] & 0x07;
+        len = 4;
+    } else {
+        *text += 1;
+        return 0xFFFD;
+    }
+
+    for (int i = 1; i < len; i++) {
+        if ((s[i] & 0xC0) != 0x80) {
+            *text += 1;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+
+    *text += len;
+    return cp;
+}
+
+/**
+ * Encode a codepoint as UTF-8 (buf must hold 5 bytes)
+ */
+static void encode_utf8(Uint32 cp, char *buf) {
+    if (cp < 0x80) {
+        buf[0] = (char)cp;
+        buf[1] = '\0';
+    } else if (cp < 0x800) {
+        buf[0] = (char)(0xC0 | (cp >> 6));
+        buf[1] = (char)(0x80 | (cp & 0x3F));
+        buf[2] = '\0';
+    } else if (cp < 0x10000) {
+        buf[0] = (char)(0xE0 | (cp >> 12));
+        buf[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (cp & 0x3F));
+        buf[3] = '\0';
+    } else {
+        buf[0] = (char)(0xF0 | (cp >> 18));
+        buf[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        buf[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        buf[3] = (char)(0x80 | (cp & 0x3F));
+        buf[4] = '\0';
+    }
+}
+
+/**
+ * Hash slot for a non-ASCII codepoint
+ */
+static uint32_t hash_slot(Uint32 cp) {
+    return (cp * 2654435761u) >> (32 - 10);  // log2(ATLAS_HASH_SIZE)
+}
+
+/**
+ * Find a cached glyph
+ */
+static const Glyph* find_glyph(const GlyphAtlas *atlas, Uint32 cp) {
+    if (cp < 128) {
+        return atlas->ascii[cp] ? &atlas->glyphs[atlas->ascii[cp] - 1] : NULL;
+    }
+
+    uint32_t b = hash_slot(cp);
+    while (atlas->table[b]) {
+        const Glyph *g = &atlas->glyphs[atlas->table[b] - 1];
+        if (g->codepoint == cp) return g;
+        b = (b + 1) & (ATLAS_HASH_SIZE - 1);
+    }
+    return NULL;
+}
+
+/**
+ * Forget every glyph (texture contents are simply overwritten)
+ */
+static void reset_atlas(GlyphAtlas *atlas) {
+    atlas->glyph_count = 0;
+    atlas->pen_x = 0;
+    atlas->pen_y = 0;
+    atlas->shelf_h = 0;
+    memset(atlas->ascii, 0, sizeof(atlas->ascii));
+    memset(atlas->table, 0, sizeof(atlas->table));
+    atlas->stats.resets++;
+}
+
+/**
+ * Rasterize a glyph into the atlas
+ * May reset the atlas, so flush pending quads first.
+ */
+static const Glyph* add_glyph(GlyphAtlas *atlas, Uint32 cp) {
+    char utf8[5];
+    encode_utf8(cp, utf8);
+
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface *surface = TTF_RenderUTF8_Blended(atlas->font, utf8, white);
+
+    int advance = 0;
+    if (cp <= 0xFFFF) {
+        TTF_GlyphMetrics(atlas->font, (Uint16)cp, NULL, NULL, NULL, NULL, &advance);
+    }
+    if (advance <= 0 && surface) {
+        advance = surface->w;
+    }
+
+    int w = surface ? surface->w : 0;
+    int h = surface ? surface->h : 0;
+    if (w > atlas->size || h > atlas->size) {
+        SDL_FreeSurface(surface);
+        return NULL;
+    }
+
+    // Make room: next shelf, or start over when the texture is full
+    if (atlas->glyph_count >= ATLAS_MAX_GLYPHS) {
+        reset_atlas(atlas);
+    }
+    if (atlas->pen_x + w > atlas->size) {
+        atlas->pen_x = 0;
+        atlas->pen_y += atlas->shelf_h + ATLAS_PAD;
+        atlas->shelf_h = 0;
+    }
+    if (atlas->pen_y + h > atlas->size) {
+        printf("[GLYPH] Atlas full (%d glyphs), starting over\n", atlas->glyph_count);
+        reset_atlas(atlas);
+    }
+
+    Glyph *g = &atlas->glyphs[atlas->glyph_count];
+    g->codepoint = cp;
+    g->advance = advance;
+    g->rect = (SDL_Rect){atlas->pen_x, atlas->pen_y, w, h};
+
+    if (surface && w > 0 && h > 0) {
+        SDL_Surface *argb = surface;
+        if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+            argb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+        }
+        if (!argb || SDL_UpdateTexture(atlas->texture, &g->rect, argb->pixels, argb->pitch) != 0) {
+            g->rect.w = 0;
+        }
+        if (argb && argb != surface) SDL_FreeSurface(argb);
+
+        atlas->pen_x += w + ATLAS_PAD;
+        if (h > atlas->shelf_h) atlas->shelf_h = h;
+    } else {
+        g->rect.w = 0;
+    }
+    SDL_FreeSurface(surface);
+
+    // Index it
+    int16_t index = (int16_t)(++atlas->glyph_count);
+    if (cp < 128) {
+        atlas->ascii[cp] = index;
+    } else {
+        uint32_t b = hash_slot(cp);
+        while (atlas->table[b]) b = (b + 1) & (ATLAS_HASH_SIZE - 1);
+        atlas->table[b] = index;
+    }
+    return g;
+}
+
+/**
+ * Find or rasterize a glyph
+ */
+static const Glyph* get_glyph(GlyphAtlas *atlas, Uint32 cp, int *pending, SDL_Color color);
+
+/**
+ * Draw the pending quads
+ */
+static void flush_batch(GlyphAtlas *atlas, int count, SDL_Color color) {
+    if (count == 0) return;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if (!g_indices_ready) {
+        for (int i = 0; i < ATLAS_BATCH_GLYPHS; i++) {
+            int *idx = &g_indices[i * 6];
+            idx[0] = i * 4;
+            idx[1] = i * 4 + 1;
+            idx[2] = i * 4 + 2;
+            idx[3] = i * 4 + 2;
+            idx[4] = i * 4 + 1;
+            idx[5] = i * 4 + 3;
+        }
+        g_indices_ready = true;
+    }
+
+    float scale = 1.0f / (float)atlas->size;
+    for (int i = 0; i < count; i++) {
+        const GlyphQuad *q = &g_batch[i];
+        float x0 = (float)q->dst.x, y0 = (float)q->dst.y;
+        float x1 = x0 + q->dst.w, y1 = y0 + q->dst.h;
+        float u0 = q->src.x * scale, v0 = q->src.y * scale;
+        float u1 = (q->src.x + q->src.w) * scale, v1 = (q->src.y + q->src.h) * scale;
+
+        SDL_Vertex *v = &g_vertices[i * 4];
+        v[0] = (SDL_Vertex){{x0, y0}, color, {u0, v0}};
+        v[1] = (SDL_Vertex){{x1, y0}, color, {u1, v0}};
+        v[2] = (SDL_Vertex){{x0, y1}, color, {u0, v1}};
+        v[3] = (SDL_Vertex){{x1, y1}, color, {u1, v1}};
+    }
+    SDL_RenderGeometry(atlas->renderer, atlas->texture, g_vertices, count * 4, g_indices, count * 6);
+#else
+    // Older SDL: same quads, one copy each
+    SDL_SetTextureColorMod(atlas->texture, color.r, color.g, color.b);
+    SDL_SetTextureAlphaMod(atlas->texture, color.a);
+    for (int i = 0; i < count; i++) {
+        SDL_RenderCopy(atlas->renderer, atlas->texture, &g_batch[i].src, &g_batch[i].dst);
+    }
+#endif
+}
+
+static const Glyph* get_glyph(GlyphAtlas *atlas, Uint32 cp, int *pending, SDL_Color color) {
+    const Glyph *g = find_glyph(atlas, cp);
+    if (g) {
+        atlas->stats.hits++;
+        return g;
+    }
+    atlas->stats.misses++;
+
+    // Rasterizing may start the atlas over under pending quads
+    if (pending) {
+        flush_batch(atlas, *pending, color);
+        *pending = 0;
+    }
+    return add_glyph(atlas, cp);
+}
+
+GlyphAtlas* glyph_atlas_create(SDL_Renderer *renderer, TTF_Font *font) {
+    if (!renderer || !font) return NULL;
+
+    GlyphAtlas *atlas = calloc(1, sizeof(GlyphAtlas));
+    if (!atlas) return NULL;
+
+    atlas->renderer = renderer;
+    atlas->font = font;
+    atlas->height = TTF_FontHeight(font);
+    atlas->kern = TTF_GetFontKerning(font) && !TTF_FontFaceIsFixedWidth(font);
+    atlas->size = atlas->height <= 40 ? 512 : 1024;
+
+    atlas->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                       SDL_TEXTUREACCESS_STATIC, atlas->size, atlas->size);
+    if (!atlas->texture) {
+        fprintf(stderr, "[GLYPH] Failed to create atlas: %s\n", SDL_GetError());
+        free(atlas);
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+
+    // Start fully transparent so unused space never shows
+    void *blank = calloc((size_t)atlas->size * atlas->size, 4);
+    if (blank) {
+        SDL_UpdateTexture(atlas->texture, NULL, blank, atlas->size * 4);
+        free(blank);
+    }
+
+    // Printable ASCII up front: the common case never rasterizes mid-frame
+    for (Uint32 cp = 32; cp < 127; cp++) {
+        add_glyph(atlas, cp);
+    }
+    return atlas;
+}
+
+void glyph_atlas_destroy(GlyphAtlas *atlas) {
+    if (!atlas) return;
+    if (atlas->texture) SDL_DestroyTexture(atlas->texture);
+    free(atlas);
+}
+
+int glyph_atlas_draw(GlyphAtlas *atlas, const char *text, int x, int y, SDL_Color color) {
+    if (!atlas || !text) return 0;
+
+    int pen = x;
+    int pending = 0;
+    Uint32 prev = 0;
+    const char *p = text;
+    while (*p) {
+        Uint32 cp = decode_utf8(&p);
+        const Glyph *g = get_glyph(atlas, cp, &pending, color);
+        if (!g) continue;
+        pen += kerning(atlas, prev, cp);
+        prev = cp;
+
+        if (g->rect.w > 0) {
+            if (pending == ATLAS_BATCH_GLYPHS) {
+                flush_batch(atlas, pending, color);
+                pending = 0;
+            }
+            g_batch[pending].src = g->rect;
+            g_batch[pending].dst = (SDL_Rect){pen, y, g->rect.w, g->rect.h};
+            pending++;
+        }
+        pen += g->advance;
+    }
+    flush_batch(atlas, pending, color);
+
+    return pen - x;
+}
+
+int glyph_atlas_measure(GlyphAtlas *atlas, const char *text, int len) {
+    if (!atlas || !text) return 0;
+
+    const char *end = len < 0 ? NULL : text + len;
+    int width = 0;
+    Uint32 prev = 0;
+    const char *p = text;
+    while (*p && (!end || p < end)) {
+        Uint32 cp = decode_utf8(&p);
+        const Glyph *g = get_glyph(atlas, cp, NULL, (SDL_Color){0, 0, 0, 0});
+        if (!g) continue;
+        width += kerning(atlas, prev, cp) + g->advance;
+        prev = cp;
+    }
+    return width;
+}
+
+void glyph_atlas_stats(const GlyphAtlas *atlas, GlyphAtlasStats *out) {
+    *out = atlas->stats;
+    out->glyphs = atlas->glyph_count;
+}
+
+int glyph_atlas_height(const GlyphAtlas *atlas) {
+    return atlas ? atlas->height : 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * Glyph Atlas - Cached glyph text renderer
+ *
+ * Each font gets one atlas texture holding its glyphs (rendered white) and
+ * their advances. Text is drawn as a batch of textured quads tinted per
+ * vertex, so drawing a string costs no allocation and no texture upload
+ * once its glyphs have been seen, whatever the string or color.
+ */
+
+#ifndef GLYPH_H
+#define GLYPH_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+typedef struct GlyphAtlas GlyphAtlas;
+
+/**
+ * Lookup counters (since creation)
+ */
+typedef struct {
+    unsigned long hits;         // Glyphs found in the atlas
+    unsigned long misses;       // Glyphs rasterized on demand
+    unsigned long resets;       // Times the full atlas started over
+    int glyphs;                 // Glyphs cached now
+} GlyphAtlasStats;
+
+/**
+ * Create an atlas for a font
+ * @param renderer Renderer the atlas texture belongs to
+ * @param font Font to rasterize (must outlive the atlas)
+ * @return Atlas, or NULL on failure
+ */
+GlyphAtlas* glyph_atlas_create(SDL_Renderer *renderer, TTF_Font *font);
+
+/**
+ * Destroy an atlas and its texture
+ * @param atlas Atlas (can be NULL)
+ */
+void glyph_atlas_destroy(GlyphAtlas *atlas);
+
+/**
+ * Draw UTF-8 text
+ * @param atlas Font atlas
+ * @param text UTF-8 string
+ * @param x Left edge
+ * @param y Top edge (line top, like TTF_RenderUTF8)
+ * @param color Text color, alpha included
+ * @return Width drawn in pixels
+ */
+int glyph_atlas_draw(GlyphAtlas *atlas, const char *text, int x, int y, SDL_Color color);
+
+/**
+ * Measure UTF-8 text (same layout as glyph_atlas_draw)
+ * @param atlas Font atlas
+ * @param text UTF-8 string
+ * @param len Bytes to measure, or -1 for the whole string
+ * @return Width in pixels
+ */
+int glyph_atlas_measure(GlyphAtlas *atlas, const char *text, int len);
+
+/**
+ * Read the lookup counters
+ * @param atlas Font atlas
+ * @param out Output: counters
+ */
+void glyph_atlas_stats(const GlyphAtlas *atlas, GlyphAtlasStats *out);
+
+/**
+ * Line height of the atlas font
+ */
+int glyph_atlas_height(const GlyphAtlas *atlas);
+
+#endif // GLYPH_H
@@ -0,0 +1,485 @@
+/**
+ * HTTP Client Implementation
+ *
+ * There is no TLS library on the device, so transfers still go through the
+ * curl CLI, but without the per-call overhead around it: curl is exec'd
+ * straight from fork() (no /bin/sh), headers and body arrive on one pipe
+ * (-D -) and are split in memory, and resolved addresses are cached and
+ * passed with --resolve. Status and ETag come from the final header block.
+ */
+
+#include "http.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Resolved host cache
+#define DNS_CACHE_SIZE 8
+#define DNS_CACHE_TTL_SEC 600
+
+// Room for the header blocks in front of the body
+#define HTTP_HEADER_ALLOWANCE (16 * 1024)
+
+// curl exit codes that mean the cached address is bad
+#define CURL_E_COULDNT_CONNECT 7
+#define CURL_E_OPERATION_TIMEDOUT 28
+
+struct HttpCall {
+    pid_t pid;
+    int fd;
+    FILE *stream;        // Streaming reads (http_open), NULL otherwise
+    size_t max_body;
+    int dns_slot;        // Cache entry used for --resolve, -1 = none
+};
+
+typedef struct {
+    char host[128];
+    int port;
+    char addr[INET6_ADDRSTRLEN];
+    time_t resolved_at;
+} DnsEntry;
+
+static DnsEntry g_dns[DNS_CACHE_SIZE];
+static int g_dns_next = 0;
+static pthread_mutex_t g_dns_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Split host and port out of an http(s) URL
+ * @return true if the URL has a host name (IP literals are left alone)
+ */
+static bool parse_host(const char *url, char *host, size_t host_size, int *port) {
+    const char *p;
+    if (strncmp(url, "https://", 8) == 0) {
+        p = url + 8;
+        *port = 443;
+    } else if (strncmp(url, "http://", 7) == 0) {
+        p = url + 7;
+        *port = 80;
+    } else {
+        return false;
+    }
+
+    if (*p == '[') return false;  // IPv6 literal
+
+    size_t len = strcspn(p, ":/?#");
+    if (len == 0 || len >= host_size) return false;
+    memcpy(host, p, len);
+    host[len] = '\0';
+
+    if (p[len] == ':') *port = atoi(p + len + 1);
+
+    struct in_addr tmp;
+    return inet_pton(AF_INET, host, &tmp) != 1;
+}
+
+/**
+ * Look up a host, from the cache when fresh
+ * @return Cache slot, or -1 if the name does not resolve
+ */
+static int dns_lookup(const char *host, int port, char *addr, size_t addr_size) {
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&g_dns_mutex);
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        DnsEntry *e = &g_dns[i];
+        if (e->host[0] && e->port == port && strcmp(e->host, host) == 0 &&
+            now - e->resolved_at < DNS_CACHE_TTL_SEC) {
+            snprintf(addr, addr_size, "%s", e->addr);
+            pthread_mutex_unlock(&g_dns_mutex);
+            return i;
+        }
+    }
+    pthread_mutex_unlock(&g_dns_mutex);
+
+    // Resolve outside the lock (it blocks on the network)
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, NULL, &hints, &res) != 0 || !res) {
+        return -1;
+    }
+
+    char text[INET6_ADDRSTRLEN] = {0};
+    for (struct addrinfo *ai = res; ai && !text[0]; ai = ai->ai_next) {
+        // Prefer IPv4; the handhelds rarely have a v6 route
+        if (ai->ai_family == AF_INET) {
+            inet_ntop(AF_INET, &((struct sockaddr_in *)ai->ai_addr)->sin_addr,
+                      text, sizeof(text));
+        }
+    }
+    freeaddrinfo(res);
+    if (!text[0]) return -1;
+
+    pthread_mutex_lock(&g_dns_mutex);
+    int slot = g_dns_next;
+    g_dns_next = (g_dns_next + 1) % DNS_CACHE_SIZE;
+    DnsEntry *e = &g_dns[slot];
+    snprintf(e->host, sizeof(e->host), "%s", host);
+    snprintf(e->addr, sizeof(e->addr), "%s", text);
+    e->port = port;
+    e->resolved_at = now;
+    pthread_mutex_unlock(&g_dns_mutex);
+
+    snprintf(addr, addr_size, "%s", text);
+    return slot;
+}
+
+/**
+ * Forget a cached address after a connect failure
+ */
+static void dns_invalidate(int slot) {
+    if (slot < 0) return;
+    pthread_mutex_lock(&g_dns_mutex);
+    g_dns[slot].host[0] = '\0';
+    pthread_mutex_unlock(&g_dns_mutex);
+}
+
+HttpCall* http_start(const HttpRequest *req) {
+    if (!req || !req->url) return NULL;
+
+    HttpCall *call = calloc(1, sizeof(HttpCall));
+    if (!call) return NULL;
+    call->max_body = req->max_body ? req->max_body : HTTP_DEFAULT_MAX_BODY;
+    call->dns_slot = -1;
+
+    // Build argv before forking (the child only dup2s and execs)
+    const char *argv[16 + 2 * HTTP_MAX_HEADERS];
+    int argc = 0;
+    char timeout[16];
+    char resolve[256];
+
+    snprintf(timeout, sizeof(timeout), "%d",
+             req->timeout_sec > 0 ? req->timeout_sec : HTTP_DEFAULT_TIMEOUT);
+
+    argv[argc++] = "curl";
+    argv[argc++] = "-s";
+    argv[argc++] = "-L";
+    argv[argc++] = "-D";
+    argv[argc++] = "-";
+    argv[argc++] = "-m";
+    argv[argc++] = timeout;
+    if (req->insecure) argv[argc++] = "-k";
+    if (req->user_agent) {
+        argv[argc++] = "-A";
+        argv[argc++] = req->user_agent;
+    }
+    for (int i = 0; i < HTTP_MAX_HEADERS && req->headers[i]; i++) {
+        argv[argc++] = "-H";
+        argv[argc++] = req->headers[i];
+    }
+    if (req->post_data) {
+        argv[argc++] = "-d";
+        argv[argc++] = req->post_data;
+    }
+
+    char host[128];
+    char addr[INET6_ADDRSTRLEN];
+    int port;
+    if (parse_host(req->url, host, sizeof(host), &port)) {
+        call->dns_slot = dns_lookup(host, port, addr, sizeof(addr));
+        if (call->dns_slot >= 0) {
+            snprintf(resolve, sizeof(resolve), "%s:%d:%s", host, port, addr);
+            argv[argc++] = "--resolve";
+            argv[argc++] = resolve;
+        }
+    }
+
+    argv[argc++] = req->url;
+    argv[argc] = NULL;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        free(call);
+        return NULL;
+    }
+    // Keep other workers' children from holding the pipe open
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        free(call);
+        return NULL;
+    }
+
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) dup2(null_fd, STDERR_FILENO);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execvp("curl", (char * const *)argv);
+        _exit(127);
+    }
+
+    close(fds[1]);
+    call->pid = pid;
+    call->fd = fds[0];
+    return call;
+}
+
+/**
+ * Wait for curl and drop a cached address that failed to connect
+ * @return curl's exit code (-1 if it was killed)
+ */
+static int reap_call(HttpCall *call) {
+    int wstatus = 0;
+    while (waitpid(call->pid, &wstatus, 0) < 0 && errno == EINTR) {}
+    int curl_ret = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : -1;
+
+    if (curl_ret == CURL_E_COULDNT_CONNECT || curl_ret == CURL_E_OPERATION_TIMEDOUT) {
+        dns_invalidate(call->dns_slot);
+    }
+    return curl_ret;
+}
+
+/**
+ * Split the header blocks (one per redirect hop) off the front of the
+ * output, leaving the final status/ETag in resp and returning the body
+ */
+static char* parse_headers(char *buf, size_t len, HttpResponse *resp, size_t *body_len) {
+    char *p = buf;
+    char *end = buf + len;
+
+    while (end - p >= 5 && strncmp(p, "HTTP/", 5) == 0) {
+        char *sp = memchr(p, ' ', end - p);
+        resp->status = sp ? atoi(sp + 1) : 0;
+        resp->etag[0] = '\0';
+
+        // Walk the header lines up to the blank line
+        char *line = p;
+        char *next = NULL;
+        while (line < end) {
+            char *nl = memchr(line, '\n', end - line);
+            if (!nl) {
+                next = end;
+                break;
+            }
+            size_t line_len = nl - line;
+            if (line_len > 0 && line[line_len - 1] == '\r') line_len--;
+            if (line_len == 0) {
+                next = nl + 1;
+                break;
+            }
+            if (line_len > 5 && strncasecmp(line, "etag:", 5) == 0) {
+                const char *v = line + 5;
+                size_t v_len = line_len - 5;
+                while (v_len > 0 && isspace((unsigned char)*v)) { v++; v_len--; }
+                if (v_len >= sizeof(resp->etag)) v_len = sizeof(resp->etag) - 1;
+                memcpy(resp->etag, v, v_len);
+                resp->etag[v_len] = '\0';
+            }
+            line = nl + 1;
+        }
+        if (!next) next = end;
+        p = next;
+
+        // Interim (1xx) and followed (3xx) responses are trailed by another block
+        bool interim = resp->status < 200 || (resp->status >= 300 && resp->status < 400);
+        if (!interim || end - p < 5 || strncmp(p, "HTTP/", 5) != 0) break;
+    }
+
+    *body_len = end - p;
+    return p;
+}
+
+bool http_finish(HttpCall *call, HttpResponse *resp) {
+    memset(resp, 0, sizeof(HttpResponse));
+    if (!call) return false;
+
+    size_t limit = call->max_body + HTTP_HEADER_ALLOWANCE;
+    size_t capacity = 16 * 1024;
+    size_t size = 0;
+    bool truncated = false;
+    char *buf = malloc(capacity);
+
+    while (buf) {
+        if (size + 4096 + 1 > capacity) {
+            if (capacity >= limit) {
+                truncated = true;
+                break;
+            }
+            char *grown = realloc(buf, capacity * 2);
+            if (!grown) break;
+            buf = grown;
+            capacity *= 2;
+        }
+        ssize_t n = read(call->fd, buf + size, capacity - size - 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        size += n;
+    }
+
+    close(call->fd);
+    if (truncated) kill(call->pid, SIGKILL);
+
+    int curl_ret = reap_call(call);
+    free(call);
+
+    if (!buf) return false;
+    if (curl_ret != 0 || truncated || size == 0) {
+        if (curl_ret != 0) fprintf(stderr, "[HTTP] curl failed with code %d\n", curl_ret);
+        if (truncated) fprintf(stderr, "[HTTP] Response too large\n");
+        free(buf);
+        return false;
+    }
+    buf[size] = '\0';
+
+    size_t body_len = 0;
+    char *body = parse_headers(buf, size, resp, &body_len);
+    if (resp->status == 0) {
+        free(buf);
+        return false;
+    }
+
+    if (body_len > 0) {
+        memmove(buf, body, body_len);
+        buf[body_len] = '\0';
+        resp->body = buf;
+        resp->body_len = body_len;
+    } else {
+        free(buf);
+    }
+    return true;
+}
+
+bool http_request(const HttpRequest *req, HttpResponse *resp) {
+    HttpCall *call = http_start(req);
+    if (!call) {
+        memset(resp, 0, sizeof(HttpResponse));
+        fprintf(stderr, "[HTTP] Failed to start curl: %s\n", strerror(errno));
+        return false;
+    }
+    return http_finish(call, resp);
+}
+
+bool http_open(const HttpRequest *req, HttpCall **out, HttpResponse *resp) {
+    memset(resp, 0, sizeof(HttpResponse));
+    *out = NULL;
+
+    HttpCall *call = http_start(req);
+    if (!call) return false;
+
+    call->stream = fdopen(call->fd, "r");
+    if (!call->stream) {
+        close(call->fd);
+        kill(call->pid, SIGKILL);
+        reap_call(call);
+        free(call);
+        return false;
+    }
+
+    // Header blocks line by line, leaving the stream at the body
+    char line[1024];
+    bool in_block = false;
+    while (fgets(line, sizeof(line), call->stream)) {
+        size_t len = strcspn(line, "\r\n");
+        if (!in_block) {
+            if (strncmp(line, "HTTP/", 5) != 0) break;
+            char *sp = strchr(line, ' ');
+            resp->status = sp ? atoi(sp + 1) : 0;
+            resp->etag[0] = '\0';
+            in_block = true;
+            continue;
+        }
+        if (len == 0) {
+            // Interim (1xx) and followed (3xx) responses are trailed by another block
+            bool interim = resp->status < 200 || (resp->status >= 300 && resp->status < 400);
+            int c = interim ? fgetc(call->stream) : EOF;
+            if (c == EOF) break;
+            ungetc(c, call->stream);
+            if (c != 'H') break;
+            in_block = false;
+            continue;
+        }
+        if (len > 5 && strncasecmp(line, "etag:", 5) == 0) {
+            const char *v = line + 5;
+            size_t v_len = len - 5;
+            while (v_len > 0 && isspace((unsigned char)*v)) { v++; v_len--; }
+            if (v_len >= sizeof(resp->etag)) v_len = sizeof(resp->etag) - 1;
+            memcpy(resp->etag, v, v_len);
+            resp->etag[v_len] = '\0';
+        }
+    }
+
+    if (resp->status == 0) {
+        http_close(call, true);
+        return false;
+    }
+
+    *out = call;
+    return true;
+}
+
+size_t http_read(HttpCall *call, void *buf, size_t size) {
+    if (!call || !call->stream) return 0;
+    return fread(buf, 1, size, call->stream);
+}
+
+void http_cancel(HttpCall *call) {
+    if (call) kill(call->pid, SIGTERM);
+}
+
+bool http_close(HttpCall *call, bool abort) {
+    if (!call) return false;
+
+    if (abort) kill(call->pid, SIGTERM);
+    if (call->stream) {
+        fclose(call->stream);
+    } else {
+        close(call->fd);
+    }
+
+    int curl_ret = reap_call(call);
+    free(call);
+
+    if (!abort && curl_ret != 0) {
+        fprintf(stderr, "[HTTP] curl failed with code %d\n", curl_ret);
+    }
+    return !abort && curl_ret == 0;
+}
+
+void http_response_free(HttpResponse *resp) {
+    if (!resp) return;
+    free(resp->body);
+    resp->body = NULL;
+    resp->body_len = 0;
+}
+
+void http_url_encode(const char *src, char *dst, size_t dst_size) {
+    static const char *hex = "0123456789ABCDEF";
+    size_t j = 0;
+
+    for (size_t i = 0; src[i] && j < dst_size - 4; i++) {
+        unsigned char c = (unsigned char)src[i];
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            dst[j++] = c;
+        } else if (c == ' ') {
+            dst[j++] = '+';
+        } else {
+            dst[j++] = '%';
+            dst[j++] = hex[c >> 4];
+            dst[j++] = hex[c & 0x0F];
+        }
+    }
+    dst[j] = '\0';
+}
@@ -0,0 +1,122 @@
+/**
+ * HTTP Client - Shared curl runner for Web API calls
+ *
+ * Requests run curl directly (no shell, no temp files) and the response
+ * is read from a pipe into memory, ready for cJSON_Parse, or streamed
+ * chunk by chunk for downloads. Host names are
+ * resolved in-process once and handed to curl with --resolve, so repeat
+ * calls to the same API skip the DNS lookup.
+ */
+
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HTTP_MAX_HEADERS 8
+#define HTTP_DEFAULT_TIMEOUT 15      // Seconds for the whole transfer
+#define HTTP_DEFAULT_MAX_BODY (256 * 1024)
+
+/**
+ * Request description (all strings are borrowed for the call)
+ */
+typedef struct {
+    const char *url;
+    const char *post_data;                 // Form body, NULL for GET
+    const char *headers[HTTP_MAX_HEADERS]; // "Name: value", NULL-terminated
+    const char *user_agent;                // NULL = curl default
+    int timeout_sec;                       // 0 = HTTP_DEFAULT_TIMEOUT
+    size_t max_body;                       // 0 = HTTP_DEFAULT_MAX_BODY
+    bool insecure;                         // Skip TLS verification (-k)
+} HttpRequest;
+
+/**
+ * Response (body is malloc'd, free with http_response_free)
+ */
+typedef struct {
+    int status;          // HTTP status of the final response, 0 = no response
+    char *body;          // NUL-terminated, NULL if empty
+    size_t body_len;
+    char etag[128];      // ETag header, empty if none
+} HttpResponse;
+
+/**
+ * In-flight request handle
+ */
+typedef struct HttpCall HttpCall;
+
+/**
+ * Start a request without waiting for the response
+ * @param req Request to send
+ * @return Handle for http_finish(), or NULL if curl could not be started
+ */
+HttpCall* http_start(const HttpRequest *req);
+
+/**
+ * Wait for a started request and read its response
+ * Always consumes the handle.
+ * @param call Handle from http_start()
+ * @param resp Output (zeroed first)
+ * @return true if a complete response was received (any status)
+ */
+bool http_finish(HttpCall *call, HttpResponse *resp);
+
+/**
+ * Perform a request and wait for the response
+ * @param req Request to send
+ * @param resp Output (zeroed first)
+ * @return true if a complete response was received (any status)
+ */
+bool http_request(const HttpRequest *req, HttpResponse *resp);
+
+/**
+ * Start a request and read its headers, leaving the body to stream
+ * For large downloads that are processed as they arrive.
+ * @param req Request to send (max_body is ignored)
+ * @param out Output: handle for http_read()/http_close()
+ * @param resp Output: status and ETag (no body)
+ * @return true if response headers were received
+ */
+bool http_open(const HttpRequest *req, HttpCall **out, HttpResponse *resp);
+
+/**
+ * Read the next chunk of a streamed body (blocking)
+ * @param call Handle from http_open()
+ * @param buf Destination
+ * @param size Bytes wanted
+ * @return Bytes read (less than size only at the end of the body)
+ */
+size_t http_read(HttpCall *call, void *buf, size_t size);
+
+/**
+ * Stop a streamed transfer from another thread
+ * A blocked http_read() then returns the bytes it has; the owner still
+ * calls http_close().
+ * @param call Handle from http_open()
+ */
+void http_cancel(HttpCall *call);
+
+/**
+ * Finish a streamed request
+ * @param call Handle from http_open() (consumed)
+ * @param abort Stop the transfer instead of waiting for it to end
+ * @return true if the whole body was transferred
+ */
+bool http_close(HttpCall *call, bool abort);
+
+/**
+ * Free a response body
+ * @param resp Response from http_finish/http_request
+ */
+void http_response_free(HttpResponse *resp);
+
+/**
+ * URL encode a string for use in query parameters (space becomes '+')
+ * @param src Input string
+ * @param dst Output buffer
+ * @param dst_size Output buffer size
+ */
+void http_url_encode(const char *src, char *dst, size_t dst_size);
+
+#endif // HTTP_H
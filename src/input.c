@@ -12,6 +12,12 @@
  * - JOY_L1 = 4, JOY_R1 = 5 (shoulder buttons)
  * - JOY_SELECT = 6, JOY_START = 7
  * - JOY_MENU = 8
+ *
+ * On Linux an input thread sleeps in epoll on the power and AVRCP evdev
+ * devices and wakes the main loop with an SDL user event when either has
+ * data, or when a held Left/Right is due its next seek step. It never reads
+ * the devices: the poll functions still do that on the main thread, so the
+ * exclusive grab and the drain after wake work as before.
  */
 
 #include "input.h"
@@ -19,11 +25,15 @@
 #include <stdbool.h>
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
 
 #ifdef __linux__
 #include <fcntl.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <linux/input.h>
 #endif
 
@@ -44,6 +54,7 @@
 #define KBRD_START   SDLK_RETURN  // Start
 #define KBRD_SELECT  SDLK_RSHIFT  // Select
 #define KBRD_POWER   SDLK_p       // Power button (suspend) - P key on keyboard
+#define KBRD_HUD     SDLK_F3      // Perf HUD (Start+Select on the device)
 
 // Trimui Brick joystick button indices (from NextUI platform.h)
 // These match the official NextUI mapping for tg5040 platform
@@ -70,7 +81,7 @@ static Uint8 g_button_state[16] = {0};
 static Uint32 g_button_cooldown[16] = {0};
 #define BUTTON_COOLDOWN_MS 250  // Minimum ms between button presses
 
-// Start button tracking for combos (Start+B = exit)
+// Start button tracking for combos (Start+B = exit, Start+Select = perf HUD)
 static bool g_start_held = false;
 static bool g_start_combo_used = false;  // True if combo was triggered while Start held
 
@@ -81,6 +92,12 @@ static Uint8 g_hat_state = SDL_HAT_CENTERED;
 static Uint32 g_seek_start_time = 0;  // When Left/Right was first pressed
 static int g_seek_direction = 0;       // -1 for left, +1 for right, 0 for none
 static Uint32 g_last_seek_tick = 0;    // Last time we returned a seek amount
+#define SEEK_STEP_MS 150                // Minimum ms between seek steps
+
+// Main loop wake-up (see input.h)
+static Uint32 g_wake_event = (Uint32)-1;
+static SDL_atomic_t g_wake_pending;    // Wake event queued, not seen yet
+static SDL_atomic_t g_seek_held;       // input_is_seeking(), for the input thread
 
 // L2/R2 trigger debouncing (fire once per press, not continuously)
 static bool g_l2_triggered = false;
@@ -136,8 +153,137 @@ static int find_avrcp_device(void) {
 }
 #endif
 
+/**
+ * Queue the wake event unless one is already waiting
+ */
+static void push_wake(void) {
+    if (g_wake_event == (Uint32)-1) return;
+    if (!SDL_AtomicCAS(&g_wake_pending, 0, 1)) return;
+
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = g_wake_event;
+    if (SDL_PushEvent(&event) < 1) {
+        SDL_AtomicSet(&g_wake_pending, 0);
+    }
+}
 
-InputAction input_handle_event(const SDL_Event *event) {
+#ifdef __linux__
+static pthread_t g_input_thread;
+static bool g_input_thread_running = false;
+static int g_epoll_fd = -1;
+static int g_control_fd = -1;          // eventfd: seek hold changed, or stop
+static volatile bool g_input_stop = false;
+
+/**
+ * Input thread: wait for device data (edge-triggered, the main thread
+ * reads it) and turn it into a wake event; while a seek is held, also
+ * wake once per seek step
+ */
+static void* input_thread_func(void *arg) {
+    (void)arg;
+    struct epoll_event events[4];
+
+    while (!g_input_stop) {
+        int timeout = SDL_AtomicGet(&g_seek_held) ? SEEK_STEP_MS : -1;
+        int n = epoll_wait(g_epoll_fd, events, 4, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            printf("[INPUT] epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+
+        bool device_data = (n == 0);  // Timeout: seek step due
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == g_control_fd) {
+                uint64_t value;
+                ssize_t r = read(g_control_fd, &value, sizeof(value));  // Clear the counter
+                (void)r;
+            } else {
+                device_data = true;
+            }
+        }
+        if (device_data && !g_input_stop) push_wake();
+    }
+    return NULL;
+}
+
+/**
+ * Add a device to the epoll set (edge-triggered)
+ */
+static void watch_fd(int fd) {
+    if (fd < 0) return;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = fd;
+    if (epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        printf("[INPUT] Warning: Could not watch fd %d: %s\n", fd, strerror(errno));
+    }
+}
+
+/**
+ * Nudge the input thread to re-read its state
+ */
+static void kick_input_thread(void) {
+    if (g_control_fd < 0) return;
+    uint64_t one = 1;
+    ssize_t r = write(g_control_fd, &one, sizeof(one));  // Fails only if already pending
+    (void)r;
+}
+
+/**
+ * Start the input thread (after the devices are open)
+ */
+static void start_input_thread(void) {
+    g_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    g_control_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_epoll_fd < 0 || g_control_fd < 0) {
+        printf("[INPUT] Warning: No input thread (%s), polling per frame\n", strerror(errno));
+        return;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = g_control_fd;
+    epoll_ctl(g_epoll_fd, EPOLL_CTL_ADD, g_control_fd, &ev);
+    watch_fd(g_power_fd);
+    watch_fd(g_volume_fd);
+
+    g_input_stop = false;
+    if (pthread_create(&g_input_thread, NULL, input_thread_func, NULL) != 0) {
+        printf("[INPUT] Warning: Could not start input thread, polling per frame\n");
+        return;
+    }
+    g_input_thread_running = true;
+}
+
+/**
+ * Stop the input thread and close its fds
+ */
+static void stop_input_thread(void) {
+    if (g_input_thread_running) {
+        g_input_stop = true;
+        kick_input_thread();
+        pthread_join(g_input_thread, NULL);
+        g_input_thread_running = false;
+    }
+    if (g_epoll_fd >= 0) {
+        close(g_epoll_fd);
+        g_epoll_fd = -1;
+    }
+    if (g_control_fd >= 0) {
+        close(g_control_fd);
+        g_control_fd = -1;
+    }
+}
+#endif
+
+/**
+ * Map one SDL event to an action (updates button/hat/seek state)
+ */
+static InputAction map_event(const SDL_Event *event) {
     switch (event->type) {
         case SDL_KEYDOWN:
             // Ignore key repeats
@@ -160,6 +306,7 @@ InputAction input_handle_event(const SDL_Event *event) {
                 case KBRD_START:  return INPUT_MENU;
                 case KBRD_SELECT: return INPUT_SHUFFLE;
                 case KBRD_POWER:  return INPUT_SUSPEND;  // P key for suspend on desktop
+                case KBRD_HUD:    return INPUT_PERF_HUD;
                 case SDLK_ESCAPE:return INPUT_BACK;
                 case SDLK_h:     return INPUT_HELP;  // H key for help on desktop
                 // Hardware volume keys (Trimui Brick)
@@ -210,7 +357,13 @@ InputAction input_handle_event(const SDL_Event *event) {
                 case JOY_R1:
                     return INPUT_NEXT;     // R1 - next track
                 // L2/R2 handled via axis (analog triggers)
-                case JOY_SELECT: return INPUT_SHUFFLE;  // Select - shuffle/dim toggle
+                case JOY_SELECT:
+                    // Check for Start+Select combo (perf HUD)
+                    if (g_start_held) {
+                        g_start_combo_used = true;
+                        return INPUT_PERF_HUD;
+                    }
+                    return INPUT_SHUFFLE;  // Select - shuffle/dim toggle
                 case JOY_START:
                     // Track Start press for combos
                     g_start_held = true;
@@ -354,6 +507,24 @@ InputAction input_handle_event(const SDL_Event *event) {
     return INPUT_NONE;
 }
 
+InputAction input_handle_event(const SDL_Event *event) {
+    if (event->type == g_wake_event) {
+        return INPUT_NONE;  // Only there to end the main loop's wait
+    }
+
+    InputAction action = map_event(event);
+
+    // Let the input thread time the seek steps of a hold
+    bool seeking = input_is_seeking();
+    if (seeking != (SDL_AtomicGet(&g_seek_held) != 0)) {
+        SDL_AtomicSet(&g_seek_held, seeking ? 1 : 0);
+#ifdef __linux__
+        kick_input_thread();
+#endif
+    }
+    return action;
+}
+
 InputAction input_poll_holds(void) {
     // No hold detection needed - X triggers help directly
     // Keep function for potential future use
@@ -372,8 +543,8 @@ int input_get_seek_amount(void) {
     Uint32 now = SDL_GetTicks();
     Uint32 held_ms = now - g_seek_start_time;
 
-    // Rate limit: only return seek amount every 150ms
-    if (g_last_seek_tick > 0 && now - g_last_seek_tick < 150) {
+    // Rate limit: only return seek amount every SEEK_STEP_MS
+    if (g_last_seek_tick > 0 && now - g_last_seek_tick < SEEK_STEP_MS) {
         return 0;
     }
     g_last_seek_tick = now;
@@ -399,6 +570,9 @@ int input_get_seek_amount(void) {
 }
 
 bool input_init(void) {
+    g_wake_event = SDL_RegisterEvents(1);
+    SDL_AtomicSet(&g_wake_pending, 0);
+
 #ifdef __linux__
     // Open power button device (non-blocking)
     g_power_fd = open(POWER_BUTTON_DEVICE, O_RDONLY | O_NONBLOCK);
@@ -428,12 +602,15 @@ bool input_init(void) {
     } else {
         printf("[INPUT] No AVRCP device found (BT headphone not connected?)\n");
     }
+
+    start_input_thread();
 #endif
     return true;
 }
 
 void input_cleanup(void) {
 #ifdef __linux__
+    stop_input_thread();
     if (g_power_fd >= 0) {
         // Release exclusive grab before closing
         ioctl(g_power_fd, EVIOCGRAB, 0);
@@ -451,6 +628,9 @@ void input_cleanup(void) {
 }
 
 InputAction input_poll_power(void) {
+    // Reading all devices now; data arriving from here on wakes again
+    SDL_AtomicSet(&g_wake_pending, 0);
+
 #ifdef __linux__
     if (g_power_fd < 0) {
         return INPUT_NONE;
@@ -1,5 +1,10 @@
 /**
  * Input Handler - D-Pad and button mapping for Trimui Brick
+ *
+ * The power and AVRCP devices are read directly (evdev), not through SDL.
+ * A background thread watches them and ends the main loop's
+ * SDL_WaitEventTimeout() when they have data, so waiting for the next
+ * frame doesn't delay input.
  */
 
 #ifndef INPUT_H
@@ -28,6 +33,7 @@ typedef enum {
     INPUT_FAVORITE,  // Y button tap - toggle favorite
     INPUT_HELP,      // Y button hold - show help overlay
     INPUT_EXIT,      // Start + B combo - exit app
+    INPUT_PERF_HUD,  // Start + Select combo - toggle perf HUD
     INPUT_VOL_UP,    // Hardware volume up
     INPUT_VOL_DOWN,  // Hardware volume down
     INPUT_SUSPEND    // Power button - system suspend
@@ -35,6 +41,7 @@ typedef enum {
 
 /**
  * Handle SDL event and return corresponding action
+ * The input thread's wake event maps to INPUT_NONE.
  * @param event SDL event to process
  * @return Input action or INPUT_NONE
  */
@@ -66,6 +73,7 @@ bool input_is_seeking(void);
 
 /**
  * Initialize input system (opens power button device on Linux)
+ * Call after SDL_Init(); starts the input thread on Linux.
  * @return true on success
  */
 bool input_init(void);
@@ -77,6 +85,7 @@ void input_cleanup(void);
 
 /**
  * Poll power button (reads from /dev/input/event1 on Linux)
+ * Call before input_poll_volume() on each pass: it re-arms the wake event.
  * @return INPUT_SUSPEND if power pressed, INPUT_NONE otherwise
  */
 InputAction input_poll_power(void);
@@ -0,0 +1,134 @@
+/**
+ * I/O Scheduler Implementation
+ *
+ * The gate is a counter of priority reads in flight plus a hold deadline,
+ * both under one mutex. Bulk bandwidth is paced by reserving time slots:
+ * each bulk read pushes the shared "next free" time forward by
+ * bytes / rate, and its caller sleeps until the slot it got.
+ */
+
+#include "iosched.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// Kernel ioprio encoding (linux/ioprio.h is not in every toolchain)
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int g_priority_active = 0;       // Priority reads in flight
+static uint64_t g_hold_until_us = 0;    // Bulk paused until then
+static uint64_t g_bulk_next_us = 0;     // Next free bulk bandwidth slot
+
+static __thread IoClass t_class = IO_CLASS_FOREGROUND;
+
+/**
+ * Monotonic time in microseconds
+ */
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/**
+ * Apply a class to the calling thread's kernel I/O priority
+ */
+static void set_ioprio(IoClass cls) {
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    int value;
+    switch (cls) {
+        case IO_CLASS_AUDIO:      value = (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | 0; break;
+        case IO_CLASS_FOREGROUND: value = (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | 4; break;
+        default:                  value = (IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT); break;
+    }
+    // who = 0 is the calling thread
+    syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, value);
+#else
+    (void)cls;
+#endif
+}
+
+void iosched_set_class(IoClass cls) {
+    if (cls == t_class) return;
+    t_class = cls;
+    set_ioprio(cls);
+}
+
+IoClass iosched_get_class(void) {
+    return t_class;
+}
+
+void iosched_begin(void) {
+    if (t_class == IO_CLASS_BULK) return;
+    pthread_mutex_lock(&g_mutex);
+    g_priority_active++;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void iosched_end(void) {
+    if (t_class == IO_CLASS_BULK) return;
+    pthread_mutex_lock(&g_mutex);
+    if (g_priority_active > 0) g_priority_active--;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void iosched_hold(int ms) {
+    if (ms <= 0) return;
+    uint64_t until = now_us() + (uint64_t)ms * 1000u;
+
+    pthread_mutex_lock(&g_mutex);
+    if (until > g_hold_until_us) g_hold_until_us = until;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+bool iosched_gate(size_t bytes, const volatile bool *cancel) {
+    if (t_class != IO_CLASS_BULK) return true;
+
+    // Wait out priority reads and holds
+    pthread_mutex_lock(&g_mutex);
+    while (g_priority_active > 0 || now_us() < g_hold_until_us) {
+        pthread_mutex_unlock(&g_mutex);
+        if (cancel && *cancel) return false;
+        usleep(IOSCHED_POLL_MS * 1000);
+        pthread_mutex_lock(&g_mutex);
+    }
+
+    // Reserve a bandwidth slot
+    uint64_t now = now_us();
+    uint64_t start = g_bulk_next_us > now ? g_bulk_next_us : now;
+    g_bulk_next_us = start + (uint64_t)bytes * 1000000u / IOSCHED_BULK_RATE;
+    pthread_mutex_unlock(&g_mutex);
+
+    if (start > now) usleep((useconds_t)(start - now));
+    return !(cancel && *cancel);
+}
+
+size_t iosched_read(FILE *f, void *buf, size_t size) {
+    if (t_class != IO_CLASS_BULK) {
+        iosched_begin();
+        size_t n = fread(buf, 1, size, f);
+        iosched_end();
+        return n;
+    }
+
+    size_t total = 0;
+    while (total < size) {
+        size_t want = size - total;
+        if (want > IOSCHED_CHUNK) want = IOSCHED_CHUNK;
+        iosched_gate(want, NULL);
+
+        size_t n = fread((uint8_t *)buf + total, 1, want, f);
+        total += n;
+        if (n < want) break;
+    }
+    return total;
+}
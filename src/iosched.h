@@ -0,0 +1,92 @@
+/**
+ * I/O Scheduler - Priority gate for SD card reads
+ *
+ * Playback, the foreground browser and bulk background work (library
+ * builds, MP3 index scans, warmup) all read from the same slow SD card.
+ * Every thread carries an I/O class: the kernel gets a matching ioprio,
+ * and bulk readers go through a gate that holds them while a priority
+ * read is in flight or a track transition is near, and caps their
+ * bandwidth otherwise. Playback and the browser never wait on the gate.
+ */
+
+#ifndef IOSCHED_H
+#define IOSCHED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Bulk reads are split into chunks of this size (one gate pass each)
+#define IOSCHED_CHUNK (256 * 1024)
+
+// Bandwidth cap for bulk readers (bytes per second, all threads together)
+#define IOSCHED_BULK_RATE (4 * 1024 * 1024)
+
+// How long bulk I/O stays paused after a track load or seek
+#define IOSCHED_HOLD_MS 1500
+
+// Bulk I/O also pauses this close to the end of a track
+#define IOSCHED_TRACK_END_SEC 3
+
+// Gate re-check interval while held
+#define IOSCHED_POLL_MS 20
+
+/**
+ * I/O class of a thread (lower value wins)
+ */
+typedef enum {
+    IO_CLASS_AUDIO,         // Playback and preload
+    IO_CLASS_FOREGROUND,    // The user is waiting (browser, covers)
+    IO_CLASS_BULK           // Nobody is waiting
+} IoClass;
+
+/**
+ * Set the calling thread's I/O class (also its kernel ioprio on Linux)
+ * Threads start as IO_CLASS_FOREGROUND.
+ * @param cls I/O class
+ */
+void iosched_set_class(IoClass cls);
+
+/**
+ * Get the calling thread's I/O class
+ * @return I/O class
+ */
+IoClass iosched_get_class(void);
+
+/**
+ * Mark the start of a priority read (bulk readers wait until it ends)
+ * No-op for bulk threads. Pair with iosched_end().
+ */
+void iosched_begin(void);
+
+/**
+ * Mark the end of a priority read
+ */
+void iosched_end(void);
+
+/**
+ * Pause bulk I/O for a while (track loads, seeks, transitions)
+ * @param ms Duration from now; extends a hold already in place
+ */
+void iosched_hold(int ms);
+
+/**
+ * Wait until bulk I/O may proceed, then charge its bandwidth budget
+ * Returns at once for non-bulk threads.
+ * @param bytes Bytes about to be read (0 = just wait for the gate)
+ * @param cancel Optional flag that ends the wait early
+ * @return false if cancelled
+ */
+bool iosched_gate(size_t bytes, const volatile bool *cancel);
+
+/**
+ * fread() through the gate
+ * Bulk threads read in IOSCHED_CHUNK pieces, passing the gate before each.
+ * @param f Open file
+ * @param buf Destination
+ * @param size Bytes wanted
+ * @return Bytes read
+ */
+size_t iosched_read(FILE *f, void *buf, size_t size);
+
+#endif // IOSCHED_H
@@ -0,0 +1,268 @@
+/**
+ * Job System Implementation
+ *
+ * A fixed table of job slots guarded by one mutex/cond. Workers take the
+ * oldest queued job of the highest class that its concurrency cap allows;
+ * finished jobs with a callback wait in the table until jobs_poll().
+ */
+
+#include "jobs.h"
+#include "trace.h"
+#include "iosched.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_RUNNING,
+    SLOT_FINISHED       // Waiting for jobs_poll() to run its callback
+} SlotState;
+
+/**
+ * Job slot
+ */
+typedef struct {
+    SlotState state;
+    JobId id;
+    JobClass cls;
+    const char *name;
+    JobFunc run;
+    JobDone done;
+    void *arg;
+    unsigned int seq;           // Submission order within the table
+    volatile bool cancel;
+} JobSlot;
+
+static JobSlot g_slots[JOBS_MAX];
+static JobId g_next_id = 1;
+static unsigned int g_next_seq = 0;
+static int g_running[JOB_CLASS_COUNT];
+
+static pthread_t g_workers[JOBS_WORKERS];
+static int g_worker_count = 0;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static bool g_shutdown = false;
+
+/**
+ * Whether another job of a class may start (caller holds g_mutex)
+ */
+static bool class_has_room(JobClass cls) {
+    if (cls == JOB_CLASS_AUDIO) return true;
+
+    int non_audio = g_running[JOB_CLASS_INTERACTIVE] + g_running[JOB_CLASS_BACKGROUND];
+    if (non_audio >= JOBS_NON_AUDIO_MAX) return false;
+    if (cls == JOB_CLASS_BACKGROUND && g_running[JOB_CLASS_BACKGROUND] >= JOBS_BACKGROUND_MAX) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Next job to run (caller holds g_mutex)
+ * @return Slot index, or -1 if nothing may start
+ */
+static int next_job(void) {
+    for (int cls = 0; cls < JOB_CLASS_COUNT; cls++) {
+        if (!class_has_room((JobClass)cls)) continue;
+
+        int best = -1;
+        for (int i = 0; i < JOBS_MAX; i++) {
+            JobSlot *s = &g_slots[i];
+            if (s->state != SLOT_QUEUED || s->cls != (JobClass)cls) continue;
+            if (best < 0 || (int)(s->seq - g_slots[best].seq) < 0) best = i;
+        }
+        if (best >= 0) return best;
+    }
+    return -1;
+}
+
+/**
+ * Mark a slot finished, or free it if nobody wants the callback
+ * (caller holds g_mutex)
+ */
+static void finish_slot(JobSlot *s) {
+    s->state = s->done ? SLOT_FINISHED : SLOT_FREE;
+}
+
+/**
+ * Run one slot outside the lock (caller holds g_mutex)
+ */
+static void run_slot(JobSlot *s) {
+    s->state = SLOT_RUNNING;
+    g_running[s->cls]++;
+    pthread_mutex_unlock(&g_mutex);
+
+    // Job class picks the thread's I/O class; audio and interactive jobs
+    // count as priority reads for their whole run
+    static const IoClass io_classes[JOB_CLASS_COUNT] = {
+        IO_CLASS_AUDIO, IO_CLASS_FOREGROUND, IO_CLASS_BULK
+    };
+    iosched_set_class(io_classes[s->cls]);
+
+    trace_begin(s->name);
+    iosched_begin();
+    s->run(s->arg, &s->cancel);
+    iosched_end();
+    trace_end();
+
+    pthread_mutex_lock(&g_mutex);
+    g_running[s->cls]--;
+    finish_slot(s);
+    pthread_cond_broadcast(&g_cond);  // A capped class may have room now
+}
+
+/**
+ * Pool worker
+ */
+static void* worker_func(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_mutex);
+    while (!g_shutdown) {
+        int index = next_job();
+        if (index < 0) {
+            pthread_cond_wait(&g_cond, &g_mutex);
+            continue;
+        }
+        run_slot(&g_slots[index]);
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return NULL;
+}
+
+/**
+ * Find a job's slot (caller holds g_mutex)
+ */
+static JobSlot* find_slot(JobId id) {
+    for (int i = 0; i < JOBS_MAX; i++) {
+        if (g_slots[i].state != SLOT_FREE && g_slots[i].id == id) return &g_slots[i];
+    }
+    return NULL;
+}
+
+void jobs_init(void) {
+    if (g_worker_count > 0) return;
+
+    pthread_mutex_lock(&g_mutex);
+    memset(g_slots, 0, sizeof(g_slots));
+    memset(g_running, 0, sizeof(g_running));
+    g_shutdown = false;
+    pthread_mutex_unlock(&g_mutex);
+
+    for (int i = 0; i < JOBS_WORKERS; i++) {
+        if (pthread_create(&g_workers[g_worker_count], NULL, worker_func, NULL) == 0) {
+            g_worker_count++;
+        }
+    }
+
+    if (g_worker_count == 0) {
+        fprintf(stderr, "[JOBS] No worker threads, jobs will run inline\n");
+    } else {
+        printf("[JOBS] Pool started (%d workers)\n", g_worker_count);
+    }
+}
+
+void jobs_shutdown(void) {
+    pthread_mutex_lock(&g_mutex);
+    g_shutdown = true;
+    for (int i = 0; i < JOBS_MAX; i++) {
+        JobSlot *s = &g_slots[i];
+        s->cancel = true;
+        if (s->state == SLOT_QUEUED) finish_slot(s);
+    }
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+
+    for (int i = 0; i < g_worker_count; i++) {
+        pthread_join(g_workers[i], NULL);
+    }
+    g_worker_count = 0;
+
+    // Let submitters free what they handed over
+    jobs_poll();
+}
+
+JobId jobs_submit(JobClass cls, const char *name, JobFunc run, JobDone done, void *arg) {
+    if (!run || cls < 0 || cls >= JOB_CLASS_COUNT) return 0;
+
+    pthread_mutex_lock(&g_mutex);
+    JobSlot *s = NULL;
+    for (int i = 0; i < JOBS_MAX && !s; i++) {
+        if (g_slots[i].state == SLOT_FREE) s = &g_slots[i];
+    }
+    if (!s || g_shutdown) {
+        pthread_mutex_unlock(&g_mutex);
+        fprintf(stderr, "[JOBS] Cannot queue %s\n", name);
+        return 0;
+    }
+
+    s->id = g_next_id++;
+    if (g_next_id == 0) g_next_id = 1;
+    s->cls = cls;
+    s->name = name;
+    s->run = run;
+    s->done = done;
+    s->arg = arg;
+    s->seq = g_next_seq++;
+    s->cancel = false;
+    s->state = SLOT_QUEUED;
+    JobId id = s->id;
+
+    if (g_worker_count == 0) {
+        // No pool: run now, callback still goes through jobs_poll()
+        run_slot(s);
+    } else {
+        pthread_cond_broadcast(&g_cond);
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return id;
+}
+
+bool jobs_cancel(JobId id) {
+    if (id == 0) return false;
+
+    pthread_mutex_lock(&g_mutex);
+    JobSlot *s = find_slot(id);
+    bool active = s && (s->state == SLOT_QUEUED || s->state == SLOT_RUNNING);
+    if (active) {
+        s->cancel = true;
+        if (s->state == SLOT_QUEUED) finish_slot(s);
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return active;
+}
+
+int jobs_poll(void) {
+    JobDone done[JOBS_MAX];
+    void *args[JOBS_MAX];
+    bool cancelled[JOBS_MAX];
+    int count = 0;
+
+    pthread_mutex_lock(&g_mutex);
+
+    // Oldest first, so callbacks arrive in submission order
+    while (count < JOBS_MAX) {
+        int oldest = -1;
+        for (int i = 0; i < JOBS_MAX; i++) {
+            if (g_slots[i].state != SLOT_FINISHED) continue;
+            if (oldest < 0 || (int)(g_slots[i].seq - g_slots[oldest].seq) < 0) oldest = i;
+        }
+        if (oldest < 0) break;
+
+        JobSlot *s = &g_slots[oldest];
+        done[count] = s->done;
+        args[count] = s->arg;
+        cancelled[count] = s->cancel;
+        count++;
+        s->state = SLOT_FREE;
+    }
+    pthread_mutex_unlock(&g_mutex);
+
+    for (int i = 0; i < count; i++) {
+        done[i](args[i], cancelled[i]);
+    }
+    return count;
+}
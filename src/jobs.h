@@ -0,0 +1,95 @@
+/**
+ * Job System - Shared worker pool for background work
+ *
+ * Jobs are queued in three priority classes and run on a fixed pool.
+ * Each job gets a cancellation flag it can poll, and an optional
+ * completion callback that jobs_poll() delivers on the main loop, so
+ * results can touch SDL and UI state directly. One worker is always kept
+ * free of non-audio jobs, so a burst of covers or scans never delays the
+ * preloader that gapless playback depends on.
+ */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+
+// Pool threads
+#define JOBS_WORKERS 3
+
+// Queued + running + undelivered jobs
+#define JOBS_MAX 64
+
+// Workers that may run non-audio / background jobs at the same time
+#define JOBS_NON_AUDIO_MAX (JOBS_WORKERS - 1)
+#define JOBS_BACKGROUND_MAX 1
+
+/**
+ * Priority class (lower value runs first)
+ */
+typedef enum {
+    JOB_CLASS_AUDIO,        // Playback depends on it (preload)
+    JOB_CLASS_INTERACTIVE,  // The user is waiting to see it (covers, searches)
+    JOB_CLASS_BACKGROUND,   // Nobody is waiting (warmup, indexing)
+    JOB_CLASS_COUNT
+} JobClass;
+
+/**
+ * Job handle (0 = none)
+ */
+typedef unsigned int JobId;
+
+/**
+ * Job body (runs on a pool thread)
+ * @param arg Submitter's argument
+ * @param cancel Becomes true when the job is cancelled; poll it between steps
+ */
+typedef void (*JobFunc)(void *arg, const volatile bool *cancel);
+
+/**
+ * Completion callback (runs on the main thread from jobs_poll)
+ * Also called for jobs cancelled before they ran, so arg can be freed here.
+ * @param arg Submitter's argument
+ * @param cancelled true if the job was cancelled (it may not have run)
+ */
+typedef void (*JobDone)(void *arg, bool cancelled);
+
+/**
+ * Start the pool (call once from the main thread)
+ */
+void jobs_init(void);
+
+/**
+ * Cancel everything, wait for running jobs and stop the pool
+ * Pending completion callbacks are delivered (as cancelled) first.
+ */
+void jobs_shutdown(void);
+
+/**
+ * Queue a job
+ * Runs inline on the caller if the pool isn't running.
+ * @param cls Priority class
+ * @param name Static string for logs and traces
+ * @param run Job body
+ * @param done Completion callback, or NULL
+ * @param arg Passed to run and done
+ * @return Job id, or 0 if the queue is full (nothing was queued)
+ */
+JobId jobs_submit(JobClass cls, const char *name, JobFunc run, JobDone done, void *arg);
+
+/**
+ * Cancel a job
+ * A queued job is dropped (its callback still runs, as cancelled); a
+ * running one sees its cancel flag set.
+ * @param id Job id (0 is ignored)
+ * @return true if the job was still queued or running
+ */
+bool jobs_cancel(JobId id);
+
+/**
+ * Deliver completion callbacks (call once per frame from the main loop)
+ * @return Number of callbacks run
+ */
+int jobs_poll(void);
+
+#endif // JOBS_H
@@ -0,0 +1,240 @@
+/**
+ * JSON Arena Implementation
+ *
+ * The cJSON hooks check the calling thread's arena: while it is parsing,
+ * allocations are bumped out of its current region and frees of arena
+ * memory are ignored; anything else goes to malloc/free as before. On
+ * reset a thread keeps a single region, sized from what the last
+ * response needed, so steady-state parses take nothing from the heap.
+ */
+
+#include "jsonarena.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define JSON_ARENA_ALIGN 8
+
+/**
+ * Arena region (data follows the header)
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;                // Data bytes
+    size_t used;
+} ArenaChunk;
+
+/**
+ * Per-thread arena
+ */
+typedef struct {
+    ArenaChunk *head;           // Region being filled (newest first)
+    size_t next_size;           // Size of the next region taken from the heap
+    int live;                   // Trees parsed and not yet released
+    bool parsing;
+    unsigned long allocs;       // Counted here, folded into g_stats on reset
+} Arena;
+
+static pthread_key_t g_key;
+static pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+static __thread Arena *t_arena = NULL;
+
+static pthread_mutex_t g_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static JsonArenaStats g_stats;
+
+#define CHUNK_HEADER ((sizeof(ArenaChunk) + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1))
+
+/**
+ * Data start of a region
+ */
+static uint8_t* chunk_data(ArenaChunk *c) {
+    return (uint8_t *)c + CHUNK_HEADER;
+}
+
+/**
+ * Free every region of an arena
+ * @return Bytes the regions held
+ */
+static size_t free_chunks(Arena *a) {
+    size_t total = 0;
+    ArenaChunk *c = a->head;
+    while (c) {
+        ArenaChunk *next = c->next;
+        total += c->size;
+        free(c);
+        c = next;
+    }
+    a->head = NULL;
+    return total;
+}
+
+/**
+ * Thread exit: give the arena back
+ */
+static void arena_destroy(void *ptr) {
+    Arena *a = (Arena *)ptr;
+    free_chunks(a);
+    free(a);
+}
+
+static void make_key(void) {
+    pthread_key_create(&g_key, arena_destroy);
+}
+
+/**
+ * The calling thread's arena, created on first use
+ */
+static Arena* thread_arena(void) {
+    if (t_arena) return t_arena;
+
+    pthread_once(&g_key_once, make_key);
+    Arena *a = (Arena *)calloc(1, sizeof(Arena));
+    if (!a) return NULL;
+    a->next_size = JSON_ARENA_CHUNK;
+    pthread_setspecific(g_key, a);
+    t_arena = a;
+    return a;
+}
+
+/**
+ * Whether a pointer lies in one of an arena's regions
+ */
+static bool arena_owns(const Arena *a, const void *ptr) {
+    const uint8_t *p = (const uint8_t *)ptr;
+    for (ArenaChunk *c = a->head; c; c = c->next) {
+        const uint8_t *data = chunk_data(c);
+        if (p >= data && p < data + c->size) return true;
+    }
+    return false;
+}
+
+/**
+ * Bump-allocate from the current region, taking a new one if it is full
+ */
+static void* arena_alloc(Arena *a, size_t size) {
+    size = (size + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1);
+
+    ArenaChunk *c = a->head;
+    if (!c || c->size - c->used < size) {
+        size_t chunk_size = a->next_size;
+        if (c && c->size * 2 > chunk_size) chunk_size = c->size * 2;
+        if (chunk_size < size) chunk_size = size;
+
+        ArenaChunk *grown = (ArenaChunk *)malloc(CHUNK_HEADER + chunk_size);
+        if (!grown) return NULL;
+        grown->next = c;
+        grown->size = chunk_size;
+        grown->used = 0;
+        a->head = c = grown;
+
+        pthread_mutex_lock(&g_stats_mutex);
+        g_stats.chunk_allocs++;
+        pthread_mutex_unlock(&g_stats_mutex);
+    }
+
+    void *ptr = chunk_data(c) + c->used;
+    c->used += size;
+    a->allocs++;
+    return ptr;
+}
+
+/**
+ * Empty an arena, keeping one region sized for what it just held
+ */
+static void arena_reset(Arena *a) {
+    size_t footprint = 0;
+    for (ArenaChunk *c = a->head; c; c = c->next) footprint += c->size;
+
+    if (a->head && !a->head->next && a->head->size <= JSON_ARENA_KEEP_MAX) {
+        a->head->used = 0;
+    } else {
+        // Several regions: replace them with one big enough next time
+        free_chunks(a);
+        a->next_size = footprint > JSON_ARENA_KEEP_MAX ? JSON_ARENA_KEEP_MAX : footprint;
+        if (a->next_size < JSON_ARENA_CHUNK) a->next_size = JSON_ARENA_CHUNK;
+    }
+
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.arena_allocs += a->allocs;
+    g_stats.resets++;
+    if (footprint > g_stats.peak_bytes) g_stats.peak_bytes = footprint;
+    pthread_mutex_unlock(&g_stats_mutex);
+    a->allocs = 0;
+}
+
+/**
+ * cJSON malloc hook
+ */
+static void* hook_malloc(size_t size) {
+    Arena *a = t_arena;
+    if (a && a->parsing) return arena_alloc(a, size);
+
+    pthread_mutex_lock(&g_stats_mutex);
+    g_stats.heap_allocs++;
+    pthread_mutex_unlock(&g_stats_mutex);
+    return malloc(size);
+}
+
+/**
+ * cJSON free hook: arena memory is only given back by a reset
+ */
+static void hook_free(void *ptr) {
+    Arena *a = t_arena;
+    if (ptr && a && arena_owns(a, ptr)) return;
+    free(ptr);
+}
+
+void json_arena_init(void) {
+    cJSON_Hooks hooks = { hook_malloc, hook_free };
+    cJSON_InitHooks(&hooks);
+    memset(&g_stats, 0, sizeof(g_stats));
+}
+
+cJSON* json_arena_parse(const char *text) {
+    if (!text) return NULL;
+
+    Arena *a = thread_arena();
+    if (!a) return cJSON_Parse(text);  // No arena: plain heap tree
+
+    a->parsing = true;
+    cJSON *root = cJSON_Parse(text);
+    a->parsing = false;
+
+    if (root) {
+        a->live++;
+    } else if (a->live == 0) {
+        arena_reset(a);  // Drop what the failed parse left behind
+    }
+    return root;
+}
+
+void json_arena_release(cJSON *root) {
+    if (!root) return;
+
+    Arena *a = t_arena;
+    if (!a || !arena_owns(a, root)) {
+        cJSON_Delete(root);  // Parsed on the heap
+        return;
+    }
+
+    if (--a->live <= 0) {
+        a->live = 0;
+        arena_reset(a);
+    }
+}
+
+void json_arena_stats(JsonArenaStats *out) {
+    pthread_mutex_lock(&g_stats_mutex);
+    *out = g_stats;
+    pthread_mutex_unlock(&g_stats_mutex);
+}
+
+void json_arena_report(void) {
+    JsonArenaStats s;
+    json_arena_stats(&s);
+    printf("[JSON] %lu arena / %lu heap allocations, %lu regions, %lu resets, peak %zu KB\n",
+           s.arena_allocs, s.heap_allocs, s.chunk_allocs, s.resets, s.peak_bytes / 1024);
+}
@@ -0,0 +1,68 @@
+/**
+ * JSON Arena - Bump-allocated cJSON trees for network responses
+ *
+ * Search results, tokens and API responses are parsed, copied out of and
+ * thrown away whole. Parsing them through the arena puts every node and
+ * string of a response into one per-thread region that is reset in a
+ * single step, instead of a malloc per node that fragments the heap over
+ * a long session. Ordinary cJSON use (building and printing the state
+ * files) keeps going to the heap through the same hooks.
+ */
+
+#ifndef JSONARENA_H
+#define JSONARENA_H
+
+#include <stddef.h>
+#include "cJSON.h"
+
+// First region of each thread's arena
+#define JSON_ARENA_CHUNK (32 * 1024)
+
+// Largest region kept between parses (bigger ones go back to the heap)
+#define JSON_ARENA_KEEP_MAX (512 * 1024)
+
+/**
+ * Allocation counters (all threads since json_arena_init)
+ */
+typedef struct {
+    unsigned long arena_allocs;     // cJSON allocations served by an arena
+    unsigned long heap_allocs;      // cJSON allocations that went to malloc
+    unsigned long chunk_allocs;     // Arena regions taken from the heap
+    unsigned long resets;           // Arena resets (one per released response)
+    size_t peak_bytes;              // Largest arena footprint seen
+} JsonArenaStats;
+
+/**
+ * Install the cJSON allocator hooks
+ * Call once from main() before any thread uses cJSON.
+ */
+void json_arena_init(void);
+
+/**
+ * Parse a document into the calling thread's arena
+ * The tree must be freed with json_arena_release(), never cJSON_Delete(),
+ * and nothing in it may be used afterwards: copy strings out first.
+ * @param text NUL-terminated JSON
+ * @return Root item, or NULL on parse error
+ */
+cJSON* json_arena_parse(const char *text);
+
+/**
+ * Release a tree from json_arena_parse() (NULL is ignored)
+ * The arena is reset once the thread's last live tree is released.
+ * @param root Root item
+ */
+void json_arena_release(cJSON *root);
+
+/**
+ * Read the allocation counters
+ * @param out Output: counters
+ */
+void json_arena_stats(JsonArenaStats *out);
+
+/**
+ * Log the allocation counters
+ */
+void json_arena_report(void);
+
+#endif // JSONARENA_H
@@ -0,0 +1,984 @@
+/**
+ * Library Index Implementation
+ *
+ * Directories live in a hash table keyed by path. Each record is one
+ * allocation holding the path, the packed entry names and a type byte per
+ * entry, already in display order. A directory is trusted while its mtime
+ * matches; one scanned within LIB_RACY_SECONDS of its mtime is rechecked
+ * next time, because FAT timestamps are too coarse to tell a change made
+ * in the same 2-second window.
+ *
+ * The builder thread walks the whole tree once per start (reusing fresh
+ * records, rescanning stale ones), drops directories that disappeared and
+ * saves the index. A second thread serves browser navigation: it scans
+ * one folder at a time, publishes entries as it reads them and abandons
+ * the folder as soon as a newer request arrives. Threading follows
+ * preload.c: pthreads plus mutex/cond.
+ *
+ * Index file (native endianness, device-local):
+ *   u32 magic, u32 version, u32 dir_count, then per directory:
+ *   u16 path_len, path, i64 mtime, u8 racy, u32 count, u32 names_size,
+ *   names (NUL-separated), types (count bytes)
+ */
+
+#include "library.h"
+#include "state.h"
+#include "iosched.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define LIB_INDEX_FILENAME "library.idx"
+#define LIB_INDEX_MAGIC    0x58494C4D  // "MLIX"
+#define LIB_INDEX_VERSION  1
+#define LIB_HASH_BUCKETS   1024
+#define LIB_RACY_SECONDS   3
+#define LIB_MAX_PATH       512
+
+// Entry type byte
+#define LIB_TYPE_FILE 0
+#define LIB_TYPE_DIR  1
+
+// One indexed directory (single allocation, see alloc_dir)
+typedef struct LibDir {
+    struct LibDir *next;    // Hash chain
+    char *path;
+    char *names;            // count NUL-terminated names, back to back
+    uint8_t *types;         // LIB_TYPE_* per entry
+    int64_t mtime;          // Directory mtime when scanned
+    uint32_t names_size;
+    int count;
+    bool racy;              // Needs rescan regardless of mtime
+    unsigned generation;    // Last builder pass that saw it
+} LibDir;
+
+// Scan scratch: names in one arena, sorted through a 4-byte index array
+typedef struct {
+    char *arena;
+    size_t arena_used;
+    size_t arena_capacity;
+    uint32_t *offsets;      // Arena offset per entry (read order)
+    uint8_t *types;         // LIB_TYPE_* per entry (read order)
+    int count;
+    int capacity;
+} ScanList;
+
+// Index state (guarded by g_mutex)
+static LibDir *g_table[LIB_HASH_BUCKETS];
+static unsigned g_generation = 0;
+static bool g_dirty = false;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Builder thread
+static pthread_t g_builder_thread;
+static bool g_builder_running = false;
+static volatile bool g_building = false;
+static volatile bool g_shutdown = false;
+
+// Foreground scan thread (browser navigation), guarded by g_scan_mutex
+static pthread_t g_scan_thread;
+static bool g_scan_thread_running = false;
+static pthread_mutex_t g_scan_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_scan_cond = PTHREAD_COND_INITIALIZER;
+static unsigned g_scan_ticket = 0;            // Latest request
+static bool g_scan_requested = false;         // Request not yet picked up
+static char g_scan_path[LIB_MAX_PATH] = {0};
+static LibraryScanStatus g_scan_status = LIBRARY_SCAN_DONE;
+static ScanList g_scan_progress;              // Entries read so far
+static int g_scan_delivered = 0;              // Entries already polled
+
+// Listing listener (set before the builder starts)
+static LibraryListFn g_listener = NULL;
+static void *g_listener_data = NULL;
+
+static char g_base_path[LIB_MAX_PATH] = {0};
+static char g_index_path[LIB_MAX_PATH] = {0};
+
+bool library_is_audio_file(const char *name) {
+    const char *ext = strrchr(name, '.');
+    if (!ext || ext[1] == '\0') return false;
+
+    // Get extension length
+    int len = 0;
+    for (const char *p = ext; *p; p++) len++;
+    if (len < 4 || len > 5) return false;
+
+    // Case-insensitive comparison
+    char c1 = ext[1] | 0x20;  // tolower
+    char c2 = ext[2] | 0x20;
+    char c3 = ext[3] | 0x20;
+
+    if (len == 4) {
+        // .mp3, .ogg, .wav, .m4a
+        if (c1 == 'm' && c2 == 'p' && c3 == '3') return true;
+        if (c1 == 'o' && c2 == 'g' && c3 == 'g') return true;
+        if (c1 == 'w' && c2 == 'a' && c3 == 'v') return true;
+        if (c1 == 'm' && c2 == '4' && c3 == 'a') return true;
+    } else {
+        // .flac, .webm, .opus
+        char c4 = ext[4] | 0x20;
+        if (c1 == 'f' && c2 == 'l' && c3 == 'a' && c4 == 'c') return true;
+        if (c1 == 'w' && c2 == 'e' && c3 == 'b' && c4 == 'm') return true;
+        if (c1 == 'o' && c2 == 'p' && c3 == 'u' && c4 == 's') return true;
+    }
+
+    return false;
+}
+
+/**
+ * Natural sort comparison - treats embedded numbers as integers
+ * Example: "Track 2" < "Track 10" (unlike alphabetical sort)
+ */
+static int compare_natural(const char *a, const char *b) {
+    while (*a && *b) {
+        if (isdigit((unsigned char)*a) && isdigit((unsigned char)*b)) {
+            // Both pointing to digits - compare as integers
+            long na = strtol(a, (char **)&a, 10);
+            long nb = strtol(b, (char **)&b, 10);
+            if (na != nb) return (na < nb) ? -1 : 1;
+            // Numbers equal, continue comparing rest of string
+        } else {
+            // Compare characters case-insensitively
+            int ca = tolower((unsigned char)*a);
+            int cb = tolower((unsigned char)*b);
+            if (ca != cb) return ca - cb;
+            a++;
+            b++;
+        }
+    }
+    // Handle different lengths
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
+int library_compare_entries(const char *a, bool a_is_dir, const char *b, bool b_is_dir) {
+    if (a_is_dir != b_is_dir) return a_is_dir ? -1 : 1;
+    return compare_natural(a, b);
+}
+
+/**
+ * Compare two scanned entries by index (directories first, then natural sort)
+ */
+static int compare_scan_entries(const ScanList *list, uint32_t a, uint32_t b) {
+    return library_compare_entries(list->arena + list->offsets[a], list->types[a] == LIB_TYPE_DIR,
+                                   list->arena + list->offsets[b], list->types[b] == LIB_TYPE_DIR);
+}
+
+/**
+ * Merge sort an index array (qsort has no context argument, and scans run
+ * on the builder and main threads at once, so no static comparator state)
+ */
+static void sort_indices(const ScanList *list, uint32_t *order, uint32_t *tmp, int n) {
+    if (n < 2) return;
+    int half = n / 2;
+    sort_indices(list, order, tmp, half);
+    sort_indices(list, order + half, tmp, n - half);
+
+    int i = 0, j = half, k = 0;
+    while (i < half && j < n) {
+        tmp[k++] = (compare_scan_entries(list, order[j], order[i]) < 0) ? order[j++] : order[i++];
+    }
+    while (i < half) tmp[k++] = order[i++];
+    while (j < n) tmp[k++] = order[j++];
+    memcpy(order, tmp, n * sizeof(uint32_t));
+}
+
+/**
+ * Add one entry to a scan list
+ * @return false if out of memory
+ */
+static bool scan_list_add(ScanList *list, const char *name, bool is_dir) {
+    if (list->count == list->capacity) {
+        int new_capacity = list->capacity ? list->capacity * 2 : 64;
+        uint32_t *offsets = realloc(list->offsets, new_capacity * sizeof(uint32_t));
+        if (!offsets) return false;
+        list->offsets = offsets;
+        uint8_t *types = realloc(list->types, new_capacity);
+        if (!types) return false;
+        list->types = types;
+        list->capacity = new_capacity;
+    }
+
+    size_t len = strlen(name) + 1;
+    if (list->arena_used + len > list->arena_capacity) {
+        size_t new_capacity = list->arena_capacity ? list->arena_capacity * 2 : 4096;
+        while (new_capacity < list->arena_used + len) new_capacity *= 2;
+        char *arena = realloc(list->arena, new_capacity);
+        if (!arena) return false;
+        list->arena = arena;
+        list->arena_capacity = new_capacity;
+    }
+
+    memcpy(list->arena + list->arena_used, name, len);
+    list->offsets[list->count] = (uint32_t)list->arena_used;
+    list->types[list->count] = is_dir ? LIB_TYPE_DIR : LIB_TYPE_FILE;
+    list->arena_used += len;
+    list->count++;
+    return true;
+}
+
+/**
+ * FNV-1a hash of a path, reduced to a bucket
+ */
+static unsigned hash_path(const char *path) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h % LIB_HASH_BUCKETS;
+}
+
+/**
+ * Allocate a directory record with room for path, names and types
+ */
+static LibDir* alloc_dir(const char *path, int count, uint32_t names_size) {
+    size_t path_len = strlen(path) + 1;
+    LibDir *d = malloc(sizeof(LibDir) + path_len + names_size + (size_t)count);
+    if (!d) return NULL;
+
+    memset(d, 0, sizeof(LibDir));
+    d->path = (char *)(d + 1);
+    d->names = d->path + path_len;
+    d->types = (uint8_t *)(d->names + names_size);
+    d->names_size = names_size;
+    d->count = count;
+    memcpy(d->path, path, path_len);
+    return d;
+}
+
+/**
+ * Find a directory record (caller holds g_mutex)
+ */
+static LibDir* find_dir(const char *path) {
+    for (LibDir *d = g_table[hash_path(path)]; d; d = d->next) {
+        if (strcmp(d->path, path) == 0) return d;
+    }
+    return NULL;
+}
+
+/**
+ * Report a record to the listener (caller holds g_mutex)
+ */
+static void notify_dir(const LibDir *d) {
+    if (g_listener) g_listener(d->path, d->names, d->types, d->count, g_listener_data);
+}
+
+/**
+ * Insert a record, replacing any previous one for the path (caller holds g_mutex)
+ */
+static void insert_dir(LibDir *nd) {
+    notify_dir(nd);
+    LibDir **link = &g_table[hash_path(nd->path)];
+    while (*link) {
+        if (strcmp((*link)->path, nd->path) == 0) {
+            LibDir *old = *link;
+            nd->next = old->next;
+            *link = nd;
+            free(old);
+            return;
+        }
+        link = &(*link)->next;
+    }
+    nd->next = NULL;
+    *link = nd;
+}
+
+/**
+ * Check if a record still describes the directory on disk
+ */
+static bool dir_is_fresh(const LibDir *d, const struct stat *st) {
+    return d && !d->racy && d->mtime == (int64_t)st->st_mtime;
+}
+
+/**
+ * Publish one entry of the foreground scan
+ * @return false if the scan was superseded (stop reading)
+ */
+static bool scan_report(unsigned ticket, const char *name, bool is_dir) {
+    pthread_mutex_lock(&g_scan_mutex);
+    bool current = (ticket == g_scan_ticket);
+    if (current) scan_list_add(&g_scan_progress, name, is_dir);
+    pthread_mutex_unlock(&g_scan_mutex);
+    return current;
+}
+
+/**
+ * Read a directory from disk into a new record (no locks held)
+ * Uses d_type when the filesystem provides it to skip a stat per entry.
+ * @param ticket Foreground scan to report progress to (0 = none)
+ * @return Record, or NULL if unreadable or cancelled
+ */
+static LibDir* scan_dir(const char *path, unsigned ticket) {
+    struct stat dir_st;
+    if (stat(path, &dir_st) != 0 || !S_ISDIR(dir_st.st_mode)) return NULL;
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "Cannot open directory: %s\n", path);
+        return NULL;
+    }
+
+    ScanList list = {0};
+    bool cancelled = false;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        // Skip hidden files and special entries
+        if (entry->d_name[0] == '.') continue;
+
+        bool is_dir = false;
+        bool is_file = false;
+#ifdef DT_DIR
+        if (entry->d_type == DT_DIR) {
+            is_dir = true;
+        } else if (entry->d_type == DT_REG) {
+            is_file = true;
+        } else if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK)
+#endif
+        {
+            char full_path[LIB_MAX_PATH];
+            snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
+            struct stat st;
+            if (stat(full_path, &st) != 0) continue;
+            is_dir = S_ISDIR(st.st_mode);
+            is_file = S_ISREG(st.st_mode);
+        }
+
+        if (!is_dir && !(is_file && library_is_audio_file(entry->d_name))) continue;
+        if (!scan_list_add(&list, entry->d_name, is_dir)) break;
+        if (ticket && !scan_report(ticket, entry->d_name, is_dir)) {
+            cancelled = true;
+            break;
+        }
+    }
+
+    closedir(dir);
+
+    if (cancelled) {
+        printf("Scan cancelled: %s\n", path);
+        free(list.arena);
+        free(list.offsets);
+        free(list.types);
+        return NULL;
+    }
+
+    // Sort 4-byte indices, then lay names out once in display order
+    int count = list.count;
+    uint32_t *order = malloc((count ? count : 1) * 2 * sizeof(uint32_t));
+    LibDir *d = order ? alloc_dir(path, count, (uint32_t)list.arena_used) : NULL;
+    if (d) {
+        for (int i = 0; i < count; i++) order[i] = (uint32_t)i;
+        sort_indices(&list, order, order + count, count);
+
+        char *p = d->names;
+        for (int i = 0; i < count; i++) {
+            const char *name = list.arena + list.offsets[order[i]];
+            size_t len = strlen(name) + 1;
+            memcpy(p, name, len);
+            p += len;
+            d->types[i] = list.types[order[i]];
+        }
+        d->mtime = (int64_t)dir_st.st_mtime;
+        d->racy = (int64_t)time(NULL) - d->mtime < LIB_RACY_SECONDS;
+    }
+
+    free(order);
+    free(list.arena);
+    free(list.offsets);
+    free(list.types);
+
+    printf("Scanned %s: %d entries\n", path, count);
+
+    return d;
+}
+
+/**
+ * Call fn for each entry of a record (caller holds g_mutex)
+ */
+static void visit_entries(const LibDir *d, LibraryEntryFn fn, void *userdata) {
+    const char *name = d->names;
+    for (int i = 0; i < d->count; i++) {
+        fn(name, d->types[i] == LIB_TYPE_DIR, userdata);
+        name += strlen(name) + 1;
+    }
+}
+
+// Builder work queue (builder thread only)
+typedef struct {
+    char **paths;
+    size_t head;
+    size_t count;
+    size_t capacity;
+} PathQueue;
+
+/**
+ * Append "dir/name" to the builder queue
+ */
+static void queue_push(PathQueue *q, const char *dir, const char *name) {
+    if (q->count == q->capacity) {
+        size_t new_capacity = q->capacity ? q->capacity * 2 : 256;
+        char **grown = realloc(q->paths, new_capacity * sizeof(char *));
+        if (!grown) return;
+        q->paths = grown;
+        q->capacity = new_capacity;
+    }
+
+    char full_path[LIB_MAX_PATH];
+    if (name) {
+        snprintf(full_path, sizeof(full_path), "%s/%s", dir, name);
+    } else {
+        snprintf(full_path, sizeof(full_path), "%s", dir);
+    }
+    char *copy = strdup(full_path);
+    if (copy) q->paths[q->count++] = copy;
+}
+
+/**
+ * Queue every subdirectory of a record (caller holds g_mutex)
+ */
+static void queue_subdirs(PathQueue *q, const LibDir *d) {
+    const char *name = d->names;
+    for (int i = 0; i < d->count; i++) {
+        if (d->types[i] == LIB_TYPE_DIR) queue_push(q, d->path, name);
+        name += strlen(name) + 1;
+    }
+}
+
+/**
+ * Drop records not seen by the given builder pass (caller holds g_mutex)
+ */
+static void prune_generation(unsigned generation) {
+    int pruned = 0;
+    for (int b = 0; b < LIB_HASH_BUCKETS; b++) {
+        LibDir **link = &g_table[b];
+        while (*link) {
+            if ((*link)->generation != generation) {
+                LibDir *old = *link;
+                *link = old->next;
+                free(old);
+                pruned++;
+            } else {
+                link = &(*link)->next;
+            }
+        }
+    }
+    if (pruned > 0) {
+        g_dirty = true;
+        printf("[LIBRARY] Pruned %d vanished directories\n", pruned);
+    }
+}
+
+/**
+ * Write the index to disk if it changed
+ * Serializes under the lock into memory, writes outside it.
+ */
+static void save_index(void) {
+    if (!g_index_path[0]) return;
+
+    pthread_mutex_lock(&g_mutex);
+    if (!g_dirty) {
+        pthread_mutex_unlock(&g_mutex);
+        return;
+    }
+
+    size_t size = 3 * sizeof(uint32_t);
+    uint32_t dir_count = 0;
+    for (int b = 0; b < LIB_HASH_BUCKETS; b++) {
+        for (LibDir *d = g_table[b]; d; d = d->next) {
+            size += sizeof(uint16_t) + strlen(d->path) + sizeof(int64_t) + 1 +
+                    2 * sizeof(uint32_t) + d->names_size + (size_t)d->count;
+            dir_count++;
+        }
+    }
+
+    uint8_t *buf = malloc(size);
+    if (!buf) {
+        pthread_mutex_unlock(&g_mutex);
+        return;
+    }
+
+    uint8_t *p = buf;
+    uint32_t header[3] = { LIB_INDEX_MAGIC, LIB_INDEX_VERSION, dir_count };
+    memcpy(p, header, sizeof(header));
+    p += sizeof(header);
+
+    for (int b = 0; b < LIB_HASH_BUCKETS; b++) {
+        for (LibDir *d = g_table[b]; d; d = d->next) {
+            uint16_t path_len = (uint16_t)strlen(d->path);
+            uint32_t count = (uint32_t)d->count;
+            memcpy(p, &path_len, sizeof(path_len));          p += sizeof(path_len);
+            memcpy(p, d->path, path_len);                     p += path_len;
+            memcpy(p, &d->mtime, sizeof(d->mtime));           p += sizeof(d->mtime);
+            *p++ = d->racy ? 1 : 0;
+            memcpy(p, &count, sizeof(count));                 p += sizeof(count);
+            memcpy(p, &d->names_size, sizeof(d->names_size)); p += sizeof(d->names_size);
+            memcpy(p, d->names, d->names_size);               p += d->names_size;
+            memcpy(p, d->types, count);                       p += count;
+        }
+    }
+
+    g_dirty = false;
+    pthread_mutex_unlock(&g_mutex);
+
+    // Write to a temp file and rename so a power cut never leaves half an index
+    char tmp_path[LIB_MAX_PATH + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", g_index_path);
+    FILE *f = fopen(tmp_path, "wb");
+    bool ok = false;
+    if (f) {
+        ok = fwrite(buf, 1, size, f) == size;
+        ok = (fclose(f) == 0) && ok;
+    }
+    if (ok && rename(tmp_path, g_index_path) == 0) {
+        printf("[LIBRARY] Saved index: %u directories, %zu KB\n", dir_count, size / 1024);
+    } else {
+        fprintf(stderr, "[LIBRARY] Failed to save index: %s\n", g_index_path);
+        remove(tmp_path);
+        pthread_mutex_lock(&g_mutex);
+        g_dirty = true;
+        pthread_mutex_unlock(&g_mutex);
+    }
+
+    free(buf);
+}
+
+/**
+ * Load the saved index (records already present are kept, they're newer)
+ */
+static void load_index(void) {
+    FILE *f = fopen(g_index_path, "rb");
+    if (!f) {
+        printf("[LIBRARY] No saved index\n");
+        return;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *buf = (size > 0) ? malloc((size_t)size) : NULL;
+    if (!buf || fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        fclose(f);
+        return;
+    }
+    fclose(f);
+
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + size;
+    uint32_t header[3];
+    int loaded = 0;
+
+    if (end - p < (long)sizeof(header)) goto done;
+    memcpy(header, p, sizeof(header));
+    p += sizeof(header);
+    if (header[0] != LIB_INDEX_MAGIC || header[1] != LIB_INDEX_VERSION) {
+        printf("[LIBRARY] Ignoring index with old format\n");
+        goto done;
+    }
+
+    pthread_mutex_lock(&g_mutex);
+    for (uint32_t i = 0; i < header[2]; i++) {
+        uint16_t path_len;
+        int64_t mtime;
+        uint32_t count, names_size;
+        char path[LIB_MAX_PATH];
+
+        if (end - p < (long)sizeof(path_len)) break;
+        memcpy(&path_len, p, sizeof(path_len));             p += sizeof(path_len);
+        if (path_len >= sizeof(path) || end - p < (long)path_len + (long)sizeof(mtime) + 1 +
+                                                  2 * (long)sizeof(uint32_t)) break;
+        memcpy(path, p, path_len);                           p += path_len;
+        path[path_len] = '\0';
+        memcpy(&mtime, p, sizeof(mtime));                    p += sizeof(mtime);
+        bool racy = *p++ != 0;
+        memcpy(&count, p, sizeof(count));                    p += sizeof(count);
+        memcpy(&names_size, p, sizeof(names_size));          p += sizeof(names_size);
+        if ((uint64_t)(end - p) < (uint64_t)names_size + count) break;
+
+        if (!find_dir(path)) {
+            LibDir *d = alloc_dir(path, (int)count, names_size);
+            if (!d) break;
+            memcpy(d->names, p, names_size);
+            memcpy(d->types, p + names_size, count);
+            d->mtime = mtime;
+            d->racy = racy;
+            insert_dir(d);
+            loaded++;
+        }
+        p += names_size + count;
+    }
+    pthread_mutex_unlock(&g_mutex);
+
+    printf("[LIBRARY] Loaded index: %d directories\n", loaded);
+
+done:
+    free(buf);
+}
+
+/**
+ * Builder thread: walk the tree, rescan what changed, prune, save
+ */
+static void* builder_func(void *arg) {
+    (void)arg;
+    iosched_set_class(IO_CLASS_BULK);
+    printf("[LIBRARY] Builder started: %s\n", g_base_path);
+
+    pthread_mutex_lock(&g_mutex);
+    unsigned generation = ++g_generation;
+    pthread_mutex_unlock(&g_mutex);
+
+    PathQueue queue = {0};
+    queue_push(&queue, g_base_path, NULL);
+    int rescanned = 0;
+
+    while (queue.head < queue.count && !g_shutdown) {
+        char *path = queue.paths[queue.head++];
+
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            pthread_mutex_lock(&g_mutex);
+            LibDir *d = find_dir(path);
+            bool fresh = dir_is_fresh(d, &st);
+            if (fresh) {
+                d->generation = generation;
+                queue_subdirs(&queue, d);
+                notify_dir(d);
+            }
+            pthread_mutex_unlock(&g_mutex);
+
+            // Readdir + stats: yield to playback and foreground scans
+            if (!fresh && iosched_gate(0, &g_shutdown)) {
+                LibDir *nd = scan_dir(path, 0);
+                if (nd) {
+                    pthread_mutex_lock(&g_mutex);
+                    nd->generation = generation;
+                    insert_dir(nd);
+                    queue_subdirs(&queue, nd);
+                    g_dirty = true;
+                    pthread_mutex_unlock(&g_mutex);
+                    rescanned++;
+                }
+            }
+        }
+
+        free(path);
+    }
+
+    size_t walked = queue.head;
+    while (queue.head < queue.count) {
+        free(queue.paths[queue.head++]);
+    }
+    free(queue.paths);
+
+    if (!g_shutdown) {
+        pthread_mutex_lock(&g_mutex);
+        prune_generation(generation);
+        pthread_mutex_unlock(&g_mutex);
+        printf("[LIBRARY] Build done: %zu directories, %d rescanned\n", walked, rescanned);
+        if (g_listener) g_listener(NULL, NULL, NULL, 0, g_listener_data);
+    }
+
+    save_index();
+    g_building = false;
+    return NULL;
+}
+
+/**
+ * Scan thread: serve the latest foreground request
+ */
+static void* scan_thread_func(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_scan_mutex);
+    while (!g_shutdown) {
+        if (!g_scan_requested) {
+            pthread_cond_wait(&g_scan_cond, &g_scan_mutex);
+            continue;
+        }
+
+        unsigned ticket = g_scan_ticket;
+        char path[LIB_MAX_PATH];
+        strncpy(path, g_scan_path, sizeof(path) - 1);
+        path[sizeof(path) - 1] = '\0';
+        g_scan_requested = false;
+        pthread_mutex_unlock(&g_scan_mutex);
+
+        iosched_begin();  // The browser is waiting: the builder pauses
+        LibDir *nd = scan_dir(path, ticket);
+        iosched_end();
+        if (nd) {
+            pthread_mutex_lock(&g_mutex);
+            nd->generation = g_generation;
+            insert_dir(nd);
+            g_dirty = true;
+            pthread_mutex_unlock(&g_mutex);
+        }
+
+        pthread_mutex_lock(&g_scan_mutex);
+        if (ticket == g_scan_ticket) {
+            g_scan_status = nd ? LIBRARY_SCAN_DONE : LIBRARY_SCAN_FAILED;
+            pthread_cond_broadcast(&g_scan_cond);
+        }
+    }
+    pthread_mutex_unlock(&g_scan_mutex);
+    return NULL;
+}
+
+int library_init(const char *base_path) {
+    strncpy(g_base_path, base_path, sizeof(g_base_path) - 1);
+
+    const char *data_dir = state_get_data_dir();
+    if (data_dir && data_dir[0]) {
+        snprintf(g_index_path, sizeof(g_index_path), "%s/%s", data_dir, LIB_INDEX_FILENAME);
+        load_index();
+    }
+
+    g_shutdown = false;
+    g_building = true;
+    if (pthread_create(&g_builder_thread, NULL, builder_func, NULL) != 0) {
+        fprintf(stderr, "[LIBRARY] Failed to create builder thread\n");
+        g_building = false;
+        return -1;
+    }
+    g_builder_running = true;
+    return 0;
+}
+
+void library_set_listener(LibraryListFn fn, void *userdata) {
+    pthread_mutex_lock(&g_mutex);
+    g_listener = fn;
+    g_listener_data = userdata;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void library_cleanup(void) {
+    g_shutdown = true;
+    if (g_builder_running) {
+        pthread_join(g_builder_thread, NULL);
+        g_builder_running = false;
+    }
+    if (g_scan_thread_running) {
+        pthread_mutex_lock(&g_scan_mutex);
+        g_scan_ticket++;  // Cancel a scan in flight
+        pthread_cond_broadcast(&g_scan_cond);
+        pthread_mutex_unlock(&g_scan_mutex);
+        pthread_join(g_scan_thread, NULL);
+        g_scan_thread_running = false;
+    }
+    free(g_scan_progress.arena);
+    free(g_scan_progress.offsets);
+    free(g_scan_progress.types);
+    memset(&g_scan_progress, 0, sizeof(g_scan_progress));
+
+    save_index();
+
+    pthread_mutex_lock(&g_mutex);
+    for (int b = 0; b < LIB_HASH_BUCKETS; b++) {
+        LibDir *d = g_table[b];
+        while (d) {
+            LibDir *next = d->next;
+            free(d);
+            d = next;
+        }
+        g_table[b] = NULL;
+    }
+    pthread_mutex_unlock(&g_mutex);
+}
+
+int library_list_dir(const char *path, LibraryEntryFn fn, void *userdata) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Cannot open directory: %s\n", path);
+        return -1;
+    }
+
+    // Fast path: index still matches the directory
+    pthread_mutex_lock(&g_mutex);
+    LibDir *d = find_dir(path);
+    if (dir_is_fresh(d, &st)) {
+        visit_entries(d, fn, userdata);
+        int count = d->count;
+        pthread_mutex_unlock(&g_mutex);
+        return count;
+    }
+    pthread_mutex_unlock(&g_mutex);
+
+    // Missing or stale: rescan and update the index
+    LibDir *nd = scan_dir(path, 0);
+    if (!nd) return -1;
+
+    pthread_mutex_lock(&g_mutex);
+    nd->generation = g_generation;
+    insert_dir(nd);
+    g_dirty = true;
+    visit_entries(nd, fn, userdata);
+    int count = nd->count;
+    pthread_mutex_unlock(&g_mutex);
+
+    return count;
+}
+
+int library_list_cached(const char *path, LibraryEntryFn fn, void *userdata, bool validate) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Cannot open directory: %s\n", path);
+        return -1;
+    }
+
+    pthread_mutex_lock(&g_mutex);
+    LibDir *d = find_dir(path);
+    int count = LIBRARY_NOT_INDEXED;
+    if (d && (!validate || dir_is_fresh(d, &st))) {
+        visit_entries(d, fn, userdata);
+        count = d->count;
+    }
+    pthread_mutex_unlock(&g_mutex);
+
+    return count;
+}
+
+unsigned library_scan_start(const char *path) {
+    pthread_mutex_lock(&g_scan_mutex);
+
+    // Start the scan thread on first use (browser scans before library_init)
+    if (!g_scan_thread_running) {
+        if (pthread_create(&g_scan_thread, NULL, scan_thread_func, NULL) == 0) {
+            g_scan_thread_running = true;
+        } else {
+            fprintf(stderr, "[LIBRARY] Failed to create scan thread\n");
+        }
+    }
+
+    unsigned ticket = ++g_scan_ticket;
+    strncpy(g_scan_path, path, sizeof(g_scan_path) - 1);
+    g_scan_path[sizeof(g_scan_path) - 1] = '\0';
+    g_scan_progress.count = 0;
+    g_scan_progress.arena_used = 0;
+    g_scan_delivered = 0;
+    g_scan_status = g_scan_thread_running ? LIBRARY_SCAN_RUNNING : LIBRARY_SCAN_FAILED;
+    g_scan_requested = true;
+    pthread_cond_broadcast(&g_scan_cond);
+
+    pthread_mutex_unlock(&g_scan_mutex);
+    return ticket;
+}
+
+LibraryScanStatus library_scan_poll(unsigned ticket, LibraryEntryFn fn, void *userdata) {
+    pthread_mutex_lock(&g_scan_mutex);
+
+    if (ticket != g_scan_ticket) {
+        pthread_mutex_unlock(&g_scan_mutex);
+        return LIBRARY_SCAN_FAILED;
+    }
+
+    for (; g_scan_delivered < g_scan_progress.count; g_scan_delivered++) {
+        int i = g_scan_delivered;
+        fn(g_scan_progress.arena + g_scan_progress.offsets[i],
+           g_scan_progress.types[i] == LIB_TYPE_DIR, userdata);
+    }
+    LibraryScanStatus status = g_scan_status;
+
+    pthread_mutex_unlock(&g_scan_mutex);
+    return status;
+}
+
+void library_scan_wait(unsigned ticket) {
+    pthread_mutex_lock(&g_scan_mutex);
+    while (ticket == g_scan_ticket && g_scan_status == LIBRARY_SCAN_RUNNING) {
+        pthread_cond_wait(&g_scan_cond, &g_scan_mutex);
+    }
+    pthread_mutex_unlock(&g_scan_mutex);
+}
+
+bool library_update_entry(const char *path, const char *old_name, const char *new_name, bool is_dir) {
+    if (!path) return false;
+    if (new_name && !is_dir && !library_is_audio_file(new_name)) new_name = NULL;
+
+    pthread_mutex_lock(&g_mutex);
+    LibDir *d = find_dir(path);
+    if (!d) {
+        pthread_mutex_unlock(&g_mutex);
+        return false;
+    }
+
+    // Find the entry going away, and whether the new one is already listed
+    uint8_t type = is_dir ? LIB_TYPE_DIR : LIB_TYPE_FILE;
+    int old_index = -1;
+    bool duplicate = false;
+    const char *name = d->names;
+    for (int i = 0; i < d->count; i++) {
+        if (d->types[i] == type) {
+            if (old_name && old_index < 0 && strcmp(name, old_name) == 0) old_index = i;
+            else if (new_name && strcmp(name, new_name) == 0) duplicate = true;
+        }
+        name += strlen(name) + 1;
+    }
+    if (duplicate) new_name = NULL;
+    if (old_index < 0 && !new_name) {
+        pthread_mutex_unlock(&g_mutex);
+        return true;
+    }
+
+    // Lay the listing out again in one pass, new entry at its sorted place
+    int count = d->count - (old_index >= 0) + (new_name != NULL);
+    uint32_t names_size = d->names_size - (old_index >= 0 ? (uint32_t)strlen(old_name) + 1 : 0) +
+                          (new_name ? (uint32_t)strlen(new_name) + 1 : 0);
+    LibDir *nd = alloc_dir(path, count, names_size);
+    if (!nd) {
+        d->racy = true;  // Can't patch it: have it read again
+        pthread_mutex_unlock(&g_mutex);
+        return false;
+    }
+
+    char *p = nd->names;
+    int n = 0;
+    name = d->names;
+    for (int i = 0; i <= d->count; i++) {
+        if (new_name && (i == d->count ||
+                         library_compare_entries(new_name, is_dir, name, d->types[i] == LIB_TYPE_DIR) < 0)) {
+            size_t len = strlen(new_name) + 1;
+            memcpy(p, new_name, len);
+            p += len;
+            nd->types[n++] = type;
+            new_name = NULL;
+        }
+        if (i == d->count) break;
+
+        size_t len = strlen(name) + 1;
+        if (i != old_index) {
+            memcpy(p, name, len);
+            p += len;
+            nd->types[n++] = d->types[i];
+        }
+        name += len;
+    }
+
+    // Our own change, but a 2s FAT mtime can't vouch for the rest of the
+    // folder: the next validated listing reads it once more
+    nd->mtime = d->mtime;
+    nd->racy = true;
+    nd->generation = d->generation;
+    insert_dir(nd);
+    g_dirty = true;
+    pthread_mutex_unlock(&g_mutex);
+    return true;
+}
+
+void library_invalidate(const char *path) {
+    if (!path) return;
+    pthread_mutex_lock(&g_mutex);
+    LibDir *d = find_dir(path);
+    if (d) d->racy = true;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+bool library_is_building(void) {
+    return g_building;
+}
@@ -0,0 +1,158 @@
+/**
+ * Library Index - Persistent directory tree of the music folder
+ *
+ * Keeps every directory's sorted listing (subfolders, then audio files,
+ * natural order) together with the directory's mtime, so the browser can
+ * show a folder without readdir/stat/sort on each visit. The index is
+ * saved to the data directory, rebuilt in the background on startup, and
+ * each directory is revalidated by mtime (one stat) when it is opened.
+ * Folders that do need reading are scanned on a worker thread, with
+ * partial results available while the scan runs.
+ */
+
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <stdbool.h>
+
+/**
+ * Callback for each entry of a listed directory, in display order
+ * @param name Entry name (valid only during the call)
+ * @param is_dir true for a subdirectory, false for an audio file
+ * @param userdata Caller context
+ */
+typedef void (*LibraryEntryFn)(const char *name, bool is_dir, void *userdata);
+
+/**
+ * Callback when the index takes in a directory listing
+ * Called for every listing scanned or loaded, and for every directory the
+ * background build finds unchanged; a call with path NULL ends a build
+ * pass (every directory still on disk has been reported since the last
+ * one). Runs on whichever thread updated the index, with the index locked
+ * except for the end-of-pass call: don't call library_* from it.
+ * @param path Directory path, or NULL at the end of a build pass
+ * @param names count NUL-terminated entry names back to back (display order)
+ * @param is_dir Per entry: nonzero for a subdirectory, 0 for an audio file
+ * @param count Number of entries
+ * @param userdata Listener context
+ */
+typedef void (*LibraryListFn)(const char *path, const char *names, const unsigned char *is_dir,
+                              int count, void *userdata);
+
+/**
+ * State of a background directory scan
+ */
+typedef enum {
+    LIBRARY_SCAN_RUNNING,      // Still reading, more entries may arrive
+    LIBRARY_SCAN_DONE,         // Finished, sorted listing is in the index
+    LIBRARY_SCAN_FAILED        // Unreadable, or superseded by a newer scan
+} LibraryScanStatus;
+
+// library_list_cached() result when the directory needs a (re)scan
+#define LIBRARY_NOT_INDEXED (-2)
+
+/**
+ * Load the saved index and start the background build
+ * Call after state_init() (index lives in the data directory).
+ * library_list_dir() works before this, just without the saved index.
+ * @param base_path Music root to index
+ * @return 0 on success, -1 if the builder could not start
+ */
+int library_init(const char *base_path);
+
+/**
+ * Set the listener for directory listings (one listener; NULL removes it)
+ * Set it before library_init() to also see the listings of the saved index.
+ * @param fn Listener
+ * @param userdata Passed to fn
+ */
+void library_set_listener(LibraryListFn fn, void *userdata);
+
+/**
+ * Stop the background build and save the index if it changed
+ */
+void library_cleanup(void);
+
+/**
+ * List a directory from the index, rescanning it if its mtime changed
+ * @param path Directory path
+ * @param fn Called for each entry (subdirectories first, natural sort)
+ * @param userdata Passed to fn
+ * @return Number of entries, or -1 if the directory can't be read
+ */
+int library_list_dir(const char *path, LibraryEntryFn fn, void *userdata);
+
+/**
+ * List a directory from the index without touching its contents on disk
+ * @param path Directory path
+ * @param fn Called for each entry (subdirectories first, natural sort)
+ * @param userdata Passed to fn
+ * @param validate Check the directory mtime first (one stat)
+ * @return Number of entries, LIBRARY_NOT_INDEXED if missing or stale,
+ *         or -1 if the directory doesn't exist
+ */
+int library_list_cached(const char *path, LibraryEntryFn fn, void *userdata, bool validate);
+
+/**
+ * Scan a directory on the background scan thread
+ * Cancels any scan still in flight. Entries are delivered unsorted through
+ * library_scan_poll() while reading; once done the sorted listing is
+ * available from library_list_cached(path, ..., false).
+ * @param path Directory path
+ * @return Ticket identifying this scan
+ */
+unsigned library_scan_start(const char *path);
+
+/**
+ * Collect entries read since the last poll (read order, not sorted)
+ * @param ticket Ticket from library_scan_start()
+ * @param fn Called for each new entry
+ * @param userdata Passed to fn
+ * @return Scan state
+ */
+LibraryScanStatus library_scan_poll(unsigned ticket, LibraryEntryFn fn, void *userdata);
+
+/**
+ * Block until a scan finishes (for callers that need the listing now)
+ * @param ticket Ticket from library_scan_start()
+ */
+void library_scan_wait(unsigned ticket);
+
+/**
+ * Patch one entry of an indexed directory's listing without reading it
+ * Keeps the sorted order and tells the listener; the directory is still
+ * read once more on its next validated listing.
+ * @param path Directory path
+ * @param old_name Entry that went away, or NULL
+ * @param new_name Entry that appeared, or NULL (files other than audio are ignored)
+ * @param is_dir true if the entry is a subdirectory
+ * @return true if the directory is indexed (and was patched)
+ */
+bool library_update_entry(const char *path, const char *old_name, const char *new_name, bool is_dir);
+
+/**
+ * Compare two entries in display order (directories first, natural sort)
+ * @return <0, 0 or >0 like strcmp (0 also for names that only differ in case)
+ */
+int library_compare_entries(const char *a, bool a_is_dir, const char *b, bool b_is_dir);
+
+/**
+ * Check if a file name has one of the listed audio extensions
+ */
+bool library_is_audio_file(const char *name);
+
+/**
+ * Force a directory to be rescanned on next listing
+ * Use after modifying it (delete, rename), since FAT mtimes only have
+ * 2-second resolution.
+ * @param path Directory path
+ */
+void library_invalidate(const char *path);
+
+/**
+ * Check if the background build is still running
+ * @return true while the initial walk is in progress
+ */
+bool library_is_building(void);
+
+#endif // LIBRARY_H
@@ -0,0 +1,183 @@
+/**
+ * Library Search UI State Implementation
+ *
+ * Input follows ytsearch.c, on the same keyboard grid (the characters come
+ * from ytsearch_get_char_at(), so both screens always type alike). Lookups
+ * run synchronously on the main thread: the search index answers in a few
+ * milliseconds, so every keystroke simply runs the query again.
+ */
+
+#include "libsearch.h"
+#include "ytsearch.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Visible items in results list
+#define VISIBLE_RESULTS 7
+
+// Current state
+static LibSearchState g_state = LIBSEARCH_INPUT;
+
+// Input state
+static char g_query[128] = {0};
+static int g_query_cursor = 0;  // Position in text
+static int g_kbd_row = 0;       // Keyboard grid row
+static int g_kbd_col = 0;       // Keyboard grid column
+
+// Results of the current query
+static SearchHit g_results[SEARCHINDEX_MAX_HITS];
+static int g_result_count = 0;
+static int g_match_count = 0;
+static int g_results_cursor = 0;
+static int g_scroll_offset = 0;
+static float g_query_ms = 0.0f;
+
+/**
+ * Look the current query up again
+ */
+static void run_query(void) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    g_match_count = searchindex_query(g_query, g_results, SEARCHINDEX_MAX_HITS);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    g_result_count = g_match_count < SEARCHINDEX_MAX_HITS ? g_match_count : SEARCHINDEX_MAX_HITS;
+    g_results_cursor = 0;
+    g_scroll_offset = 0;
+    g_query_ms = (end.tv_sec - start.tv_sec) * 1000.0f + (end.tv_nsec - start.tv_nsec) / 1e6f;
+}
+
+void libsearch_init(void) {
+    g_state = LIBSEARCH_INPUT;
+    g_query[0] = '\0';
+    g_query_cursor = 0;
+    g_kbd_row = 0;
+    g_kbd_col = 0;
+    g_result_count = 0;
+    g_match_count = 0;
+    g_results_cursor = 0;
+    g_scroll_offset = 0;
+    g_query_ms = 0.0f;
+
+    // Tags make titles and artists findable; nothing to do once all are read
+    searchindex_enrich();
+    printf("[LIBSEARCH] %d tracks indexed\n", searchindex_count());
+}
+
+LibSearchState libsearch_get_state(void) {
+    return g_state;
+}
+
+void libsearch_set_state(LibSearchState state) {
+    g_state = state;
+}
+
+// ============================================================================
+// Input State
+// ============================================================================
+
+const char* libsearch_get_query(void) {
+    return g_query;
+}
+
+int libsearch_get_cursor(void) {
+    return g_query_cursor;
+}
+
+void libsearch_move_kbd(int dx, int dy) {
+    int cols, rows;
+    ytsearch_get_kbd_size(&cols, &rows);
+    g_kbd_col += dx;
+    g_kbd_row += dy;
+
+    // Wrap around
+    if (g_kbd_col < 0) g_kbd_col = cols - 1;
+    if (g_kbd_col >= cols) g_kbd_col = 0;
+    if (g_kbd_row < 0) g_kbd_row = rows - 1;
+    if (g_kbd_row >= rows) g_kbd_row = 0;
+}
+
+void libsearch_insert(void) {
+    int len = strlen(g_query);
+    if (len >= (int)sizeof(g_query) - 1) return;
+
+    char c = ytsearch_get_char_at(g_kbd_row, g_kbd_col);
+    if (c == '\0') return;
+
+    // Shift characters right to make room
+    for (int i = len; i >= g_query_cursor; i--) {
+        g_query[i + 1] = g_query[i];
+    }
+    g_query[g_query_cursor] = c;
+    g_query_cursor++;
+    run_query();
+}
+
+void libsearch_delete(void) {
+    int len = strlen(g_query);
+    if (g_query_cursor == 0 || len == 0) return;
+
+    // Shift characters left
+    for (int i = g_query_cursor - 1; i < len; i++) {
+        g_query[i] = g_query[i + 1];
+    }
+    g_query_cursor--;
+    run_query();
+}
+
+void libsearch_get_kbd_pos(int *row, int *col) {
+    if (row) *row = g_kbd_row;
+    if (col) *col = g_kbd_col;
+}
+
+// ============================================================================
+// Results State
+// ============================================================================
+
+int libsearch_get_result_count(void) {
+    return g_result_count;
+}
+
+int libsearch_get_match_count(void) {
+    return g_match_count;
+}
+
+const SearchHit* libsearch_get_result(int index) {
+    if (index < 0 || index >= g_result_count) {
+        return NULL;
+    }
+    return &g_results[index];
+}
+
+int libsearch_get_results_cursor(void) {
+    return g_results_cursor;
+}
+
+void libsearch_move_results_cursor(int delta) {
+    if (g_result_count == 0) return;
+    g_results_cursor += delta;
+
+    if (g_results_cursor < 0) {
+        g_results_cursor = g_result_count - 1;
+    }
+    if (g_results_cursor >= g_result_count) {
+        g_results_cursor = 0;
+    }
+
+    // Adjust scroll offset to keep cursor visible
+    if (g_results_cursor < g_scroll_offset) {
+        g_scroll_offset = g_results_cursor;
+    }
+    if (g_results_cursor >= g_scroll_offset + VISIBLE_RESULTS) {
+        g_scroll_offset = g_results_cursor - VISIBLE_RESULTS + 1;
+    }
+}
+
+int libsearch_get_scroll_offset(void) {
+    return g_scroll_offset;
+}
+
+float libsearch_get_query_ms(void) {
+    return g_query_ms;
+}
@@ -0,0 +1,118 @@
+/**
+ * Library Search UI State Management
+ *
+ * Manages the local search screen: a query typed on the YouTube search
+ * keyboard (ytsearch.h) and the matching tracks from the search index,
+ * which are looked up again on every keystroke.
+ */
+
+#ifndef LIBSEARCH_H
+#define LIBSEARCH_H
+
+#include <stdbool.h>
+#include "searchindex.h"
+
+/**
+ * Library search UI states
+ */
+typedef enum {
+    LIBSEARCH_INPUT,      // Keyboard, with the first matches below it
+    LIBSEARCH_RESULTS     // Full results list
+} LibSearchState;
+
+/**
+ * Initialize library search UI
+ * Resets to input state with empty query and starts tagging untagged
+ * tracks in the background.
+ */
+void libsearch_init(void);
+
+/**
+ * Get current UI state
+ */
+LibSearchState libsearch_get_state(void);
+
+/**
+ * Set UI state
+ */
+void libsearch_set_state(LibSearchState state);
+
+// ============================================================================
+// Input State (Character Picker)
+// ============================================================================
+
+/**
+ * Get current search query text
+ */
+const char* libsearch_get_query(void);
+
+/**
+ * Get cursor position in query text
+ */
+int libsearch_get_cursor(void);
+
+/**
+ * Move keyboard cursor in grid
+ * @param dx -1 for left, 1 for right
+ * @param dy -1 for up, 1 for down
+ */
+void libsearch_move_kbd(int dx, int dy);
+
+/**
+ * Insert currently selected character at cursor (updates the results)
+ */
+void libsearch_insert(void);
+
+/**
+ * Delete character before cursor (updates the results)
+ */
+void libsearch_delete(void);
+
+/**
+ * Get keyboard grid position
+ */
+void libsearch_get_kbd_pos(int *row, int *col);
+
+// ============================================================================
+// Results State
+// ============================================================================
+
+/**
+ * Get number of results in the list (at most SEARCHINDEX_MAX_HITS)
+ */
+int libsearch_get_result_count(void);
+
+/**
+ * Get number of matching tracks (may exceed the list)
+ */
+int libsearch_get_match_count(void);
+
+/**
+ * Get a result by index
+ * @return Pointer to result, or NULL if invalid index
+ */
+const SearchHit* libsearch_get_result(int index);
+
+/**
+ * Get current cursor position in results list
+ */
+int libsearch_get_results_cursor(void);
+
+/**
+ * Move cursor in results list
+ * @param delta -1 for up, 1 for down
+ */
+void libsearch_move_results_cursor(int delta);
+
+/**
+ * Get scroll offset for results list
+ */
+int libsearch_get_scroll_offset(void);
+
+/**
+ * Get how long the last lookup took
+ * @return Milliseconds
+ */
+float libsearch_get_query_ms(void);
+
+#endif // LIBSEARCH_H
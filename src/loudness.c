@@ -0,0 +1,323 @@
+/**
+ * Loudness Implementation
+ *
+ * The meter follows ITU-R BS.1770-4 / EBU R128: two-stage K-weighting
+ * (high shelf + RLB high-pass, coefficients derived for any sample rate),
+ * mean square per 100ms step, 400ms gating blocks overlapping by 75%, an
+ * absolute gate at -70 LUFS and a relative gate 10 LU below the level of
+ * what passed it. Block energies go into a 0.1 LU histogram instead of a
+ * list, so a meter is a few KB however long the track is.
+ *
+ * Measurements run one file per background-class job: dr_flac decodes the
+ * whole file through the bulk I/O gate, the result goes to the metadata
+ * cache. A file whose tags carry a gain just has that stored.
+ */
+
+#include "loudness.h"
+#include "equalizer.h"
+#include "metadata.h"
+#include "iosched.h"
+#include "jobs.h"
+#include "tags.h"
+#include "dr_flac.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#define LOUDNESS_MAX_CHANNELS 8
+#define LOUDNESS_ABS_GATE -70.0       // LUFS
+#define LOUDNESS_REL_GATE -10.0       // LU below the absolute-gated level
+#define LOUDNESS_HIST_MAX 10.0        // Top of the histogram (LUFS)
+#define LOUDNESS_HIST_STEP 0.1        // LU per histogram bin
+#define LOUDNESS_HIST_BINS 800        // (MAX - ABS_GATE) / STEP
+#define LOUDNESS_DECODE_FRAMES 4096   // Frames decoded per step of a measurement
+#define LOUDNESS_MAX_PENDING 4        // Measurements queued or running
+
+/**
+ * One biquad stage (a0 normalized to 1)
+ */
+typedef struct {
+    double b0, b1, b2, a1, a2;
+} Stage;
+
+struct LoudnessMeter {
+    int channels;
+    double weight[LOUDNESS_MAX_CHANNELS];
+    Stage shelf;
+    Stage highpass;
+    double z[LOUDNESS_MAX_CHANNELS][4];   // Stage history per channel (transposed DF-II)
+    int step_frames;                      // Frames per 100ms step
+    int step_pos;
+    double step_sum;                      // Weighted sum of squares of this step
+    double steps[4];                      // Mean squares of the last four steps
+    int step_count;
+    double bin_energy[LOUDNESS_HIST_BINS];
+    uint32_t bin_count[LOUDNESS_HIST_BINS];
+};
+
+// Main thread only
+static bool g_enabled = true;
+static float g_track_gain = 0.0f;
+static char g_pending[LOUDNESS_MAX_PENDING][512];
+
+/**
+ * Loudness of a mean square
+ */
+static double energy_to_lufs(double energy) {
+    return -0.691 + 10.0 * log10(energy);
+}
+
+/**
+ * Run one sample through a stage (transposed direct form II)
+ */
+static inline double stage_run(const Stage *s, double *z, double x) {
+    double y = s->b0 * x + z[0];
+    z[0] = s->b1 * x - s->a1 * y + z[1];
+    z[1] = s->b2 * x - s->a2 * y;
+    return y;
+}
+
+/**
+ * Close a 100ms step; every step after the fourth ends a gating block
+ */
+static void end_step(LoudnessMeter *m) {
+    m->steps[m->step_count % 4] = m->step_sum / m->step_frames;
+    m->step_count++;
+    m->step_sum = 0.0;
+    m->step_pos = 0;
+    if (m->step_count < 4) return;
+
+    double energy = (m->steps[0] + m->steps[1] + m->steps[2] + m->steps[3]) / 4.0;
+    if (energy <= 0.0) return;
+    double lufs = energy_to_lufs(energy);
+    if (lufs < LOUDNESS_ABS_GATE) return;
+
+    int bin = (int)((lufs - LOUDNESS_ABS_GATE) / LOUDNESS_HIST_STEP);
+    if (bin >= LOUDNESS_HIST_BINS) bin = LOUDNESS_HIST_BINS - 1;
+    m->bin_energy[bin] += energy;
+    m->bin_count[bin]++;
+}
+
+LoudnessMeter* loudness_meter_create(int sample_rate, int channels) {
+    if (sample_rate < 8000 || channels <= 0 || channels > LOUDNESS_MAX_CHANNELS) return NULL;
+
+    LoudnessMeter *m = calloc(1, sizeof(LoudnessMeter));
+    if (!m) return NULL;
+    m->channels = channels;
+    m->step_frames = sample_rate / 10;
+
+    // BS.1770 weights: 5.1 drops the LFE and lifts the surrounds
+    for (int c = 0; c < channels; c++) m->weight[c] = 1.0;
+    if (channels == 6) {
+        m->weight[3] = 0.0;
+        m->weight[4] = 1.41;
+        m->weight[5] = 1.41;
+    }
+
+    // Stage 1: high shelf, +4 dB above ~1.7 kHz (head response)
+    double f0 = 1681.974450955533;
+    double gain = 3.999843853973347;
+    double q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / sample_rate);
+    double vh = pow(10.0, gain / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    m->shelf.b0 = (vh + vb * k / q + k * k) / a0;
+    m->shelf.b1 = 2.0 * (k * k - vh) / a0;
+    m->shelf.b2 = (vh - vb * k / q + k * k) / a0;
+    m->shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+    m->shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+    // Stage 2: RLB high-pass at ~38 Hz
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / sample_rate);
+    a0 = 1.0 + k / q + k * k;
+    m->highpass.b0 = 1.0;
+    m->highpass.b1 = -2.0;
+    m->highpass.b2 = 1.0;
+    m->highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+    m->highpass.a2 = (1.0 - k / q + k * k) / a0;
+    return m;
+}
+
+void loudness_meter_destroy(LoudnessMeter *m) {
+    free(m);
+}
+
+void loudness_meter_add(LoudnessMeter *m, const int16_t *pcm, int frames) {
+    const int channels = m->channels;
+    for (int i = 0; i < frames; i++) {
+        double sum = 0.0;
+        for (int c = 0; c < channels; c++) {
+            double x = pcm[c] / 32768.0;
+            double y = stage_run(&m->shelf, m->z[c], x);
+            y = stage_run(&m->highpass, m->z[c] + 2, y);
+            sum += m->weight[c] * y * y;
+        }
+        pcm += channels;
+
+        m->step_sum += sum;
+        if (++m->step_pos == m->step_frames) end_step(m);
+    }
+}
+
+bool loudness_meter_integrated(const LoudnessMeter *m, double *lufs) {
+    double energy = 0.0;
+    uint64_t count = 0;
+    for (int b = 0; b < LOUDNESS_HIST_BINS; b++) {
+        energy += m->bin_energy[b];
+        count += m->bin_count[b];
+    }
+    if (count == 0) return false;
+
+    // Relative gate: drop blocks 10 LU under the absolute-gated mean
+    double gate = energy_to_lufs(energy / count) + LOUDNESS_REL_GATE;
+    int first = (int)ceil((gate - LOUDNESS_ABS_GATE) / LOUDNESS_HIST_STEP);
+    if (first < 0) first = 0;
+
+    energy = 0.0;
+    count = 0;
+    for (int b = first; b < LOUDNESS_HIST_BINS; b++) {
+        energy += m->bin_energy[b];
+        count += m->bin_count[b];
+    }
+    if (count == 0) return false;
+
+    *lufs = energy_to_lufs(energy / count);
+    return true;
+}
+
+/**
+ * Check if a path is a FLAC file (the only format decoded outside SDL_mixer)
+ */
+static bool is_measurable(const char *path) {
+    const char *ext = strrchr(path, '.');
+    return ext && strcasecmp(ext, ".flac") == 0;
+}
+
+/**
+ * Decode a FLAC file and measure it
+ * @return false if cancelled, unreadable or silent
+ */
+static bool measure_flac(const char *path, double *lufs, const volatile bool *cancel) {
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+
+    drflac *flac = drflac_open_file(path, NULL);
+    if (!flac) return false;
+
+    LoudnessMeter *m = loudness_meter_create((int)flac->sampleRate, flac->channels);
+    int16_t *pcm = malloc((size_t)LOUDNESS_DECODE_FRAMES * flac->channels * sizeof(int16_t));
+
+    // Charge the gate with the compressed bytes each step reads
+    size_t step_bytes = flac->totalPCMFrameCount > 0
+        ? (size_t)((uint64_t)st.st_size * LOUDNESS_DECODE_FRAMES / flac->totalPCMFrameCount)
+        : (size_t)LOUDNESS_DECODE_FRAMES * flac->channels;
+
+    bool ok = m && pcm;
+    while (ok) {
+        if (!iosched_gate(step_bytes, cancel)) {
+            ok = false;
+            break;
+        }
+        drflac_uint64 frames = drflac_read_pcm_frames_s16(flac, LOUDNESS_DECODE_FRAMES, pcm);
+        if (frames == 0) break;
+        loudness_meter_add(m, pcm, (int)frames);
+    }
+
+    ok = ok && loudness_meter_integrated(m, lufs);
+    free(pcm);
+    loudness_meter_destroy(m);
+    drflac_close(flac);
+    return ok;
+}
+
+/**
+ * Measurement job: stores a gain for the path in arg
+ */
+static void measure_job(void *arg, const volatile bool *cancel) {
+    const char *path = (const char *)arg;
+
+    float gain;
+    if (metadata_get_gain(path, &gain)) return;
+
+    TrackInfo info;
+    tags_probe(path, &info);
+    if (info.has_replaygain) {
+        metadata_set_gain(path, info.replaygain_db);
+        printf("[LOUDNESS] Tagged %+.2f dB: %s\n", info.replaygain_db, path);
+        return;
+    }
+
+    double lufs;
+    if (!measure_flac(path, &lufs, cancel)) return;
+
+    gain = (float)(LOUDNESS_TARGET_LUFS - lufs);
+    metadata_set_gain(path, gain);
+    printf("[LOUDNESS] %.1f LUFS, gain %+.2f dB: %s\n", lufs, gain, path);
+}
+
+/**
+ * Free a finished job's path and its pending slot
+ */
+static void measure_done(void *arg, bool cancelled) {
+    (void)cancelled;
+    for (int i = 0; i < LOUDNESS_MAX_PENDING; i++) {
+        if (g_pending[i] == (char *)arg) g_pending[i][0] = '\0';
+    }
+}
+
+void loudness_request(const char *path) {
+    if (!path || !path[0] || strlen(path) >= sizeof(g_pending[0]) || !is_measurable(path)) return;
+
+    float gain;
+    if (metadata_get_gain(path, &gain)) return;
+
+    int free_slot = -1;
+    for (int i = 0; i < LOUDNESS_MAX_PENDING; i++) {
+        if (strcmp(g_pending[i], path) == 0) return;
+        if (!g_pending[i][0] && free_slot < 0) free_slot = i;
+    }
+    if (free_slot < 0) return;
+
+    // The slot holds the path until measure_done() clears it
+    char *slot = g_pending[free_slot];
+    strcpy(slot, path);
+    if (jobs_submit(JOB_CLASS_BACKGROUND, "loudness", measure_job, measure_done, slot) == 0) {
+        slot[0] = '\0';
+    }
+}
+
+float loudness_track_gain(const char *path, const TrackInfo *info) {
+    float gain = 0.0f;
+    if (info && info->has_replaygain) {
+        gain = info->replaygain_db;
+    } else if (!path || !metadata_get_gain(path, &gain)) {
+        loudness_request(path);
+        return 0.0f;
+    }
+
+    if (gain < LOUDNESS_GAIN_MIN_DB) gain = LOUDNESS_GAIN_MIN_DB;
+    if (gain > LOUDNESS_GAIN_MAX_DB) gain = LOUDNESS_GAIN_MAX_DB;
+    return gain;
+}
+
+void loudness_apply(float gain_db) {
+    g_track_gain = gain_db;
+    eq_set_pregain_db(g_enabled ? gain_db : 0.0f);
+}
+
+void loudness_set_enabled(bool enabled) {
+    if (enabled == g_enabled) return;
+    g_enabled = enabled;
+    eq_set_pregain_db(g_enabled ? g_track_gain : 0.0f);
+    printf("[LOUDNESS] Normalization %s\n", enabled ? "on" : "off");
+}
+
+bool loudness_is_enabled(void) {
+    return g_enabled;
+}
@@ -0,0 +1,90 @@
+/**
+ * Loudness - EBU R128 track gain for volume normalization
+ *
+ * Each track is played at a ReplayGain 2.0 style gain (-18 LUFS target):
+ * from its own REPLAYGAIN_TRACK_GAIN / R128_TRACK_GAIN tag when it has
+ * one, else from an integrated loudness measurement kept in the metadata
+ * cache. Untagged FLACs are measured by a background-class job the first
+ * time they are played or queued, so the gain is there on the next play.
+ * The gain is applied as the equalizer's pre-gain, so it costs no pass
+ * over the samples of its own.
+ */
+
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "audio.h"
+
+// ReplayGain 2.0 reference level
+#define LOUDNESS_TARGET_LUFS -18.0
+
+// Applied gain range (boosts stay small: the EQ soft-clips above that)
+#define LOUDNESS_GAIN_MIN_DB -15.0f
+#define LOUDNESS_GAIN_MAX_DB 6.0f
+
+/**
+ * BS.1770 integrated loudness meter (K-weighting, 400ms blocks, gated)
+ */
+typedef struct LoudnessMeter LoudnessMeter;
+
+/**
+ * Create a meter
+ * @param sample_rate Input rate in Hz
+ * @param channels Interleaved channel count (1-8; 5.1 gets surround weights)
+ * @return Meter, or NULL on bad arguments / out of memory
+ */
+LoudnessMeter* loudness_meter_create(int sample_rate, int channels);
+
+/**
+ * Free a meter (NULL is fine)
+ */
+void loudness_meter_destroy(LoudnessMeter *m);
+
+/**
+ * Feed interleaved S16 samples
+ * @param frames Number of frames
+ */
+void loudness_meter_add(LoudnessMeter *m, const int16_t *pcm, int frames);
+
+/**
+ * Integrated loudness of everything fed so far
+ * @param lufs Output: loudness in LUFS
+ * @return false if every block was below the absolute gate (silence)
+ */
+bool loudness_meter_integrated(const LoudnessMeter *m, double *lufs);
+
+/**
+ * Gain for a track, from its tags or the cache
+ * Queues a measurement when the track has neither. Main thread.
+ * @param path Audio file path
+ * @param info Track info as probed (has_replaygain / replaygain_db)
+ * @return Gain in dB, 0 if unknown yet
+ */
+float loudness_track_gain(const char *path, const TrackInfo *info);
+
+/**
+ * Measure a file in the background if nothing is known about it
+ * Only FLAC is measured (the other formats are decoded inside SDL_mixer).
+ * @param path Audio file path
+ */
+void loudness_request(const char *path);
+
+/**
+ * Set the gain of the track that is now playing (main thread)
+ * @param gain_db Track gain; ignored while normalization is off
+ */
+void loudness_apply(float gain_db);
+
+/**
+ * Turn normalization on or off (takes effect at once)
+ */
+void loudness_set_enabled(bool enabled);
+
+/**
+ * Check if normalization is on
+ */
+bool loudness_is_enabled(void);
+
+#endif // LOUDNESS_H
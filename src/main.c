@@ -15,7 +15,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
-#include <dirent.h>
 #include <stdbool.h>
 #include <time.h>
 
@@ -38,10 +37,27 @@
 #include "download_queue.h"
 #include "equalizer.h"
 #include "preload.h"
+#include "wav.h"
 #include "spotify.h"
 #include "spsearch.h"
 #include "spotify_audio.h"
 #include "update.h"
+#include "warmup.h"
+#include "trace.h"
+#include "startup.h"
+#include "jobs.h"
+#include "memgov.h"
+#include "jsonarena.h"
+#include "library.h"
+#include "mp3index.h"
+#include "persist.h"
+#include "shuffle.h"
+#include "loudness.h"
+#include "searchindex.h"
+#include "libsearch.h"
+#include "spectrum.h"
+#include "snapshot.h"
+#include "perfhud.h"
 
 // Screen dimensions (auto-detected at runtime)
 static int g_screen_width = 1280;   // Fallback
@@ -63,11 +79,13 @@ typedef enum {
     STATE_RENAME,       // Rename text input
     STATE_SCANNING,     // Scanning metadata (MusicBrainz)
     STATE_SCAN_COMPLETE,// Scan finished
+    STATE_LIBRARY_SEARCH,   // Library search input (live matches)
+    STATE_LIBRARY_RESULTS,  // Library search results list
     STATE_YOUTUBE_SEARCH,   // YouTube search input
     STATE_YOUTUBE_RESULTS,  // YouTube results list
     STATE_YOUTUBE_DOWNLOAD, // YouTube download progress
     STATE_DOWNLOAD_QUEUE,   // Download queue list view
-    STATE_SEEKING,          // Seeking in FLAC file (shows loading)
+    STATE_SEEKING,          // Deferred seek (resume prompt, shows loading)
     STATE_EQUALIZER,        // Equalizer screen (bass/treble horizontal bars)
     STATE_SPOTIFY_CONNECT,  // Waiting for phone to connect via Spotify Connect
     STATE_SPOTIFY_SEARCH,   // Spotify search input keyboard
@@ -85,7 +103,7 @@ static char g_error_message[256] = {0};  // Last error message
 static char g_loading_file[256] = {0};   // File being loaded
 
 // Home menu state
-typedef enum { HOME_RESUME, HOME_BROWSE, HOME_FAVORITES, HOME_YOUTUBE, HOME_SPOTIFY, HOME_COUNT } HomeItem;
+typedef enum { HOME_RESUME, HOME_BROWSE, HOME_SEARCH, HOME_FAVORITES, HOME_YOUTUBE, HOME_SPOTIFY, HOME_COUNT } HomeItem;
 static int g_home_cursor = HOME_BROWSE;  // Default to Browse
 
 // Resume list state
@@ -97,16 +115,31 @@ static int g_favorites_cursor = 0;
 static int g_favorites_scroll = 0;
 
 // Metadata scanning state
-static char g_scan_folder[512] = {0};
 static int g_scan_current = 0;
 static int g_scan_total = 0;
 static int g_scan_found = 0;
 static char g_scan_current_file[256] = {0};
-static bool g_scan_cancelled = false;
 
 // Currently playing track path (for state persistence)
 static char g_current_track_path[512] = {0};
 
+// Track the audio thread handed off to, while the track-end logic runs
+static char g_handoff_track[512] = {0};
+
+// What picks the next track: queued decks are checked against it
+typedef struct {
+    RepeatMode repeat;
+    bool shuffle;
+    bool favorites;
+    int index;          // Favorites playback index, or browser cursor
+    int count;
+    char dir[512];
+} PlaylistPos;
+
+// Track queued on the second deck, and the playlist it was picked from
+static char g_queued_track[512] = {0};
+static PlaylistPos g_queued_pos;
+
 // Seek target for STATE_SEEKING (-1 = none)
 static int g_seek_target = -1;
 
@@ -209,18 +242,22 @@ static int init_sdl(void) {
         // Ensure A2DP profile is connected (not just BT control channel)
         if (bluealsa_configured && bt_device_mac[0]) {
             printf("Ensuring A2DP connection to %s...\n", bt_device_mac);
+            trace_begin("a2dp_connect");
             char cmd[128];
             snprintf(cmd, sizeof(cmd), "bluetoothctl connect %s >/dev/null 2>&1", bt_device_mac);
             system(cmd);
             SDL_Delay(500);  // Give A2DP time to establish
+            trace_end();
         }
     }
     #endif
 
     // Initialize SDL_mixer for audio playback
     // 44100 Hz (CD quality), signed 16-bit, stereo, 2048 sample buffer
+    // (later resized with the power mode, see audio_period_for_mode())
     // Try bluealsa first if configured, fall back to default if it fails
     bool using_bluetooth = false;
+    trace_begin("mix_open_audio");
     #ifdef __linux__
     if (bluealsa_configured) {
         SDL_setenv("AUDIODEV", "bluealsa", 1);
@@ -230,7 +267,7 @@ static int init_sdl(void) {
                 printf("Retrying bluealsa (%d/3)...\n", retry + 1);
                 SDL_Delay(500);  // Wait 500ms between retries
             }
-            if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == 0) {
+            if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, AUDIO_PERIOD_DEFAULT) == 0) {
                 printf("Bluetooth audio (bluealsa) opened successfully\n");
                 using_bluetooth = true;
                 // Enable BT mode (detects control name) and set volume to 100%
@@ -260,7 +297,7 @@ static int init_sdl(void) {
         }
         #endif
         printf("Opening default audio...\n");
-        if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+        if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, AUDIO_PERIOD_DEFAULT) < 0) {
             fprintf(stderr, "Mix_OpenAudio (default) failed: %s\n", Mix_GetError());
             TTF_Quit();
             SDL_Quit();
@@ -268,10 +305,26 @@ static int init_sdl(void) {
         }
         printf("Default audio opened successfully\n");
     }
+    trace_end();
 
     return 0;
 }
 
+/**
+ * Device period for the power mode and screen state
+ * Screen off or dimmed: long periods so the SoC sleeps between callbacks.
+ * Performance: short ones for snappier EQ changes and seeks.
+ */
+static int audio_period_for_mode(void) {
+    if (screen_is_off()) return AUDIO_PERIOD_MAX;
+    if (screen_is_dimmed()) return 4096;
+    switch (menu_get_power_mode()) {
+        case POWER_MODE_BATTERY:     return 4096;
+        case POWER_MODE_PERFORMANCE: return 1024;
+        default:                     return AUDIO_PERIOD_DEFAULT;
+    }
+}
+
 /**
  * Save current playback position for the current track
  */
@@ -284,6 +337,204 @@ static void save_current_position(void) {
     }
 }
 
+/**
+ * Load a track handed over by the preloader, then free the handoff struct
+ * FLAC arrives as decoded WAV (+ streaming tail); other formats as the
+ * compressed file in memory (or page-cache warmed) with tags pre-read.
+ * @param path Path to the audio file
+ * @param preloaded Result of preload_consume() (may be NULL)
+ * @return true if loaded successfully
+ */
+static bool load_preloaded_track(const char *path, PreloadedTrack *preloaded) {
+    if (!preloaded) return false;
+
+    bool loaded = false;
+    if (preloaded->is_flac) {
+        if (preloaded->wav_data) {
+            loaded = audio_load_preloaded(path, preloaded->wav_data, preloaded->wav_size,
+                                           preloaded->flac_handle, preloaded->duration_sec);
+        }
+        // wav_data/flac_handle ownership transferred, only free struct
+        preloaded->wav_data = NULL;
+        preloaded->flac_handle = NULL;
+    } else {
+        loaded = audio_load_preloaded_music(path, preloaded->file_data,
+                                            preloaded->file_size, &preloaded->info,
+                                            &preloaded->toc);
+        preloaded->file_data = NULL;  // Ownership transferred
+    }
+
+    preload_free_track(preloaded);
+    return loaded;
+}
+
+/**
+ * Bring the shuffle order in line with what is playing
+ * Favorites playback shuffles the favorites, otherwise the files of the
+ * browser folder (directories and ".." never come up).
+ */
+static void shuffle_sync_playlist(void) {
+    bool favorites = favorites_is_playback_mode();
+    int count = favorites ? favorites_get_count() : browser_get_count();
+    int *items = count > 0 ? (int *)malloc(count * sizeof(int)) : NULL;
+    if (!items) {
+        shuffle_reset();
+        return;
+    }
+
+    int files = 0;
+    int current = -1;
+    if (favorites) {
+        for (int i = 0; i < count; i++) items[files++] = i;
+        current = favorites_get_playback_index();
+    } else {
+        for (int i = 0; i < count; i++) {
+            const FileEntry *entry = browser_get_entry(i);
+            if (entry && entry->type == ENTRY_FILE) items[files++] = i;
+        }
+        // The cursor is the playing track unless the user has moved it
+        const char *selected = browser_get_selected_path();
+        if (selected && strcmp(selected, g_current_track_path) == 0) {
+            current = browser_get_cursor();
+        }
+    }
+
+    const char *dir = browser_get_current_path();
+    shuffle_sync(favorites ? "favorites" : (dir ? dir : ""), items, files, current);
+    free(items);
+}
+
+/**
+ * Path of the track that plays after the current one (for the preloader)
+ * Follows the shuffle order or the favorites when those are active.
+ * @return Path, or NULL if nothing follows
+ */
+static const char* next_track_path(void) {
+    if (menu_is_shuffle_enabled()) {
+        shuffle_sync_playlist();
+        int next = shuffle_peek();
+        if (next < 0) return NULL;
+        return favorites_is_playback_mode() ? favorites_get_path(next)
+                                            : browser_get_entry_path(next);
+    }
+
+    if (favorites_is_playback_mode()) {
+        int count = favorites_get_count();
+        int next = favorites_get_playback_index() + 1;
+        if (count <= 0 || (next >= count && menu_get_repeat_mode() != REPEAT_ALL)) {
+            return NULL;
+        }
+        return favorites_get_path(next % count);
+    }
+
+    return browser_get_next_track_path();
+}
+
+/**
+ * Capture the state next_track_path() depends on
+ */
+static void playlist_pos_get(PlaylistPos *pos) {
+    memset(pos, 0, sizeof(*pos));
+    pos->repeat = menu_get_repeat_mode();
+    pos->shuffle = menu_is_shuffle_enabled();
+    pos->favorites = favorites_is_playback_mode();
+    if (pos->favorites) {
+        pos->index = favorites_get_playback_index();
+        pos->count = favorites_get_count();
+    } else {
+        pos->index = browser_get_cursor();
+        pos->count = browser_get_count();
+        const char *dir = browser_get_current_path();
+        if (dir) strncpy(pos->dir, dir, sizeof(pos->dir) - 1);
+    }
+}
+
+/**
+ * Take back the queued deck if it is no longer what plays next
+ * Repeat, shuffle or the playlist may have changed since it was queued;
+ * the track-end logic in update() would then cut it off right after the
+ * audio thread switched to it. The new next track is preloaded instead.
+ */
+static void check_queued_track(void) {
+    if (!g_queued_track[0] || !audio_has_queued()) return;
+
+    PlaylistPos pos;
+    playlist_pos_get(&pos);
+    if (memcmp(&pos, &g_queued_pos, sizeof(pos)) == 0) return;
+
+    const char *next = pos.repeat == REPEAT_ONE ? NULL : next_track_path();
+    if (next && strcmp(next, g_queued_track) == 0) {
+        memcpy(&g_queued_pos, &pos, sizeof(pos));  // Same track still comes next
+        return;
+    }
+
+    // False if the audio thread got there first: update() sees the handoff
+    if (!audio_unqueue()) return;
+    g_queued_track[0] = '\0';
+    next = next_track_path();
+    if (next) preload_start(next);
+}
+
+/**
+ * Switch to the next track at a track end, gapless if it was preloaded
+ * @param path Path to the audio file (may be NULL)
+ * @return true if it is playing
+ */
+static bool play_next_track(const char *path) {
+    if (!path) return false;
+
+    // Already playing: the audio thread switched decks at the track end
+    if (g_handoff_track[0] && strcmp(path, g_handoff_track) == 0) {
+        strncpy(g_current_track_path, path, sizeof(g_current_track_path) - 1);
+        const char *next = next_track_path();
+        if (next) preload_start(next);
+        return true;
+    }
+
+    // Try gapless transition first
+    bool loaded = load_preloaded_track(path, preload_consume(path));
+    if (loaded) {
+        printf("[GAPLESS] Seamless transition to: %s\n", path);
+    }
+    if (!loaded) {
+        loaded = audio_load(path);
+    }
+    if (!loaded) return false;
+
+    strncpy(g_current_track_path, path, sizeof(g_current_track_path) - 1);
+    audio_play();
+
+    // Preload next track
+    const char *next = next_track_path();
+    if (next) preload_start(next);
+    return true;
+}
+
+/**
+ * Open a file's folder in the browser with the cursor on the file
+ * @param path Path to the audio file
+ */
+static void browse_to_file(const char *path) {
+    char dir[512];
+    strncpy(dir, path, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+    char *last_slash = strrchr(dir, '/');
+    if (!last_slash) return;
+
+    *last_slash = '\0';
+    browser_navigate_to(dir);
+    browser_wait_for_scan();
+    const char *filename = last_slash + 1;
+    int count = browser_get_count();
+    for (int i = 0; i < count; i++) {
+        const FileEntry *entry = browser_get_entry(i);
+        if (entry && strcmp(entry->name, filename) == 0) {
+            browser_set_cursor(i);
+            break;
+        }
+    }
+}
+
 /**
  * Load and play a file, restoring saved position if available
  * @param path Path to the audio file
@@ -301,19 +552,9 @@ static bool play_file(const char *path) {
     strncpy(g_loading_file, filename, sizeof(g_loading_file) - 1);
 
     // Check if we have preloaded data for this track (gapless playback)
-    PreloadedTrack *preloaded = preload_consume(path);
-    bool loaded = false;
-
-    if (preloaded && preloaded->is_flac && preloaded->wav_data) {
-        // Use preloaded FLAC data for instant transition
-        loaded = audio_load_preloaded(path, preloaded->wav_data, preloaded->wav_size,
-                                       preloaded->duration_sec);
-        if (loaded) {
-            // wav_data ownership transferred, only free struct
-            preloaded->wav_data = NULL;
-            printf("[GAPLESS] Used preloaded data for: %s\n", filename);
-        }
-        preload_free_track(preloaded);
+    bool loaded = load_preloaded_track(path, preload_consume(path));
+    if (loaded) {
+        printf("[GAPLESS] Used preloaded data for: %s\n", filename);
     }
 
     if (!loaded) {
@@ -344,7 +585,7 @@ static bool play_file(const char *path) {
     // If saved_pos > 0, playback starts in STATE_RESUME_PROMPT handler
 
     // Start preloading next track for gapless playback
-    const char *next_path = browser_get_next_track_path();
+    const char *next_path = next_track_path();
     if (next_path) {
         preload_start(next_path);
     }
@@ -385,6 +626,10 @@ static void save_app_state(void) {
     state_data.repeat = menu_get_repeat_mode();
     state_data.theme = theme_get_current();
     state_data.power_mode = menu_get_power_mode();
+    state_data.download_format = menu_get_download_format();
+    state_data.crossfade_sec = menu_get_crossfade_sec();
+    state_data.normalize = menu_is_normalize_enabled();
+    state_data.spectrum = menu_is_spectrum_enabled();
     for (int i = 0; i < EQ_BAND_COUNT; i++) {
         state_data.eq_bands[i] = eq_get_band_db(i);
     }
@@ -399,25 +644,41 @@ static void save_app_state(void) {
  * Cleanup all SDL resources
  */
 static void cleanup(void) {
+    // Let any init still running in the background finish first
+    startup_wait_all();
+
+    // Stop decode/scan jobs before the modules they write into go away
+    jobs_shutdown();
+
     // Save state before cleanup
     save_app_state();
+    snapshot_save(g_current_track_path, g_state == STATE_PLAYING);
 
     // Save favorites, positions, and restore screen
+    warmup_cleanup();
     positions_cleanup();
     favorites_cleanup();
     state_cleanup();
+    persist_cleanup();
     screen_cleanup();
     sysinfo_cleanup();
 
     metadata_cleanup();
     dlqueue_shutdown();
+    ytsearch_cleanup();
+    spsearch_cleanup();
     youtube_cleanup();
     spotify_cleanup();
     sp_audio_cleanup();
     update_cleanup();
     preload_cleanup();
+    library_cleanup();
+    searchindex_cleanup();
+    mp3index_cleanup();
     eq_cleanup();
     audio_cleanup();
+    wav_pool_cleanup();
+    json_arena_report();
     ui_cleanup();
     browser_cleanup();
 
@@ -459,6 +720,7 @@ static void handle_input(AppState *state) {
         int seek_amount = input_get_seek_amount();
         if (seek_amount != 0) {
             audio_seek(seek_amount);
+            ui_invalidate();
         }
     }
 
@@ -467,13 +729,16 @@ static void handle_input(AppState *state) {
     if (power_action == INPUT_SUSPEND) {
         bool was_playing = audio_is_playing();
         if (was_playing) audio_toggle_pause();
+        snapshot_save(g_current_track_path, *state == STATE_PLAYING);
         screen_system_suspend();
         input_drain_power();  // Clear accumulated events after wake
+        ui_invalidate();
         if (was_playing) audio_toggle_pause();
     }
 
     // Poll hardware volume buttons (reads from /dev/input/event0 on Linux)
     InputAction vol_action = input_poll_volume();
+    if (vol_action != INPUT_NONE) ui_invalidate();
     if (vol_action == INPUT_VOL_UP) {
         int vol = audio_get_volume();
         audio_set_volume(vol + 5);
@@ -492,6 +757,7 @@ static void handle_input(AppState *state) {
         }
 
         InputAction action = input_handle_event(&event);
+        if (action != INPUT_NONE) ui_invalidate();
 
         // Global exit handler (Start + B combo)
         if (action == INPUT_EXIT) {
@@ -499,10 +765,17 @@ static void handle_input(AppState *state) {
             return;
         }
 
+        // Global perf HUD toggle (Start + Select combo)
+        if (action == INPUT_PERF_HUD) {
+            perfhud_toggle();
+            continue;
+        }
+
         // Global suspend handler (power button)
         if (action == INPUT_SUSPEND) {
             bool was_playing = audio_is_playing();
             if (was_playing) audio_toggle_pause();
+            snapshot_save(g_current_track_path, *state == STATE_PLAYING);
             screen_system_suspend();
             if (was_playing) audio_toggle_pause();
             continue;
@@ -536,7 +809,7 @@ static void handle_input(AppState *state) {
             if (action == INPUT_SELECT) {
                 FileMenuResult result = filemenu_confirm_delete(true);
                 if (result == FILEMENU_RESULT_DELETED) {
-                    browser_rescan_preserve_cursor();
+                    browser_entry_removed(filemenu_get_path(), filemenu_is_directory());
                 }
                 *state = STATE_BROWSER;
             } else if (action == INPUT_BACK) {
@@ -585,6 +858,12 @@ static void handle_input(AppState *state) {
                         case HOME_BROWSE:
                             *state = STATE_BROWSER;
                             break;
+                        case HOME_SEARCH:
+                            if (searchindex_count() > 0) {
+                                libsearch_init();
+                                *state = STATE_LIBRARY_SEARCH;
+                            }
+                            break;
                         case HOME_FAVORITES:
                             if (favorites_get_count() > 0) {
                                 g_favorites_cursor = 0;
@@ -664,6 +943,7 @@ static void handle_input(AppState *state) {
                         if (last_slash) {
                             *last_slash = '\0';
                             browser_navigate_to(dir);
+                            browser_wait_for_scan();
                             // Find and select the file
                             const char *filename = last_slash + 1;
                             int browser_count = browser_get_count();
@@ -741,6 +1021,7 @@ static void handle_input(AppState *state) {
                         if (last_slash) {
                             *last_slash = '\0';
                             browser_navigate_to(dir);
+                            browser_wait_for_scan();
                             const char *filename = last_slash + 1;
                             int browser_count = browser_get_count();
                             for (int i = 0; i < browser_count; i++) {
@@ -799,32 +1080,16 @@ static void handle_input(AppState *state) {
                             filemenu_rename_init();
                             *state = STATE_RENAME;
                         } else if (option == FILEMENU_SCAN_METADATA) {
-                            // Initialize metadata scan
-                            strncpy(g_scan_folder, filemenu_get_path(), sizeof(g_scan_folder) - 1);
+                            // Metadata scan runs on a worker thread (rate-limited network)
                             g_scan_current = 0;
+                            g_scan_total = 0;
                             g_scan_found = 0;
-                            g_scan_cancelled = false;
                             g_scan_current_file[0] = '\0';
-
-                            // Count audio files in folder
-                            g_scan_total = 0;
-                            DIR *dir = opendir(g_scan_folder);
-                            if (dir) {
-                                struct dirent *entry;
-                                while ((entry = readdir(dir)) != NULL) {
-                                    if (entry->d_name[0] == '.') continue;
-                                    const char *ext = strrchr(entry->d_name, '.');
-                                    if (ext && (strcasecmp(ext, ".mp3") == 0 ||
-                                                strcasecmp(ext, ".flac") == 0 ||
-                                                strcasecmp(ext, ".ogg") == 0 ||
-                                                strcasecmp(ext, ".wav") == 0)) {
-                                        g_scan_total++;
-                                    }
-                                }
-                                closedir(dir);
+                            if (metadata_scan_start(filemenu_get_path())) {
+                                *state = STATE_SCANNING;
+                            } else {
+                                *state = STATE_BROWSER;
                             }
-
-                            *state = STATE_SCANNING;
                         } else if (option == FILEMENU_CANCEL) {
                             *state = STATE_BROWSER;
                         }
@@ -896,7 +1161,8 @@ static void handle_input(AppState *state) {
                         // Open file menu for selected item (not parent "..")
                         const FileEntry *entry = browser_get_entry(browser_get_cursor());
                         if (entry && entry->type != ENTRY_PARENT) {
-                            filemenu_init(entry->full_path, entry->type == ENTRY_DIRECTORY);
+                            filemenu_init(browser_get_entry_path(browser_get_cursor()),
+                                          entry->type == ENTRY_DIRECTORY);
                             *state = STATE_FILE_MENU;
                         }
                         break;
@@ -997,25 +1263,14 @@ static void handle_input(AppState *state) {
                         break;
                     case INPUT_SEEK_START:
                         // L2 - jump to beginning of track
-                        if (audio_is_flac()) {
-                            // FLAC: use STATE_SEEKING for clean loading display
-                            g_seek_target = 0;
-                            *state = STATE_SEEKING;
-                        } else {
-                            audio_seek_absolute(0);
-                        }
+                        // (FLAC seeks are a cursor move now, no loading screen needed)
+                        audio_seek_absolute(0);
                         break;
                     case INPUT_SEEK_END: {
                         // R2 - jump near end of track (5 seconds before end)
                         const TrackInfo *info = audio_get_track_info();
                         if (info && info->duration_sec > 5) {
-                            if (audio_is_flac()) {
-                                // FLAC: use STATE_SEEKING for clean loading display
-                                g_seek_target = info->duration_sec - 5;
-                                *state = STATE_SEEKING;
-                            } else {
-                                audio_seek_absolute(info->duration_sec - 5);
-                            }
+                            audio_seek_absolute(info->duration_sec - 5);
                         }
                         break;
                     }
@@ -1130,7 +1385,8 @@ static void handle_input(AppState *state) {
                         // Start = confirm rename
                         FileMenuResult result = filemenu_rename_confirm();
                         if (result == FILEMENU_RESULT_RENAMED) {
-                            browser_navigate_to(browser_get_current_path());
+                            browser_entry_renamed(filemenu_get_path(), filemenu_rename_get_new_path(),
+                                                  filemenu_is_directory());
                         }
                         *state = STATE_BROWSER;
                         break;
@@ -1155,7 +1411,7 @@ static void handle_input(AppState *state) {
             case STATE_SCANNING:
                 // B to cancel scanning
                 if (action == INPUT_BACK) {
-                    g_scan_cancelled = true;
+                    metadata_scan_cancel();
                     *state = STATE_SCAN_COMPLETE;
                 }
                 break;
@@ -1167,6 +1423,75 @@ static void handle_input(AppState *state) {
                 }
                 break;
 
+            case STATE_LIBRARY_SEARCH:
+                switch (action) {
+                    case INPUT_UP:
+                        libsearch_move_kbd(0, -1);
+                        break;
+                    case INPUT_DOWN:
+                        libsearch_move_kbd(0, 1);
+                        break;
+                    case INPUT_LEFT:
+                        libsearch_move_kbd(-1, 0);
+                        break;
+                    case INPUT_RIGHT:
+                        libsearch_move_kbd(1, 0);
+                        break;
+                    case INPUT_SELECT:
+                        libsearch_insert();  // Results follow every keystroke
+                        break;
+                    case INPUT_FAVORITE:
+                    case INPUT_BACK:
+                        // Y or B = delete character (backspace)
+                        libsearch_delete();
+                        break;
+                    case INPUT_MENU:
+                        // Start = browse the results
+                        if (libsearch_get_result_count() > 0) {
+                            libsearch_set_state(LIBSEARCH_RESULTS);
+                            *state = STATE_LIBRARY_RESULTS;
+                        }
+                        break;
+                    case INPUT_SHUFFLE:
+                        // Select = cancel
+                        *state = STATE_HOME;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+
+            case STATE_LIBRARY_RESULTS:
+                switch (action) {
+                    case INPUT_UP:
+                        libsearch_move_results_cursor(-1);
+                        break;
+                    case INPUT_DOWN:
+                        libsearch_move_results_cursor(1);
+                        break;
+                    case INPUT_SELECT: {
+                        // Play in its folder, so next/previous follow the album
+                        const SearchHit *hit = libsearch_get_result(libsearch_get_results_cursor());
+                        if (hit) {
+                            favorites_set_playback_mode(false, 0);
+                            browse_to_file(hit->path);
+                            if (play_file(hit->path)) {
+                                *state = (g_pending_resume_pos > 0) ? STATE_RESUME_PROMPT : STATE_PLAYING;
+                            } else {
+                                *state = STATE_ERROR;  // Deleted since it was indexed
+                            }
+                        }
+                        break;
+                    }
+                    case INPUT_BACK:
+                        libsearch_set_state(LIBSEARCH_INPUT);
+                        *state = STATE_LIBRARY_SEARCH;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+
             case STATE_YOUTUBE_SEARCH:
                 switch (action) {
                     case INPUT_UP:
@@ -1191,8 +1516,10 @@ static void handle_input(AppState *state) {
                         break;
                     case INPUT_MENU:
                         // Start = execute search
-                        if (ytsearch_execute_search()) {
-                            // State will change to SEARCHING in update()
+                        if (ytsearch_execute_search() &&
+                            ytsearch_get_state() == YTSEARCH_RESULTS) {
+                            // Answered from the search cache
+                            *state = STATE_YOUTUBE_RESULTS;
                         }
                         break;
                     case INPUT_SHUFFLE:
@@ -1270,6 +1597,7 @@ static void handle_input(AppState *state) {
                                 if (last_slash) {
                                     *last_slash = '\0';
                                     browser_navigate_to(dir);
+                                    browser_wait_for_scan();
                                     // Find and select the file
                                     const char *filename = last_slash + 1;
                                     int count = browser_get_count();
@@ -1372,8 +1700,10 @@ static void handle_input(AppState *state) {
                         break;
                     case INPUT_MENU:
                         // Start = execute search
-                        if (spsearch_execute_search()) {
-                            // State will change to SEARCHING in update()
+                        if (spsearch_execute_search() &&
+                            spsearch_get_state() == SPSEARCH_RESULTS) {
+                            // Answered from the search cache
+                            *state = STATE_SPOTIFY_RESULTS;
                         }
                         break;
                     case INPUT_SHUFFLE:
@@ -1398,6 +1728,8 @@ static void handle_input(AppState *state) {
                         const SpotifyTrack *track = spsearch_get_result(spsearch_get_results_cursor());
                         if (track) {
                             spotify_play_track(track->uri);
+                            audio_stop();  // Spotify takes over the music hook
+                            sp_audio_play();
                             *state = STATE_SPOTIFY_PLAYING;
                         }
                         break;
@@ -1415,6 +1747,7 @@ static void handle_input(AppState *state) {
                 switch (action) {
                     case INPUT_SELECT:
                         spotify_toggle_pause();
+                        sp_audio_set_paused(spotify_get_state() == SP_STATE_PAUSED);
                         break;
                     case INPUT_BACK:
                         spotify_stop_playback();
@@ -1466,14 +1799,10 @@ static void handle_input(AppState *state) {
 }
 
 /**
- * Update game state
+ * Check power switch (GPIO 243) - poll every 200ms
+ * Turns the screen off/on to follow it (pocket mode).
  */
-static Uint32 g_last_position_save = 0;
-static int g_last_saved_position = -1;  // Track last saved value to avoid redundant writes
-#define POSITION_SAVE_INTERVAL_MS 15000  // Save position every 15 seconds (was 10)
-
-static void update(AppState *state) {
-    // Check power switch (GPIO 243) - poll every 200ms
+static void poll_power_switch(void) {
     static Uint32 last_switch_check = 0;
     Uint32 now = SDL_GetTicks();
     if (now - last_switch_check > 200) {
@@ -1483,6 +1812,7 @@ static void update(AppState *state) {
             screen_off();
         } else if (!switch_on && screen_is_off()) {
             screen_on();
+            ui_invalidate();  // Repaint once on wake
         }
 
         // Pocket mode: green heartbeat blink every 10s
@@ -1490,6 +1820,30 @@ static void update(AppState *state) {
             screen_update_led_heartbeat(now);
         }
     }
+}
+
+/**
+ * Update game state
+ */
+static Uint32 g_last_position_save = 0;
+static int g_last_saved_position = -1;  // Track last saved value to avoid redundant writes
+#define POSITION_SAVE_INTERVAL_MS 15000  // Save position every 15 seconds (was 10)
+
+static void update(AppState *state) {
+    // Fill in the folder list from a background scan
+    browser_update();
+    if (browser_is_scanning()) ui_invalidate();  // Entries are arriving
+
+    // Completion callbacks of pool jobs, then the cover they may have left
+    jobs_poll();
+
+    // Shrink or restore cache budgets as memory pressure changes
+    memgov_update();
+
+    // Upload cover art decoded in the background
+    if (cover_poll()) ui_invalidate();
+
+    poll_power_switch();
 
     // Check sleep timer
     if (*state == STATE_PLAYING || *state == STATE_MENU || *state == STATE_EQUALIZER) {
@@ -1517,8 +1871,10 @@ static void update(AppState *state) {
         }
     }
 
-    // Check if current track finished (not just paused)
-    if (*state == STATE_PLAYING && !audio_is_playing() && !audio_is_paused()) {
+    // Check if current track finished (not just paused), or the audio
+    // thread already moved on to the queued track
+    bool handoff = audio_take_handoff(g_handoff_track, sizeof(g_handoff_track));
+    if (handoff || (*state == STATE_PLAYING && !audio_is_playing() && !audio_is_paused())) {
         // Track finished completely - clear its saved position
         if (g_current_track_path[0]) {
             positions_clear(g_current_track_path);
@@ -1541,10 +1897,13 @@ static void update(AppState *state) {
             if (fav_count > 0) {
                 const char *path = NULL;
                 if (menu_is_shuffle_enabled()) {
-                    // Shuffle among favorites
-                    int random_idx = rand() % fav_count;
-                    favorites_set_playback_index(random_idx);
-                    path = favorites_get_current_playback_path();
+                    // Shuffle among favorites, in the preloaded order
+                    shuffle_sync_playlist();
+                    int next_idx = shuffle_advance();
+                    if (next_idx >= 0) {
+                        favorites_set_playback_index(next_idx);
+                        path = favorites_get_current_playback_path();
+                    }
                 } else {
                     // Sequential through favorites
                     int new_idx = favorites_advance_playback(1);
@@ -1557,11 +1916,9 @@ static void update(AppState *state) {
                         path = favorites_get_current_playback_path();
                     }
                 }
-                if (path && audio_load(path)) {
-                    strncpy(g_current_track_path, path, sizeof(g_current_track_path) - 1);
+                if (play_next_track(path)) {
                     // Update favorites cursor to match playback position
                     g_favorites_cursor = favorites_get_playback_index();
-                    audio_play();
                 }
             } else {
                 // No favorites, disable playback mode
@@ -1570,134 +1927,114 @@ static void update(AppState *state) {
                 *state = STATE_BROWSER;
             }
         } else if (menu_is_shuffle_enabled()) {
-            // Shuffle: play random track from browser
-            int count = browser_get_count();
-            if (count > 0) {
-                int random_offset = rand() % count;
-                browser_move_cursor(random_offset - browser_get_cursor());
-                const char *path = browser_get_selected_path();
-                if (path && audio_load(path)) {
-                    strncpy(g_current_track_path, path, sizeof(g_current_track_path) - 1);
-                    audio_play();
-                }
+            // Shuffle: next file of the folder's order (already preloaded)
+            shuffle_sync_playlist();
+            int next_idx = shuffle_advance();
+            if (next_idx >= 0) {
+                browser_set_cursor(next_idx);
+                play_next_track(browser_get_selected_path());
             }
         } else {
             // Normal: advance to next track in browser (with gapless support)
             if (browser_move_cursor(1)) {
-                const char *path = browser_get_selected_path();
-                if (path) {
-                    // Try gapless transition first
-                    bool loaded = false;
-                    PreloadedTrack *preloaded = preload_consume(path);
-                    if (preloaded && preloaded->is_flac && preloaded->wav_data) {
-                        loaded = audio_load_preloaded(path, preloaded->wav_data,
-                                                       preloaded->wav_size, preloaded->duration_sec);
-                        if (loaded) {
-                            preloaded->wav_data = NULL;  // Ownership transferred
-                            printf("[GAPLESS] Seamless transition to: %s\n", path);
-                        }
-                        preload_free_track(preloaded);
-                    }
-                    if (!loaded) {
-                        loaded = audio_load(path);
-                    }
-                    if (loaded) {
-                        strncpy(g_current_track_path, path, sizeof(g_current_track_path) - 1);
-                        audio_play();
-                        // Preload next track
-                        const char *next = browser_get_next_track_path();
-                        if (next) preload_start(next);
-                    }
-                }
+                play_next_track(browser_get_selected_path());
             } else if (repeat == REPEAT_ALL) {
                 // At end of list, go back to start
                 browser_move_cursor(-browser_get_cursor());
-                const char *path = browser_get_selected_path();
-                if (path && audio_load(path)) {
-                    strncpy(g_current_track_path, path, sizeof(g_current_track_path) - 1);
-                    audio_play();
-                    // Preload next track
-                    const char *next = browser_get_next_track_path();
-                    if (next) preload_start(next);
-                }
+                play_next_track(browser_get_selected_path());
             } else {
                 // No more tracks, return to browser
                 g_current_track_path[0] = '\0';
                 *state = STATE_BROWSER;
             }
         }
+
+        // Queued track no longer wanted (playlist or repeat changed)
+        if (handoff && !g_current_track_path[0]) {
+            audio_stop();
+        }
+        g_handoff_track[0] = '\0';
+        g_queued_track[0] = '\0';
     }
 
-    // Handle metadata scanning (incremental - one file per frame)
-    if (*state == STATE_SCANNING) {
-        // Get next file to scan
-        DIR *dir = opendir(g_scan_folder);
-        if (dir) {
-            struct dirent *entry;
-            int count = 0;
-            bool found_file = false;
-
-            while ((entry = readdir(dir)) != NULL) {
-                if (entry->d_name[0] == '.') continue;
-
-                // Check if audio file
-                const char *ext = strrchr(entry->d_name, '.');
-                if (!ext) continue;
-                if (strcasecmp(ext, ".mp3") != 0 && strcasecmp(ext, ".flac") != 0 &&
-                    strcasecmp(ext, ".ogg") != 0 && strcasecmp(ext, ".wav") != 0) continue;
-
-                count++;
-                if (count <= g_scan_current) continue;  // Skip already processed
-
-                // Found next file to process
-                found_file = true;
-                g_scan_current = count;
-                strncpy(g_scan_current_file, entry->d_name, sizeof(g_scan_current_file) - 1);
-
-                // Build full path
-                char filepath[512];
-                snprintf(filepath, sizeof(filepath), "%s/%s", g_scan_folder, entry->d_name);
-
-                // Lookup metadata
-                MetadataResult result;
-                if (metadata_lookup(filepath, &result)) {
-                    g_scan_found++;
+    // Queue a preloaded FLAC behind the playing one, so the audio thread
+    // switches (or crossfades) at the exact sample instead of this loop
+    audio_set_crossfade(menu_get_crossfade_sec());
+    loudness_set_enabled(menu_is_normalize_enabled());
+    // Spotify's pipe owns the music hook while it plays: keep the device as is
+    audio_set_period(*state == STATE_SPOTIFY_PLAYING ? audio_get_period(NULL) : audio_period_for_mode());
+    switch (menu_get_power_mode()) {
+        case POWER_MODE_BATTERY:     audio_set_resample_quality(RESAMPLE_FAST);   break;
+        case POWER_MODE_PERFORMANCE: audio_set_resample_quality(RESAMPLE_BEST);   break;
+        default:                     audio_set_resample_quality(RESAMPLE_MEDIUM); break;
+    }
+    // Spectrum bars tap the audio only while they are on screen
+    spectrum_set_active(menu_is_spectrum_enabled() && *state == STATE_PLAYING);
+    spectrum_set_max_rate(menu_get_power_mode() == POWER_MODE_BATTERY ? 10 : 0);
+    check_queued_track();
+    if (audio_is_flac() && !audio_has_queued() && preload_is_ready() &&
+        menu_get_repeat_mode() != REPEAT_ONE) {
+        const char *next = preload_get_path();
+        if (next && strcmp(audio_format_from_path(next), "FLAC") == 0) {
+            char path[512];
+            strncpy(path, next, sizeof(path) - 1);
+            path[sizeof(path) - 1] = '\0';
+            PreloadedTrack *preloaded = preload_consume(path);
+            if (preloaded && preloaded->is_flac) {
+                if (audio_queue_preloaded(path, preloaded->wav_data, preloaded->wav_size,
+                                          preloaded->flac_handle, preloaded->duration_sec)) {
+                    strncpy(g_queued_track, path, sizeof(g_queued_track) - 1);
+                    playlist_pos_get(&g_queued_pos);
                 }
-                break;
+                // Ownership transferred, only free struct
+                preloaded->wav_data = NULL;
+                preloaded->flac_handle = NULL;
             }
-            closedir(dir);
+            if (preloaded) preload_free_track(preloaded);
+        }
+    }
 
-            // Check if scan complete
-            if (!found_file || g_scan_current >= g_scan_total) {
-                *state = STATE_SCAN_COMPLETE;
-            }
-        } else {
+    // Mirror the background metadata scan's progress for the UI
+    if (*state == STATE_SCANNING) {
+        MetadataScanProgress progress;
+        metadata_scan_get_progress(&progress);
+        g_scan_current = progress.current;
+        g_scan_total = progress.total;
+        g_scan_found = progress.found;
+        strncpy(g_scan_current_file, progress.current_file, sizeof(g_scan_current_file) - 1);
+
+        if (!progress.running) {
             *state = STATE_SCAN_COMPLETE;
         }
     }
 
-    // Handle YouTube search (blocking operation with loading indicator)
-    if (*state == STATE_YOUTUBE_SEARCH && ytsearch_get_state() == YTSEARCH_SEARCHING) {
-        // Render "Searching..." screen BEFORE blocking search call
-        // This ensures user sees the loading indicator
-        ui_render_youtube_search();
-
-        if (ytsearch_update_search()) {
-            // Search complete
-            if (ytsearch_get_state() == YTSEARCH_RESULTS) {
-                *state = STATE_YOUTUBE_RESULTS;
-            }
-            // On error, stays in YOUTUBE_SEARCH (error shown)
+    // Handle YouTube search (runs on a worker, results stream in)
+    if ((*state == STATE_YOUTUBE_SEARCH || *state == STATE_YOUTUBE_RESULTS) &&
+        ytsearch_update_search()) {
+        if (ytsearch_get_state() == YTSEARCH_RESULTS) {
+            // First result arrived
+            *state = STATE_YOUTUBE_RESULTS;
+        } else if (ytsearch_get_state() == YTSEARCH_INPUT) {
+            // Nothing found or failed (error shown)
+            *state = STATE_YOUTUBE_SEARCH;
         }
     }
 
+    // Let the download queue throttle around playback and BATTERY mode
+    dlqueue_set_conditions(audio_is_playing() && !audio_is_paused(),
+                           menu_get_power_mode() == POWER_MODE_BATTERY);
+    dlqueue_set_keep_native(menu_get_download_format() == DOWNLOAD_FORMAT_NATIVE);
+
     // Check for completed background downloads
     if (dlqueue_has_new_completions()) {
-        // A download finished in the background
-        // Just log it - user stays in current state
+        // A download finished in the background: user stays in current
+        // state, the file just shows up in its folder's listing
         const char *completed = dlqueue_get_last_completed();
         if (completed) {
-            printf("[MAIN] Background download complete: %s\n", completed);
+            char path[512];
+            snprintf(path, sizeof(path), "%s", completed);
+            printf("[MAIN] Background download complete: %s\n", path);
+            browser_entry_added(path, false);
         }
     }
 
@@ -1726,44 +2063,34 @@ static void update(AppState *state) {
         }
     }
 
-    // Handle Spotify search (blocking operation with loading indicator)
-    if (*state == STATE_SPOTIFY_SEARCH && spsearch_get_state() == SPSEARCH_SEARCHING) {
-        // Render "Searching..." before blocking call
-        ui_render_spotify_search();
-
-        if (spsearch_update_search()) {
-            if (spsearch_get_state() == SPSEARCH_RESULTS) {
-                *state = STATE_SPOTIFY_RESULTS;
-            }
-            // On error, stays in SPOTIFY_SEARCH
+    // Handle Spotify search (runs on a worker)
+    if ((*state == STATE_SPOTIFY_SEARCH || *state == STATE_SPOTIFY_RESULTS) &&
+        spsearch_update_search()) {
+        if (spsearch_get_state() == SPSEARCH_RESULTS) {
+            *state = STATE_SPOTIFY_RESULTS;
         }
+        // On error, stays in SPOTIFY_SEARCH
     }
 
     // Handle Spotify audio pipe (check for EOF / connection loss)
     if (*state == STATE_SPOTIFY_PLAYING) {
-        if (sp_audio_is_eof()) {
+        if (sp_audio_is_drained()) {
             printf("[MAIN] Spotify pipe EOF - track ended or connection lost\n");
+            sp_audio_stop();
             sp_audio_reset();
             *state = STATE_SPOTIFY_RESULTS;
         }
     }
 
-    // Handle self-update (blocking operations with UI updates)
+    // Self-update runs on its own thread; just poll for the result
+    // (the update screen redraws every frame)
     if (*state == STATE_UPDATE) {
         UpdateState upd_state = update_get_state();
 
         if (upd_state == UPDATE_CHECKING) {
-            // Render UI before blocking check
-            ui_render_update();
-            if (update_check_complete()) {
-                // Check finished - state changed automatically
-            }
+            update_check_complete();
         } else if (upd_state == UPDATE_DOWNLOADING) {
-            // Render UI before blocking download
-            ui_render_update();
-            if (update_download_complete()) {
-                // Download finished - state changed to READY or ERROR
-            }
+            update_download_complete();
         }
     }
 
@@ -1824,6 +2151,12 @@ static void render(AppState *state) {
         case STATE_SCAN_COMPLETE:
             ui_render_scan_complete(g_scan_found, g_scan_total);
             break;
+        case STATE_LIBRARY_SEARCH:
+            ui_render_library_search();
+            break;
+        case STATE_LIBRARY_RESULTS:
+            ui_render_library_results();
+            break;
         case STATE_YOUTUBE_SEARCH:
             ui_render_youtube_search();
             break;
@@ -1860,19 +2193,179 @@ static void render(AppState *state) {
     }
 }
 
+// Music library root (argv[1] overrides)
+static const char *g_music_path = "/mnt/SDCARD/Music";
+
+// Startup task that the browser waits for
+static int g_task_library = -1;
+static int g_task_favorites = -1;  // Player screen, drawn from the snapshot early
+static int g_task_sysinfo = -1;
+
+/**
+ * Startup task: library index (and MP3 seek index) for the music root
+ */
+static void init_library_task(void) {
+    // Load library index and refresh it in the background (needs data dir);
+    // the search index follows it from the saved listings on
+    searchindex_init(g_music_path);
+    library_init(g_music_path);
+    mp3index_init();
+}
+
+/**
+ * Startup task: Spotify integration (PCM pipe reader only if librespot exists)
+ */
+static void init_spotify_task(void) {
+    spotify_init();
+    if (spotify_is_available()) {
+        sp_audio_init(spotify_get_fifo_path());
+    }
+}
+
+/**
+ * Startup task: favorites
+ */
+static void init_favorites_task(void) {
+    if (favorites_init() < 0) {
+        fprintf(stderr, "Favorites initialization failed (non-fatal)\n");
+    }
+}
+
+/**
+ * Startup task: position tracking
+ */
+static void init_positions_task(void) {
+    if (positions_init() < 0) {
+        fprintf(stderr, "Positions initialization failed (non-fatal)\n");
+    }
+}
+
+/**
+ * Startup task: screen brightness control
+ */
+static void init_screen_task(void) {
+    if (screen_init() < 0) {
+        fprintf(stderr, "Screen control initialization failed (non-fatal)\n");
+    }
+}
+
+/**
+ * Startup task: system info (battery, volume)
+ */
+static void init_sysinfo_task(void) {
+    if (sysinfo_init() < 0) {
+        fprintf(stderr, "System info initialization failed (non-fatal)\n");
+    }
+}
+
+/**
+ * Queue the init steps that don't need SDL and start the pool
+ * All run after state_init() (data dir). Registration order is priority:
+ * the library comes first because the browser waits on it, then what the
+ * snapshot frame of the player screen reads.
+ */
+static void start_background_init(void) {
+    g_task_library = startup_add("library_init", init_library_task);
+    g_task_favorites = startup_add("favorites_init", init_favorites_task);
+    g_task_sysinfo = startup_add("sysinfo_init", init_sysinfo_task);
+    startup_add("positions_init", init_positions_task);
+    startup_add("metadata_init", metadata_init);          // MusicBrainz cache
+    int youtube = startup_add("youtube_init", youtube_init);  // yt-dlp probe
+    startup_add("spotify_init", init_spotify_task);       // librespot probe
+    startup_add("update_init", update_init);
+    startup_add("screen_init", init_screen_task);
+
+    // Restored downloads start right away and need the yt-dlp path
+    int dlqueue = startup_add("dlqueue_init", dlqueue_init);
+    startup_depends(dlqueue, youtube);
+
+    startup_run();
+}
+
+// Pocket mode (screen off): button/switch polling and playback upkeep rates
+#define POCKET_POLL_MS 250
+#define POCKET_UPDATE_MS 1000
+#define POCKET_TRACK_END_SEC 2       // Closer than this to the end, run every pass
+#define POCKET_TRACK_END_POLL_MS 20
+
+/**
+ * One pass of the pocket-mode loop (screen off)
+ * Nothing is drawn. Buttons and the power switch are polled a few times a
+ * second; update() (position saves, track advance, sleep timer) runs at
+ * about 1 Hz, and every pass near the end of a track so the next one still
+ * starts gapless. Sleeps on SDL events in between, which the power and
+ * volume keys end at once through the input thread's wake event.
+ */
+static void pocket_tick(AppState *state) {
+    static Uint32 last_update = 0;
+
+    handle_input(state);  // Drains events, polls power/volume buttons
+    if (!g_running) return;
+
+    const TrackInfo *info = audio_get_track_info();
+    bool track_ending = *state == STATE_PLAYING && !audio_is_paused() &&
+                        (!audio_is_playing() ||  // Finished, next not started yet
+                         (info && info->duration_sec > 0 &&
+                          info->duration_sec - info->position_sec <= POCKET_TRACK_END_SEC));
+
+    Uint32 now = SDL_GetTicks();
+    if (track_ending || now - last_update >= POCKET_UPDATE_MS) {
+        last_update = now;
+        update(state);
+    } else {
+        poll_power_switch();
+    }
+
+    // Switch unlocked: back to the normal loop, which repaints right away
+    if (!screen_is_off()) return;
+
+    SDL_WaitEventTimeout(NULL, track_ending ? POCKET_TRACK_END_POLL_MS : POCKET_POLL_MS);
+}
+
+// Longest idle sleep on an unchanged screen (update() still polls; input
+// ends the wait, evdev buttons through the input thread's wake event)
+#define IDLE_WAIT_MAX_MS 100
+
 /**
  * Main entry point
  */
 int main(int argc, char *argv[]) {
-    (void)argc;
-    (void)argv;
-
+    trace_init();
+    perfhud_init();
     printf("Mono - Starting...\n");
 
+    // cJSON allocator hooks, before any thread parses
+    json_arena_init();
+
+    // Default music path - can be overridden via command line
+    if (argc > 1) {
+        g_music_path = argv[1];
+    }
+
+    // Initialize state persistence (data dir, needed by most modules)
+    trace_begin("state_init");
+    if (state_init() < 0) {
+        fprintf(stderr, "State initialization failed (non-fatal)\n");
+    }
+    // Register callback to save state when settings change (power mode, etc.)
+    state_set_settings_callback(save_app_state);
+    trace_end();
+
+    // Cache budgets from the device's free memory (before caches register)
+    memgov_init();
+
+    // Shared job pool (preload, covers, warmup)
+    jobs_init();
+
+    // Independent init runs on the pool while SDL comes up here
+    start_background_init();
+
     // Initialize SDL
+    trace_begin("sdl_init");
     if (init_sdl() < 0) {
         return 1;
     }
+    trace_end();
 
     // Initialize UI
 #ifdef __APPLE__
@@ -1892,52 +2385,29 @@ int main(int argc, char *argv[]) {
     }
 #endif
 
+    trace_begin("ui_init");
     if (ui_init(g_screen_width, g_screen_height) < 0) {
         fprintf(stderr, "UI initialization failed\n");
         cleanup();
         return 1;
     }
+    trace_end();
 
     // Initialize audio engine
+    trace_begin("audio_init");
     if (audio_init() < 0) {
         fprintf(stderr, "Audio initialization failed\n");
         cleanup();
         return 1;
     }
 
-    // Initialize equalizer (after Mix_OpenAudio)
+    // Initialize equalizer (after Mix_OpenAudio), which feeds the spectrum tap
+    spectrum_init();
     eq_init();
 
     // Initialize preloader for gapless playback
     preload_init();
-
-    // Initialize metadata cache (MusicBrainz lookups)
-    metadata_init();
-
-    // Initialize YouTube integration
-    youtube_init();
-
-    // Initialize Spotify integration
-    spotify_init();
-
-    // Initialize self-update system
-    update_init();
-
-    // Initialize background download queue
-    dlqueue_init();
-
-    // Initialize file browser
-    // Default music path - can be overridden via command line
-    const char *music_path = "/mnt/SDCARD/Music";
-    if (argc > 1) {
-        music_path = argv[1];
-    }
-
-    if (browser_init(music_path) < 0) {
-        fprintf(stderr, "Browser initialization failed\n");
-        cleanup();
-        return 1;
-    }
+    trace_end();
 
     // Initialize menu system
     menu_init();
@@ -1945,88 +2415,95 @@ int main(int argc, char *argv[]) {
     // Initialize theme system
     theme_init();
 
-    // Initialize state persistence
-    if (state_init() < 0) {
-        fprintf(stderr, "State initialization failed (non-fatal)\n");
-    }
-    // Register callback to save state when settings change (power mode, etc.)
-    state_set_settings_callback(save_app_state);
-
-    // Initialize favorites
-    if (favorites_init() < 0) {
-        fprintf(stderr, "Favorites initialization failed (non-fatal)\n");
-    }
-
-    // Initialize position tracking
-    if (positions_init() < 0) {
-        fprintf(stderr, "Positions initialization failed (non-fatal)\n");
+    // Saved state (its theme already applies to the snapshot frame)
+    AppStateData saved_state;
+    bool have_saved_state = state_load(&saved_state);
+    if (have_saved_state) {
+        theme_set(saved_state.theme);
     }
 
-    // Warm SD card cache for files with saved positions (prevents slow first-seek)
-    // Reads entire files to cache them for fast Mix_SetMusicPosition seeking
-    {
-        int pos_count = positions_get_count();
-        int files_to_cache = (pos_count < 10) ? pos_count : 10;
-        if (files_to_cache > 0) {
-            printf("[MAIN] Warming SD cache for %d files...\n", files_to_cache);
-            char path[512];
-            unsigned char cache_buf[32768];  // 32KB read buffer
-            for (int i = 0; i < files_to_cache; i++) {
-                // Show loading progress
-                char loading_msg[64];
-                snprintf(loading_msg, sizeof(loading_msg), "Loading cache %d/%d...", i + 1, files_to_cache);
-                ui_render_loading(loading_msg);
-
-                if (positions_get_entry(i, path, sizeof(path)) >= 0) {
-                    FILE *f = fopen(path, "rb");
-                    if (f) {
-                        // Read entire file to warm cache
-                        while (fread(cache_buf, 1, sizeof(cache_buf), f) == sizeof(cache_buf)) {
-                            // Just reading to warm cache
-                        }
-                        fclose(f);
-                    }
-                }
+    // Closed on the player: draw that screen from the resume snapshot now,
+    // before the library, tags and cover load (they replace it as they do)
+    bool browser_restored = false;
+    ResumeSnapshot snap;
+    if (have_saved_state && saved_state.has_resume_data && saved_state.was_playing &&
+        snapshot_load(saved_state.last_file, &snap)) {
+        trace_begin("snapshot_frame");
+        if (snap.on_player &&
+            browser_restore(g_music_path, snap.folder, snap.names, snap.is_dir,
+                            snap.count, snap.cursor) == 0) {
+            browser_restored = true;
+            audio_show_track_info(&snap.track);
+            if (snap.cover) {
+                cover_show_thumbnail(snap.cover_dir, snap.cover, snap.cover_w, snap.cover_h,
+                                     snap.cover_dark);
             }
-            printf("[MAIN] SD cache warmed\n");
+            startup_wait(g_task_favorites);
+            startup_wait(g_task_sysinfo);
+
+            AppState boot_state = g_state;
+            g_state = STATE_PLAYING;
+            render(&g_state);
+            g_state = boot_state;  // Until playback actually resumes
+            ui_invalidate();
         }
+        snapshot_free(&snap);
+        trace_end();
     }
 
-    // Initialize screen brightness control
-    if (screen_init() < 0) {
-        fprintf(stderr, "Screen control initialization failed (non-fatal)\n");
+    // Initialize file browser (lists through the library index)
+    startup_wait(g_task_library);
+    trace_begin("browser_init");
+    if (!browser_restored && browser_init(g_music_path) < 0) {
+        fprintf(stderr, "Browser initialization failed\n");
+        cleanup();
+        return 1;
     }
+    trace_end();
 
-    // Initialize system info (battery, volume)
-    if (sysinfo_init() < 0) {
-        fprintf(stderr, "System info initialization failed (non-fatal)\n");
-    }
+    // Everything below uses the modules set up in the background
+    trace_begin("startup_wait");
+    startup_wait_all();
+    trace_end();
 
-    // Try to restore previous state
-    AppStateData saved_state;
-    if (state_load(&saved_state)) {
+    // Restore the rest of the previous state
+    trace_begin("state_restore");
+
+    // Warm the SD card cache for files with saved positions in the
+    // background (prevents slow first-seek), last played track first
+    warmup_start(have_saved_state ? saved_state.last_file : NULL);
+
+    if (have_saved_state) {
         // Restore user preferences
         audio_set_volume(saved_state.volume);
         menu_set_shuffle(saved_state.shuffle);
         menu_set_repeat(saved_state.repeat);
-        theme_set(saved_state.theme);
         menu_set_power_mode(saved_state.power_mode);
+        menu_set_download_format(saved_state.download_format);
+        menu_set_crossfade_sec(saved_state.crossfade_sec);
+        menu_set_normalize(saved_state.normalize);
+        menu_set_spectrum(saved_state.spectrum);
         for (int i = 0; i < EQ_BAND_COUNT; i++) {
             eq_set_band_db(i, saved_state.eq_bands[i]);
         }
 
         // Try to resume playback if there was an active track
         if (saved_state.has_resume_data && saved_state.last_file[0]) {
-            // Navigate to the folder containing the last track
-            if (saved_state.last_folder[0]) {
+            // Navigate to the folder containing the last track (already
+            // shown from the snapshot: just check it against the library)
+            if (browser_restored &&
+                strcmp(browser_get_current_path(), saved_state.last_folder) == 0) {
+                browser_revalidate();
+            } else if (saved_state.last_folder[0]) {
                 browser_navigate_to(saved_state.last_folder);
             }
+            browser_wait_for_scan();
 
             // Find and select the track
             int count = browser_get_count();
             for (int i = 0; i < count; i++) {
-                const FileEntry *entry = browser_get_entry(i);
-                if (entry && strcmp(entry->full_path, saved_state.last_file) == 0) {
+                const char *entry_path = browser_get_entry_path(i);
+                if (entry_path && strcmp(entry_path, saved_state.last_file) == 0) {
                     browser_set_cursor(i);
                     break;
                 }
@@ -2042,6 +2519,8 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    trace_end();
+
     // Seed random number generator for shuffle
     srand((unsigned int)time(NULL));
 
@@ -2054,8 +2533,16 @@ int main(int argc, char *argv[]) {
     // - Performance: 60fps active, 20fps dimmed
     Uint32 frame_start;
     AppState prev_state = g_state;
+    bool boot_reported = false;
 
     while (g_running) {
+        // Pocket mode: screen is off, skip rendering entirely
+        if (screen_is_off()) {
+            spectrum_set_active(false);
+            pocket_tick(&g_state);
+            continue;
+        }
+
         frame_start = SDL_GetTicks();
 
         // Determine target frame time based on power mode and activity
@@ -2091,19 +2578,52 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        uint64_t pass_start = perfhud_now_us();
         handle_input(&g_state);
         update(&g_state);
-        render(&g_state);
+        uint64_t render_start = perfhud_now_us();
 
-        // Track state changes for debugging
+        // Screen changes always redraw
         if (g_state != prev_state) {
             prev_state = g_state;
+            ui_invalidate();
+        }
+
+        // Browser and player only redraw when something on them changed
+        bool tracked = (g_state == STATE_BROWSER || g_state == STATE_PLAYING);
+        uint32_t render_us = 0;  // 0: nothing drawn
+        if (!tracked || ui_needs_redraw()) {
+            if (!boot_reported) trace_begin("first_render");
+            render(&g_state);
+            render_us = (uint32_t)(perfhud_now_us() - render_start);
+            if (render_us == 0) render_us = 1;
+        }
+        perfhud_record((uint32_t)(render_start - pass_start), render_us, (int)target_frame_ms);
+
+        // Time to first frame, once a pass has actually drawn one
+        if (!boot_reported && render_us > 0) {
+            trace_end();
+            trace_mark("first_frame");
+            trace_report("Boot");
+            memgov_report();
+            int wakeups = 0;
+            int period = audio_get_period(&wakeups);
+            printf("[AUDIO] Period %d frames, %d wakeups/s\n", period, wakeups);
+            boot_reported = true;
         }
 
-        // Energy-efficient sleep - use longer delay when less activity needed
+        // Energy-efficient sleep - use longer delay when less activity needed.
+        // Input ends it early; tracked screens still only redraw when due.
         Uint32 frame_duration = SDL_GetTicks() - frame_start;
-        if (frame_duration < target_frame_ms) {
-            SDL_Delay(target_frame_ms - frame_duration);
+        Uint32 wait_ms = frame_duration < target_frame_ms ? target_frame_ms - frame_duration : 0;
+        if (tracked && !audio_is_playing() && !ui_needs_redraw()) {
+            // Idle: sleep until the next scheduled change, waking on input
+            Uint32 idle_ms = ui_ms_until_redraw();
+            if (idle_ms > IDLE_WAIT_MAX_MS) idle_ms = IDLE_WAIT_MAX_MS;
+            if (idle_ms > wait_ms) wait_ms = idle_ms;
+            SDL_WaitEventTimeout(NULL, (int)wait_ms);
+        } else if (wait_ms > 0) {
+            SDL_WaitEventTimeout(NULL, (int)wait_ms);
         }
     }
 
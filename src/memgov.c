@@ -0,0 +1,245 @@
+/**
+ * Memory Governor Implementation
+ *
+ * Pressure comes from MemAvailable and, where the kernel has PSI, from
+ * the share of time tasks stalled on memory; the worse of the two wins.
+ * Budget callbacks are only ever run from memgov_update() on the main
+ * thread, for every client whose last applied level differs from the
+ * current one, so clients registering from startup tasks are caught up
+ * on the next frame.
+ */
+
+#include "memgov.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * Registered cache
+ */
+typedef struct {
+    const char *name;
+    size_t base_budget;
+    MemUsageFunc usage;
+    MemBudgetFunc apply;
+    MemPressure applied;        // Level the client last got a budget for
+} Client;
+
+static Client g_clients[MEMGOV_MAX_CLIENTS];
+static int g_client_count = 0;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static MemPressure g_level = MEM_PRESSURE_NONE;
+static long g_total_kb = 0;
+static long g_available_kb = 0;
+static double g_psi_avg10 = -1.0;   // -1 = no PSI
+static uint64_t g_last_poll_ms = 0;
+
+/**
+ * Monotonic time in milliseconds
+ */
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/**
+ * Read MemTotal and MemAvailable
+ * @return false if /proc/meminfo is unreadable
+ */
+static bool read_meminfo(long *total_kb, long *available_kb) {
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (!f) return false;
+
+    char line[128];
+    long free_kb = -1, cached_kb = 0;
+    *total_kb = 0;
+    *available_kb = -1;
+    while (fgets(line, sizeof(line), f)) {
+        long value;
+        if (sscanf(line, "MemTotal: %ld", &value) == 1) *total_kb = value;
+        else if (sscanf(line, "MemAvailable: %ld", &value) == 1) *available_kb = value;
+        else if (sscanf(line, "MemFree: %ld", &value) == 1) free_kb = value;
+        else if (sscanf(line, "Cached: %ld", &value) == 1) cached_kb = value;
+    }
+    fclose(f);
+
+    // Kernels before 3.14 have no MemAvailable
+    if (*available_kb < 0) *available_kb = free_kb >= 0 ? free_kb + cached_kb : 0;
+    return *total_kb > 0;
+}
+
+/**
+ * Read the "some avg10" figure of memory PSI
+ * @return Percent, or -1 if the kernel has no PSI
+ */
+static double read_psi(void) {
+    FILE *f = fopen("/proc/pressure/memory", "r");
+    if (!f) return -1.0;
+
+    double avg10 = -1.0;
+    char line[160];
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "some avg10=%lf", &avg10) == 1) break;
+    }
+    fclose(f);
+    return avg10;
+}
+
+/**
+ * Poll the kernel and work out the level (main thread)
+ */
+static MemPressure measure(void) {
+    long total_kb, available_kb;
+    if (!read_meminfo(&total_kb, &available_kb)) return MEM_PRESSURE_NONE;
+    g_total_kb = total_kb;
+    g_available_kb = available_kb;
+    g_psi_avg10 = read_psi();
+
+    MemPressure level = MEM_PRESSURE_NONE;
+    if (available_kb < MEMGOV_MODERATE_KB || g_psi_avg10 >= MEMGOV_MODERATE_PSI) {
+        level = MEM_PRESSURE_MODERATE;
+    }
+    if (available_kb < MEMGOV_CRITICAL_KB || g_psi_avg10 >= MEMGOV_CRITICAL_PSI) {
+        level = MEM_PRESSURE_CRITICAL;
+    }
+    return level;
+}
+
+/**
+ * Budget of a client at a level
+ */
+static size_t budget_for(const Client *c, MemPressure level) {
+    switch (level) {
+        case MEM_PRESSURE_NONE:     return c->base_budget;
+        case MEM_PRESSURE_MODERATE: return c->base_budget / 2;
+        default:                    return c->base_budget / 8;
+    }
+}
+
+static const char* level_name(MemPressure level) {
+    switch (level) {
+        case MEM_PRESSURE_NONE:     return "none";
+        case MEM_PRESSURE_MODERATE: return "moderate";
+        default:                    return "critical";
+    }
+}
+
+void memgov_init(void) {
+    g_level = measure();
+    g_last_poll_ms = now_ms();
+    printf("[MEMGOV] %ld MB total, %ld MB available, pressure %s\n",
+           g_total_kb / 1024, g_available_kb / 1024, level_name(g_level));
+}
+
+int memgov_register(const char *name, size_t base_budget, MemUsageFunc usage, MemBudgetFunc apply) {
+    pthread_mutex_lock(&g_mutex);
+    if (g_client_count >= MEMGOV_MAX_CLIENTS) {
+        pthread_mutex_unlock(&g_mutex);
+        fprintf(stderr, "[MEMGOV] Cannot register %s\n", name);
+        return -1;
+    }
+
+    Client *c = &g_clients[g_client_count];
+    c->name = name;
+    c->base_budget = base_budget;
+    c->usage = usage;
+    c->apply = apply;
+    c->applied = MEM_PRESSURE_NONE;  // Clients start at their base budget
+    int id = g_client_count++;
+    pthread_mutex_unlock(&g_mutex);
+    return id;
+}
+
+size_t memgov_budget(int id) {
+    pthread_mutex_lock(&g_mutex);
+    size_t budget = (id >= 0 && id < g_client_count) ? budget_for(&g_clients[id], g_level) : 0;
+    pthread_mutex_unlock(&g_mutex);
+    return budget;
+}
+
+bool memgov_update(void) {
+    uint64_t now = now_ms();
+    bool changed = false;
+    if (now - g_last_poll_ms >= MEMGOV_POLL_MS) {
+        g_last_poll_ms = now;
+        MemPressure level = measure();
+        if (level != g_level) {
+            printf("[MEMGOV] Pressure %s -> %s (%ld MB available)\n",
+                   level_name(g_level), level_name(level), g_available_kb / 1024);
+            pthread_mutex_lock(&g_mutex);
+            g_level = level;
+            pthread_mutex_unlock(&g_mutex);
+            changed = true;
+        }
+    }
+
+    // Catch up every client that hasn't seen this level (outside the lock:
+    // callbacks take their own module locks)
+    for (int i = 0; i < MEMGOV_MAX_CLIENTS; i++) {
+        pthread_mutex_lock(&g_mutex);
+        if (i >= g_client_count) {
+            pthread_mutex_unlock(&g_mutex);
+            break;
+        }
+        Client *c = &g_clients[i];
+        bool stale = c->applied != g_level;
+        MemBudgetFunc apply = c->apply;
+        size_t budget = budget_for(c, g_level);
+        c->applied = g_level;
+        MemPressure level = g_level;
+        pthread_mutex_unlock(&g_mutex);
+
+        if (stale && apply) apply(budget, level);
+    }
+
+    if (changed) memgov_report();
+    return changed;
+}
+
+MemPressure memgov_level(void) {
+    return g_level;
+}
+
+long memgov_available_kb(void) {
+    return g_available_kb;
+}
+
+int memgov_snapshot(MemClient *out) {
+    pthread_mutex_lock(&g_mutex);
+    int count = g_client_count;
+    Client clients[MEMGOV_MAX_CLIENTS];
+    memcpy(clients, g_clients, sizeof(Client) * count);
+    MemPressure level = g_level;
+    pthread_mutex_unlock(&g_mutex);
+
+    for (int i = 0; i < count; i++) {
+        out[i].name = clients[i].name;
+        out[i].usage = clients[i].usage ? clients[i].usage() : 0;
+        out[i].budget = budget_for(&clients[i], level);
+    }
+    return count;
+}
+
+void memgov_report(void) {
+    MemClient clients[MEMGOV_MAX_CLIENTS];
+    int count = memgov_snapshot(clients);
+
+    size_t total = 0;
+    printf("[MEMGOV] Pressure %s, %ld MB available", level_name(g_level), g_available_kb / 1024);
+    if (g_psi_avg10 >= 0) printf(", PSI %.1f%%", g_psi_avg10);
+    printf("\n");
+    for (int i = 0; i < count; i++) {
+        total += clients[i].usage;
+        if (clients[i].budget > 0) {
+            printf("[MEMGOV]   %-12s %7zu KB of %7zu KB\n", clients[i].name,
+                   clients[i].usage / 1024, clients[i].budget / 1024);
+        } else {
+            printf("[MEMGOV]   %-12s %7zu KB\n", clients[i].name, clients[i].usage / 1024);
+        }
+    }
+    printf("[MEMGOV]   %-12s %7zu KB\n", "total", total / 1024);
+}
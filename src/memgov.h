@@ -0,0 +1,115 @@
+/**
+ * Memory Governor - Device-aware budgets for the big caches
+ *
+ * The Brick's RAM is shared with the GPU, and the caches that size
+ * themselves (preloaded tracks, pooled WAV buffers, cover pixels, the
+ * metadata map) know nothing about what the rest of the system is
+ * using. The governor watches /proc/meminfo and memory PSI, turns them
+ * into a pressure level, and hands each registered cache a budget for
+ * that level. Caches shrink (or grow back) in their budget callback.
+ */
+
+#ifndef MEMGOV_H
+#define MEMGOV_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MEMGOV_MAX_CLIENTS 16
+
+// How often the main loop re-reads the kernel's numbers
+#define MEMGOV_POLL_MS 2000
+
+// MemAvailable thresholds for each level
+#define MEMGOV_MODERATE_KB (96 * 1024)
+#define MEMGOV_CRITICAL_KB (48 * 1024)
+
+// PSI "some avg10" thresholds (percent of time stalled on memory)
+#define MEMGOV_MODERATE_PSI 10.0
+#define MEMGOV_CRITICAL_PSI 40.0
+
+/**
+ * Pressure level
+ */
+typedef enum {
+    MEM_PRESSURE_NONE,
+    MEM_PRESSURE_MODERATE,      // Budgets halved
+    MEM_PRESSURE_CRITICAL       // Budgets down to an eighth
+} MemPressure;
+
+/**
+ * Bytes a cache currently holds (main thread)
+ */
+typedef size_t (*MemUsageFunc)(void);
+
+/**
+ * Apply a new budget (main thread, called when the level changes)
+ * @param budget Bytes the cache may hold from now on
+ * @param level Pressure level the budget comes from
+ */
+typedef void (*MemBudgetFunc)(size_t budget, MemPressure level);
+
+/**
+ * One cache, for debugging displays
+ */
+typedef struct {
+    const char *name;
+    size_t usage;           // Bytes held now
+    size_t budget;          // Current budget (0 = not budgeted, usage only)
+} MemClient;
+
+/**
+ * Read the initial numbers (call once, before any client registers)
+ */
+void memgov_init(void);
+
+/**
+ * Register a cache (any thread)
+ * If the level isn't NONE, the budget callback runs from the next
+ * memgov_update().
+ * @param name Static string for reports
+ * @param base_budget Budget with no pressure (0 = report usage only)
+ * @param usage Usage callback (can be NULL)
+ * @param apply Budget callback (can be NULL)
+ * @return Client id, or -1 if the table is full
+ */
+int memgov_register(const char *name, size_t base_budget, MemUsageFunc usage, MemBudgetFunc apply);
+
+/**
+ * Current budget of a client
+ * @param id Client id
+ * @return Budget in bytes (0 for unknown ids or unbudgeted clients)
+ */
+size_t memgov_budget(int id);
+
+/**
+ * Re-read pressure at most every MEMGOV_POLL_MS and apply budget changes
+ * Call from the main loop.
+ * @return true if the level changed
+ */
+bool memgov_update(void);
+
+/**
+ * Current pressure level
+ */
+MemPressure memgov_level(void);
+
+/**
+ * MemAvailable at the last poll
+ * @return Kilobytes, or 0 if /proc/meminfo is unreadable
+ */
+long memgov_available_kb(void);
+
+/**
+ * Snapshot the per-cache breakdown (main thread)
+ * @param out Array of MEMGOV_MAX_CLIENTS entries
+ * @return Number of entries filled
+ */
+int memgov_snapshot(MemClient *out);
+
+/**
+ * Log the per-cache breakdown
+ */
+void memgov_report(void);
+
+#endif // MEMGOV_H
@@ -2,8 +2,8 @@
  * Menu System Implementation
  *
  * Context-sensitive menu with mode-based item arrays:
- * - Player mode:  Shuffle, Repeat, Sleep, Equalizer
- * - Browser mode: Theme, Power
+ * - Player mode:  Shuffle, Repeat, Crossfade, Normalize, Spectrum, Sleep, Equalizer
+ * - Browser mode: Theme, Power, Downloads
  */
 
 #include "menu.h"
@@ -19,6 +19,7 @@ static int g_cursor = 0;
 static bool g_shuffle = false;
 static RepeatMode g_repeat = REPEAT_OFF;
 static PowerMode g_power_mode = POWER_MODE_BALANCED;
+static DownloadFormat g_download_format = DOWNLOAD_FORMAT_MP3;
 static int g_sleep_minutes = 0;  // 0, 15, 30, 60
 static Uint32 g_sleep_end_ticks = 0;
 
@@ -27,12 +28,21 @@ static const int SLEEP_OPTIONS[] = {0, 15, 30, 60};
 static const int SLEEP_OPTIONS_COUNT = 4;
 static int g_sleep_option_index = 0;
 
+// Crossfade options (in seconds, 0 = gapless)
+static const int CROSSFADE_OPTIONS[] = {0, 2, 4, 8};
+static const int CROSSFADE_OPTIONS_COUNT = 4;
+static int g_crossfade_sec = 0;
+
+static bool g_normalize = true;
+static bool g_spectrum = false;
+
 // Item arrays per mode
-static const MenuItem PLAYER_ITEMS[] = { MENU_SHUFFLE, MENU_REPEAT, MENU_SLEEP, MENU_EQUALIZER };
-static const int PLAYER_ITEM_COUNT = 4;
+static const MenuItem PLAYER_ITEMS[] = { MENU_SHUFFLE, MENU_REPEAT, MENU_CROSSFADE, MENU_NORMALIZE,
+                                         MENU_SPECTRUM, MENU_SLEEP, MENU_EQUALIZER };
+static const int PLAYER_ITEM_COUNT = 7;
 
-static const MenuItem BROWSER_ITEMS[] = { MENU_THEME, MENU_POWER, MENU_UPDATE };
-static const int BROWSER_ITEM_COUNT = 3;
+static const MenuItem BROWSER_ITEMS[] = { MENU_THEME, MENU_POWER, MENU_DOWNLOADS, MENU_UPDATE };
+static const int BROWSER_ITEM_COUNT = 4;
 
 // Label buffer for dynamic labels
 static char g_label_buf[64];
@@ -54,9 +64,13 @@ void menu_init(void) {
     g_shuffle = false;
     g_repeat = REPEAT_OFF;
     g_power_mode = POWER_MODE_BALANCED;
+    g_download_format = DOWNLOAD_FORMAT_MP3;
     g_sleep_minutes = 0;
     g_sleep_end_ticks = 0;
     g_sleep_option_index = 0;
+    g_crossfade_sec = 0;
+    g_normalize = true;
+    g_spectrum = false;
 }
 
 void menu_open(MenuMode mode) {
@@ -64,6 +78,10 @@ void menu_open(MenuMode mode) {
     g_cursor = 0;
 }
 
+MenuMode menu_get_mode(void) {
+    return g_mode;
+}
+
 void menu_move_cursor(int direction) {
     int count = get_active_count();
     g_cursor += direction;
@@ -85,6 +103,32 @@ MenuResult menu_select(void) {
             printf("[MENU] Repeat: %s\n", menu_get_repeat_string());
             return MENU_RESULT_NONE;
 
+        case MENU_CROSSFADE: {
+            int next = 0;
+            for (int i = 0; i < CROSSFADE_OPTIONS_COUNT; i++) {
+                if (CROSSFADE_OPTIONS[i] == g_crossfade_sec) {
+                    next = (i + 1) % CROSSFADE_OPTIONS_COUNT;
+                    break;
+                }
+            }
+            g_crossfade_sec = CROSSFADE_OPTIONS[next];
+            printf("[MENU] Crossfade: %s\n", menu_get_crossfade_string());
+            state_notify_settings_changed();
+            return MENU_RESULT_NONE;
+        }
+
+        case MENU_NORMALIZE:
+            g_normalize = !g_normalize;
+            printf("[MENU] Normalize: %s\n", g_normalize ? "ON" : "OFF");
+            state_notify_settings_changed();
+            return MENU_RESULT_NONE;
+
+        case MENU_SPECTRUM:
+            g_spectrum = !g_spectrum;
+            printf("[MENU] Spectrum: %s\n", g_spectrum ? "ON" : "OFF");
+            state_notify_settings_changed();
+            return MENU_RESULT_NONE;
+
         case MENU_SLEEP:
             g_sleep_option_index = (g_sleep_option_index + 1) % SLEEP_OPTIONS_COUNT;
             g_sleep_minutes = SLEEP_OPTIONS[g_sleep_option_index];
@@ -111,6 +155,12 @@ MenuResult menu_select(void) {
             state_notify_settings_changed();
             return MENU_RESULT_NONE;
 
+        case MENU_DOWNLOADS:
+            g_download_format = (g_download_format + 1) % 2;
+            printf("[MENU] Download format: %s\n", menu_get_download_format_string());
+            state_notify_settings_changed();
+            return MENU_RESULT_NONE;
+
         case MENU_UPDATE:
             printf("[MENU] Check for Updates selected\n");
             return MENU_RESULT_UPDATE;
@@ -144,6 +194,18 @@ const char* menu_get_item_label(int index) {
             snprintf(g_label_buf, sizeof(g_label_buf), "Repeat: %s",
                      menu_get_repeat_string());
             break;
+        case MENU_CROSSFADE:
+            snprintf(g_label_buf, sizeof(g_label_buf), "Crossfade: %s",
+                     menu_get_crossfade_string());
+            break;
+        case MENU_NORMALIZE:
+            snprintf(g_label_buf, sizeof(g_label_buf), "Normalize: %s",
+                     g_normalize ? "On" : "Off");
+            break;
+        case MENU_SPECTRUM:
+            snprintf(g_label_buf, sizeof(g_label_buf), "Spectrum: %s",
+                     g_spectrum ? "On" : "Off");
+            break;
         case MENU_SLEEP:
             snprintf(g_label_buf, sizeof(g_label_buf), "Sleep: %s",
                      menu_get_sleep_string());
@@ -159,6 +221,10 @@ const char* menu_get_item_label(int index) {
             snprintf(g_label_buf, sizeof(g_label_buf), "Power: %s",
                      menu_get_power_string());
             break;
+        case MENU_DOWNLOADS:
+            snprintf(g_label_buf, sizeof(g_label_buf), "Downloads: %s",
+                     menu_get_download_format_string());
+            break;
         case MENU_UPDATE:
             snprintf(g_label_buf, sizeof(g_label_buf), "Check for Updates");
             break;
@@ -254,3 +320,53 @@ const char* menu_get_power_string(void) {
         default: return "Balanced";
     }
 }
+
+DownloadFormat menu_get_download_format(void) {
+    return g_download_format;
+}
+
+void menu_set_download_format(DownloadFormat format) {
+    g_download_format = (format == DOWNLOAD_FORMAT_NATIVE) ? DOWNLOAD_FORMAT_NATIVE : DOWNLOAD_FORMAT_MP3;
+    printf("[MENU] Download format set to: %s\n", menu_get_download_format_string());
+}
+
+const char* menu_get_download_format_string(void) {
+    return g_download_format == DOWNLOAD_FORMAT_NATIVE ? "Opus (no re-encode)" : "MP3";
+}
+
+int menu_get_crossfade_sec(void) {
+    return g_crossfade_sec;
+}
+
+void menu_set_crossfade_sec(int seconds) {
+    g_crossfade_sec = 0;
+    for (int i = 0; i < CROSSFADE_OPTIONS_COUNT; i++) {
+        if (CROSSFADE_OPTIONS[i] == seconds) g_crossfade_sec = seconds;
+    }
+    printf("[MENU] Crossfade set to: %s\n", menu_get_crossfade_string());
+}
+
+const char* menu_get_crossfade_string(void) {
+    static char buf[16];
+    if (g_crossfade_sec == 0) return "Off";
+    snprintf(buf, sizeof(buf), "%d sec", g_crossfade_sec);
+    return buf;
+}
+
+bool menu_is_normalize_enabled(void) {
+    return g_normalize;
+}
+
+void menu_set_normalize(bool enabled) {
+    g_normalize = enabled;
+    printf("[MENU] Normalize set to: %s\n", enabled ? "ON" : "OFF");
+}
+
+bool menu_is_spectrum_enabled(void) {
+    return g_spectrum;
+}
+
+void menu_set_spectrum(bool enabled) {
+    g_spectrum = enabled;
+    printf("[MENU] Spectrum set to: %s\n", enabled ? "ON" : "OFF");
+}
@@ -1,8 +1,8 @@
 /**
  * Menu System - Context-sensitive options menu
  *
- * Player menu:  Shuffle, Repeat, Sleep, Equalizer
- * Browser menu: Theme, Power
+ * Player menu:  Shuffle, Repeat, Crossfade, Normalize, Sleep, Equalizer
+ * Browser menu: Theme, Power, Downloads
  */
 
 #ifndef MENU_H
@@ -28,12 +28,20 @@ typedef enum {
     POWER_MODE_PERFORMANCE  // 60fps, smoother UI - worst battery
 } PowerMode;
 
+/**
+ * Download formats for the YouTube queue
+ */
+typedef enum {
+    DOWNLOAD_FORMAT_MP3,     // Transcode to MP3 (default, plays everywhere)
+    DOWNLOAD_FORMAT_NATIVE   // Keep the Opus stream as is (no re-encode)
+} DownloadFormat;
+
 /**
  * Menu mode - determines which items are shown
  */
 typedef enum {
-    MENU_MODE_PLAYER,   // Opened from player: Shuffle, Repeat, Sleep, Equalizer
-    MENU_MODE_BROWSER   // Opened from browser/home: Theme, Power
+    MENU_MODE_PLAYER,   // Opened from player: Shuffle, Repeat, Crossfade, Normalize, Spectrum, Sleep, Equalizer
+    MENU_MODE_BROWSER   // Opened from browser/home: Theme, Power, Downloads
 } MenuMode;
 
 /**
@@ -52,10 +60,14 @@ typedef enum {
 typedef enum {
     MENU_SHUFFLE,
     MENU_REPEAT,
+    MENU_CROSSFADE,
+    MENU_NORMALIZE,
+    MENU_SPECTRUM,
     MENU_SLEEP,
     MENU_EQUALIZER,
     MENU_THEME,
     MENU_POWER,
+    MENU_DOWNLOADS,
     MENU_UPDATE,
     MENU_ITEM_COUNT
 } MenuItem;
@@ -71,6 +83,11 @@ void menu_init(void);
  */
 void menu_open(MenuMode mode);
 
+/**
+ * Get the mode the menu was last opened in
+ */
+MenuMode menu_get_mode(void);
+
 /**
  * Move cursor up/down within active items
  * @param direction -1 for up, 1 for down
@@ -161,4 +178,54 @@ void menu_set_power_mode(PowerMode mode);
  */
 const char* menu_get_power_string(void);
 
+/**
+ * Get current download format
+ */
+DownloadFormat menu_get_download_format(void);
+
+/**
+ * Set download format (for state restoration)
+ */
+void menu_set_download_format(DownloadFormat format);
+
+/**
+ * Get string representation of download format
+ */
+const char* menu_get_download_format_string(void);
+
+/**
+ * Get crossfade between tracks in seconds (0 = gapless, no overlap)
+ */
+int menu_get_crossfade_sec(void);
+
+/**
+ * Set crossfade (for state restoration; unknown values turn it off)
+ */
+void menu_set_crossfade_sec(int seconds);
+
+/**
+ * Get string representation of crossfade
+ */
+const char* menu_get_crossfade_string(void);
+
+/**
+ * Get loudness normalization state (on by default)
+ */
+bool menu_is_normalize_enabled(void);
+
+/**
+ * Set loudness normalization (for state restoration)
+ */
+void menu_set_normalize(bool enabled);
+
+/**
+ * Get spectrum bars state (off by default)
+ */
+bool menu_is_spectrum_enabled(void);
+
+/**
+ * Set spectrum bars (for state restoration)
+ */
+void menu_set_spectrum(bool enabled);
+
 #endif // MENU_H
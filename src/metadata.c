@@ -1,13 +1,30 @@
 /**
  * Metadata Scanner Implementation
  *
- * Uses MusicBrainz API via curl CLI for metadata lookup.
- * Caches results in ~/.mono/metadata_cache.json
+ * Uses MusicBrainz API via http.c for metadata lookup.
+ * Caches results in ~/.mono/metadata_cache.bin, a memory-mapped file:
+ *
+ *   [header][bucket table][records...]
+ *
+ * The bucket table is an open-addressing hash of path -> record offset,
+ * so a lookup touches one or two buckets and one record no matter how big
+ * the library is, and opening the cache is a single mmap. New results are
+ * appended as records and the bucket is repointed in place; the file is
+ * only rewritten (compacted) when the table has to grow. The old
+ * metadata_cache.json is imported once.
+ *
+ * Records also carry the track's loudness gain (loudness.c). A file that
+ * was measured before it was ever looked up gets a gain-only record, which
+ * the lookup and the folder scan treat as not cached.
  */
 
 #include "metadata.h"
+#include "tags.h"
 #include "version.h"
+#include "http.h"
 #include "cJSON.h"
+#include "memgov.h"
+#include "jsonarena.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,57 +33,100 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
 
 // Cache file location
 #define CACHE_DIR_HOME ".mono"
-#define CACHE_FILENAME "metadata_cache.json"
-#define CACHE_BACKUP_FILENAME "metadata_cache.json.bak"
-#define TEMP_FILE "/tmp/mono_mb_response.json"
+#define CACHE_FILENAME "metadata_cache.bin"
+#define CACHE_BACKUP_FILENAME "metadata_cache.bin.bak"
+#define CACHE_LEGACY_FILENAME "metadata_cache.json"
+#define CACHE_IMPORTED_SUFFIX ".imported"
+#define CACHE_MAGIC 0x4154444D             // "MDTA"
+#define CACHE_VERSION 2                    // 2: records carry a loudness gain
+#define CACHE_INITIAL_BUCKETS 1024         // Power of two
+#define CACHE_GROW_BYTES (64 * 1024)       // File is extended in steps this size
+#define CACHE_MAX_TEXT 255                 // Longest stored title/artist/album
+#define CACHE_MAX_PATH 511
+#define MB_MAX_RESPONSE (1024 * 1024)
 
 // MusicBrainz API
 #define MB_API_BASE "https://musicbrainz.org/ws/2/recording"
 #define MB_USER_AGENT VERSION_USER_AGENT
 
-// Rate limiting (1 request per second)
-#define RATE_LIMIT_MS 1100
+// Rate limiting (1 request per second, measured start to start)
+#define RATE_LIMIT_MS 1000
 
 // Minimum confidence to auto-accept match
 #define MIN_CONFIDENCE 60
 
+/**
+ * Cache file header
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t bucket_count;     // Power of two
+    uint32_t entry_count;      // Live entries
+    uint32_t records_start;    // Offset of the first record
+    uint32_t records_end;      // Append position
+} CacheHeader;
+
+/**
+ * Hash table slot (offset 0 = empty)
+ */
+typedef struct {
+    uint32_t hash;
+    uint32_t offset;
+} CacheBucket;
+
+/**
+ * Record header, followed by path, title, artist and album (no NULs)
+ * Version 1 records end after confidence; the rest of the layout is the same.
+ */
+typedef struct {
+    uint16_t path_len;
+    uint16_t title_len;
+    uint16_t artist_len;
+    uint16_t album_len;
+    int32_t confidence;
+    int16_t gain_cb;           // Loudness gain in 0.01 dB (if RECORD_HAS_GAIN)
+    uint16_t flags;
+} CacheRecord;
+
+#define CACHE_RECORD_V1_SIZE 12
+#define RECORD_HAS_GAIN 0x1        // gain_cb is valid
+#define RECORD_GAIN_ONLY 0x2       // Measured, but never looked up
+
 // Cache storage
-static cJSON *g_cache = NULL;
+static int g_cache_fd = -1;
+static uint8_t *g_map = NULL;
+static size_t g_map_size = 0;
 static char g_cache_path[512] = {0};
 static int g_total_lookups = 0;
-static bool g_cache_dirty = false;
+static bool g_cache_dirty = false;         // Mapping written since last msync
+static bool g_cache_damaged = false;       // A record failed its bounds check: rebuild
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;  // Cache and scan progress
+
+// Background folder scan
+#define SCAN_MAX_DEPTH 16
+static pthread_t g_scan_thread;
+static bool g_scan_thread_running = false;
+static volatile bool g_scan_cancel = false;
+static char g_scan_folder[512] = {0};
+static MetadataScanProgress g_scan_progress = {0};
+static char g_resume_folder[512] = {0};    // Folder of the last cancelled scan
+static int g_resume_index = 0;             // File it stopped at
 
 // Audio file extensions
 static const char *AUDIO_EXTENSIONS[] = {
     ".mp3", ".flac", ".ogg", ".wav", ".m4a", ".aac", NULL
 };
 
-/**
- * URL encode a string for use in query parameters
- */
-static void url_encode(const char *src, char *dst, size_t dst_size) {
-    static const char *hex = "0123456789ABCDEF";
-    size_t j = 0;
-
-    for (size_t i = 0; src[i] && j < dst_size - 4; i++) {
-        unsigned char c = (unsigned char)src[i];
-        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-            dst[j++] = c;
-        } else if (c == ' ') {
-            dst[j++] = '+';
-        } else {
-            dst[j++] = '%';
-            dst[j++] = hex[c >> 4];
-            dst[j++] = hex[c & 0x0F];
-        }
-    }
-    dst[j] = '\0';
-}
-
 /**
  * Extract search query from filename
  * "01. Suite-Pee.flac" -> "Suite-Pee"
@@ -151,124 +211,463 @@ static void ensure_cache_dir(void) {
     mkdir(dir, 0755);  // Ignore error if exists
 }
 
+#define CACHE_HEADER ((CacheHeader *)g_map)
+#define CACHE_BUCKETS ((CacheBucket *)(g_map + sizeof(CacheHeader)))
+
 /**
- * Load cache from disk
+ * FNV-1a hash of a path (never 0, so 0 can't look like a used bucket)
  */
-static void load_cache(void) {
-    if (g_cache) {
-        cJSON_Delete(g_cache);
-        g_cache = NULL;
+static uint32_t hash_path(const char *path) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
     }
+    return h ? h : 1;
+}
 
-    snprintf(g_cache_path, sizeof(g_cache_path), "%s/%s", get_cache_dir(), CACHE_FILENAME);
-
-    FILE *f = fopen(g_cache_path, "r");
-    if (!f) {
-        g_cache = cJSON_CreateObject();
-        return;
+/**
+ * Unmap and close the cache file
+ */
+static void close_cache(void) {
+    if (g_map) {
+        if (g_cache_dirty) msync(g_map, g_map_size, MS_SYNC);
+        munmap(g_map, g_map_size);
+        g_map = NULL;
+        g_map_size = 0;
     }
+    if (g_cache_fd >= 0) {
+        close(g_cache_fd);
+        g_cache_fd = -1;
+    }
+    g_cache_dirty = false;
+    g_cache_damaged = false;
+}
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+/**
+ * Map the open cache file at its current size
+ */
+static bool map_cache(void) {
+    struct stat st;
+    if (fstat(g_cache_fd, &st) != 0 || st.st_size < (off_t)sizeof(CacheHeader)) return false;
 
-    if (size <= 0 || size > 10 * 1024 * 1024) {  // Max 10MB
-        fclose(f);
-        g_cache = cJSON_CreateObject();
-        return;
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, g_cache_fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[METADATA] mmap failed: %s\n", strerror(errno));
+        return false;
     }
+    g_map = map;
+    g_map_size = (size_t)st.st_size;
+    return true;
+}
 
-    char *json = malloc(size + 1);
-    if (!json) {
-        fclose(f);
-        g_cache = cJSON_CreateObject();
-        return;
-    }
+/**
+ * Write an empty cache with the given table size to an open fd
+ */
+static bool init_cache_file(int fd, uint32_t bucket_count) {
+    uint32_t records_start = (uint32_t)(sizeof(CacheHeader) + bucket_count * sizeof(CacheBucket));
+    if (ftruncate(fd, 0) != 0 || ftruncate(fd, records_start + CACHE_GROW_BYTES) != 0) return false;
 
-    size_t read = fread(json, 1, size, f);
-    json[read] = '\0';
-    fclose(f);
+    CacheHeader header = { CACHE_MAGIC, CACHE_VERSION, bucket_count, 0, records_start, records_start };
+    return pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+}
 
-    g_cache = cJSON_Parse(json);
-    free(json);
+/**
+ * Check a mapped file's header and bounds
+ */
+static bool cache_is_valid(void) {
+    const CacheHeader *h = CACHE_HEADER;
+    if (h->magic != CACHE_MAGIC || (h->version != 1 && h->version != CACHE_VERSION)) return false;
+    if (h->bucket_count == 0 || (h->bucket_count & (h->bucket_count - 1)) != 0) return false;
+    if (h->records_start != sizeof(CacheHeader) + h->bucket_count * sizeof(CacheBucket)) return false;
+    return h->records_start <= h->records_end && h->records_end <= g_map_size;
+}
 
-    if (!g_cache) {
-        g_cache = cJSON_CreateObject();
+/**
+ * Bounds-check a record before anything is read from it
+ * A torn write or a file from another version can hold lengths that run
+ * past the data or past the fields they are copied into.
+ * @param map Mapping holding the record
+ * @param header Header of that mapping
+ * @param offset Record offset
+ * @param header_size Record header size (CACHE_RECORD_V1_SIZE for version 1)
+ * @return The record, or NULL if it is damaged
+ */
+static const CacheRecord* record_at(const uint8_t *map, const CacheHeader *header,
+                                    uint32_t offset, size_t header_size) {
+    if (offset < header->records_start || (uint64_t)offset + header_size > header->records_end) {
+        return NULL;
     }
+    const CacheRecord *r = (const CacheRecord *)(map + offset);
+    if (r->path_len > CACHE_MAX_PATH || r->title_len > CACHE_MAX_TEXT ||
+        r->artist_len > CACHE_MAX_TEXT || r->album_len > CACHE_MAX_TEXT) {
+        return NULL;
+    }
+    uint64_t end = (uint64_t)offset + header_size + r->path_len + r->title_len +
+                   r->artist_len + r->album_len;
+    return end <= header->records_end ? r : NULL;
+}
 
-    printf("[METADATA] Loaded cache: %d entries\n", cJSON_GetArraySize(g_cache));
+/**
+ * Record in the current mapping, flagging the cache for a rebuild if damaged
+ */
+static const CacheRecord* cache_record(uint32_t offset) {
+    const CacheRecord *r = record_at(g_map, CACHE_HEADER, offset, sizeof(CacheRecord));
+    if (!r && !g_cache_damaged) {
+        fprintf(stderr, "[METADATA] Damaged record at %u, cache will be rebuilt\n", offset);
+        g_cache_damaged = true;
+    }
+    return r;
 }
 
 /**
- * Save cache to disk
+ * Find the bucket for a path: its entry, or the empty slot it would use
+ * @return Bucket, or NULL if the table is full (damaged file)
  */
-static void save_cache(void) {
-    if (!g_cache || !g_cache_dirty) return;
+static CacheBucket* find_bucket(const char *path, uint32_t hash) {
+    uint32_t mask = CACHE_HEADER->bucket_count - 1;
+    size_t path_len = strlen(path);
+
+    for (uint32_t n = 0, i = hash & mask; n <= mask; n++, i = (i + 1) & mask) {
+        CacheBucket *b = &CACHE_BUCKETS[i];
+        if (b->offset == 0) return b;
+        if (b->hash == hash) {
+            const CacheRecord *r = cache_record(b->offset);
+            if (r && r->path_len == path_len &&
+                memcmp(g_map + b->offset + sizeof(CacheRecord), path, path_len) == 0) {
+                return b;
+            }
+        }
+    }
+    return NULL;
+}
 
-    ensure_cache_dir();
+/**
+ * Decode a record into a result
+ * @param gain_cb Output: stored loudness gain
+ * @param flags Output: RECORD_* flags
+ * @return false if the record is damaged (nothing is copied)
+ */
+static bool read_record(uint32_t offset, MetadataResult *result, int16_t *gain_cb, uint16_t *flags) {
+    const CacheRecord *r = cache_record(offset);
+    if (!r) return false;
+    const char *p = (const char *)(g_map + offset + sizeof(CacheRecord)) + r->path_len;
 
-    char *json = cJSON_Print(g_cache);
-    if (!json) return;
+    memset(result, 0, sizeof(MetadataResult));
+    memcpy(result->title, p, r->title_len);   p += r->title_len;
+    memcpy(result->artist, p, r->artist_len); p += r->artist_len;
+    memcpy(result->album, p, r->album_len);
+    result->confidence = r->confidence;
+    *gain_cb = r->gain_cb;
+    *flags = r->flags;
+    return true;
+}
 
-    FILE *f = fopen(g_cache_path, "w");
-    if (f) {
-        fputs(json, f);
-        fclose(f);
-        g_cache_dirty = false;
-        printf("[METADATA] Saved cache: %d entries\n", cJSON_GetArraySize(g_cache));
+/**
+ * Make room for len more bytes of records, extending the file if needed
+ */
+static bool reserve_records(size_t len) {
+    if (CACHE_HEADER->records_end + len <= g_map_size) return true;
+
+    size_t new_size = g_map_size + CACHE_GROW_BYTES;
+    while (new_size < CACHE_HEADER->records_end + len) new_size += CACHE_GROW_BYTES;
+
+    munmap(g_map, g_map_size);
+    g_map = NULL;
+    if (ftruncate(g_cache_fd, (off_t)new_size) != 0) {
+        fprintf(stderr, "[METADATA] Failed to grow cache: %s\n", strerror(errno));
+        map_cache();
+        return false;
     }
+    return map_cache();
+}
 
-    free(json);
+/**
+ * Append a record and point the path's bucket at it
+ */
+static bool put_record(const char *path, const MetadataResult *result, int16_t gain_cb, uint16_t flags) {
+    CacheRecord r;
+    size_t path_len = strlen(path);
+    r.path_len = (uint16_t)(path_len < CACHE_MAX_PATH ? path_len : CACHE_MAX_PATH);
+    r.title_len = (uint16_t)strnlen(result->title, CACHE_MAX_TEXT);
+    r.artist_len = (uint16_t)strnlen(result->artist, CACHE_MAX_TEXT);
+    r.album_len = (uint16_t)strnlen(result->album, CACHE_MAX_TEXT);
+    r.confidence = result->confidence;
+    r.gain_cb = gain_cb;
+    r.flags = flags;
+    if (r.path_len != path_len) return false;  // Too long to key on
+
+    size_t len = sizeof(r) + r.path_len + r.title_len + r.artist_len + r.album_len;
+    len = (len + 3) & ~(size_t)3;  // Keep records 4-byte aligned
+    if (!reserve_records(len)) return false;
+
+    uint32_t offset = CACHE_HEADER->records_end;
+    uint8_t *p = g_map + offset;
+    memcpy(p, &r, sizeof(r));                  p += sizeof(r);
+    memcpy(p, path, r.path_len);               p += r.path_len;
+    memcpy(p, result->title, r.title_len);     p += r.title_len;
+    memcpy(p, result->artist, r.artist_len);   p += r.artist_len;
+    memcpy(p, result->album, r.album_len);
+    CACHE_HEADER->records_end = offset + (uint32_t)len;
+
+    uint32_t hash = hash_path(path);
+    CacheBucket *b = find_bucket(path, hash);
+    if (!b) return false;
+    if (b->offset == 0) CACHE_HEADER->entry_count++;
+    b->hash = hash;
+    b->offset = offset;
+
+    g_cache_dirty = true;
+    return true;
 }
 
 /**
- * Query MusicBrainz API using curl CLI
+ * Rewrite the cache, dropping replaced and damaged records
+ * Also upgrades a version 1 file (records without a gain).
+ * @param new_count Table size of the new file
  */
-static bool query_musicbrainz(const char *search_query, MetadataResult *result) {
-    char encoded_query[512];
-    url_encode(search_query, encoded_query, sizeof(encoded_query));
+static bool rebuild_cache(uint32_t new_count) {
+    char tmp_path[520];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", g_cache_path);
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    if (!init_cache_file(fd, new_count)) {
+        close(fd);
+        remove(tmp_path);
+        return false;
+    }
 
-    // Build curl command
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd),
-        "curl -s -A '%s' '%s?query=%s&fmt=json&limit=3' -o '%s' 2>/dev/null",
-        MB_USER_AGENT, MB_API_BASE, encoded_query, TEMP_FILE);
+    // Swap in the new file, then copy live entries from the old mapping
+    uint8_t *old_map = g_map;
+    size_t old_size = g_map_size;
+    int old_fd = g_cache_fd;
+    CacheHeader old_header = *(const CacheHeader *)old_map;
+    uint32_t old_count = old_header.bucket_count;
+    bool old_v1 = old_header.version == 1;
+    size_t old_record_size = old_v1 ? CACHE_RECORD_V1_SIZE : sizeof(CacheRecord);
+    const CacheBucket *old_buckets = (const CacheBucket *)(old_map + sizeof(CacheHeader));
+
+    g_cache_fd = fd;
+    g_map = NULL;
+    if (!map_cache()) {
+        close(fd);
+        remove(tmp_path);
+        g_cache_fd = old_fd;
+        g_map = old_map;
+        g_map_size = old_size;
+        return false;
+    }
 
-    int ret = system(cmd);
-    if (ret != 0) {
-        fprintf(stderr, "[METADATA] curl failed with code %d\n", ret);
+    uint32_t dropped = 0;
+    for (uint32_t i = 0; i < old_count; i++) {
+        if (old_buckets[i].offset == 0) continue;
+        const CacheRecord *r = record_at(old_map, &old_header, old_buckets[i].offset, old_record_size);
+        if (!r) {
+            dropped++;
+            continue;
+        }
+        const char *p = (const char *)r + old_record_size;
+        char path[CACHE_MAX_PATH + 1];
+        MetadataResult result = {0};
+        memcpy(path, p, r->path_len);  path[r->path_len] = '\0';  p += r->path_len;
+        memcpy(result.title, p, r->title_len);   p += r->title_len;
+        memcpy(result.artist, p, r->artist_len); p += r->artist_len;
+        memcpy(result.album, p, r->album_len);
+        result.confidence = r->confidence;
+        put_record(path, &result, old_v1 ? 0 : r->gain_cb, old_v1 ? 0 : r->flags);
+    }
+
+    munmap(old_map, old_size);
+    close(old_fd);
+    msync(g_map, g_map_size, MS_SYNC);
+    g_cache_dirty = false;
+    g_cache_damaged = false;
+    if (dropped > 0) printf("[METADATA] Dropped %u damaged records\n", dropped);
+
+    if (rename(tmp_path, g_cache_path) != 0) {
+        fprintf(stderr, "[METADATA] Failed to replace cache: %s\n", strerror(errno));
         return false;
     }
+    printf("[METADATA] Cache rebuilt with %u slots\n", new_count);
+    return true;
+}
+
+/**
+ * Add or replace a cache entry with its gain fields
+ */
+static void cache_put_record(const char *filepath, const MetadataResult *result,
+                             int16_t gain_cb, uint16_t flags) {
+    if (!g_map) return;
+
+    // Keep the table under 70% full so probes stay short
+    if ((CACHE_HEADER->entry_count + 1) * 10 > CACHE_HEADER->bucket_count * 7) {
+        rebuild_cache(CACHE_HEADER->bucket_count * 2);
+    } else if (g_cache_damaged) {
+        rebuild_cache(CACHE_HEADER->bucket_count);
+    }
+    put_record(filepath, result, gain_cb, flags);
+}
+
+/**
+ * Add or replace a lookup result, keeping a gain already stored
+ */
+static void cache_put(const char *filepath, const MetadataResult *result) {
+    if (!g_map) return;
+
+    MetadataResult old;
+    int16_t gain_cb = 0;
+    uint16_t flags = 0;
+    CacheBucket *b = find_bucket(filepath, hash_path(filepath));
+    if (!b || b->offset == 0 || !read_record(b->offset, &old, &gain_cb, &flags)) flags = 0;
+    cache_put_record(filepath, result, gain_cb, flags & RECORD_HAS_GAIN);
+}
+
+/**
+ * One-time import of the old JSON cache
+ */
+static void import_legacy_cache(void) {
+    char legacy_path[512];
+    snprintf(legacy_path, sizeof(legacy_path), "%s/%s", get_cache_dir(), CACHE_LEGACY_FILENAME);
 
-    // Read response
-    FILE *f = fopen(TEMP_FILE, "r");
-    if (!f) return false;
+    FILE *f = fopen(legacy_path, "r");
+    if (!f) return;
 
     fseek(f, 0, SEEK_END);
     long size = ftell(f);
     fseek(f, 0, SEEK_SET);
 
-    if (size <= 0 || size > 1024 * 1024) {
-        fclose(f);
-        unlink(TEMP_FILE);
-        return false;
-    }
-
-    char *json = malloc(size + 1);
+    char *json = (size > 0 && size <= 10 * 1024 * 1024) ? malloc(size + 1) : NULL;  // Max 10MB
     if (!json) {
         fclose(f);
-        unlink(TEMP_FILE);
-        return false;
+        return;
     }
-
     size_t read = fread(json, 1, size, f);
     json[read] = '\0';
     fclose(f);
-    unlink(TEMP_FILE);
 
-    // Parse JSON
     cJSON *root = cJSON_Parse(json);
     free(json);
+    if (!root) return;
+
+    int imported = 0;
+    cJSON *entry;
+    cJSON_ArrayForEach(entry, root) {
+        if (!entry->string) continue;
+        MetadataResult result = {0};
+        cJSON *title = cJSON_GetObjectItem(entry, "title");
+        cJSON *artist = cJSON_GetObjectItem(entry, "artist");
+        cJSON *album = cJSON_GetObjectItem(entry, "album");
+        cJSON *confidence = cJSON_GetObjectItem(entry, "confidence");
+        if (title && title->valuestring) strncpy(result.title, title->valuestring, sizeof(result.title) - 1);
+        if (artist && artist->valuestring) strncpy(result.artist, artist->valuestring, sizeof(result.artist) - 1);
+        if (album && album->valuestring) strncpy(result.album, album->valuestring, sizeof(result.album) - 1);
+        if (confidence) result.confidence = confidence->valueint;
+        cache_put(entry->string, &result);
+        imported++;
+    }
+    cJSON_Delete(root);
+
+    // Keep the JSON around, but never import it again
+    char done_path[540];
+    snprintf(done_path, sizeof(done_path), "%s%s", legacy_path, CACHE_IMPORTED_SUFFIX);
+    rename(legacy_path, done_path);
+
+    printf("[METADATA] Imported %d entries from %s\n", imported, CACHE_LEGACY_FILENAME);
+}
+
+/**
+ * Open (or create) and map the cache file
+ */
+static void load_cache(void) {
+    close_cache();
+    ensure_cache_dir();
+
+    snprintf(g_cache_path, sizeof(g_cache_path), "%s/%s", get_cache_dir(), CACHE_FILENAME);
+
+    g_cache_fd = open(g_cache_path, O_RDWR | O_CREAT, 0644);
+    if (g_cache_fd < 0) {
+        fprintf(stderr, "[METADATA] Cannot open cache: %s\n", g_cache_path);
+        return;
+    }
+
+    bool created = false;
+    if (!map_cache() || !cache_is_valid()) {
+        if (g_map) {
+            munmap(g_map, g_map_size);
+            g_map = NULL;
+        }
+        if (!init_cache_file(g_cache_fd, CACHE_INITIAL_BUCKETS) || !map_cache()) {
+            fprintf(stderr, "[METADATA] Cannot create cache: %s\n", g_cache_path);
+            close_cache();
+            return;
+        }
+        created = true;
+    }
+
+    if (created) {
+        import_legacy_cache();
+    } else if (CACHE_HEADER->version != CACHE_VERSION && !rebuild_cache(CACHE_HEADER->bucket_count)) {
+        fprintf(stderr, "[METADATA] Cannot upgrade cache: %s\n", g_cache_path);
+        close_cache();
+        return;
+    }
+
+    printf("[METADATA] Loaded cache: %u entries\n", CACHE_HEADER->entry_count);
+}
+
+/**
+ * Flush cache writes to disk
+ */
+static void save_cache(void) {
+    if (g_map && g_cache_damaged) rebuild_cache(CACHE_HEADER->bucket_count);
+    if (!g_map || !g_cache_dirty) return;
+
+    msync(g_map, g_map_size, MS_SYNC);
+    g_cache_dirty = false;
+    printf("[METADATA] Saved cache: %u entries\n", CACHE_HEADER->entry_count);
+}
+
+/**
+ * Start a MusicBrainz search
+ * The request runs in the background and its response is parsed from
+ * memory, so the caller can do other work (prepare the next query) while
+ * it is in flight.
+ * @return Handle to read with mb_request_finish(), or NULL
+ */
+static HttpCall* mb_request_start(const char *search_query) {
+    char encoded_query[512];
+    http_url_encode(search_query, encoded_query, sizeof(encoded_query));
+
+    char url[1024];
+    snprintf(url, sizeof(url), "%s?query=%s&fmt=json&limit=3", MB_API_BASE, encoded_query);
+
+    HttpRequest req = {
+        .url = url,
+        .user_agent = MB_USER_AGENT,
+        .max_body = MB_MAX_RESPONSE,
+    };
+    HttpCall *call = http_start(&req);
+    if (!call) {
+        fprintf(stderr, "[METADATA] Failed to start curl: %s\n", strerror(errno));
+    }
+    return call;
+}
+
+/**
+ * Read a response started by mb_request_start() and parse the best match
+ */
+static bool mb_request_finish(HttpCall *call, MetadataResult *result) {
+    HttpResponse resp;
+    if (!http_finish(call, &resp)) return false;
+    if (resp.status != 200 || !resp.body) {
+        fprintf(stderr, "[METADATA] MusicBrainz returned HTTP %d\n", resp.status);
+        http_response_free(&resp);
+        return false;
+    }
+
+    // Parse JSON
+    cJSON *root = json_arena_parse(resp.body);
+    http_response_free(&resp);
 
     if (!root) return false;
 
@@ -314,45 +713,66 @@ static bool query_musicbrainz(const char *search_query, MetadataResult *result)
         }
     }
 
-    cJSON_Delete(root);
+    json_arena_release(root);
+    pthread_mutex_lock(&g_mutex);
     g_total_lookups++;
+    pthread_mutex_unlock(&g_mutex);
 
     return found;
 }
 
 /**
- * Add result to cache
+ * Query MusicBrainz API (blocking)
  */
-static void cache_result(const char *filepath, const MetadataResult *result) {
-    if (!g_cache) return;
-
-    cJSON *entry = cJSON_CreateObject();
-    cJSON_AddStringToObject(entry, "title", result->title);
-    cJSON_AddStringToObject(entry, "artist", result->artist);
-    cJSON_AddStringToObject(entry, "album", result->album);
-    cJSON_AddNumberToObject(entry, "confidence", result->confidence);
-
-    // Remove old entry if exists
-    cJSON_DeleteItemFromObject(g_cache, filepath);
-    cJSON_AddItemToObject(g_cache, filepath, entry);
-
-    g_cache_dirty = true;
+static bool query_musicbrainz(const char *search_query, MetadataResult *result) {
+    HttpCall *call = mb_request_start(search_query);
+    return call && mb_request_finish(call, result);
 }
 
 // ============================================================================
 // Public API
 // ============================================================================
 
+/**
+ * Size of the cache mapping (file-backed, so the kernel can reclaim it)
+ */
+static size_t metadata_usage(void) {
+    pthread_mutex_lock(&g_mutex);
+    size_t bytes = g_map ? g_map_size : 0;
+    pthread_mutex_unlock(&g_mutex);
+    return bytes;
+}
+
 void metadata_init(void) {
     load_cache();
     g_total_lookups = 0;
+    memgov_register("metadata", 0, metadata_usage, NULL);
 }
 
 void metadata_cleanup(void) {
+    if (g_scan_thread_running) {
+        g_scan_cancel = true;
+        pthread_join(g_scan_thread, NULL);
+        g_scan_thread_running = false;
+    }
+
+    pthread_mutex_lock(&g_mutex);
     save_cache();
-    if (g_cache) {
-        cJSON_Delete(g_cache);
-        g_cache = NULL;
+    close_cache();
+    pthread_mutex_unlock(&g_mutex);
+}
+
+/**
+ * Build the search query for a file
+ * Uses embedded artist/title when the file has them, else the filename.
+ */
+static void build_query(const char *filepath, char *query, size_t size) {
+    TrackInfo tags;
+    tags_probe(filepath, &tags);
+    if (tags.title[0]) {
+        snprintf(query, size, "%.120s%s%.120s", tags.artist, tags.artist[0] ? " " : "", tags.title);
+    } else {
+        extract_search_query(filepath, query, size);
     }
 }
 
@@ -366,9 +786,8 @@ bool metadata_lookup(const char *filepath, MetadataResult *result) {
         return true;
     }
 
-    // Extract search query from filename
     char query[256];
-    extract_search_query(filepath, query, sizeof(query));
+    build_query(filepath, query, sizeof(query));
 
     if (strlen(query) < 2) return false;
 
@@ -376,7 +795,9 @@ bool metadata_lookup(const char *filepath, MetadataResult *result) {
 
     // Query MusicBrainz
     if (query_musicbrainz(query, result)) {
-        cache_result(filepath, result);
+        pthread_mutex_lock(&g_mutex);
+        cache_put(filepath, result);
+        pthread_mutex_unlock(&g_mutex);
         printf("[METADATA] Found: %s - %s (%d%%)\n",
                result->artist, result->title, result->confidence);
         return true;
@@ -385,111 +806,329 @@ bool metadata_lookup(const char *filepath, MetadataResult *result) {
     return false;
 }
 
-int metadata_scan_folder(const char *folder_path, ScanProgressCallback progress_cb) {
-    if (!folder_path) return 0;
+/**
+ * Monotonic clock in milliseconds
+ */
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
 
-    DIR *dir = opendir(folder_path);
-    if (!dir) return 0;
+/**
+ * Growable list of file paths
+ */
+typedef struct {
+    char **paths;
+    int count;
+    int capacity;
+} PathList;
+
+static void path_list_free(PathList *list) {
+    for (int i = 0; i < list->count; i++) free(list->paths[i]);
+    free(list->paths);
+    memset(list, 0, sizeof(*list));
+}
 
-    // Create backup before scanning (so user can restore if results are bad)
-    metadata_backup_cache();
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/**
+ * Collect audio files under a folder, recursing into subfolders
+ */
+static void collect_audio_files(const char *folder_path, PathList *list, int depth) {
+    if (depth > SCAN_MAX_DEPTH) return;
+
+    DIR *dir = opendir(folder_path);
+    if (!dir) return;
 
-    // First pass: count audio files
-    int total = 0;
     struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
         if (entry->d_name[0] == '.') continue;
-        if (is_audio_file(entry->d_name)) total++;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", folder_path, entry->d_name);
+
+        bool is_dir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+            struct stat st;
+            is_dir = stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        if (is_dir) {
+            collect_audio_files(path, list, depth + 1);
+        } else if (is_audio_file(entry->d_name)) {
+            if (list->count == list->capacity) {
+                int new_capacity = list->capacity ? list->capacity * 2 : 64;
+                char **grown = realloc(list->paths, new_capacity * sizeof(char *));
+                if (!grown) break;
+                list->paths = grown;
+                list->capacity = new_capacity;
+            }
+            char *copy = strdup(path);
+            if (!copy) break;
+            list->paths[list->count++] = copy;
+        }
     }
-    rewinddir(dir);
 
-    if (total == 0) {
-        closedir(dir);
+    closedir(dir);
+}
+
+/**
+ * Advance to the next file that needs a request and build its query
+ * Files already in the cache count as found without a request.
+ * @param index In: first candidate, out: file the query is for
+ * @return false when no files are left
+ */
+static bool prepare_next(const PathList *files, int *index, char *query, size_t size, int *found) {
+    for (; *index < files->count; (*index)++) {
+        const char *path = files->paths[*index];
+        if (metadata_has_cache(path)) {
+            (*found)++;
+            continue;
+        }
+        build_query(path, query, size);
+        if (strlen(query) >= 2) return true;
+    }
+    return false;
+}
+
+int metadata_scan_folder(const char *folder_path, ScanProgressCallback progress_cb) {
+    if (!folder_path) return 0;
+
+    PathList files = {0};
+    collect_audio_files(folder_path, &files, 0);
+    if (files.count == 0) {
+        path_list_free(&files);
         return 0;
     }
+    qsort(files.paths, files.count, sizeof(char *), compare_paths);
+
+    // Create backup before scanning (so user can restore if results are bad)
+    metadata_backup_cache();
 
-    // Second pass: scan files
+    // Continue a cancelled scan of the same folder where it stopped
     int current = 0;
-    int found = 0;
+    pthread_mutex_lock(&g_mutex);
+    if (strcmp(g_resume_folder, folder_path) == 0 && g_resume_index < files.count) {
+        current = g_resume_index;
+        printf("[METADATA] Resuming scan at %d / %d\n", current, files.count);
+    }
+    pthread_mutex_unlock(&g_mutex);
 
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] == '.') continue;
-        if (!is_audio_file(entry->d_name)) continue;
+    // Files before the resume point that matched last time still count
+    int found = 0;
+    for (int i = 0; i < current; i++) {
+        if (metadata_has_cache(files.paths[i])) found++;
+    }
 
-        current++;
+    bool cancelled = false;
+    uint64_t last_request = 0;
+    char query[256];
+    char next_query[256];
+    bool have = prepare_next(&files, &current, query, sizeof(query), &found);
 
-        // Build full path
-        char filepath[512];
-        snprintf(filepath, sizeof(filepath), "%s/%s", folder_path, entry->d_name);
+    while (have) {
+        const char *path = files.paths[current];
+        const char *name = strrchr(path, '/');
+        name = name ? name + 1 : path;
 
         // Progress callback
-        if (progress_cb && !progress_cb(current, total, entry->d_name)) {
-            break;  // Cancelled
+        if (progress_cb && !progress_cb(current + 1, files.count, found, name)) {
+            cancelled = true;
+            break;
         }
 
-        // Skip if already cached
-        if (metadata_has_cache(filepath)) {
-            found++;
-            continue;
+        // Spend the rate budget exactly: requests start RATE_LIMIT_MS apart,
+        // however long the previous one took
+        uint64_t now = now_ms();
+        if (last_request && now < last_request + RATE_LIMIT_MS) {
+            usleep((useconds_t)(last_request + RATE_LIMIT_MS - now) * 1000);
         }
+        last_request = now_ms();
+
+        printf("[METADATA] Searching: %s\n", query);
+        HttpCall *call = mb_request_start(query);
+
+        // Read the next file's tags while this request is in flight
+        int next = current + 1;
+        bool have_next = prepare_next(&files, &next, next_query, sizeof(next_query), &found);
 
-        // Lookup metadata
         MetadataResult result;
-        if (metadata_lookup(filepath, &result)) {
+        memset(&result, 0, sizeof(result));
+        if (call && mb_request_finish(call, &result)) {
+            pthread_mutex_lock(&g_mutex);
+            cache_put(path, &result);
+            pthread_mutex_unlock(&g_mutex);
             found++;
+            printf("[METADATA] Found: %s - %s (%d%%)\n",
+                   result.artist, result.title, result.confidence);
         }
 
-        // Rate limiting (1 req/sec for MusicBrainz)
-        usleep(RATE_LIMIT_MS * 1000);
+        current = next;
+        have = have_next;
+        memcpy(query, next_query, sizeof(query));
     }
 
-    closedir(dir);
+    pthread_mutex_lock(&g_mutex);
+    if (cancelled) {
+        strncpy(g_resume_folder, folder_path, sizeof(g_resume_folder) - 1);
+        g_resume_index = current;
+    } else {
+        g_resume_folder[0] = '\0';
+        g_resume_index = 0;
+    }
     save_cache();  // Save after scan
+    pthread_mutex_unlock(&g_mutex);
 
+    path_list_free(&files);
     return found;
 }
 
-bool metadata_get_cached(const char *filepath, MetadataResult *result) {
-    if (!g_cache || !filepath || !result) return false;
+/**
+ * Scan thread progress: publish for the UI, stop when cancelled
+ */
+static bool scan_thread_progress(int current, int total, int found, const char *current_file) {
+    pthread_mutex_lock(&g_mutex);
+    g_scan_progress.current = current;
+    g_scan_progress.total = total;
+    g_scan_progress.found = found;
+    strncpy(g_scan_progress.current_file, current_file, sizeof(g_scan_progress.current_file) - 1);
+    g_scan_progress.current_file[sizeof(g_scan_progress.current_file) - 1] = '\0';
+    pthread_mutex_unlock(&g_mutex);
+    return !g_scan_cancel;
+}
 
-    cJSON *entry = cJSON_GetObjectItem(g_cache, filepath);
-    if (!entry) return false;
+/**
+ * Scan thread: run one folder scan
+ */
+static void* scan_thread_func(void *arg) {
+    (void)arg;
+    int found = metadata_scan_folder(g_scan_folder, scan_thread_progress);
+
+    pthread_mutex_lock(&g_mutex);
+    g_scan_progress.found = found;
+    if (!g_scan_cancel) g_scan_progress.current = g_scan_progress.total;
+    g_scan_progress.running = false;
+    pthread_mutex_unlock(&g_mutex);
+    return NULL;
+}
 
-    memset(result, 0, sizeof(MetadataResult));
+bool metadata_scan_start(const char *folder_path) {
+    if (!folder_path) return false;
 
-    cJSON *title = cJSON_GetObjectItem(entry, "title");
-    cJSON *artist = cJSON_GetObjectItem(entry, "artist");
-    cJSON *album = cJSON_GetObjectItem(entry, "album");
-    cJSON *confidence = cJSON_GetObjectItem(entry, "confidence");
+    pthread_mutex_lock(&g_mutex);
+    bool busy = g_scan_progress.running;
+    pthread_mutex_unlock(&g_mutex);
+    if (busy) return false;
 
-    if (title && title->valuestring) {
-        strncpy(result->title, title->valuestring, sizeof(result->title) - 1);
-    }
-    if (artist && artist->valuestring) {
-        strncpy(result->artist, artist->valuestring, sizeof(result->artist) - 1);
-    }
-    if (album && album->valuestring) {
-        strncpy(result->album, album->valuestring, sizeof(result->album) - 1);
+    // Reap the previous (finished) scan
+    if (g_scan_thread_running) {
+        pthread_join(g_scan_thread, NULL);
+        g_scan_thread_running = false;
     }
-    if (confidence) {
-        result->confidence = confidence->valueint;
+
+    strncpy(g_scan_folder, folder_path, sizeof(g_scan_folder) - 1);
+    g_scan_folder[sizeof(g_scan_folder) - 1] = '\0';
+    memset(&g_scan_progress, 0, sizeof(g_scan_progress));
+    g_scan_progress.running = true;
+    g_scan_cancel = false;
+
+    if (pthread_create(&g_scan_thread, NULL, scan_thread_func, NULL) != 0) {
+        fprintf(stderr, "[METADATA] Failed to create scan thread\n");
+        g_scan_progress.running = false;
+        return false;
     }
+    g_scan_thread_running = true;
+    return true;
+}
+
+void metadata_scan_cancel(void) {
+    g_scan_cancel = true;
+}
+
+void metadata_scan_get_progress(MetadataScanProgress *progress) {
+    pthread_mutex_lock(&g_mutex);
+    *progress = g_scan_progress;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+bool metadata_get_cached(const char *filepath, MetadataResult *result) {
+    if (!filepath || !result) return false;
 
-    return result->title[0] != '\0';
+    pthread_mutex_lock(&g_mutex);
+    CacheBucket *b = g_map ? find_bucket(filepath, hash_path(filepath)) : NULL;
+    int16_t gain_cb = 0;
+    uint16_t flags = 0;
+    bool hit = b && b->offset != 0 && read_record(b->offset, result, &gain_cb, &flags);
+    pthread_mutex_unlock(&g_mutex);
+
+    return hit && !(flags & RECORD_GAIN_ONLY) && result->title[0] != '\0';
 }
 
 bool metadata_has_cache(const char *filepath) {
-    if (!g_cache || !filepath) return false;
-    return cJSON_HasObjectItem(g_cache, filepath);
+    if (!filepath) return false;
+
+    pthread_mutex_lock(&g_mutex);
+    CacheBucket *b = g_map ? find_bucket(filepath, hash_path(filepath)) : NULL;
+    const CacheRecord *r = b && b->offset != 0 ? cache_record(b->offset) : NULL;
+    bool hit = r && !(r->flags & RECORD_GAIN_ONLY);
+    pthread_mutex_unlock(&g_mutex);
+
+    return hit;
+}
+
+bool metadata_get_gain(const char *filepath, float *gain_db) {
+    if (!filepath || !gain_db) return false;
+
+    pthread_mutex_lock(&g_mutex);
+    CacheBucket *b = g_map ? find_bucket(filepath, hash_path(filepath)) : NULL;
+    MetadataResult result;
+    int16_t gain_cb = 0;
+    uint16_t flags = 0;
+    bool hit = b && b->offset != 0 && read_record(b->offset, &result, &gain_cb, &flags) &&
+               (flags & RECORD_HAS_GAIN);
+    pthread_mutex_unlock(&g_mutex);
+
+    if (hit) *gain_db = gain_cb / 100.0f;
+    return hit;
+}
+
+void metadata_set_gain(const char *filepath, float gain_db) {
+    if (!filepath) return;
+    if (gain_db < -300.0f) gain_db = -300.0f;
+    if (gain_db > 300.0f) gain_db = 300.0f;
+    int16_t gain_cb = (int16_t)(gain_db * 100.0f + (gain_db < 0 ? -0.5f : 0.5f));
+
+    pthread_mutex_lock(&g_mutex);
+    if (g_map) {
+        MetadataResult result = {0};
+        int16_t old_gain;
+        uint16_t flags = RECORD_GAIN_ONLY;
+        CacheBucket *b = find_bucket(filepath, hash_path(filepath));
+        if (!b || b->offset == 0 || !read_record(b->offset, &result, &old_gain, &flags)) {
+            memset(&result, 0, sizeof(result));
+            flags = RECORD_GAIN_ONLY;
+        }
+        cache_put_record(filepath, &result, gain_cb, flags | RECORD_HAS_GAIN);
+    }
+    pthread_mutex_unlock(&g_mutex);
 }
 
 void metadata_clear_cache(void) {
-    if (g_cache) {
-        cJSON_Delete(g_cache);
-        g_cache = cJSON_CreateObject();
-        g_cache_dirty = true;
-        save_cache();
+    pthread_mutex_lock(&g_mutex);
+    if (g_map) {
+        munmap(g_map, g_map_size);
+        g_map = NULL;
+        g_map_size = 0;
+        if (init_cache_file(g_cache_fd, CACHE_INITIAL_BUCKETS) && map_cache()) {
+            printf("[METADATA] Cache cleared\n");
+        } else {
+            close_cache();
+        }
     }
+    pthread_mutex_unlock(&g_mutex);
 }
 
 bool metadata_backup_cache(void) {
@@ -497,12 +1136,18 @@ bool metadata_backup_cache(void) {
     snprintf(backup_path, sizeof(backup_path), "%s/%s", get_cache_dir(), CACHE_BACKUP_FILENAME);
 
     // If cache file doesn't exist, nothing to backup
-    FILE *src = fopen(g_cache_path, "r");
-    if (!src) return false;
+    pthread_mutex_lock(&g_mutex);
+    save_cache();
+    FILE *src = fopen(g_cache_path, "rb");
+    if (!src) {
+        pthread_mutex_unlock(&g_mutex);
+        return false;
+    }
 
-    FILE *dst = fopen(backup_path, "w");
+    FILE *dst = fopen(backup_path, "wb");
     if (!dst) {
         fclose(src);
+        pthread_mutex_unlock(&g_mutex);
         return false;
     }
 
@@ -515,6 +1160,7 @@ bool metadata_backup_cache(void) {
 
     fclose(src);
     fclose(dst);
+    pthread_mutex_unlock(&g_mutex);
 
     printf("[METADATA] Backup created: %s\n", backup_path);
     return true;
@@ -524,15 +1170,20 @@ bool metadata_restore_backup(void) {
     char backup_path[512];
     snprintf(backup_path, sizeof(backup_path), "%s/%s", get_cache_dir(), CACHE_BACKUP_FILENAME);
 
-    FILE *src = fopen(backup_path, "r");
+    FILE *src = fopen(backup_path, "rb");
     if (!src) {
         fprintf(stderr, "[METADATA] No backup found\n");
         return false;
     }
 
-    FILE *dst = fopen(g_cache_path, "w");
+    // Unmap first: the file is overwritten underneath the mapping
+    pthread_mutex_lock(&g_mutex);
+    close_cache();
+    FILE *dst = fopen(g_cache_path, "wb");
     if (!dst) {
         fclose(src);
+        load_cache();
+        pthread_mutex_unlock(&g_mutex);
         return false;
     }
 
@@ -548,6 +1199,7 @@ bool metadata_restore_backup(void) {
 
     // Reload cache from restored file
     load_cache();
+    pthread_mutex_unlock(&g_mutex);
 
     printf("[METADATA] Restored from backup\n");
     return true;
@@ -567,7 +1219,9 @@ bool metadata_has_backup(void) {
 
 void metadata_get_stats(int *total_cached, int *total_lookups) {
     if (total_cached) {
-        *total_cached = g_cache ? cJSON_GetArraySize(g_cache) : 0;
+        pthread_mutex_lock(&g_mutex);
+        *total_cached = g_map ? (int)CACHE_HEADER->entry_count : 0;
+        pthread_mutex_unlock(&g_mutex);
     }
     if (total_lookups) {
         *total_lookups = g_total_lookups;
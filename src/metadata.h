@@ -20,7 +20,16 @@ typedef struct {
 
 // Scan progress callback
 // Returns false to cancel scan
-typedef bool (*ScanProgressCallback)(int current, int total, const char *current_file);
+typedef bool (*ScanProgressCallback)(int current, int total, int found, const char *current_file);
+
+// Progress of a background scan (metadata_scan_start)
+typedef struct {
+    bool running;
+    int current;               // Files handled so far
+    int total;                 // Audio files found under the folder
+    int found;                 // Files with metadata (cached or matched)
+    char current_file[256];
+} MetadataScanProgress;
 
 /**
  * Initialize metadata system, load cache from disk
@@ -41,13 +50,35 @@ void metadata_cleanup(void);
 bool metadata_lookup(const char *filepath, MetadataResult *result);
 
 /**
- * Scan all audio files in a folder for metadata
+ * Scan all audio files in a folder and its subfolders for metadata
+ * Blocking. Requests start exactly one rate-limit interval apart, and the
+ * next file's query is prepared while a request is in flight. A scan that
+ * was cancelled continues where it stopped when the same folder is scanned
+ * again.
  * @param folder_path Path to folder to scan
  * @param progress_cb Callback for progress updates (can be NULL)
- * @return Number of files successfully matched
+ * @return Number of files with metadata (cached or matched)
  */
 int metadata_scan_folder(const char *folder_path, ScanProgressCallback progress_cb);
 
+/**
+ * Run metadata_scan_folder() on a background thread
+ * @param folder_path Path to folder to scan
+ * @return false if a scan is already running or the thread failed
+ */
+bool metadata_scan_start(const char *folder_path);
+
+/**
+ * Ask the background scan to stop (the resume point is kept)
+ */
+void metadata_scan_cancel(void);
+
+/**
+ * Get the background scan's progress
+ * @param progress Output (running=false once the scan has finished)
+ */
+void metadata_scan_get_progress(MetadataScanProgress *progress);
+
 /**
  * Get cached metadata for a file (if available)
  * @param filepath Path to audio file
@@ -61,6 +92,23 @@ bool metadata_get_cached(const char *filepath, MetadataResult *result);
  */
 bool metadata_has_cache(const char *filepath);
 
+/**
+ * Get the stored loudness gain of a file (see loudness.h)
+ * @param filepath Path to audio file
+ * @param gain_db Output: track gain in dB
+ * @return true if a gain is stored
+ */
+bool metadata_get_gain(const char *filepath, float *gain_db);
+
+/**
+ * Store a file's loudness gain, keeping its other cached metadata
+ * A file without an entry gets a gain-only one, which
+ * metadata_has_cache() and metadata_get_cached() don't count.
+ * @param filepath Path to audio file
+ * @param gain_db Track gain in dB
+ */
+void metadata_set_gain(const char *filepath, float gain_db);
+
 /**
  * Clear all cached metadata
  */
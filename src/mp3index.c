@@ -0,0 +1,246 @@
+/**
+ * MP3 Index Implementation
+ *
+ * A small ring of recent scans, saved whole after each new entry (a few
+ * hundred bytes per track). Threading follows preload.c: one worker,
+ * one pending request, pthread mutex/cond.
+ */
+
+#include "mp3index.h"
+#include "state.h"
+#include "iosched.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define MP3INDEX_FILENAME "mp3_index.bin"
+#define MP3INDEX_MAGIC 0x5833504D          // "MP3X"
+#define MP3INDEX_VERSION 1
+#define MP3INDEX_MAX_ENTRIES 128
+#define MP3INDEX_MAX_PATH 512
+
+/**
+ * One scanned file
+ */
+typedef struct {
+    char *path;
+    int64_t size;
+    int64_t mtime;
+    Mp3Toc toc;
+} IndexEntry;
+
+static IndexEntry g_entries[MP3INDEX_MAX_ENTRIES];
+static int g_next_slot = 0;                 // Ring position to overwrite next
+static char g_cache_path[MP3INDEX_MAX_PATH] = {0};
+
+static pthread_t g_thread;
+static bool g_thread_running = false;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static char g_request[MP3INDEX_MAX_PATH] = {0};
+static volatile bool g_shutdown = false;
+
+/**
+ * Find the entry for a path (caller holds g_mutex)
+ */
+static IndexEntry* find_entry(const char *path) {
+    for (int i = 0; i < MP3INDEX_MAX_ENTRIES; i++) {
+        if (g_entries[i].path && strcmp(g_entries[i].path, path) == 0) {
+            return &g_entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Store a result, replacing an older one for the same path or the oldest
+ * entry (caller holds g_mutex)
+ */
+static void store_entry(const char *path, int64_t size, int64_t mtime, const Mp3Toc *toc) {
+    IndexEntry *e = find_entry(path);
+    if (!e) {
+        e = &g_entries[g_next_slot];
+        g_next_slot = (g_next_slot + 1) % MP3INDEX_MAX_ENTRIES;
+        free(e->path);
+        e->path = strdup(path);
+        if (!e->path) return;
+    }
+    e->size = size;
+    e->mtime = mtime;
+    e->toc = *toc;
+}
+
+/**
+ * Write the cache (temp file + rename, like the library index)
+ */
+static void save_cache(void) {
+    if (!g_cache_path[0]) return;
+
+    char tmp_path[MP3INDEX_MAX_PATH + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", g_cache_path);
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return;
+
+    pthread_mutex_lock(&g_mutex);
+    uint32_t count = 0;
+    for (int i = 0; i < MP3INDEX_MAX_ENTRIES; i++) {
+        if (g_entries[i].path) count++;
+    }
+    uint32_t header[3] = { MP3INDEX_MAGIC, MP3INDEX_VERSION, count };
+    bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+
+    // Oldest first, so reloading keeps the ring order
+    for (int n = 0; n < MP3INDEX_MAX_ENTRIES && ok; n++) {
+        const IndexEntry *e = &g_entries[(g_next_slot + n) % MP3INDEX_MAX_ENTRIES];
+        if (!e->path) continue;
+        uint16_t path_len = (uint16_t)strlen(e->path);
+        ok = fwrite(&path_len, sizeof(path_len), 1, f) == 1 &&
+             fwrite(e->path, 1, path_len, f) == path_len &&
+             fwrite(&e->size, sizeof(e->size), 1, f) == 1 &&
+             fwrite(&e->mtime, sizeof(e->mtime), 1, f) == 1 &&
+             fwrite(&e->toc.duration_ms, sizeof(e->toc.duration_ms), 1, f) == 1 &&
+             fwrite(e->toc.offsets, sizeof(e->toc.offsets), 1, f) == 1;
+    }
+    pthread_mutex_unlock(&g_mutex);
+
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp_path, g_cache_path) != 0) {
+        fprintf(stderr, "[MP3INDEX] Failed to save cache: %s\n", g_cache_path);
+        remove(tmp_path);
+    }
+}
+
+/**
+ * Read the saved cache
+ */
+static void load_cache(void) {
+    FILE *f = fopen(g_cache_path, "rb");
+    if (!f) return;
+
+    uint32_t header[3];
+    if (fread(header, sizeof(header), 1, f) != 1 ||
+        header[0] != MP3INDEX_MAGIC || header[1] != MP3INDEX_VERSION) {
+        fclose(f);
+        return;
+    }
+
+    int loaded = 0;
+    pthread_mutex_lock(&g_mutex);
+    for (uint32_t i = 0; i < header[2]; i++) {
+        uint16_t path_len;
+        char path[MP3INDEX_MAX_PATH];
+        int64_t size, mtime;
+        Mp3Toc toc = {0};
+
+        if (fread(&path_len, sizeof(path_len), 1, f) != 1 || path_len >= sizeof(path)) break;
+        if (fread(path, 1, path_len, f) != path_len) break;
+        path[path_len] = '\0';
+        if (fread(&size, sizeof(size), 1, f) != 1 ||
+            fread(&mtime, sizeof(mtime), 1, f) != 1 ||
+            fread(&toc.duration_ms, sizeof(toc.duration_ms), 1, f) != 1 ||
+            fread(toc.offsets, sizeof(toc.offsets), 1, f) != 1) break;
+
+        toc.valid = true;
+        toc.exact = true;
+        store_entry(path, size, mtime, &toc);
+        loaded++;
+    }
+    pthread_mutex_unlock(&g_mutex);
+    fclose(f);
+
+    printf("[MP3INDEX] Loaded %d cached scans\n", loaded);
+}
+
+/**
+ * Worker: scan the latest requested file
+ */
+static void* scan_thread_func(void *arg) {
+    (void)arg;
+    iosched_set_class(IO_CLASS_BULK);  // Whole-file reads, nobody waits on them
+
+    pthread_mutex_lock(&g_mutex);
+    while (!g_shutdown) {
+        if (!g_request[0]) {
+            pthread_cond_wait(&g_cond, &g_mutex);
+            continue;
+        }
+
+        char path[MP3INDEX_MAX_PATH];
+        strncpy(path, g_request, sizeof(path) - 1);
+        path[sizeof(path) - 1] = '\0';
+        g_request[0] = '\0';
+        pthread_mutex_unlock(&g_mutex);
+
+        struct stat st;
+        Mp3Toc toc;
+        bool scanned = stat(path, &st) == 0 && tags_scan_mp3(path, &toc, &g_shutdown);
+
+        if (scanned) {
+            pthread_mutex_lock(&g_mutex);
+            store_entry(path, (int64_t)st.st_size, (int64_t)st.st_mtime, &toc);
+            pthread_mutex_unlock(&g_mutex);
+            save_cache();
+        }
+
+        pthread_mutex_lock(&g_mutex);
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return NULL;
+}
+
+int mp3index_init(void) {
+    const char *data_dir = state_get_data_dir();
+    if (data_dir && data_dir[0]) {
+        snprintf(g_cache_path, sizeof(g_cache_path), "%s/%s", data_dir, MP3INDEX_FILENAME);
+        load_cache();
+    }
+
+    g_shutdown = false;
+    if (pthread_create(&g_thread, NULL, scan_thread_func, NULL) != 0) {
+        fprintf(stderr, "[MP3INDEX] Failed to create scan thread\n");
+        return -1;
+    }
+    g_thread_running = true;
+    return 0;
+}
+
+void mp3index_cleanup(void) {
+    if (g_thread_running) {
+        pthread_mutex_lock(&g_mutex);
+        g_shutdown = true;
+        pthread_cond_broadcast(&g_cond);
+        pthread_mutex_unlock(&g_mutex);
+        pthread_join(g_thread, NULL);
+        g_thread_running = false;
+    }
+
+    for (int i = 0; i < MP3INDEX_MAX_ENTRIES; i++) {
+        free(g_entries[i].path);
+        g_entries[i].path = NULL;
+    }
+}
+
+bool mp3index_lookup(const char *path, Mp3Toc *toc) {
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+
+    pthread_mutex_lock(&g_mutex);
+    IndexEntry *e = find_entry(path);
+    bool hit = e && e->size == (int64_t)st.st_size && e->mtime == (int64_t)st.st_mtime;
+    if (hit) *toc = e->toc;
+    pthread_mutex_unlock(&g_mutex);
+
+    return hit;
+}
+
+void mp3index_request(const char *path) {
+    if (!g_thread_running) return;
+
+    pthread_mutex_lock(&g_mutex);
+    strncpy(g_request, path, sizeof(g_request) - 1);
+    g_request[sizeof(g_request) - 1] = '\0';
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+}
@@ -0,0 +1,43 @@
+/**
+ * MP3 Index - Background frame scans with a persistent cache
+ *
+ * MP3s without a Xing/Info TOC (VBR rips from older encoders, most
+ * podcasts) only give a bitrate estimate up front. The index walks such a
+ * file's frames on a worker thread once, then remembers the exact duration
+ * and seek table keyed by path, size and mtime.
+ */
+
+#ifndef MP3INDEX_H
+#define MP3INDEX_H
+
+#include <stdbool.h>
+#include "tags.h"
+
+/**
+ * Load the saved cache and start the scan thread
+ * Call after state_init() (cache lives in the data directory).
+ * @return 0 on success, -1 if the thread could not start
+ */
+int mp3index_init(void);
+
+/**
+ * Stop the scan thread (cancelling a scan in progress)
+ */
+void mp3index_cleanup(void);
+
+/**
+ * Look up a cached scan
+ * @param path MP3 file path
+ * @param toc Output: exact seek table
+ * @return true if the file was scanned and hasn't changed since
+ */
+bool mp3index_lookup(const char *path, Mp3Toc *toc);
+
+/**
+ * Scan a file in the background (replaces a request not yet started)
+ * Poll mp3index_lookup() for the result.
+ * @param path MP3 file path
+ */
+void mp3index_request(const char *path);
+
+#endif // MP3INDEX_H
@@ -0,0 +1,149 @@
+/**
+ * Perf HUD Implementation
+ *
+ * A ring of per-pass samples, written and summarized on the main thread
+ * only. Percentiles sort a copy of the drawn frames (at most
+ * PERFHUD_SAMPLES), which is cheap at the overlay's refresh rate; the
+ * resident size is read from /proc/self/statm at most once a second.
+ */
+
+#include "perfhud.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RSS_REFRESH_MS 1000
+
+/**
+ * One main loop pass
+ */
+typedef struct {
+    uint32_t update_us;
+    uint32_t render_us;        // 0: nothing drawn
+    Uint32 ticks;              // SDL_GetTicks() at record time
+} PassSample;
+
+static bool g_visible = false;
+static PassSample g_samples[PERFHUD_SAMPLES];
+static int g_sample_count = 0;
+static int g_sample_next = 0;
+static int g_target_ms = 0;
+
+static long g_rss_kb = -1;
+static Uint32 g_rss_read_at = 0;
+static bool g_rss_valid = false;
+
+/**
+ * Clear the recorded passes
+ */
+static void reset_samples(void) {
+    g_sample_count = 0;
+    g_sample_next = 0;
+}
+
+void perfhud_init(void) {
+    const char *env = getenv(PERFHUD_ENV);
+    g_visible = env && env[0] && strcmp(env, "0") != 0;
+    if (g_visible) printf("[HUD] Enabled by %s\n", PERFHUD_ENV);
+}
+
+void perfhud_toggle(void) {
+    g_visible = !g_visible;
+    reset_samples();
+    printf("[HUD] %s\n", g_visible ? "Shown" : "Hidden");
+}
+
+bool perfhud_is_visible(void) {
+    return g_visible;
+}
+
+uint64_t perfhud_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+void perfhud_record(uint32_t update_us, uint32_t render_us, int target_ms) {
+    if (!g_visible) return;
+
+    PassSample *s = &g_samples[g_sample_next];
+    s->update_us = update_us;
+    s->render_us = render_us;
+    s->ticks = SDL_GetTicks();
+    g_sample_next = (g_sample_next + 1) % PERFHUD_SAMPLES;
+    if (g_sample_count < PERFHUD_SAMPLES) g_sample_count++;
+    g_target_ms = target_ms;
+}
+
+/**
+ * qsort comparator for uint32_t
+ */
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Nearest-rank percentile of a sorted array, in milliseconds
+ */
+static float percentile_ms(const uint32_t *sorted, int count, int pct) {
+    if (count == 0) return 0.0f;
+    int rank = (count * pct + 99) / 100;
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1] / 1000.0f;
+}
+
+/**
+ * Resident set size from /proc/self/statm (second field, in pages)
+ */
+static long read_rss_kb(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return -1;
+    unsigned long size = 0, resident = 0;
+    int fields = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    if (fields != 2) return -1;
+    return (long)(resident * (unsigned long)sysconf(_SC_PAGESIZE) / 1024);
+}
+
+void perfhud_get_stats(PerfHudStats *out) {
+    memset(out, 0, sizeof(*out));
+
+    uint32_t frame_us[PERFHUD_SAMPLES];
+    uint64_t update_total = 0, render_total = 0;
+    Uint32 now = SDL_GetTicks();
+    for (int i = 0; i < g_sample_count; i++) {
+        const PassSample *s = &g_samples[i];
+        update_total += s->update_us;
+        if (now - s->ticks < 1000) out->passes_per_sec++;
+        if (s->render_us == 0) continue;
+
+        frame_us[out->frames++] = s->update_us + s->render_us;
+        render_total += s->render_us;
+        if (now - s->ticks < 1000) out->drawn_per_sec++;
+    }
+
+    if (out->frames > 0) {
+        qsort(frame_us, (size_t)out->frames, sizeof(frame_us[0]), compare_u32);
+        out->frame_p50_ms = percentile_ms(frame_us, out->frames, 50);
+        out->frame_p95_ms = percentile_ms(frame_us, out->frames, 95);
+        out->frame_p99_ms = percentile_ms(frame_us, out->frames, 99);
+        out->frame_max_ms = frame_us[out->frames - 1] / 1000.0f;
+        out->render_avg_ms = render_total / 1000.0f / out->frames;
+    }
+    if (g_sample_count > 0) {
+        out->update_avg_ms = update_total / 1000.0f / g_sample_count;
+    }
+    out->target_ms = g_target_ms;
+
+    if (!g_rss_valid || now - g_rss_read_at >= RSS_REFRESH_MS) {
+        g_rss_kb = read_rss_kb();
+        g_rss_read_at = now;
+        g_rss_valid = true;
+    }
+    out->rss_kb = g_rss_kb;
+}
@@ -0,0 +1,78 @@
+/**
+ * Perf HUD - Per-frame counters for the on-screen debug overlay
+ *
+ * The main loop reports how long each pass spent in input + update and in
+ * rendering; this keeps the last PERFHUD_SAMPLES passes and turns them into
+ * percentiles and rates. ui.c draws the overlay (toggled with Start+Select,
+ * or on from launch with MONO_HUD=1) from these and the other modules'
+ * counters. Nothing is recorded while the overlay is hidden.
+ */
+
+#ifndef PERFHUD_H
+#define PERFHUD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Main loop passes kept
+#define PERFHUD_SAMPLES 128
+
+// Overlay refresh interval (it redraws tracked screens on its own)
+#define PERFHUD_REFRESH_MS 500
+
+// Environment variable that shows the overlay from launch
+#define PERFHUD_ENV "MONO_HUD"
+
+/**
+ * Summary of the recorded passes
+ */
+typedef struct {
+    int frames;                 // Drawn frames in the window
+    float frame_p50_ms;         // Update + render of drawn frames
+    float frame_p95_ms;
+    float frame_p99_ms;
+    float frame_max_ms;
+    float update_avg_ms;        // Input + update, all passes
+    float render_avg_ms;        // Render, drawn frames
+    int drawn_per_sec;          // Drawn frames in the last second
+    int passes_per_sec;         // Loop passes in the last second
+    int target_ms;              // Frame budget of the latest pass
+    long rss_kb;                // Resident memory (/proc/self/statm), -1 if unknown
+} PerfHudStats;
+
+/**
+ * Read MONO_HUD (call once at startup)
+ */
+void perfhud_init(void);
+
+/**
+ * Show or hide the overlay (clears the samples when shown)
+ */
+void perfhud_toggle(void);
+
+/**
+ * Check whether the overlay is shown
+ */
+bool perfhud_is_visible(void);
+
+/**
+ * Monotonic clock for the loop timings
+ * @return Microseconds
+ */
+uint64_t perfhud_now_us(void);
+
+/**
+ * Record one main loop pass (ignored while hidden)
+ * @param update_us Time in input handling and update()
+ * @param render_us Time in render(), 0 if nothing was drawn
+ * @param target_ms Frame budget for this pass
+ */
+void perfhud_record(uint32_t update_us, uint32_t render_us, int target_ms);
+
+/**
+ * Summarize the recorded passes
+ * @param out Output
+ */
+void perfhud_get_stats(PerfHudStats *out);
+
+#endif // PERFHUD_H
@@ -0,0 +1,291 @@
+/**
+ * Persist Implementation
+ *
+ * A small FIFO of pending jobs, one per path. A new write to a queued path
+ * replaces its data and moves it to the back, so a snapshot queued after a
+ * journal append is still written after it. Threading follows preload.c:
+ * one worker, pthread mutex/cond.
+ */
+
+#include "persist.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define PERSIST_MAX_JOBS 16
+#define PERSIST_MAX_PATH 512
+
+// Saves of the same file within this window become one write
+#define PERSIST_COALESCE_MS 500
+
+/**
+ * One pending write
+ */
+typedef struct {
+    bool used;
+    bool append;                    // Append instead of replacing the file
+    char path[PERSIST_MAX_PATH];
+    char *data;
+    size_t size;
+    uint64_t due_ms;                // Written once this passes (or on flush)
+    uint32_t seq;                   // Queue order
+} PersistJob;
+
+static PersistJob g_jobs[PERSIST_MAX_JOBS];
+static uint32_t g_next_seq = 0;
+
+static pthread_t g_thread;
+static bool g_thread_running = false;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;       // Work queued
+static pthread_cond_t g_idle_cond = PTHREAD_COND_INITIALIZER;  // Queue drained
+static bool g_flush_requested = false;
+static bool g_busy = false;                 // A job is being written
+static bool g_shutdown = false;
+
+/**
+ * Wall clock in milliseconds (matches pthread_cond_timedwait's clock)
+ */
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/**
+ * Replace a file via temp file + fsync + rename
+ */
+static bool write_atomic(const char *path, const char *data, size_t size) {
+    char tmp_path[PERSIST_MAX_PATH + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return false;
+
+    bool ok = (size == 0 || fwrite(data, 1, size, f) == size) &&
+              fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(tmp_path, path) != 0) {
+        remove(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Append to a file and sync it
+ */
+static bool write_append(const char *path, const char *data, size_t size) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = write(fd, data + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += (size_t)n;
+    }
+    bool ok = done == size && fdatasync(fd) == 0;
+    return (close(fd) == 0) && ok;
+}
+
+/**
+ * Oldest queued job (caller holds g_mutex)
+ */
+static PersistJob* oldest_job(void) {
+    PersistJob *oldest = NULL;
+    for (int i = 0; i < PERSIST_MAX_JOBS; i++) {
+        if (g_jobs[i].used && (!oldest || (int32_t)(g_jobs[i].seq - oldest->seq) < 0)) {
+            oldest = &g_jobs[i];
+        }
+    }
+    return oldest;
+}
+
+/**
+ * Take a job off the queue and write it
+ * Called with g_mutex held; drops it during the I/O.
+ */
+static void run_job(PersistJob *job) {
+    PersistJob work = *job;
+    job->used = false;
+    job->data = NULL;
+    g_busy = true;
+    pthread_mutex_unlock(&g_mutex);
+
+    bool ok = work.append ? write_append(work.path, work.data, work.size)
+                          : write_atomic(work.path, work.data, work.size);
+    if (!ok) {
+        fprintf(stderr, "[PERSIST] Failed to write %s\n", work.path);
+    }
+    free(work.data);
+
+    pthread_mutex_lock(&g_mutex);
+    g_busy = false;
+}
+
+/**
+ * Write every queued job on the calling thread (no writer running)
+ */
+static void drain_sync(void) {
+    pthread_mutex_lock(&g_mutex);
+    PersistJob *job;
+    while (!g_busy && (job = oldest_job()) != NULL) {
+        run_job(job);
+    }
+    pthread_mutex_unlock(&g_mutex);
+}
+
+/**
+ * Writer thread: write jobs in queue order once they are due
+ */
+static void* persist_thread_func(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_mutex);
+    while (true) {
+        PersistJob *job = oldest_job();
+        if (!job) {
+            g_flush_requested = false;
+            pthread_cond_broadcast(&g_idle_cond);
+            if (g_shutdown) break;
+            pthread_cond_wait(&g_cond, &g_mutex);
+            continue;
+        }
+
+        if (!g_flush_requested && !g_shutdown && job->due_ms > now_ms()) {
+            struct timespec until = {
+                .tv_sec = (time_t)(job->due_ms / 1000),
+                .tv_nsec = (long)(job->due_ms % 1000) * 1000000
+            };
+            pthread_cond_timedwait(&g_cond, &g_mutex, &until);
+            continue;
+        }
+
+        run_job(job);
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return NULL;
+}
+
+/**
+ * Queue a write or append
+ */
+static bool enqueue(const char *path, const void *data, size_t size, bool append) {
+    if (!path || !path[0] || strlen(path) >= PERSIST_MAX_PATH || (size && !data)) return false;
+
+    pthread_mutex_lock(&g_mutex);
+
+    PersistJob *job = NULL;
+    PersistJob *free_slot = NULL;
+    for (int i = 0; i < PERSIST_MAX_JOBS; i++) {
+        if (g_jobs[i].used && strcmp(g_jobs[i].path, path) == 0) {
+            job = &g_jobs[i];
+            break;
+        }
+        if (!g_jobs[i].used && !free_slot) free_slot = &g_jobs[i];
+    }
+
+    bool ok = true;
+    if (job && append) {
+        // Extend whatever is pending for this file
+        char *grown = realloc(job->data, job->size + size + 1);
+        if (grown) {
+            memcpy(grown + job->size, data, size);
+            job->data = grown;
+            job->size += size;
+        }
+        ok = grown != NULL;
+    } else {
+        char *copy = malloc(size + 1);
+        if (!copy || (!job && !free_slot)) {
+            free(copy);
+            ok = false;
+        } else {
+            memcpy(copy, data, size);
+            if (job) {
+                // New contents supersede the pending ones; keep the first
+                // deadline so constant saves still get written
+                free(job->data);
+            } else {
+                job = free_slot;
+                job->used = true;
+                strcpy(job->path, path);
+                job->due_ms = now_ms() + PERSIST_COALESCE_MS;
+            }
+            job->append = append;
+            job->data = copy;
+            job->size = size;
+            job->seq = g_next_seq++;
+        }
+    }
+
+    if (ok) pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+
+    if (!ok) {
+        fprintf(stderr, "[PERSIST] Queue full, dropped write to %s\n", path);
+    } else if (!g_thread_running) {
+        drain_sync();
+    }
+    return ok;
+}
+
+int persist_init(void) {
+    if (g_thread_running) return 0;
+
+    g_shutdown = false;
+    if (pthread_create(&g_thread, NULL, persist_thread_func, NULL) != 0) {
+        fprintf(stderr, "[PERSIST] Failed to create writer thread\n");
+        return -1;
+    }
+    g_thread_running = true;
+    return 0;
+}
+
+void persist_cleanup(void) {
+    if (g_thread_running) {
+        pthread_mutex_lock(&g_mutex);
+        g_shutdown = true;
+        pthread_cond_signal(&g_cond);
+        pthread_mutex_unlock(&g_mutex);
+        pthread_join(g_thread, NULL);
+        g_thread_running = false;
+    }
+
+    // Anything queued after the thread stopped
+    drain_sync();
+}
+
+bool persist_write(const char *path, const void *data, size_t size) {
+    return enqueue(path, data, size, false);
+}
+
+bool persist_append(const char *path, const void *data, size_t size) {
+    return enqueue(path, data, size, true);
+}
+
+void persist_flush(void) {
+    if (!g_thread_running) {
+        drain_sync();
+        return;
+    }
+
+    pthread_mutex_lock(&g_mutex);
+    g_flush_requested = true;
+    pthread_cond_signal(&g_cond);
+    while (oldest_job() || g_busy) {
+        pthread_cond_wait(&g_idle_cond, &g_mutex);
+    }
+    pthread_mutex_unlock(&g_mutex);
+}
@@ -0,0 +1,55 @@
+/**
+ * Persist - Background writer for settings and caches
+ *
+ * Callers hand over the new contents of a file and return immediately; a
+ * worker thread writes it (temp file + fsync + rename) after a short
+ * coalescing window, so repeated saves of the same file become one write
+ * and the frame loop never waits on the SD card. Appends (journals) are
+ * queued the same way and written in order.
+ */
+
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Start the writer thread
+ * Writes queued before this (or if it fails) are done synchronously.
+ * @return 0 on success, -1 if the thread could not start
+ */
+int persist_init(void);
+
+/**
+ * Write everything pending and stop the writer thread
+ */
+void persist_cleanup(void);
+
+/**
+ * Replace a file's contents atomically (in the background)
+ * Replaces any write to the same path that hasn't happened yet.
+ * @param path Destination file
+ * @param data Contents (copied)
+ * @param size Length of data
+ * @return false if out of memory or queue slots (nothing queued)
+ */
+bool persist_write(const char *path, const void *data, size_t size);
+
+/**
+ * Append to a file (in the background, synced when written)
+ * Appends to a pending persist_write() of the same path extend it.
+ * @param path Destination file
+ * @param data Bytes to append (copied)
+ * @param size Length of data
+ * @return false if out of memory or queue slots (nothing queued)
+ */
+bool persist_append(const char *path, const void *data, size_t size);
+
+/**
+ * Write everything pending now and wait for it
+ * Call before suspend or anything else that may cut power.
+ */
+void persist_flush(void);
+
+#endif // PERSIST_H
@@ -1,33 +1,78 @@
 /**
  * Position Persistence Implementation
  *
- * Stores playback positions in a simple JSON file.
- * Uses a hash-based approach for quick lookups.
+ * Positions live in a snapshot (positions.json) plus an append-only journal
+ * (positions.log). Each change appends one short line to the journal
+ * (synced by the persist writer), so a regular save is a small sequential
+ * write that survives power loss. The snapshot is rewritten only when the
+ * journal grows past a limit, and at exit. Lookups go through an
+ * open-addressing hash table over the entry array.
+ *
+ * Journal line: "<seconds>\t<path>\n", 0 seconds means cleared. A torn last
+ * line (power cut mid-write) has no newline and is ignored on replay.
  */
 
 #include "positions.h"
 #include "state.h"
+#include "persist.h"
+#include "cJSON.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 // Maximum number of tracked positions
 #define MAX_POSITIONS 500
 
+// Hash buckets (power of two, kept under 50% load)
+#define POSITION_BUCKETS 1024
+
+// Rewrite the snapshot once the journal holds this many records
+#define JOURNAL_COMPACT_RECORDS 256
+
 // Minimum position to save (don't save if < 5 seconds)
 #define MIN_POSITION_SEC 5
 
 // Position entry
 typedef struct {
-    char path[512];
+    char *path;
+    uint32_t hash;
     int position_sec;
 } PositionEntry;
 
-// Position storage
+// Position storage, oldest first
 static PositionEntry g_positions[MAX_POSITIONS];
 static int g_position_count = 0;
+static int16_t g_buckets[POSITION_BUCKETS];  // Entry index + 1, 0 = empty
 static char g_positions_path[512] = {0};
-static bool g_dirty = false;  // Track if changes need saving
+static char g_journal_path[512] = {0};
+static int g_journal_records = 0;
+static bool g_dirty = false;  // Snapshot is behind the journal
+
+/**
+ * FNV-1a hash of a path
+ */
+static uint32_t hash_path(const char *path) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)path; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Rebuild the hash table from the entry array
+ * Needed after entries shift (clear, eviction); both are rare.
+ */
+static void rebuild_buckets(void) {
+    memset(g_buckets, 0, sizeof(g_buckets));
+    for (int i = 0; i < g_position_count; i++) {
+        uint32_t b = g_positions[i].hash & (POSITION_BUCKETS - 1);
+        while (g_buckets[b]) b = (b + 1) & (POSITION_BUCKETS - 1);
+        g_buckets[b] = (int16_t)(i + 1);
+    }
+}
 
 /**
  * Find position entry by path
@@ -36,16 +81,73 @@ static bool g_dirty = false;  // Track if changes need saving
 static int find_position(const char *path) {
     if (!path || !path[0]) return -1;
 
-    for (int i = 0; i < g_position_count; i++) {
-        if (strcmp(g_positions[i].path, path) == 0) {
-            return i;
+    uint32_t hash = hash_path(path);
+    uint32_t b = hash & (POSITION_BUCKETS - 1);
+    while (g_buckets[b]) {
+        int idx = g_buckets[b] - 1;
+        if (g_positions[idx].hash == hash && strcmp(g_positions[idx].path, path) == 0) {
+            return idx;
         }
+        b = (b + 1) & (POSITION_BUCKETS - 1);
     }
     return -1;
 }
 
+/**
+ * Remove an entry, keeping the rest in order
+ */
+static void remove_entry(int idx) {
+    free(g_positions[idx].path);
+    if (idx < g_position_count - 1) {
+        memmove(&g_positions[idx], &g_positions[idx + 1],
+                (g_position_count - idx - 1) * sizeof(PositionEntry));
+    }
+    g_position_count--;
+    rebuild_buckets();
+}
+
+/**
+ * Set an entry in memory (no journaling)
+ * @return true if anything changed
+ */
+static bool apply_position(const char *path, int position_sec) {
+    int idx = find_position(path);
+
+    if (position_sec <= 0) {
+        if (idx < 0) return false;
+        remove_entry(idx);
+        return true;
+    }
+
+    if (idx >= 0) {
+        if (g_positions[idx].position_sec == position_sec) return false;
+        g_positions[idx].position_sec = position_sec;
+        return true;
+    }
+
+    char *copy = strdup(path);
+    if (!copy) return false;
+
+    // Storage full - drop the oldest entry
+    if (g_position_count >= MAX_POSITIONS) {
+        remove_entry(0);
+    }
+
+    PositionEntry *e = &g_positions[g_position_count];
+    e->path = copy;
+    e->hash = hash_path(path);
+    e->position_sec = position_sec;
+
+    uint32_t b = e->hash & (POSITION_BUCKETS - 1);
+    while (g_buckets[b]) b = (b + 1) & (POSITION_BUCKETS - 1);
+    g_buckets[b] = (int16_t)(g_position_count + 1);
+    g_position_count++;
+    return true;
+}
+
 /**
  * Simple JSON string extraction
+ * Fallback for snapshots written before paths were escaped.
  */
 static bool extract_json_entry(const char *json, int *offset, char *path, size_t path_size, int *position) {
     const char *p = json + *offset;
@@ -81,67 +183,169 @@ static bool extract_json_entry(const char *json, int *offset, char *path, size_t
     return true;
 }
 
-int positions_init(void) {
-    // Build positions file path
-    const char *data_dir = state_get_data_dir();
-    if (!data_dir || !data_dir[0]) {
-        fprintf(stderr, "[POSITIONS] No data directory available\n");
-        return -1;
-    }
-
-    snprintf(g_positions_path, sizeof(g_positions_path), "%s/positions.json", data_dir);
-
-    // Load existing positions
-    FILE *f = fopen(g_positions_path, "r");
-    if (!f) {
-        printf("[POSITIONS] No saved positions found\n");
-        return 0;
-    }
+/**
+ * Read a whole file into a NUL-terminated buffer
+ * @return Buffer (caller frees) or NULL if missing/empty/too large
+ */
+static char* read_file(const char *path, long *out_size) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
 
-    // Read entire file
     fseek(f, 0, SEEK_END);
     long size = ftell(f);
     fseek(f, 0, SEEK_SET);
 
     if (size <= 0 || size > 1024 * 1024) {  // Max 1MB
         fclose(f);
-        return 0;
+        return NULL;
     }
 
-    char *json = malloc(size + 1);
-    if (!json) {
+    char *data = malloc(size + 1);
+    if (!data) {
         fclose(f);
-        return -1;
+        return NULL;
     }
 
-    size_t read_size = fread(json, 1, size, f);
+    size_t read_size = fread(data, 1, size, f);
     fclose(f);
 
     if (read_size != (size_t)size) {
-        free(json);
-        return -1;
+        free(data);
+        return NULL;
     }
-    json[size] = '\0';
-
-    // Parse entries
-    int offset = 0;
-    char path[512];
-    int position;
+    data[size] = '\0';
+    *out_size = size;
+    return data;
+}
 
-    while (g_position_count < MAX_POSITIONS) {
-        if (!extract_json_entry(json, &offset, path, sizeof(path), &position)) {
-            break;
+/**
+ * Load the snapshot
+ */
+static void load_snapshot(void) {
+    long size;
+    char *json = read_file(g_positions_path, &size);
+    if (!json) return;
+
+    cJSON *root = cJSON_Parse(json);
+    if (cJSON_IsObject(root)) {
+        cJSON *item;
+        cJSON_ArrayForEach(item, root) {
+            if (item->string && item->string[0] && cJSON_IsNumber(item)) {
+                apply_position(item->string, item->valueint);
+            }
         }
+    } else {
+        // Older snapshot with unescaped paths
+        int offset = 0;
+        char path[512];
+        int position;
+        while (extract_json_entry(json, &offset, path, sizeof(path), &position)) {
+            if (path[0] && position > 0) {
+                apply_position(path, position);
+            }
+        }
+    }
 
-        if (path[0] && position > 0) {
-            strncpy(g_positions[g_position_count].path, path, sizeof(g_positions[0].path) - 1);
-            g_positions[g_position_count].position_sec = position;
-            g_position_count++;
+    cJSON_Delete(root);
+    free(json);
+}
+
+/**
+ * Replay the journal on top of the snapshot
+ */
+static void replay_journal(void) {
+    long size;
+    char *log = read_file(g_journal_path, &size);
+    if (!log) return;
+
+    char *line = log;
+    char *end;
+    while ((end = strchr(line, '\n')) != NULL) {
+        *end = '\0';
+        char *tab = strchr(line, '\t');
+        if (tab && tab[1]) {
+            apply_position(tab + 1, atoi(line));
+            g_journal_records++;
         }
+        line = end + 1;
+    }
+
+    free(log);
+    if (g_journal_records > 0) {
+        g_dirty = true;
+    }
+}
+
+/**
+ * Queue the snapshot and an empty journal
+ * The writer keeps queue order, so the journal is only emptied once the
+ * snapshot is on disk; replaying a journal that outlived a crash on top of
+ * the new snapshot is harmless.
+ */
+static void compact(void) {
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return;
+    for (int i = 0; i < g_position_count; i++) {
+        cJSON_AddNumberToObject(root, g_positions[i].path, g_positions[i].position_sec);
     }
+    char *json = cJSON_Print(root);
+    cJSON_Delete(root);
+    if (!json) return;
 
+    bool ok = persist_write(g_positions_path, json, strlen(json)) &&
+              persist_write(g_journal_path, "", 0);
     free(json);
-    printf("[POSITIONS] Loaded %d saved positions\n", g_position_count);
+    if (!ok) return;
+
+    g_journal_records = 0;
+    g_dirty = false;
+    printf("[POSITIONS] Saved %d positions\n", g_position_count);
+}
+
+/**
+ * Append one change to the journal
+ */
+static void journal_append(const char *path, int position_sec) {
+    if (!g_journal_path[0]) return;
+    g_dirty = true;
+
+    // Paths with newlines can't be journaled; snapshot them instead
+    if (strchr(path, '\n')) {
+        compact();
+        return;
+    }
+
+    char line[600];
+    int len = snprintf(line, sizeof(line), "%d\t%s\n", position_sec, path);
+    if (len <= 0 || len >= (int)sizeof(line)) return;
+
+    persist_append(g_journal_path, line, (size_t)len);
+
+    if (++g_journal_records >= JOURNAL_COMPACT_RECORDS) {
+        compact();
+    }
+}
+
+int positions_init(void) {
+    // Build positions file path
+    const char *data_dir = state_get_data_dir();
+    if (!data_dir || !data_dir[0]) {
+        fprintf(stderr, "[POSITIONS] No data directory available\n");
+        return -1;
+    }
+
+    snprintf(g_positions_path, sizeof(g_positions_path), "%s/positions.json", data_dir);
+    snprintf(g_journal_path, sizeof(g_journal_path), "%s/positions.log", data_dir);
+
+    load_snapshot();
+    replay_journal();
+
+    if (g_position_count == 0) {
+        printf("[POSITIONS] No saved positions found\n");
+    } else {
+        printf("[POSITIONS] Loaded %d saved positions (%d journaled)\n",
+               g_position_count, g_journal_records);
+    }
     return 0;
 }
 
@@ -154,34 +358,12 @@ void positions_set(const char *path, int position_sec) {
         return;
     }
 
-    int idx = find_position(path);
-
-    if (idx >= 0) {
-        // Update existing
-        if (g_positions[idx].position_sec != position_sec) {
-            g_positions[idx].position_sec = position_sec;
-            g_dirty = true;
-        }
-    } else {
-        // Add new entry
-        if (g_position_count < MAX_POSITIONS) {
-            strncpy(g_positions[g_position_count].path, path, sizeof(g_positions[0].path) - 1);
-            g_positions[g_position_count].position_sec = position_sec;
-            g_position_count++;
-            g_dirty = true;
-        } else {
-            // Storage full - remove oldest entry (index 0) and shift
-            memmove(&g_positions[0], &g_positions[1], (MAX_POSITIONS - 1) * sizeof(PositionEntry));
-            strncpy(g_positions[MAX_POSITIONS - 1].path, path, sizeof(g_positions[0].path) - 1);
-            g_positions[MAX_POSITIONS - 1].position_sec = position_sec;
-            g_dirty = true;
-        }
+    if (apply_position(path, position_sec)) {
+        journal_append(path, position_sec);
     }
 }
 
 int positions_get(const char *path) {
-    if (!path || !path[0]) return 0;
-
     int idx = find_position(path);
     if (idx >= 0) {
         return g_positions[idx].position_sec;
@@ -192,45 +374,23 @@ int positions_get(const char *path) {
 void positions_clear(const char *path) {
     if (!path || !path[0]) return;
 
-    int idx = find_position(path);
-    if (idx >= 0) {
-        // Remove by shifting remaining entries
-        if (idx < g_position_count - 1) {
-            memmove(&g_positions[idx], &g_positions[idx + 1],
-                    (g_position_count - idx - 1) * sizeof(PositionEntry));
-        }
-        g_position_count--;
-        g_dirty = true;
+    if (apply_position(path, 0)) {
+        journal_append(path, 0);
     }
 }
 
 void positions_save(void) {
-    if (!g_dirty || g_position_count == 0) return;
-
-    FILE *f = fopen(g_positions_path, "w");
-    if (!f) {
-        fprintf(stderr, "[POSITIONS] Failed to save positions\n");
-        return;
-    }
-
-    fprintf(f, "{\n");
-    for (int i = 0; i < g_position_count; i++) {
-        // Escape path for JSON
-        fprintf(f, "  \"%s\": %d%s\n",
-                g_positions[i].path,
-                g_positions[i].position_sec,
-                (i < g_position_count - 1) ? "," : "");
-    }
-    fprintf(f, "}\n");
-
-    fclose(f);
-    g_dirty = false;
-    printf("[POSITIONS] Saved %d positions\n", g_position_count);
+    if (!g_dirty || !g_positions_path[0]) return;
+    compact();
 }
 
 void positions_cleanup(void) {
     positions_save();
+    for (int i = 0; i < g_position_count; i++) {
+        free(g_positions[i].path);
+    }
     g_position_count = 0;
+    memset(g_buckets, 0, sizeof(g_buckets));
 }
 
 int positions_get_count(void) {
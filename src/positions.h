@@ -21,6 +21,7 @@ int positions_init(void);
 
 /**
  * Save position for a file
+ * The change is appended to the on-disk journal right away.
  * @param path Full path to the audio file
  * @param position_sec Position in seconds
  */
@@ -40,8 +41,8 @@ int positions_get(const char *path);
 void positions_clear(const char *path);
 
 /**
- * Save all positions to disk
- * Call this before exit or periodically
+ * Rewrite the positions snapshot and empty the journal
+ * Not needed for durability (changes are journaled); called at exit.
  */
 void positions_save(void);
 
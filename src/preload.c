@@ -1,11 +1,15 @@
 /**
  * Audio Preloader Implementation
  *
- * Background thread decodes next track while current plays.
- * Follows same threading pattern as download_queue.c.
+ * Jobs on the shared pool (audio class) decode the next track while the
+ * current one plays. The result is handed over under g_mutex as soon as
+ * it is ready, without waiting for the main loop.
  */
 
 #include "preload.h"
+#include "wav.h"
+#include "jobs.h"
+#include "memgov.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
 #include <pthread.h>
@@ -21,21 +25,21 @@
 typedef enum {
     PRELOAD_IDLE,
     PRELOAD_LOADING,
-    PRELOAD_READY,
-    PRELOAD_CANCELLED
+    PRELOAD_READY
 } PreloadState;
 
-// Thread synchronization
-static pthread_t g_worker_thread;
+// Synchronization with the decode job
 static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
-static bool g_worker_running = false;
+static bool g_initialized = false;
 static bool g_shutdown = false;
+static JobId g_job = 0;
+static unsigned int g_generation = 0;      // Bumped per request; stale jobs drop their result
 
 // Current preload state
 static PreloadState g_state = PRELOAD_IDLE;
 static char g_request_path[512] = {0};
 static PreloadedTrack *g_ready_track = NULL;
+static size_t g_ram_budget = PRELOAD_DEFAULT_RAM_BUDGET;
 
 /**
  * Check if file has FLAC extension
@@ -47,10 +51,12 @@ static bool is_flac_file(const char *path) {
 }
 
 /**
- * Decode FLAC to WAV in memory (full file, not chunked)
- * For preloading, we decode the entire file since we have time
+ * Decode FLAC to WAV in memory within the RAM budget
+ * Tracks that fit are decoded whole. Longer tracks keep only the head
+ * (up to PRELOAD_HEAD_SECONDS) plus the open decoder, which audio.c
+ * streams from once the head has played.
  */
-static PreloadedTrack* decode_flac_full(const char *path) {
+static PreloadedTrack* decode_flac(const char *path, size_t ram_budget) {
     drflac *pFlac = drflac_open_file(path, NULL);
     if (!pFlac) {
         fprintf(stderr, "[PRELOAD] Failed to open FLAC: %s\n", path);
@@ -62,63 +68,36 @@ static PreloadedTrack* decode_flac_full(const char *path) {
     uint64_t total_frames = pFlac->totalPCMFrameCount;
     int duration_sec = (int)(total_frames / sample_rate);
 
-    // Allocate PCM buffer
-    size_t pcm_size = total_frames * channels * sizeof(int16_t);
-    int16_t *pcm_data = (int16_t *)malloc(pcm_size);
-    if (!pcm_data) {
-        fprintf(stderr, "[PRELOAD] Failed to allocate PCM buffer (%zu bytes)\n", pcm_size);
-        drflac_close(pFlac);
-        return NULL;
+    // Decide how much to keep resident
+    size_t frame_bytes = channels * sizeof(int16_t);
+    uint64_t budget_frames = ram_budget / frame_bytes;
+    bool fits = total_frames <= budget_frames;
+    uint64_t frames_to_decode = total_frames;
+    if (!fits) {
+        frames_to_decode = (uint64_t)PRELOAD_HEAD_SECONDS * sample_rate;
+        if (frames_to_decode > budget_frames) frames_to_decode = budget_frames;
     }
 
-    // Decode entire file
-    uint64_t frames_read = drflac_read_pcm_frames_s16(pFlac, total_frames, pcm_data);
-    drflac_close(pFlac);
-
-    if (frames_read == 0) {
-        free(pcm_data);
-        return NULL;
+    // Decode whole file or just the head, straight into the final WAV image
+    size_t wav_size = 0;
+    uint64_t frames_read = 0;
+    uint8_t *wav_data = wav_decode_flac(pFlac, frames_to_decode, &wav_size, &frames_read);
+    if (fits || frames_read < frames_to_decode) {
+        drflac_close(pFlac);
+        pFlac = NULL;
     }
 
-    // Build WAV in memory
-    size_t wav_size = 44 + (frames_read * channels * sizeof(int16_t));
-    uint8_t *wav_data = (uint8_t *)malloc(wav_size);
     if (!wav_data) {
-        free(pcm_data);
+        fprintf(stderr, "[PRELOAD] FLAC decode failed: %s\n", path);
+        if (pFlac) drflac_close(pFlac);
         return NULL;
     }
 
-    // WAV header
-    uint32_t data_size = (uint32_t)(frames_read * channels * sizeof(int16_t));
-    uint32_t file_size = 36 + data_size;
-    uint16_t block_align = channels * sizeof(int16_t);
-    uint32_t byte_rate = sample_rate * block_align;
-
-    memcpy(wav_data + 0, "RIFF", 4);
-    memcpy(wav_data + 4, &file_size, 4);
-    memcpy(wav_data + 8, "WAVE", 4);
-    memcpy(wav_data + 12, "fmt ", 4);
-    uint32_t fmt_size = 16;
-    memcpy(wav_data + 16, &fmt_size, 4);
-    uint16_t audio_format = 1;
-    memcpy(wav_data + 20, &audio_format, 2);
-    uint16_t num_channels = (uint16_t)channels;
-    memcpy(wav_data + 22, &num_channels, 2);
-    memcpy(wav_data + 24, &sample_rate, 4);
-    memcpy(wav_data + 28, &byte_rate, 4);
-    memcpy(wav_data + 32, &block_align, 2);
-    uint16_t bits_per_sample = 16;
-    memcpy(wav_data + 34, &bits_per_sample, 2);
-    memcpy(wav_data + 36, "data", 4);
-    memcpy(wav_data + 40, &data_size, 4);
-    memcpy(wav_data + 44, pcm_data, data_size);
-
-    free(pcm_data);
-
     // Create result
-    PreloadedTrack *track = (PreloadedTrack *)malloc(sizeof(PreloadedTrack));
+    PreloadedTrack *track = (PreloadedTrack *)calloc(1, sizeof(PreloadedTrack));
     if (!track) {
-        free(wav_data);
+        wav_release(wav_data);
+        if (pFlac) drflac_close(pFlac);
         return NULL;
     }
 
@@ -126,92 +105,168 @@ static PreloadedTrack* decode_flac_full(const char *path) {
     track->path[sizeof(track->path) - 1] = '\0';
     track->wav_data = wav_data;
     track->wav_size = wav_size;
+    track->flac_handle = pFlac;
     track->sample_rate = (int)sample_rate;
     track->channels = (int)channels;
     track->duration_sec = duration_sec;
     track->is_flac = true;
 
+    printf("[PRELOAD] FLAC %s: %zu KB resident (%d of %d sec)\n",
+           pFlac ? "head+stream" : "full", wav_size / 1024,
+           (int)(frames_read / sample_rate), duration_sec);
+
     return track;
 }
 
 /**
- * Worker thread function
+ * Read a compressed track ahead of its transition
+ * Files within the RAM budget are kept in memory so SDL_mixer decodes them
+ * without touching the SD card; larger ones have their head read once to
+ * warm the page cache. Tags and duration are probed either way.
  */
-static void* worker_func(void *arg) {
-    (void)arg;
-    printf("[PRELOAD] Worker thread started\n");
+static PreloadedTrack* preload_compressed(const char *path, size_t ram_budget) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "[PRELOAD] Failed to open: %s\n", path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (file_size <= 0) {
+        fclose(f);
+        return NULL;
+    }
 
-    while (1) {
-        pthread_mutex_lock(&g_mutex);
+    PreloadedTrack *track = (PreloadedTrack *)calloc(1, sizeof(PreloadedTrack));
+    if (!track) {
+        fclose(f);
+        return NULL;
+    }
+    strncpy(track->path, path, sizeof(track->path) - 1);
 
-        // Wait for work or shutdown
-        while (g_state != PRELOAD_LOADING && !g_shutdown) {
-            pthread_cond_wait(&g_cond, &g_mutex);
+    if ((size_t)file_size <= ram_budget) {
+        track->file_data = (uint8_t *)malloc((size_t)file_size);
+        if (track->file_data &&
+            fread(track->file_data, 1, (size_t)file_size, f) == (size_t)file_size) {
+            track->file_size = (size_t)file_size;
+        } else {
+            free(track->file_data);
+            track->file_data = NULL;
         }
+    }
 
-        if (g_shutdown) {
-            pthread_mutex_unlock(&g_mutex);
-            break;
+    if (!track->file_data) {
+        // Too big (or short read): just pull the head into the page cache
+        // Per call: two preload jobs can overlap while one winds down
+        const size_t chunk = 64 * 1024;
+        uint8_t *warm_buf = (uint8_t *)malloc(chunk);
+        size_t warmed = 0;
+        size_t n;
+        while (warm_buf && warmed < PRELOAD_WARM_BYTES &&
+               (n = fread(warm_buf, 1, chunk, f)) > 0) {
+            warmed += n;
         }
+        free(warm_buf);
+    }
+    fclose(f);
 
-        // Copy path to local variable
-        char path[512];
-        strncpy(path, g_request_path, sizeof(path) - 1);
-        path[sizeof(path) - 1] = '\0';
-
-        pthread_mutex_unlock(&g_mutex);
+    tags_probe_toc(path, &track->info, &track->toc);
+    track->duration_sec = track->info.duration_sec;
 
-        printf("[PRELOAD] Starting preload: %s\n", path);
+    printf("[PRELOAD] %s %s: %zu KB resident\n", audio_format_from_path(path),
+           track->file_data ? "full" : "warmed", track->file_size / 1024);
 
-        // Decode the file
-        PreloadedTrack *track = NULL;
+    return track;
+}
 
-        if (is_flac_file(path)) {
-            track = decode_flac_full(path);
-        } else {
-            // For MP3/OGG, create a minimal track struct
-            // SDL_mixer will handle loading, we just mark it as ready
-            track = (PreloadedTrack *)malloc(sizeof(PreloadedTrack));
-            if (track) {
-                memset(track, 0, sizeof(PreloadedTrack));
-                strncpy(track->path, path, sizeof(track->path) - 1);
-                track->is_flac = false;
-                // wav_data = NULL means use native SDL_mixer loading
-            }
-        }
+/**
+ * Preload request handed to a job
+ */
+typedef struct {
+    char path[512];
+    size_t ram_budget;
+    unsigned int generation;
+} PreloadJob;
 
-        // Check if cancelled during decode
-        pthread_mutex_lock(&g_mutex);
+/**
+ * Job: decode one requested track
+ */
+static void preload_job(void *arg, const volatile bool *cancel) {
+    PreloadJob *job = (PreloadJob *)arg;
+    const char *path = job->path;
+
+    printf("[PRELOAD] Starting preload: %s\n", path);
+
+    // Decode the file
+    PreloadedTrack *track = NULL;
+
+    if (*cancel) {
+        // Superseded before it started
+    } else if (is_flac_file(path)) {
+        track = decode_flac(path, job->ram_budget);
+    } else if (audio_format_from_path(path)[0]) {
+        // MP3/OGG/Opus/...: SDL_mixer decodes, we do the file I/O up front
+        track = preload_compressed(path, job->ram_budget);
+    }
 
-        if (g_state == PRELOAD_CANCELLED || g_shutdown) {
-            // Cancelled - discard result
-            if (track) {
-                if (track->wav_data) free(track->wav_data);
-                free(track);
-            }
-            g_state = PRELOAD_IDLE;
-            printf("[PRELOAD] Cancelled: %s\n", path);
-        } else if (track) {
-            // Success
-            if (g_ready_track) {
-                if (g_ready_track->wav_data) free(g_ready_track->wav_data);
-                free(g_ready_track);
-            }
-            g_ready_track = track;
-            g_state = PRELOAD_READY;
-            printf("[PRELOAD] Ready: %s (FLAC=%d, %d sec)\n",
-                   path, track->is_flac, track->duration_sec);
-        } else {
-            // Failed
-            g_state = PRELOAD_IDLE;
-            printf("[PRELOAD] Failed: %s\n", path);
-        }
+    // Check if cancelled during decode
+    pthread_mutex_lock(&g_mutex);
 
-        pthread_mutex_unlock(&g_mutex);
+    if (*cancel || g_shutdown || job->generation != g_generation) {
+        // Cancelled - discard result
+        preload_free_track(track);
+        if (job->generation == g_generation) g_state = PRELOAD_IDLE;
+        printf("[PRELOAD] Cancelled: %s\n", path);
+    } else if (track) {
+        // Success
+        preload_free_track(g_ready_track);
+        g_ready_track = track;
+        g_state = PRELOAD_READY;
+        printf("[PRELOAD] Ready: %s (FLAC=%d, %d sec)\n",
+               path, track->is_flac, track->duration_sec);
+    } else {
+        // Failed
+        g_state = PRELOAD_IDLE;
+        printf("[PRELOAD] Failed: %s\n", path);
     }
 
-    printf("[PRELOAD] Worker thread exiting\n");
-    return NULL;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+/**
+ * Job done: free the request (also reached for jobs dropped while queued)
+ */
+static void preload_job_done(void *arg, bool cancelled) {
+    (void)cancelled;
+    free(arg);
+}
+
+/**
+ * Memory held by the ready track
+ */
+static size_t preload_usage(void) {
+    pthread_mutex_lock(&g_mutex);
+    size_t bytes = g_ready_track ? g_ready_track->wav_size + g_ready_track->file_size : 0;
+    pthread_mutex_unlock(&g_mutex);
+    return bytes;
+}
+
+/**
+ * Memory governor budget: smaller budgets fall back to head-only preloads
+ */
+static void preload_budget(size_t budget, MemPressure level) {
+    (void)level;
+    preload_set_ram_budget(budget);
+}
+
+/**
+ * Memory governor budget for the WAV pool: drop idle buffers under pressure
+ */
+static void wav_pool_budget(size_t budget, MemPressure level) {
+    (void)budget;
+    if (level != MEM_PRESSURE_NONE) wav_pool_cleanup();
 }
 
 void preload_init(void) {
@@ -221,66 +276,73 @@ void preload_init(void) {
     g_request_path[0] = '\0';
     g_ready_track = NULL;
     g_shutdown = false;
+    g_initialized = true;
 
     pthread_mutex_unlock(&g_mutex);
 
-    // Start worker thread
-    if (!g_worker_running) {
-        if (pthread_create(&g_worker_thread, NULL, worker_func, NULL) == 0) {
-            g_worker_running = true;
-            printf("[PRELOAD] Initialized\n");
-        } else {
-            fprintf(stderr, "[PRELOAD] Failed to create worker thread\n");
-        }
-    }
+    memgov_register("preload", PRELOAD_DEFAULT_RAM_BUDGET, preload_usage, preload_budget);
+    memgov_register("wav_pool", 0, wav_pool_bytes, wav_pool_budget);
+
+    printf("[PRELOAD] Initialized\n");
 }
 
 void preload_cleanup(void) {
-    if (!g_worker_running) return;
+    if (!g_initialized) return;
 
     printf("[PRELOAD] Shutting down...\n");
 
+    // A decode still running drops its result (jobs_shutdown waits for it)
     pthread_mutex_lock(&g_mutex);
     g_shutdown = true;
-    pthread_cond_signal(&g_cond);
-    pthread_mutex_unlock(&g_mutex);
-
-    pthread_join(g_worker_thread, NULL);
-    g_worker_running = false;
+    JobId job = g_job;
+    g_job = 0;
 
     // Free any remaining track
-    if (g_ready_track) {
-        if (g_ready_track->wav_data) free(g_ready_track->wav_data);
-        free(g_ready_track);
-        g_ready_track = NULL;
-    }
+    preload_free_track(g_ready_track);
+    g_ready_track = NULL;
+    g_initialized = false;
+    pthread_mutex_unlock(&g_mutex);
+
+    jobs_cancel(job);
 
     printf("[PRELOAD] Shutdown complete\n");
 }
 
 void preload_start(const char *path) {
-    if (!path || !g_worker_running) return;
+    if (!path || !g_initialized) return;
+
+    PreloadJob *job = (PreloadJob *)calloc(1, sizeof(PreloadJob));
+    if (!job) return;
+    strncpy(job->path, path, sizeof(job->path) - 1);
 
     pthread_mutex_lock(&g_mutex);
 
     // Cancel any current operation
-    if (g_state == PRELOAD_LOADING) {
-        g_state = PRELOAD_CANCELLED;
-    }
+    JobId previous = g_job;
 
     // Free any ready track that wasn't consumed
-    if (g_ready_track) {
-        if (g_ready_track->wav_data) free(g_ready_track->wav_data);
-        free(g_ready_track);
-        g_ready_track = NULL;
-    }
+    preload_free_track(g_ready_track);
+    g_ready_track = NULL;
 
     // Start new preload
     strncpy(g_request_path, path, sizeof(g_request_path) - 1);
     g_request_path[sizeof(g_request_path) - 1] = '\0';
     g_state = PRELOAD_LOADING;
+    job->ram_budget = g_ram_budget;
+    job->generation = ++g_generation;
+    unsigned int generation = job->generation;
+
+    pthread_mutex_unlock(&g_mutex);
+
+    jobs_cancel(previous);
+    JobId id = jobs_submit(JOB_CLASS_AUDIO, "preload", preload_job, preload_job_done, job);
 
-    pthread_cond_signal(&g_cond);
+    pthread_mutex_lock(&g_mutex);
+    if (id == 0) {
+        free(job);  // Not queued
+        if (g_generation == generation) g_state = PRELOAD_IDLE;
+    }
+    g_job = id;
     pthread_mutex_unlock(&g_mutex);
 
     printf("[PRELOAD] Requested: %s\n", path);
@@ -289,19 +351,18 @@ void preload_start(const char *path) {
 void preload_cancel(void) {
     pthread_mutex_lock(&g_mutex);
 
-    if (g_state == PRELOAD_LOADING) {
-        g_state = PRELOAD_CANCELLED;
-    }
+    JobId job = g_job;
+    g_job = 0;
+    g_generation++;  // A decode in flight drops its result
 
-    if (g_ready_track) {
-        if (g_ready_track->wav_data) free(g_ready_track->wav_data);
-        free(g_ready_track);
-        g_ready_track = NULL;
-    }
+    preload_free_track(g_ready_track);
+    g_ready_track = NULL;
 
     g_state = PRELOAD_IDLE;
 
     pthread_mutex_unlock(&g_mutex);
+
+    jobs_cancel(job);
 }
 
 bool preload_is_ready(void) {
@@ -343,6 +404,15 @@ PreloadedTrack* preload_consume(const char *path) {
 
 void preload_free_track(PreloadedTrack *track) {
     if (!track) return;
-    if (track->wav_data) free(track->wav_data);
+    wav_release(track->wav_data);
+    if (track->flac_handle) drflac_close((drflac *)track->flac_handle);
+    free(track->file_data);
     free(track);
 }
+
+void preload_set_ram_budget(size_t bytes) {
+    pthread_mutex_lock(&g_mutex);
+    g_ram_budget = bytes;
+    pthread_mutex_unlock(&g_mutex);
+    printf("[PRELOAD] RAM budget: %zu KB\n", bytes / 1024);
+}
@@ -1,9 +1,13 @@
 /**
  * Audio Preloader - Background decoding for gapless playback
  *
- * Pre-decodes the next track in a background thread while the current
- * track plays. When track transition occurs, the pre-decoded audio
- * is immediately available, eliminating the 200-600ms gap.
+ * Pre-decodes the next track on the job pool (audio class) while the current
+ * track plays (FLAC), or reads the compressed file and its tags ahead of
+ * time for formats SDL_mixer decodes itself (MP3, OGG, Opus, ...). When
+ * the track transition occurs, the pre-decoded audio is immediately
+ * available, eliminating the 200-600ms gap.
+ * Memory is bounded by a RAM budget: long tracks keep only their first
+ * seconds decoded plus an open decoder that takes over after the head.
  */
 
 #ifndef PRELOAD_H
@@ -12,18 +16,34 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include "audio.h"
+#include "tags.h"
+
+// Default RAM allowed for one preloaded track's decoded audio (~47s of 44.1kHz stereo)
+#define PRELOAD_DEFAULT_RAM_BUDGET (8 * 1024 * 1024)
+
+// Seconds decoded ahead when a track exceeds the budget (rest is streamed)
+#define PRELOAD_HEAD_SECONDS 15
+
+// Bytes read ahead into the page cache for compressed tracks too big to keep in RAM
+#define PRELOAD_WARM_BYTES (256 * 1024)
 
 /**
  * Preloaded track data (decoded audio ready to play)
  */
 typedef struct {
     char path[512];           // Original file path
-    uint8_t *wav_data;        // WAV data in memory (for FLAC)
+    uint8_t *wav_data;        // WAV data in memory (for FLAC; whole track or head)
     size_t wav_size;          // Size of WAV data
+    void *flac_handle;        // Open drflac positioned after the head, or NULL if whole track
     int sample_rate;          // Sample rate
     int channels;             // Number of channels
     int duration_sec;         // Total duration in seconds
     bool is_flac;             // True if decoded from FLAC
+    uint8_t *file_data;       // Whole compressed file (non-FLAC), or NULL if only warmed
+    size_t file_size;         // Size of file_data
+    TrackInfo info;           // Tags and estimated duration probed by the worker (non-FLAC)
+    Mp3Toc toc;               // MP3 seek table probed with them
 } PreloadedTrack;
 
 /**
@@ -74,4 +94,12 @@ PreloadedTrack* preload_consume(const char *path);
  */
 void preload_free_track(PreloadedTrack *track);
 
+/**
+ * Set RAM budget for preloaded audio
+ * Tracks larger than the budget keep only their head decoded plus an
+ * open decoder handle. Applies to the next preload.
+ * @param bytes Maximum bytes of decoded PCM per preloaded track
+ */
+void preload_set_ram_budget(size_t bytes);
+
 #endif // PRELOAD_H
@@ -0,0 +1,229 @@
+/**
+ * Resample Implementation
+ *
+ * The rate ratio is reduced to L/M (44.1k <- 48k is 147/160). The filter
+ * bank holds L phases (at most RESAMPLE_MAX_PHASES; odd rate pairs take the
+ * nearest phase, the rate itself stays exact) of a Blackman-windowed sinc, cut off below the lower
+ * of the two Nyquist rates, in Q15 with every phase normalized to unity
+ * gain. Input is kept planar per channel so the taps line up with the
+ * history for an unstrided multiply-accumulate.
+ */
+
+#include "resample.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#define RESAMPLE_MAX_PHASES 1024     // Larger L picks the nearest of this many
+#define RESAMPLE_MAX_CHANNELS 8
+#define RESAMPLE_ROLLOFF 0.94        // Passband edge relative to the lower Nyquist
+
+struct Resampler {
+    int channels;
+    int taps;                        // Per phase, multiple of 8
+    int den;                         // L: input frame divided into this many steps
+    int step;                        // M: steps advanced per output frame
+    int phases;                      // Filters in the bank (L, or the cap)
+    int16_t *coefs;                  // phases * taps, Q15
+    int16_t *hist[RESAMPLE_MAX_CHANNELS];  // Planar input not yet consumed
+    int hist_frames;
+    int hist_capacity;
+    int pos;                         // First input frame under the filter
+    int phase;                       // Position inside the input frame (0..L-1)
+};
+
+/**
+ * Taps per phase for a quality setting
+ */
+static int quality_taps(ResampleQuality quality) {
+    switch (quality) {
+        case RESAMPLE_FAST: return 8;
+        case RESAMPLE_BEST: return 32;
+        default:            return 16;
+    }
+}
+
+static int gcd(int a, int b) {
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ * Fill the filter bank
+ * @param cutoff Cutoff in cycles per input sample (< 0.5)
+ */
+static void build_filters(Resampler *r, double cutoff) {
+    int half = r->taps / 2;
+    double *row = malloc(r->taps * sizeof(double));
+    if (!row) return;
+
+    for (int p = 0; p < r->phases; p++) {
+        double frac = (double)p / r->phases;
+        double sum = 0.0;
+        for (int k = 0; k < r->taps; k++) {
+            double t = k - half + 1 - frac;  // Distance from the output position
+            double x = 2.0 * cutoff * t;
+            double sinc = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double w = (t + half) / r->taps;  // Window position 0..1
+            double blackman = 0.42 - 0.5 * cos(2.0 * M_PI * w) + 0.08 * cos(4.0 * M_PI * w);
+            row[k] = sinc * blackman;
+            sum += row[k];
+        }
+        for (int k = 0; k < r->taps; k++) {
+            double c = row[k] / sum * 32768.0;
+            if (c > 32767.0) c = 32767.0;
+            if (c < -32768.0) c = -32768.0;
+            r->coefs[p * r->taps + k] = (int16_t)lrint(c);
+        }
+    }
+    free(row);
+}
+
+/**
+ * Sum of a[i] * b[i] over n samples (n is a multiple of 8)
+ */
+static int32_t dot_q15(const int16_t *a, const int16_t *b, int n) {
+#ifdef __ARM_NEON
+    int32x4_t acc = vdupq_n_s32(0);
+    for (int i = 0; i < n; i += 8) {
+        int16x8_t va = vld1q_s16(a + i);
+        int16x8_t vb = vld1q_s16(b + i);
+        acc = vmlal_s16(acc, vget_low_s16(va), vget_low_s16(vb));
+        acc = vmlal_s16(acc, vget_high_s16(va), vget_high_s16(vb));
+    }
+    int32x2_t pair = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+    return vget_lane_s32(vpadd_s32(pair, pair), 0);
+#else
+    int32_t acc = 0;
+    for (int i = 0; i < n; i++) acc += (int32_t)a[i] * b[i];
+    return acc;
+#endif
+}
+
+/**
+ * Make room for more planar input
+ */
+static int reserve_history(Resampler *r, int frames) {
+    if (frames <= r->hist_capacity) return 0;
+
+    int capacity = r->hist_capacity ? r->hist_capacity : 1024;
+    while (capacity < frames) capacity *= 2;
+    for (int c = 0; c < r->channels; c++) {
+        int16_t *grown = realloc(r->hist[c], capacity * sizeof(int16_t));
+        if (!grown) return -1;
+        r->hist[c] = grown;
+    }
+    r->hist_capacity = capacity;
+    return 0;
+}
+
+Resampler* resample_create(int in_rate, int out_rate, int channels, ResampleQuality quality) {
+    if (in_rate <= 0 || out_rate <= 0 || channels <= 0 || channels > RESAMPLE_MAX_CHANNELS) {
+        return NULL;
+    }
+
+    Resampler *r = calloc(1, sizeof(Resampler));
+    if (!r) return NULL;
+
+    int g = gcd(in_rate, out_rate);
+    r->den = out_rate / g;
+    r->step = in_rate / g;
+    r->phases = r->den < RESAMPLE_MAX_PHASES ? r->den : RESAMPLE_MAX_PHASES;
+    r->channels = channels;
+    r->taps = quality_taps(quality);
+
+    r->coefs = malloc((size_t)r->phases * r->taps * sizeof(int16_t));
+    if (!r->coefs || reserve_history(r, r->taps * 2) < 0) {
+        resample_destroy(r);
+        return NULL;
+    }
+
+    double ratio = (double)out_rate / in_rate;
+    build_filters(r, 0.5 * RESAMPLE_ROLLOFF * (ratio < 1.0 ? ratio : 1.0));
+    resample_reset(r);
+
+    printf("[RESAMPLE] %d -> %d Hz, %d ch, %d taps x %d phases\n",
+           in_rate, out_rate, channels, r->taps, r->phases);
+    return r;
+}
+
+void resample_destroy(Resampler *r) {
+    if (!r) return;
+    for (int c = 0; c < r->channels; c++) free(r->hist[c]);
+    free(r->coefs);
+    free(r);
+}
+
+int resample_max_output(const Resampler *r, int in_frames) {
+    int64_t in = (int64_t)in_frames + r->taps;
+    return (int)(in * r->den / r->step) + 2;
+}
+
+void resample_reset(Resampler *r) {
+    // Half a filter of silence, so the first output lines up with input 0
+    r->hist_frames = r->taps / 2 - 1;
+    for (int c = 0; c < r->channels; c++) {
+        memset(r->hist[c], 0, r->hist_frames * sizeof(int16_t));
+    }
+    r->pos = 0;
+    r->phase = 0;
+}
+
+int resample_process(Resampler *r, const int16_t *in, int in_frames, int16_t *out) {
+    if (in_frames > 0) {
+        if (reserve_history(r, r->hist_frames + in_frames) < 0) return 0;
+        for (int c = 0; c < r->channels; c++) {
+            int16_t *dst = r->hist[c] + r->hist_frames;
+            const int16_t *src = in + c;
+            for (int i = 0; i < in_frames; i++) {
+                dst[i] = *src;
+                src += r->channels;
+            }
+        }
+        r->hist_frames += in_frames;
+    }
+
+    int written = 0;
+    while (r->pos + r->taps <= r->hist_frames) {
+        int filter = r->phases == r->den ? r->phase
+                                         : (int)((int64_t)r->phase * r->phases / r->den);
+        const int16_t *coefs = r->coefs + filter * r->taps;
+        for (int c = 0; c < r->channels; c++) {
+            int32_t acc = dot_q15(r->hist[c] + r->pos, coefs, r->taps) + (1 << 14);
+            acc >>= 15;
+            if (acc > 32767) acc = 32767;
+            if (acc < -32768) acc = -32768;
+            *out++ = (int16_t)acc;
+        }
+        written++;
+
+        r->phase += r->step;
+        r->pos += r->phase / r->den;
+        r->phase %= r->den;
+    }
+
+    // Keep what the filter still needs (pos may run past it when downsampling)
+    int drop = r->pos < r->hist_frames ? r->pos : r->hist_frames;
+    if (drop > 0) {
+        for (int c = 0; c < r->channels; c++) {
+            memmove(r->hist[c], r->hist[c] + drop, (r->hist_frames - drop) * sizeof(int16_t));
+        }
+        r->hist_frames -= drop;
+        r->pos -= drop;
+    }
+    return written;
+}
+
+int resample_flush(Resampler *r, int16_t *out) {
+    int16_t silence[RESAMPLE_MAX_CHANNELS * 32] = {0};
+    return resample_process(r, silence, r->taps / 2, out);
+}
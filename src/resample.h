@@ -0,0 +1,71 @@
+/**
+ * Resample - Polyphase windowed-sinc sample rate converter
+ *
+ * Converts 16-bit interleaved PCM between two fixed rates (e.g. 96 kHz FLAC
+ * to the 44.1 kHz device) with a rational polyphase filter bank, so each
+ * output sample is one short dot product per channel (NEON on the device).
+ * Filter length follows the quality setting, which main.c ties to the
+ * power mode. One converter per stream; not thread-safe.
+ */
+
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <stdint.h>
+
+/**
+ * Filter quality (taps per phase)
+ */
+typedef enum {
+    RESAMPLE_FAST,      // 8 taps - battery mode
+    RESAMPLE_MEDIUM,    // 16 taps (default)
+    RESAMPLE_BEST       // 32 taps - performance mode
+} ResampleQuality;
+
+typedef struct Resampler Resampler;
+
+/**
+ * Create a converter
+ * @param in_rate Source sample rate
+ * @param out_rate Output sample rate
+ * @param channels Interleaved channel count
+ * @param quality Filter length
+ * @return Converter, or NULL on bad rates / out of memory
+ */
+Resampler* resample_create(int in_rate, int out_rate, int channels, ResampleQuality quality);
+
+/**
+ * Free a converter (NULL is fine)
+ */
+void resample_destroy(Resampler *r);
+
+/**
+ * Largest output resample_process() can produce for an input block
+ * @param in_frames Input frames per call
+ * @return Output frames to allocate
+ */
+int resample_max_output(const Resampler *r, int in_frames);
+
+/**
+ * Convert a block of input
+ * Input the filter still needs is kept for the next call.
+ * @param in Interleaved input frames
+ * @param in_frames Number of input frames
+ * @param out Interleaved output (resample_max_output(in_frames) frames)
+ * @return Output frames written
+ */
+int resample_process(Resampler *r, const int16_t *in, int in_frames, int16_t *out);
+
+/**
+ * Push out the samples held back by the filter (at end of stream)
+ * @param out Interleaved output (resample_max_output(0) frames)
+ * @return Output frames written
+ */
+int resample_flush(Resampler *r, int16_t *out);
+
+/**
+ * Drop held input (after a seek)
+ */
+void resample_reset(Resampler *r);
+
+#endif // RESAMPLE_H
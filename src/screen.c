@@ -6,6 +6,7 @@
  */
 
 #include "screen.h"
+#include "persist.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -410,6 +411,9 @@ bool screen_switch_is_on(void) {
 void screen_system_suspend(void) {
     printf("[SCREEN] System suspend...\n");
 
+    // Pending saves must reach the card before power is cut
+    persist_flush();
+
     // Save brightness before suspend
     if (g_disp_fd >= 0) {
         int current = disp_get_brightness();
@@ -0,0 +1,189 @@
+/**
+ * Search Cache Implementation
+ *
+ * One small file per query: header, the key (so hash collisions are
+ * detected) and the result structs as stored in memory. A changed struct
+ * size invalidates old entries. Writes go through persist.c.
+ */
+
+#include "searchcache.h"
+#include "persist.h"
+#include "state.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define SEARCHCACHE_DIR "search_cache"
+#define SEARCHCACHE_MAGIC 0x48435253  // "SRCH"
+#define SEARCHCACHE_VERSION 1
+#define SEARCHCACHE_MAX_KEY 256
+
+/**
+ * Entry file header, followed by the key and the results
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int64_t saved_at;
+    uint32_t item_size;
+    uint32_t count;
+    uint32_t key_len;
+} CacheHeader;
+
+/**
+ * Build "<service>\n<query>" with the query lowercased and whitespace
+ * collapsed, so "Daft  Punk " and "daft punk" share an entry
+ * @return Key length
+ */
+static size_t build_key(const char *service, const char *query, char *key, size_t size) {
+    size_t len = (size_t)snprintf(key, size, "%s\n", service);
+    if (len >= size) return 0;
+
+    bool space = false;
+    for (const unsigned char *p = (const unsigned char *)query; *p && len < size - 1; p++) {
+        if (isspace(*p)) {
+            space = true;
+            continue;
+        }
+        if (space && key[len - 1] != '\n') key[len++] = ' ';
+        if (len >= size - 1) break;
+        key[len++] = (char)tolower(*p);
+        space = false;
+    }
+    key[len] = '\0';
+    return len;
+}
+
+/**
+ * Entry file for a key (FNV-1a)
+ * @return false if there is no data directory
+ */
+static bool entry_path(const char *key, char *path, size_t size) {
+    const char *data_dir = state_get_data_dir();
+    if (!data_dir || !data_dir[0]) return false;
+
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    snprintf(path, size, "%s/%s/%08x.bin", data_dir, SEARCHCACHE_DIR, h);
+    return true;
+}
+
+/**
+ * Keep the cache bounded by dropping the oldest entry
+ */
+static void trim_cache(const char *cache_dir) {
+    DIR *dir = opendir(cache_dir);
+    if (!dir) return;
+
+    int count = 0;
+    time_t oldest_time = 0;
+    char oldest[512] = {0};
+    char path[512];
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        const char *ext = strrchr(entry->d_name, '.');
+        if (!ext || strcmp(ext, ".bin") != 0) continue;
+
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, entry->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+
+        count++;
+        if (!oldest[0] || st.st_mtime < oldest_time) {
+            oldest_time = st.st_mtime;
+            strncpy(oldest, path, sizeof(oldest) - 1);
+        }
+    }
+    closedir(dir);
+
+    if (count > SEARCHCACHE_MAX_ENTRIES && oldest[0]) {
+        remove(oldest);
+    }
+}
+
+int searchcache_get(const char *service, const char *query,
+                    void *items, size_t item_size, int max_items, bool *stale) {
+    if (!service || !query || !items || item_size == 0 || max_items <= 0) return -1;
+
+    char key[SEARCHCACHE_MAX_KEY];
+    char path[512];
+    size_t key_len = build_key(service, query, key, sizeof(key));
+    if (key_len == 0 || !entry_path(key, path, sizeof(path))) return -1;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+
+    CacheHeader hdr;
+    char stored_key[SEARCHCACHE_MAX_KEY];
+    int count = -1;
+    int64_t now = (int64_t)time(NULL);
+
+    if (fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+        hdr.magic == SEARCHCACHE_MAGIC && hdr.version == SEARCHCACHE_VERSION &&
+        hdr.item_size == item_size && hdr.count > 0 &&
+        hdr.key_len == key_len && key_len < sizeof(stored_key) &&
+        now - hdr.saved_at < SEARCHCACHE_TTL_SEC &&
+        fread(stored_key, 1, key_len, f) == key_len &&
+        memcmp(stored_key, key, key_len) == 0) {
+
+        int n = (hdr.count < (uint32_t)max_items) ? (int)hdr.count : max_items;
+        if (fread(items, item_size, (size_t)n, f) == (size_t)n) {
+            count = n;
+            if (stale) *stale = (now - hdr.saved_at >= SEARCHCACHE_FRESH_SEC);
+        }
+    }
+
+    fclose(f);
+    if (count >= 0) {
+        printf("[SEARCHCACHE] Hit for %s '%s' (%d results)\n", service, query, count);
+    }
+    return count;
+}
+
+void searchcache_put(const char *service, const char *query,
+                     const void *items, size_t item_size, int count) {
+    if (!service || !query || !items || item_size == 0 || count <= 0) return;
+
+    char key[SEARCHCACHE_MAX_KEY];
+    char path[512];
+    size_t key_len = build_key(service, query, key, sizeof(key));
+    if (key_len == 0 || !entry_path(key, path, sizeof(path))) return;
+
+    CacheHeader hdr = {0};
+    hdr.magic = SEARCHCACHE_MAGIC;
+    hdr.version = SEARCHCACHE_VERSION;
+    hdr.saved_at = (int64_t)time(NULL);
+    hdr.item_size = (uint32_t)item_size;
+    hdr.count = (uint32_t)count;
+    hdr.key_len = (uint32_t)key_len;
+
+    size_t size = sizeof(hdr) + key_len + item_size * (size_t)count;
+    uint8_t *buf = malloc(size);
+    if (!buf) return;
+    memcpy(buf, &hdr, sizeof(hdr));
+    memcpy(buf + sizeof(hdr), key, key_len);
+    memcpy(buf + sizeof(hdr) + key_len, items, item_size * (size_t)count);
+
+    // Cache directory sits next to the entry file
+    char cache_dir[512];
+    strncpy(cache_dir, path, sizeof(cache_dir) - 1);
+    cache_dir[sizeof(cache_dir) - 1] = '\0';
+    char *slash = strrchr(cache_dir, '/');
+    if (slash) {
+        *slash = '\0';
+        mkdir(cache_dir, 0755);
+        trim_cache(cache_dir);
+    }
+
+    persist_write(path, buf, size);
+    free(buf);
+}
@@ -0,0 +1,49 @@
+/**
+ * Search Cache - Persistent results for repeated YouTube/Spotify queries
+ *
+ * Results are stored per service and normalized query (case and spacing
+ * ignored) under the data directory. Fresh entries are served as-is;
+ * older ones are served at once but flagged stale so the caller can
+ * refresh them in the background. Entries past the TTL are ignored.
+ */
+
+#ifndef SEARCHCACHE_H
+#define SEARCHCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Entries younger than this are served without revalidating
+#define SEARCHCACHE_FRESH_SEC (15 * 60)
+
+// Entries older than this are ignored (TTL)
+#define SEARCHCACHE_TTL_SEC (7 * 24 * 3600)
+
+// Most queries kept on disk (oldest dropped first)
+#define SEARCHCACHE_MAX_ENTRIES 64
+
+/**
+ * Look up cached results
+ * @param service Service name (e.g. "youtube")
+ * @param query Query as typed
+ * @param items Output array
+ * @param item_size Size of one result (must match what was stored)
+ * @param max_items Capacity of items
+ * @param stale Output: true if the entry should be revalidated (can be NULL)
+ * @return Number of results, or -1 on a miss
+ */
+int searchcache_get(const char *service, const char *query,
+                    void *items, size_t item_size, int max_items, bool *stale);
+
+/**
+ * Store results (written in the background)
+ * @param service Service name
+ * @param query Query as typed
+ * @param items Results
+ * @param item_size Size of one result
+ * @param count Number of results (0 stores nothing)
+ */
+void searchcache_put(const char *service, const char *query,
+                     const void *items, size_t item_size, int count);
+
+#endif // SEARCHCACHE_H
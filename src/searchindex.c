@@ -0,0 +1,1148 @@
+/**
+ * Search Index Implementation
+ *
+ * Documents (one per version of a file) sit in a flat array, their strings
+ * (name, tags, folded search text) in one append-only arena. A file whose
+ * listing or tags change gets a new document and the old one is marked
+ * dead, so posting lists only ever grow at the end and stay sorted by
+ * document id. Queries skip dead documents; a compaction drops them once
+ * they are a third of the index.
+ *
+ * Trigrams are over a 37-symbol alphabet (space, a-z, 0-9), 50653 lists
+ * addressed directly. The search text is " name | title | artist | album
+ * | folder | parent " with a space before every word, so the first two
+ * letters of a word make a trigram too; no trigram spans a '|'.
+ *
+ * File format (native endianness, written to a temp file and renamed):
+ *   u32 magic, u32 version, u32 strings_size, u32 dir_count, u32 doc_count,
+ *   u32 list_count, strings, dirs (u32 path, u32 count, u32 docs[count]),
+ *   docs (SearchDoc), lists (u32 trigram, u32 count, u32 ids[count])
+ */
+
+#include "searchindex.h"
+#include "library.h"
+#include "metadata.h"
+#include "state.h"
+#include "tags.h"
+#include "iosched.h"
+#include "jobs.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#define SEARCH_INDEX_FILENAME "search.idx"
+#define SEARCH_INDEX_MAGIC    0x58495353  // "SSIX"
+#define SEARCH_INDEX_VERSION  1
+#define SEARCH_MAX_PATH       512
+#define SEARCH_MAX_TEXT       1024        // Folded search text of one file
+#define SEARCH_SYMBOLS        37          // Space, a-z, 0-9
+#define SEARCH_TRIGRAMS       (SEARCH_SYMBOLS * SEARCH_SYMBOLS * SEARCH_SYMBOLS)
+#define SEARCH_MAX_WORDS      8
+#define SEARCH_MAX_WORD       62
+#define SEARCH_ENRICH_BATCH   64          // Files tagged per job
+#define SEARCH_PROBE_BYTES    (64 * 1024) // Charged to the I/O gate per tag read
+#define SEARCH_COMPACT_MIN    1024        // Dead documents before compaction is considered
+#define NO_DOC                UINT32_MAX
+
+// Document flags
+#define DOC_ALIVE  1
+#define DOC_TAGGED 2                      // Tags looked up (found or not)
+
+// One version of a file (all u32, so the array is saved as is)
+typedef struct {
+    uint32_t dir;           // Index into dirs
+    uint32_t name;          // String offsets (0 = empty string)
+    uint32_t title;
+    uint32_t artist;
+    uint32_t album;
+    uint32_t text;          // Folded search text
+    uint32_t flags;         // DOC_*
+} SearchDoc;
+
+// One directory: its live documents in listing order
+typedef struct {
+    uint32_t path;
+    uint32_t *docs;
+    uint32_t count;
+    uint32_t capacity;
+    unsigned pass;          // Last library build pass that reported it
+} SearchDir;
+
+// Document ids holding one trigram, ascending
+typedef struct {
+    uint32_t *ids;
+    uint32_t count;
+    uint32_t capacity;
+} PostingList;
+
+typedef struct {
+    char *strings;
+    size_t strings_used;
+    size_t strings_capacity;
+    SearchDoc *docs;
+    uint32_t doc_count;
+    uint32_t doc_capacity;
+    uint32_t dead;
+    SearchDir *dirs;
+    uint32_t dir_count;
+    uint32_t dir_capacity;
+    uint32_t *slots;        // Path hash: dir index + 1, 0 = empty
+    uint32_t slot_count;    // Power of two
+    PostingList *lists;     // SEARCH_TRIGRAMS
+} Index;
+
+// Index state (guarded by g_mutex)
+static Index g_index;
+static unsigned g_pass = 1;
+static unsigned g_epoch = 0;              // Bumped when compaction renumbers documents
+static uint32_t g_enrich_cursor = 0;      // First document the tagger hasn't looked at
+static bool g_dirty = false;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Query scratch (main thread only)
+static uint32_t *g_candidates = NULL;
+static uint32_t g_candidate_capacity = 0;
+
+// Tagger job (main thread only)
+static JobId g_enrich_job = 0;
+
+static char g_base_path[SEARCH_MAX_PATH] = {0};
+static char g_index_path[SEARCH_MAX_PATH] = {0};
+
+#define STR(off) (g_index.strings + (off))
+
+// Second byte of UTF-8 U+00C0..U+00FF folded to ASCII (' ' = not a letter)
+static const char LATIN1_FOLD[64] =
+    "aaaaaaaceeeeiiiidnooooo ouuuuy s"
+    "aaaaaaaceeeeiiiidnooooo ouuuuy y";
+
+/**
+ * Append text folded to the search alphabet
+ * Lowercases, strips accents, and turns every run of anything else into
+ * one space.
+ * @return New length of out
+ */
+static size_t fold_append(char *out, size_t len, size_t size, const char *text) {
+    const unsigned char *p = (const unsigned char *)text;
+    while (*p && len + 1 < size) {
+        char c;
+        if (*p < 0x80) {
+            c = (char)tolower(*p++);
+            if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))) c = ' ';
+        } else if (*p == 0xC3 && p[1] >= 0x80 && p[1] <= 0xBF) {
+            c = LATIN1_FOLD[p[1] - 0x80];
+            p += 2;
+        } else {
+            c = ' ';
+            p++;
+            while ((*p & 0xC0) == 0x80) p++;
+        }
+        if (c == ' ' && len > 0 && out[len - 1] == ' ') continue;
+        out[len++] = c;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+/**
+ * Symbol of a folded character, -1 for the field separator
+ */
+static int symbol(char c) {
+    if (c == ' ') return 0;
+    if (c >= 'a' && c <= 'z') return 1 + (c - 'a');
+    if (c >= '0' && c <= '9') return 27 + (c - '0');
+    return -1;
+}
+
+/**
+ * Trigram at s, -1 if it spans a separator or the end
+ */
+static int trigram_at(const char *s) {
+    int a = symbol(s[0]);
+    if (a < 0) return -1;
+    int b = symbol(s[1]);
+    if (b < 0) return -1;
+    int c = symbol(s[2]);
+    if (c < 0) return -1;
+    return (a * SEARCH_SYMBOLS + b) * SEARCH_SYMBOLS + c;
+}
+
+static int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t hash_str(const char *s) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)s; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// ============================================================================
+// Index storage (caller holds g_mutex)
+// ============================================================================
+
+/**
+ * Allocate an empty index (string 0 is "")
+ */
+static bool index_alloc(Index *ix) {
+    memset(ix, 0, sizeof(Index));
+    ix->lists = calloc(SEARCH_TRIGRAMS, sizeof(PostingList));
+    ix->strings = malloc(64 * 1024);
+    if (!ix->lists || !ix->strings) return false;
+    ix->strings_capacity = 64 * 1024;
+    ix->strings[0] = '\0';
+    ix->strings_used = 1;
+    return true;
+}
+
+static void index_free(Index *ix) {
+    if (ix->lists) {
+        for (int t = 0; t < SEARCH_TRIGRAMS; t++) free(ix->lists[t].ids);
+    }
+    for (uint32_t i = 0; i < ix->dir_count; i++) free(ix->dirs[i].docs);
+    free(ix->lists);
+    free(ix->dirs);
+    free(ix->slots);
+    free(ix->docs);
+    free(ix->strings);
+    memset(ix, 0, sizeof(Index));
+}
+
+/**
+ * Copy a string into the arena
+ * @return Offset (0 for an empty string or when out of memory)
+ */
+static uint32_t add_string(const char *s) {
+    if (!s || !s[0]) return 0;
+    size_t len = strlen(s) + 1;
+    if (g_index.strings_used + len > g_index.strings_capacity) {
+        size_t capacity = g_index.strings_capacity * 2;
+        while (capacity < g_index.strings_used + len) capacity *= 2;
+        char *grown = realloc(g_index.strings, capacity);
+        if (!grown) return 0;
+        g_index.strings = grown;
+        g_index.strings_capacity = capacity;
+    }
+    uint32_t offset = (uint32_t)g_index.strings_used;
+    memcpy(g_index.strings + offset, s, len);
+    g_index.strings_used += len;
+    return offset;
+}
+
+/**
+ * Append a document id to a trigram's list
+ */
+static void posting_add(int trigram, uint32_t id) {
+    PostingList *l = &g_index.lists[trigram];
+    if (l->count == l->capacity) {
+        uint32_t capacity = l->capacity ? l->capacity * 2 : 4;
+        uint32_t *grown = realloc(l->ids, capacity * sizeof(uint32_t));
+        if (!grown) return;
+        l->ids = grown;
+        l->capacity = capacity;
+    }
+    l->ids[l->count++] = id;
+}
+
+/**
+ * Add a document to the list of each distinct trigram of its text
+ */
+static void index_text(uint32_t id) {
+    const char *text = STR(g_index.docs[id].text);
+    int trigrams[SEARCH_MAX_TEXT];
+    int n = 0;
+    for (size_t i = 0; text[i] && text[i + 1] && text[i + 2]; i++) {
+        int t = trigram_at(text + i);
+        if (t >= 0) trigrams[n++] = t;
+    }
+    qsort(trigrams, n, sizeof(int), compare_int);
+    for (int i = 0; i < n; i++) {
+        if (i == 0 || trigrams[i] != trigrams[i - 1]) posting_add(trigrams[i], id);
+    }
+}
+
+/**
+ * Find a directory by path
+ * @return Index, or -1
+ */
+static int find_dir(const char *path) {
+    if (!g_index.slot_count) return -1;
+    uint32_t mask = g_index.slot_count - 1;
+    for (uint32_t s = hash_str(path) & mask; g_index.slots[s]; s = (s + 1) & mask) {
+        uint32_t di = g_index.slots[s] - 1;
+        if (strcmp(STR(g_index.dirs[di].path), path) == 0) return (int)di;
+    }
+    return -1;
+}
+
+/**
+ * Put a directory into the path hash (there is a free slot)
+ */
+static void slot_insert(uint32_t di) {
+    uint32_t mask = g_index.slot_count - 1;
+    uint32_t s = hash_str(STR(g_index.dirs[di].path)) & mask;
+    while (g_index.slots[s]) s = (s + 1) & mask;
+    g_index.slots[s] = di + 1;
+}
+
+/**
+ * Size the path hash for the directory count (at most half full)
+ */
+static bool reserve_slots(uint32_t dir_count) {
+    if (dir_count * 2 < g_index.slot_count) return true;
+
+    uint32_t slot_count = g_index.slot_count ? g_index.slot_count : 1024;
+    while (dir_count * 2 >= slot_count) slot_count *= 2;
+    uint32_t *slots = calloc(slot_count, sizeof(uint32_t));
+    if (!slots) return false;
+
+    free(g_index.slots);
+    g_index.slots = slots;
+    g_index.slot_count = slot_count;
+    for (uint32_t di = 0; di < g_index.dir_count; di++) slot_insert(di);
+    return true;
+}
+
+/**
+ * Add a directory with no documents
+ * @return Index, or -1 if out of memory
+ */
+static int add_dir(const char *path) {
+    if (!reserve_slots(g_index.dir_count + 1)) return -1;
+    if (g_index.dir_count == g_index.dir_capacity) {
+        uint32_t capacity = g_index.dir_capacity ? g_index.dir_capacity * 2 : 256;
+        SearchDir *grown = realloc(g_index.dirs, capacity * sizeof(SearchDir));
+        if (!grown) return -1;
+        g_index.dirs = grown;
+        g_index.dir_capacity = capacity;
+    }
+
+    uint32_t di = g_index.dir_count;
+    memset(&g_index.dirs[di], 0, sizeof(SearchDir));
+    g_index.dirs[di].path = add_string(path);
+    g_index.dir_count++;
+    slot_insert(di);
+    return (int)di;
+}
+
+/**
+ * Replace a directory's document list
+ */
+static void dir_set_docs(SearchDir *dir, const uint32_t *ids, uint32_t count) {
+    if (count > dir->capacity) {
+        uint32_t *grown = realloc(dir->docs, count * sizeof(uint32_t));
+        if (!grown) return;
+        dir->docs = grown;
+        dir->capacity = count;
+    }
+    memcpy(dir->docs, ids, count * sizeof(uint32_t));
+    dir->count = count;
+}
+
+/**
+ * Fill the search text of a file
+ * @param dir_path Directory the file is in
+ */
+static void build_text(char *out, const char *name, const char *title, const char *artist,
+                       const char *album, const char *dir_path) {
+    char stem[256];
+    snprintf(stem, sizeof(stem), "%s", name);
+    char *dot = strrchr(stem, '.');
+    if (dot && dot != stem) *dot = '\0';
+
+    // Up to two folder names below the music root
+    char rel[SEARCH_MAX_PATH];
+    size_t base_len = strlen(g_base_path);
+    if (base_len > 0 && strncmp(dir_path, g_base_path, base_len) == 0) dir_path += base_len;
+    snprintf(rel, sizeof(rel), "%s", dir_path);
+    const char *folder = "";
+    const char *parent = "";
+    char *slash = strrchr(rel, '/');
+    if (slash) {
+        folder = slash + 1;
+        *slash = '\0';
+        slash = strrchr(rel, '/');
+        parent = slash ? slash + 1 : rel;
+    }
+
+    const char *fields[] = { stem, title, artist, album, folder, parent };
+    size_t len = 0;
+    out[len++] = ' ';
+    for (int i = 0; i < 6; i++) {
+        if (i > 0) {
+            if (out[len - 1] != ' ') out[len++] = ' ';
+            out[len++] = '|';
+            out[len++] = ' ';
+        }
+        len = fold_append(out, len, SEARCH_MAX_TEXT - 4, fields[i] ? fields[i] : "");
+    }
+    if (out[len - 1] != ' ') out[len++] = ' ';
+    out[len] = '\0';
+}
+
+/**
+ * Add and index a document
+ * The strings must not point into the arena (it may move).
+ * @return Document id, or NO_DOC if out of memory
+ */
+static uint32_t add_doc(uint32_t dir, const char *name, const char *title, const char *artist,
+                        const char *album, uint32_t flags) {
+    if (g_index.doc_count == g_index.doc_capacity) {
+        uint32_t capacity = g_index.doc_capacity ? g_index.doc_capacity * 2 : 1024;
+        SearchDoc *grown = realloc(g_index.docs, capacity * sizeof(SearchDoc));
+        if (!grown) return NO_DOC;
+        g_index.docs = grown;
+        g_index.doc_capacity = capacity;
+    }
+
+    char text[SEARCH_MAX_TEXT];
+    build_text(text, name, title, artist, album, STR(g_index.dirs[dir].path));
+
+    uint32_t id = g_index.doc_count;
+    SearchDoc *d = &g_index.docs[id];
+    d->dir = dir;
+    d->name = add_string(name);
+    d->title = add_string(title);
+    d->artist = add_string(artist);
+    d->album = add_string(album);
+    d->text = add_string(text);
+    d->flags = DOC_ALIVE | flags;
+    g_index.doc_count++;
+
+    index_text(id);
+    g_dirty = true;
+    return id;
+}
+
+/**
+ * Mark a document dead (its list entries are skipped from now on)
+ */
+static void kill_doc(uint32_t id) {
+    if (!(g_index.docs[id].flags & DOC_ALIVE)) return;
+    g_index.docs[id].flags &= ~DOC_ALIVE;
+    g_index.dead++;
+    g_dirty = true;
+}
+
+/**
+ * Full path of a document
+ */
+static void doc_path(const SearchDoc *d, char *out, size_t size) {
+    snprintf(out, size, "%s/%s", STR(g_index.dirs[d->dir].path), STR(d->name));
+}
+
+/**
+ * Rebuild the index from its live documents (renumbers them)
+ */
+static void compact(void) {
+    Index old = g_index;
+    if (!index_alloc(&g_index)) {
+        index_free(&g_index);
+        g_index = old;
+        return;
+    }
+
+    char name[256], title[256], artist[256], album[256];
+    for (uint32_t i = 0; i < old.dir_count; i++) {
+        const SearchDir *od = &old.dirs[i];
+        if (od->count == 0) continue;
+        int di = add_dir(old.strings + od->path);
+        if (di < 0) break;
+
+        uint32_t *ids = malloc(od->count * sizeof(uint32_t));
+        if (!ids) break;
+        uint32_t n = 0;
+        for (uint32_t k = 0; k < od->count; k++) {
+            const SearchDoc *o = &old.docs[od->docs[k]];
+            snprintf(name, sizeof(name), "%s", old.strings + o->name);
+            snprintf(title, sizeof(title), "%s", old.strings + o->title);
+            snprintf(artist, sizeof(artist), "%s", old.strings + o->artist);
+            snprintf(album, sizeof(album), "%s", old.strings + o->album);
+            uint32_t id = add_doc((uint32_t)di, name, title, artist, album, o->flags & DOC_TAGGED);
+            if (id != NO_DOC) ids[n++] = id;
+        }
+        g_index.dirs[di].pass = od->pass;
+        dir_set_docs(&g_index.dirs[di], ids, n);
+        free(ids);
+    }
+
+    printf("[SEARCH] Compacted: %u documents (%u dead dropped)\n", g_index.doc_count, old.dead);
+    index_free(&old);
+    g_enrich_cursor = 0;
+    g_epoch++;
+    g_dirty = true;
+}
+
+/**
+ * Compact once dead documents are a third of the index
+ */
+static void maybe_compact(void) {
+    if (g_index.dead >= SEARCH_COMPACT_MIN && g_index.dead * 3 >= g_index.doc_count) compact();
+}
+
+// ============================================================================
+// Persistence
+// ============================================================================
+
+/**
+ * Write the index to disk if it changed
+ * Serializes under the lock into memory, writes outside it.
+ */
+static void save_index(void) {
+    if (!g_index_path[0]) return;
+
+    pthread_mutex_lock(&g_mutex);
+    if (!g_dirty || !g_index.lists) {
+        pthread_mutex_unlock(&g_mutex);
+        return;
+    }
+
+    uint32_t list_count = 0;
+    size_t size = 6 * sizeof(uint32_t) + g_index.strings_used +
+                  (size_t)g_index.doc_count * sizeof(SearchDoc);
+    for (uint32_t i = 0; i < g_index.dir_count; i++) {
+        size += (2 + (size_t)g_index.dirs[i].count) * sizeof(uint32_t);
+    }
+    for (int t = 0; t < SEARCH_TRIGRAMS; t++) {
+        if (g_index.lists[t].count == 0) continue;
+        size += (2 + (size_t)g_index.lists[t].count) * sizeof(uint32_t);
+        list_count++;
+    }
+
+    uint8_t *buf = malloc(size);
+    if (!buf) {
+        pthread_mutex_unlock(&g_mutex);
+        return;
+    }
+
+    uint8_t *p = buf;
+    uint32_t header[6] = { SEARCH_INDEX_MAGIC, SEARCH_INDEX_VERSION, (uint32_t)g_index.strings_used,
+                           g_index.dir_count, g_index.doc_count, list_count };
+    memcpy(p, header, sizeof(header));                         p += sizeof(header);
+    memcpy(p, g_index.strings, g_index.strings_used);          p += g_index.strings_used;
+    for (uint32_t i = 0; i < g_index.dir_count; i++) {
+        const SearchDir *dir = &g_index.dirs[i];
+        memcpy(p, &dir->path, sizeof(uint32_t));               p += sizeof(uint32_t);
+        memcpy(p, &dir->count, sizeof(uint32_t));              p += sizeof(uint32_t);
+        memcpy(p, dir->docs, dir->count * sizeof(uint32_t));   p += dir->count * sizeof(uint32_t);
+    }
+    memcpy(p, g_index.docs, g_index.doc_count * sizeof(SearchDoc));
+    p += g_index.doc_count * sizeof(SearchDoc);
+    for (uint32_t t = 0; t < SEARCH_TRIGRAMS; t++) {
+        const PostingList *l = &g_index.lists[t];
+        if (l->count == 0) continue;
+        memcpy(p, &t, sizeof(uint32_t));                       p += sizeof(uint32_t);
+        memcpy(p, &l->count, sizeof(uint32_t));                p += sizeof(uint32_t);
+        memcpy(p, l->ids, l->count * sizeof(uint32_t));        p += l->count * sizeof(uint32_t);
+    }
+
+    uint32_t doc_count = g_index.doc_count - g_index.dead;
+    g_dirty = false;
+    pthread_mutex_unlock(&g_mutex);
+
+    // Write to a temp file and rename so a power cut never leaves half an index
+    char tmp_path[SEARCH_MAX_PATH + 8];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", g_index_path);
+    FILE *f = fopen(tmp_path, "wb");
+    bool ok = false;
+    if (f) {
+        ok = fwrite(buf, 1, size, f) == size;
+        ok = (fclose(f) == 0) && ok;
+    }
+    if (ok && rename(tmp_path, g_index_path) == 0) {
+        printf("[SEARCH] Saved index: %u tracks, %zu KB\n", doc_count, size / 1024);
+    } else {
+        fprintf(stderr, "[SEARCH] Failed to save index: %s\n", g_index_path);
+        remove(tmp_path);
+        pthread_mutex_lock(&g_mutex);
+        g_dirty = true;
+        pthread_mutex_unlock(&g_mutex);
+    }
+
+    free(buf);
+}
+
+/**
+ * Read a u32 array from a saved index
+ * @return false if the file ends first
+ */
+static bool read_u32s(const uint8_t **p, const uint8_t *end, uint32_t *out, size_t count) {
+    if ((size_t)(end - *p) / sizeof(uint32_t) < count) return false;
+    memcpy(out, *p, count * sizeof(uint32_t));
+    *p += count * sizeof(uint32_t);
+    return true;
+}
+
+/**
+ * Fill the (empty) index from a saved file image
+ * @return false if it is damaged or from another version
+ */
+static bool parse_index(const uint8_t *p, const uint8_t *end) {
+    uint32_t header[6];
+    if (!read_u32s(&p, end, header, 6)) return false;
+    if (header[0] != SEARCH_INDEX_MAGIC || header[1] != SEARCH_INDEX_VERSION) {
+        printf("[SEARCH] Ignoring index with old format\n");
+        return false;
+    }
+    uint32_t strings_size = header[2], dir_count = header[3], doc_count = header[4];
+
+    // Strings: string 0 is "", the arena ends on a NUL
+    if (strings_size == 0 || (size_t)(end - p) < strings_size || p[0] != '\0' ||
+        p[strings_size - 1] != '\0') return false;
+    if (strings_size > g_index.strings_capacity) {
+        char *grown = realloc(g_index.strings, strings_size);
+        if (!grown) return false;
+        g_index.strings = grown;
+        g_index.strings_capacity = strings_size;
+    }
+    memcpy(g_index.strings, p, strings_size);
+    g_index.strings_used = strings_size;
+    p += strings_size;
+
+    g_index.dirs = calloc(dir_count ? dir_count : 1, sizeof(SearchDir));
+    g_index.docs = malloc((doc_count ? doc_count : 1) * sizeof(SearchDoc));
+    if (!g_index.dirs || !g_index.docs) return false;
+    g_index.dir_capacity = dir_count;
+    g_index.doc_capacity = doc_count;
+
+    for (uint32_t i = 0; i < dir_count; i++) {
+        SearchDir *dir = &g_index.dirs[i];
+        uint32_t head[2];
+        if (!read_u32s(&p, end, head, 2) || head[0] >= strings_size) return false;
+        dir->path = head[0];
+        dir->docs = malloc((head[1] ? head[1] : 1) * sizeof(uint32_t));
+        g_index.dir_count = i + 1;  // Owns docs from here on
+        if (!dir->docs || !read_u32s(&p, end, dir->docs, head[1])) return false;
+        dir->count = dir->capacity = head[1];
+        for (uint32_t k = 0; k < dir->count; k++) {
+            if (dir->docs[k] >= doc_count) return false;
+        }
+    }
+
+    if ((size_t)(end - p) / sizeof(SearchDoc) < doc_count) return false;
+    memcpy(g_index.docs, p, doc_count * sizeof(SearchDoc));
+    p += doc_count * sizeof(SearchDoc);
+    g_index.doc_count = doc_count;
+    for (uint32_t i = 0; i < doc_count; i++) {
+        const SearchDoc *d = &g_index.docs[i];
+        if (d->dir >= dir_count || d->name >= strings_size || d->title >= strings_size ||
+            d->artist >= strings_size || d->album >= strings_size || d->text >= strings_size) {
+            return false;
+        }
+        if (!(d->flags & DOC_ALIVE)) g_index.dead++;
+    }
+
+    for (uint32_t i = 0; i < header[5]; i++) {
+        uint32_t head[2];
+        if (!read_u32s(&p, end, head, 2) || head[0] >= SEARCH_TRIGRAMS) return false;
+        PostingList *l = &g_index.lists[head[0]];
+        if (l->ids) return false;
+        l->ids = malloc((head[1] ? head[1] : 1) * sizeof(uint32_t));
+        if (!l->ids || !read_u32s(&p, end, l->ids, head[1])) return false;
+        l->count = l->capacity = head[1];
+        for (uint32_t k = 0; k < l->count; k++) {
+            if (l->ids[k] >= doc_count) return false;
+        }
+    }
+
+    return reserve_slots(dir_count);
+}
+
+/**
+ * Load the saved index (an empty one when missing or damaged)
+ */
+static void load_index(void) {
+    FILE *f = fopen(g_index_path, "rb");
+    if (!f) {
+        printf("[SEARCH] No saved index\n");
+        return;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *buf = (size > 0) ? malloc((size_t)size) : NULL;
+    if (!buf || fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        free(buf);
+        fclose(f);
+        return;
+    }
+    fclose(f);
+
+    pthread_mutex_lock(&g_mutex);
+    if (parse_index(buf, buf + size)) {
+        printf("[SEARCH] Loaded index: %u tracks in %u directories\n",
+               g_index.doc_count - g_index.dead, g_index.dir_count);
+    } else {
+        fprintf(stderr, "[SEARCH] Discarding damaged index\n");
+        index_free(&g_index);
+        index_alloc(&g_index);
+    }
+    pthread_mutex_unlock(&g_mutex);
+
+    free(buf);
+}
+
+// ============================================================================
+// Following the library
+// ============================================================================
+
+/**
+ * Check if a directory's documents are exactly the files of a listing
+ */
+static bool listing_matches(const SearchDir *dir, const char *names, const unsigned char *is_dir,
+                            int count) {
+    uint32_t k = 0;
+    const char *name = names;
+    for (int i = 0; i < count; i++, name += strlen(name) + 1) {
+        if (is_dir[i]) continue;
+        if (k >= dir->count || strcmp(STR(g_index.docs[dir->docs[k]].name), name) != 0) return false;
+        k++;
+    }
+    return k == dir->count;
+}
+
+/**
+ * Take the document of a file out of a directory's list
+ * Listings mostly keep their order, so the search starts where the last
+ * one ended.
+ * @param hint In/out: position to start from
+ * @return Document id, or NO_DOC if the file is new
+ */
+static uint32_t take_doc(SearchDir *dir, const char *name, uint32_t *hint) {
+    for (uint32_t n = 0; n < dir->count; n++) {
+        uint32_t k = (*hint + n) % dir->count;
+        uint32_t id = dir->docs[k];
+        if (id != NO_DOC && strcmp(STR(g_index.docs[id].name), name) == 0) {
+            dir->docs[k] = NO_DOC;
+            *hint = k + 1;
+            return id;
+        }
+    }
+    return NO_DOC;
+}
+
+/**
+ * Drop directories the finished build pass didn't report, then save
+ */
+static void end_pass(void) {
+    pthread_mutex_lock(&g_mutex);
+    uint32_t dropped = 0;
+    for (uint32_t i = 0; i < g_index.dir_count; i++) {
+        SearchDir *dir = &g_index.dirs[i];
+        if (dir->pass == g_pass || dir->count == 0) continue;
+        for (uint32_t k = 0; k < dir->count; k++) kill_doc(dir->docs[k]);
+        dropped += dir->count;
+        dir->count = 0;
+    }
+    g_pass++;
+    maybe_compact();
+    pthread_mutex_unlock(&g_mutex);
+
+    if (dropped > 0) printf("[SEARCH] Dropped %u tracks of vanished directories\n", dropped);
+    save_index();
+}
+
+/**
+ * Library listener: bring one directory's documents in line with its listing
+ */
+static void on_listing(const char *path, const char *names, const unsigned char *is_dir,
+                       int count, void *userdata) {
+    (void)userdata;
+    if (!path) {
+        end_pass();
+        return;
+    }
+
+    pthread_mutex_lock(&g_mutex);
+    int di = g_index.lists ? find_dir(path) : -1;
+    if (di < 0 && g_index.lists) di = add_dir(path);
+    if (di < 0) {
+        pthread_mutex_unlock(&g_mutex);
+        return;
+    }
+    SearchDir *dir = &g_index.dirs[di];
+    dir->pass = g_pass;
+
+    // The common case: nothing changed since the last report
+    if (listing_matches(dir, names, is_dir, count)) {
+        pthread_mutex_unlock(&g_mutex);
+        return;
+    }
+
+    uint32_t *ids = malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    if (!ids) {
+        pthread_mutex_unlock(&g_mutex);
+        return;
+    }
+    uint32_t n = 0, hint = 0, added = 0;
+    const char *name = names;
+    for (int i = 0; i < count; i++, name += strlen(name) + 1) {
+        if (is_dir[i]) continue;
+        uint32_t id = take_doc(dir, name, &hint);
+        if (id == NO_DOC) {
+            id = add_doc((uint32_t)di, name, NULL, NULL, NULL, 0);
+            added++;
+        }
+        if (id != NO_DOC) ids[n++] = id;
+    }
+
+    // Whatever is left was deleted or renamed
+    uint32_t removed = 0;
+    for (uint32_t k = 0; k < dir->count; k++) {
+        if (dir->docs[k] != NO_DOC) {
+            kill_doc(dir->docs[k]);
+            removed++;
+        }
+    }
+    dir_set_docs(dir, ids, n);
+    free(ids);
+    pthread_mutex_unlock(&g_mutex);
+
+    if (removed > 0 || added > 16) {
+        printf("[SEARCH] %s: %u added, %u removed\n", path, added, removed);
+    }
+}
+
+// ============================================================================
+// Tagging
+// ============================================================================
+
+// One tagger job: documents picked under the lock, read outside it
+typedef struct {
+    unsigned epoch;
+    int count;
+    bool more;              // Untagged documents may remain after this batch
+    uint32_t docs[SEARCH_ENRICH_BATCH];
+    char paths[SEARCH_ENRICH_BATCH][SEARCH_MAX_PATH];
+} EnrichBatch;
+
+/**
+ * Give a document its tags (caller holds g_mutex)
+ * Tagged files get a new document with the richer text.
+ */
+static void retag_doc(uint32_t id, const char *title, const char *artist, const char *album) {
+    SearchDoc *d = &g_index.docs[id];
+    if (!(d->flags & DOC_ALIVE) || (d->flags & DOC_TAGGED)) return;
+    if (!title[0] && !artist[0] && !album[0]) {
+        d->flags |= DOC_TAGGED;
+        g_dirty = true;
+        return;
+    }
+
+    char name[256];
+    snprintf(name, sizeof(name), "%s", STR(d->name));
+    uint32_t di = d->dir;
+    uint32_t nid = add_doc(di, name, title, artist, album, DOC_TAGGED);
+    if (nid == NO_DOC) return;
+    kill_doc(id);
+
+    SearchDir *dir = &g_index.dirs[di];
+    for (uint32_t k = 0; k < dir->count; k++) {
+        if (dir->docs[k] == id) dir->docs[k] = nid;
+    }
+}
+
+/**
+ * Tagger job: metadata cache first, else the file's own tags
+ */
+static void enrich_job(void *arg, const volatile bool *cancel) {
+    EnrichBatch *b = (EnrichBatch *)arg;
+
+    pthread_mutex_lock(&g_mutex);
+    b->epoch = g_epoch;
+    while (g_enrich_cursor < g_index.doc_count && b->count < SEARCH_ENRICH_BATCH) {
+        const SearchDoc *d = &g_index.docs[g_enrich_cursor];
+        if ((d->flags & DOC_ALIVE) && !(d->flags & DOC_TAGGED)) {
+            doc_path(d, b->paths[b->count], SEARCH_MAX_PATH);
+            b->docs[b->count++] = g_enrich_cursor;
+        }
+        g_enrich_cursor++;
+    }
+    b->more = g_enrich_cursor < g_index.doc_count;
+    pthread_mutex_unlock(&g_mutex);
+
+    int tagged = 0;
+    for (int i = 0; i < b->count && !*cancel; i++) {
+        MetadataResult meta;
+        TrackInfo info;
+        const char *title, *artist, *album;
+        if (metadata_get_cached(b->paths[i], &meta)) {
+            title = meta.title;
+            artist = meta.artist;
+            album = meta.album;
+        } else {
+            if (!iosched_gate(SEARCH_PROBE_BYTES, cancel)) break;
+            tags_probe(b->paths[i], &info);
+            title = info.title;
+            artist = info.artist;
+            album = info.album;
+        }
+
+        pthread_mutex_lock(&g_mutex);
+        bool current = b->epoch == g_epoch;
+        if (current) retag_doc(b->docs[i], title, artist, album);
+        pthread_mutex_unlock(&g_mutex);
+        if (!current) break;  // Compacted meanwhile: ids moved, the next batch rescans
+        if (title[0] || artist[0] || album[0]) tagged++;
+    }
+
+    if (tagged > 0) printf("[SEARCH] Tagged %d of %d tracks\n", tagged, b->count);
+    if (!b->more && !*cancel) {
+        pthread_mutex_lock(&g_mutex);
+        maybe_compact();
+        pthread_mutex_unlock(&g_mutex);
+        save_index();
+    }
+}
+
+static void submit_enrich(void);
+
+/**
+ * Queue the next batch while there is more to tag
+ */
+static void enrich_done(void *arg, bool cancelled) {
+    EnrichBatch *b = (EnrichBatch *)arg;
+    bool more = b->more && !cancelled;
+    free(b);
+    g_enrich_job = 0;
+    if (more) submit_enrich();
+}
+
+static void submit_enrich(void) {
+    EnrichBatch *b = calloc(1, sizeof(EnrichBatch));
+    if (!b) return;
+    g_enrich_job = jobs_submit(JOB_CLASS_BACKGROUND, "search_tags", enrich_job, enrich_done, b);
+    if (g_enrich_job == 0) free(b);
+}
+
+void searchindex_enrich(void) {
+    if (g_enrich_job) return;
+    pthread_mutex_lock(&g_mutex);
+    g_enrich_cursor = 0;
+    pthread_mutex_unlock(&g_mutex);
+    submit_enrich();
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+int searchindex_init(const char *base_path) {
+    snprintf(g_base_path, sizeof(g_base_path), "%s", base_path ? base_path : "");
+
+    pthread_mutex_lock(&g_mutex);
+    bool ok = index_alloc(&g_index);
+    if (!ok) index_free(&g_index);
+    pthread_mutex_unlock(&g_mutex);
+    if (!ok) {
+        fprintf(stderr, "[SEARCH] Out of memory\n");
+        return -1;
+    }
+
+    const char *data_dir = state_get_data_dir();
+    if (data_dir && data_dir[0]) {
+        snprintf(g_index_path, sizeof(g_index_path), "%s/%s", data_dir, SEARCH_INDEX_FILENAME);
+        load_index();
+    }
+
+    library_set_listener(on_listing, NULL);
+    return 0;
+}
+
+void searchindex_cleanup(void) {
+    library_set_listener(NULL, NULL);
+    jobs_cancel(g_enrich_job);
+    save_index();
+
+    pthread_mutex_lock(&g_mutex);
+    index_free(&g_index);
+    pthread_mutex_unlock(&g_mutex);
+    free(g_candidates);
+    g_candidates = NULL;
+    g_candidate_capacity = 0;
+}
+
+/**
+ * Keep the candidates also in a list (both ascending)
+ * @return Candidates left
+ */
+static uint32_t intersect(uint32_t *cand, uint32_t n, const PostingList *l) {
+    uint32_t out = 0, lo = 0;
+    for (uint32_t i = 0; i < n && lo < l->count; i++) {
+        // Binary search for the first id >= cand[i] in what's left of the list
+        uint32_t hi = l->count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (l->ids[mid] < cand[i]) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo < l->count && l->ids[lo] == cand[i]) cand[out++] = cand[i];
+    }
+    return out;
+}
+
+// A query word: " word", matched from [1] when it may start mid-word
+typedef struct {
+    char text[SEARCH_MAX_WORD + 2];
+    bool anywhere;
+} QueryWord;
+
+/**
+ * Score a document's text against every word
+ * +2 per word matching at a word start, +1 per word in the name or title.
+ * @return Score, or -1 if a word is missing
+ */
+static int score_text(const char *text, const QueryWord *words, int count) {
+    int score = 0;
+    for (int w = 0; w < count; w++) {
+        const char *hit = strstr(text, words[w].text);
+        if (hit) {
+            hit++;
+            score += 2;
+        } else if (!words[w].anywhere || !(hit = strstr(text, words[w].text + 1))) {
+            return -1;
+        }
+
+        int bars = 0;
+        for (const char *p = text; p < hit; p++) {
+            if (*p == '|') bars++;
+        }
+        if (bars <= 1) score++;
+    }
+    return score;
+}
+
+/**
+ * Fill a hit from a document (caller holds g_mutex)
+ */
+static void fill_hit(SearchHit *hit, const SearchDoc *d) {
+    doc_path(d, hit->path, sizeof(hit->path));
+
+    if (d->title) {
+        snprintf(hit->title, sizeof(hit->title), "%s", STR(d->title));
+    } else {
+        snprintf(hit->title, sizeof(hit->title), "%s", STR(d->name));
+        char *dot = strrchr(hit->title, '.');
+        if (dot && dot != hit->title) *dot = '\0';
+    }
+
+    if (d->artist && d->album) {
+        snprintf(hit->detail, sizeof(hit->detail), "%s - %s", STR(d->artist), STR(d->album));
+    } else if (d->artist || d->album) {
+        snprintf(hit->detail, sizeof(hit->detail), "%s", STR(d->artist ? d->artist : d->album));
+    } else {
+        const char *dir_path = STR(g_index.dirs[d->dir].path);
+        const char *folder = strrchr(dir_path, '/');
+        snprintf(hit->detail, sizeof(hit->detail), "%s", folder ? folder + 1 : dir_path);
+    }
+}
+
+int searchindex_query(const char *query, SearchHit *hits, int max_hits) {
+    if (!query || !hits || max_hits <= 0) return 0;
+    if (max_hits > SEARCHINDEX_MAX_HITS) max_hits = SEARCHINDEX_MAX_HITS;
+
+    // Split the folded query into words
+    char folded[256];
+    fold_append(folded, 0, sizeof(folded), query);
+    QueryWord words[SEARCH_MAX_WORDS];
+    int word_count = 0;
+    char *save = NULL;
+    for (char *w = strtok_r(folded, " ", &save); w && word_count < SEARCH_MAX_WORDS;
+         w = strtok_r(NULL, " ", &save)) {
+        snprintf(words[word_count].text, sizeof(words[0].text), " %.*s", SEARCH_MAX_WORD, w);
+        words[word_count].anywhere = strlen(w) >= 3;
+        word_count++;
+    }
+    if (word_count == 0) return 0;
+
+    pthread_mutex_lock(&g_mutex);
+    if (!g_index.lists) {
+        pthread_mutex_unlock(&g_mutex);
+        return 0;
+    }
+
+    // Lists of every trigram a match must contain (" xy" for short words)
+    const PostingList *lists[SEARCH_MAX_WORDS * SEARCH_MAX_WORD];
+    int list_count = 0;
+    for (int w = 0; w < word_count; w++) {
+        const char *t = words[w].anywhere ? words[w].text + 1 : words[w].text;
+        for (; t[0] && t[1] && t[2]; t++) {
+            const PostingList *l = &g_index.lists[trigram_at(t)];
+            if (l->count == 0) {
+                pthread_mutex_unlock(&g_mutex);
+                return 0;
+            }
+            lists[list_count++] = l;
+        }
+    }
+
+    // Intersect from the shortest list up
+    for (int i = 1; i < list_count; i++) {
+        const PostingList *l = lists[i];
+        int j = i;
+        while (j > 0 && lists[j - 1]->count > l->count) {
+            lists[j] = lists[j - 1];
+            j--;
+        }
+        lists[j] = l;
+    }
+    uint32_t n = list_count > 0 ? lists[0]->count : g_index.doc_count;
+    if (n > g_candidate_capacity) {
+        uint32_t *grown = realloc(g_candidates, n * sizeof(uint32_t));
+        if (!grown) {
+            pthread_mutex_unlock(&g_mutex);
+            return 0;
+        }
+        g_candidates = grown;
+        g_candidate_capacity = n;
+    }
+    if (list_count > 0) {
+        memcpy(g_candidates, lists[0]->ids, n * sizeof(uint32_t));
+        for (int i = 1; i < list_count && n > 0; i++) n = intersect(g_candidates, n, lists[i]);
+    } else {
+        for (uint32_t i = 0; i < n; i++) g_candidates[i] = i;
+    }
+
+    // Verify and keep the best max_hits (stable: listing order breaks ties)
+    uint32_t top[SEARCHINDEX_MAX_HITS];
+    int top_score[SEARCHINDEX_MAX_HITS];
+    int top_count = 0;
+    int matches = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const SearchDoc *d = &g_index.docs[g_candidates[i]];
+        if (!(d->flags & DOC_ALIVE)) continue;
+        int score = score_text(STR(d->text), words, word_count);
+        if (score < 0) continue;
+        matches++;
+
+        if (top_count == max_hits && score <= top_score[top_count - 1]) continue;
+        int pos = top_count < max_hits ? top_count++ : max_hits - 1;
+        while (pos > 0 && top_score[pos - 1] < score) {
+            top[pos] = top[pos - 1];
+            top_score[pos] = top_score[pos - 1];
+            pos--;
+        }
+        top[pos] = g_candidates[i];
+        top_score[pos] = score;
+    }
+
+    for (int i = 0; i < top_count; i++) fill_hit(&hits[i], &g_index.docs[top[i]]);
+    pthread_mutex_unlock(&g_mutex);
+    return matches;
+}
+
+int searchindex_count(void) {
+    pthread_mutex_lock(&g_mutex);
+    int count = (int)(g_index.doc_count - g_index.dead);
+    pthread_mutex_unlock(&g_mutex);
+    return count;
+}
@@ -0,0 +1,69 @@
+/**
+ * Search Index - Trigram index over every track in the library
+ *
+ * Each audio file gets one search text: its name, its title/artist/album
+ * tags and the names of its two enclosing folders, folded to lowercase
+ * ASCII. Every trigram of that text points at the file through a sorted
+ * posting list, so a query only verifies the files that hold all of its
+ * trigrams. The index follows the library index (library.h) a directory
+ * at a time, picks up tags in the background (metadata cache first, then
+ * the file's own tags) and is saved to the data directory, so a boot
+ * starts from the saved lists instead of rebuilding them.
+ */
+
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <stdbool.h>
+
+// Most results a query returns (the total match count is still reported)
+#define SEARCHINDEX_MAX_HITS 100
+
+/**
+ * One query result
+ */
+typedef struct {
+    char path[512];         // Full path of the audio file
+    char title[256];        // Title tag, or the file name without extension
+    char detail[256];       // "Artist - Album" when tagged, else the folder name
+} SearchHit;
+
+/**
+ * Load the saved index and start following the library
+ * Call before library_init() so the saved library listings are seen too.
+ * @param base_path Music root (folder names above it aren't indexed)
+ * @return 0 on success (an empty index is fine), -1 if out of memory
+ */
+int searchindex_init(const char *base_path);
+
+/**
+ * Stop tagging and save the index if it changed
+ * Call after library_cleanup().
+ */
+void searchindex_cleanup(void);
+
+/**
+ * Find tracks matching every word of a query
+ * Words of three letters or more match anywhere, shorter words match the
+ * start of a word. Hits that match at word starts, in the name or the
+ * title come first.
+ * @param query Search text (any case; accents are folded)
+ * @param hits Output array
+ * @param max_hits Size of hits (at most SEARCHINDEX_MAX_HITS are filled)
+ * @return Number of matching tracks (may exceed max_hits), 0 if none
+ */
+int searchindex_query(const char *query, SearchHit *hits, int max_hits);
+
+/**
+ * Read the tags of tracks indexed without them, in the background
+ * Runs batches of background-class jobs until every track is tagged.
+ * Main thread.
+ */
+void searchindex_enrich(void);
+
+/**
+ * Number of tracks in the index
+ */
+int searchindex_count(void);
+
+#endif // SEARCHINDEX_H
@@ -0,0 +1,144 @@
+/**
+ * Shuffle Implementation
+ *
+ * Fisher-Yates over the playlist's items. The following cycle is shuffled
+ * as soon as someone peeks past the end of the current one, so the peeked
+ * item (already being preloaded) is the one that really plays next.
+ * Main thread only.
+ */
+
+#include "shuffle.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char g_key[512] = {0};
+static int *g_order = NULL;         // Current cycle
+static int *g_next = NULL;          // Following cycle (valid if g_next_ready)
+static int *g_items = NULL;         // Items as passed in, to detect changes
+static int g_count = 0;
+static int g_capacity = 0;
+static int g_pos = -1;              // Index of the playing item in g_order
+static bool g_next_ready = false;
+
+/**
+ * Shuffle into a permutation of the items
+ */
+static void permute(int *out) {
+    memcpy(out, g_items, g_count * sizeof(int));
+    for (int i = g_count - 1; i > 0; i--) {
+        int j = rand() % (i + 1);
+        int tmp = out[i];
+        out[i] = out[j];
+        out[j] = tmp;
+    }
+}
+
+/**
+ * Move an item to a slot of a cycle (swapping with what was there)
+ * @return false if the item isn't in the cycle
+ */
+static bool place(int *order, int slot, int item) {
+    for (int i = 0; i < g_count; i++) {
+        if (order[i] == item) {
+            order[i] = order[slot];
+            order[slot] = item;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Grow the arrays to hold count items
+ */
+static bool reserve(int count) {
+    if (count <= g_capacity) return true;
+
+    int *order = realloc(g_order, count * sizeof(int));
+    if (order) g_order = order;
+    int *next = realloc(g_next, count * sizeof(int));
+    if (next) g_next = next;
+    int *items = realloc(g_items, count * sizeof(int));
+    if (items) g_items = items;
+    if (!order || !next || !items) return false;
+
+    g_capacity = count;
+    return true;
+}
+
+void shuffle_sync(const char *key, const int *items, int count, int current) {
+    bool same = g_count == count && count > 0 && strcmp(g_key, key) == 0 &&
+                memcmp(g_items, items, count * sizeof(int)) == 0;
+
+    if (!same) {
+        if (count <= 0 || !reserve(count)) {
+            shuffle_reset();
+            return;
+        }
+        strncpy(g_key, key, sizeof(g_key) - 1);
+        g_key[sizeof(g_key) - 1] = '\0';
+        memcpy(g_items, items, count * sizeof(int));
+        g_count = count;
+
+        permute(g_order);
+        g_pos = 0;
+        g_next_ready = false;
+        if (current >= 0) place(g_order, 0, current);
+        printf("[SHUFFLE] New order: %d tracks\n", count);
+        return;
+    }
+
+    if (current < 0 || g_order[g_pos] == current) return;
+
+    // Picked by hand: it takes the playing slot; a later slot if unplayed
+    if (g_pos + 1 < g_count) {
+        g_pos++;
+        place(g_order, g_pos, current);
+    } else {
+        place(g_order, g_pos, current);
+    }
+    g_next_ready = false;
+}
+
+int shuffle_peek(void) {
+    if (g_count <= 0 || g_pos < 0) return -1;
+    if (g_pos + 1 < g_count) return g_order[g_pos + 1];
+
+    // End of the cycle: the next one is shuffled now, so the preload holds
+    if (!g_next_ready) {
+        permute(g_next);
+        int playing = g_order[g_pos];
+        if (g_count > 1 && g_next[0] == playing) {
+            // Never the same track twice in a row across cycles
+            int swap = 1 + rand() % (g_count - 1);
+            g_next[0] = g_next[swap];
+            g_next[swap] = playing;
+        }
+        g_next_ready = true;
+    }
+    return g_next[0];
+}
+
+int shuffle_advance(void) {
+    int item = shuffle_peek();
+    if (item < 0) return -1;
+
+    if (g_pos + 1 < g_count) {
+        g_pos++;
+    } else {
+        int *tmp = g_order;
+        g_order = g_next;
+        g_next = tmp;
+        g_next_ready = false;
+        g_pos = 0;
+    }
+    return item;
+}
+
+void shuffle_reset(void) {
+    g_key[0] = '\0';
+    g_count = 0;
+    g_pos = -1;
+    g_next_ready = false;
+}
@@ -0,0 +1,48 @@
+/**
+ * Shuffle - Non-repeating play order for shuffle mode
+ *
+ * Keeps a per-session permutation of a playlist's tracks (the browser
+ * folder's files, or the favorites) so every track plays once per cycle
+ * and the next one is known before the current one ends. The player
+ * asks shuffle_peek() for the track to preload and shuffle_advance() at
+ * the transition, so shuffle is as gapless as sequential playback.
+ * Items are the caller's own indices (browser entries, favorites).
+ */
+
+#ifndef SHUFFLE_H
+#define SHUFFLE_H
+
+#include <stdbool.h>
+
+/**
+ * Use an order for a playlist, building a new one if it changed
+ * The order is kept while key and item list are unchanged; otherwise a
+ * new permutation starts at current. A current item played out of order
+ * (picked by hand) takes the next slot of the cycle.
+ * @param key Playlist identity, e.g. the folder path
+ * @param items Playable items (caller's indices, no duplicates)
+ * @param count Number of items
+ * @param current Item playing now (-1 if none)
+ */
+void shuffle_sync(const char *key, const int *items, int count, int current);
+
+/**
+ * Item that plays after the current one (O(1))
+ * At the end of a cycle this is the first item of the next one, which
+ * never repeats the item that just played.
+ * @return Item, or -1 if there is no order
+ */
+int shuffle_peek(void);
+
+/**
+ * Move to the next item (the one shuffle_peek() returned)
+ * @return Item, or -1 if there is no order
+ */
+int shuffle_advance(void);
+
+/**
+ * Forget the order (next sync starts a new one)
+ */
+void shuffle_reset(void);
+
+#endif // SHUFFLE_H
@@ -0,0 +1,218 @@
+/**
+ * Resume Snapshot Implementation
+ *
+ * One binary file in the data directory, replaced through the persist
+ * writer: a fixed header (with the TrackInfo as is, so the version goes
+ * up whenever that struct changes), then the three paths, the listing's
+ * names and types, and the cover's RGBA pixels.
+ *
+ * Only the track file is checked on load (one stat: size and mtime). The
+ * listing and the cover are shown as saved and corrected by the normal
+ * library and cover loads once those have run.
+ */
+
+#include "snapshot.h"
+#include "browser.h"
+#include "cover.h"
+#include "state.h"
+#include "persist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define SNAPSHOT_FILENAME "resume.snap"
+#define SNAPSHOT_MAGIC    0x4E53524D  // "MRSN"
+#define SNAPSHOT_VERSION  1
+#define SNAPSHOT_MAX_ENTRIES 20000
+
+/**
+ * File header, followed by the paths, names, types and cover pixels
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int64_t track_size;
+    int64_t track_mtime;
+    int32_t cursor;
+    int32_t count;
+    uint32_t names_size;
+    uint16_t track_len;
+    uint16_t folder_len;
+    uint16_t cover_dir_len;
+    uint16_t cover_w;
+    uint16_t cover_h;
+    uint8_t cover_dark;
+    uint8_t on_player;
+    TrackInfo track;
+} SnapHeader;
+
+/**
+ * Build the snapshot file path in the data directory
+ */
+static bool snapshot_path(char *out, size_t size) {
+    const char *data_dir = state_get_data_dir();
+    if (!data_dir || !data_dir[0]) return false;
+    snprintf(out, size, "%s/%s", data_dir, SNAPSHOT_FILENAME);
+    return true;
+}
+
+bool snapshot_save(const char *track_path, bool on_player) {
+    char path[512];
+    struct stat st;
+    if (!track_path || !track_path[0] || !snapshot_path(path, sizeof(path)) ||
+        stat(track_path, &st) != 0) {
+        return false;
+    }
+
+    const char *folder = browser_get_current_path();
+    const unsigned char *cover = NULL;
+    const char *cover_dir = "";
+    int cover_w = 0, cover_h = 0;
+    bool cover_dark = true;
+    if (!cover_get_thumbnail(&cover, &cover_w, &cover_h, &cover_dark, &cover_dir)) {
+        cover = NULL;
+        cover_w = cover_h = 0;
+    }
+
+    // Listing without "..", which the browser adds back by itself
+    int count = 0;
+    int cursor = browser_get_cursor();
+    size_t names_size = 0;
+    for (int i = 0; i < browser_get_count(); i++) {
+        const FileEntry *entry = browser_get_entry(i);
+        if (entry->type == ENTRY_PARENT) {
+            if (i <= browser_get_cursor()) cursor--;  // -1 if ".." is selected
+            continue;
+        }
+        names_size += strlen(entry->name) + 1;
+        count++;
+    }
+    if (count > SNAPSHOT_MAX_ENTRIES) return false;
+
+    SnapHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SNAPSHOT_MAGIC;
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.track_size = (int64_t)st.st_size;
+    hdr.track_mtime = (int64_t)st.st_mtime;
+    hdr.cursor = cursor;
+    hdr.count = count;
+    hdr.names_size = (uint32_t)names_size;
+    hdr.track_len = (uint16_t)strlen(track_path);
+    hdr.folder_len = (uint16_t)strlen(folder);
+    hdr.cover_dir_len = (uint16_t)strlen(cover_dir);
+    hdr.cover_w = (uint16_t)cover_w;
+    hdr.cover_h = (uint16_t)cover_h;
+    hdr.cover_dark = cover_dark ? 1 : 0;
+    hdr.on_player = on_player ? 1 : 0;
+    hdr.track = *audio_get_track_info();
+
+    size_t cover_size = (size_t)cover_w * cover_h * 4;
+    size_t size = sizeof(hdr) + hdr.track_len + hdr.folder_len + hdr.cover_dir_len +
+                  names_size + (size_t)count + cover_size;
+    unsigned char *buf = malloc(size);
+    if (!buf) return false;
+
+    unsigned char *p = buf;
+    memcpy(p, &hdr, sizeof(hdr));                   p += sizeof(hdr);
+    memcpy(p, track_path, hdr.track_len);           p += hdr.track_len;
+    memcpy(p, folder, hdr.folder_len);              p += hdr.folder_len;
+    memcpy(p, cover_dir, hdr.cover_dir_len);        p += hdr.cover_dir_len;
+    unsigned char *types = p + names_size;
+    int n = 0;
+    for (int i = 0; i < browser_get_count(); i++) {
+        const FileEntry *entry = browser_get_entry(i);
+        if (entry->type == ENTRY_PARENT) continue;
+        size_t len = strlen(entry->name) + 1;
+        memcpy(p, entry->name, len);
+        p += len;
+        types[n++] = (entry->type == ENTRY_DIRECTORY) ? 1 : 0;
+    }
+    p += count;
+    if (cover_size) memcpy(p, cover, cover_size);
+
+    bool queued = persist_write(path, buf, size);
+    free(buf);
+    printf("[SNAPSHOT] Saved %s (%d entries, %dx%d cover)\n", track_path, count, cover_w, cover_h);
+    return queued;
+}
+
+/**
+ * Read a length-prefixed string into a fixed buffer
+ */
+static bool read_string(FILE *f, char *out, size_t size, uint16_t len) {
+    if (len >= size || fread(out, 1, len, f) != len) return false;
+    out[len] = '\0';
+    return true;
+}
+
+bool snapshot_load(const char *track_path, ResumeSnapshot *snap) {
+    memset(snap, 0, sizeof(*snap));
+
+    char path[512];
+    struct stat st;
+    if (!track_path || !track_path[0] || !snapshot_path(path, sizeof(path)) ||
+        stat(track_path, &st) != 0) {
+        return false;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    SnapHeader hdr;
+    bool ok = fread(&hdr, sizeof(hdr), 1, f) == 1 &&
+              hdr.magic == SNAPSHOT_MAGIC && hdr.version == SNAPSHOT_VERSION &&
+              hdr.track_size == (int64_t)st.st_size && hdr.track_mtime == (int64_t)st.st_mtime &&
+              hdr.count >= 0 && hdr.count <= SNAPSHOT_MAX_ENTRIES &&
+              read_string(f, snap->track_path, sizeof(snap->track_path), hdr.track_len) &&
+              strcmp(snap->track_path, track_path) == 0 &&
+              read_string(f, snap->folder, sizeof(snap->folder), hdr.folder_len) &&
+              read_string(f, snap->cover_dir, sizeof(snap->cover_dir), hdr.cover_dir_len);
+
+    if (ok) {
+        size_t cover_size = (size_t)hdr.cover_w * hdr.cover_h * 4;
+        snap->names = malloc(hdr.names_size ? hdr.names_size : 1);
+        snap->is_dir = malloc(hdr.count ? (size_t)hdr.count : 1);
+        snap->cover = cover_size ? malloc(cover_size) : NULL;
+        ok = snap->names && snap->is_dir && (!cover_size || snap->cover) &&
+             fread(snap->names, 1, hdr.names_size, f) == hdr.names_size &&
+             fread(snap->is_dir, 1, (size_t)hdr.count, f) == (size_t)hdr.count &&
+             (!cover_size || fread(snap->cover, 1, cover_size, f) == cover_size);
+    }
+
+    // Names must be exactly count NUL-terminated strings
+    if (ok) {
+        int terminators = 0;
+        for (uint32_t i = 0; i < hdr.names_size; i++) {
+            if (snap->names[i] == '\0') terminators++;
+        }
+        ok = terminators == hdr.count && (hdr.names_size == 0 || snap->names[hdr.names_size - 1] == '\0');
+    }
+    fclose(f);
+
+    if (!ok) {
+        snapshot_free(snap);
+        return false;
+    }
+
+    snap->track = hdr.track;
+    snap->track.title[sizeof(snap->track.title) - 1] = '\0';
+    snap->track.artist[sizeof(snap->track.artist) - 1] = '\0';
+    snap->track.album[sizeof(snap->track.album) - 1] = '\0';
+    snap->cursor = hdr.cursor;
+    snap->on_player = hdr.on_player != 0;
+    snap->count = hdr.count;
+    snap->cover_w = snap->cover ? hdr.cover_w : 0;
+    snap->cover_h = snap->cover ? hdr.cover_h : 0;
+    snap->cover_dark = hdr.cover_dark != 0;
+    return true;
+}
+
+void snapshot_free(ResumeSnapshot *snap) {
+    free(snap->names);
+    free(snap->is_dir);
+    free(snap->cover);
+    memset(snap, 0, sizeof(*snap));
+}
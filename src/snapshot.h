@@ -0,0 +1,60 @@
+/**
+ * Resume Snapshot - What the player screen showed when the last session ended
+ *
+ * Written at exit and before suspend next to state.json: the browser's
+ * sorted listing, the track info on screen, a small cover thumbnail with
+ * its brightness flag and the track file's size and mtime. On launch the
+ * previous screen is drawn from it before the library, tags and cover
+ * are loaded; those still load as usual and replace it as they arrive.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include "audio.h"
+
+/**
+ * Loaded snapshot (free with snapshot_free)
+ */
+typedef struct {
+    char track_path[512];       // Track on screen
+    char folder[512];           // Browser folder
+    char cover_dir[512];        // Folder the cover came from
+    TrackInfo track;            // Title, artist, album, duration, position
+    int cursor;                 // Browser cursor, not counting ".." (-1 on it)
+    bool on_player;             // Session ended on the player screen
+    int count;                  // Listing entries (".." not included)
+    char *names;                // count NUL-terminated names, back to back
+    unsigned char *is_dir;      // Per entry: 1 for a folder
+    unsigned char *cover;       // RGBA thumbnail, NULL if there was no cover
+    int cover_w;
+    int cover_h;
+    bool cover_dark;
+} ResumeSnapshot;
+
+/**
+ * Save the current screen's snapshot (in the background, see persist.h)
+ * Reads the browser, the loaded track and the cover; call before
+ * browser_cleanup() and cover_cleanup().
+ * @param track_path Track being played, or NULL/empty for none (nothing saved)
+ * @param on_player true if the player screen is showing
+ * @return true if queued
+ */
+bool snapshot_save(const char *track_path, bool on_player);
+
+/**
+ * Load the snapshot if it still describes the given track
+ * @param track_path Track the saved state resumes
+ * @param snap Output (zeroed on failure)
+ * @return false if missing, corrupt, for another track, or the track
+ *         file changed since
+ */
+bool snapshot_load(const char *track_path, ResumeSnapshot *snap);
+
+/**
+ * Free a loaded snapshot's buffers
+ */
+void snapshot_free(ResumeSnapshot *snap);
+
+#endif // SNAPSHOT_H
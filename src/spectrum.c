@@ -0,0 +1,293 @@
+/**
+ * Spectrum Implementation - Lock-free PCM tap and radix-2 FFT
+ *
+ * Audio thread: each post-mix buffer is folded to mono and halved to
+ * 22050 Hz (pairs averaged, which is lowpass enough for bars) into an
+ * int16 ring. The audio thread alone writes the ring and publishes its
+ * running write count with an atomic store every SPECTRUM_TAP_BLOCK
+ * samples, so a reader never sees a count ahead of the data.
+ *
+ * UI thread: copies the newest SPECTRUM_FFT_SIZE samples out, then reads
+ * the count again; if the writer may have lapped the copied span, the
+ * frame is dropped and the bars just keep falling. The copy is Hann
+ * windowed into split real/imag arrays in bit-reversed order and run
+ * through an in-place radix-2 FFT whose per-stage twiddles are stored
+ * contiguously, four butterflies per NEON op on ARM; scalar elsewhere.
+ *
+ * Bars pick the loudest bin of a log-spaced band from 60 Hz to 11 kHz, in
+ * dB from SPECTRUM_FLOOR_DB to full scale. They jump up at once and fall
+ * at SPECTRUM_FALL_PER_SEC, timed by the clock, so a capped update rate
+ * changes neither how fast they fall nor what the audio thread does.
+ */
+
+#include "spectrum.h"
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#define SPECTRUM_RING_SIZE    8192    // Mono samples (~370ms at 22050 Hz), power of two
+#define SPECTRUM_RING_MASK    (SPECTRUM_RING_SIZE - 1)
+#define SPECTRUM_TAP_BLOCK    256     // Samples written between publishes
+#define SPECTRUM_TAP_RATE     22050.0f
+#define SPECTRUM_LOW_HZ       60.0f
+#define SPECTRUM_HIGH_HZ      11000.0f
+#define SPECTRUM_FLOOR_DB     -60.0f
+#define SPECTRUM_FALL_PER_SEC 1.5f    // Bar heights per second
+#define SPECTRUM_FFT_BITS     10
+
+// Ring (written by the audio thread only)
+static int16_t g_ring[SPECTRUM_RING_SIZE];
+static SDL_atomic_t g_write_count;            // Samples written, wraps
+static SDL_atomic_t g_active;
+static int g_tap_carry = 0;                   // Audio thread only
+static bool g_tap_odd = false;
+
+// Tables (built once by spectrum_init)
+static float g_window[SPECTRUM_FFT_SIZE];     // Hann, scaled to full-scale S16
+static float g_twiddle_re[SPECTRUM_FFT_SIZE]; // Stage with half-size h at [h - 1]
+static float g_twiddle_im[SPECTRUM_FFT_SIZE];
+static uint16_t g_bitrev[SPECTRUM_FFT_SIZE];
+static int g_bar_lo[SPECTRUM_BARS];           // First bin of each bar
+static int g_bar_hi[SPECTRUM_BARS];           // One past the last bin
+static float g_ref_power = 1.0f;              // Peak bin power of a full-scale sine
+
+// UI thread state
+static float g_re[SPECTRUM_FFT_SIZE];
+static float g_im[SPECTRUM_FFT_SIZE];
+static int16_t g_snapshot[SPECTRUM_FFT_SIZE];
+static float g_bars[SPECTRUM_BARS];
+static unsigned g_start_count = 0;            // Write count when tapping started
+static Uint32 g_last_update = 0;
+static Uint32 g_last_fall = 0;
+static int g_interval_ms = 0;
+
+void spectrum_init(void) {
+    const double pi = 3.14159265358979323846;
+
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+        double hann = 0.5 - 0.5 * cos(2.0 * pi * i / (SPECTRUM_FFT_SIZE - 1));
+        g_window[i] = (float)(hann / 32768.0);
+
+        unsigned rev = 0;
+        for (int b = 0; b < SPECTRUM_FFT_BITS; b++) {
+            if (i & (1 << b)) rev |= 1u << (SPECTRUM_FFT_BITS - 1 - b);
+        }
+        g_bitrev[i] = (uint16_t)rev;
+    }
+
+    for (int half = 1; half < SPECTRUM_FFT_SIZE; half <<= 1) {
+        for (int k = 0; k < half; k++) {
+            double angle = -pi * k / half;
+            g_twiddle_re[half - 1 + k] = (float)cos(angle);
+            g_twiddle_im[half - 1 + k] = (float)sin(angle);
+        }
+    }
+
+    // Hann's coherent gain is 1/2, so a full-scale sine peaks at N/4
+    float peak = SPECTRUM_FFT_SIZE / 4.0f;
+    g_ref_power = peak * peak;
+
+    // Log-spaced bands, at least one bin each and never overlapping
+    float bin_hz = SPECTRUM_TAP_RATE / SPECTRUM_FFT_SIZE;
+    float ratio = SPECTRUM_HIGH_HZ / SPECTRUM_LOW_HZ;
+    int prev_hi = 1;
+    for (int i = 0; i < SPECTRUM_BARS; i++) {
+        float lo_hz = SPECTRUM_LOW_HZ * powf(ratio, (float)i / SPECTRUM_BARS);
+        float hi_hz = SPECTRUM_LOW_HZ * powf(ratio, (float)(i + 1) / SPECTRUM_BARS);
+        int lo = (int)(lo_hz / bin_hz + 0.5f);
+        int hi = (int)(hi_hz / bin_hz + 0.5f);
+        if (lo < prev_hi) lo = prev_hi;
+        if (hi <= lo) hi = lo + 1;
+        if (hi > SPECTRUM_FFT_SIZE / 2) hi = SPECTRUM_FFT_SIZE / 2;
+        if (lo >= hi) lo = hi - 1;
+        g_bar_lo[i] = lo;
+        g_bar_hi[i] = hi;
+        prev_hi = hi;
+    }
+
+    memset(g_bars, 0, sizeof(g_bars));
+    SDL_AtomicSet(&g_active, 0);
+    printf("[SPECTRUM] %d-point FFT, %d bars (%s)\n", SPECTRUM_FFT_SIZE, SPECTRUM_BARS,
+#ifdef __ARM_NEON
+           "NEON"
+#else
+           "scalar"
+#endif
+           );
+}
+
+void spectrum_tap(const int16_t *stereo, int frames) {
+    if (!SDL_AtomicGet(&g_active)) return;
+
+    unsigned count = (unsigned)SDL_AtomicGet(&g_write_count);
+    int unpublished = 0;
+    for (int i = 0; i < frames; i++) {
+        int mono = stereo[i * 2] + stereo[i * 2 + 1];
+        if (!g_tap_odd) {
+            g_tap_carry = mono;
+            g_tap_odd = true;
+            continue;
+        }
+        g_ring[count & SPECTRUM_RING_MASK] = (int16_t)((g_tap_carry + mono) / 4);
+        g_tap_odd = false;
+        count++;
+        if (++unpublished == SPECTRUM_TAP_BLOCK) {
+            SDL_AtomicSet(&g_write_count, (int)count);
+            unpublished = 0;
+        }
+    }
+    if (unpublished) SDL_AtomicSet(&g_write_count, (int)count);
+}
+
+void spectrum_set_active(bool active) {
+    if (active == spectrum_is_active()) return;
+
+    if (active) {
+        g_start_count = (unsigned)SDL_AtomicGet(&g_write_count);
+        g_last_update = 0;
+        g_last_fall = SDL_GetTicks();
+    } else {
+        memset(g_bars, 0, sizeof(g_bars));
+    }
+    SDL_AtomicSet(&g_active, active ? 1 : 0);
+}
+
+bool spectrum_is_active(void) {
+    return SDL_AtomicGet(&g_active) != 0;
+}
+
+void spectrum_set_max_rate(int max_hz) {
+    g_interval_ms = (max_hz > 0) ? 1000 / max_hz : 0;
+}
+
+int spectrum_get_interval_ms(void) {
+    return g_interval_ms;
+}
+
+const float* spectrum_get_bars(void) {
+    return g_bars;
+}
+
+/**
+ * In-place radix-2 FFT over g_re/g_im (input already in bit-reversed order)
+ */
+static void fft_run(void) {
+    for (int half = 1; half < SPECTRUM_FFT_SIZE; half <<= 1) {
+        const float *tw_re = &g_twiddle_re[half - 1];
+        const float *tw_im = &g_twiddle_im[half - 1];
+        int len = half * 2;
+
+#ifdef __ARM_NEON
+        if (half >= 4) {
+            for (int j = 0; j < SPECTRUM_FFT_SIZE; j += len) {
+                float *a_re = &g_re[j], *a_im = &g_im[j];
+                float *b_re = &g_re[j + half], *b_im = &g_im[j + half];
+                for (int k = 0; k < half; k += 4) {
+                    float32x4_t w_re = vld1q_f32(tw_re + k);
+                    float32x4_t w_im = vld1q_f32(tw_im + k);
+                    float32x4_t x_re = vld1q_f32(b_re + k);
+                    float32x4_t x_im = vld1q_f32(b_im + k);
+                    float32x4_t t_re = vmlsq_f32(vmulq_f32(x_re, w_re), x_im, w_im);
+                    float32x4_t t_im = vmlaq_f32(vmulq_f32(x_re, w_im), x_im, w_re);
+                    float32x4_t u_re = vld1q_f32(a_re + k);
+                    float32x4_t u_im = vld1q_f32(a_im + k);
+                    vst1q_f32(a_re + k, vaddq_f32(u_re, t_re));
+                    vst1q_f32(a_im + k, vaddq_f32(u_im, t_im));
+                    vst1q_f32(b_re + k, vsubq_f32(u_re, t_re));
+                    vst1q_f32(b_im + k, vsubq_f32(u_im, t_im));
+                }
+            }
+            continue;
+        }
+#endif
+
+        for (int j = 0; j < SPECTRUM_FFT_SIZE; j += len) {
+            for (int k = 0; k < half; k++) {
+                int a = j + k;
+                int b = a + half;
+                float t_re = g_re[b] * tw_re[k] - g_im[b] * tw_im[k];
+                float t_im = g_re[b] * tw_im[k] + g_im[b] * tw_re[k];
+                g_re[b] = g_re[a] - t_re;
+                g_im[b] = g_im[a] - t_im;
+                g_re[a] += t_re;
+                g_im[a] += t_im;
+            }
+        }
+    }
+}
+
+/**
+ * Window and transform a block, then write each bar's level (0..1)
+ */
+static void analyze(const int16_t *samples, float *levels) {
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+        int dst = g_bitrev[i];
+        g_re[dst] = samples[i] * g_window[i];
+        g_im[dst] = 0.0f;
+    }
+
+    fft_run();
+
+    for (int i = 0; i < SPECTRUM_BARS; i++) {
+        float power = 0.0f;
+        for (int bin = g_bar_lo[i]; bin < g_bar_hi[i]; bin++) {
+            float p = g_re[bin] * g_re[bin] + g_im[bin] * g_im[bin];
+            if (p > power) power = p;
+        }
+
+        float level = 0.0f;
+        if (power > 0.0f) {
+            float db = 10.0f * log10f(power / g_ref_power);
+            level = (db - SPECTRUM_FLOOR_DB) / -SPECTRUM_FLOOR_DB;
+            if (level < 0.0f) level = 0.0f;
+            if (level > 1.0f) level = 1.0f;
+        }
+        levels[i] = level;
+    }
+}
+
+void spectrum_analyze(const int16_t *samples) {
+    analyze(samples, g_bars);
+}
+
+bool spectrum_update(void) {
+    if (!spectrum_is_active()) return false;
+
+    // Bars fall by the clock, whether or not a new block is analyzed
+    Uint32 now = SDL_GetTicks();
+    float fall = (now - g_last_fall) * (SPECTRUM_FALL_PER_SEC / 1000.0f);
+    g_last_fall = now;
+    for (int i = 0; i < SPECTRUM_BARS; i++) {
+        g_bars[i] = (g_bars[i] > fall) ? g_bars[i] - fall : 0.0f;
+    }
+
+    bool due = (g_last_update == 0 || now - g_last_update >= (Uint32)g_interval_ms);
+    unsigned end = (unsigned)SDL_AtomicGet(&g_write_count);
+    if (due && end - g_start_count >= SPECTRUM_FFT_SIZE) {
+        unsigned begin = end - SPECTRUM_FFT_SIZE;
+        for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+            g_snapshot[i] = g_ring[(begin + i) & SPECTRUM_RING_MASK];
+        }
+
+        // Writer lapped the span while it was copied: skip this block
+        unsigned after = (unsigned)SDL_AtomicGet(&g_write_count);
+        if (after - end <= SPECTRUM_RING_SIZE - SPECTRUM_FFT_SIZE - SPECTRUM_TAP_BLOCK) {
+            float levels[SPECTRUM_BARS];
+            analyze(g_snapshot, levels);
+            for (int i = 0; i < SPECTRUM_BARS; i++) {
+                if (levels[i] > g_bars[i]) g_bars[i] = levels[i];
+            }
+            g_last_update = now ? now : 1;
+        }
+    }
+
+    for (int i = 0; i < SPECTRUM_BARS; i++) {
+        if (g_bars[i] > 0.0f) return true;
+    }
+    return false;
+}
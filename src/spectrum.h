@@ -0,0 +1,76 @@
+/**
+ * Spectrum - Bar spectrum of the audio being played
+ *
+ * The post-mix callback taps a mono, half-rate copy of every buffer into
+ * a lock-free ring (spectrum_tap()); the UI thread windows the newest
+ * SPECTRUM_FFT_SIZE samples, runs a float FFT over them and folds the
+ * bins into log-spaced bars. The tap is a single atomic load while the
+ * spectrum is not on screen.
+ */
+
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SPECTRUM_BARS     24
+#define SPECTRUM_FFT_SIZE 1024
+
+/**
+ * Build the window, twiddle and bar tables
+ * Call once before the first spectrum_update().
+ */
+void spectrum_init(void);
+
+/**
+ * Copy a post-mix buffer into the ring (audio thread)
+ * Returns at once unless the spectrum is active.
+ * @param stereo Interleaved stereo S16 samples at 44100 Hz
+ * @param frames Number of stereo frames
+ */
+void spectrum_tap(const int16_t *stereo, int frames);
+
+/**
+ * Start or stop tapping audio
+ * Only active while the bars are on screen; stopping clears the bars.
+ */
+void spectrum_set_active(bool active);
+
+/**
+ * Check whether audio is being tapped
+ */
+bool spectrum_is_active(void);
+
+/**
+ * Limit how often the bars are recomputed
+ * @param max_hz Updates per second, 0 to follow the frame rate
+ */
+void spectrum_set_max_rate(int max_hz);
+
+/**
+ * Recompute the bars from the newest audio if an update is due (UI thread)
+ * @return true while any bar is above zero (keep redrawing)
+ */
+bool spectrum_update(void);
+
+/**
+ * Get the bar heights, low to high frequency
+ * @return SPECTRUM_BARS values from 0.0 to 1.0
+ */
+const float* spectrum_get_bars(void);
+
+/**
+ * Get the time between updates
+ * @return Milliseconds, 0 when following the frame rate
+ */
+int spectrum_get_interval_ms(void);
+
+/**
+ * Run the FFT over a block of samples into the bars (benchmark harness)
+ * Skips the ring, the rate limit and the smoothing.
+ * @param samples SPECTRUM_FFT_SIZE mono samples
+ */
+void spectrum_analyze(const int16_t *samples);
+
+#endif // SPECTRUM_H
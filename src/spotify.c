@@ -2,13 +2,16 @@
  * Spotify Integration Implementation
  *
  * Uses librespot for Spotify Connect auth + audio streaming.
- * Uses curl + Spotify Web API for search/browse.
+ * Uses the Spotify Web API via http.c for search/browse; the access token
+ * is kept between calls, so a search is a single request.
  * Follows patterns from youtube.c for CLI execution and cJSON parsing.
  */
 
 #include "spotify.h"
 #include "state.h"
+#include "http.h"
 #include "cJSON.h"
+#include "jsonarena.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,9 +30,6 @@
 // Named FIFO pipe for PCM audio from librespot
 #define SPOTIFY_FIFO_PATH "/tmp/mono_spotify"
 
-// Temp file for API responses
-#define TEMP_API_FILE "/tmp/mono_sp_api.json"
-
 // Config file for API credentials
 #define SPOTIFY_CONFIG_FILE "spotify.json"
 
@@ -217,7 +217,6 @@ void spotify_init(void) {
 void spotify_cleanup(void) {
     kill_librespot();
     unlink(SPOTIFY_FIFO_PATH);
-    unlink(TEMP_API_FILE);
     unlink(LIBRESPOT_EVENT_FILE);
     unlink(LIBRESPOT_PID_FILE);
     unlink(LIBRESPOT_EVENT_SCRIPT);
@@ -359,38 +358,27 @@ bool spotify_api_authenticate(void) {
     }
 
     // Client Credentials flow - no user auth needed for search
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd),
-        "curl -s -X POST 'https://accounts.spotify.com/api/token' "
-        "-d 'grant_type=client_credentials' "
-        "-d 'client_id=%s' "
-        "-d 'client_secret=%s' "
-        "> %s 2>/dev/null",
-        g_client_id, g_client_secret, TEMP_API_FILE);
+    char post_data[512];
+    snprintf(post_data, sizeof(post_data),
+        "grant_type=client_credentials&client_id=%s&client_secret=%s",
+        g_client_id, g_client_secret);
+
+    HttpRequest req = {
+        .url = "https://accounts.spotify.com/api/token",
+        .post_data = post_data,
+        .max_body = 8 * 1024,
+    };
+    HttpResponse resp;
 
     printf("[SPOTIFY] Authenticating with Web API...\n");
-    int ret = system(cmd);
-
-    if (ret != 0) {
+    if (!http_request(&req, &resp)) {
         snprintf(g_error, sizeof(g_error), "API auth failed (network error?)");
         return false;
     }
 
-    // Read response
-    FILE *f = fopen(TEMP_API_FILE, "r");
-    if (!f) {
-        snprintf(g_error, sizeof(g_error), "Failed to read auth response");
-        return false;
-    }
-
-    char buf[2048];
-    size_t read = fread(buf, 1, sizeof(buf) - 1, f);
-    fclose(f);
-    unlink(TEMP_API_FILE);
-    buf[read] = '\0';
-
     // Parse token
-    cJSON *json = cJSON_Parse(buf);
+    cJSON *json = resp.body ? json_arena_parse(resp.body) : NULL;
+    http_response_free(&resp);
     if (!json) {
         snprintf(g_error, sizeof(g_error), "Invalid auth response");
         return false;
@@ -404,7 +392,7 @@ bool spotify_api_authenticate(void) {
         int exp_sec = (expires && cJSON_IsNumber(expires)) ? (int)expires->valuedouble : 3600;
         g_token_expires = time(NULL) + exp_sec - 60;  // Refresh 60s before expiry
         printf("[SPOTIFY] API token obtained (expires in %ds)\n", exp_sec);
-        cJSON_Delete(json);
+        json_arena_release(json);
         return true;
     }
 
@@ -416,7 +404,7 @@ bool spotify_api_authenticate(void) {
         snprintf(g_error, sizeof(g_error), "Auth failed (invalid response)");
     }
 
-    cJSON_Delete(json);
+    json_arena_release(json);
     return false;
 }
 
@@ -430,29 +418,6 @@ static bool ensure_api_token(void) {
     return spotify_api_authenticate();
 }
 
-/**
- * URL encode a string (same as youtube.c)
- */
-static void url_encode(const char *src, char *dst, size_t dst_size) {
-    static const char *hex = "0123456789ABCDEF";
-    size_t j = 0;
-
-    for (size_t i = 0; src[i] && j < dst_size - 4; i++) {
-        unsigned char c = (unsigned char)src[i];
-        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
-            (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' || c == '~') {
-            dst[j++] = c;
-        } else if (c == ' ') {
-            dst[j++] = '+';
-        } else {
-            dst[j++] = '%';
-            dst[j++] = hex[c >> 4];
-            dst[j++] = hex[c & 0x0F];
-        }
-    }
-    dst[j] = '\0';
-}
-
 int spotify_search(const char *query, SpotifyTrack *results, int max_results) {
     if (!query || !results || max_results <= 0) {
         snprintf(g_error, sizeof(g_error), "Invalid search parameters");
@@ -472,59 +437,32 @@ int spotify_search(const char *query, SpotifyTrack *results, int max_results) {
 
     // URL encode query
     char encoded_query[512];
-    url_encode(query, encoded_query, sizeof(encoded_query));
+    http_url_encode(query, encoded_query, sizeof(encoded_query));
 
     // Build search request
-    char cmd[2048];
-    snprintf(cmd, sizeof(cmd),
-        "curl -s 'https://api.spotify.com/v1/search?q=%s&type=track&limit=%d' "
-        "-H 'Authorization: Bearer %s' "
-        "> %s 2>/dev/null",
-        encoded_query, max_results, g_access_token, TEMP_API_FILE);
+    char url[768];
+    snprintf(url, sizeof(url),
+        "https://api.spotify.com/v1/search?q=%s&type=track&limit=%d",
+        encoded_query, max_results);
+    char auth[600];
+    snprintf(auth, sizeof(auth), "Authorization: Bearer %s", g_access_token);
+
+    HttpRequest req = {
+        .url = url,
+        .headers = { auth, NULL },
+        .max_body = 512 * 1024,
+    };
+    HttpResponse resp;
 
     printf("[SPOTIFY] Searching: %s\n", query);
-    int ret = system(cmd);
-
-    if (ret != 0) {
+    if (!http_request(&req, &resp)) {
         snprintf(g_error, sizeof(g_error), "Search failed (network error?)");
-        unlink(TEMP_API_FILE);
         return -1;
     }
 
-    // Read response
-    FILE *f = fopen(TEMP_API_FILE, "r");
-    if (!f) {
-        snprintf(g_error, sizeof(g_error), "Failed to read search results");
-        return -1;
-    }
-
-    // Read entire file (search results can be large)
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    if (size <= 0 || size > 65536) {
-        fclose(f);
-        unlink(TEMP_API_FILE);
-        snprintf(g_error, sizeof(g_error), "Invalid search response");
-        return -1;
-    }
-
-    char *buf = malloc(size + 1);
-    if (!buf) {
-        fclose(f);
-        unlink(TEMP_API_FILE);
-        return -1;
-    }
-
-    size_t bytes_read = fread(buf, 1, size, f);
-    fclose(f);
-    unlink(TEMP_API_FILE);
-    buf[bytes_read] = '\0';
-
     // Parse JSON response
-    cJSON *json = cJSON_Parse(buf);
-    free(buf);
+    cJSON *json = resp.body ? json_arena_parse(resp.body) : NULL;
+    http_response_free(&resp);
 
     if (!json) {
         snprintf(g_error, sizeof(g_error), "Invalid search JSON");
@@ -537,7 +475,7 @@ int spotify_search(const char *query, SpotifyTrack *results, int max_results) {
         cJSON *msg = cJSON_GetObjectItem(error, "message");
         snprintf(g_error, sizeof(g_error), "%s",
                  (msg && msg->valuestring) ? msg->valuestring : "API error");
-        cJSON_Delete(json);
+        json_arena_release(json);
         // Token might be expired
         g_access_token[0] = '\0';
         return -1;
@@ -548,7 +486,7 @@ int spotify_search(const char *query, SpotifyTrack *results, int max_results) {
     cJSON *items = tracks ? cJSON_GetObjectItem(tracks, "items") : NULL;
 
     if (!items || !cJSON_IsArray(items)) {
-        cJSON_Delete(json);
+        json_arena_release(json);
         snprintf(g_error, sizeof(g_error), "No results for '%s'", query);
         return 0;
     }
@@ -601,7 +539,7 @@ int spotify_search(const char *query, SpotifyTrack *results, int max_results) {
                count, t->artist, t->title, t->duration_ms);
     }
 
-    cJSON_Delete(json);
+    json_arena_release(json);
 
     if (count == 0) {
         snprintf(g_error, sizeof(g_error), "No results for '%s'", query);
@@ -697,6 +635,10 @@ const char* spotify_get_cache_dir(void) {
     return g_cache_dir;
 }
 
+const char* spotify_get_fifo_path(void) {
+    return SPOTIFY_FIFO_PATH;
+}
+
 bool spotify_has_cached_credentials(void) {
     char cred_path[512];
     snprintf(cred_path, sizeof(cred_path), "%s/credentials.json", g_cache_dir);
@@ -152,6 +152,12 @@ void spotify_format_duration(int duration_ms, char *buffer);
  */
 const char* spotify_get_cache_dir(void);
 
+/**
+ * Get the FIFO librespot writes PCM audio to
+ * @return Path to the named pipe
+ */
+const char* spotify_get_fifo_path(void);
+
 /**
  * Check if we have cached credentials (previous auth)
  * @return true if cached credentials exist
@@ -1,15 +1,20 @@
 /**
  * Spotify Audio Pipe Reader Implementation
  *
- * Background pthread reads raw S16LE PCM from librespot's named FIFO,
- * stores in a ring buffer, and provides WAV-wrapped chunks to SDL_mixer.
+ * Background pthread reads raw S16LE PCM from librespot's named FIFO and
+ * stores it in a lock-free single-producer/single-consumer ring buffer.
+ * Playback runs through the SDL_mixer music hook (like FLAC in audio.c),
+ * which mixes straight out of the ring: no copies when the device already
+ * runs at 44.1kHz S16 stereo, and a fixed conversion buffer otherwise.
  *
- * Threading model follows preload.c: pthread with mutex/cond sync.
- * WAV assembly follows audio.c load_flac_from_position(): SDL_RWFromMem().
+ * The reader thread follows preload.c's pthread lifecycle; the ring itself
+ * takes no lock.
  */
 
 #include "spotify_audio.h"
+#include "audio.h"
 #include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -17,36 +22,35 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
 
-// Ring buffer for PCM data
+// FIFO read chunk (~46ms of audio)
+#define SP_READ_CHUNK 8192
+
+// How long the reader waits for data before checking for shutdown
+#define SP_POLL_TIMEOUT_MS 100
+
+// Converted output staged before volume mixing (only when the device format differs)
+#define SP_MIX_BUFFER_SIZE 16384
+
+// Pre-buffer adaptation
+#define SP_JITTER_WINDOW_MS 10000     // Gaps are remembered for one to two windows
+#define SP_PREBUFFER_DECAY_MS 20000   // Clean playback needed before shrinking
+#define SP_RECEIVE_TIMEOUT_MS 3000    // Silence before the link counts as idle
+
+// Single-producer/single-consumer ring buffer for PCM data
+// The reader thread only advances head, the consumer only advances tail, so
+// neither side ever waits on the other. Both are free-running 32-bit byte
+// counters: head - tail is the fill level (valid across wraparound because
+// the capacity is a power of two) and counter & mask is the byte index.
 typedef struct {
     uint8_t *data;
-    size_t capacity;     // Total buffer size in bytes
-    size_t write_pos;    // Next write position
-    size_t read_pos;     // Next read position
-    size_t available;    // Bytes available to read
-    pthread_mutex_t mutex;
+    uint32_t capacity;   // Total buffer size in bytes (power of two)
+    uint32_t mask;       // capacity - 1
+    SDL_atomic_t head;   // Bytes ever written (producer)
+    SDL_atomic_t tail;   // Bytes ever read (consumer)
 } RingBuffer;
 
-// WAV header (44 bytes) for wrapping raw PCM
-#pragma pack(push, 1)
-typedef struct {
-    char riff[4];           // "RIFF"
-    uint32_t file_size;     // File size - 8
-    char wave[4];           // "WAVE"
-    char fmt[4];            // "fmt "
-    uint32_t fmt_size;      // 16
-    uint16_t audio_format;  // 1 (PCM)
-    uint16_t channels;      // 2
-    uint32_t sample_rate;   // 44100
-    uint32_t byte_rate;     // sample_rate * channels * bits/8
-    uint16_t block_align;   // channels * bits/8
-    uint16_t bits_per_sample; // 16
-    char data_id[4];        // "data"
-    uint32_t data_size;     // PCM data size
-} WavHeader;
-#pragma pack(pop)
-
 // State
 static char g_fifo_path[256] = {0};
 static int g_fifo_fd = -1;
@@ -60,17 +64,45 @@ static size_t g_total_bytes_read = 0;
 // Timestamp of last data received
 static uint32_t g_last_data_time = 0;
 
+// Playback through the music hook
+static bool g_hooked = false;
+static SDL_AudioStream *g_convert = NULL;   // NULL when the device matches the source format
+static Uint8 *g_mix_buf = NULL;             // Conversion output (with g_convert)
+static Uint16 g_device_format = AUDIO_S16SYS;
+static volatile bool g_paused = false;
+static volatile bool g_buffering = true;    // Waiting for the prebuffer before (re)starting
+
+// Telemetry (written by the reader or the hook, read by the UI)
+static volatile int g_underruns = 0;
+static volatile int g_prebuffer_ms = SP_PREBUFFER_START_MS;
+static volatile int g_jitter_ms = 0;
+static volatile int g_throughput_kbps = 0;
+static volatile int g_first_audio_ms = -1;
+static volatile uint32_t g_fill_histogram[SP_FILL_BUCKETS];
+static uint32_t g_play_time = 0;            // When sp_audio_play() hooked playback
+static uint32_t g_last_adjust_time = 0;     // Hook: last pre-buffer change
+
+// Reader-thread measurement windows
+static int g_gap_window_max = 0;
+static int g_gap_prev_max = 0;
+static uint32_t g_gap_window_start = 0;
+static size_t g_rate_window_bytes = 0;
+static uint32_t g_rate_window_start = 0;
+
 /**
  * Initialize ring buffer
+ * @param capacity Requested size, rounded down to a power of two
  */
 static bool ringbuf_init(RingBuffer *rb, size_t capacity) {
-    rb->data = malloc(capacity);
+    uint32_t size = 1;
+    while (size <= capacity / 2 && size < 0x40000000u) size <<= 1;
+
+    rb->data = malloc(size);
     if (!rb->data) return false;
-    rb->capacity = capacity;
-    rb->write_pos = 0;
-    rb->read_pos = 0;
-    rb->available = 0;
-    pthread_mutex_init(&rb->mutex, NULL);
+    rb->capacity = size;
+    rb->mask = size - 1;
+    SDL_AtomicSet(&rb->head, 0);
+    SDL_AtomicSet(&rb->tail, 0);
     return true;
 }
 
@@ -82,110 +114,143 @@ static void ringbuf_free(RingBuffer *rb) {
         free(rb->data);
         rb->data = NULL;
     }
-    pthread_mutex_destroy(&rb->mutex);
 }
 
 /**
- * Write data to ring buffer (called from reader thread)
+ * Write data to ring buffer (producer: reader thread only)
  * @return Number of bytes actually written
  */
 static size_t ringbuf_write(RingBuffer *rb, const uint8_t *data, size_t len) {
-    pthread_mutex_lock(&rb->mutex);
+    uint32_t head = (uint32_t)SDL_AtomicGet(&rb->head);
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&rb->tail);
 
-    size_t space = rb->capacity - rb->available;
+    size_t space = rb->capacity - (head - tail);
     if (len > space) len = space;  // Drop excess if buffer full
 
     // Write in up to two chunks (wrap around)
-    size_t first_chunk = rb->capacity - rb->write_pos;
+    uint32_t pos = head & rb->mask;
+    size_t first_chunk = rb->capacity - pos;
     if (first_chunk > len) first_chunk = len;
 
-    memcpy(rb->data + rb->write_pos, data, first_chunk);
+    memcpy(rb->data + pos, data, first_chunk);
     if (len > first_chunk) {
         memcpy(rb->data, data + first_chunk, len - first_chunk);
     }
 
-    rb->write_pos = (rb->write_pos + len) % rb->capacity;
-    rb->available += len;
-
-    pthread_mutex_unlock(&rb->mutex);
+    // Publish after the copy (SDL atomics are full barriers)
+    SDL_AtomicSet(&rb->head, (int)(head + (uint32_t)len));
     return len;
 }
 
 /**
- * Read data from ring buffer (called from main thread)
- * @return Number of bytes actually read
+ * Get available bytes in ring buffer (safe from either side)
  */
-static size_t ringbuf_read(RingBuffer *rb, uint8_t *out, size_t len) {
-    pthread_mutex_lock(&rb->mutex);
-
-    if (len > rb->available) len = rb->available;
-
-    // Read in up to two chunks (wrap around)
-    size_t first_chunk = rb->capacity - rb->read_pos;
-    if (first_chunk > len) first_chunk = len;
+static size_t ringbuf_available(RingBuffer *rb) {
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&rb->tail);
+    uint32_t head = (uint32_t)SDL_AtomicGet(&rb->head);
+    return head - tail;
+}
 
-    memcpy(out, rb->data + rb->read_pos, first_chunk);
-    if (len > first_chunk) {
-        memcpy(out + first_chunk, rb->data, len - first_chunk);
-    }
+/**
+ * Get the contiguous readable span at the tail (consumer only)
+ * @param ptr Set to the first readable byte
+ * @return Bytes readable at ptr without wrapping
+ */
+static size_t ringbuf_peek(RingBuffer *rb, const uint8_t **ptr) {
+    uint32_t tail = (uint32_t)SDL_AtomicGet(&rb->tail);
+    uint32_t head = (uint32_t)SDL_AtomicGet(&rb->head);
 
-    rb->read_pos = (rb->read_pos + len) % rb->capacity;
-    rb->available -= len;
+    uint32_t pos = tail & rb->mask;
+    size_t len = head - tail;
+    if (len > rb->capacity - pos) len = rb->capacity - pos;
 
-    pthread_mutex_unlock(&rb->mutex);
+    *ptr = rb->data + pos;
     return len;
 }
 
 /**
- * Get available bytes in ring buffer
+ * Release bytes previously returned by ringbuf_peek (consumer only)
  */
-static size_t ringbuf_available(RingBuffer *rb) {
-    pthread_mutex_lock(&rb->mutex);
-    size_t avail = rb->available;
-    pthread_mutex_unlock(&rb->mutex);
-    return avail;
+static void ringbuf_consume(RingBuffer *rb, size_t len) {
+    SDL_AtomicAdd(&rb->tail, (int)len);
 }
 
 /**
  * Reset ring buffer (clear all data)
+ * Consumer side: drops what is buffered by catching tail up to head, so it
+ * is safe while the reader thread keeps writing.
  */
 static void ringbuf_reset(RingBuffer *rb) {
-    pthread_mutex_lock(&rb->mutex);
-    rb->write_pos = 0;
-    rb->read_pos = 0;
-    rb->available = 0;
-    pthread_mutex_unlock(&rb->mutex);
+    SDL_AtomicSet(&rb->tail, SDL_AtomicGet(&rb->head));
 }
 
 /**
- * Build a WAV header for the given PCM data size
+ * Convert milliseconds of audio to ring bytes
  */
-static void build_wav_header(WavHeader *hdr, uint32_t pcm_size) {
-    memcpy(hdr->riff, "RIFF", 4);
-    hdr->file_size = 36 + pcm_size;
-    memcpy(hdr->wave, "WAVE", 4);
-    memcpy(hdr->fmt, "fmt ", 4);
-    hdr->fmt_size = 16;
-    hdr->audio_format = 1;  // PCM
-    hdr->channels = SP_CHANNELS;
-    hdr->sample_rate = SP_SAMPLE_RATE;
-    hdr->byte_rate = SP_BYTES_PER_SEC;
-    hdr->block_align = SP_BYTES_PER_SAMPLE;
-    hdr->bits_per_sample = SP_BITS;
-    memcpy(hdr->data_id, "data", 4);
-    hdr->data_size = pcm_size;
+static size_t ms_to_bytes(int ms) {
+    return (size_t)ms * SP_BYTES_PER_SEC / 1000;
+}
+
+/**
+ * Record the gap before a pipe read and the bytes it returned (reader thread)
+ * @param gap_ms Time since the previous read, or -1 if not meaningful
+ */
+static void record_read(uint32_t now, int gap_ms, size_t bytes) {
+    if (gap_ms >= 0) {
+        if (now - g_gap_window_start >= SP_JITTER_WINDOW_MS) {
+            g_gap_prev_max = g_gap_window_max;
+            g_gap_window_max = 0;
+            g_gap_window_start = now;
+        }
+        if (gap_ms > SP_PREBUFFER_MAX_MS) gap_ms = SP_PREBUFFER_MAX_MS;
+        if (gap_ms > g_gap_window_max) g_gap_window_max = gap_ms;
+        g_jitter_ms = (g_gap_window_max > g_gap_prev_max) ? g_gap_window_max : g_gap_prev_max;
+    }
+
+    g_rate_window_bytes += bytes;
+    uint32_t elapsed = now - g_rate_window_start;
+    if (elapsed >= 1000) {
+        g_throughput_kbps = (int)(g_rate_window_bytes * 1000 / elapsed / 1024);
+        g_rate_window_bytes = 0;
+        g_rate_window_start = now;
+    }
+}
+
+/**
+ * Move the pre-buffer target (audio thread)
+ * Doubles after an underrun, never sits below twice the recent jitter, and
+ * steps down by a quarter after each stretch of clean playback.
+ */
+static void adapt_prebuffer(bool underrun) {
+    uint32_t now = SDL_GetTicks();
+    int target = g_prebuffer_ms;
+    int floor_ms = 2 * g_jitter_ms;
+    if (floor_ms < SP_PREBUFFER_MIN_MS) floor_ms = SP_PREBUFFER_MIN_MS;
+
+    if (underrun) {
+        target *= 2;
+        g_last_adjust_time = now;
+    } else if (now - g_last_adjust_time >= SP_PREBUFFER_DECAY_MS) {
+        target = target * 3 / 4;
+        g_last_adjust_time = now;
+    }
+
+    if (target < floor_ms) target = floor_ms;
+    if (target > SP_PREBUFFER_MAX_MS) target = SP_PREBUFFER_MAX_MS;
+    g_prebuffer_ms = target;
 }
 
 /**
  * Background thread: reads PCM data from FIFO pipe into ring buffer
+ * When the ring is full the thread stops reading, so librespot blocks on
+ * the pipe instead of audio being dropped (e.g. while paused).
  */
 static void* pipe_reader_thread(void *arg) {
     (void)arg;
 
     printf("[SP_AUDIO] Reader thread started\n");
 
-    // Open FIFO in non-blocking mode first, then switch to blocking
-    // This avoids blocking forever if librespot hasn't opened its end yet
+    // Non-blocking open: librespot may not have opened its end yet
     g_fifo_fd = open(g_fifo_path, O_RDONLY | O_NONBLOCK);
     if (g_fifo_fd < 0) {
         fprintf(stderr, "[SP_AUDIO] Failed to open FIFO: %s\n", strerror(errno));
@@ -193,34 +258,51 @@ static void* pipe_reader_thread(void *arg) {
         return NULL;
     }
 
-    // Switch to blocking mode for efficient reads
-    int flags = fcntl(g_fifo_fd, F_GETFL);
-    fcntl(g_fifo_fd, F_SETFL, flags & ~O_NONBLOCK);
-
-    uint8_t read_buf[8192];  // 8KB read chunks (~46ms of audio)
+    uint8_t read_buf[SP_READ_CHUNK];
+    bool had_writer = false;
+    bool waited = false;  // Last write stalled on a full ring
 
     while (g_running) {
+        struct pollfd pfd = {g_fifo_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, SP_POLL_TIMEOUT_MS);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+
         ssize_t bytes = read(g_fifo_fd, read_buf, sizeof(read_buf));
 
         if (bytes > 0) {
-            ringbuf_write(&g_buffer, read_buf, bytes);
+            // Gaps only say something about the link while we are consuming
+            uint32_t now = SDL_GetTicks();
+            bool measured = had_writer && g_hooked && !g_paused && !waited;
+            record_read(now, measured ? (int)(now - g_last_data_time) : -1, (size_t)bytes);
+
+            had_writer = true;
+            waited = false;
+            size_t done = 0;
+            while (done < (size_t)bytes && g_running) {
+                size_t n = ringbuf_write(&g_buffer, read_buf + done, bytes - done);
+                done += n;
+                if (done < (size_t)bytes) {
+                    usleep(10000);  // Full - wait for the hook
+                    waited = true;
+                }
+            }
             g_total_bytes_read += bytes;
             g_receiving = true;
             g_last_data_time = SDL_GetTicks();
         } else if (bytes == 0) {
+            if (!had_writer) {
+                // No writer yet (a FIFO reads as EOF until one opens it)
+                usleep(50000);
+                continue;
+            }
             // EOF - librespot closed the pipe (track ended or process stopped)
             printf("[SP_AUDIO] Pipe EOF (track ended)\n");
             g_eof = true;
             g_receiving = false;
             break;
         } else {
-            // Error
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // No data available (shouldn't happen in blocking mode)
-                usleep(10000);  // 10ms
-                continue;
-            }
-            if (errno == EINTR) continue;  // Interrupted by signal
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
 
             fprintf(stderr, "[SP_AUDIO] Read error: %s\n", strerror(errno));
             g_eof = true;
@@ -229,15 +311,102 @@ static void* pipe_reader_thread(void *arg) {
         }
     }
 
-    if (g_fifo_fd >= 0) {
-        close(g_fifo_fd);
-        g_fifo_fd = -1;
-    }
+    close(g_fifo_fd);
+    g_fifo_fd = -1;
 
     printf("[SP_AUDIO] Reader thread exiting (total: %zu bytes)\n", g_total_bytes_read);
     return NULL;
 }
 
+/**
+ * SDL_mixer music hook: mix PCM from the ring buffer into the output
+ * Runs on the audio thread. Output is pre-silenced by SDL_mixer, so an
+ * underrun simply leaves silence; playback then waits for the prebuffer
+ * again instead of stuttering. Volume is applied here because
+ * Mix_VolumeMusic() does not affect hooked music. The EQ post-mix still
+ * runs on the result.
+ */
+static void SDLCALL sp_music_hook(void *udata, Uint8 *stream, int len) {
+    (void)udata;
+
+    if (g_paused) return;
+
+    // Fill level seen by each callback
+    size_t buffered = ringbuf_available(&g_buffer);
+    int bucket = 0;
+    while (bucket < SP_FILL_BUCKETS - 1 && buffered >= ms_to_bytes(250 << bucket)) bucket++;
+    g_fill_histogram[bucket]++;
+
+    if (g_buffering) {
+        if (!g_eof && !sp_audio_is_ready()) return;
+        g_buffering = false;
+        if (g_first_audio_ms < 0) {
+            g_first_audio_ms = (int)(SDL_GetTicks() - g_play_time);
+            g_last_adjust_time = SDL_GetTicks();
+        }
+    }
+
+    int volume = (int)(audio_get_volume() * 1.28);
+    const uint8_t *src;
+
+    while (len > 0) {
+        if (!g_convert) {
+            // Device matches the source: mix straight from the ring
+            size_t n = ringbuf_peek(&g_buffer, &src);
+            n -= n % SP_BYTES_PER_SAMPLE;
+            if (n == 0) break;
+            if (n > (size_t)len) n = (size_t)len;
+
+            SDL_MixAudioFormat(stream, src, AUDIO_S16LSB, (Uint32)n, volume);
+            ringbuf_consume(&g_buffer, n);
+            stream += n;
+            len -= (int)n;
+            continue;
+        }
+
+        // Feed the converter until it can satisfy this request
+        while (SDL_AudioStreamAvailable(g_convert) < len) {
+            size_t n = ringbuf_peek(&g_buffer, &src);
+            n -= n % SP_BYTES_PER_SAMPLE;
+            if (n == 0) break;
+            if (n > SP_READ_CHUNK) n = SP_READ_CHUNK;
+            SDL_AudioStreamPut(g_convert, src, (int)n);
+            ringbuf_consume(&g_buffer, n);
+        }
+
+        int want = (len < SP_MIX_BUFFER_SIZE) ? len : SP_MIX_BUFFER_SIZE;
+        int got = SDL_AudioStreamGet(g_convert, g_mix_buf, want);
+        if (got <= 0) break;
+
+        SDL_MixAudioFormat(stream, g_mix_buf, g_device_format, (Uint32)got, volume);
+        stream += got;
+        len -= got;
+    }
+
+    bool underrun = (len > 0 && !g_eof);
+    if (underrun) {
+        g_underruns++;
+        g_buffering = true;
+    }
+    adapt_prebuffer(underrun);
+}
+
+/**
+ * Remove the music hook and free conversion state
+ */
+static void unhook_playback(void) {
+    if (g_hooked) {
+        Mix_HookMusic(NULL, NULL);  // Locks audio, hook is not running after this
+        g_hooked = false;
+    }
+    if (g_convert) {
+        SDL_FreeAudioStream(g_convert);
+        g_convert = NULL;
+    }
+    free(g_mix_buf);
+    g_mix_buf = NULL;
+}
+
 bool sp_audio_init(const char *fifo_path) {
     if (!fifo_path) return false;
 
@@ -249,14 +418,15 @@ bool sp_audio_init(const char *fifo_path) {
     g_total_bytes_read = 0;
     g_last_data_time = 0;
 
-    // Allocate ring buffer (~5MB for 30 seconds of stereo S16)
+    // Allocate ring buffer (4MB, ~23 seconds of stereo S16 after power-of-two rounding)
     size_t buf_size = SP_BUFFER_SECONDS * SP_BYTES_PER_SEC;
     if (!ringbuf_init(&g_buffer, buf_size)) {
         fprintf(stderr, "[SP_AUDIO] Failed to allocate %zu byte buffer\n", buf_size);
         return false;
     }
 
-    printf("[SP_AUDIO] Initialized (buffer=%zu bytes, %d sec)\n", buf_size, SP_BUFFER_SECONDS);
+    printf("[SP_AUDIO] Initialized (buffer=%u bytes, %u sec)\n",
+           g_buffer.capacity, g_buffer.capacity / SP_BYTES_PER_SEC);
     return true;
 }
 
@@ -287,82 +457,96 @@ bool sp_audio_start(void) {
 }
 
 void sp_audio_stop(void) {
+    unhook_playback();
+
     if (!g_running) return;
 
+    // Reader notices within one poll timeout and closes the FIFO itself
     g_running = false;
-
-    // Close FIFO to unblock the reader thread
-    if (g_fifo_fd >= 0) {
-        close(g_fifo_fd);
-        g_fifo_fd = -1;
-    }
-
     pthread_join(g_thread, NULL);
     printf("[SP_AUDIO] Reader thread stopped\n");
 }
 
-bool sp_audio_is_ready(void) {
-    size_t threshold = SP_PREBUFFER_SECONDS * SP_BYTES_PER_SEC;
-    return ringbuf_available(&g_buffer) >= threshold;
-}
-
-bool sp_audio_is_receiving(void) {
-    if (!g_receiving) return false;
+bool sp_audio_play(void) {
+    if (g_hooked) return true;
+    if (!g_buffer.data || !sp_audio_start()) return false;
 
-    // Consider "not receiving" if no data for 3 seconds
-    uint32_t now = SDL_GetTicks();
-    if (g_last_data_time > 0 && (now - g_last_data_time) > 3000) {
+    int freq;
+    Uint16 format;
+    int channels;
+    if (!Mix_QuerySpec(&freq, &format, &channels)) {
+        fprintf(stderr, "[SP_AUDIO] Audio device not open\n");
         return false;
     }
+
+    g_device_format = format;
+    if (freq != SP_SAMPLE_RATE || format != AUDIO_S16LSB || channels != SP_CHANNELS) {
+        g_convert = SDL_NewAudioStream(AUDIO_S16LSB, SP_CHANNELS, SP_SAMPLE_RATE,
+                                       format, (Uint8)channels, freq);
+        g_mix_buf = malloc(SP_MIX_BUFFER_SIZE);
+        if (!g_convert || !g_mix_buf) {
+            fprintf(stderr, "[SP_AUDIO] Failed to set up conversion: %s\n", SDL_GetError());
+            unhook_playback();
+            return false;
+        }
+    }
+
+    // Fresh stats; the pre-buffer target and jitter carry over (same link)
+    g_paused = false;
+    g_buffering = true;
+    g_underruns = 0;
+    g_first_audio_ms = -1;
+    memset((void *)g_fill_histogram, 0, sizeof(g_fill_histogram));
+    g_play_time = SDL_GetTicks();
+    Mix_HookMusic(sp_music_hook, NULL);
+    g_hooked = true;
+
+    printf("[SP_AUDIO] Playback hooked (%s)\n", g_convert ? "converting" : "direct");
     return true;
 }
 
-bool sp_audio_is_eof(void) {
-    return g_eof;
+void sp_audio_set_paused(bool paused) {
+    g_paused = paused;
 }
 
-uint8_t* sp_audio_get_wav_chunk(size_t *out_size) {
-    // Read up to 5 seconds of PCM at a time
-    size_t max_pcm = 5 * SP_BYTES_PER_SEC;
-    size_t available = ringbuf_available(&g_buffer);
+bool sp_audio_is_drained(void) {
+    return g_eof && ringbuf_available(&g_buffer) < SP_BYTES_PER_SAMPLE;
+}
 
-    if (available == 0) {
-        if (out_size) *out_size = 0;
-        return NULL;
+void sp_audio_get_stats(SpAudioStats *stats) {
+    if (!stats) return;
+    stats->underruns = g_underruns;
+    stats->prebuffer_ms = g_prebuffer_ms;
+    stats->jitter_ms = g_jitter_ms;
+    stats->throughput_kbps = g_throughput_kbps;
+    stats->first_audio_ms = g_first_audio_ms;
+    stats->buffered_ms = (int)(ringbuf_available(&g_buffer) * 1000 / SP_BYTES_PER_SEC);
+    for (int i = 0; i < SP_FILL_BUCKETS; i++) {
+        stats->fill_histogram[i] = g_fill_histogram[i];
     }
+}
 
-    size_t pcm_size = (available < max_pcm) ? available : max_pcm;
+bool sp_audio_is_ready(void) {
+    return ringbuf_available(&g_buffer) >= ms_to_bytes(g_prebuffer_ms);
+}
 
-    // Align to sample boundary (4 bytes per frame for stereo S16)
-    pcm_size = (pcm_size / SP_BYTES_PER_SAMPLE) * SP_BYTES_PER_SAMPLE;
-    if (pcm_size == 0) {
-        if (out_size) *out_size = 0;
-        return NULL;
-    }
+bool sp_audio_is_receiving(void) {
+    if (!g_receiving) return false;
 
-    // Allocate WAV buffer (header + PCM data)
-    size_t wav_size = sizeof(WavHeader) + pcm_size;
-    uint8_t *wav_buf = malloc(wav_size);
-    if (!wav_buf) {
-        if (out_size) *out_size = 0;
-        return NULL;
-    }
+    // Consider "not receiving" after 3 seconds without data, or longer if
+    // the link normally stalls for longer than that
+    uint32_t timeout = SP_RECEIVE_TIMEOUT_MS;
+    if ((uint32_t)g_jitter_ms * 2 > timeout) timeout = (uint32_t)g_jitter_ms * 2;
 
-    // Write WAV header
-    WavHeader *hdr = (WavHeader *)wav_buf;
-    build_wav_header(hdr, (uint32_t)pcm_size);
-
-    // Read PCM data from ring buffer
-    size_t actual = ringbuf_read(&g_buffer, wav_buf + sizeof(WavHeader), pcm_size);
-    if (actual < pcm_size) {
-        // Update header with actual size
-        hdr->data_size = (uint32_t)actual;
-        hdr->file_size = 36 + (uint32_t)actual;
-        wav_size = sizeof(WavHeader) + actual;
+    uint32_t now = SDL_GetTicks();
+    if (g_last_data_time > 0 && (now - g_last_data_time) > timeout) {
+        return false;
     }
+    return true;
+}
 
-    if (out_size) *out_size = wav_size;
-    return wav_buf;
+bool sp_audio_is_eof(void) {
+    return g_eof;
 }
 
 int sp_audio_buffered_seconds(void) {
@@ -1,12 +1,14 @@
 /**
  * Spotify Audio Pipe Reader
  *
- * Background pthread reads raw PCM from librespot's named FIFO pipe,
- * wraps chunks with WAV headers, and feeds them to SDL_mixer via
- * SDL_RWFromMem() (same pattern as FLAC chunked decode in audio.c).
+ * Background pthread reads raw PCM from librespot's named FIFO pipe into
+ * a ring buffer, which an SDL_mixer music hook drains straight into the
+ * output stream (same pattern as FLAC streaming in audio.c).
  *
  * Audio format: S16LE, 44100Hz, stereo (librespot --format S16 --bitrate 160)
- * Buffer: ~5 seconds of pre-buffer before first playback
+ * Buffer: adaptive pre-buffer before playback starts. It starts short,
+ * doubles after an underrun, tracks the gaps seen between pipe reads and
+ * shrinks again while playback stays clean.
  */
 
 #ifndef SPOTIFY_AUDIO_H
@@ -24,8 +26,27 @@
 #define SP_BYTES_PER_SEC    (SP_SAMPLE_RATE * SP_BYTES_PER_SAMPLE)  // ~176KB/s
 
 // Buffer sizes
-#define SP_PREBUFFER_SECONDS  3   // Pre-buffer before starting playback
-#define SP_BUFFER_SECONDS     30  // Total ring buffer capacity (~5MB)
+#define SP_PREBUFFER_MIN_MS   500    // Smallest pre-buffer target
+#define SP_PREBUFFER_START_MS 1000   // Initial target (fast first audio on a good link)
+#define SP_PREBUFFER_MAX_MS   10000  // Largest target after repeated underruns
+#define SP_BUFFER_SECONDS     30  // Ring buffer capacity, rounded down to a power of two (4MB)
+
+// Fill-level histogram: bucket i counts callbacks with less than
+// 250ms << i buffered (last bucket: everything above)
+#define SP_FILL_BUCKETS 8
+
+/**
+ * Streaming statistics (since the last sp_audio_play)
+ */
+typedef struct {
+    int underruns;               // Times playback ran dry
+    int prebuffer_ms;            // Current pre-buffer target
+    int jitter_ms;               // Longest recent gap between pipe reads
+    int throughput_kbps;         // Pipe read rate over the last second (KB/s)
+    int first_audio_ms;          // Play request to first audio (-1 = still buffering)
+    int buffered_ms;             // Audio in the ring now
+    uint32_t fill_histogram[SP_FILL_BUCKETS];  // Audio callbacks per fill level
+} SpAudioStats;
 
 /**
  * Initialize the Spotify audio pipe reader
@@ -46,13 +67,38 @@ void sp_audio_cleanup(void);
 bool sp_audio_start(void);
 
 /**
- * Stop reading (kills thread, does not close pipe)
+ * Stop playback and reading (removes the music hook, joins the thread)
  */
 void sp_audio_stop(void);
 
+/**
+ * Start playback through the SDL_mixer music hook
+ * Starts the reader if needed. Playback begins once the pre-buffer is
+ * filled. The caller stops local playback first (one music hook at a time).
+ * @return true if playback is hooked
+ */
+bool sp_audio_play(void);
+
+/**
+ * Pause/resume output (buffered audio is kept, the reader stops at full)
+ * @param paused true to output silence
+ */
+void sp_audio_set_paused(bool paused);
+
+/**
+ * Check if the pipe hit EOF and everything buffered has played
+ */
+bool sp_audio_is_drained(void);
+
+/**
+ * Get streaming statistics
+ * @param stats Output
+ */
+void sp_audio_get_stats(SpAudioStats *stats);
+
 /**
  * Check if enough data has been buffered for playback
- * @return true if pre-buffer threshold reached
+ * @return true if the adaptive pre-buffer target is reached
  */
 bool sp_audio_is_ready(void);
 
@@ -68,14 +114,6 @@ bool sp_audio_is_receiving(void);
  */
 bool sp_audio_is_eof(void);
 
-/**
- * Get a WAV-wrapped chunk of audio for SDL_mixer
- * Caller must free the returned buffer when done.
- * @param out_size Output: size of WAV data
- * @return WAV data buffer (caller frees), or NULL if not enough data
- */
-uint8_t* sp_audio_get_wav_chunk(size_t *out_size);
-
 /**
  * Get how many seconds of audio are buffered
  * @return Buffered seconds (approximate)
@@ -3,13 +3,20 @@
  *
  * Manages search input, results list state for Spotify.
  * Mirrors ytsearch.c 1:1 but uses Spotify Web API for search.
+ * The Web API round trip runs on a worker thread; repeated queries are
+ * answered from searchcache.c and refreshed in the background when stale.
  */
 
 #include "spsearch.h"
 #include "spotify.h"
+#include "searchcache.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
+// Search results cache service name
+#define SPSEARCH_CACHE_SERVICE "spotify"
+
 // Character set for search input - QWERTY layout grid (same as ytsearch.c)
 #define KBD_COLS 10
 #define KBD_ROWS 5
@@ -44,8 +51,72 @@ static char g_error[256] = {0};
 
 // Search pending flag
 static bool g_search_pending = false;
+static bool g_revalidating = false;        // Showing cached results, refresh running
+static char g_active_query[128] = {0};     // Query the running search was started for
+
+// Search worker (one request at a time, stale answers dropped by generation)
+static pthread_t g_thread;
+static bool g_thread_running = false;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static bool g_shutdown = false;
+static bool g_request_ready = false;
+static unsigned int g_generation = 0;
+static SpotifyTrack g_incoming[SPOTIFY_MAX_RESULTS];
+static int g_search_status = 0;            // spotify_search() result
+static char g_search_error[256] = {0};
+static bool g_search_done = false;
+
+/**
+ * Worker: run the latest requested search
+ */
+static void* search_thread_func(void *arg) {
+    (void)arg;
+    static SpotifyTrack found[SPOTIFY_MAX_RESULTS];
+
+    pthread_mutex_lock(&g_mutex);
+    while (!g_shutdown) {
+        if (!g_request_ready) {
+            pthread_cond_wait(&g_cond, &g_mutex);
+            continue;
+        }
+
+        char query[sizeof(g_active_query)];
+        memcpy(query, g_active_query, sizeof(query));
+        unsigned int generation = g_generation;
+        g_request_ready = false;
+        pthread_mutex_unlock(&g_mutex);
+
+        int status = spotify_search(query, found, SPOTIFY_MAX_RESULTS);
+        const char *err = spotify_get_error();
+
+        pthread_mutex_lock(&g_mutex);
+        if (generation == g_generation) {
+            if (status > 0) memcpy(g_incoming, found, status * sizeof(SpotifyTrack));
+            g_search_status = status;
+            snprintf(g_search_error, sizeof(g_search_error), "%s", err ? err : "");
+            g_search_done = true;
+        }
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return NULL;
+}
+
+/**
+ * Drop the running search, if any (main thread)
+ * The HTTP request itself runs to completion; its answer is ignored.
+ */
+static void cancel_search(void) {
+    pthread_mutex_lock(&g_mutex);
+    g_generation++;
+    g_request_ready = false;
+    pthread_mutex_unlock(&g_mutex);
+    g_search_pending = false;
+    g_revalidating = false;
+}
 
 void spsearch_init(void) {
+    cancel_search();
     g_state = SPSEARCH_INPUT;
     g_query[0] = '\0';
     g_query_cursor = 0;
@@ -63,9 +134,25 @@ SpSearchState spsearch_get_state(void) {
 }
 
 void spsearch_set_state(SpSearchState state) {
+    // Leaving the results for input abandons a refresh still running
+    if (state == SPSEARCH_INPUT) {
+        cancel_search();
+    }
     g_state = state;
 }
 
+void spsearch_cleanup(void) {
+    if (!g_thread_running) return;
+
+    pthread_mutex_lock(&g_mutex);
+    g_generation++;
+    g_shutdown = true;
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+    pthread_join(g_thread, NULL);
+    g_thread_running = false;
+}
+
 // ============================================================================
 // Input State
 // ============================================================================
@@ -159,41 +246,108 @@ bool spsearch_execute_search(void) {
         return false;
     }
 
+    cancel_search();
+
     g_error[0] = '\0';
-    g_state = SPSEARCH_SEARCHING;
+    g_results_cursor = 0;
+    g_scroll_offset = 0;
+
+    // Cached results show immediately; stale ones are refreshed below
+    bool stale = false;
+    int cached = searchcache_get(SPSEARCH_CACHE_SERVICE, g_query, g_results,
+                                 sizeof(SpotifyTrack), SPOTIFY_MAX_RESULTS, &stale);
+    if (cached > 0) {
+        g_result_count = cached;
+        g_state = SPSEARCH_RESULTS;
+        if (!stale) {
+            return true;
+        }
+    } else {
+        g_result_count = 0;
+        g_state = SPSEARCH_SEARCHING;
+    }
+
+    // Worker starts on first use
+    if (!g_thread_running) {
+        g_shutdown = false;
+        if (pthread_create(&g_thread, NULL, search_thread_func, NULL) != 0) {
+            if (cached > 0) return true;  // Cached results are still good
+            snprintf(g_error, sizeof(g_error), "Search failed to start");
+            g_state = SPSEARCH_INPUT;
+            return false;
+        }
+        g_thread_running = true;
+    }
+
     g_search_pending = true;
+    g_revalidating = (cached > 0);
+
+    pthread_mutex_lock(&g_mutex);
+    strncpy(g_active_query, g_query, sizeof(g_active_query) - 1);
+    g_active_query[sizeof(g_active_query) - 1] = '\0';
+    g_search_done = false;
+    g_request_ready = true;
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
 
-    printf("[SPSEARCH] Starting search for: %s\n", g_query);
+    printf("[SPSEARCH] Starting %s for: %s\n", g_revalidating ? "refresh" : "search", g_query);
     return true;
 }
 
 bool spsearch_update_search(void) {
-    if (g_state != SPSEARCH_SEARCHING || !g_search_pending) {
+    if (!g_search_pending) {
+        return false;
+    }
+
+    pthread_mutex_lock(&g_mutex);
+    bool done = g_search_done;
+    int status = g_search_status;
+    char err[sizeof(g_search_error)];
+    memcpy(err, g_search_error, sizeof(err));
+    if (done && status > 0) {
+        memcpy(g_results, g_incoming, status * sizeof(SpotifyTrack));
+    }
+    pthread_mutex_unlock(&g_mutex);
+
+    if (!done) {
         return false;
     }
 
-    // Perform the actual search (blocking - same pattern as ytsearch.c)
     g_search_pending = false;
-    g_result_count = spotify_search(g_query, g_results, SPOTIFY_MAX_RESULTS);
 
-    if (g_result_count < 0) {
-        const char *err = spotify_get_error();
-        snprintf(g_error, sizeof(g_error), "%s", err ? err : "Search failed");
+    if (g_revalidating) {
+        // Keep the cached list if the refresh failed
+        g_revalidating = false;
+        if (status > 0) {
+            g_result_count = status;
+            if (g_results_cursor >= g_result_count) g_results_cursor = g_result_count - 1;
+            if (g_scroll_offset > g_results_cursor) g_scroll_offset = g_results_cursor;
+            searchcache_put(SPSEARCH_CACHE_SERVICE, g_active_query, g_results,
+                            sizeof(SpotifyTrack), g_result_count);
+            printf("[SPSEARCH] Refreshed: %d results\n", g_result_count);
+        }
+        return false;
+    }
+
+    if (status < 0) {
+        snprintf(g_error, sizeof(g_error), "%s", err[0] ? err : "Search failed");
         g_result_count = 0;
         g_state = SPSEARCH_INPUT;
         return true;
     }
 
-    if (g_result_count == 0) {
+    if (status == 0) {
         snprintf(g_error, sizeof(g_error), "No results for '%s'", g_query);
+        g_result_count = 0;
         g_state = SPSEARCH_INPUT;
         return true;
     }
 
     // Success - switch to results
-    g_results_cursor = 0;
-    g_scroll_offset = 0;
+    g_result_count = status;
     g_state = SPSEARCH_RESULTS;
+    searchcache_put(SPSEARCH_CACHE_SERVICE, g_active_query, g_results,
+                    sizeof(SpotifyTrack), g_result_count);
 
     printf("[SPSEARCH] Search complete: %d results\n", g_result_count);
     return true;
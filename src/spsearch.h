@@ -26,6 +26,11 @@ typedef enum {
  */
 void spsearch_init(void);
 
+/**
+ * Stop the search worker (call at app exit)
+ */
+void spsearch_cleanup(void);
+
 /**
  * Get current UI state
  */
@@ -98,15 +103,16 @@ bool spsearch_has_query(void);
 
 /**
  * Execute Spotify search with current query
- * Changes state to SPSEARCH_SEARCHING
- * @return true if search started
+ * Changes state to SPSEARCH_SEARCHING, or straight to SPSEARCH_RESULTS for
+ * a cached query (refreshed in the background if stale)
+ * @return true if search started or was answered from the cache
  */
 bool spsearch_execute_search(void);
 
 /**
- * Update search (call each frame when SPSEARCH_SEARCHING)
- * Performs the actual search operation (blocking)
- * @return true when search is complete
+ * Update search (call each frame while in the search or results state)
+ * Picks up the worker's answer; a background refresh swaps in silently
+ * @return true when the state changed
  */
 bool spsearch_update_search(void);
 
@@ -0,0 +1,166 @@
+/**
+ * Startup Implementation
+ *
+ * Workers pick the first registered task whose dependencies are done, so
+ * registration order doubles as priority. One mutex/cond guards the table;
+ * waiting on a task's completion also makes its writes visible to the
+ * waiter.
+ */
+
+#include "startup.h"
+#include "trace.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Registered task
+ */
+typedef struct {
+    const char *name;
+    StartupFunc func;
+    int deps[STARTUP_MAX_DEPS];
+    int dep_count;
+    bool started;
+    bool done;
+} StartupTask;
+
+static StartupTask g_tasks[STARTUP_MAX_TASKS];
+static int g_task_count = 0;
+
+static pthread_t g_workers[STARTUP_WORKERS];
+static int g_worker_count = 0;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+
+/**
+ * Next task that can start (caller holds g_mutex)
+ * @return Task index, or -1 if none is ready
+ */
+static int next_ready(void) {
+    for (int i = 0; i < g_task_count; i++) {
+        StartupTask *t = &g_tasks[i];
+        if (t->started) continue;
+
+        bool ready = true;
+        for (int d = 0; d < t->dep_count && ready; d++) {
+            ready = g_tasks[t->deps[d]].done;
+        }
+        if (ready) return i;
+    }
+    return -1;
+}
+
+/**
+ * Whether every task has been picked up (caller holds g_mutex)
+ */
+static bool all_started(void) {
+    for (int i = 0; i < g_task_count; i++) {
+        if (!g_tasks[i].started) return false;
+    }
+    return true;
+}
+
+/**
+ * Run one task outside the lock (caller holds g_mutex)
+ */
+static void run_task(int index) {
+    StartupTask *t = &g_tasks[index];
+    t->started = true;
+    pthread_mutex_unlock(&g_mutex);
+
+    trace_begin(t->name);
+    t->func();
+    trace_end();
+
+    pthread_mutex_lock(&g_mutex);
+    t->done = true;
+    pthread_cond_broadcast(&g_cond);
+}
+
+/**
+ * Pool worker: runs ready tasks until none are left to start
+ */
+static void* worker_func(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_mutex);
+    while (!all_started()) {
+        int index = next_ready();
+        if (index < 0) {
+            // Everything left waits on a running task
+            pthread_cond_wait(&g_cond, &g_mutex);
+            continue;
+        }
+        run_task(index);
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return NULL;
+}
+
+int startup_add(const char *name, StartupFunc func) {
+    if (g_task_count >= STARTUP_MAX_TASKS || !func) {
+        fprintf(stderr, "[STARTUP] Cannot add task %s\n", name);
+        return -1;
+    }
+
+    StartupTask *t = &g_tasks[g_task_count];
+    t->name = name;
+    t->func = func;
+    t->dep_count = 0;
+    t->started = false;
+    t->done = false;
+    return g_task_count++;
+}
+
+void startup_depends(int task, int dependency) {
+    // Only earlier tasks, so the graph can't have a cycle
+    if (task < 0 || task >= g_task_count || dependency < 0 || dependency >= task) return;
+
+    StartupTask *t = &g_tasks[task];
+    if (t->dep_count < STARTUP_MAX_DEPS) {
+        t->deps[t->dep_count++] = dependency;
+    }
+}
+
+void startup_run(void) {
+    int threads = g_task_count < STARTUP_WORKERS ? g_task_count : STARTUP_WORKERS;
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&g_workers[g_worker_count], NULL, worker_func, NULL) == 0) {
+            g_worker_count++;
+        }
+    }
+
+    if (g_worker_count == 0 && g_task_count > 0) {
+        fprintf(stderr, "[STARTUP] No worker threads, running tasks inline\n");
+        pthread_mutex_lock(&g_mutex);
+        int index;
+        while ((index = next_ready()) >= 0) {
+            run_task(index);
+        }
+        pthread_mutex_unlock(&g_mutex);
+    }
+
+    printf("[STARTUP] %d tasks on %d threads\n", g_task_count, g_worker_count);
+}
+
+void startup_wait(int task) {
+    if (task < 0 || task >= g_task_count) return;
+
+    pthread_mutex_lock(&g_mutex);
+    while (!g_tasks[task].done) {
+        pthread_cond_wait(&g_cond, &g_mutex);
+    }
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void startup_wait_all(void) {
+    for (int i = 0; i < g_task_count; i++) {
+        startup_wait(i);
+    }
+
+    for (int i = 0; i < g_worker_count; i++) {
+        pthread_join(g_workers[i], NULL);
+    }
+    g_worker_count = 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * Startup - Dependency-ordered init tasks on a small thread pool
+ *
+ * main() registers the independent init steps (cache loads, tool probes,
+ * sysfs reads) as tasks with explicit dependencies, starts the pool, and
+ * brings up SDL on the main thread meanwhile. Before touching a module
+ * from the main thread it waits for that module's task.
+ */
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+// Pool size (the A133 has four cores; the main thread keeps one)
+#define STARTUP_WORKERS 3
+
+#define STARTUP_MAX_TASKS 24
+#define STARTUP_MAX_DEPS 4
+
+/**
+ * Init task body (runs on a pool thread)
+ */
+typedef void (*StartupFunc)(void);
+
+/**
+ * Register a task (before startup_run)
+ * @param name Static string, used for logging and tracing
+ * @param func Task body
+ * @return Task id, or -1 if the table is full
+ */
+int startup_add(const char *name, StartupFunc func);
+
+/**
+ * Make a task wait for another one
+ * @param task Task id
+ * @param dependency Task that must finish first (registered earlier)
+ */
+void startup_depends(int task, int dependency);
+
+/**
+ * Start the pool (returns immediately)
+ * Falls back to running every task inline if no thread can be created.
+ */
+void startup_run(void);
+
+/**
+ * Block until a task has finished
+ * @param task Task id (-1 is ignored)
+ */
+void startup_wait(int task);
+
+/**
+ * Block until every task has finished and stop the pool
+ * Safe to call more than once.
+ */
+void startup_wait_all(void);
+
+#endif // STARTUP_H
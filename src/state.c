@@ -18,6 +18,7 @@
  */
 
 #include "state.h"
+#include "persist.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -197,9 +198,12 @@ void state_cleanup(void) {
 bool state_save(const AppStateData *data) {
     if (!data) return false;
 
-    FILE *f = fopen(g_state_path, "w");
+    // Build the file in memory; the persist thread writes it
+    char *json = NULL;
+    size_t json_size = 0;
+    FILE *f = open_memstream(&json, &json_size);
     if (!f) {
-        fprintf(stderr, "[STATE] Failed to open %s for writing\n", g_state_path);
+        fprintf(stderr, "[STATE] Failed to build state file\n");
         return false;
     }
 
@@ -219,6 +223,10 @@ bool state_save(const AppStateData *data) {
     fprintf(f, "  \"repeat\": %d,\n", (int)data->repeat);
     fprintf(f, "  \"theme\": %d,\n", (int)data->theme);
     fprintf(f, "  \"power_mode\": %d,\n", (int)data->power_mode);
+    fprintf(f, "  \"download_format\": %d,\n", (int)data->download_format);
+    fprintf(f, "  \"crossfade_sec\": %d,\n", data->crossfade_sec);
+    fprintf(f, "  \"normalize\": %s,\n", data->normalize ? "true" : "false");
+    fprintf(f, "  \"spectrum\": %s,\n", data->spectrum ? "true" : "false");
     fprintf(f, "  \"eq_band_0\": %d,\n", data->eq_bands[0]);
     fprintf(f, "  \"eq_band_1\": %d,\n", data->eq_bands[1]);
     fprintf(f, "  \"eq_band_2\": %d,\n", data->eq_bands[2]);
@@ -228,6 +236,10 @@ bool state_save(const AppStateData *data) {
     fprintf(f, "}\n");
 
     fclose(f);
+    bool queued = persist_write(g_state_path, json, json_size);
+    free(json);
+    if (!queued) return false;
+
     printf("[STATE] Saved state to %s\n", g_state_path);
     return true;
 }
@@ -242,6 +254,10 @@ bool state_load(AppStateData *data) {
     data->repeat = REPEAT_OFF;
     data->theme = THEME_DARK;
     data->power_mode = POWER_MODE_BALANCED;
+    data->download_format = DOWNLOAD_FORMAT_MP3;
+    data->crossfade_sec = 0;
+    data->normalize = true;
+    data->spectrum = false;
     memset(data->eq_bands, 0, sizeof(data->eq_bands));
     data->has_resume_data = false;
 
@@ -299,6 +315,15 @@ bool state_load(AppStateData *data) {
         data->power_mode = (PowerMode)power_mode_int;
     }
 
+    int download_format_int = 0;  // Default to MP3
+    if (json_get_int(json, "download_format", &download_format_int)) {
+        data->download_format = (DownloadFormat)download_format_int;
+    }
+
+    json_get_int(json, "crossfade_sec", &data->crossfade_sec);
+    json_get_bool(json, "normalize", &data->normalize);
+    json_get_bool(json, "spectrum", &data->spectrum);
+
     // Load 5-band EQ (with backwards compat for old eq_bass/eq_treble)
     json_get_int(json, "eq_band_0", &data->eq_bands[0]);
     json_get_int(json, "eq_band_1", &data->eq_bands[1]);
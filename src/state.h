@@ -30,6 +30,10 @@ typedef struct {
     RepeatMode repeat;            // Repeat mode (OFF/ONE/ALL)
     ThemeId theme;                // UI theme (DARK/LIGHT)
     PowerMode power_mode;         // Power mode (BATTERY/BALANCED/PERFORMANCE)
+    DownloadFormat download_format; // YouTube queue output (MP3/NATIVE)
+    int crossfade_sec;            // Crossfade between tracks (0 = gapless)
+    bool normalize;               // Loudness normalization enabled
+    bool spectrum;                // Spectrum bars on the player screen
     int eq_bands[5];              // Equalizer bands 0-4 (-12 to +12 dB)
 
     // State flags
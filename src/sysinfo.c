@@ -3,10 +3,13 @@
  *
  * Reads battery and volume information from Trimui Brick hardware.
  * Battery: sysfs interface at /sys/class/power_supply/axp2202-battery/
- * Volume: ALSA mixer "DAC volume" (range 0-255)
+ * Volume: ALSA control "digital volume", read through the kernel control
+ *         device (/dev/snd/controlC*). The element is subscribed to, so the
+ *         value is only re-read when the driver reports a change.
+ * Bluetooth: connection devices (hci0:<handle>) in /sys/class/bluetooth
  *
  * Uses time-based caching to avoid excessive system calls:
- * - Volume: refreshed every 500ms (responds quickly to changes)
+ * - Volume: event-driven (amixer polled every 100ms if the control is missing)
  * - Battery: refreshed every 10 seconds (changes slowly)
  */
 
@@ -14,9 +17,19 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdbool.h>
+#include <dirent.h>
 #include <sys/time.h>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sound/asound.h>
+#endif
+
 // Sysfs paths for battery on Trimui Brick (AXP2202 PMIC)
 #define BATTERY_CAPACITY_PATH "/sys/class/power_supply/axp2202-battery/capacity"
 #define BATTERY_STATUS_PATH "/sys/class/power_supply/axp2202-battery/status"
@@ -26,6 +39,13 @@
 #define BATTERY_REFRESH_MS 10000  // Refresh battery every 10 seconds
 #define CONNECTIVITY_REFRESH_MS 5000  // Refresh WiFi/BT every 5 seconds
 
+// ALSA control for the system volume (inverted: 0 = loud, max = mute)
+#define VOLUME_CONTROL_NAME "digital volume"
+#define VOLUME_MAX_CARDS 8
+
+// Bluetooth connections appear as hci<N>:<handle> devices
+#define BLUETOOTH_CLASS_PATH "/sys/class/bluetooth"
+
 // Cached values
 static int g_cached_battery = -1;
 static int g_cached_volume = -1;
@@ -38,6 +58,14 @@ static unsigned long g_last_volume_refresh = 0;
 static unsigned long g_last_battery_refresh = 0;
 static unsigned long g_last_connectivity_refresh = 0;
 
+#ifdef __linux__
+// Subscribed volume control (-1 = not found, fall back to amixer)
+static int g_ctl_fd = -1;
+static struct snd_ctl_elem_id g_volume_id;
+static long g_volume_min = 0;
+static long g_volume_max = 0;
+#endif
+
 /**
  * Get current time in milliseconds
  */
@@ -114,6 +142,122 @@ static int parse_amixer_volume(void) {
     return volume;
 }
 
+#ifdef __linux__
+/**
+ * Find the volume element on a control device and subscribe to its events
+ * @return true if found (the fd is kept open)
+ */
+static bool find_volume_element(int fd) {
+    struct snd_ctl_elem_list list;
+    memset(&list, 0, sizeof(list));
+    if (ioctl(fd, SNDRV_CTL_IOCTL_ELEM_LIST, &list) < 0 || list.count == 0) {
+        return false;
+    }
+
+    struct snd_ctl_elem_id *ids = calloc(list.count, sizeof(*ids));
+    if (!ids) return false;
+    list.space = list.count;
+    list.pids = ids;
+
+    bool found = false;
+    if (ioctl(fd, SNDRV_CTL_IOCTL_ELEM_LIST, &list) == 0) {
+        for (unsigned int i = 0; i < list.used && !found; i++) {
+            if (ids[i].iface != SNDRV_CTL_ELEM_IFACE_MIXER ||
+                strcasecmp((const char *)ids[i].name, VOLUME_CONTROL_NAME) != 0) {
+                continue;
+            }
+
+            struct snd_ctl_elem_info info;
+            memset(&info, 0, sizeof(info));
+            info.id = ids[i];
+            if (ioctl(fd, SNDRV_CTL_IOCTL_ELEM_INFO, &info) < 0 ||
+                info.type != SNDRV_CTL_ELEM_TYPE_INTEGER ||
+                info.value.integer.max <= info.value.integer.min) {
+                continue;
+            }
+
+            g_volume_id = info.id;
+            g_volume_min = info.value.integer.min;
+            g_volume_max = info.value.integer.max;
+            found = true;
+        }
+    }
+    free(ids);
+    if (!found) return false;
+
+    int subscribe = 1;
+    if (ioctl(fd, SNDRV_CTL_IOCTL_SUBSCRIBE_EVENTS, &subscribe) < 0) {
+        fprintf(stderr, "[SYSINFO] Volume events unavailable\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Open the control device holding the volume element
+ */
+static void open_volume_control(void) {
+    char path[32];
+    for (int card = 0; card < VOLUME_MAX_CARDS; card++) {
+        snprintf(path, sizeof(path), "/dev/snd/controlC%d", card);
+        int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) continue;
+
+        if (find_volume_element(fd)) {
+            g_ctl_fd = fd;
+            printf("[SYSINFO] Volume control on card %d (range %ld-%ld)\n",
+                   card, g_volume_min, g_volume_max);
+            return;
+        }
+        close(fd);
+    }
+    printf("[SYSINFO] Volume control not found, using amixer\n");
+}
+
+/**
+ * Read the volume element as a percentage (same rounding as amixer)
+ */
+static int read_volume_control(void) {
+    struct snd_ctl_elem_value value;
+    memset(&value, 0, sizeof(value));
+    value.id = g_volume_id;
+    if (ioctl(g_ctl_fd, SNDRV_CTL_IOCTL_ELEM_READ, &value) < 0) return -1;
+
+    long range = g_volume_max - g_volume_min;
+    long raw = value.value.integer.value[0] - g_volume_min;
+    int pct = (int)((raw * 100 + range / 2) / range);
+
+    // Invert: digital volume is inverted (0% = loud, 100% = mute)
+    return 100 - pct;
+}
+
+/**
+ * Drain pending control events
+ * @return true if the volume element changed
+ */
+static bool volume_events_pending(void) {
+    struct snd_ctl_event event;
+    bool changed = false;
+
+    while (read(g_ctl_fd, &event, sizeof(event)) == (ssize_t)sizeof(event)) {
+        if (event.type != SNDRV_CTL_EVENT_ELEM ||
+            event.data.elem.id.numid != g_volume_id.numid) {
+            continue;
+        }
+        if (event.data.elem.mask == SNDRV_CTL_EVENT_MASK_REMOVE) {
+            // Element went away (driver reload) - fall back to polling
+            close(g_ctl_fd);
+            g_ctl_fd = -1;
+            return false;
+        }
+        if (event.data.elem.mask & SNDRV_CTL_EVENT_MASK_VALUE) {
+            changed = true;
+        }
+    }
+    return changed;
+}
+#endif
+
 /**
  * Refresh battery cache if expired
  */
@@ -148,9 +292,23 @@ static void refresh_battery_if_needed(void) {
 }
 
 /**
- * Refresh volume cache if expired
+ * Refresh volume cache if changed (or expired, when polling amixer)
  */
 static void refresh_volume_if_needed(void) {
+#ifdef __linux__
+    if (g_ctl_fd >= 0) {
+        // Costs a single non-blocking read() while nothing changes
+        if (volume_events_pending() || g_last_volume_refresh == 0) {
+            int value = read_volume_control();
+            if (value >= 0) {
+                g_cached_volume = value;
+            }
+            g_last_volume_refresh = get_time_ms();
+        }
+        if (g_ctl_fd >= 0) return;
+    }
+#endif
+
     unsigned long now = get_time_ms();
     if (now - g_last_volume_refresh >= VOLUME_REFRESH_MS || g_last_volume_refresh == 0) {
 #ifdef __APPLE__
@@ -180,16 +338,18 @@ static void refresh_connectivity_if_needed(void) {
             g_cached_wifi = false;
         }
 
-        // Bluetooth: check if any device is connected
-        FILE *pipe = popen("bluetoothctl info 2>/dev/null | grep -c 'Connected: yes'", "r");
-        if (pipe) {
-            char buf[16];
-            if (fgets(buf, sizeof(buf), pipe)) {
-                g_cached_bluetooth = (atoi(buf) > 0);
+        // Bluetooth: the kernel adds hci0:<handle> for each live connection
+        g_cached_bluetooth = false;
+        DIR *dir = opendir(BLUETOOTH_CLASS_PATH);
+        if (dir) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                if (strncmp(entry->d_name, "hci", 3) == 0 && strchr(entry->d_name, ':')) {
+                    g_cached_bluetooth = true;
+                    break;
+                }
             }
-            pclose(pipe);
-        } else {
-            g_cached_bluetooth = false;
+            closedir(dir);
         }
 #endif
         g_last_connectivity_refresh = now;
@@ -201,6 +361,9 @@ int sysinfo_init(void) {
     g_last_battery_refresh = 0;
     g_last_volume_refresh = 0;
     g_last_connectivity_refresh = 0;
+#ifdef __linux__
+    open_volume_control();
+#endif
     refresh_battery_if_needed();
     refresh_volume_if_needed();
     refresh_connectivity_if_needed();
@@ -231,6 +394,7 @@ int sysinfo_get_volume(void) {
 
 void sysinfo_refresh_volume(void) {
     // Force immediate refresh by resetting timestamp
+    // (the control event may not have arrived yet when a key is handled)
     g_last_volume_refresh = 0;
     refresh_volume_if_needed();
 }
@@ -246,5 +410,10 @@ bool sysinfo_is_bluetooth_connected(void) {
 }
 
 void sysinfo_cleanup(void) {
-    // Nothing to cleanup for sysfs/amixer
+#ifdef __linux__
+    if (g_ctl_fd >= 0) {
+        close(g_ctl_fd);
+        g_ctl_fd = -1;
+    }
+#endif
 }
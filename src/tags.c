@@ -0,0 +1,808 @@
+/**
+ * Tag Probe Implementation
+ *
+ * The file is opened once. The head window covers the tag blocks and first
+ * audio frame of almost every file; anything past it (tags behind large
+ * embedded artwork) is read on demand from the same handle.
+ */
+
+#include "tags.h"
+#include "iosched.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+
+#define TAGS_HEAD_SIZE (64 * 1024)   // Covers ID3v2/FLAC/Ogg headers of most files
+#define TAGS_TAIL_SIZE (16 * 1024)   // Last Ogg page, or the ID3v1 tag
+#define TAGS_SYNC_WINDOW 4096        // Bytes searched for the first MP3 frame
+#define ID3V1_SIZE 128
+#define TAGS_SCAN_CHUNK (64 * 1024)  // Read size of the full frame scan
+#define TAGS_SCAN_MARK_FRAMES 32     // Frames between recorded scan positions
+
+/**
+ * An open file with its head and tail windows
+ */
+typedef struct {
+    FILE *f;
+    long file_size;
+    uint8_t *head;
+    size_t head_len;
+    uint8_t *tail;
+    size_t tail_len;
+    bool tail_owned;     // Tail is its own allocation (not inside head)
+} Probe;
+
+static uint32_t get_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t get_syncsafe(const uint8_t *p) {
+    return ((uint32_t)(p[0] & 0x7F) << 21) | ((uint32_t)(p[1] & 0x7F) << 14) |
+           ((uint32_t)(p[2] & 0x7F) << 7) | (uint32_t)(p[3] & 0x7F);
+}
+
+/**
+ * Read bytes at an offset, from the head window when it covers them
+ */
+static bool probe_read(Probe *p, long offset, void *dst, size_t len) {
+    if (offset < 0) return false;
+    if ((size_t)offset + len <= p->head_len) {
+        memcpy(dst, p->head + offset, len);
+        return true;
+    }
+    if (fseek(p->f, offset, SEEK_SET) != 0) return false;
+    return fread(dst, 1, len, p->f) == len;
+}
+
+/**
+ * Read the last len bytes of the file into the tail window
+ */
+static bool probe_read_tail(Probe *p, size_t len) {
+    if ((long)len > p->file_size) len = (size_t)p->file_size;
+    long start = p->file_size - (long)len;
+
+    // Small files are entirely in the head window already
+    if ((size_t)p->file_size <= p->head_len) {
+        p->tail = p->head + start;
+        p->tail_len = len;
+        return len > 0;
+    }
+
+    p->tail = malloc(len);
+    if (!p->tail) return false;
+    if (fseek(p->f, start, SEEK_SET) != 0 || fread(p->tail, 1, len, p->f) != len) {
+        free(p->tail);
+        p->tail = NULL;
+        return false;
+    }
+    p->tail_len = len;
+    p->tail_owned = true;
+    return true;
+}
+
+/**
+ * Mark a field as found if it ended up non-empty
+ */
+static void note_field(const TrackInfo *info, const char *dest,
+                       bool *got_title, bool *got_artist, bool *got_album) {
+    if (dest[0] == '\0') return;
+    if (dest == info->title) *got_title = true;
+    else if (dest == info->artist) *got_artist = true;
+    else if (dest == info->album) *got_album = true;
+}
+
+/**
+ * Store a track gain tag value ("-6.54 dB", or a Q7.8 integer for R128)
+ * @param r128 Value is an Opus R128_TRACK_GAIN (relative to -23 LUFS)
+ */
+static void note_gain(TrackInfo *info, const char *value, size_t len, bool r128) {
+    char buf[32];
+    if (len == 0 || len >= sizeof(buf)) return;
+    memcpy(buf, value, len);
+    buf[len] = '\0';
+
+    char *end;
+    double db = strtod(buf, &end);
+    if (end == buf) return;
+    if (r128) db = db / 256.0 + 5.0;  // Same -18 LUFS reference as ReplayGain 2.0
+
+    info->replaygain_db = (float)db;
+    info->has_replaygain = true;
+}
+
+/**
+ * Decode an ID3v2 text frame body (encoding byte + text) into dest
+ */
+static void copy_id3_text(char *dest, size_t dest_size, const uint8_t *content, uint32_t frame_size) {
+    int encoding = content[0];
+    const uint8_t *text_start = content + 1;
+    uint32_t text_len = frame_size - 1;
+
+    dest[0] = '\0';
+    if (encoding == 0 || encoding == 3) {
+        // ISO-8859-1 or UTF-8: direct copy
+        size_t copy_len = (text_len < dest_size - 1) ? text_len : dest_size - 1;
+        memcpy(dest, text_start, copy_len);
+        dest[copy_len] = '\0';
+    } else if (encoding == 1 || encoding == 2) {
+        // UTF-16 (with or without BOM): simple ASCII extraction
+        // (Full UTF-16 support would require iconv/ICU)
+        size_t j = 0;
+        int bom_skip = 0;
+        if (text_len >= 2 && ((text_start[0] == 0xFF && text_start[1] == 0xFE) ||
+                               (text_start[0] == 0xFE && text_start[1] == 0xFF))) {
+            bom_skip = 2;
+        }
+        bool is_be = (bom_skip == 2 && text_start[0] == 0xFE);
+
+        for (uint32_t i = bom_skip; i + 1 < text_len && j < dest_size - 1; i += 2) {
+            unsigned char lo = is_be ? text_start[i + 1] : text_start[i];
+            unsigned char hi = is_be ? text_start[i] : text_start[i + 1];
+            if (hi == 0 && lo >= 0x20 && lo < 0x7F) {
+                dest[j++] = (char)lo;
+            } else if (lo == 0 && hi == 0) {
+                break;  // Null terminator
+            }
+        }
+        dest[j] = '\0';
+    }
+
+    // Trim trailing whitespace
+    size_t len = strlen(dest);
+    while (len > 0 && dest[len - 1] == ' ') {
+        dest[--len] = '\0';
+    }
+}
+
+/**
+ * Read a TXXX frame body (encoding, description, value) for a track gain
+ * @param content Frame body, modified in place
+ */
+static void parse_id3_txxx(TrackInfo *info, uint8_t *content, uint32_t frame_size) {
+    int encoding = content[0];
+    uint32_t value_start = 0;
+    if (encoding == 1 || encoding == 2) {
+        for (uint32_t i = 1; i + 1 < frame_size; i += 2) {
+            if (content[i] == 0 && content[i + 1] == 0) {
+                value_start = i + 2;
+                break;
+            }
+        }
+    } else {
+        const uint8_t *nul = memchr(content + 1, 0, frame_size - 1);
+        if (nul) value_start = (uint32_t)(nul - content) + 1;
+    }
+    if (value_start == 0 || value_start >= frame_size) return;
+
+    char desc[32];
+    copy_id3_text(desc, sizeof(desc), content, value_start);
+    if (strcasecmp(desc, "REPLAYGAIN_TRACK_GAIN") != 0) return;
+
+    // The value is encoded like the description: put the encoding byte in
+    // front of it (over the terminator) and decode it the same way
+    char value[32];
+    content[value_start - 1] = (uint8_t)encoding;
+    copy_id3_text(value, sizeof(value), content + value_start - 1, frame_size - value_start + 1);
+    note_gain(info, value, strlen(value), false);
+}
+
+/**
+ * Parse ID3v2 TIT2/TPE1/TALB (TT2/TP1/TAL in v2.2) and the TXXX track gain
+ * @param audio_start Output: offset of the first byte after the tag
+ */
+static bool parse_id3v2(Probe *p, TrackInfo *info, long *audio_start) {
+    *audio_start = 0;
+    if (p->head_len < 10 || memcmp(p->head, "ID3", 3) != 0) return false;
+
+    const uint8_t *header = p->head;
+    int version = header[3];
+    if (version < 2 || version > 4) return false;
+
+    uint32_t tag_size = get_syncsafe(header + 6);
+    bool has_footer = (header[5] & 0x10) != 0;
+    *audio_start = 10 + (long)tag_size + (has_footer ? 10 : 0);
+
+    int header_len = (version == 2) ? 6 : 10;
+    int id_len = (version == 2) ? 3 : 4;
+    bool got_title = false, got_artist = false, got_album = false;
+    long pos = 10;
+    long end_pos = 10 + (long)tag_size;
+
+    // Parse frames
+    while (pos + header_len <= end_pos &&
+           !(got_title && got_artist && got_album && info->has_replaygain)) {
+        uint8_t frame_header[10];
+        if (!probe_read(p, pos, frame_header, header_len)) break;
+
+        // Check for padding (null bytes = end of frames)
+        if (frame_header[0] == 0) break;
+
+        uint32_t frame_size;
+        if (version == 2) {
+            frame_size = ((uint32_t)frame_header[3] << 16) |
+                         ((uint32_t)frame_header[4] << 8) |
+                         (uint32_t)frame_header[5];
+        } else if (version == 4) {
+            frame_size = get_syncsafe(frame_header + 4);   // ID3v2.4: syncsafe
+        } else {
+            frame_size = get_be32(frame_header + 4);       // ID3v2.3: big-endian
+        }
+
+        // Sanity check
+        if (frame_size == 0 || frame_size > 10000000) {
+            pos += header_len + frame_size;
+            continue;
+        }
+
+        // Check if this is a text frame we want
+        char *dest = NULL;
+        size_t dest_size = 0;
+        bool txxx = memcmp(frame_header, id_len == 3 ? "TXX" : "TXXX", id_len) == 0;
+        if (memcmp(frame_header, id_len == 3 ? "TT2" : "TIT2", id_len) == 0) {
+            dest = info->title;
+            dest_size = sizeof(info->title);
+        } else if (memcmp(frame_header, id_len == 3 ? "TP1" : "TPE1", id_len) == 0) {
+            dest = info->artist;
+            dest_size = sizeof(info->artist);
+        } else if (memcmp(frame_header, id_len == 3 ? "TAL" : "TALB", id_len) == 0) {
+            dest = info->album;
+            dest_size = sizeof(info->album);
+        }
+
+        if ((dest || (txxx && !info->has_replaygain)) && frame_size > 1) {
+            uint8_t *content = malloc(frame_size);
+            if (content) {
+                if (probe_read(p, pos + header_len, content, frame_size)) {
+                    if (dest) {
+                        copy_id3_text(dest, dest_size, content, frame_size);
+                        note_field(info, dest, &got_title, &got_artist, &got_album);
+                    } else {
+                        parse_id3_txxx(info, content, frame_size);
+                    }
+                }
+                free(content);
+            }
+        }
+
+        pos += header_len + frame_size;
+    }
+
+    return got_title || got_artist || got_album;
+}
+
+/**
+ * Parse an ID3v1 tag at the end of the tail window (legacy fallback)
+ */
+static bool parse_id3v1(const Probe *p, TrackInfo *info) {
+    if (p->tail_len < ID3V1_SIZE) return false;
+    const uint8_t *tag = p->tail + p->tail_len - ID3V1_SIZE;
+    if (memcmp(tag, "TAG", 3) != 0) return false;
+
+    char title[31], artist[31], album[31];
+    memcpy(title, tag + 3, 30);
+    memcpy(artist, tag + 33, 30);
+    memcpy(album, tag + 63, 30);
+    title[30] = artist[30] = album[30] = '\0';
+
+    // Trim trailing spaces
+    for (int i = 29; i >= 0 && title[i] == ' '; i--) title[i] = '\0';
+    for (int i = 29; i >= 0 && artist[i] == ' '; i--) artist[i] = '\0';
+    for (int i = 29; i >= 0 && album[i] == ' '; i--) album[i] = '\0';
+
+    if (strlen(title) > 0) strncpy(info->title, title, sizeof(info->title) - 1);
+    if (strlen(artist) > 0) strncpy(info->artist, artist, sizeof(info->artist) - 1);
+    if (strlen(album) > 0) strncpy(info->album, album, sizeof(info->album) - 1);
+
+    return strlen(title) > 0;
+}
+
+/**
+ * Fields of an MPEG Layer III frame header
+ */
+typedef struct {
+    int version;          // 3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5
+    int bitrate;          // kbps
+    int sample_rate;
+    int samples;          // PCM samples per frame
+    int frame_len;        // Bytes including header
+    bool mono;
+} Mp3Frame;
+
+/**
+ * Parse a 4-byte frame header
+ * @return false if it isn't a valid Layer III header
+ */
+static bool parse_mp3_frame(const uint8_t *h, Mp3Frame *fr) {
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+
+    static const int bitrates_v1_l3[] = {
+        0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0
+    };
+    static const int bitrates_v2_l3[] = {
+        0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0
+    };
+    static const int rates_v1[] = {44100, 48000, 32000, 0};
+
+    int version = (h[1] >> 3) & 0x03;
+    int layer = (h[1] >> 1) & 0x03;
+    int bitrate_idx = (h[2] >> 4) & 0x0F;
+    int rate_idx = (h[2] >> 2) & 0x03;
+    int padding = (h[2] >> 1) & 0x01;
+    if (layer != 0x01 || version == 0x01) return false;
+
+    fr->version = version;
+    fr->bitrate = (version == 0x03) ? bitrates_v1_l3[bitrate_idx] : bitrates_v2_l3[bitrate_idx];
+    fr->sample_rate = rates_v1[rate_idx] >> (version == 0x03 ? 0 : (version == 0x02 ? 1 : 2));
+    if (fr->bitrate == 0 || fr->sample_rate == 0) return false;
+
+    fr->samples = (version == 0x03) ? 1152 : 576;
+    fr->frame_len = (fr->samples / 8) * fr->bitrate * 1000 / fr->sample_rate + padding;
+    fr->mono = ((h[3] >> 6) & 0x03) == 0x03;
+    return true;
+}
+
+/**
+ * Spread offsets evenly between two points (CBR, or no better TOC)
+ */
+static void toc_linear(Mp3Toc *toc, long start, long end) {
+    for (int i = 0; i <= MP3_TOC_POINTS; i++) {
+        toc->offsets[i] = (uint32_t)(start + (int64_t)(end - start) * i / MP3_TOC_POINTS);
+    }
+}
+
+/**
+ * Duration from the first MP3 frame: Xing/Info or VBRI frame count when
+ * present (exact for VBR), otherwise file size over the CBR bitrate.
+ * Fills the seek TOC from the Xing header when it carries one.
+ */
+static int mp3_duration(Probe *p, long audio_start, bool has_id3v1, Mp3Toc *toc) {
+    uint8_t *window = malloc(TAGS_SYNC_WINDOW);
+    if (!window) return 0;
+
+    size_t window_len = TAGS_SYNC_WINDOW;
+    if (audio_start + (long)window_len > p->file_size) {
+        window_len = p->file_size > audio_start ? (size_t)(p->file_size - audio_start) : 0;
+    }
+    if (window_len < 4 || !probe_read(p, audio_start, window, window_len)) {
+        free(window);
+        return 0;
+    }
+
+    // Find first frame sync
+    size_t sync_pos = 0;
+    Mp3Frame fr;
+    bool found = false;
+    for (size_t i = 0; i + 3 < window_len && !found; i++) {
+        if (window[i] == 0xFF && (window[i + 1] & 0xE0) == 0xE0) {
+            found = true;
+            sync_pos = i;
+        }
+    }
+    if (!found || !parse_mp3_frame(window + sync_pos, &fr)) {
+        free(window);
+        return 0;
+    }
+
+    long frame_start = audio_start + (long)sync_pos;
+    long audio_end = p->file_size - (has_id3v1 ? ID3V1_SIZE : 0);
+    if (audio_end <= frame_start) audio_end = p->file_size;
+
+    // Xing/Info sits after the side info; VBRI at a fixed offset
+    size_t side_info = (fr.version == 0x03) ? (fr.mono ? 17 : 32) : (fr.mono ? 9 : 17);
+    size_t xing = sync_pos + 4 + side_info;
+    size_t vbri = sync_pos + 4 + 32;
+    uint32_t frames = 0;
+    const uint8_t *xing_toc = NULL;
+
+    if (xing + 8 <= window_len &&
+        (memcmp(window + xing, "Xing", 4) == 0 || memcmp(window + xing, "Info", 4) == 0)) {
+        uint32_t flags = get_be32(window + xing + 4);
+        size_t field = xing + 8;
+        if ((flags & 0x01) && field + 4 <= window_len) {
+            frames = get_be32(window + field);
+            field += 4;
+        }
+        if ((flags & 0x02) && field + 4 <= window_len) {
+            uint32_t bytes = get_be32(window + field);
+            if (bytes > 0 && frame_start + (long)bytes <= p->file_size) audio_end = frame_start + bytes;
+            field += 4;
+        }
+        if ((flags & 0x04) && field + MP3_TOC_POINTS <= window_len) {
+            xing_toc = window + field;
+        }
+    } else if (vbri + 18 <= window_len && memcmp(window + vbri, "VBRI", 4) == 0) {
+        frames = get_be32(window + vbri + 14);
+    }
+
+    int duration = 0;
+    if (frames > 0) {
+        duration = (int)((uint64_t)frames * fr.samples / fr.sample_rate);
+    } else {
+        duration = (int)(((int64_t)(audio_end - audio_start) * 8) / (fr.bitrate * 1000));
+    }
+
+    if (toc) {
+        toc->valid = true;
+        toc->duration_ms = frames > 0 ? (uint32_t)((uint64_t)frames * fr.samples * 1000 / fr.sample_rate)
+                                      : (uint32_t)duration * 1000;
+        if (xing_toc) {
+            // Xing TOC: byte position at each percent, in 1/256ths of the stream
+            for (int i = 0; i < MP3_TOC_POINTS; i++) {
+                toc->offsets[i] = (uint32_t)(frame_start + (int64_t)(audio_end - frame_start) * xing_toc[i] / 256);
+            }
+            toc->offsets[MP3_TOC_POINTS] = (uint32_t)audio_end;
+        } else {
+            toc_linear(toc, frame_start, audio_end);
+        }
+        toc->exact = frames > 0 && xing_toc;
+    }
+
+    free(window);
+    return duration;
+}
+
+/**
+ * Parse a Vorbis comment body (vendor, count, "FIELD=value" list)
+ * Shared by FLAC VORBIS_COMMENT blocks and Ogg Vorbis/Opus comment headers.
+ * Also picks up the track gain (REPLAYGAIN_TRACK_GAIN, or R128_TRACK_GAIN
+ * in Opus).
+ */
+static bool parse_vorbis_comments(const uint8_t *data, size_t size, TrackInfo *info) {
+    bool got_title = false, got_artist = false, got_album = false;
+    size_t pos = 0;
+
+    // Vendor string
+    if (pos + 4 > size) return false;
+    pos += 4 + (size_t)get_le32(data + pos);
+
+    // Number of comments
+    if (pos + 4 > size) return false;
+    uint32_t comment_count = get_le32(data + pos);
+    pos += 4;
+
+    for (uint32_t i = 0; i < comment_count && pos + 4 <= size; i++) {
+        uint32_t comment_len = get_le32(data + pos);
+        pos += 4;
+        if (comment_len > size - pos) break;
+
+        // Comment format: "FIELD=value"
+        const char *comment = (const char *)data + pos;
+        const char *equals = memchr(comment, '=', comment_len);
+        if (equals) {
+            size_t field_len = equals - comment;
+            const char *value = equals + 1;
+            size_t value_len = comment_len - field_len - 1;
+
+            // Case-insensitive field comparison
+            char *dest = NULL;
+            size_t dest_size = 0;
+            if (field_len == 5 && strncasecmp(comment, "TITLE", 5) == 0) {
+                dest = info->title;
+                dest_size = sizeof(info->title);
+            } else if (field_len == 6 && strncasecmp(comment, "ARTIST", 6) == 0) {
+                dest = info->artist;
+                dest_size = sizeof(info->artist);
+            } else if (field_len == 5 && strncasecmp(comment, "ALBUM", 5) == 0) {
+                dest = info->album;
+                dest_size = sizeof(info->album);
+            }
+
+            if (dest && value_len > 0) {
+                size_t copy_len = (value_len < dest_size - 1) ? value_len : dest_size - 1;
+                memcpy(dest, value, copy_len);
+                dest[copy_len] = '\0';
+                note_field(info, dest, &got_title, &got_artist, &got_album);
+            } else if (field_len == 21 && strncasecmp(comment, "REPLAYGAIN_TRACK_GAIN", 21) == 0) {
+                note_gain(info, value, value_len, false);
+            } else if (field_len == 15 && strncasecmp(comment, "R128_TRACK_GAIN", 15) == 0) {
+                note_gain(info, value, value_len, true);
+            }
+        }
+
+        pos += comment_len;
+        if (got_title && got_artist && got_album && info->has_replaygain) break;
+    }
+
+    return got_title || got_artist || got_album;
+}
+
+/**
+ * Parse FLAC metadata blocks: STREAMINFO (duration) and VORBIS_COMMENT
+ */
+static bool parse_flac(Probe *p, TrackInfo *info) {
+    bool got_metadata = false;
+    bool got_comments = false;
+    bool last_block = false;
+    long pos = 4;
+
+    while (!last_block && !(got_comments && info->duration_sec > 0)) {
+        uint8_t block_header[4];
+        if (!probe_read(p, pos, block_header, 4)) break;
+
+        last_block = (block_header[0] & 0x80) != 0;
+        int block_type = block_header[0] & 0x7F;
+        uint32_t block_size = ((uint32_t)block_header[1] << 16) |
+                              ((uint32_t)block_header[2] << 8) |
+                              (uint32_t)block_header[3];
+        pos += 4;
+
+        if (block_type == 0 && block_size >= 18) {
+            // STREAMINFO: 20-bit sample rate, 36-bit total samples
+            uint8_t si[18];
+            if (probe_read(p, pos, si, sizeof(si))) {
+                uint32_t rate = ((uint32_t)si[10] << 12) | ((uint32_t)si[11] << 4) | (si[12] >> 4);
+                uint64_t total = ((uint64_t)(si[13] & 0x0F) << 32) | get_be32(si + 14);
+                if (rate > 0) info->duration_sec = (int)(total / rate);
+            }
+        } else if (block_type == 4 && block_size > 8) {
+            // VORBIS_COMMENT
+            uint8_t *block_data = malloc(block_size);
+            if (block_data) {
+                if (probe_read(p, pos, block_data, block_size)) {
+                    got_metadata = parse_vorbis_comments(block_data, block_size, info);
+                }
+                free(block_data);
+            }
+            got_comments = true;
+        }
+
+        pos += block_size;
+    }
+
+    return got_metadata;
+}
+
+/**
+ * Find a byte pattern in a buffer
+ * @param last Return the last match instead of the first
+ */
+static const uint8_t* find_bytes(const uint8_t *buf, size_t len, const char *pat, size_t pat_len, bool last) {
+    if (len < pat_len) return NULL;
+    const uint8_t *match = NULL;
+    for (size_t i = 0; i + pat_len <= len; i++) {
+        if (buf[i] == (uint8_t)pat[0] && memcmp(buf + i, pat, pat_len) == 0) {
+            match = buf + i;
+            if (!last) break;
+        }
+    }
+    return match;
+}
+
+/**
+ * Parse Ogg Vorbis/Opus: comment header from the head window, duration
+ * from the granule position of the last page in the tail window
+ */
+static bool parse_ogg(Probe *p, TrackInfo *info) {
+    bool got_metadata = false;
+    uint32_t rate = 0;
+    uint32_t pre_skip = 0;
+
+    const uint8_t *end = p->head + p->head_len;
+    const uint8_t *id = find_bytes(p->head, p->head_len, "\x01vorbis", 7, false);
+    const uint8_t *comments = NULL;
+    if (id && id + 16 <= end) {
+        rate = get_le32(id + 12);
+        comments = find_bytes(id, end - id, "\x03vorbis", 7, false);
+        if (comments) comments += 7;
+    } else {
+        id = find_bytes(p->head, p->head_len, "OpusHead", 8, false);
+        if (id && id + 12 <= end) {
+            rate = 48000;  // Opus granules always count 48kHz samples
+            pre_skip = (uint32_t)id[10] | ((uint32_t)id[11] << 8);
+            comments = find_bytes(id, end - id, "OpusTags", 8, false);
+            if (comments) comments += 8;
+        }
+    }
+
+    // A comment packet spanning pages is only parsed up to the page break
+    if (comments) {
+        got_metadata = parse_vorbis_comments(comments, end - comments, info);
+    }
+
+    if (rate > 0 && probe_read_tail(p, TAGS_TAIL_SIZE)) {
+        const uint8_t *page = find_bytes(p->tail, p->tail_len, "OggS", 4, true);
+        if (page && page + 14 <= p->tail + p->tail_len && page[4] == 0) {
+            uint64_t granule = (uint64_t)get_le32(page + 6) | ((uint64_t)get_le32(page + 10) << 32);
+            if (granule != UINT64_MAX && granule > pre_skip) {
+                info->duration_sec = (int)((granule - pre_skip) / rate);
+            }
+        }
+    }
+
+    return got_metadata;
+}
+
+bool tags_probe(const char *path, TrackInfo *info) {
+    return tags_probe_toc(path, info, NULL);
+}
+
+bool tags_probe_toc(const char *path, TrackInfo *info, Mp3Toc *toc) {
+    memset(info, 0, sizeof(*info));
+    if (toc) memset(toc, 0, sizeof(*toc));
+
+    Probe p = {0};
+    p.f = fopen(path, "rb");
+    if (!p.f) return false;
+
+    fseek(p.f, 0, SEEK_END);
+    p.file_size = ftell(p.f);
+    fseek(p.f, 0, SEEK_SET);
+
+    // Heap buffer: Trimui has a limited stack, and workers call this too
+    p.head = malloc(TAGS_HEAD_SIZE);
+    if (!p.head || p.file_size <= 0) {
+        free(p.head);
+        fclose(p.f);
+        return false;
+    }
+    p.head_len = fread(p.head, 1, TAGS_HEAD_SIZE, p.f);
+
+    bool got_metadata = false;
+    if (p.head_len >= 4 && memcmp(p.head, "fLaC", 4) == 0) {
+        got_metadata = parse_flac(&p, info);
+    } else if (p.head_len >= 4 && memcmp(p.head, "OggS", 4) == 0) {
+        got_metadata = parse_ogg(&p, info);
+    } else {
+        // MP3/other: ID3v2 first (modern tags), then ID3v1 (legacy fallback)
+        long audio_start = 0;
+        got_metadata = parse_id3v2(&p, info, &audio_start);
+
+        probe_read_tail(&p, ID3V1_SIZE);
+        bool has_id3v1 = p.tail_len >= ID3V1_SIZE &&
+                         memcmp(p.tail + p.tail_len - ID3V1_SIZE, "TAG", 3) == 0;
+        if (!got_metadata) got_metadata = parse_id3v1(&p, info);
+
+        // Only MPEG audio starts with an ID3v2 tag or a frame sync
+        bool is_mpeg = audio_start > 0 ||
+                       (p.head_len >= 2 && p.head[0] == 0xFF && (p.head[1] & 0xE0) == 0xE0);
+        if (is_mpeg) info->duration_sec = mp3_duration(&p, audio_start, has_id3v1, toc);
+    }
+
+    if (p.tail_owned) free(p.tail);
+    free(p.head);
+    fclose(p.f);
+    return got_metadata;
+}
+
+/**
+ * Position recorded during the frame scan
+ */
+typedef struct {
+    uint32_t offset;
+    uint64_t samples;     // PCM samples before this frame
+} ScanMark;
+
+bool tags_scan_mp3(const char *path, Mp3Toc *toc, const volatile bool *cancel) {
+    memset(toc, 0, sizeof(*toc));
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+
+    uint8_t *buf = malloc(TAGS_SCAN_CHUNK);
+    if (!buf || file_size <= 0) {
+        free(buf);
+        fclose(f);
+        return false;
+    }
+
+    // Skip ID3v2
+    long pos = 0;
+    uint8_t header[10];
+    fseek(f, 0, SEEK_SET);
+    if (fread(header, 1, 10, f) == 10 && memcmp(header, "ID3", 3) == 0) {
+        pos = 10 + (long)get_syncsafe(header + 6) + ((header[5] & 0x10) ? 10 : 0);
+    }
+
+    ScanMark *marks = NULL;
+    size_t mark_count = 0, mark_capacity = 0;
+    uint64_t samples = 0;
+    uint32_t frames = 0;
+    int sample_rate = 0;
+    long audio_end = pos;
+    long buf_start = 0;
+    size_t buf_len = 0;
+    bool ok = true;
+
+    while (!(cancel && *cancel)) {
+        // Keep the next header inside the buffer
+        if (pos < buf_start || pos + 4 > buf_start + (long)buf_len) {
+            if (fseek(f, pos, SEEK_SET) != 0) break;
+            buf_start = pos;
+            buf_len = iosched_read(f, buf, TAGS_SCAN_CHUNK);
+            if (buf_len < 4) break;
+        }
+
+        const uint8_t *h = buf + (pos - buf_start);
+        Mp3Frame fr;
+        if (!parse_mp3_frame(h, &fr) || (sample_rate && fr.sample_rate != sample_rate)) {
+            if (h[0] == 'T' && h[1] == 'A' && h[2] == 'G') break;  // ID3v1 trailer
+            pos++;  // Lost sync: search forward
+            continue;
+        }
+
+        // The Xing/Info frame carries no audio
+        if (frames == 0 && sample_rate == 0) {
+            size_t side_info = (fr.version == 0x03) ? (fr.mono ? 17 : 32) : (fr.mono ? 9 : 17);
+            long tag = pos + 4 + (long)side_info - buf_start;
+            sample_rate = fr.sample_rate;
+            if (tag + 4 <= (long)buf_len &&
+                (memcmp(buf + tag, "Xing", 4) == 0 || memcmp(buf + tag, "Info", 4) == 0)) {
+                pos += fr.frame_len;
+                continue;
+            }
+        }
+
+        if (frames % TAGS_SCAN_MARK_FRAMES == 0) {
+            if (mark_count == mark_capacity) {
+                size_t new_capacity = mark_capacity ? mark_capacity * 2 : 1024;
+                ScanMark *grown = realloc(marks, new_capacity * sizeof(ScanMark));
+                if (!grown) {
+                    ok = false;
+                    break;
+                }
+                marks = grown;
+                mark_capacity = new_capacity;
+            }
+            marks[mark_count].offset = (uint32_t)pos;
+            marks[mark_count].samples = samples;
+            mark_count++;
+        }
+
+        frames++;
+        samples += fr.samples;
+        pos += fr.frame_len;
+        audio_end = pos < file_size ? pos : file_size;
+    }
+
+    bool cancelled = cancel && *cancel;
+    free(buf);
+    fclose(f);
+
+    if (!ok || cancelled || frames == 0) {
+        free(marks);
+        return false;
+    }
+
+    // Byte offset at each percent of the duration
+    size_t m = 0;
+    for (int i = 0; i < MP3_TOC_POINTS; i++) {
+        uint64_t target = samples * i / MP3_TOC_POINTS;
+        while (m + 1 < mark_count && marks[m + 1].samples <= target) m++;
+        toc->offsets[i] = marks[m].offset;
+    }
+    toc->offsets[MP3_TOC_POINTS] = (uint32_t)audio_end;
+    free(marks);
+
+    toc->duration_ms = (uint32_t)(samples * 1000 / sample_rate);
+    toc->valid = true;
+    toc->exact = true;
+
+    printf("[TAGS] Scanned %u frames (%u ms): %s\n", frames, toc->duration_ms, path);
+    return true;
+}
+
+long tags_toc_offset(const Mp3Toc *toc, double position_sec) {
+    if (!toc->valid || toc->duration_ms == 0) return -1;
+
+    double percent = position_sec * 1000.0 * MP3_TOC_POINTS / toc->duration_ms;
+    if (percent < 0) percent = 0;
+    if (percent >= MP3_TOC_POINTS) percent = MP3_TOC_POINTS - 0.001;
+
+    // Interpolate between the surrounding points
+    int i = (int)percent;
+    double frac = percent - i;
+    double a = toc->offsets[i];
+    double b = toc->offsets[i + 1];
+    return (long)(a + (b - a) * frac);
+}
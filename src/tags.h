@@ -0,0 +1,69 @@
+/**
+ * Tag Probe - One-pass tag and duration reader for audio files
+ *
+ * Reads a file's head and tail once and parses everything the player needs
+ * from those buffers: ID3v2/ID3v1 and Xing/VBRI headers (MP3), STREAMINFO
+ * and Vorbis comments (FLAC), Vorbis/Opus comments and the last granule
+ * position (Ogg), plus ReplayGain/R128 track gain tags. Shared by the player, the preloader and the metadata
+ * scanner so a track is opened once instead of once per tag format.
+ * MP3s also get a seek table (TOC) so seeks don't decode from the start.
+ */
+
+#ifndef TAGS_H
+#define TAGS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "audio.h"
+
+// Seek table resolution: one point per percent of the duration
+#define MP3_TOC_POINTS 100
+
+/**
+ * MP3 seek table: byte offset of the frame at each percent of the track
+ */
+typedef struct Mp3Toc {
+    bool valid;                                // File is MPEG audio
+    bool exact;                                // Frame-accurate duration and TOC
+    uint32_t duration_ms;
+    uint32_t offsets[MP3_TOC_POINTS + 1];      // [MP3_TOC_POINTS] = end of audio
+} Mp3Toc;
+
+/**
+ * Read embedded tags and duration of a file
+ * Touches no globals, so it is safe from worker threads.
+ * @param path Audio file path
+ * @param info Output: title/artist/album (empty when absent),
+ *             duration_sec (0 if unknown) and the track gain tag;
+ *             position_sec is zeroed
+ * @return true if any of title/artist/album was found
+ */
+bool tags_probe(const char *path, TrackInfo *info);
+
+/**
+ * tags_probe() that also returns the MP3 seek table
+ * The TOC comes from the Xing header when it has one (exact), otherwise it
+ * is spread linearly over the audio (a CBR estimate; see tags_scan_mp3()).
+ * @param toc Output: seek table (valid=false for non-MPEG files)
+ */
+bool tags_probe_toc(const char *path, TrackInfo *info, Mp3Toc *toc);
+
+/**
+ * Walk every MP3 frame to get an exact duration and seek table
+ * Reads the whole file; meant for a background thread.
+ * @param path MP3 file path
+ * @param toc Output: exact seek table
+ * @param cancel Polled between frames, stops the walk when true (can be NULL)
+ * @return true on success
+ */
+bool tags_scan_mp3(const char *path, Mp3Toc *toc, const volatile bool *cancel);
+
+/**
+ * Byte offset to start decoding from for a position
+ * @param toc Seek table
+ * @param position_sec Target position
+ * @return File offset near the target frame, or -1 without a table
+ */
+long tags_toc_offset(const Mp3Toc *toc, double position_sec);
+
+#endif // TAGS_H
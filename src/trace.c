@@ -0,0 +1,183 @@
+/**
+ * Trace Implementation
+ *
+ * Each thread keeps its own stack of open spans; only finished spans and
+ * marks touch the shared ring buffer, under a mutex, so a span costs two
+ * clock reads and one short critical section.
+ */
+
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+/**
+ * Recorded event
+ */
+typedef struct {
+    const char *name;
+    uint64_t start_us;      // Since trace_init()
+    uint64_t dur_us;        // 0 for marks
+    unsigned int thread;    // Small per-thread number (main = 1)
+    int depth;              // Nesting level, 0 = top level
+    bool instant;
+} TraceEvent;
+
+static TraceEvent g_events[TRACE_MAX_EVENTS];
+static int g_event_count = 0;     // Total recorded (can exceed the ring)
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t g_origin_us = 0;
+static unsigned int g_next_thread = 1;
+
+// Open spans of the calling thread
+static __thread const char *t_names[TRACE_MAX_DEPTH];
+static __thread uint64_t t_starts[TRACE_MAX_DEPTH];
+static __thread int t_depth = 0;
+static __thread unsigned int t_thread = 0;
+
+/**
+ * Monotonic time in microseconds
+ */
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/**
+ * Append an event to the ring (caller fills everything but the thread)
+ */
+static void record(TraceEvent ev) {
+    pthread_mutex_lock(&g_mutex);
+    if (t_thread == 0) t_thread = g_next_thread++;
+    ev.thread = t_thread;
+    g_events[g_event_count % TRACE_MAX_EVENTS] = ev;
+    g_event_count++;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void trace_init(void) {
+    pthread_mutex_lock(&g_mutex);
+    g_origin_us = now_us();
+    g_event_count = 0;
+    if (t_thread == 0) t_thread = g_next_thread++;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void trace_begin(const char *name) {
+    if (t_depth < TRACE_MAX_DEPTH) {
+        t_names[t_depth] = name;
+        t_starts[t_depth] = now_us();
+    }
+    t_depth++;
+}
+
+void trace_end(void) {
+    if (t_depth == 0) return;
+    t_depth--;
+    if (t_depth >= TRACE_MAX_DEPTH) return;
+
+    uint64_t end = now_us();
+    TraceEvent ev = {
+        .name = t_names[t_depth],
+        .start_us = t_starts[t_depth] - g_origin_us,
+        .dur_us = end - t_starts[t_depth],
+        .depth = t_depth,
+        .instant = false,
+    };
+    record(ev);
+}
+
+void trace_mark(const char *name) {
+    TraceEvent ev = {
+        .name = name,
+        .start_us = now_us() - g_origin_us,
+        .depth = t_depth,
+        .instant = true,
+    };
+    record(ev);
+}
+
+/**
+ * Copy the ring out in recording order
+ * @return Number of events copied
+ */
+static int snapshot(TraceEvent *out) {
+    pthread_mutex_lock(&g_mutex);
+    int count = g_event_count < TRACE_MAX_EVENTS ? g_event_count : TRACE_MAX_EVENTS;
+    int first = g_event_count - count;
+    for (int i = 0; i < count; i++) {
+        out[i] = g_events[(first + i) % TRACE_MAX_EVENTS];
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return count;
+}
+
+/**
+ * Sort by start time (spans are recorded when they end)
+ */
+static int compare_start(const void *a, const void *b) {
+    const TraceEvent *ea = a;
+    const TraceEvent *eb = b;
+    if (ea->start_us != eb->start_us) return ea->start_us < eb->start_us ? -1 : 1;
+    return ea->depth - eb->depth;
+}
+
+/**
+ * Write the events as Chrome trace JSON
+ */
+static void export_chrome(const char *path, const TraceEvent *events, int count) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "[TRACE] Cannot write %s\n", path);
+        return;
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (int i = 0; i < count; i++) {
+        const TraceEvent *e = &events[i];
+        if (e->instant) {
+            fprintf(f, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%llu,\"pid\":1,\"tid\":%u}",
+                    e->name, (unsigned long long)e->start_us, e->thread);
+        } else {
+            fprintf(f, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":1,\"tid\":%u}",
+                    e->name, (unsigned long long)e->start_us,
+                    (unsigned long long)e->dur_us, e->thread);
+        }
+        fprintf(f, i + 1 < count ? ",\n" : "\n");
+    }
+    fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(f);
+
+    printf("[TRACE] Chrome trace written to %s (%d events)\n", path, count);
+}
+
+void trace_report(const char *title) {
+    static TraceEvent events[TRACE_MAX_EVENTS];  // Main thread only
+    int count = snapshot(events);
+    qsort(events, count, sizeof(TraceEvent), compare_start);
+
+    double total_ms = (now_us() - g_origin_us) / 1000.0;
+    printf("[TRACE] %s: %.1f ms (budget %d ms%s)\n", title, total_ms,
+           TRACE_BOOT_BUDGET_MS, total_ms > TRACE_BOOT_BUDGET_MS ? ", OVER" : "");
+
+    // Top-level phases of the main thread, plus their direct children
+    for (int i = 0; i < count; i++) {
+        const TraceEvent *e = &events[i];
+        if (e->thread != 1 || e->depth > 1) continue;
+
+        if (e->instant) {
+            printf("[TRACE]   @ %-22s at %8.1f ms\n", e->name, e->start_us / 1000.0);
+        } else {
+            double ms = e->dur_us / 1000.0;
+            printf("[TRACE]   %s%-22s %8.1f ms %5.1f%%\n", e->depth ? "  " : "",
+                   e->name, ms, total_ms > 0 ? ms * 100.0 / total_ms : 0.0);
+        }
+    }
+
+    const char *path = getenv(TRACE_ENV);
+    if (path && path[0]) export_chrome(path, events, count);
+}
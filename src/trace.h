@@ -0,0 +1,56 @@
+/**
+ * Trace - Lightweight timeline of startup phases and subsystem calls
+ *
+ * Spans (trace_begin/trace_end, nestable, any thread) and instant marks
+ * go into a fixed ring buffer with microsecond timestamps. trace_report()
+ * logs the top-level phases against the boot budget; setting MONO_TRACE
+ * to a file path also exports the buffer as Chrome trace JSON
+ * (chrome://tracing, Perfetto).
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+// Events kept (oldest are overwritten)
+#define TRACE_MAX_EVENTS 512
+
+// Nesting depth tracked per thread
+#define TRACE_MAX_DEPTH 16
+
+// Target time from process start to the first frame
+#define TRACE_BOOT_BUDGET_MS 1000
+
+// Environment variable naming the Chrome trace output file
+#define TRACE_ENV "MONO_TRACE"
+
+/**
+ * Start the timeline clock (call first thing in main)
+ */
+void trace_init(void);
+
+/**
+ * Open a span on the calling thread
+ * @param name Static string (kept by pointer)
+ */
+void trace_begin(const char *name);
+
+/**
+ * Close the innermost open span on the calling thread
+ */
+void trace_end(void);
+
+/**
+ * Record an instant event (e.g. "first_frame")
+ * @param name Static string (kept by pointer)
+ */
+void trace_mark(const char *name);
+
+/**
+ * Log the per-phase summary and export the Chrome trace if requested
+ * @param title Heading for the log lines (e.g. "Boot")
+ */
+void trace_report(const char *title);
+
+#endif // TRACE_H
@@ -17,6 +17,7 @@
 #include "metadata.h"
 #include "theme.h"
 #include "ytsearch.h"
+#include "libsearch.h"
 #include "youtube.h"
 #include "download_queue.h"
 #include "equalizer.h"
@@ -25,6 +26,13 @@
 #include "spotify_audio.h"
 #include "update.h"
 #include "version.h"
+#include "glyph.h"
+#include "spectrum.h"
+#include "perfhud.h"
+#include "preload.h"
+#include "memgov.h"
+#include "jsonarena.h"
+#include "audiostats.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <stdio.h>
@@ -193,140 +201,93 @@ static const SDL_Color MONKEY_PALETTE[] = {
 };
 
 // ============================================================================
-// TEXT CACHING SYSTEM
-// Reduces TTF_RenderUTF8_Blended calls from 50+/frame to ~5/frame
-// LRU cache with 64 entries, expires textures after 5 seconds of non-use
+// TEXT RENDERING
+// One glyph atlas per font (glyph.c): drawing and measuring text costs no
+// TTF rasterizing, allocation or texture upload once glyphs are cached
 // ============================================================================
-#define TEXT_CACHE_SIZE 64
-#define TEXT_CACHE_EXPIRE_MS 5000  // 5 seconds
+#define FONT_COUNT 5
 
-typedef struct {
-    char text[128];
-    SDL_Color color;
+static struct {
     TTF_Font *font;
-    SDL_Texture *texture;
-    int width, height;
-    Uint32 last_used;
-    bool in_use;
-} CachedText;
-
-static CachedText g_text_cache[TEXT_CACHE_SIZE];
-static int g_text_cache_hits = 0;
-static int g_text_cache_misses = 0;
+    GlyphAtlas *atlas;
+} g_atlases[FONT_COUNT];
 
 /**
- * Initialize text cache
+ * Create the atlases (after load_fonts)
  */
-static void text_cache_init(void) {
-    memset(g_text_cache, 0, sizeof(g_text_cache));
+static void text_atlas_init(void) {
+    TTF_Font *fonts[FONT_COUNT] = {
+        g_font_large, g_font_medium, g_font_small, g_font_tiny, g_font_hint
+    };
+    for (int i = 0; i < FONT_COUNT; i++) {
+        g_atlases[i].font = fonts[i];
+        g_atlases[i].atlas = glyph_atlas_create(g_renderer, fonts[i]);
+    }
 }
 
 /**
- * Clear all cached textures (call on theme change or cleanup)
+ * Destroy the atlases (before the renderer)
  */
-static void text_cache_clear(void) {
-    for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
-        if (g_text_cache[i].texture) {
-            SDL_DestroyTexture(g_text_cache[i].texture);
-            g_text_cache[i].texture = NULL;
-        }
-        g_text_cache[i].in_use = false;
+static void text_atlas_cleanup(void) {
+    for (int i = 0; i < FONT_COUNT; i++) {
+        glyph_atlas_destroy(g_atlases[i].atlas);
+        g_atlases[i].atlas = NULL;
+        g_atlases[i].font = NULL;
     }
 }
 
 /**
- * Expire old cache entries (call periodically)
+ * Atlas for a font
  */
-static void text_cache_expire(void) {
-    Uint32 now = SDL_GetTicks();
-    for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
-        if (g_text_cache[i].in_use &&
-            now - g_text_cache[i].last_used > TEXT_CACHE_EXPIRE_MS) {
-            if (g_text_cache[i].texture) {
-                SDL_DestroyTexture(g_text_cache[i].texture);
-                g_text_cache[i].texture = NULL;
-            }
-            g_text_cache[i].in_use = false;
-        }
+static GlyphAtlas* atlas_for(TTF_Font *font) {
+    for (int i = 0; i < FONT_COUNT; i++) {
+        if (g_atlases[i].font == font) return g_atlases[i].atlas;
     }
+    return NULL;
 }
 
 /**
- * Find or create cached texture for text
- * @return Texture pointer (do NOT destroy - managed by cache)
+ * Measure text with the same layout render_text() draws
+ * Drop-in for TTF_SizeUTF8 (w/h may be NULL).
  */
-static SDL_Texture* text_cache_get(const char *text, TTF_Font *font, SDL_Color color,
-                                   int *out_w, int *out_h) {
-    if (!text || !text[0]) return NULL;
-
-    Uint32 now = SDL_GetTicks();
-
-    // Search for existing entry
-    for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
-        if (g_text_cache[i].in_use &&
-            g_text_cache[i].font == font &&
-            g_text_cache[i].color.r == color.r &&
-            g_text_cache[i].color.g == color.g &&
-            g_text_cache[i].color.b == color.b &&
-            strcmp(g_text_cache[i].text, text) == 0) {
-            // Cache hit
-            g_text_cache[i].last_used = now;
-            g_text_cache_hits++;
-            *out_w = g_text_cache[i].width;
-            *out_h = g_text_cache[i].height;
-            return g_text_cache[i].texture;
-        }
-    }
-
-    // Cache miss - find free slot or evict oldest
-    int slot = -1;
-    Uint32 oldest_time = now;
-
-    for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
-        if (!g_text_cache[i].in_use) {
-            slot = i;
-            break;
-        }
-        if (g_text_cache[i].last_used < oldest_time) {
-            oldest_time = g_text_cache[i].last_used;
-            slot = i;
-        }
+static void text_size(TTF_Font *font, const char *text, int *w, int *h) {
+    GlyphAtlas *atlas = atlas_for(font);
+    if (!atlas) {
+        TTF_SizeUTF8(font, text, w, h);
+        return;
     }
+    if (w) *w = glyph_atlas_measure(atlas, text, -1);
+    if (h) *h = glyph_atlas_height(atlas);
+}
 
-    if (slot < 0) slot = 0;  // Shouldn't happen, but safety first
-
-    // Evict old entry if needed
-    if (g_text_cache[slot].texture) {
-        SDL_DestroyTexture(g_text_cache[slot].texture);
-    }
+// ============================================================================
+// DAMAGE TRACKING
+// The browser and player screens are only redrawn when something on them
+// changes: main.c invalidates on input and state changes, and animations
+// schedule the time of their next visible frame while drawing
+// ============================================================================
+#define UI_IDLE_REDRAW_MS 1000          // Status bar refresh / safety net
+#define UI_PROGRESS_REDRAW_MS 250       // Player time and progress bar
 
-    // Create new entry
-    SDL_Surface *surface = TTF_RenderUTF8_Blended(font, text, color);
-    if (!surface) return NULL;
+static bool g_ui_dirty = true;
+static Uint32 g_ui_redraw_at = 0;
 
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(g_renderer, surface);
-    if (!texture) {
-        SDL_FreeSurface(surface);
-        return NULL;
+/**
+ * Request a redraw no later than a point in time
+ * @param at SDL_GetTicks() time of the next visible change
+ */
+static void schedule_redraw(Uint32 at) {
+    if ((Sint32)(at - g_ui_redraw_at) < 0) {
+        g_ui_redraw_at = at;
     }
+}
 
-    // Store in cache
-    strncpy(g_text_cache[slot].text, text, sizeof(g_text_cache[slot].text) - 1);
-    g_text_cache[slot].text[sizeof(g_text_cache[slot].text) - 1] = '\0';
-    g_text_cache[slot].color = color;
-    g_text_cache[slot].font = font;
-    g_text_cache[slot].texture = texture;
-    g_text_cache[slot].width = surface->w;
-    g_text_cache[slot].height = surface->h;
-    g_text_cache[slot].last_used = now;
-    g_text_cache[slot].in_use = true;
-
-    SDL_FreeSurface(surface);
-    g_text_cache_misses++;
-
-    *out_w = g_text_cache[slot].width;
-    *out_h = g_text_cache[slot].height;
-    return texture;
+/**
+ * Start drawing a tracked screen: nothing is pending until scheduled again
+ */
+static void begin_tracked_frame(void) {
+    g_ui_dirty = false;
+    g_ui_redraw_at = SDL_GetTicks() + UI_IDLE_REDRAW_MS;
 }
 
 /**
@@ -342,6 +303,7 @@ static void render_monkey(int x, int y, bool is_playing) {
             g_monkey_frame = MONKEY_DANCE_SEQ[g_monkey_seq];
             g_monkey_last_update = now;
         }
+        schedule_redraw(g_monkey_last_update + MONKEY_FRAME_MS + 1);
     } else {
         g_monkey_frame = 1;  // Resting pose (arms down) when not playing
         g_monkey_seq = 0;
@@ -372,18 +334,12 @@ static void render_monkey(int x, int y, bool is_playing) {
 static void render_text_shadow(const char *text, int x, int y, TTF_Font *font, SDL_Color color);
 
 /**
- * Render text to screen (cached version)
- * Uses LRU text cache to avoid repeated TTF rendering
+ * Render text to screen
+ * Drawn from the font's glyph atlas as one batch of quads
  */
 static void render_text(const char *text, int x, int y, TTF_Font *font, SDL_Color color) {
     if (!text || !text[0]) return;
-
-    int w, h;
-    SDL_Texture *texture = text_cache_get(text, font, color, &w, &h);
-    if (texture) {
-        SDL_Rect dest = {x, y, w, h};
-        SDL_RenderCopy(g_renderer, texture, NULL, &dest);
-    }
+    glyph_atlas_draw(atlas_for(font), text, x, y, color);
 }
 
 /**
@@ -392,23 +348,11 @@ static void render_text(const char *text, int x, int y, TTF_Font *font, SDL_Colo
 static void render_text_shadow(const char *text, int x, int y, TTF_Font *font, SDL_Color color) {
     if (!text || !text[0]) return;
 
-    SDL_Color shadow = {0, 0, 0, 180};
-
-    SDL_Surface *shadow_surface = TTF_RenderUTF8_Blended(font, text, shadow);
-    if (shadow_surface) {
-        SDL_Texture *shadow_tex = SDL_CreateTextureFromSurface(g_renderer, shadow_surface);
-        if (shadow_tex) {
-            SDL_SetTextureBlendMode(shadow_tex, SDL_BLENDMODE_BLEND);
-            SDL_Rect dest1 = {x + 1, y + 1, shadow_surface->w, shadow_surface->h};
-            SDL_Rect dest2 = {x + 2, y + 2, shadow_surface->w, shadow_surface->h};
-            SDL_SetTextureAlphaMod(shadow_tex, 100);
-            SDL_RenderCopy(g_renderer, shadow_tex, NULL, &dest2);
-            SDL_SetTextureAlphaMod(shadow_tex, 150);
-            SDL_RenderCopy(g_renderer, shadow_tex, NULL, &dest1);
-            SDL_DestroyTexture(shadow_tex);
-        }
-        SDL_FreeSurface(shadow_surface);
-    }
+    // Two offset passes (alpha 180 scaled by 100/255 and 150/255)
+    SDL_Color outer = {0, 0, 0, 70};
+    SDL_Color inner = {0, 0, 0, 106};
+    render_text(text, x + 2, y + 2, font, outer);
+    render_text(text, x + 1, y + 1, font, inner);
 
     render_text(text, x, y, font, color);
 }
@@ -419,7 +363,7 @@ static void render_text_shadow(const char *text, int x, int y, TTF_Font *font, S
 static void render_header(const char *title, SDL_Color color, bool animate_monkey) {
     render_text(title, SCREEN_PAD, SCREEN_PAD, g_font_medium, color);
     int text_w;
-    TTF_SizeUTF8(g_font_medium, title, &text_w, NULL);
+    text_size(g_font_medium, title, &text_w, NULL);
     render_monkey(SCREEN_PAD + text_w + 8, SCREEN_PAD - 2, animate_monkey);
 }
 
@@ -429,7 +373,7 @@ static void render_header(const char *title, SDL_Color color, bool animate_monke
 static void render_header_shadow(const char *title, SDL_Color color, bool animate_monkey) {
     render_text_shadow(title, SCREEN_PAD, SCREEN_PAD, g_font_medium, color);
     int text_w;
-    TTF_SizeUTF8(g_font_medium, title, &text_w, NULL);
+    text_size(g_font_medium, title, &text_w, NULL);
     render_monkey(SCREEN_PAD + text_w + 8, SCREEN_PAD - 2, animate_monkey);
 }
 
@@ -438,7 +382,7 @@ static void render_header_shadow(const char *title, SDL_Color color, bool animat
  */
 static int get_header_end_x(const char *title) {
     int text_w;
-    TTF_SizeUTF8(g_font_medium, title, &text_w, NULL);
+    text_size(g_font_medium, title, &text_w, NULL);
     return SCREEN_PAD + text_w + 8 + (16 * MONKEY_PIXEL_SIZE) + 8;
 }
 
@@ -512,7 +456,7 @@ static void render_text_truncated(const char *text, int x, int y, int max_width,
     truncated[sizeof(truncated) - 1] = '\0';
 
     int w, h;
-    TTF_SizeUTF8(font, truncated, &w, &h);
+    text_size(font, truncated, &w, &h);
 
     // Truncate with ellipsis if too long
     while (w > max_width && strlen(truncated) > 3) {
@@ -520,7 +464,7 @@ static void render_text_truncated(const char *text, int x, int y, int max_width,
         truncated[strlen(truncated) - 1] = '.';
         truncated[strlen(truncated) - 2] = '.';
         truncated[strlen(truncated) - 3] = '.';
-        TTF_SizeUTF8(font, truncated, &w, &h);
+        text_size(font, truncated, &w, &h);
     }
 
     render_text(truncated, x, y, font, color);
@@ -543,7 +487,7 @@ static int render_filename_with_ext(const char *text, int x, int y,
         // No extension — render as-is
         render_text(text, x, y, font, color);
         int w;
-        TTF_SizeUTF8(font, text, &w, NULL);
+        text_size(font, text, &w, NULL);
         return w;
     }
 
@@ -557,13 +501,13 @@ static int render_filename_with_ext(const char *text, int x, int y,
     render_text(name_part, x, y, font, color);
 
     int name_w;
-    TTF_SizeUTF8(font, name_part, &name_w, NULL);
+    text_size(font, name_part, &name_w, NULL);
 
     // Render extension part in dim color
     render_text(dot, x + name_w, y, font, ext_color);
 
     int ext_w;
-    TTF_SizeUTF8(font, dot, &ext_w, NULL);
+    text_size(font, dot, &ext_w, NULL);
     return name_w + ext_w;
 }
 
@@ -578,7 +522,7 @@ static void render_text_scrolling(const char *text, int x, int y, int max_width,
     if (!text || !text[0]) return;
 
     int text_width;
-    TTF_SizeUTF8(font, text, &text_width, NULL);
+    text_size(font, text, &text_width, NULL);
 
     // Fits on screen — render with extension color
     if (text_width <= max_width) {
@@ -609,6 +553,7 @@ static void render_text_scrolling(const char *text, int x, int y, int max_width,
         g_list_scroll_offset++;
         g_list_scroll_last_update = now;
     }
+    schedule_redraw(g_list_scroll_last_update + LIST_SCROLL_SPEED_MS + 1);
 
     // Build looping text
     char extended[512];
@@ -636,7 +581,7 @@ static void render_text_scrolling(const char *text, int x, int y, int max_width,
         visible[visible_len + 1] = '\0';
 
         int new_width;
-        TTF_SizeUTF8(font, visible, &new_width, NULL);
+        text_size(font, visible, &new_width, NULL);
         if (new_width > max_width) {
             visible[visible_len] = '\0';
             break;
@@ -659,12 +604,12 @@ static int render_dialog_title(const char *text, int y, int max_width) {
 
     TTF_Font *font = g_font_large;
     int w, h;
-    TTF_SizeUTF8(font, text, &w, &h);
+    text_size(font, text, &w, &h);
 
     // Fall back to medium if too wide
     if (w > max_width) {
         font = g_font_medium;
-        TTF_SizeUTF8(font, text, &w, &h);
+        text_size(font, text, &w, &h);
     }
 
     int x = (g_screen_width - w) / 2;
@@ -679,7 +624,7 @@ static void render_text_centered(const char *text, int y, TTF_Font *font, SDL_Co
     if (!text || !text[0]) return;
 
     int w, h;
-    TTF_SizeUTF8(font, text, &w, &h);
+    text_size(font, text, &w, &h);
     int x = (g_screen_width - w) / 2;
     render_text(text, x, y, font, color);
 }
@@ -691,7 +636,7 @@ static void render_text_centered_shadow(const char *text, int y, TTF_Font *font,
     if (!text || !text[0]) return;
 
     int w, h;
-    TTF_SizeUTF8(font, text, &w, &h);
+    text_size(font, text, &w, &h);
     int x = (g_screen_width - w) / 2;
     render_text_shadow(text, x, y, font, color);
 }
@@ -819,6 +764,35 @@ static void render_play_pause_icon(int center_x, int y, bool is_playing) {
     }
 }
 
+/**
+ * Render spectrum bars growing up from a baseline (player screen)
+ * Recomputes the bars when due and keeps the screen redrawing while they
+ * move; draws nothing unless the spectrum is active.
+ */
+static void render_spectrum(int x, int bottom_y, int w, int max_h, SDL_Color color, bool translucent) {
+    if (!spectrum_is_active() || max_h <= 0) return;
+
+    bool moving = spectrum_update();
+    if (moving || audio_is_playing()) {
+        schedule_redraw(SDL_GetTicks() + spectrum_get_interval_ms());
+    }
+
+    const float *bars = spectrum_get_bars();
+    int gap = 6;
+    int bar_w = (w - gap * (SPECTRUM_BARS - 1)) / SPECTRUM_BARS;
+    if (bar_w < 1) return;
+    int start_x = x + (w - (bar_w * SPECTRUM_BARS + gap * (SPECTRUM_BARS - 1))) / 2;
+
+    if (translucent) SDL_SetRenderDrawBlendMode(g_renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(g_renderer, color.r, color.g, color.b, translucent ? 200 : 255);
+    for (int i = 0; i < SPECTRUM_BARS; i++) {
+        int h = (int)(bars[i] * max_h);
+        if (h < 1) continue;
+        SDL_Rect bar = {start_x + i * (bar_w + gap), bottom_y - h, bar_w, h};
+        SDL_RenderFillRect(g_renderer, &bar);
+    }
+}
+
 /**
  * Render status bar (volume and battery) in top right corner
  * Call this from both browser and player renders
@@ -921,14 +895,14 @@ int ui_init(int width, int height) {
     // Initialize cover art system
     cover_init(g_renderer);
 
-    // Initialize text cache
-    text_cache_init();
+    // Glyph atlases for all text
+    text_atlas_init();
 
     return 0;
 }
 
 void ui_cleanup(void) {
-    text_cache_clear();  // Clear text cache before destroying renderer
+    text_atlas_cleanup();  // Atlas textures belong to the renderer
     cover_cleanup();
     if (g_font_large) TTF_CloseFont(g_font_large);
     if (g_font_medium) TTF_CloseFont(g_font_medium);
@@ -970,27 +944,28 @@ void ui_render_home(void) {
     // Menu items layout - responsive to screen height
     // Available space: between header (60) and footer (50)
     int content_height = g_screen_height - HEADER_HEIGHT - FOOTER_HEIGHT;
-    int menu_count = 5;
-    int menu_start_y = HEADER_HEIGHT + content_height / 10;
-    int item_height = content_height / 7;  // Each item takes ~1/7 of space (5 items)
+    int menu_count = 6;
+    int menu_start_y = HEADER_HEIGHT + content_height / 12;
+    int item_height = content_height / 8;  // Each item takes ~1/8 of space (6 items)
     int box_width = g_screen_width / 3;  // 1/3 of screen width
     int box_height = item_height - 12;  // Leave some padding
     int box_x = (g_screen_width - box_width) / 2;
 
-    // Menu items (5 options)
-    const char *labels[] = {"Resume", "Browse", "Favorites", "YouTube", "Spotify (Soon)"};
-    int counts[] = {resume_count, -1, favorites_count, -1, -1};  // -1 means no count shown
+    // Menu items (6 options)
+    const char *labels[] = {"Resume", "Browse", "Search", "Favorites", "YouTube", "Spotify (Soon)"};
+    int counts[] = {resume_count, -1, -1, favorites_count, -1, -1};  // -1 means no count shown
     bool yt_available = youtube_is_available();
     bool sp_available = false;  // Disabled until Spotify Developer API reopens
 
     for (int i = 0; i < menu_count; i++) {
         int y = menu_start_y + i * item_height;
         bool is_selected = (i == cursor);
-        // Resume/Favorites disabled if empty, YouTube/Spotify disabled if unavailable
+        // Resume/Favorites/Search disabled if empty, YouTube/Spotify disabled if unavailable
         bool is_disabled = (i == 0 && resume_count == 0) ||
-                          (i == 2 && favorites_count == 0) ||
-                          (i == 3 && !yt_available) ||
-                          (i == 4 && !sp_available);
+                          (i == 2 && searchindex_count() == 0) ||
+                          (i == 3 && favorites_count == 0) ||
+                          (i == 4 && !yt_available) ||
+                          (i == 5 && !sp_available);
 
         // Selection box
         if (is_selected) {
@@ -1009,7 +984,7 @@ void ui_render_home(void) {
 
         SDL_Color color = is_disabled ? COLOR_DIM : (is_selected ? COLOR_ACCENT : COLOR_TEXT);
         int text_h;
-        TTF_SizeUTF8(g_font_medium, display, NULL, &text_h);
+        text_size(g_font_medium, display, NULL, &text_h);
         render_text_centered(display, y + (box_height - text_h) / 2, g_font_medium, color);
     }
 
@@ -1214,13 +1189,7 @@ void ui_render_favorites(void) {
 }
 
 void ui_render_browser(void) {
-    // Periodically expire old cache entries
-    static Uint32 last_cache_expire = 0;
-    Uint32 now = SDL_GetTicks();
-    if (now - last_cache_expire > 1000) {  // Check every second
-        text_cache_expire();
-        last_cache_expire = now;
-    }
+    begin_tracked_frame();
 
     // Clear screen
     SDL_SetRenderDrawColor(g_renderer, COLOR_BG.r, COLOR_BG.g, COLOR_BG.b, 255);
@@ -1265,8 +1234,9 @@ void ui_render_browser(void) {
     // Color for played files (orange/amber)
     SDL_Color COLOR_PLAYED = {255, 160, 0, 255};
 
-    if (count == 0) {
-        render_text_centered("No music files found", g_screen_height / 2, g_font_medium, COLOR_DIM);
+    if (count == 0 || (count == 1 && browser_get_entry(0)->type == ENTRY_PARENT && browser_is_scanning())) {
+        const char *empty_msg = browser_is_scanning() ? "Scanning..." : "No music files found";
+        render_text_centered(empty_msg, g_screen_height / 2, g_font_medium, COLOR_DIM);
     }
 
     for (int i = 0; i < visible_count && (scroll + i) < count; i++) {
@@ -1274,8 +1244,13 @@ void ui_render_browser(void) {
         if (!entry) continue;
 
         bool is_selected = (scroll + i) == cursor;
-        bool is_favorite = (entry->type == ENTRY_FILE) && favorites_is_favorite(entry->full_path);
-        bool has_position = (entry->type == ENTRY_FILE) && (positions_get(entry->full_path) > 0);
+        bool is_favorite = false;
+        bool has_position = false;
+        if (entry->type == ENTRY_FILE) {
+            const char *entry_path = browser_get_entry_path(scroll + i);
+            is_favorite = favorites_is_favorite(entry_path);
+            has_position = positions_get(entry_path) > 0;
+        }
 
         // Selection highlight (thick retro border)
         if (is_selected) {
@@ -1372,7 +1347,7 @@ static void render_scrolling_text_centered(const char *text, int y, int max_widt
     if (!text || !text[0]) return;
 
     int text_width, text_height;
-    TTF_SizeUTF8(font, text, &text_width, &text_height);
+    text_size(font, text, &text_width, &text_height);
 
     if (text_width <= max_width) {
         // Fits on screen - render centered normally
@@ -1392,6 +1367,7 @@ static void render_scrolling_text_centered(const char *text, int y, int max_widt
         (*scroll_offset)++;
         g_player_scroll_last_update = now;
     }
+    schedule_redraw(g_player_scroll_last_update + PLAYER_SCROLL_SPEED_MS + 1);
 
     // Create extended text with gap for seamless loop
     char extended[512];
@@ -1423,7 +1399,7 @@ static void render_scrolling_text_centered(const char *text, int y, int max_widt
         visible[visible_len + 1] = '\0';
 
         int new_width;
-        TTF_SizeUTF8(font, visible, &new_width, NULL);
+        text_size(font, visible, &new_width, NULL);
 
         if (new_width > max_width) {
             // This char would overflow - stop here
@@ -1447,6 +1423,11 @@ static void render_scrolling_text_centered(const char *text, int y, int max_widt
 // Internal: renders player content without SDL_RenderPresent
 static void ui_render_player_content(void) {
     const TrackInfo *info = audio_get_track_info();
+
+    // Time label and progress bar move while playing
+    if (audio_is_playing()) {
+        schedule_redraw(SDL_GetTicks() + UI_PROGRESS_REDRAW_MS);
+    }
     SDL_Texture *cover = cover_get_texture();
     bool has_cover_bg = (cover != NULL);
 
@@ -1600,6 +1581,11 @@ static void ui_render_player_content(void) {
     int bar_w = g_screen_width - MARGIN * 4;
     int bar_h = 12;
 
+    // Spectrum bars between the play icon (40px) and the progress bar
+    int spectrum_h = bar_y - 16 - (play_icon_y + 56);
+    render_spectrum(bar_x, bar_y - 16, bar_w, spectrum_h < 120 ? spectrum_h : 120,
+                    icon_color, has_cover_bg);
+
     // Background bar (semi-transparent when cover bg)
     if (has_cover_bg) {
         SDL_SetRenderDrawBlendMode(g_renderer, SDL_BLENDMODE_BLEND);
@@ -1645,7 +1631,7 @@ static void ui_render_player_content(void) {
     snprintf(time_str, sizeof(time_str), "%s / %s", pos_str, dur_str);
 
     int tw, th;
-    TTF_SizeUTF8(g_font_small, time_str, &tw, &th);
+    text_size(g_font_small, time_str, &tw, &th);
     SDL_Color time_color = has_cover_bg ? cover_text : COLOR_DIM;
     if (has_cover_bg) {
         render_text_shadow(time_str, (g_screen_width - tw) / 2, bar_y + 24, g_font_small, time_color);
@@ -1659,7 +1645,7 @@ static void ui_render_player_content(void) {
         SDL_Color fmt_color = has_cover_bg ? cover_accent : COLOR_ACCENT;
         int fmt_x = bar_x + bar_w;
         int fmt_w;
-        TTF_SizeUTF8(g_font_small, fmt, &fmt_w, NULL);
+        text_size(g_font_small, fmt, &fmt_w, NULL);
         fmt_x -= fmt_w;
         if (has_cover_bg) {
             render_text_shadow(fmt, fmt_x, bar_y + 24, g_font_small, fmt_color);
@@ -1703,6 +1689,7 @@ static void ui_render_player_content(void) {
 }
 
 void ui_render_player(void) {
+    begin_tracked_frame();
     ui_render_player_content();
     render_version_watermark();
     SDL_RenderPresent(g_renderer);
@@ -1712,7 +1699,7 @@ void ui_render_menu(void) {
     // Render appropriate background based on menu mode
     // Player content behind when opened from player, solid bg otherwise
     int item_count = menu_get_item_count();
-    if (item_count == 4) {
+    if (menu_get_mode() == MENU_MODE_PLAYER) {
         // Player mode - render player underneath
         ui_render_player_content();
     } else {
@@ -1859,12 +1846,12 @@ void ui_render_equalizer(void) {
         const char *label = eq_get_band_label(i);
         // Center label text under bar
         int tw = 0, th = 0;
-        TTF_SizeText(g_font_small, label, &tw, &th);
+        text_size(g_font_small, label, &tw, &th);
         render_text(label, cx - tw / 2, label_y, g_font_small, label_color);
 
         // dB value above bar (positioned per column)
         const char *db_str = eq_get_band_string(i);
-        TTF_SizeText(g_font_small, db_str, &tw, &th);
+        text_size(g_font_small, db_str, &tw, &th);
         render_text(db_str, cx - tw / 2, bar_top - 36, g_font_small,
                    (i == selected) ? COLOR_TEXT : COLOR_DIM);
     }
@@ -2225,9 +2212,9 @@ void ui_render_resume_prompt(int saved_pos) {
 
     // Measure all text to size box responsively
     int title_w, title_h, sub_w, sub_h, hint_w, hint_h;
-    TTF_SizeUTF8(g_font_large, "Resume Playback?", &title_w, &title_h);
-    TTF_SizeUTF8(g_font_medium, position_text, &sub_w, &sub_h);
-    TTF_SizeUTF8(g_font_small, BTN_A ":Resume  " BTN_B ":Start Over", &hint_w, &hint_h);
+    text_size(g_font_large, "Resume Playback?", &title_w, &title_h);
+    text_size(g_font_medium, position_text, &sub_w, &sub_h);
+    text_size(g_font_small, BTN_A ":Resume  " BTN_B ":Start Over", &hint_w, &hint_h);
 
     int pad_x = 50;
     int pad_top = 30;
@@ -2325,7 +2312,7 @@ void ui_render_rename(void) {
             }
 
             int tw, th;
-            TTF_SizeUTF8(g_font_small, ch_str, &tw, &th);
+            text_size(g_font_small, ch_str, &tw, &th);
             int tx = x + (cell_w - tw) / 2;
             int ty = y + (cell_h - th) / 2;
 
@@ -2347,48 +2334,11 @@ void ui_render_rename(void) {
 // YouTube UI Rendering
 // ============================================================================
 
-void ui_render_youtube_search(void) {
-    // Clear screen
-    SDL_SetRenderDrawColor(g_renderer, COLOR_BG.r, COLOR_BG.g, COLOR_BG.b, 255);
-    SDL_RenderClear(g_renderer);
-
-    // Check if we're in SEARCHING state - show loading indicator
-    if (ytsearch_get_state() == YTSEARCH_SEARCHING) {
-        // Title
-        render_text_centered("YouTube Search", 20, g_font_medium, COLOR_ACCENT);
-
-        // Show searching message with animated monkey
-        render_dialog_title("Searching...", g_screen_height / 2 - 80, g_screen_width - 60);
-
-        // Show query being searched
-        const char *query = ytsearch_get_query();
-        if (query && query[0]) {
-            char display[128];
-            snprintf(display, sizeof(display), "\"%s\"", query);
-            render_text_centered(display, g_screen_height / 2 - 20, g_font_medium, COLOR_TEXT);
-        }
-
-        // Animated monkey (always animating during search)
-        int monkey_x = (g_screen_width - 16 * MONKEY_PIXEL_SIZE) / 2;
-        int monkey_y = g_screen_height / 2 + 40;
-        render_monkey(monkey_x, monkey_y, true);  // true = animate
-
-        // Hint
-        render_text_centered("Please wait...", g_screen_height - 100, g_font_small, COLOR_DIM);
-
-        render_version_watermark();
-        SDL_RenderPresent(g_renderer);
-        return;
-    }
-
-    // Title
-    render_text_centered("YouTube Search", 20, g_font_medium, COLOR_ACCENT);
-
-    // Current query with cursor
-    const char *query = ytsearch_get_query();
-    int cursor_pos = ytsearch_get_cursor();
-    int text_y = 80;
-
+/**
+ * Render a text input box with the cursor shown as '|'
+ * @param text_y Baseline of the text (the box starts 8px above)
+ */
+static void render_query_box(const char *query, int cursor_pos, int text_y) {
     // Text box background
     int box_w = g_screen_width - 80;
     int box_x = 40;
@@ -2402,14 +2352,19 @@ void ui_render_youtube_search(void) {
         snprintf(display, sizeof(display), "|");
     }
     render_text(display, box_x + 12, text_y, g_font_small, COLOR_TEXT);
+}
 
-    // Grid keyboard (QWERTY layout)
+/**
+ * Render the search keyboard grid (characters from ytsearch.c)
+ * @param kbd_y Top of the grid
+ * @param cur_row Selected row
+ * @param cur_col Selected column
+ * @return Bottom of the grid
+ */
+static int render_keyboard(int kbd_y, int cur_row, int cur_col) {
     int kbd_cols, kbd_rows;
     ytsearch_get_kbd_size(&kbd_cols, &kbd_rows);
-    int cur_row, cur_col;
-    ytsearch_get_kbd_pos(&cur_row, &cur_col);
 
-    int kbd_y = 150;
     int cell_w = 100;
     int cell_h = 70;
     int kbd_w = kbd_cols * cell_w;
@@ -2438,7 +2393,7 @@ void ui_render_youtube_search(void) {
             }
 
             int tw, th;
-            TTF_SizeUTF8(g_font_small, ch_str, &tw, &th);
+            text_size(g_font_small, ch_str, &tw, &th);
             int tx = x + (cell_w - tw) / 2;
             int ty = y + (cell_h - th) / 2;
 
@@ -2446,11 +2401,58 @@ void ui_render_youtube_search(void) {
             render_text(ch_str, tx, ty, g_font_small, color);
         }
     }
+    return kbd_y + kbd_rows * cell_h;
+}
+
+void ui_render_youtube_search(void) {
+    // Clear screen
+    SDL_SetRenderDrawColor(g_renderer, COLOR_BG.r, COLOR_BG.g, COLOR_BG.b, 255);
+    SDL_RenderClear(g_renderer);
+
+    // Check if we're in SEARCHING state - show loading indicator
+    if (ytsearch_get_state() == YTSEARCH_SEARCHING) {
+        // Title
+        render_text_centered("YouTube Search", 20, g_font_medium, COLOR_ACCENT);
+
+        // Show searching message with animated monkey
+        render_dialog_title("Searching...", g_screen_height / 2 - 80, g_screen_width - 60);
+
+        // Show query being searched
+        const char *query = ytsearch_get_query();
+        if (query && query[0]) {
+            char display[128];
+            snprintf(display, sizeof(display), "\"%s\"", query);
+            render_text_centered(display, g_screen_height / 2 - 20, g_font_medium, COLOR_TEXT);
+        }
+
+        // Animated monkey (always animating during search)
+        int monkey_x = (g_screen_width - 16 * MONKEY_PIXEL_SIZE) / 2;
+        int monkey_y = g_screen_height / 2 + 40;
+        render_monkey(monkey_x, monkey_y, true);  // true = animate
+
+        // Hint
+        render_text_centered("Please wait...", g_screen_height - 100, g_font_small, COLOR_DIM);
+
+        render_version_watermark();
+        SDL_RenderPresent(g_renderer);
+        return;
+    }
+
+    // Title
+    render_text_centered("YouTube Search", 20, g_font_medium, COLOR_ACCENT);
+
+    // Current query with cursor
+    render_query_box(ytsearch_get_query(), ytsearch_get_cursor(), 80);
+
+    // Grid keyboard (QWERTY layout)
+    int cur_row, cur_col;
+    ytsearch_get_kbd_pos(&cur_row, &cur_col);
+    int kbd_bottom = render_keyboard(150, cur_row, cur_col);
 
     // Error message if any
     const char *error = ytsearch_get_error();
     if (error) {
-        render_text_centered(error, kbd_y + kbd_rows * cell_h + 10, g_font_small, COLOR_ERROR);
+        render_text_centered(error, kbd_bottom + 10, g_font_small, COLOR_ERROR);
     }
 
     // Controls
@@ -2477,7 +2479,8 @@ void ui_render_youtube_results(void) {
     // Header
     const char *query = ytsearch_get_query();
     char header[128];
-    snprintf(header, sizeof(header), "Results: %s", query);
+    snprintf(header, sizeof(header), "Results: %s%s", query,
+             ytsearch_is_searching() ? "  (searching...)" : "");
     render_text(header, MARGIN, 8, g_font_small, COLOR_TEXT);
 
     // Results list
@@ -2597,6 +2600,121 @@ void ui_render_youtube_results(void) {
     SDL_RenderPresent(g_renderer);
 }
 
+void ui_render_library_search(void) {
+    // Clear screen
+    SDL_SetRenderDrawColor(g_renderer, COLOR_BG.r, COLOR_BG.g, COLOR_BG.b, 255);
+    SDL_RenderClear(g_renderer);
+
+    // Title
+    render_text_centered("Library Search", 20, g_font_medium, COLOR_ACCENT);
+
+    // Current query with cursor
+    const char *query = libsearch_get_query();
+    render_query_box(query, libsearch_get_cursor(), 80);
+
+    // Grid keyboard (same grid as YouTube search)
+    int cur_row, cur_col;
+    libsearch_get_kbd_pos(&cur_row, &cur_col);
+    int y = render_keyboard(150, cur_row, cur_col) + 10;
+
+    // Match count, then as many matches as fit above the controls
+    char status[96];
+    int matches = libsearch_get_match_count();
+    if (!query[0]) {
+        snprintf(status, sizeof(status), "%d tracks", searchindex_count());
+    } else if (matches == 0) {
+        snprintf(status, sizeof(status), "No matches");
+    } else {
+        snprintf(status, sizeof(status), "%d match%s (%.1f ms)", matches,
+                 matches == 1 ? "" : "es", libsearch_get_query_ms());
+    }
+    render_text_centered(status, y, g_font_small, COLOR_DIM);
+    y += 36;
+
+    int ctrl_y = g_screen_height - 100;
+    int max_width = g_screen_width - 2 * MARGIN;
+    for (int i = 0; y + 30 <= ctrl_y - 6; i++, y += 32) {
+        const SearchHit *hit = libsearch_get_result(i);
+        if (!hit) break;
+        char line[520];
+        snprintf(line, sizeof(line), "%s  -  %s", hit->title, hit->detail);
+        render_text_truncated(line, MARGIN, y, max_width, g_font_small, COLOR_TEXT);
+    }
+
+    // Controls
+    render_text_centered("D-Pad: Move   " BTN_A ": Insert   " BTN_B ": Delete", ctrl_y, g_font_small, COLOR_DIM);
+    render_text_centered(BTN_START ": Results   " BTN_SELECT ": Cancel", ctrl_y + 30, g_font_small, COLOR_DIM);
+
+    render_version_watermark();
+    SDL_RenderPresent(g_renderer);
+}
+
+void ui_render_library_results(void) {
+    // Clear screen
+    SDL_SetRenderDrawColor(g_renderer, COLOR_BG.r, COLOR_BG.g, COLOR_BG.b, 255);
+    SDL_RenderClear(g_renderer);
+
+    // Header
+    char header[160];
+    snprintf(header, sizeof(header), "Results: %s", libsearch_get_query());
+    render_text(header, MARGIN, 8, g_font_small, COLOR_TEXT);
+
+    int result_count = libsearch_get_result_count();
+    int cursor = libsearch_get_results_cursor();
+    int scroll = libsearch_get_scroll_offset();
+
+    int y = HEADER_HEIGHT + 10;
+    int visible = 7;
+    int max_width = g_screen_width - 2 * MARGIN - 20;
+
+    for (int i = 0; i < visible && (scroll + i) < result_count; i++) {
+        int idx = scroll + i;
+        const SearchHit *hit = libsearch_get_result(idx);
+        if (!hit) continue;
+
+        bool is_selected = (idx == cursor);
+
+        // Highlight selected item
+        if (is_selected) {
+            draw_rect(0, y - 5, g_screen_width, LINE_HEIGHT + 10, COLOR_HIGHLIGHT);
+        }
+
+        // Title, then artist/album (or folder) on the next line
+        render_text_truncated(hit->title, MARGIN + 10, y, max_width,
+                              g_font_small, is_selected ? COLOR_ACCENT : COLOR_TEXT);
+        render_text_truncated(hit->detail, MARGIN + 20, y + 28, max_width - 10,
+                              g_font_small, COLOR_DIM);
+
+        y += LINE_HEIGHT + 10;
+    }
+
+    // Scroll indicators
+    if (scroll > 0) {
+        render_text_centered("^ more ^", HEADER_HEIGHT - 5, g_font_small, COLOR_DIM);
+    }
+    if (scroll + visible < result_count) {
+        render_text_centered("v more v", g_screen_height - 70, g_font_small, COLOR_DIM);
+    }
+
+    // Footer (the list holds the best matches when there are more)
+    char footer[64];
+    int matches = libsearch_get_match_count();
+    if (matches > result_count) {
+        snprintf(footer, sizeof(footer), "%d of %d  (%d matches)", cursor + 1, result_count, matches);
+    } else {
+        snprintf(footer, sizeof(footer), "%d of %d", cursor + 1, result_count);
+    }
+    render_text_centered(footer, g_screen_height - 45, g_font_small, COLOR_DIM);
+
+    render_text(BTN_A ":Play  " BTN_B ":Back", MARGIN, g_screen_height - SCREEN_PAD - 22, g_font_hint, COLOR_DIM);
+
+    // Render toast overlay before present
+    render_toast_overlay();
+
+    render_version_watermark();
+    SDL_RenderPresent(g_renderer);
+}
+
 void ui_render_youtube_download(void) {
     // Clear screen
     SDL_SetRenderDrawColor(g_renderer, COLOR_BG.r, COLOR_BG.g, COLOR_BG.b, 255);
@@ -2719,6 +2837,10 @@ void ui_render_download_queue(void) {
                 status_icon = "[>>]";
                 status_color = COLOR_ACCENT;
                 break;
+            case DL_CONVERTING:
+                status_icon = "[~~]";
+                status_color = COLOR_ACCENT;
+                break;
             case DL_COMPLETE:
                 status_icon = "[OK]";
                 status_color = COLOR_ACCENT;
@@ -2747,8 +2869,8 @@ void ui_render_download_queue(void) {
         render_text(title_display, MARGIN + 70, y, g_font_small,
                    is_selected ? COLOR_ACCENT : COLOR_TEXT);
 
-        // Progress bar for downloading items
-        if (item->status == DL_DOWNLOADING) {
+        // Progress bar for downloading/converting items
+        if (item->status == DL_DOWNLOADING || item->status == DL_CONVERTING) {
             int bar_x = g_screen_width - MARGIN - 150;
             int bar_w = 130;
             int bar_h = 16;
@@ -2827,11 +2949,14 @@ static void render_toast_overlay(void) {
     if (elapsed_ms > UI_TOAST_DURATION_MS - TOAST_FADE_MS) {
         alpha = 255 * (UI_TOAST_DURATION_MS - elapsed_ms) / TOAST_FADE_MS;
         if (alpha < 0) alpha = 0;
+        schedule_redraw(now + 33);  // Animate the fade
+    } else {
+        schedule_redraw(g_toast_start_time + UI_TOAST_DURATION_MS - TOAST_FADE_MS);
     }
 
     // Calculate text width for background box
     int text_w, text_h;
-    TTF_SizeUTF8(g_font_small, g_toast_message, &text_w, &text_h);
+    text_size(g_font_small, g_toast_message, &text_w, &text_h);
 
     int box_w = text_w + 40;
     int box_h = text_h + 20;
@@ -2850,52 +2975,117 @@ static void render_toast_overlay(void) {
 
     // Text (centered in box)
     SDL_Color text_color = {COLOR_TEXT.r, COLOR_TEXT.g, COLOR_TEXT.b, (Uint8)alpha};
-    SDL_Surface *surface = TTF_RenderUTF8_Blended(g_font_small, g_toast_message, text_color);
-    if (surface) {
-        SDL_Texture *texture = SDL_CreateTextureFromSurface(g_renderer, surface);
-        if (texture) {
-            SDL_SetTextureAlphaMod(texture, (Uint8)alpha);
-            SDL_Rect dest = {
-                box_x + (box_w - text_w) / 2,
-                box_y + (box_h - text_h) / 2,
-                text_w,
-                text_h
-            };
-            SDL_RenderCopy(g_renderer, texture, NULL, &dest);
-            SDL_DestroyTexture(texture);
-        }
-        SDL_FreeSurface(surface);
+    render_text(g_toast_message, box_x + (box_w - text_w) / 2, box_y + (box_h - text_h) / 2,
+                g_font_small, text_color);
+}
+
+/**
+ * Internal: Render the perf HUD (top-left, under the header), see perfhud.h
+ */
+static void render_perf_hud(void) {
+    if (!perfhud_is_visible()) return;
+    schedule_redraw(SDL_GetTicks() + PERFHUD_REFRESH_MS);
+
+    PerfHudStats perf;
+    perfhud_get_stats(&perf);
+
+    // Text cache: all font atlases, plus the cover as the other texture
+    GlyphAtlasStats total = {0};
+    int textures = 0;
+    for (int i = 0; i < FONT_COUNT; i++) {
+        if (!g_atlases[i].atlas) continue;
+        GlyphAtlasStats s;
+        glyph_atlas_stats(g_atlases[i].atlas, &s);
+        total.hits += s.hits;
+        total.misses += s.misses;
+        total.resets += s.resets;
+        total.glyphs += s.glyphs;
+        textures++;
+    }
+    if (cover_get_texture()) textures++;
+    unsigned long lookups = total.hits + total.misses;
+    float hit_pct = lookups ? 100.0f * total.hits / lookups : 100.0f;
+
+    JsonArenaStats json;
+    json_arena_stats(&json);
+    int wakeups = 0;
+    int period = audio_get_period(&wakeups);
+    AudioStats audio;
+    audiostats_read(&audio);
+    const AudioPathStats *hook = &audio.path[AUDIO_PATH_FLAC_HOOK];
+    const AudioPathStats *post = &audio.path[AUDIO_PATH_POSTMIX];
+
+    const char *preload_path = preload_get_path();
+    const char *preload_name = preload_path ? strrchr(preload_path, '/') : NULL;
+    preload_name = preload_name ? preload_name + 1 : (preload_path ? preload_path : "");
+    const char *dl_title = dlqueue_get_current_title();
+
+    char lines[8][128];
+    int line_count = (int)(sizeof(lines) / sizeof(lines[0]));
+    snprintf(lines[0], sizeof(lines[0]), "frame p50 %.1f  p95 %.1f  p99 %.1f  max %.1f ms (%d)",
+             perf.frame_p50_ms, perf.frame_p95_ms, perf.frame_p99_ms, perf.frame_max_ms,
+             perf.target_ms);
+    snprintf(lines[1], sizeof(lines[1]), "update %.2f  render %.2f ms  %d fps  %d passes/s",
+             perf.update_avg_ms, perf.render_avg_ms, perf.drawn_per_sec, perf.passes_per_sec);
+    snprintf(lines[2], sizeof(lines[2]), "glyphs %.1f%% hit  %lu miss  %lu reset  %d cached  %d tex",
+             hit_pct, total.misses, total.resets, total.glyphs, textures);
+    snprintf(lines[3], sizeof(lines[3]), "rss %.1f MB  avail %ld MB  json peak %zu KB",
+             perf.rss_kb >= 0 ? perf.rss_kb / 1024.0f : 0.0f, memgov_available_kb() / 1024,
+             json.peak_bytes / 1024);
+    snprintf(lines[4], sizeof(lines[4]), "audio period %d (%d/s)  miss %u  late %u  gap max %.1f ms",
+             period, wakeups, audio.deadline_misses, audio.late_callbacks,
+             audio.worst_gap_us / 1000.0f);
+    snprintf(lines[5], sizeof(lines[5]), "audio us avg/p99/max  hook %u/%u/%u  post %u/%u/%u",
+             hook->avg_us, audiostats_percentile_us(hook, 99), hook->worst_us,
+             post->avg_us, audiostats_percentile_us(post, 99), post->worst_us);
+    snprintf(lines[6], sizeof(lines[6]), "preload %s %.60s",
+             !preload_path ? "idle" : (preload_is_ready() ? "ready" : "loading"), preload_name);
+    if (dlqueue_is_downloading()) {
+        snprintf(lines[7], sizeof(lines[7]), "download %d%%  %d queued  %.50s",
+                 dlqueue_get_progress(), dlqueue_pending_count(), dl_title ? dl_title : "");
+    } else {
+        snprintf(lines[7], sizeof(lines[7]), "download idle  %d queued", dlqueue_pending_count());
+    }
+
+    int line_h = 0;
+    int box_w = 0;
+    for (int i = 0; i < line_count; i++) {
+        int w, h;
+        text_size(g_font_tiny, lines[i], &w, &h);
+        if (w > box_w) box_w = w;
+        if (h > line_h) line_h = h;
+    }
+    int x = SCREEN_PAD;
+    int y = HEADER_HEIGHT + 8;
+
+    SDL_SetRenderDrawBlendMode(g_renderer, SDL_BLENDMODE_BLEND);
+    draw_rect(x - 6, y - 4, box_w + 12, line_h * line_count + 8, (SDL_Color){0, 0, 0, 180});
+    SDL_Color hud_color = {255, 255, 255, 230};
+    for (int i = 0; i < line_count; i++) {
+        render_text(lines[i], x, y + i * line_h, g_font_tiny, hud_color);
     }
 }
 
 /**
  * Internal: Render version watermark (bottom-right corner)
+ * Also draws the perf HUD when shown: every screen ends with this.
  */
 static void render_version_watermark(void) {
+    render_perf_hud();
+
     char version_str[32];
     snprintf(version_str, sizeof(version_str), "v%s", VERSION);
 
     // Render small, dimmed text in bottom-right corner
     int text_w, text_h;
-    TTF_SizeUTF8(g_font_tiny, version_str, &text_w, &text_h);
+    text_size(g_font_tiny, version_str, &text_w, &text_h);
 
     int x = g_screen_width - text_w - SCREEN_PAD;
     int y = g_screen_height - text_h - SCREEN_PAD;
 
-    // Very dim color (like a watermark)
+    // Very dim color (like a watermark), 50% opacity
     SDL_Color watermark_color = {COLOR_DIM.r, COLOR_DIM.g, COLOR_DIM.b, 128};
-
-    SDL_Surface *surface = TTF_RenderUTF8_Blended(g_font_tiny, version_str, watermark_color);
-    if (surface) {
-        SDL_Texture *texture = SDL_CreateTextureFromSurface(g_renderer, surface);
-        if (texture) {
-            SDL_SetTextureAlphaMod(texture, 128);  // 50% opacity
-            SDL_Rect dest = {x, y, text_w, text_h};
-            SDL_RenderCopy(g_renderer, texture, NULL, &dest);
-            SDL_DestroyTexture(texture);
-        }
-        SDL_FreeSurface(surface);
-    }
+    render_text(version_str, x, y, g_font_tiny, watermark_color);
 }
 
 void ui_show_toast(const char *message) {
@@ -2906,6 +3096,7 @@ void ui_show_toast(const char *message) {
     strncpy(g_toast_message, message, sizeof(g_toast_message) - 1);
     g_toast_message[sizeof(g_toast_message) - 1] = '\0';
     g_toast_start_time = SDL_GetTicks();
+    g_ui_dirty = true;
 }
 
 bool ui_toast_active(void) {
@@ -3064,7 +3255,7 @@ void ui_render_spotify_search(void) {
             }
 
             int tw, th;
-            TTF_SizeUTF8(g_font_small, ch_str, &tw, &th);
+            text_size(g_font_small, ch_str, &tw, &th);
             int tx = x + (cell_w - tw) / 2;
             int ty = y + (cell_h - th) / 2;
 
@@ -3242,6 +3433,42 @@ void ui_render_spotify_player(void) {
     render_text_centered(buf_status, g_screen_height - 120, g_font_small,
                         receiving ? COLOR_ACCENT : COLOR_DIM);
 
+    // Streaming stats: link quality and how the pre-buffer adapted to it
+    SpAudioStats stats;
+    sp_audio_get_stats(&stats);
+
+    char stats_line[128];
+    snprintf(stats_line, sizeof(stats_line), "Target %d.%ds  Jitter %dms  %dKB/s  Underruns %d",
+             stats.prebuffer_ms / 1000, (stats.prebuffer_ms % 1000) / 100,
+             stats.jitter_ms, stats.throughput_kbps, stats.underruns);
+    render_text_centered(stats_line, center_y + 160, g_font_hint, COLOR_DIM);
+
+    if (stats.first_audio_ms >= 0) {
+        snprintf(stats_line, sizeof(stats_line), "First audio %dms", stats.first_audio_ms);
+    } else {
+        snprintf(stats_line, sizeof(stats_line), "Buffering %d/%dms", stats.buffered_ms, stats.prebuffer_ms);
+    }
+    render_text_centered(stats_line, center_y + 190, g_font_hint, COLOR_DIM);
+
+    // Fill-level histogram (left = nearly empty, right = well buffered)
+    uint32_t hist_max = 0;
+    for (int i = 0; i < SP_FILL_BUCKETS; i++) {
+        if (stats.fill_histogram[i] > hist_max) hist_max = stats.fill_histogram[i];
+    }
+    if (hist_max > 0) {
+        int bar_w = 16;
+        int bar_gap = 4;
+        int hist_h = 24;
+        int hist_x = (g_screen_width - SP_FILL_BUCKETS * (bar_w + bar_gap) + bar_gap) / 2;
+        int hist_base = center_y + 250;
+        for (int i = 0; i < SP_FILL_BUCKETS; i++) {
+            int h = (int)(stats.fill_histogram[i] * hist_h / hist_max);
+            if (h < 1) h = 1;
+            draw_rect(hist_x + i * (bar_w + bar_gap), hist_base - h, bar_w, h,
+                      i == 0 ? COLOR_DIM : COLOR_ACCENT);
+        }
+    }
+
     // Dancing monkey (animates while streaming)
     int monkey_x = (g_screen_width - 16 * MONKEY_PIXEL_SIZE) / 2;
     int monkey_y = g_screen_height - 180;
@@ -3291,7 +3518,7 @@ void ui_render_update(void) {
             char version_text[128];
             int ver_h;
             snprintf(version_text, sizeof(version_text), "Current: v%s  ->  New: %s", VERSION, info->version);
-            TTF_SizeUTF8(g_font_medium, version_text, NULL, &ver_h);
+            text_size(g_font_medium, version_text, NULL, &ver_h);
             render_text_centered(version_text, avail_y, g_font_medium, COLOR_TEXT);
 
             // Changelog preview (first 3 lines)
@@ -3408,3 +3635,16 @@ void ui_render_update(void) {
     render_version_watermark();
     SDL_RenderPresent(g_renderer);
 }
+
+void ui_invalidate(void) {
+    g_ui_dirty = true;
+}
+
+bool ui_needs_redraw(void) {
+    return g_ui_dirty || (Sint32)(SDL_GetTicks() - g_ui_redraw_at) >= 0;
+}
+
+Uint32 ui_ms_until_redraw(void) {
+    if (ui_needs_redraw()) return 0;
+    return g_ui_redraw_at - SDL_GetTicks();
+}
@@ -125,6 +125,16 @@ void ui_render_youtube_search(void);
  */
 void ui_render_youtube_results(void);
 
+/**
+ * Render library search input screen (keyboard and first matches)
+ */
+void ui_render_library_search(void);
+
+/**
+ * Render library search results list
+ */
+void ui_render_library_results(void);
+
 /**
  * Render YouTube download progress
  */
@@ -187,4 +197,22 @@ void ui_player_reset_scroll(void);
  */
 int ui_get_list_visible_rows(void);
 
+/**
+ * Mark the screen as changed (input, state change, new data)
+ * Only the browser and player screens track damage; others always redraw.
+ */
+void ui_invalidate(void);
+
+/**
+ * Check if the browser/player screen has anything new to show
+ * @return true if invalidated or a scheduled animation frame is due
+ */
+bool ui_needs_redraw(void);
+
+/**
+ * Time until the next scheduled visible change
+ * @return Milliseconds (0 if a redraw is already due)
+ */
+Uint32 ui_ms_until_redraw(void);
+
 #endif // UI_H
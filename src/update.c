@@ -1,38 +1,72 @@
 /**
  * Self-Update Implementation
  *
- * Uses curl CLI to fetch GitHub releases API and download binary.
- * Follows patterns from metadata.c and youtube.c.
+ * Checks and downloads run on a worker thread so the update screen keeps
+ * drawing. The release lookup is a conditional request (If-None-Match
+ * with the last ETag), so an unchanged release is answered from the
+ * cached JSON. The asset is streamed through http.c: for a zip, the local
+ * file headers are walked as they arrive and only bin/mono is kept (in
+ * memory) and inflated; every other entry is skipped unread. The binary
+ * is verified (size, CRC-32, ELF magic) and written next to the current
+ * one, then swapped in with rename().
  */
 
 #include "update.h"
 #include "version.h"
+#include "http.h"
+#include "persist.h"
+#include "state.h"
+#include "stb_image.h"
 #include "cJSON.h"
+#include "jsonarena.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <stdint.h>
+#include <stdarg.h>
 
 #ifdef __APPLE__
 #include <mach-o/dyld.h>  // For _NSGetExecutablePath
 #endif
 
-// Temporary file paths
-#define TEMP_API_RESPONSE "/tmp/mono_update_api.json"
-#define TEMP_BINARY       "/tmp/mono_update_binary"
-#define TEMP_ZIP          "/tmp/mono_update.zip"
-#define TEMP_EXTRACT_DIR  "/tmp/mono_extract"
 #define BACKUP_SUFFIX     ".bak"
+#define NEW_SUFFIX        ".new"
+
+// Cached release response (data dir)
+#define RELEASE_CACHE_FILE "update_release.json"
+#define RELEASE_ETAG_FILE  "update_release.etag"
 
 // GitHub API endpoint
 #define GITHUB_API_URL "https://api.github.com/repos/" GITHUB_REPO_OWNER "/" GITHUB_REPO_NAME "/releases/latest"
 
 // Timeout for curl operations (seconds)
 #define CURL_TIMEOUT 30
-
-// State
+#define DOWNLOAD_TIMEOUT 120
+
+// Stream chunk, and the largest binary we accept
+#define STREAM_CHUNK (64 * 1024)
+#define MAX_BINARY_SIZE (32 * 1024 * 1024)
+
+// Zip local file header
+#define ZIP_LOCAL_SIG 0x04034b50
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_FLAG_DATA_DESCRIPTOR 0x0008
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATE 8
+
+// Worker jobs
+typedef enum {
+    JOB_NONE,
+    JOB_CHECK,
+    JOB_DOWNLOAD
+} UpdateJob;
+
+// State (shared with the worker, guarded by g_mutex)
 static UpdateState g_state = UPDATE_IDLE;
 static UpdateInfo g_info = {0};
 static char g_error[256] = {0};
@@ -44,6 +78,28 @@ static char g_binary_path[512] = {0};
 // Whether current download is a zip (vs bare binary)
 static bool g_is_zip = false;
 
+// Worker
+static pthread_t g_thread;
+static bool g_thread_running = false;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static UpdateJob g_job = JOB_NONE;
+static bool g_shutdown = false;
+static HttpCall *g_active_call = NULL;   // Streamed download in flight
+
+// A job is queued or running
+#define JOB_BUSY() (g_job != JOB_NONE || g_state == UPDATE_CHECKING || \
+                    g_state == UPDATE_DOWNLOADING)
+
+/**
+ * Streamed download being consumed by the worker
+ */
+typedef struct {
+    HttpCall *call;
+    size_t received;
+    size_t total;        // Expected bytes, 0 = unknown
+} Stream;
+
 /**
  * Compare version strings
  * Returns: -1 if v1 < v2, 0 if equal, 1 if v1 > v2
@@ -93,143 +149,226 @@ static const char* get_binary_path(void) {
     return g_binary_path;
 }
 
-void update_init(void) {
-    g_state = UPDATE_IDLE;
-    memset(&g_info, 0, sizeof(g_info));
-    g_error[0] = '\0';
-    g_progress = 0;
+/**
+ * Move to a new state
+ */
+static void set_state(UpdateState state) {
+    pthread_mutex_lock(&g_mutex);
+    g_state = state;
+    pthread_mutex_unlock(&g_mutex);
+}
 
-    // Initialize binary path
-    get_binary_path();
+/**
+ * Record an error and move to UPDATE_ERROR
+ */
+static void set_error(const char *fmt, ...) {
+    char msg[sizeof(g_error)];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+
+    printf("[UPDATE] Error: %s\n", msg);
+
+    pthread_mutex_lock(&g_mutex);
+    snprintf(g_error, sizeof(g_error), "%s", msg);
+    g_state = UPDATE_ERROR;
+    pthread_mutex_unlock(&g_mutex);
 }
 
-void update_cleanup(void) {
-    // Clean up temp files
-    unlink(TEMP_API_RESPONSE);
-    unlink(TEMP_BINARY);
-    unlink(TEMP_ZIP);
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "rm -rf '%s' 2>/dev/null", TEMP_EXTRACT_DIR);
-    system(cmd);
+/**
+ * Whether the worker should give up (app is exiting)
+ */
+static bool should_stop(void) {
+    pthread_mutex_lock(&g_mutex);
+    bool stop = g_shutdown;
+    pthread_mutex_unlock(&g_mutex);
+    return stop;
 }
 
-void update_check(void) {
-    g_state = UPDATE_CHECKING;
-    g_error[0] = '\0';
-    memset(&g_info, 0, sizeof(g_info));
+/**
+ * Path of a file in the data directory
+ * @return false if there is no data directory
+ */
+static bool data_path(const char *name, char *path, size_t size) {
+    const char *data_dir = state_get_data_dir();
+    if (!data_dir || !data_dir[0]) return false;
+    snprintf(path, size, "%s/%s", data_dir, name);
+    return true;
+}
 
-    printf("[UPDATE] Checking for updates...\n");
-    printf("[UPDATE] Current version: %s\n", VERSION);
+/**
+ * Read a small file into a NUL-terminated malloc'd buffer
+ * @return Contents, or NULL if missing/unreadable
+ */
+static char* read_small_file(const char *path, size_t *out_len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (len <= 0 || len > 1024 * 1024) {
+        fclose(f);
+        return NULL;
+    }
+
+    char *buf = malloc(len + 1);
+    if (buf && fread(buf, 1, len, f) != (size_t)len) {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(f);
+    if (!buf) return NULL;
+
+    buf[len] = '\0';
+    if (out_len) *out_len = len;
+    return buf;
 }
 
-bool update_check_complete(void) {
-    if (g_state != UPDATE_CHECKING) return true;
-
-    // Execute curl to fetch GitHub API
-    // Note: -k skips SSL verification (Trimui lacks updated CA certs)
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd),
-        "curl -s -k -m %d -A '%s' "
-        "-H 'Accept: application/vnd.github.v3+json' "
-        "'%s' -o '%s' 2>/dev/null",
-        CURL_TIMEOUT, VERSION_USER_AGENT, GITHUB_API_URL, TEMP_API_RESPONSE);
-
-    int ret = system(cmd);
-    if (ret != 0) {
-        snprintf(g_error, sizeof(g_error), "Network error (curl failed)");
-        g_state = UPDATE_ERROR;
-        printf("[UPDATE] curl failed with code %d\n", ret);
-        return true;
+/**
+ * Fetch the latest release JSON, revalidating the cached copy
+ * @return malloc'd JSON, or NULL (error already set)
+ */
+static char* fetch_release_json(void) {
+    char body_path[512];
+    char etag_path[512];
+    bool can_cache = data_path(RELEASE_CACHE_FILE, body_path, sizeof(body_path)) &&
+                     data_path(RELEASE_ETAG_FILE, etag_path, sizeof(etag_path));
+
+    char *etag = can_cache ? read_small_file(etag_path, NULL) : NULL;
+    char if_none_match[192] = {0};
+    if (etag) {
+        etag[strcspn(etag, "\r\n")] = '\0';
+        if (etag[0]) snprintf(if_none_match, sizeof(if_none_match), "If-None-Match: %s", etag);
+        free(etag);
     }
 
-    // Read response file
-    FILE *f = fopen(TEMP_API_RESPONSE, "r");
-    if (!f) {
-        snprintf(g_error, sizeof(g_error), "Failed to read API response");
-        g_state = UPDATE_ERROR;
-        return true;
+    // Note: insecure skips SSL verification (Trimui lacks updated CA certs)
+    HttpRequest req = {
+        .url = GITHUB_API_URL,
+        .headers = { "Accept: application/vnd.github.v3+json",
+                     if_none_match[0] ? if_none_match : NULL, NULL },
+        .user_agent = VERSION_USER_AGENT,
+        .timeout_sec = CURL_TIMEOUT,
+        .max_body = 100 * 1024,  // Max 100KB response
+        .insecure = true,
+    };
+    HttpResponse resp;
+
+    if (!http_request(&req, &resp)) {
+        set_error("Network error (curl failed)");
+        return NULL;
     }
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+    // Unchanged since the last check: GitHub sends no body (and doesn't
+    // count it against the rate limit)
+    if (resp.status == 304) {
+        http_response_free(&resp);
+        char *cached = read_small_file(body_path, NULL);
+        if (cached) {
+            printf("[UPDATE] Release unchanged, using cached response\n");
+            return cached;
+        }
 
-    if (size <= 0 || size > 100 * 1024) {  // Max 100KB response
-        fclose(f);
-        snprintf(g_error, sizeof(g_error), "Invalid API response");
-        g_state = UPDATE_ERROR;
-        return true;
+        // Cache went missing; ask again without the validator
+        unlink(etag_path);
+        req.headers[1] = NULL;
+        if (!http_request(&req, &resp)) {
+            set_error("Network error (curl failed)");
+            return NULL;
+        }
     }
 
-    char *json = malloc(size + 1);
-    if (!json) {
-        fclose(f);
-        snprintf(g_error, sizeof(g_error), "Out of memory");
-        g_state = UPDATE_ERROR;
-        return true;
+    if (!resp.body) {
+        http_response_free(&resp);
+        set_error("Invalid API response");
+        return NULL;
     }
 
-    size_t read = fread(json, 1, size, f);
-    json[read] = '\0';
-    fclose(f);
-    unlink(TEMP_API_RESPONSE);
+    if (can_cache && resp.status == 200 && resp.etag[0]) {
+        persist_write(body_path, resp.body, resp.body_len);
+        persist_write(etag_path, resp.etag, strlen(resp.etag));
+    }
 
-    // Parse JSON response
-    cJSON *root = cJSON_Parse(json);
-    free(json);
+    // Hand the body over to the caller
+    return resp.body;
+}
 
+/**
+ * Copy the download URL and size of a release asset
+ */
+static void read_asset(cJSON *asset, UpdateInfo *info, bool *found) {
+    cJSON *url = cJSON_GetObjectItem(asset, "browser_download_url");
+    cJSON *size_obj = cJSON_GetObjectItem(asset, "size");
+
+    if (url && cJSON_IsString(url)) {
+        strncpy(info->download_url, url->valuestring, sizeof(info->download_url) - 1);
+        *found = true;
+    }
+    if (size_obj && cJSON_IsNumber(size_obj)) {
+        info->size_bytes = (size_t)size_obj->valuedouble;
+    }
+}
+
+/**
+ * Parse the releases API response into g_info
+ * Sets the resulting state (AVAILABLE, UP_TO_DATE or ERROR).
+ */
+static void parse_release(const char *json) {
+    cJSON *root = json_arena_parse(json);
     if (!root) {
-        snprintf(g_error, sizeof(g_error), "Failed to parse API response");
-        g_state = UPDATE_ERROR;
-        return true;
+        set_error("Failed to parse API response");
+        return;
     }
 
     // Check for API error
     cJSON *message = cJSON_GetObjectItem(root, "message");
     if (message && cJSON_IsString(message)) {
-        snprintf(g_error, sizeof(g_error), "GitHub: %s", message->valuestring);
-        cJSON_Delete(root);
-        g_state = UPDATE_ERROR;
-        return true;
+        set_error("GitHub: %s", message->valuestring);
+        json_arena_release(root);
+        return;
     }
 
     // Extract version (tag_name)
     cJSON *tag_name = cJSON_GetObjectItem(root, "tag_name");
     if (!tag_name || !cJSON_IsString(tag_name)) {
-        snprintf(g_error, sizeof(g_error), "No version in response");
-        cJSON_Delete(root);
-        g_state = UPDATE_ERROR;
-        return true;
+        set_error("No version in response");
+        json_arena_release(root);
+        return;
     }
 
-    strncpy(g_info.version, tag_name->valuestring, sizeof(g_info.version) - 1);
-    printf("[UPDATE] Latest version: %s\n", g_info.version);
+    UpdateInfo info = {0};
+    strncpy(info.version, tag_name->valuestring, sizeof(info.version) - 1);
+    printf("[UPDATE] Latest version: %s\n", info.version);
 
     // Compare versions
-    if (compare_versions(g_info.version, VERSION) <= 0) {
+    if (compare_versions(info.version, VERSION) <= 0) {
         printf("[UPDATE] Already up to date\n");
-        cJSON_Delete(root);
+        json_arena_release(root);
+        pthread_mutex_lock(&g_mutex);
+        g_info = info;
         g_state = UPDATE_UP_TO_DATE;
-        return true;
+        pthread_mutex_unlock(&g_mutex);
+        return;
     }
 
     // Extract changelog (body)
     cJSON *body = cJSON_GetObjectItem(root, "body");
     if (body && cJSON_IsString(body)) {
-        strncpy(g_info.changelog, body->valuestring, sizeof(g_info.changelog) - 1);
+        strncpy(info.changelog, body->valuestring, sizeof(info.changelog) - 1);
     }
 
     // Find binary asset in assets array
     cJSON *assets = cJSON_GetObjectItem(root, "assets");
     if (!assets || !cJSON_IsArray(assets)) {
-        snprintf(g_error, sizeof(g_error), "No assets in release");
-        cJSON_Delete(root);
-        g_state = UPDATE_ERROR;
-        return true;
+        set_error("No assets in release");
+        json_arena_release(root);
+        return;
     }
 
     bool found_binary = false;
-    g_is_zip = false;
+    bool is_zip = false;
     int asset_count = cJSON_GetArraySize(assets);
 
     // First pass: look for zip release (v1.9.0+ format)
@@ -240,17 +379,8 @@ bool update_check_complete(void) {
         if (name && cJSON_IsString(name) &&
             (strcmp(name->valuestring, "mono-release.zip") == 0 ||
              strcmp(name->valuestring, "Mono.pak.zip") == 0)) {
-            cJSON *url = cJSON_GetObjectItem(asset, "browser_download_url");
-            cJSON *size_obj = cJSON_GetObjectItem(asset, "size");
-
-            if (url && cJSON_IsString(url)) {
-                strncpy(g_info.download_url, url->valuestring, sizeof(g_info.download_url) - 1);
-                found_binary = true;
-                g_is_zip = true;
-            }
-            if (size_obj && cJSON_IsNumber(size_obj)) {
-                g_info.size_bytes = (size_t)size_obj->valuedouble;
-            }
+            read_asset(asset, &info, &found_binary);
+            is_zip = found_binary;
             break;
         }
     }
@@ -262,185 +392,505 @@ bool update_check_complete(void) {
             cJSON *name = cJSON_GetObjectItem(asset, "name");
 
             if (name && cJSON_IsString(name) && strcmp(name->valuestring, "mono") == 0) {
-                cJSON *url = cJSON_GetObjectItem(asset, "browser_download_url");
-                cJSON *size_obj = cJSON_GetObjectItem(asset, "size");
-
-                if (url && cJSON_IsString(url)) {
-                    strncpy(g_info.download_url, url->valuestring, sizeof(g_info.download_url) - 1);
-                    found_binary = true;
-                    g_is_zip = false;
-                }
-                if (size_obj && cJSON_IsNumber(size_obj)) {
-                    g_info.size_bytes = (size_t)size_obj->valuedouble;
-                }
+                read_asset(asset, &info, &found_binary);
                 break;
             }
         }
     }
 
-    cJSON_Delete(root);
+    json_arena_release(root);
 
     if (!found_binary) {
-        snprintf(g_error, sizeof(g_error), "Binary not found in release");
-        g_state = UPDATE_ERROR;
-        return true;
+        set_error("Binary not found in release");
+        return;
     }
 
-    printf("[UPDATE] Update available: %s (%zu bytes)\n", g_info.version, g_info.size_bytes);
+    printf("[UPDATE] Update available: %s (%zu bytes)\n", info.version, info.size_bytes);
+    pthread_mutex_lock(&g_mutex);
+    g_info = info;
+    g_is_zip = is_zip;
     g_state = UPDATE_AVAILABLE;
-    return true;
+    pthread_mutex_unlock(&g_mutex);
 }
 
-void update_download(void) {
-    if (g_state != UPDATE_AVAILABLE) return;
-
-    g_state = UPDATE_DOWNLOADING;
-    g_progress = 0;
-    g_error[0] = '\0';
+/**
+ * Check job: look up the latest release
+ */
+static void run_check(void) {
+    char *json = fetch_release_json();
+    if (!json) return;
+    parse_release(json);
+    free(json);
+}
 
-    printf("[UPDATE] Starting download: %s\n", g_info.download_url);
+/**
+ * Read from the download, tracking progress
+ * @return Bytes read (short only at the end of the body or on shutdown)
+ */
+static size_t stream_read(Stream *s, void *buf, size_t size) {
+    size_t got = 0;
+    while (got < size) {
+        if (should_stop()) break;
+        size_t want = size - got;
+        if (want > STREAM_CHUNK) want = STREAM_CHUNK;
+        size_t n = http_read(s->call, (char *)buf + got, want);
+        if (n == 0) break;
+        got += n;
+        s->received += n;
+
+        if (s->total > 0) {
+            int pct = (int)((uint64_t)s->received * 100 / s->total);
+            if (pct > 100) pct = 100;
+            pthread_mutex_lock(&g_mutex);
+            g_progress = pct;
+            pthread_mutex_unlock(&g_mutex);
+        }
+    }
+    return got;
 }
 
-bool update_download_complete(void) {
-    if (g_state != UPDATE_DOWNLOADING) return true;
-
-    // Download with curl, showing progress
-    // Use -# for progress bar output, parse it for percentage
-    // Note: -k skips SSL verification (Trimui lacks updated CA certs)
-    const char *dl_path = g_is_zip ? TEMP_ZIP : TEMP_BINARY;
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd),
-        "curl -L -k -m 120 -A '%s' "
-        "--progress-bar "
-        "-o '%s' "
-        "'%s' 2>&1",
-        VERSION_USER_AGENT, dl_path, g_info.download_url);
-
-    FILE *pipe = popen(cmd, "r");
-    if (!pipe) {
-        snprintf(g_error, sizeof(g_error), "Failed to start download");
-        g_state = UPDATE_ERROR;
-        return true;
+/**
+ * Discard bytes from the download
+ * @return true if all of them arrived
+ */
+static bool stream_skip(Stream *s, size_t size) {
+    char buf[4096];
+    while (size > 0) {
+        size_t want = size < sizeof(buf) ? size : sizeof(buf);
+        if (stream_read(s, buf, want) != want) return false;
+        size -= want;
     }
+    return true;
+}
+
+static uint16_t rd16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
 
-    char line[256];
-    while (fgets(line, sizeof(line), pipe)) {
-        // Parse curl progress bar output: "###  15.0%"
-        char *pct = strstr(line, "%");
-        if (pct) {
-            char *start = pct - 1;
-            while (start > line && (*start == '.' || (*start >= '0' && *start <= '9'))) {
-                start--;
+/**
+ * CRC-32 (zip polynomial)
+ */
+static uint32_t crc32_calc(const unsigned char *data, size_t len) {
+    static uint32_t table[256];
+    static bool table_ready = false;
+
+    if (!table_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
             }
-            start++;
-            g_progress = (int)atof(start);
-            if (g_progress > 100) g_progress = 100;
+            table[i] = c;
         }
+        table_ready = true;
     }
 
-    int status = pclose(pipe);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+/**
+ * Zip entry names that hold the binary (flat v1.9.1+, nested v1.9.0)
+ */
+static bool is_binary_entry(const char *name) {
+    return strcmp(name, "bin/mono") == 0 || strcmp(name, "Mono.pak/bin/mono") == 0;
+}
+
+/**
+ * Walk the zip as it streams in and pull out the binary
+ * @param out Output: malloc'd binary
+ * @param out_len Output: binary size
+ * @return true if the entry was found, inflated and matched its CRC
+ */
+static bool extract_from_zip(Stream *s, unsigned char **out, size_t *out_len) {
+    unsigned char hdr[ZIP_LOCAL_HEADER_SIZE];
+
+    while (stream_read(s, hdr, sizeof(hdr)) == sizeof(hdr)) {
+        // Central directory reached: no more entries
+        if (rd32(hdr) != ZIP_LOCAL_SIG) break;
+
+        uint16_t flags = rd16(hdr + 6);
+        uint16_t method = rd16(hdr + 8);
+        uint32_t crc = rd32(hdr + 14);
+        uint32_t comp_size = rd32(hdr + 18);
+        uint32_t size = rd32(hdr + 22);
+        uint16_t name_len = rd16(hdr + 26);
+        uint16_t extra_len = rd16(hdr + 28);
+
+        char name[512];
+        if (name_len >= sizeof(name)) {
+            if (!stream_skip(s, name_len)) return false;
+            name[0] = '\0';
+        } else {
+            if (stream_read(s, name, name_len) != name_len) return false;
+            name[name_len] = '\0';
+        }
+        if (!stream_skip(s, extra_len)) return false;
+
+        bool sizes_known = !(flags & ZIP_FLAG_DATA_DESCRIPTOR);
+
+        if (!is_binary_entry(name)) {
+            // Sizes of a streamed (descriptor) entry aren't known up front
+            if (!sizes_known) {
+                set_error("Unsupported zip layout");
+                return false;
+            }
+            if (!stream_skip(s, comp_size)) return false;
+            continue;
+        }
+
+        if (method != ZIP_METHOD_STORED && method != ZIP_METHOD_DEFLATE) {
+            set_error("Unsupported zip compression (%u)", method);
+            return false;
+        }
+
+        // Compressed entry into memory (or everything left, if unsized)
+        size_t cap = sizes_known ? comp_size : 1024 * 1024;
+        if (cap == 0 || cap > MAX_BINARY_SIZE) {
+            set_error("Binary in zip has a bad size");
+            return false;
+        }
+        unsigned char *comp = malloc(cap);
+        size_t comp_len = 0;
+        while (comp) {
+            size_t n = stream_read(s, comp + comp_len, cap - comp_len);
+            comp_len += n;
+            if (sizes_known || comp_len < cap || cap >= MAX_BINARY_SIZE) break;
+            unsigned char *grown = realloc(comp, cap * 2);
+            if (!grown) {
+                free(comp);
+                comp = NULL;
+                break;
+            }
+            comp = grown;
+            cap *= 2;
+        }
+        if (!comp || (sizes_known && comp_len != comp_size)) {
+            free(comp);
+            set_error("Download incomplete");
+            return false;
+        }
+
+        unsigned char *data;
+        size_t data_len;
+        if (method == ZIP_METHOD_STORED) {
+            data = comp;
+            data_len = sizes_known ? comp_len : 0;
+        } else {
+            int inflated = 0;
+            data = (unsigned char *)stbi_zlib_decode_noheader_malloc(
+                (const char *)comp, (int)comp_len, &inflated);
+            data_len = inflated > 0 ? (size_t)inflated : 0;
+            free(comp);
+        }
+
+        if (!data || data_len == 0) {
+            free(data);
+            set_error("Failed to extract binary from zip");
+            return false;
+        }
+
+        // Descriptor entries carry their CRC after the data; the ELF check
+        // still guards against a bad extract
+        if (sizes_known && (data_len != size || crc32_calc(data, data_len) != crc)) {
+            free(data);
+            set_error("Binary in zip failed verification");
+            return false;
+        }
 
-    // Verify download
-    struct stat st;
-    if (stat(dl_path, &st) != 0) {
-        snprintf(g_error, sizeof(g_error), "Download failed - file not created");
-        g_state = UPDATE_ERROR;
+        printf("[UPDATE] Extracted %s (%zu bytes)\n", name, data_len);
+        *out = data;
+        *out_len = data_len;
         return true;
     }
 
-    // Verify size if we know it
-    if (g_info.size_bytes > 0 && (size_t)st.st_size != g_info.size_bytes) {
-        snprintf(g_error, sizeof(g_error), "Size mismatch: got %ld, expected %zu",
-                 (long)st.st_size, g_info.size_bytes);
-        unlink(dl_path);
-        g_state = UPDATE_ERROR;
-        return true;
+    if (!should_stop()) set_error("Binary not found in zip");
+    return false;
+}
+
+/**
+ * Whether a buffer starts like a Linux executable
+ */
+static bool looks_executable(const unsigned char *data, size_t len) {
+#ifdef __APPLE__
+    (void)data;
+    (void)len;
+    return true;
+#else
+    return len >= 4 && data[0] == 0x7F && data[1] == 'E' && data[2] == 'L' && data[3] == 'F';
+#endif
+}
+
+/**
+ * Write the new binary next to the old one (synced, executable)
+ */
+static bool write_binary(const char *path, const unsigned char *data, size_t len) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+    if (fd < 0) return false;
+
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += n;
     }
 
-    if (status != 0) {
-        snprintf(g_error, sizeof(g_error), "Download incomplete (curl error)");
-        unlink(dl_path);
-        g_state = UPDATE_ERROR;
-        return true;
+    bool ok = done == len && fsync(fd) == 0;
+    if (close(fd) != 0) ok = false;
+    if (ok) chmod(path, 0755);
+    if (!ok) unlink(path);
+    return ok;
+}
+
+/**
+ * Stream a bare binary asset straight to disk
+ */
+static bool download_bare(Stream *s, const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+    if (fd < 0) {
+        set_error("Cannot write %s", path);
+        return false;
     }
 
-    printf("[UPDATE] Download complete: %ld bytes\n", (long)st.st_size);
-    g_progress = 100;
+    unsigned char *buf = malloc(STREAM_CHUNK);
+    bool ok = buf != NULL;
+    bool first = true;
+    size_t n;
+    while (ok && (n = stream_read(s, buf, STREAM_CHUNK)) > 0) {
+        if (first && !looks_executable(buf, n)) {
+            set_error("Downloaded file is not a binary");
+            ok = false;
+            break;
+        }
+        first = false;
+        if (write(fd, buf, n) != (ssize_t)n) {
+            set_error("Write failed");
+            ok = false;
+        }
+    }
+    free(buf);
+
+    if (ok && first) {
+        set_error("Download failed - empty file");
+        ok = false;
+    }
+    if (ok && fsync(fd) != 0) ok = false;
+    close(fd);
+
+    if (ok) chmod(path, 0755);
+    if (!ok) unlink(path);
+    return ok;
+}
 
-    // Extract binary from zip if needed
-    if (g_is_zip) {
-        printf("[UPDATE] Extracting binary from zip...\n");
+/**
+ * Download job: fetch, verify and apply the release asset
+ */
+static void run_download(void) {
+    pthread_mutex_lock(&g_mutex);
+    UpdateInfo info = g_info;
+    bool is_zip = g_is_zip;
+    pthread_mutex_unlock(&g_mutex);
+
+    char new_path[520];
+    snprintf(new_path, sizeof(new_path), "%s%s", get_binary_path(), NEW_SUFFIX);
+
+    // Note: insecure skips SSL verification (Trimui lacks updated CA certs)
+    HttpRequest req = {
+        .url = info.download_url,
+        .user_agent = VERSION_USER_AGENT,
+        .timeout_sec = DOWNLOAD_TIMEOUT,
+        .insecure = true,
+    };
+    HttpResponse resp;
+    HttpCall *call = NULL;
+
+    if (!http_open(&req, &call, &resp)) {
+        set_error("Failed to start download");
+        return;
+    }
+    if (resp.status != 200) {
+        http_close(call, true);
+        set_error("Download failed (HTTP %d)", resp.status);
+        return;
+    }
 
-        // Clean up and create extraction dir
-        snprintf(cmd, sizeof(cmd), "rm -rf '%s' && mkdir -p '%s'", TEMP_EXTRACT_DIR, TEMP_EXTRACT_DIR);
-        system(cmd);
+    pthread_mutex_lock(&g_mutex);
+    g_active_call = call;
+    pthread_mutex_unlock(&g_mutex);
 
-        // Try flat structure first (v1.9.1+: bin/mono at root of zip)
-        snprintf(cmd, sizeof(cmd), "unzip -o '%s' 'bin/mono' -d '%s' 2>/dev/null", TEMP_ZIP, TEMP_EXTRACT_DIR);
-        int extract_ret = system(cmd);
+    Stream s = { .call = call, .received = 0, .total = info.size_bytes };
+    bool ok;
 
-        if (extract_ret != 0) {
-            // Try nested structure (v1.9.0: Mono.pak/bin/mono)
-            snprintf(cmd, sizeof(cmd), "unzip -o '%s' 'Mono.pak/bin/mono' -d '%s' 2>/dev/null", TEMP_ZIP, TEMP_EXTRACT_DIR);
-            extract_ret = system(cmd);
+    if (is_zip) {
+        unsigned char *data = NULL;
+        size_t len = 0;
+        ok = extract_from_zip(&s, &data, &len);
+        if (ok && !looks_executable(data, len)) {
+            set_error("Extracted file is not a binary");
+            ok = false;
         }
-
-        if (extract_ret != 0) {
-            snprintf(g_error, sizeof(g_error), "Failed to extract binary from zip");
-            unlink(TEMP_ZIP);
-            snprintf(cmd, sizeof(cmd), "rm -rf '%s'", TEMP_EXTRACT_DIR);
-            system(cmd);
-            g_state = UPDATE_ERROR;
-            return true;
+        if (ok && !write_binary(new_path, data, len)) {
+            set_error("Cannot write %s", new_path);
+            ok = false;
         }
+        free(data);
+    } else {
+        ok = download_bare(&s, new_path);
+    }
+
+    pthread_mutex_lock(&g_mutex);
+    g_active_call = NULL;
+    pthread_mutex_unlock(&g_mutex);
 
-        // Find and move the extracted binary to TEMP_BINARY
-        // Try flat path first, then nested
-        bool extracted = false;
-        char extract_path[512];
+    // The zip's central directory isn't needed, so stop the transfer there
+    bool transferred = http_close(call, is_zip);
 
-        snprintf(extract_path, sizeof(extract_path), "%s/bin/mono", TEMP_EXTRACT_DIR);
-        if (stat(extract_path, &st) == 0) {
-            extracted = true;
+    if (ok && !is_zip) {
+        if (!transferred) {
+            set_error("Download incomplete (curl error)");
+            ok = false;
+        } else if (info.size_bytes > 0 && s.received != info.size_bytes) {
+            set_error("Size mismatch: got %zu, expected %zu", s.received, info.size_bytes);
+            ok = false;
         }
+        if (!ok) unlink(new_path);
+    }
 
-        if (!extracted) {
-            snprintf(extract_path, sizeof(extract_path), "%s/Mono.pak/bin/mono", TEMP_EXTRACT_DIR);
-            if (stat(extract_path, &st) == 0) {
-                extracted = true;
-            }
+    if (!ok) {
+        if (should_stop()) unlink(new_path);
+        return;
+    }
+
+    printf("[UPDATE] Download complete: %zu bytes\n", s.received);
+    pthread_mutex_lock(&g_mutex);
+    g_progress = 100;
+    pthread_mutex_unlock(&g_mutex);
+
+    // Apply the update immediately
+    update_apply();
+}
+
+/**
+ * Worker: runs one check or download at a time
+ */
+static void* update_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_mutex);
+    while (!g_shutdown) {
+        if (g_job == JOB_NONE) {
+            pthread_cond_wait(&g_cond, &g_mutex);
+            continue;
         }
 
-        if (!extracted) {
-            snprintf(g_error, sizeof(g_error), "Binary not found in extracted zip");
-            unlink(TEMP_ZIP);
-            snprintf(cmd, sizeof(cmd), "rm -rf '%s'", TEMP_EXTRACT_DIR);
-            system(cmd);
-            g_state = UPDATE_ERROR;
-            return true;
+        UpdateJob job = g_job;
+        g_job = JOB_NONE;
+        pthread_mutex_unlock(&g_mutex);
+
+        if (job == JOB_CHECK) {
+            run_check();
+        } else {
+            run_download();
         }
 
-        snprintf(cmd, sizeof(cmd), "mv '%s' '%s'", extract_path, TEMP_BINARY);
-        if (system(cmd) != 0) {
-            snprintf(g_error, sizeof(g_error), "Failed to move extracted binary");
-            unlink(TEMP_ZIP);
-            snprintf(cmd, sizeof(cmd), "rm -rf '%s'", TEMP_EXTRACT_DIR);
-            system(cmd);
+        pthread_mutex_lock(&g_mutex);
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return NULL;
+}
+
+/**
+ * Hand a job to the worker
+ */
+static void queue_job(UpdateJob job) {
+    g_job = job;
+    if (!g_thread_running) {
+        g_shutdown = false;
+        if (pthread_create(&g_thread, NULL, update_thread, NULL) == 0) {
+            g_thread_running = true;
+        } else {
+            snprintf(g_error, sizeof(g_error), "Failed to start updater");
             g_state = UPDATE_ERROR;
-            return true;
+            g_job = JOB_NONE;
+            return;
         }
+    }
+    pthread_cond_signal(&g_cond);
+}
+
+void update_init(void) {
+    g_state = UPDATE_IDLE;
+    memset(&g_info, 0, sizeof(g_info));
+    g_error[0] = '\0';
+    g_progress = 0;
+
+    // Initialize binary path
+    get_binary_path();
+}
+
+void update_cleanup(void) {
+    if (!g_thread_running) return;
 
-        // Clean up zip and extract dir
-        unlink(TEMP_ZIP);
-        snprintf(cmd, sizeof(cmd), "rm -rf '%s'", TEMP_EXTRACT_DIR);
-        system(cmd);
+    pthread_mutex_lock(&g_mutex);
+    g_shutdown = true;
+    if (g_active_call) http_cancel(g_active_call);
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
 
-        printf("[UPDATE] Binary extracted successfully\n");
+    pthread_join(g_thread, NULL);
+    g_thread_running = false;
+}
+
+void update_check(void) {
+    pthread_mutex_lock(&g_mutex);
+    if (JOB_BUSY()) {
+        pthread_mutex_unlock(&g_mutex);
+        return;
     }
 
-    // Apply the update immediately
-    update_apply();
-    return true;
+    g_state = UPDATE_CHECKING;
+    g_error[0] = '\0';
+    memset(&g_info, 0, sizeof(g_info));
+
+    printf("[UPDATE] Checking for updates...\n");
+    printf("[UPDATE] Current version: %s\n", VERSION);
+
+    queue_job(JOB_CHECK);
+    pthread_mutex_unlock(&g_mutex);
+}
+
+bool update_check_complete(void) {
+    return update_get_state() != UPDATE_CHECKING;
+}
+
+void update_download(void) {
+    pthread_mutex_lock(&g_mutex);
+    if (g_state != UPDATE_AVAILABLE || JOB_BUSY()) {
+        pthread_mutex_unlock(&g_mutex);
+        return;
+    }
+
+    g_state = UPDATE_DOWNLOADING;
+    g_progress = 0;
+    g_error[0] = '\0';
+
+    printf("[UPDATE] Starting download: %s\n", g_info.download_url);
+
+    queue_job(JOB_DOWNLOAD);
+    pthread_mutex_unlock(&g_mutex);
+}
+
+bool update_download_complete(void) {
+    return update_get_state() != UPDATE_DOWNLOADING;
 }
 
 void update_apply(void) {
@@ -449,46 +899,41 @@ void update_apply(void) {
     printf("[UPDATE] Applying update...\n");
     printf("[UPDATE] Target: %s\n", binary);
 
-    // Create backup
+    char new_path[520];
     char backup_path[520];
+    snprintf(new_path, sizeof(new_path), "%s%s", binary, NEW_SUFFIX);
     snprintf(backup_path, sizeof(backup_path), "%s%s", binary, BACKUP_SUFFIX);
 
     // Remove old backup if exists
     unlink(backup_path);
 
-    // Backup current binary
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd), "cp '%s' '%s' 2>/dev/null", binary, backup_path);
-    if (system(cmd) != 0) {
+    // Backup current binary (the running process keeps its open inode)
+    bool backed_up = rename(binary, backup_path) == 0;
+    if (backed_up) {
+        printf("[UPDATE] Backup created: %s\n", backup_path);
+    } else {
         // Backup failed, but continue anyway (new install case)
         printf("[UPDATE] Backup failed (may be new install)\n");
-    } else {
-        printf("[UPDATE] Backup created: %s\n", backup_path);
     }
 
     // Replace binary
-    snprintf(cmd, sizeof(cmd), "mv '%s' '%s'", TEMP_BINARY, binary);
-    if (system(cmd) != 0) {
-        snprintf(g_error, sizeof(g_error), "Failed to replace binary");
+    if (rename(new_path, binary) != 0) {
+        set_error("Failed to replace binary");
         // Try to restore backup
-        snprintf(cmd, sizeof(cmd), "mv '%s' '%s' 2>/dev/null", backup_path, binary);
-        system(cmd);
-        g_state = UPDATE_ERROR;
+        if (backed_up) rename(backup_path, binary);
+        unlink(new_path);
         return;
     }
 
-    // Make executable
-    snprintf(cmd, sizeof(cmd), "chmod +x '%s'", binary);
-    if (system(cmd) != 0) {
-        printf("[UPDATE] Warning: chmod failed\n");
-    }
-
     printf("[UPDATE] Update applied successfully!\n");
-    g_state = UPDATE_READY;
+    set_state(UPDATE_READY);
 }
 
 UpdateState update_get_state(void) {
-    return g_state;
+    pthread_mutex_lock(&g_mutex);
+    UpdateState state = g_state;
+    pthread_mutex_unlock(&g_mutex);
+    return state;
 }
 
 const UpdateInfo* update_get_info(void) {
@@ -500,13 +945,20 @@ const char* update_get_error(void) {
 }
 
 int update_get_progress(void) {
-    return g_progress;
+    pthread_mutex_lock(&g_mutex);
+    int progress = g_progress;
+    pthread_mutex_unlock(&g_mutex);
+    return progress;
 }
 
 void update_reset(void) {
-    g_state = UPDATE_IDLE;
-    g_error[0] = '\0';
-    g_progress = 0;
-    g_is_zip = false;
-    memset(&g_info, 0, sizeof(g_info));
+    pthread_mutex_lock(&g_mutex);
+    if (!JOB_BUSY()) {
+        g_state = UPDATE_IDLE;
+        g_error[0] = '\0';
+        g_progress = 0;
+        g_is_zip = false;
+        memset(&g_info, 0, sizeof(g_info));
+    }
+    pthread_mutex_unlock(&g_mutex);
 }
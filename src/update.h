@@ -3,6 +3,7 @@
  *
  * Provides ability to check for updates from GitHub releases,
  * download new binary, and apply update on next restart.
+ * Checks and downloads run on a background thread; the UI polls.
  */
 
 #ifndef UPDATE_H
@@ -41,36 +42,39 @@ void update_init(void);
 
 /**
  * Cleanup update resources
+ * Stops the worker (an unfinished download is discarded)
  */
 void update_cleanup(void);
 
 /**
  * Start async check for updates via GitHub API
- * Sets state to UPDATE_CHECKING, then UPDATE_AVAILABLE or UPDATE_UP_TO_DATE
+ * Sets state to UPDATE_CHECKING, then UPDATE_AVAILABLE or UPDATE_UP_TO_DATE.
+ * The release response is cached and revalidated with its ETag.
  */
 void update_check(void);
 
 /**
- * Update the check (call each frame while UPDATE_CHECKING)
+ * Poll the check (non-blocking)
  * @return true when check is complete (success or error)
  */
 bool update_check_complete(void);
 
 /**
- * Start downloading the update binary
- * Sets state to UPDATE_DOWNLOADING
+ * Start downloading the update binary in the background
+ * Sets state to UPDATE_DOWNLOADING, then UPDATE_READY (applied) or
+ * UPDATE_ERROR. Zip releases are extracted while streaming.
  */
 void update_download(void);
 
 /**
- * Update the download (call each frame while UPDATE_DOWNLOADING)
+ * Poll the download (non-blocking)
  * @return true when download is complete (success or error)
  */
 bool update_download_complete(void);
 
 /**
  * Apply the downloaded update
- * Backs up current binary, replaces with new, sets executable
+ * Renames the current binary to .bak and the verified .new into place
  * Sets state to UPDATE_READY on success, UPDATE_ERROR on failure
  */
 void update_apply(void);
@@ -0,0 +1,163 @@
+/**
+ * Cache Warmup Implementation
+ *
+ * Replaces the old startup loop that read whole files on the main thread.
+ * Each file gets a few WILLNEED hints: the head, the tail, and a window
+ * around the resume point (placed with the MP3 seek table when there is
+ * one, else proportionally from the duration). The kernel reads those
+ * ranges asynchronously; the job never copies file data. It runs in the
+ * pool's background class, so it never takes the worker kept for audio.
+ */
+
+#include "warmup.h"
+#include "positions.h"
+#include "tags.h"
+#include "jobs.h"
+#include "iosched.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * File to warm, copied from the positions list
+ */
+typedef struct {
+    char path[512];
+    int position_sec;
+} WarmupEntry;
+
+static WarmupEntry g_entries[WARMUP_MAX_FILES];
+static int g_entry_count = 0;
+
+static JobId g_job = 0;
+
+/**
+ * Ask the kernel to read a byte range ahead
+ */
+static void hint_range(int fd, off_t offset, off_t len, off_t file_size) {
+    if (offset < 0) offset = 0;
+    if (offset >= file_size) return;
+    if (offset + len > file_size) len = file_size - offset;
+    if (len <= 0) return;
+
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd, offset, len, POSIX_FADV_WILLNEED);
+#else
+    // No fadvise (macOS): let the kernel read ahead on its own
+    (void)fd;
+#endif
+}
+
+/**
+ * Byte offset of a resume position
+ * @return Offset, or -1 if the duration is unknown
+ */
+static off_t resume_offset(const char *path, int position_sec, off_t file_size) {
+    TrackInfo info;
+    Mp3Toc toc;
+    memset(&info, 0, sizeof(info));
+    memset(&toc, 0, sizeof(toc));
+    tags_probe_toc(path, &info, &toc);
+
+    if (toc.valid) {
+        long offset = tags_toc_offset(&toc, position_sec);
+        if (offset >= 0) return (off_t)offset;
+    }
+    if (info.duration_sec > 0) {
+        return (off_t)((double)file_size * position_sec / info.duration_sec);
+    }
+    return -1;
+}
+
+/**
+ * Hint the ranges of one file that a resume will read
+ */
+static void warm_file(const WarmupEntry *entry) {
+    int fd = open(entry->path, O_RDONLY);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return;
+    }
+    off_t size = st.st_size;
+
+    hint_range(fd, 0, WARMUP_HEAD_BYTES, size);
+    hint_range(fd, size - WARMUP_TAIL_BYTES, WARMUP_TAIL_BYTES, size);
+
+    off_t offset = entry->position_sec > 0 ? resume_offset(entry->path, entry->position_sec, size) : 0;
+    if (offset > 0) {
+        hint_range(fd, offset - WARMUP_BEFORE_BYTES,
+                   WARMUP_BEFORE_BYTES + WARMUP_AFTER_BYTES, size);
+    }
+
+    close(fd);
+}
+
+/**
+ * Warmup job: hints each entry in priority order
+ */
+static void warmup_job(void *arg, const volatile bool *cancel) {
+    (void)arg;
+
+    int warmed = 0;
+    for (int i = 0; i < g_entry_count && !*cancel; i++) {
+        // The hints start real reads, so they count against the bulk budget
+        if (!iosched_gate(WARMUP_HEAD_BYTES + WARMUP_TAIL_BYTES + WARMUP_BEFORE_BYTES +
+                          WARMUP_AFTER_BYTES, cancel)) break;
+        warm_file(&g_entries[i]);
+        warmed++;
+    }
+
+    printf("[WARMUP] Hinted %d of %d files\n", warmed, g_entry_count);
+}
+
+/**
+ * Append an entry unless it is already listed
+ */
+static void add_entry(const char *path, int position_sec) {
+    if (g_entry_count >= WARMUP_MAX_FILES || !path || !path[0]) return;
+    for (int i = 0; i < g_entry_count; i++) {
+        if (strcmp(g_entries[i].path, path) == 0) return;
+    }
+
+    WarmupEntry *e = &g_entries[g_entry_count++];
+    strncpy(e->path, path, sizeof(e->path) - 1);
+    e->path[sizeof(e->path) - 1] = '\0';
+    e->position_sec = position_sec;
+}
+
+void warmup_start(const char *priority_path) {
+    if (g_job) return;
+
+    // Copy the list here: positions.c is main-thread only
+    g_entry_count = 0;
+    if (priority_path && priority_path[0]) {
+        add_entry(priority_path, positions_get(priority_path));
+    }
+
+    // Newest entries first (the list is kept oldest first)
+    char path[512];
+    for (int i = positions_get_count() - 1; i >= 0 && g_entry_count < WARMUP_MAX_FILES; i--) {
+        int pos = positions_get_entry(i, path, sizeof(path));
+        if (pos >= 0) add_entry(path, pos);
+    }
+
+    if (g_entry_count == 0) return;
+
+    // The entry table is only written before the job is queued
+    g_job = jobs_submit(JOB_CLASS_BACKGROUND, "warmup", warmup_job, NULL, NULL);
+    if (g_job == 0) return;
+    printf("[WARMUP] Warming %d files in the background\n", g_entry_count);
+}
+
+void warmup_cleanup(void) {
+    // jobs_shutdown() waits for the job if it is still hinting
+    jobs_cancel(g_job);
+    g_job = 0;
+}
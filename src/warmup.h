@@ -0,0 +1,35 @@
+/**
+ * Cache Warmup - Background page-cache hints for resumable tracks
+ *
+ * At startup, files with saved positions are hinted to the kernel
+ * (posix_fadvise WILLNEED) by a background-class job so the first seek
+ * into them doesn't stall on the SD card. Only the file head and the
+ * region around the resume point are requested, and nothing is copied.
+ */
+
+#ifndef WARMUP_H
+#define WARMUP_H
+
+// Most recent resume entries hinted at startup
+#define WARMUP_MAX_FILES 10
+
+// Byte ranges hinted per file
+#define WARMUP_HEAD_BYTES (256 * 1024)         // Headers, seek tables
+#define WARMUP_TAIL_BYTES (64 * 1024)          // ID3v1/APE tags
+#define WARMUP_BEFORE_BYTES (128 * 1024)       // Ahead of the resume point
+#define WARMUP_AFTER_BYTES (2 * 1024 * 1024)   // After it (first seconds played)
+
+/**
+ * Start warming in the background (returns immediately)
+ * Needs positions_init() and jobs_init(). The entry list is copied on the
+ * calling thread.
+ * @param priority_path Last played file, hinted first (can be NULL)
+ */
+void warmup_start(const char *priority_path);
+
+/**
+ * Cancel the warmup job if it is still running
+ */
+void warmup_cleanup(void);
+
+#endif // WARMUP_H
@@ -0,0 +1,187 @@
+/**
+ * WAV Images Implementation
+ *
+ * Each pooled buffer carries a small hidden prefix recording its capacity,
+ * so a released buffer can be handed back for any image that fits. Two
+ * slots cover the steady state of gapless playback: the playing track's
+ * image is released just as the next preload needs one.
+ */
+
+#include "wav.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dr_flac.h"
+
+#define WAV_POOL_SLOTS 2
+#define WAV_PREFIX_SIZE 16   // Hidden capacity prefix (keeps PCM 4-byte aligned)
+
+static uint8_t *g_pool[WAV_POOL_SLOTS] = {NULL};
+static pthread_mutex_t g_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Write little-endian integers (WAV is LE regardless of host)
+ */
+static void put_le16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get_le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * Capacity stored in a pooled buffer's prefix
+ */
+static size_t pool_capacity(const uint8_t *wav) {
+    size_t capacity;
+    memcpy(&capacity, wav - WAV_PREFIX_SIZE, sizeof(capacity));
+    return capacity;
+}
+
+void wav_write_header(uint8_t *dst, int sample_rate, int channels, size_t pcm_size) {
+    uint16_t block_align = (uint16_t)(channels * sizeof(int16_t));
+
+    memcpy(dst + 0, "RIFF", 4);
+    put_le32(dst + 4, (uint32_t)(36 + pcm_size));
+    memcpy(dst + 8, "WAVE", 4);
+    memcpy(dst + 12, "fmt ", 4);
+    put_le32(dst + 16, 16);                       // fmt chunk size
+    put_le16(dst + 20, 1);                        // PCM
+    put_le16(dst + 22, (uint16_t)channels);
+    put_le32(dst + 24, (uint32_t)sample_rate);
+    put_le32(dst + 28, (uint32_t)sample_rate * block_align);
+    put_le16(dst + 32, block_align);
+    put_le16(dst + 34, 16);                       // Bits per sample
+    memcpy(dst + 36, "data", 4);
+    put_le32(dst + 40, (uint32_t)pcm_size);
+}
+
+bool wav_read_header(const uint8_t *wav, size_t wav_size, int *sample_rate, int *channels) {
+    if (!wav || wav_size <= WAV_HEADER_SIZE) return false;
+    if (memcmp(wav, "RIFF", 4) != 0 || memcmp(wav + 8, "WAVE", 4) != 0) return false;
+    if (get_le16(wav + 20) != 1 || get_le16(wav + 34) != 16) return false;
+
+    int ch = get_le16(wav + 22);
+    int rate = (int)get_le32(wav + 24);
+    if (ch == 0 || rate == 0) return false;
+
+    *sample_rate = rate;
+    *channels = ch;
+    return true;
+}
+
+uint8_t* wav_alloc(size_t pcm_size) {
+    size_t need = WAV_HEADER_SIZE + pcm_size;
+
+    // Best fit from the pool
+    pthread_mutex_lock(&g_pool_mutex);
+    int best = -1;
+    for (int i = 0; i < WAV_POOL_SLOTS; i++) {
+        if (g_pool[i] && pool_capacity(g_pool[i]) >= need &&
+            (best < 0 || pool_capacity(g_pool[i]) < pool_capacity(g_pool[best]))) {
+            best = i;
+        }
+    }
+    uint8_t *wav = NULL;
+    if (best >= 0) {
+        wav = g_pool[best];
+        g_pool[best] = NULL;
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    if (wav) return wav;
+
+    uint8_t *block = malloc(WAV_PREFIX_SIZE + need);
+    if (!block) {
+        fprintf(stderr, "[WAV] Failed to allocate %zu bytes\n", need);
+        return NULL;
+    }
+    memcpy(block, &need, sizeof(need));
+    return block + WAV_PREFIX_SIZE;
+}
+
+void wav_release(uint8_t *wav) {
+    if (!wav) return;
+
+    // Keep it in an empty slot, or in place of a smaller one
+    pthread_mutex_lock(&g_pool_mutex);
+    int slot = -1;
+    for (int i = 0; i < WAV_POOL_SLOTS; i++) {
+        if (!g_pool[i]) {
+            slot = i;
+            break;
+        }
+        if (pool_capacity(g_pool[i]) < pool_capacity(wav) &&
+            (slot < 0 || pool_capacity(g_pool[i]) < pool_capacity(g_pool[slot]))) {
+            slot = i;
+        }
+    }
+    uint8_t *evicted = wav;
+    if (slot >= 0) {
+        evicted = g_pool[slot];
+        g_pool[slot] = wav;
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+
+    if (evicted) free(evicted - WAV_PREFIX_SIZE);
+}
+
+uint8_t* wav_decode_flac(void *flac, uint64_t max_frames, size_t *out_size, uint64_t *out_frames) {
+    drflac *pFlac = (drflac *)flac;
+    size_t frame_bytes = pFlac->channels * sizeof(int16_t);
+
+    uint8_t *wav = wav_alloc((size_t)max_frames * frame_bytes);
+    if (!wav) return NULL;
+
+    // Decode in place behind the header, then describe what we got
+    uint64_t frames = drflac_read_pcm_frames_s16(pFlac, max_frames,
+                                                 (drflac_int16 *)(wav + WAV_HEADER_SIZE));
+    if (frames == 0) {
+        wav_release(wav);
+        return NULL;
+    }
+
+    size_t pcm_size = (size_t)frames * frame_bytes;
+    wav_write_header(wav, (int)pFlac->sampleRate, (int)pFlac->channels, pcm_size);
+
+    *out_size = WAV_HEADER_SIZE + pcm_size;
+    *out_frames = frames;
+    return wav;
+}
+
+void wav_pool_cleanup(void) {
+    pthread_mutex_lock(&g_pool_mutex);
+    for (int i = 0; i < WAV_POOL_SLOTS; i++) {
+        if (g_pool[i]) {
+            free(g_pool[i] - WAV_PREFIX_SIZE);
+            g_pool[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+}
+
+size_t wav_pool_bytes(void) {
+    size_t total = 0;
+    pthread_mutex_lock(&g_pool_mutex);
+    for (int i = 0; i < WAV_POOL_SLOTS; i++) {
+        if (g_pool[i]) total += WAV_PREFIX_SIZE + pool_capacity(g_pool[i]);
+    }
+    pthread_mutex_unlock(&g_pool_mutex);
+    return total;
+}
@@ -0,0 +1,75 @@
+/**
+ * WAV Images - In-memory 16-bit PCM WAV buffers
+ *
+ * Shared by the preloader (decoded FLAC), the FLAC player (resident PCM)
+ * and the Spotify pipe reader (SDL_mixer chunks). FLAC images are decoded
+ * in a single pass straight behind the header, into buffers recycled
+ * through a small pool so track changes don't re-grow the heap.
+ */
+
+#ifndef WAV_H
+#define WAV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// Canonical PCM header: RIFF + fmt (16 bytes) + data chunk
+#define WAV_HEADER_SIZE 44
+
+/**
+ * Write a 16-bit PCM WAV header
+ * @param dst Destination (at least WAV_HEADER_SIZE bytes)
+ * @param sample_rate Sample rate in Hz
+ * @param channels Number of channels
+ * @param pcm_size Size of the PCM payload following the header
+ */
+void wav_write_header(uint8_t *dst, int sample_rate, int channels, size_t pcm_size);
+
+/**
+ * Parse a header written by wav_write_header()
+ * @param wav WAV image
+ * @param wav_size Size of the image
+ * @param sample_rate Output: sample rate in Hz
+ * @param channels Output: number of channels
+ * @return true if the image is a non-empty 16-bit PCM WAV
+ */
+bool wav_read_header(const uint8_t *wav, size_t wav_size, int *sample_rate, int *channels);
+
+/**
+ * Get a buffer for a WAV image from the pool (header space included)
+ * Must be returned with wav_release(), never free().
+ * @param pcm_size PCM payload size
+ * @return Buffer of WAV_HEADER_SIZE + pcm_size bytes, or NULL
+ */
+uint8_t* wav_alloc(size_t pcm_size);
+
+/**
+ * Return a buffer from wav_alloc() to the pool (NULL is ignored)
+ * @param wav Buffer to release
+ */
+void wav_release(uint8_t *wav);
+
+/**
+ * Decode frames from an open drflac straight into a pooled WAV image
+ * The header is written for the frames actually decoded.
+ * @param flac Open drflac handle (drflac *), left positioned after the decoded frames
+ * @param max_frames Maximum PCM frames to decode
+ * @param out_size Output: WAV image size
+ * @param out_frames Output: PCM frames decoded
+ * @return WAV image (release with wav_release), or NULL on failure/no audio
+ */
+uint8_t* wav_decode_flac(void *flac, uint64_t max_frames, size_t *out_size, uint64_t *out_frames);
+
+/**
+ * Free pooled buffers (at shutdown, or to give memory back under pressure)
+ */
+void wav_pool_cleanup(void);
+
+/**
+ * Bytes held by idle pooled buffers
+ * @return Total capacity of the pool
+ */
+size_t wav_pool_bytes(void);
+
+#endif // WAV_H
@@ -7,11 +7,17 @@
 
 #include "youtube.h"
 #include "cJSON.h"
+#include "jsonarena.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <signal.h>
+#include <pthread.h>
 #include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
 
 // Paths for yt-dlp binary (in order of preference)
 #define YTDLP_BUNDLED_REL "./bin/yt-dlp"           // When running from Mono.pak/
@@ -22,6 +28,10 @@
 #define TEMP_SEARCH_FILE "/tmp/mono_yt_search.json"
 #define DEFAULT_DOWNLOAD_DIR "/mnt/SDCARD/Music/YouTube"
 
+// ffmpeg for queue transcodes (bundled next to yt-dlp, as --ffmpeg-location)
+#define FFMPEG_BUNDLED_REL "./bin/ffmpeg"
+#define FFMPEG_SYSTEM      "ffmpeg"
+
 // Current state
 static bool g_available = false;
 static char g_ytdlp_path[256] = {0};
@@ -29,6 +39,10 @@ static char g_download_dir[256] = DEFAULT_DOWNLOAD_DIR;
 static char g_download_file[512] = {0};
 static char g_error[256] = {0};
 
+// Running search process (so another thread can cancel it)
+static pthread_mutex_t g_search_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pid_t g_search_pid = 0;
+
 /**
  * Sanitize filename - remove invalid characters
  */
@@ -51,29 +65,6 @@ static void sanitize_filename(const char *src, char *dst, size_t dst_size) {
     }
 }
 
-/**
- * URL encode a string for use in search query
- */
-static void url_encode(const char *src, char *dst, size_t dst_size) {
-    static const char *hex = "0123456789ABCDEF";
-    size_t j = 0;
-
-    for (size_t i = 0; src[i] && j < dst_size - 4; i++) {
-        unsigned char c = (unsigned char)src[i];
-        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
-            (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' || c == '~') {
-            dst[j++] = c;
-        } else if (c == ' ') {
-            dst[j++] = '+';
-        } else {
-            dst[j++] = '%';
-            dst[j++] = hex[c >> 4];
-            dst[j++] = hex[c & 0x0F];
-        }
-    }
-    dst[j] = '\0';
-}
-
 /**
  * Check if a file exists and is executable
  */
@@ -137,8 +128,87 @@ bool youtube_is_available(void) {
     return g_available;
 }
 
-int youtube_search(const char *query, YouTubeResult *results, int max_results) {
-    if (!g_available || !query || !results || max_results <= 0) {
+/**
+ * Parse one line of yt-dlp --dump-json output
+ * @return true if the line held a usable result
+ */
+static bool parse_search_line(const char *line, YouTubeResult *r) {
+    cJSON *json = json_arena_parse(line);
+    if (!json) return false;
+
+    // Extract fields
+    cJSON *id = cJSON_GetObjectItem(json, "id");
+    cJSON *title = cJSON_GetObjectItem(json, "title");
+    cJSON *channel = cJSON_GetObjectItem(json, "channel");
+    cJSON *uploader = cJSON_GetObjectItem(json, "uploader");  // Fallback
+    cJSON *duration = cJSON_GetObjectItem(json, "duration");
+
+    bool ok = false;
+    if (id && id->valuestring && title && title->valuestring) {
+        memset(r, 0, sizeof(YouTubeResult));
+
+        strncpy(r->id, id->valuestring, sizeof(r->id) - 1);
+        strncpy(r->title, title->valuestring, sizeof(r->title) - 1);
+
+        // Channel name (try channel first, then uploader)
+        if (channel && channel->valuestring) {
+            strncpy(r->channel, channel->valuestring, sizeof(r->channel) - 1);
+        } else if (uploader && uploader->valuestring) {
+            strncpy(r->channel, uploader->valuestring, sizeof(r->channel) - 1);
+        }
+
+        // Duration (may be null for live streams)
+        if (duration && cJSON_IsNumber(duration)) {
+            r->duration_sec = (int)duration->valuedouble;
+        }
+        ok = true;
+    }
+
+    json_arena_release(json);
+    return ok;
+}
+
+/**
+ * Start a shell command with its stdout on a pipe
+ * The command runs in its own process group so it can be killed whole.
+ * @return Read end of the pipe, or NULL on failure
+ */
+static FILE* spawn_reader(const char *cmd, pid_t *out_pid) {
+    int fds[2];
+    if (pipe(fds) != 0) return NULL;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return NULL;
+    }
+
+    if (pid == 0) {
+        setpgid(0, 0);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+
+    setpgid(pid, pid);  // Also from the parent, so a kill can't race the child
+    close(fds[1]);
+    FILE *f = fdopen(fds[0], "r");
+    if (!f) {
+        close(fds[0]);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        return NULL;
+    }
+    *out_pid = pid;
+    return f;
+}
+
+int youtube_search_stream(const char *query, int max_results,
+                          YouTubeResultCallback on_result, void *ctx) {
+    if (!g_available || !query || !on_result || max_results <= 0) {
         snprintf(g_error, sizeof(g_error), "Invalid parameters");
         return -1;
     }
@@ -149,81 +219,75 @@ int youtube_search(const char *query, YouTubeResult *results, int max_results) {
 
     g_error[0] = '\0';
 
-    // URL encode the query
-    char encoded_query[512];
-    url_encode(query, encoded_query, sizeof(encoded_query));
-
     // Build yt-dlp search command
     // Use --flat-playlist to get results fast without downloading
-    // ytsearch10: searches YouTube and returns 10 results
+    // --dump-json prints one JSON object per line as each result resolves
+    // exec: the shell becomes yt-dlp, so cancelling signals it directly
     char cmd[1024];
     snprintf(cmd, sizeof(cmd),
-        "%s --flat-playlist --dump-json 'ytsearch%d:%s' > %s 2>/dev/null",
-        g_ytdlp_path, max_results, query, TEMP_SEARCH_FILE);
+        "exec %s --flat-playlist --dump-json 'ytsearch%d:%s' 2>/dev/null",
+        g_ytdlp_path, max_results, query);
 
     printf("[YOUTUBE] Searching: %s\n", query);
-    int ret = system(cmd);
 
-    if (ret != 0) {
-        snprintf(g_error, sizeof(g_error), "Search failed (network error?)");
-        fprintf(stderr, "[YOUTUBE] Search command failed with code %d\n", ret);
-        unlink(TEMP_SEARCH_FILE);
-        return -1;
-    }
-
-    // Read and parse JSON output (one JSON object per line)
-    FILE *f = fopen(TEMP_SEARCH_FILE, "r");
+    pid_t pid = 0;
+    FILE *f = spawn_reader(cmd, &pid);
     if (!f) {
-        snprintf(g_error, sizeof(g_error), "Failed to read search results");
+        snprintf(g_error, sizeof(g_error), "Failed to start search");
         return -1;
     }
 
+    pthread_mutex_lock(&g_search_mutex);
+    g_search_pid = pid;
+    pthread_mutex_unlock(&g_search_mutex);
+
+    // Lines can be long (thumbnail lists), so let getline size the buffer
     int count = 0;
-    char line[4096];
-
-    while (fgets(line, sizeof(line), f) && count < max_results) {
-        // Parse each line as JSON
-        cJSON *json = cJSON_Parse(line);
-        if (!json) continue;
-
-        // Extract fields
-        cJSON *id = cJSON_GetObjectItem(json, "id");
-        cJSON *title = cJSON_GetObjectItem(json, "title");
-        cJSON *channel = cJSON_GetObjectItem(json, "channel");
-        cJSON *uploader = cJSON_GetObjectItem(json, "uploader");  // Fallback
-        cJSON *duration = cJSON_GetObjectItem(json, "duration");
-
-        if (id && id->valuestring && title && title->valuestring) {
-            YouTubeResult *r = &results[count];
-            memset(r, 0, sizeof(YouTubeResult));
-
-            strncpy(r->id, id->valuestring, sizeof(r->id) - 1);
-            strncpy(r->title, title->valuestring, sizeof(r->title) - 1);
-
-            // Channel name (try channel first, then uploader)
-            if (channel && channel->valuestring) {
-                strncpy(r->channel, channel->valuestring, sizeof(r->channel) - 1);
-            } else if (uploader && uploader->valuestring) {
-                strncpy(r->channel, uploader->valuestring, sizeof(r->channel) - 1);
-            }
+    bool stopped = false;
+    char *line = NULL;
+    size_t line_cap = 0;
 
-            // Duration (may be null for live streams)
-            if (duration && cJSON_IsNumber(duration)) {
-                r->duration_sec = (int)duration->valuedouble;
-            }
+    while (count < max_results && getline(&line, &line_cap, f) > 0) {
+        YouTubeResult r;
+        if (!parse_search_line(line, &r)) continue;
 
-            count++;
-            printf("[YOUTUBE] Result %d: %s - %s (%ds)\n",
-                   count, r->channel, r->title, r->duration_sec);
-        }
+        count++;
+        printf("[YOUTUBE] Result %d: %s - %s (%ds)\n",
+               count, r.channel, r.title, r.duration_sec);
 
-        cJSON_Delete(json);
+        if (!on_result(&r, ctx)) {
+            stopped = true;
+            break;
+        }
     }
+    free(line);
+
+    // Forget the pid before reaping it, so a cancel can't signal a reused pid
+    pthread_mutex_lock(&g_search_mutex);
+    bool cancelled = (g_search_pid == 0);
+    g_search_pid = 0;
+    pthread_mutex_unlock(&g_search_mutex);
 
+    if (stopped || count >= max_results) {
+        kill(-pid, SIGTERM);
+    }
     fclose(f);
-    unlink(TEMP_SEARCH_FILE);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    if (cancelled || stopped) {
+        snprintf(g_error, sizeof(g_error), "Search cancelled");
+        printf("[YOUTUBE] Search cancelled after %d results\n", count);
+        return count > 0 ? count : -1;
+    }
 
     if (count == 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            snprintf(g_error, sizeof(g_error), "Search failed (network error?)");
+            fprintf(stderr, "[YOUTUBE] Search command failed with status %d\n", status);
+            return -1;
+        }
         snprintf(g_error, sizeof(g_error), "No results for '%s'", query);
     }
 
@@ -231,6 +295,40 @@ int youtube_search(const char *query, YouTubeResult *results, int max_results) {
     return count;
 }
 
+void youtube_search_cancel(void) {
+    pthread_mutex_lock(&g_search_mutex);
+    if (g_search_pid > 0) {
+        kill(-g_search_pid, SIGTERM);
+        g_search_pid = 0;
+    }
+    pthread_mutex_unlock(&g_search_mutex);
+}
+
+/**
+ * Collects streamed results into the caller's array (youtube_search)
+ */
+typedef struct {
+    YouTubeResult *results;
+    int count;
+} SearchCollector;
+
+static bool collect_result(const YouTubeResult *result, void *ctx) {
+    SearchCollector *c = (SearchCollector *)ctx;
+    c->results[c->count++] = *result;
+    return true;
+}
+
+int youtube_search(const char *query, YouTubeResult *results, int max_results) {
+    if (!results) {
+        snprintf(g_error, sizeof(g_error), "Invalid parameters");
+        return -1;
+    }
+
+    SearchCollector collector = {results, 0};
+    int count = youtube_search_stream(query, max_results, collect_result, &collector);
+    return (count < 0) ? -1 : collector.count;
+}
+
 const char* youtube_download(const char *video_id, const char *title, YouTubeProgressCallback progress_cb) {
     if (!g_available || !video_id) {
         snprintf(g_error, sizeof(g_error), "Invalid parameters");
@@ -382,6 +480,299 @@ const char* youtube_download(const char *video_id, const char *title, YouTubePro
     return g_download_file;
 }
 
+/**
+ * Quote a string for /bin/sh (single quotes, embedded ones escaped)
+ */
+static void shell_quote(const char *src, char *dst, size_t dst_size) {
+    size_t j = 0;
+    if (dst_size < 3) {
+        if (dst_size) dst[0] = '\0';
+        return;
+    }
+    dst[j++] = '\'';
+    for (size_t i = 0; src[i] && j + 5 < dst_size; i++) {
+        if (src[i] == '\'') {
+            memcpy(dst + j, "'\\''", 4);
+            j += 4;
+        } else {
+            dst[j++] = src[i];
+        }
+    }
+    dst[j++] = '\'';
+    dst[j] = '\0';
+}
+
+/**
+ * Wait for a job process, killing its group first if it was abandoned
+ * @return Exit status from waitpid
+ */
+static int finish_job(FILE *f, pid_t pid, bool kill_it) {
+    if (kill_it) kill(-pid, SIGTERM);
+    fclose(f);
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    return status;
+}
+
+/**
+ * Build the title-based file name stem for a download
+ */
+static void download_stem(const char *video_id, const char *title, char *dst, size_t dst_size) {
+    if (title && title[0]) {
+        sanitize_filename(title, dst, dst_size);
+    } else {
+        strncpy(dst, video_id, dst_size - 1);
+        dst[dst_size - 1] = '\0';
+    }
+}
+
+bool youtube_find_downloaded(const char *video_id, const char *title,
+                             char *path, size_t path_size) {
+    if (!video_id) return false;
+
+    char stem[256];
+    download_stem(video_id, title, stem, sizeof(stem));
+
+    // Title-based name first, then the old video_id-based one
+    const char *names[] = {stem, video_id, NULL};
+    const char *exts[] = {".mp3", ".opus", NULL};
+    for (int i = 0; names[i]; i++) {
+        for (int j = 0; exts[j]; j++) {
+            snprintf(path, path_size, "%s/%s%s", g_download_dir, names[i], exts[j]);
+            if (access(path, F_OK) == 0) return true;
+        }
+    }
+    return false;
+}
+
+bool youtube_fetch_audio(const char *video_id, const char *title, bool prefer_opus,
+                         char *path, size_t path_size, char *error, size_t error_size,
+                         YouTubeJobCallback progress_cb, void *ctx) {
+    error[0] = '\0';
+    path[0] = '\0';
+    if (!g_available || !video_id) {
+        snprintf(error, error_size, "Invalid parameters");
+        return false;
+    }
+
+    char stem[256];
+    download_stem(video_id, title, stem, sizeof(stem));
+
+    // Dot-prefixed so the library scan skips it until it is converted
+    char output_template[512];
+    char quoted_template[600];
+    snprintf(output_template, sizeof(output_template),
+             "%s/.%s.src.%%(ext)s", g_download_dir, stem);
+    shell_quote(output_template, quoted_template, sizeof(quoted_template));
+
+    // -f bestaudio: the native audio stream, no ffmpeg in this phase
+    // (Opus preferred when it is kept as is; SDL_mixer can't play AAC)
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd),
+        "%s -f '%sbestaudio/best' "
+        "--no-playlist --progress --newline "
+        "-o %s "
+        "'https://www.youtube.com/watch?v=%s' "
+        "2>&1",
+        g_ytdlp_path, prefer_opus ? "bestaudio[acodec=opus]/" : "",
+        quoted_template, video_id);
+
+    pid_t pid;
+    FILE *f = spawn_reader(cmd, &pid);
+    if (!f) {
+        snprintf(error, error_size, "Failed to start download");
+        return false;
+    }
+
+    char line[1024];
+    int last_percent = -1;
+    bool cancelled = false;
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = '\0';
+
+        // [download] Destination: <path> / [download] <path> has already been downloaded
+        const char *dest = strstr(line, "[download] Destination: ");
+        if (dest) {
+            snprintf(path, path_size, "%s", dest + strlen("[download] Destination: "));
+            continue;
+        }
+        char *already = strstr(line, " has already been downloaded");
+        if (already && strncmp(line, "[download] ", 11) == 0) {
+            *already = '\0';
+            snprintf(path, path_size, "%s", line + 11);
+            continue;
+        }
+
+        if (strstr(line, "ERROR")) {
+            snprintf(error, error_size, "%s", line);
+            continue;
+        }
+
+        // [download]  50.0% of 5.00MiB at ...
+        if (strncmp(line, "[download]", 10) != 0) continue;
+        char *pct = strchr(line, '%');
+        if (!pct) continue;
+        char *start = pct - 1;
+        while (start > line && (*start == '.' || (*start >= '0' && *start <= '9'))) {
+            start--;
+        }
+        int percent = (int)atof(start + 1);
+        if (percent != last_percent && progress_cb) {
+            last_percent = percent;
+            if (!progress_cb(percent, ctx)) {
+                cancelled = true;
+                break;
+            }
+        }
+    }
+
+    int status = finish_job(f, pid, cancelled);
+
+    if (cancelled) {
+        if (path[0]) unlink(path);
+        path[0] = '\0';
+        snprintf(error, error_size, "Download cancelled");
+        return false;
+    }
+
+    if (!path[0] || access(path, F_OK) != 0) {
+        if (!error[0]) snprintf(error, error_size, "Download failed (exit %d)", status);
+        path[0] = '\0';
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Run an ffmpeg job writing part_path, then move it to path
+ * Progress comes from -progress pipe:1 (out_time_ms=) against the input
+ * Duration line on stderr, so remuxes and transcodes report alike.
+ * @return true if ffmpeg succeeded and the file is in place
+ */
+static bool run_ffmpeg_job(const char *args, bool low_priority,
+                           const char *part_path, const char *path,
+                           bool *cancelled, YouTubeJobCallback progress_cb, void *ctx) {
+    const char *ffmpeg = file_executable(FFMPEG_BUNDLED_REL) ? FFMPEG_BUNDLED_REL : FFMPEG_SYSTEM;
+
+    char quoted_part[700];
+    shell_quote(part_path, quoted_part, sizeof(quoted_part));
+
+    char cmd[2048];
+    snprintf(cmd, sizeof(cmd),
+        "%s%s -nostdin -y -loglevel info %s -progress pipe:1 %s 2>&1",
+        low_priority ? "nice -n 19 " : "", ffmpeg, args, quoted_part);
+
+    pid_t pid;
+    FILE *f = spawn_reader(cmd, &pid);
+    if (!f) return false;
+
+    char line[512];
+    double duration_us = 0;
+    int last_percent = -1;
+    *cancelled = false;
+
+    while (fgets(line, sizeof(line), f)) {
+        const char *dur = strstr(line, "Duration: ");
+        if (dur && duration_us <= 0) {
+            int h = 0, m = 0;
+            double sec = 0;
+            if (sscanf(dur + 10, "%d:%d:%lf", &h, &m, &sec) == 3) {
+                duration_us = ((h * 60.0 + m) * 60.0 + sec) * 1000000.0;
+            }
+            continue;
+        }
+
+        // Despite the name, out_time_ms is in microseconds
+        if (strncmp(line, "out_time_ms=", 12) != 0 || duration_us <= 0) continue;
+        int percent = (int)(atof(line + 12) * 100.0 / duration_us);
+        if (percent < 0) percent = 0;
+        if (percent > 99) percent = 99;
+        if (percent != last_percent && progress_cb) {
+            last_percent = percent;
+            if (!progress_cb(percent, ctx)) {
+                *cancelled = true;
+                break;
+            }
+        }
+    }
+
+    int status = finish_job(f, pid, *cancelled);
+    bool ok = !*cancelled && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    if (!ok || rename(part_path, path) != 0) {
+        unlink(part_path);
+        return false;
+    }
+
+    if (progress_cb) progress_cb(100, ctx);
+    return true;
+}
+
+bool youtube_convert_mp3(const char *src_path, const char *video_id, const char *title,
+                         bool low_priority, char *path, size_t path_size,
+                         char *error, size_t error_size,
+                         YouTubeJobCallback progress_cb, void *ctx) {
+    error[0] = '\0';
+
+    char stem[256];
+    download_stem(video_id, title, stem, sizeof(stem));
+    snprintf(path, path_size, "%s/%s.mp3", g_download_dir, stem);
+
+    char part_path[600];
+    snprintf(part_path, sizeof(part_path), "%s/.%s.mp3.part", g_download_dir, stem);
+
+    // Same output settings the one-shot download used (VBR V0, 44.1kHz stereo)
+    char quoted_src[600];
+    char args[800];
+    shell_quote(src_path, quoted_src, sizeof(quoted_src));
+    snprintf(args, sizeof(args),
+             "-i %s -vn -ar 44100 -ac 2 -codec:a libmp3lame -q:a 0 -f mp3", quoted_src);
+
+    bool cancelled;
+    if (!run_ffmpeg_job(args, low_priority, part_path, path, &cancelled, progress_cb, ctx)) {
+        snprintf(error, error_size, cancelled ? "Download cancelled" :
+                 "MP3 conversion failed (ffmpeg error?)");
+        path[0] = '\0';
+        return false;
+    }
+
+    unlink(src_path);
+    return true;
+}
+
+bool youtube_remux_native(const char *src_path, const char *video_id, const char *title,
+                          char *path, size_t path_size, char *error, size_t error_size,
+                          YouTubeJobCallback progress_cb, void *ctx) {
+    error[0] = '\0';
+
+    char stem[256];
+    download_stem(video_id, title, stem, sizeof(stem));
+    snprintf(path, path_size, "%s/%s.opus", g_download_dir, stem);
+
+    char part_path[600];
+    snprintf(part_path, sizeof(part_path), "%s/.%s.opus.part", g_download_dir, stem);
+
+    // Stream copy into an Ogg/Opus file; the opus muxer rejects anything
+    // that isn't already Opus, which is the caller's cue to transcode
+    char quoted_src[600];
+    char args[800];
+    shell_quote(src_path, quoted_src, sizeof(quoted_src));
+    snprintf(args, sizeof(args), "-i %s -vn -map 0:a:0 -c:a copy -f opus", quoted_src);
+
+    bool cancelled;
+    if (!run_ffmpeg_job(args, false, part_path, path, &cancelled, progress_cb, ctx)) {
+        snprintf(error, error_size, cancelled ? "Download cancelled" :
+                 "No Opus stream to keep");
+        path[0] = '\0';
+        return false;
+    }
+
+    unlink(src_path);
+    return true;
+}
+
 const char* youtube_get_temp_path(void) {
     return g_download_file[0] ? g_download_file : NULL;
 }
@@ -9,6 +9,7 @@
 #define YOUTUBE_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 // Maximum search results
 #define YOUTUBE_MAX_RESULTS 10
@@ -25,6 +26,14 @@ typedef struct {
 // Returns false to cancel download
 typedef bool (*YouTubeProgressCallback)(int percent, const char *status);
 
+// Download job progress callback (queue workers; reentrant)
+// Returns false to cancel the job
+typedef bool (*YouTubeJobCallback)(int percent, void *ctx);
+
+// Streaming search callback, called once per result as yt-dlp prints it
+// Returns false to stop the search
+typedef bool (*YouTubeResultCallback)(const YouTubeResult *result, void *ctx);
+
 /**
  * Initialize YouTube system
  * Checks for yt-dlp availability
@@ -52,6 +61,23 @@ bool youtube_is_available(void);
  */
 int youtube_search(const char *query, YouTubeResult *results, int max_results);
 
+/**
+ * Search YouTube, delivering results as they arrive (blocking)
+ * Safe to run on a worker thread; youtube_search_cancel() stops it.
+ * @param query Search query string
+ * @param max_results Maximum results to return (up to YOUTUBE_MAX_RESULTS)
+ * @param on_result Called for each result
+ * @param ctx Passed to on_result
+ * @return Number of results delivered, or -1 on error
+ */
+int youtube_search_stream(const char *query, int max_results,
+                          YouTubeResultCallback on_result, void *ctx);
+
+/**
+ * Stop a running search (kills yt-dlp; youtube_search_stream returns)
+ */
+void youtube_search_cancel(void);
+
 /**
  * Download audio from YouTube video
  * @param video_id YouTube video ID
@@ -61,6 +87,74 @@ int youtube_search(const char *query, YouTubeResult *results, int max_results);
  */
 const char* youtube_download(const char *video_id, const char *title, YouTubeProgressCallback progress_cb);
 
+/**
+ * Look for an already downloaded MP3 or Opus file of a video
+ * @param video_id YouTube video ID
+ * @param title Video title (can be NULL)
+ * @param path Output: file path when found
+ * @param path_size Size of path
+ * @return true if the file exists
+ */
+bool youtube_find_downloaded(const char *video_id, const char *title,
+                             char *path, size_t path_size);
+
+/**
+ * Download a video's native audio stream (network phase, no transcode)
+ * Thread-safe: all state is in the arguments.
+ * @param video_id YouTube video ID
+ * @param title Video title (used for the file name, can be NULL)
+ * @param prefer_opus Pick the Opus stream when there is one (for remuxing)
+ * @param path Output: downloaded source file (hidden, in the download dir)
+ * @param path_size Size of path
+ * @param error Output: error message on failure
+ * @param error_size Size of error
+ * @param progress_cb Optional progress callback (0-100)
+ * @param ctx Passed to progress_cb
+ * @return true on success
+ */
+bool youtube_fetch_audio(const char *video_id, const char *title, bool prefer_opus,
+                         char *path, size_t path_size, char *error, size_t error_size,
+                         YouTubeJobCallback progress_cb, void *ctx);
+
+/**
+ * Transcode a fetched source file to the final MP3 (CPU phase)
+ * Thread-safe. Removes the source file on success.
+ * @param src_path File from youtube_fetch_audio()
+ * @param video_id YouTube video ID
+ * @param title Video title (can be NULL)
+ * @param low_priority Run ffmpeg at the lowest CPU priority
+ * @param path Output: final MP3 path
+ * @param path_size Size of path
+ * @param error Output: error message on failure
+ * @param error_size Size of error
+ * @param progress_cb Optional progress callback (0-100)
+ * @param ctx Passed to progress_cb
+ * @return true on success
+ */
+bool youtube_convert_mp3(const char *src_path, const char *video_id, const char *title,
+                         bool low_priority, char *path, size_t path_size,
+                         char *error, size_t error_size,
+                         YouTubeJobCallback progress_cb, void *ctx);
+
+/**
+ * Keep a fetched Opus stream as is, remuxed into an .opus file (no re-encode)
+ * Thread-safe. Removes the source file on success; fails (source kept)
+ * if the stream isn't Opus, so the caller can fall back to MP3.
+ * @param src_path File from youtube_fetch_audio()
+ * @param video_id YouTube video ID
+ * @param title Video title (can be NULL)
+ * @param path Output: final .opus path
+ * @param path_size Size of path
+ * @param error Output: error message on failure
+ * @param error_size Size of error
+ * @param progress_cb Optional progress callback (0-100)
+ * @param ctx Passed to progress_cb
+ * @return true on success
+ */
+bool youtube_remux_native(const char *src_path, const char *video_id, const char *title,
+                          char *path, size_t path_size, char *error, size_t error_size,
+                          YouTubeJobCallback progress_cb, void *ctx);
+
 /**
  * Get the path to the last downloaded file
  * @return Path to temp file, or NULL if no download
@@ -3,10 +3,19 @@
  *
  * Manages search input, results list, and download progress states.
  * Follows patterns from filemenu.c (character picker) and browser.c (list).
+ *
+ * Searches run on a worker thread (threading follows preload.c: one
+ * worker, one pending request, pthread mutex/cond). Results stream in one
+ * at a time and are copied into the UI-side list by ytsearch_update_search()
+ * on the main thread, so every other accessor stays lock-free. Repeated
+ * queries are answered from searchcache.c and refreshed in the background
+ * when the entry is stale.
  */
 
 #include "ytsearch.h"
 #include "youtube.h"
+#include "searchcache.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -49,13 +58,102 @@ static const char *g_downloaded_path = NULL;
 // Error state
 static char g_error[256] = {0};
 
-// Search pending flag (for async-like behavior)
+// Search results cache service name
+#define YTSEARCH_CACHE_SERVICE "youtube"
+
+// Search in progress (main thread view)
 static bool g_search_pending = false;
+static bool g_revalidating = false;        // Showing cached results, refresh running
+static char g_active_query[128] = {0};     // Query the running search was started for
+
+// Search worker
+static pthread_t g_thread;
+static bool g_thread_running = false;
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static bool g_shutdown = false;
+static char g_request_query[128] = {0};    // Waiting for the worker
+static bool g_request_ready = false;
+static unsigned int g_generation = 0;      // Bumped per search/cancel; stale results are dropped
+static YouTubeResult g_incoming[YOUTUBE_MAX_RESULTS];  // Shared with the worker
+static int g_incoming_count = 0;
+static bool g_search_done = false;
+static int g_search_status = 0;            // youtube_search_stream() result
+static char g_search_error[256] = {0};
 
 // Render callback for progress updates
 static YTSearchRenderCallback g_render_callback = NULL;
 
+/**
+ * Worker: take one result from yt-dlp (worker thread)
+ * @return false once the search has been superseded or cancelled
+ */
+static bool on_search_result(const YouTubeResult *result, void *ctx) {
+    unsigned int generation = *(const unsigned int *)ctx;
+
+    pthread_mutex_lock(&g_mutex);
+    bool current = (generation == g_generation && !g_shutdown);
+    if (current && g_incoming_count < YOUTUBE_MAX_RESULTS) {
+        g_incoming[g_incoming_count++] = *result;
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return current;
+}
+
+/**
+ * Worker: run the latest requested search
+ */
+static void* search_thread_func(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_mutex);
+    while (!g_shutdown) {
+        if (!g_request_ready) {
+            pthread_cond_wait(&g_cond, &g_mutex);
+            continue;
+        }
+
+        char query[sizeof(g_request_query)];
+        strncpy(query, g_request_query, sizeof(query) - 1);
+        query[sizeof(query) - 1] = '\0';
+        unsigned int generation = g_generation;
+        g_request_ready = false;
+        pthread_mutex_unlock(&g_mutex);
+
+        int status = youtube_search_stream(query, YOUTUBE_MAX_RESULTS, on_search_result, &generation);
+        const char *err = youtube_get_error();
+
+        pthread_mutex_lock(&g_mutex);
+        if (generation == g_generation) {
+            g_search_status = status;
+            snprintf(g_search_error, sizeof(g_search_error), "%s", err ? err : "");
+            g_search_done = true;
+        }
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return NULL;
+}
+
+/**
+ * Drop the running search, if any (main thread)
+ */
+static void cancel_search(void) {
+    if (!g_thread_running) return;
+
+    pthread_mutex_lock(&g_mutex);
+    g_generation++;
+    g_request_ready = false;
+    pthread_mutex_unlock(&g_mutex);
+
+    if (g_search_pending) {
+        youtube_search_cancel();
+        g_search_pending = false;
+    }
+    g_revalidating = false;
+}
+
 void ytsearch_init(void) {
+    cancel_search();
     g_state = YTSEARCH_INPUT;
     g_query[0] = '\0';
     g_query_cursor = 0;
@@ -78,9 +176,26 @@ YTSearchState ytsearch_get_state(void) {
 }
 
 void ytsearch_set_state(YTSearchState state) {
+    // Leaving the results for input abandons a search still streaming in
+    if (state == YTSEARCH_INPUT) {
+        cancel_search();
+    }
     g_state = state;
 }
 
+void ytsearch_cleanup(void) {
+    if (!g_thread_running) return;
+
+    cancel_search();
+    pthread_mutex_lock(&g_mutex);
+    g_shutdown = true;
+    pthread_cond_broadcast(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+    youtube_search_cancel();
+    pthread_join(g_thread, NULL);
+    g_thread_running = false;
+}
+
 // ============================================================================
 // Input State
 // ============================================================================
@@ -182,45 +297,139 @@ bool ytsearch_execute_search(void) {
         return false;
     }
 
+    cancel_search();
+
     g_error[0] = '\0';
-    g_state = YTSEARCH_SEARCHING;
+    g_result_count = 0;
+    g_results_cursor = 0;
+    g_scroll_offset = 0;
+    strncpy(g_active_query, g_query, sizeof(g_active_query) - 1);
+    g_active_query[sizeof(g_active_query) - 1] = '\0';
+
+    // Cached results show immediately; stale ones are refreshed below
+    bool stale = false;
+    int cached = searchcache_get(YTSEARCH_CACHE_SERVICE, g_query, g_results,
+                                 sizeof(YouTubeResult), YOUTUBE_MAX_RESULTS, &stale);
+    if (cached > 0) {
+        g_result_count = cached;
+        g_state = YTSEARCH_RESULTS;
+        if (!stale) {
+            return true;
+        }
+    } else {
+        g_state = YTSEARCH_SEARCHING;
+    }
+    g_revalidating = (cached > 0);
+
+    // Worker starts on first use
+    if (!g_thread_running) {
+        g_shutdown = false;
+        if (pthread_create(&g_thread, NULL, search_thread_func, NULL) != 0) {
+            if (cached > 0) return true;  // Cached results are still good
+            snprintf(g_error, sizeof(g_error), "Search failed to start");
+            g_state = YTSEARCH_INPUT;
+            return false;
+        }
+        g_thread_running = true;
+    }
+
     g_search_pending = true;
 
-    printf("[YTSEARCH] Starting search for: %s\n", g_query);
+    pthread_mutex_lock(&g_mutex);
+    strncpy(g_request_query, g_query, sizeof(g_request_query) - 1);
+    g_request_query[sizeof(g_request_query) - 1] = '\0';
+    g_incoming_count = 0;
+    g_search_done = false;
+    g_request_ready = true;
+    pthread_cond_signal(&g_cond);
+    pthread_mutex_unlock(&g_mutex);
+
+    printf("[YTSEARCH] Starting %s for: %s\n", g_revalidating ? "refresh" : "search", g_query);
     return true;
 }
 
+/**
+ * Swap in refreshed results behind cached ones (main thread)
+ */
+static void finish_revalidation(int count) {
+    if (count <= 0) return;  // Keep showing the cached list
+
+    pthread_mutex_lock(&g_mutex);
+    memcpy(g_results, g_incoming, count * sizeof(YouTubeResult));
+    pthread_mutex_unlock(&g_mutex);
+    g_result_count = count;
+
+    if (g_results_cursor >= g_result_count) g_results_cursor = g_result_count - 1;
+    if (g_scroll_offset > g_results_cursor) g_scroll_offset = g_results_cursor;
+
+    searchcache_put(YTSEARCH_CACHE_SERVICE, g_active_query, g_results,
+                    sizeof(YouTubeResult), g_result_count);
+    printf("[YTSEARCH] Refreshed: %d results\n", g_result_count);
+}
+
 bool ytsearch_update_search(void) {
-    if (g_state != YTSEARCH_SEARCHING || !g_search_pending) {
+    if (!g_search_pending) {
         return false;
     }
 
-    // Perform the actual search (blocking)
-    g_search_pending = false;
-    g_result_count = youtube_search(g_query, g_results, YOUTUBE_MAX_RESULTS);
+    // Copy whatever arrived since last frame (refreshes swap in at the end)
+    pthread_mutex_lock(&g_mutex);
+    int incoming = g_incoming_count;
+    if (!g_revalidating && incoming > g_result_count) {
+        memcpy(&g_results[g_result_count], &g_incoming[g_result_count],
+               (incoming - g_result_count) * sizeof(YouTubeResult));
+        g_result_count = incoming;
+    }
+    bool done = g_search_done;
+    int status = g_search_status;
+    char err[sizeof(g_search_error)];
+    memcpy(err, g_search_error, sizeof(err));
+    pthread_mutex_unlock(&g_mutex);
+
+    if (g_revalidating) {
+        if (done) {
+            g_search_pending = false;
+            g_revalidating = false;
+            finish_revalidation(status > 0 ? incoming : 0);
+        }
+        return false;
+    }
 
-    if (g_result_count < 0) {
-        // Error
-        const char *err = youtube_get_error();
-        snprintf(g_error, sizeof(g_error), "%s", err ? err : "Search failed");
-        g_result_count = 0;
-        g_state = YTSEARCH_INPUT;
-        return true;
+    bool changed = false;
+
+    // First result: show the list right away, the rest keeps streaming in
+    if (g_state == YTSEARCH_SEARCHING && g_result_count > 0) {
+        g_state = YTSEARCH_RESULTS;
+        changed = true;
+    }
+
+    if (!done) {
+        return changed;
     }
 
+    g_search_pending = false;
+
     if (g_result_count == 0) {
-        snprintf(g_error, sizeof(g_error), "No results for '%s'", g_query);
+        if (status < 0) {
+            snprintf(g_error, sizeof(g_error), "%s", err[0] ? err : "Search failed");
+        } else {
+            snprintf(g_error, sizeof(g_error), "No results for '%s'", g_query);
+        }
         g_state = YTSEARCH_INPUT;
         return true;
     }
 
-    // Success - switch to results
-    g_results_cursor = 0;
-    g_scroll_offset = 0;
-    g_state = YTSEARCH_RESULTS;
+    if (status > 0) {
+        searchcache_put(YTSEARCH_CACHE_SERVICE, g_active_query, g_results,
+                        sizeof(YouTubeResult), g_result_count);
+    }
 
     printf("[YTSEARCH] Search complete: %d results\n", g_result_count);
-    return true;
+    return changed;
+}
+
+bool ytsearch_is_searching(void) {
+    return g_search_pending;
 }
 
 // ============================================================================
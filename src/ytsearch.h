@@ -27,6 +27,11 @@ typedef enum {
  */
 void ytsearch_init(void);
 
+/**
+ * Stop the search worker (call at app exit)
+ */
+void ytsearch_cleanup(void);
+
 /**
  * Get current UI state
  */
@@ -105,18 +110,27 @@ bool ytsearch_has_query(void);
 
 /**
  * Execute YouTube search with current query
- * Changes state to YTSEARCH_SEARCHING, then YTSEARCH_RESULTS
- * @return true if search started
+ * Changes state to YTSEARCH_SEARCHING, then YTSEARCH_RESULTS. A cached
+ * query goes straight to YTSEARCH_RESULTS (refreshed in the background
+ * if stale).
+ * @return true if search started or was answered from the cache
  */
 bool ytsearch_execute_search(void);
 
 /**
- * Update search (call each frame when YTSEARCH_SEARCHING)
- * Performs the actual search operation
- * @return true when search is complete (state changed to RESULTS)
+ * Update search (call each frame while a search is running)
+ * Picks up results streamed in by the search worker. The state moves to
+ * YTSEARCH_RESULTS with the first result, or back to YTSEARCH_INPUT with
+ * an error if the search ends empty.
+ * @return true when the state changed
  */
 bool ytsearch_update_search(void);
 
+/**
+ * Check if a search is still running (results may still arrive)
+ */
+bool ytsearch_is_searching(void);
+
 // ============================================================================
 // Results State
 // ============================================================================